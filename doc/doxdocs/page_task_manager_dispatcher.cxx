@@ -64,6 +64,10 @@
  *
  *  - \subpage pageInterfaceTaskDispatcher
  *
+ * The tasks of several independent computations, for instance the same analysis of
+ * different data sets, can be run by a single task dispatcher with the help of \ref
+ * Tomographer::MultiProc::BatchTaskCData and \ref Tomographer::MultiProc::BatchTask.
+ *
  */
 
 // no longer:  *  - \subpage pageInterfaceResultsCollector
@@ -332,6 +336,21 @@
  *   http://pubs.opengroup.org/onlinepubs/9699919799/functions/V2_chap02.html#tag_15_04_03_03
  *   
  *
+ * \par void setCompletedTaskResult(TaskCountIntType k, TaskResultType * result)
+ *   Provide the result of the task number \a k, which was already computed beforehand
+ *   (e.g. loaded from a checkpoint file, see \ref
+ *   Tomographer::MultiProc::TaskResultsCheckpoint).  This task will not be run, and the
+ *   task dispatcher takes ownership of the \a result pointer.  Call this function before
+ *   calling \a run().  (Since %Tomographer 5.5.)
+ *
+ * \par void setTaskCompletedHandler(Fn fn)
+ *   The argument should be a callable which accepts the parameters <code>(TaskCountIntType
+ *   k, const TaskResultType & result)</code>.  It is called each time a task has
+ *   completed, with the task number and its result.  Calls to this handler are
+ *   serialized, i.e., the handler is never called simultaneously from different threads.
+ *   It is not called for the tasks whose results were given with \a
+ *   setCompletedTaskResult().  (Since %Tomographer 5.5.)
+ *
  *
  * The \a TaskDispatcher must also provide the following typedefs:
  *
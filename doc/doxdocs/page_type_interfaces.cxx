@@ -262,6 +262,45 @@
  *     ratio \f$ P(\mathrm{newpt})/P(\mathrm{curpt}) \f$.  See below ("Role of
  *     UseFnSyntaxType").
  *
+ * A \a MHWalker may optionally provide a cache for quantities derived from a point:
+ *
+ * \since Added in %Tomographer 5.5: the optional \a PointCacheType.
+ *
+ * \par typedef ... PointCacheType
+ *     A default-constructible and swappable type which stores a point along with any
+ *     quantities derived from it which are needed to calculate the function value (for
+ *     instance, \ref Tomographer::DenseDM::TSpace::DensePointCache stores \f$ \rho =
+ *     TT^\dagger \f$).  This is only supported if <em>UseFnSyntaxType ==
+ *     MHUseFnLogValue</em>.  The \ref Tomographer::MHRandomWalk then keeps a cache for the
+ *     current point and one for the proposed new point, and exchanges them when a move is
+ *     accepted.  The cache of the current point is available to the stats collectors via
+ *     \ref Tomographer::MHRandomWalk::getCurrentPointCache() "getCurrentPointCache()", so
+ *     that, e.g., value calculators can reuse the derived quantities (see \ref
+ *     pageInterfaceValueCalculator).
+ *
+ * \par FnValueType fnLogVal(const PointType & pt, PointCacheType & cache)
+ *     <em>[Required only if PointCacheType is declared.]</em>
+ *     Store the point \a pt in \a cache, and return the value of \f$ \ln P(x) \f$ at \a
+ *     pt, reusing or storing in \a cache any derived quantities.  The random walk calls
+ *     this method instead of <code>fnLogVal(pt)</code>.
+ *
+ * A \a MHWalker whose proposal distribution is not symmetric may provide the correction
+ * to the acceptance probability:
+ *
+ * \since Added in %Tomographer 5.5: the optional \a jumpLogProposalRatio().
+ *
+ * \par double jumpLogProposalRatio() const
+ *     <em>[Optional; only supported if UseFnSyntaxType == MHUseFnLogValue.]</em> Return
+ *     \f$ \ln[\,q(\mathrm{curpt}\mid\mathrm{newpt}) / q(\mathrm{newpt}\mid\mathrm{curpt})\,]
+ *     \f$ for the point <code>newpt</code> returned by the last call to
+ *     <code>jumpFn(curpt, ...)</code>, where \f$ q \f$ is the proposal distribution.
+ *     The random walk adds this term to \f$ \ln P(\mathrm{newpt}) - \ln
+ *     P(\mathrm{curpt}) \f$ to determine the acceptance probability.  For a Hamiltonian
+ *     Monte Carlo walker such as \ref Tomographer::DenseDM::TSpace::LLHHMCWalker, this is
+ *     the decrease of the kinetic energy along the trajectory.  If this method is
+ *     present, <code>jumpFn()</code> is called exactly once before each evaluation of the
+ *     acceptance probability.
+ *
  * <br>
  * 
  * \anchor labelMHWalkerUseFnSyntaxType
@@ -354,6 +393,13 @@
  *    being modified between this callback and future other callbacks (such as \a
  *    adjustParams()).
  *
+ * \par
+ *    The parameters are only mutable if the \a AdjustmentStrategy sets at least one
+ *    stage flag.  A controller which only changes the parameters here may set \a
+ *    MHRWControllerAdjustWhileThermalizing without any frequency flag; it is then
+ *    compatible with any other controller (see, e.g., \ref
+ *    Tomographer::MHRWSweepSizeController).
+ *
  * \par template<bool IsThermalizing, bool IsAfterSample> inline void adjustParams(MHRWParamsType & params, const MHWalker & mhwalker, CountIntType iter_k, const MHRandomWalkType & mhrw)
  *    This function is responsible for adjusting the random walk paramters (see \ref
  *    pageInterfaceMHWalker) stored in \a params (it should update the params in place).
@@ -444,6 +490,17 @@
  * \par ValueType getValue(PointType pt) const
  *     Get the value corresponding to a particular point \a pt.
  *
+ * A \a ValueCalculator may optionally provide:
+ *
+ * \par typedef ... PointCacheType
+ *     A point cache type (see \ref pageInterfaceMHWalker), in which case it must also
+ *     provide <code>ValueType getValue(const PointCacheType & cache) const</code>,
+ *     calculating the value at the point stored in \a cache.  Stats collectors then use
+ *     the cache of the current point of the random walk, if the random walk has a point
+ *     cache of the same type (see \ref Tomographer::getValueAtCurrentPoint()).
+ *
+ * \since Added in %Tomographer 5.5: the optional \a PointCacheType.
+ *
  */
 
 
@@ -510,6 +567,14 @@
  *     Tomographer::MHRWNoController is used.
  *
  * \par
+ *     To run the random walk with parallel tempering (see \ref
+ *     Tomographer::MHRandomWalkTempering), pass the inverse temperatures of the replicas
+ *     as a fourth argument, as a <code>std::vector<double></code>:
+ *     \code
+ *         run(mhwalker, stats_collector, controller, tempering_betas);
+ *     \endcode
+ *
+ * \par
  *     If you are using the tools in \ref Tomographer::MHRWTasks::ValueHistogramTools, in
  *     particular inheriting from \ref
  *     Tomographer::MHRWTasks::ValueHistogramTools::CDataBase, then you should use the
@@ -521,10 +586,23 @@
  *     Have a look at "test/minimal_tomorun.cxx", "test/minimal_tomorun_controlled.cxx",
  *     "py/cxx/pytomorun.cxx" and "tomorun/tomorun_dispatch.cxx" for examples.
  *
+ * Optionally, the following method may be provided:
+ *
+ * \par MHRWAutocorrelationStatsCollectorType createAutocorrelationStatsCollector(LoggerType & logger) const
+ *     Create the \ref Tomographer::MHRWAutocorrelationStatsCollector which estimates the
+ *     autocorrelation times reported in the \a autocorrelation field of the \ref
+ *     Tomographer::MHRWTasks::MHRandomWalkTaskResult.  Provide this method in order to
+ *     include your figure of merit in the analysis.  If it is not provided, only the
+ *     function value of the random walk (e.g., the log-likelihood) is analyzed.  \ref
+ *     Tomographer::MHRWTasks::ValueHistogramTools::CDataBase provides this method for its
+ *     value calculator.
+ *
  *
  * \since Changed in %Tomographer 5.0: createMHWalker() and createStatsCollector()
  *     have been replaced by the more flexible setupRandomWalkAndRun().
  *
+ * \since Added in %Tomographer 5.5: the optional createAutocorrelationStatsCollector().
+ *
  */
 
 
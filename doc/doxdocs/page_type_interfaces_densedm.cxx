@@ -65,10 +65,13 @@
  * \note Here, the log-likelihood function is defined WITHOUT any \f$ -2 \f$ factor which
  *       is sometimes conventionally implied.
  *
- * Currently, the only implementation is \ref Tomographer::DenseDM::IndepMeasLLH, which
+ * The main implementation is \ref Tomographer::DenseDM::IndepMeasLLH, which
  * stores the individual POVM effects along with frequencies, while assuming that the
  * global observed POVM effect (in the general scenario) can be written as a product of
- * effects (though this does not imply that the POVM itself is a product POVM).
+ * effects (though this does not imply that the POVM itself is a product POVM).  The
+ * class \ref Tomographer::DenseDM::FactoredMeasLLH makes the same assumption, but stores
+ * the effects in factored form, which is much faster for low-rank effects in high
+ * dimensions.
  *
  * A \a DenseLLH compliant type should expose the following members:
  *
@@ -86,8 +89,9 @@
  *
  * \par enum { LLHCalcType = ... }
  *   Specifies how this object can calculate the loglikelihood function.  The value must
- *   be one of \ref Tomographer::DenseDM::LLHCalcTypeX "LLHCalcTypeX" or \ref
- *   Tomographer::DenseDM::LLHCalcTypeRho "LLHCalcTypeRho".  (In the future, we may add
+ *   be one of \ref Tomographer::DenseDM::LLHCalcTypeX "LLHCalcTypeX", \ref
+ *   Tomographer::DenseDM::LLHCalcTypeRho "LLHCalcTypeRho" or \ref
+ *   Tomographer::DenseDM::LLHCalcTypeT "LLHCalcTypeT".  (In the future, we may add
  *   more values to this enum to support further parameterizations.)
  *
  * \par LLHValueType logLikelihoodX(VectorParamTypeConstRef x)
@@ -100,5 +104,33 @@
  *   value of the loglikelihood function for the point \a rho, given as a density matrix.
  *   The argument type \a MatrixTypeConstRef matches the one declared in \a DMTypes.
  *
+ * \par LLHValueType logLikelihoodT(MatrixTypeConstRef T)
+ *   <em>(Required only if <code>LLHCalcType = LLHCalcTypeT</code>)</em> Calculate the
+ *   value of the loglikelihood function for the point \f$ \rho = TT^\dagger \f$, given
+ *   the matrix \a T.  This avoids computing \f$ TT^\dagger \f$ when the likelihood can
+ *   be evaluated more efficiently from \a T directly.
+ *
+ * The Hamiltonian random walk \ref Tomographer::DenseDM::TSpace::LLHHMCWalker
+ * additionally needs the gradient of the log-likelihood function.  A \a DenseLLH type
+ * which is to be used with it should expose the gradient corresponding to its \a
+ * LLHCalcType:
+ *
+ * \since Added in %Tomographer 5.5: the optional gradient methods.
+ *
+ * \par VectorParamType gradLogLikelihoodX(VectorParamTypeConstRef x)
+ *   <em>(If <code>LLHCalcType = LLHCalcTypeX</code>)</em> Return the vector of partial
+ *   derivatives of <code>logLikelihoodX(x)</code> with respect to the components of \a
+ *   x.
+ *
+ * \par MatrixType gradLogLikelihoodRho(MatrixTypeConstRef rho)
+ *   <em>(If <code>LLHCalcType = LLHCalcTypeRho</code>)</em> Return the Hermitian matrix
+ *   \f$ G \f$ such that the variation of the loglikelihood function is \f$
+ *   \mathrm{tr}(G\,d\rho) \f$ to first order.
+ *
+ * \par MatrixType gradLogLikelihoodT(MatrixTypeConstRef T)
+ *   <em>(If <code>LLHCalcType = LLHCalcTypeT</code>)</em> Return the matrix whose real
+ *   and imaginary parts are the partial derivatives of <code>logLikelihoodT(T)</code>
+ *   with respect to the real and imaginary parts of the entries of \a T.
+ *
  */
 
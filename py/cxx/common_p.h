@@ -30,6 +30,10 @@
 #define TOMOPY_COMMON_P_H
 
 #include <memory>
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
 
 #include <tomographerpy/common.h>
 #include <tomographerpy/exc.h> // TomographerCxxError
@@ -81,6 +85,50 @@ Kl * unpack_tuple_and_construct(py::tuple t)
   return construct_from_tuple_args<Kl, std::tuple<Args...> >(t, make_index_sequence<sizeof...(Args)>()) ;
 }
 
+
+// Call fn(begin, end) on contiguous chunks of [0, n) from separate threads.  Must be
+// called with the GIL released; fn must not touch any Python object.
+template<typename Fn>
+inline void parallel_for_chunks(Eigen::Index n, int num_threads, Fn fn)
+{
+  // not worth spawning a thread for less than this many items
+  static constexpr Eigen::Index MinChunkSize = 32;
+
+  if (num_threads <= 0) {
+    num_threads = (int)std::max(1u, std::thread::hardware_concurrency());
+  }
+  num_threads = (int)std::min<Eigen::Index>(num_threads, std::max<Eigen::Index>(1, n / MinChunkSize));
+
+  if (num_threads <= 1) {
+    fn(Eigen::Index(0), n);
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  std::vector<std::exception_ptr> errors(num_threads);
+  threads.reserve(num_threads);
+  const Eigen::Index chunk = (n + num_threads - 1) / num_threads;
+  for (int t = 0; t < num_threads; ++t) {
+    const Eigen::Index begin = std::min(n, t * chunk);
+    const Eigen::Index end = std::min(n, begin + chunk);
+    threads.emplace_back([&fn,&errors,t,begin,end]() {
+        try {
+          fn(begin, end);
+        } catch (...) {
+          errors[t] = std::current_exception();
+        }
+      });
+  }
+  for (auto & th : threads) {
+    th.join();
+  }
+  for (auto & e : errors) {
+    if (e) {
+      std::rethrow_exception(e);
+    }
+  }
+}
+
 } // internal
 } // namespace tpy
 
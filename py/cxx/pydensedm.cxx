@@ -27,6 +27,7 @@
 
 
 #include <cstdint>
+#include <cmath>
 
 #include <tomographerpy/common.h>
 #include <tomographerpy/exc.h>
@@ -37,6 +38,39 @@
 #include "common_p.h"
 
 
+namespace tpy { namespace internal {
+
+// Stacked X-parameterization vectors, one per row, as for IndepMeasLLH::Exn()
+typedef Eigen::Matrix<RealScalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> RealRowsMatrixType;
+// A single matrix inside a C-contiguous (N, dim, dim) NumPy array
+typedef Eigen::Matrix<ComplexScalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> CplxRowMajorMatrixType;
+// The (N, dim, dim) stacked complex matrices accepted by the batch methods
+typedef py::array_t<ComplexScalar, py::array::c_style | py::array::forcecast> CplxMatrixStackType;
+
+// Extract the number of matrices in a (N, dim, dim) array, checking its shape
+inline Eigen::Index check_matrix_stack(const CplxMatrixStackType & A, Eigen::Index dim)
+{
+  if (A.ndim() != 3 || A.shape(1) != dim || A.shape(2) != dim) {
+    throw TomographerCxxError(streamstr("Expected a stack of matrices of shape (N, "<<dim<<", "<<dim<<")"));
+  }
+  return (Eigen::Index)A.shape(0);
+}
+
+// Log-likelihood at each row of X; rows [begin,end) are processed as a single
+// matrix-matrix product with the POVM effects
+inline void llh_rows(const IndepMeasLLH & l, const Eigen::Ref<const RealRowsMatrixType> & X,
+                     RealScalar * out, Eigen::Index begin, Eigen::Index end)
+{
+  // Same as IndepMeasLLH::logLikelihoodX() for each row; tpy::IndepMeasLLH does not use
+  // any NMeasAmplifyFactor
+  const RealRowsMatrixType EX = X.middleRows(begin, end-begin) * l.Exn().transpose();
+  Eigen::Map<RealVectorType>(out + begin, end-begin) =
+    EX.array().log().matrix() * l.Nx().cast<RealScalar>().matrix();
+}
+
+} } // namespace tpy::internal
+
+
 void py_tomo_densedm(py::module rootmodule)
 {
   auto logger = Tomographer::Logger::makeLocalLogger(TOMO_ORIGIN, *tpy::logger);
@@ -145,6 +179,72 @@ void py_tomo_densedm(py::module rootmodule)
         "is expected to be a `numpy.array` object.  Returns a 2-D "
         "`numpy.array` object containing the full Hermitian matrix."
           )
+      .def("HermToXBatch", [](const Kl& p, tpy::internal::CplxMatrixStackType Herms, int num_threads) {
+          // ParamX checks that the dimension matches, see below
+          const Eigen::Index dim = Herms.ndim() == 3 ? (Eigen::Index)Herms.shape(1) : 0;
+          const Eigen::Index N = tpy::internal::check_matrix_stack(Herms, dim);
+          py::array_t<tpy::RealScalar> X({ N, dim*dim });
+          const tpy::ComplexScalar * src = Herms.data();
+          tpy::RealScalar * dst = X.mutable_data();
+          {
+            py::gil_scoped_release gil_release;
+            tpy::internal::parallel_for_chunks(N, num_threads, [&](Eigen::Index begin, Eigen::Index end) {
+                // HermToX() fails an assertion if dim doesn't match, which is reported
+                // as an exception by parallel_for_chunks()
+                for (Eigen::Index i = begin; i < end; ++i) {
+                  Eigen::Map<tpy::RealVectorType>(dst + i*dim*dim, dim*dim) =
+                    p.HermToX(Eigen::Map<const tpy::internal::CplxRowMajorMatrixType>(src + i*dim*dim, dim, dim));
+                }
+              });
+          }
+          return X;
+        }, "Herms"_a, "num_threads"_a = 0,
+        // docstring
+        "HermToXBatch(Herms, [num_threads=0])"
+        "\n\n"
+        "Calculate the X-parameterization of many Hermitian matrices at once.  The argument `Herms` "
+        "is a 3-D `numpy.array` of shape `(N, dim, dim)`.  Returns a 2-D `numpy.array` of shape "
+        "`(N, dim*dim)` whose `i`-th row is `HermToX(Herms[i])`."
+        "\n\n"
+        "The calculation is carried out without holding the Python GIL, split over `num_threads` "
+        "threads (by default, as many as there are CPUs)."
+        "\n\n"
+        ".. versionadded:: 5.5"
+          )
+      .def("XToHermBatch", [](const Kl& p, const Eigen::Ref<const tpy::internal::RealRowsMatrixType> & X,
+                              int num_threads) {
+          // ParamX checks that the dimension matches, see below
+          const Eigen::Index dim = (Eigen::Index)std::lround(std::sqrt((double)X.cols()));
+          if (X.cols() != dim*dim) {
+            throw tpy::TomographerCxxError(streamstr("Invalid length of X-parameterization vectors: "<<X.cols()));
+          }
+          const Eigen::Index N = X.rows();
+          tpy::internal::CplxMatrixStackType Herms({ N, dim, dim });
+          tpy::ComplexScalar * dst = Herms.mutable_data();
+          {
+            py::gil_scoped_release gil_release;
+            tpy::internal::parallel_for_chunks(N, num_threads, [&](Eigen::Index begin, Eigen::Index end) {
+                // XToHerm() fails an assertion if dim doesn't match, as above
+                for (Eigen::Index i = begin; i < end; ++i) {
+                  Eigen::Map<tpy::internal::CplxRowMajorMatrixType>(dst + i*dim*dim, dim, dim) =
+                    p.XToHerm(X.row(i).transpose());
+                }
+              });
+          }
+          return Herms;
+        }, "X"_a, "num_threads"_a = 0,
+        // docstring
+        "XToHermBatch(X, [num_threads=0])"
+        "\n\n"
+        "Calculate the Hermitian matrices corresponding to many X-parameterization vectors at once.  The "
+        "argument `X` is a 2-D `numpy.array` of shape `(N, dim*dim)` with one vector per row.  Returns a 3-D "
+        "`numpy.array` of shape `(N, dim, dim)` whose `i`-th entry is `XToHerm(X[i])`."
+        "\n\n"
+        "The calculation is carried out without holding the Python GIL, split over `num_threads` "
+        "threads (by default, as many as there are CPUs)."
+        "\n\n"
+        ".. versionadded:: 5.5"
+          )
       ;
   }
   logger.debug("densedm.IndepMeasLLH ...");
@@ -180,27 +280,38 @@ void py_tomo_densedm(py::module rootmodule)
       .def(py::init<tpy::DMTypes>(), "dmt"_a)
       .def_readonly("dmt", & Kl::dmt )
       .def_property_readonly("numEffects", & Kl::numEffects )
-      .def("Exn", [](const Kl& l) -> tpy::RealMatrixType { return l.Exn(); })
+      .def("Exn", [](const Kl& l) -> const Kl::VectorParamListType & { return l.Exn(); },
+           py::return_value_policy::reference_internal)
       .def("Exn", [](const Kl& l, int k) -> tpy::RealVectorType { return l.Exn(k); }, "k"_a,
            "Exn([k])"
            "\n\n"
            "If `k` is not specified, then return the matrix of all POVM effects in X-parameterization.  Each "
-           "row of the returned matrix is a POVM effect in X-parameterization. "
+           "row of the returned matrix is a POVM effect in X-parameterization.  The returned matrix is a "
+           "read-only view onto the data stored internally, no copy is made.  It is only valid until "
+           "the measurement data is next modified (with :py:meth:`resetMeas()`, :py:meth:`addMeasEffect()` "
+           "or :py:meth:`setMeas()`); use `numpy.array(llh.Exn())` if you need to keep a copy."
            "\n\n"
            "If `k` is specified, then only the given POVM effect indexed by `k` is returned. It is given "
            "in X parameterization, as a 1-D array."
            "\n\n"
            "In any case, the returned value is a `numpy.array` object."
+           "\n\n"
+           ".. versionchanged:: 5.5 `Exn()` returns a read-only view instead of a copy."
           )
-      .def("Nx", [](const Kl& l) -> tpy::FreqCountIntVectorType { return l.Nx(); })
+      .def("Nx", [](const Kl& l) -> const Kl::FreqListType & { return l.Nx(); },
+           py::return_value_policy::reference_internal)
       .def("Nx", [](const Kl& l, int k) -> tpy::FreqCountIntType { return l.Nx(k); }, "k"_a,
            "Nx([k])"
            "\n\n"
            "If `k` is not specified, then return a list of frequencies associated to each row of "
-           "the matrix returned by :py:meth:`Exn()`.  The return value is a 1-D NumPy array."
+           "the matrix returned by :py:meth:`Exn()`.  The return value is a 1-D NumPy array.  As for "
+           ":py:meth:`Exn()`, it is a read-only view onto the data stored internally, which is only valid "
+           "until the measurement data is next modified."
            "\n\n"
            "If `k` is specified, then return the frequency associated to the POVM effect indexed by `k`. "
            "The returned value is an integer."
+           "\n\n"
+           ".. versionchanged:: 5.5 `Nx()` returns a read-only view instead of a copy."
           )
       .def("resetMeas", & Kl::resetMeas,
            "resetMeas()"
@@ -309,6 +420,66 @@ void py_tomo_densedm(py::module rootmodule)
         "a `NumPy` array.  This overload converts its argument "
         "to X-parameterization and calls :py:meth:`logLikelihoodX()`."
           )
+      .def("logLikelihoodXBatch", [](const Kl& l, const Eigen::Ref<const tpy::internal::RealRowsMatrixType> & X,
+                                     int num_threads) {
+          if (X.cols() != l.dmt.dim2()) {
+            throw tpy::TomographerCxxError(streamstr("Expected X-parameterization vectors of length "
+                                                     <<l.dmt.dim2()<<", got "<<X.cols()));
+          }
+          const Eigen::Index N = X.rows();
+          py::array_t<tpy::RealScalar> values(N);
+          tpy::RealScalar * dst = values.mutable_data();
+          {
+            py::gil_scoped_release gil_release;
+            tpy::internal::parallel_for_chunks(N, num_threads, [&](Eigen::Index begin, Eigen::Index end) {
+                tpy::internal::llh_rows(l, X, dst, begin, end);
+              });
+          }
+          return values;
+        }, "X"_a, "num_threads"_a = 0,
+        "logLikelihoodXBatch(X, [num_threads=0])"
+        "\n\n"
+        "Calculate the log-likelihood function at many points at once.  The argument `X` is a 2-D "
+        "`numpy.array` of shape `(N, dim*dim)`, each row of which is the X parameterization of a state.  "
+        "Returns a 1-D `numpy.array` of length `N` whose `i`-th entry is `logLikelihoodX(X[i])`."
+        "\n\n"
+        "The calculation is carried out without holding the Python GIL, split over `num_threads` "
+        "threads (by default, as many as there are CPUs)."
+        "\n\n"
+        ".. versionadded:: 5.5"
+          )
+      .def("logLikelihoodRhoBatch", [](const Kl& l, tpy::internal::CplxMatrixStackType rhos, int num_threads) {
+          const Eigen::Index dim = l.dmt.dim();
+          const Eigen::Index N = tpy::internal::check_matrix_stack(rhos, dim);
+          py::array_t<tpy::RealScalar> values(N);
+          const tpy::ComplexScalar * src = rhos.data();
+          tpy::RealScalar * dst = values.mutable_data();
+          {
+            py::gil_scoped_release gil_release;
+            tpy::internal::parallel_for_chunks(N, num_threads, [&](Eigen::Index begin, Eigen::Index end) {
+                const tpy::ParamX param(l.dmt);
+                tpy::internal::RealRowsMatrixType X(end-begin, l.dmt.dim2());
+                for (Eigen::Index i = begin; i < end; ++i) {
+                  X.row(i-begin) = param.HermToX(
+                      Eigen::Map<const tpy::internal::CplxRowMajorMatrixType>(src + i*dim*dim, dim, dim)
+                      ).transpose();
+                }
+                tpy::internal::llh_rows(l, X, dst + begin, 0, end-begin);
+              });
+          }
+          return values;
+        }, "rhos"_a, "num_threads"_a = 0,
+        "logLikelihoodRhoBatch(rhos, [num_threads=0])"
+        "\n\n"
+        "Calculate the log-likelihood function at many states at once.  The argument `rhos` is a 3-D "
+        "`numpy.array` of shape `(N, dim, dim)` containing the density matrices.  Returns a 1-D "
+        "`numpy.array` of length `N` whose `i`-th entry is `logLikelihoodRho(rhos[i])`."
+        "\n\n"
+        "The calculation is carried out without holding the Python GIL, split over `num_threads` "
+        "threads (by default, as many as there are CPUs)."
+        "\n\n"
+        ".. versionadded:: 5.5"
+          )
       .def("__repr__", [](const Kl & p) {
           return streamstr("<IndepMeasLLH dim="<<p.dmt.dim()<<" numEffects="<<p.numEffects()
                            <<" Ntot="<<p.Nx().sum()<<">") ;
@@ -28,11 +28,13 @@
 
 #include <ios>
 #include <iomanip>
+#include <mutex>
 
 #include "tomographerpy/common.h"
 #include "tomographerpy/pyhistogram.h"
 
 #include <tomographer/tools/fmt.h>
+#include <tomographer/querrorbars.h>
 
 #include "common_p.h"
 
@@ -57,6 +59,67 @@ static inline std::string fmt_hist_param_float(tpy::RealScalar val)
 }
 
 
+// Bin counts of many values, as would be obtained by calling record() for each value.
+// Doesn't touch any Python object, so it may be called with the GIL released.
+//
+// weights may be NULL, in which case each value has weight one.
+static void histogram_count_many(const tpy::HistogramParams & params, const tpy::RealScalar * values,
+                                 const tpy::RealScalar * weights, Eigen::Index n, int num_threads,
+                                 Eigen::VectorXd & counts, double & off_chart)
+{
+  // work in blocks, so that the bin positions are calculated in one go by Eigen (with
+  // SIMD instructions) but are kept in cache for the counting pass
+  static constexpr Eigen::Index BlockSize = 256;
+
+  // same operations and order as in HistogramParams::binIndexUnsafe()
+  const tpy::RealScalar scale = tpy::RealScalar(params.num_bins);
+  const tpy::RealScalar range = params.max - params.min;
+  const Eigen::Index last_bin = params.num_bins - 1;
+
+  counts = Eigen::VectorXd::Zero(params.num_bins);
+  off_chart = 0;
+  std::mutex merge_mutex;
+
+  tpy::internal::parallel_for_chunks(n, num_threads, [&](Eigen::Index begin, Eigen::Index end) {
+      Eigen::VectorXd my_counts = Eigen::VectorXd::Zero(params.num_bins);
+      double my_off_chart = 0;
+      Eigen::Array<tpy::RealScalar, BlockSize, 1> pos;
+      for (Eigen::Index b = begin; b < end; b += BlockSize) {
+        const Eigen::Index len = std::min(BlockSize, end - b);
+        Eigen::Map<const Eigen::Array<tpy::RealScalar, Eigen::Dynamic, 1> > v(values + b, len);
+        pos.head(len) = (v - params.min) / range * scale;
+        for (Eigen::Index i = 0; i < len; ++i) {
+          const double w = (weights != NULL) ? double(weights[b+i]) : 1.0;
+          if ( ! params.isWithinBounds(v(i)) ) {
+            my_off_chart += w;
+            continue;
+          }
+          // guard against a value just below max rounding up to num_bins
+          my_counts(std::min((Eigen::Index)pos(i), last_bin)) += w;
+        }
+      }
+      std::lock_guard<std::mutex> lock(merge_mutex);
+      counts += my_counts;
+      off_chart += my_off_chart;
+    });
+}
+
+
+
+// the ftox=(h,s) argument of the fit functions, as for querrorbars.HistogramAnalysis
+static Tomographer::FigureOfMeritToX<tpy::RealScalar> ftox_from_tuple(py::tuple ftox)
+{
+  if (py::len(ftox) != 2) {
+    throw py::value_error("Expected tuple (h, s) for argument ftox");
+  }
+  const int s = ftox[1].cast<int>();
+  if (s != 1 && s != -1) {
+    throw py::value_error(streamstr("Invalid value of `s` in `ftox=(h,s)`: s=" << s));
+  }
+  return Tomographer::FigureOfMeritToX<tpy::RealScalar>(ftox[0].cast<tpy::RealScalar>(), s);
+}
+
+
 
 void py_tomo_histogram(py::module rootmodule)
 {
@@ -201,7 +264,9 @@ void py_tomo_histogram(py::module rootmodule)
         "See :py:class:`HistogramParams`.\n\n"
         ".. py:attribute:: bins\n\n"
         "    The histogram bin counts, interfaced as a `NumPy` array object storing integers.  This attribute "
-        "is readable and writable, although you may not change the size or type of the array.\n\n"
+        "is readable and writable, although you may not change the size or type of the array.  Reading "
+        "this attribute does not copy the array: the returned object is the one the histogram itself "
+        "updates, e.g. in :py:meth:`record()` and :py:meth:`record_many()`.\n\n"
         ".. py:attribute:: off_chart\n\n"
         "    The number of recorded data points which were beyond the histogram range `[params.min, params.max[`.\n\n"
         ".. py:attribute:: has_error_bars\n\n"
@@ -272,6 +337,48 @@ void py_tomo_histogram(py::module rootmodule)
         "record(value[, weight=1])\n\n"
         "Record a new data sample. This increases the corresponding bin count by one, or by `weight` if the "
         "latter argument is provided.")
+      .def("record_many", [](Kl & h, py::array_t<tpy::RealScalar, py::array::c_style | py::array::forcecast> values,
+                             py::object weights, int num_threads) {
+          auto np = py::module::import("numpy");
+          const Eigen::Index n = (Eigen::Index)values.size();
+          // keeps the converted weights alive while we use them
+          py::array_t<tpy::RealScalar, py::array::c_style | py::array::forcecast> weights_array;
+          if (!weights.is_none()) {
+            weights_array = np.attr("broadcast_to")(weights, values.attr("shape"));
+          }
+          const tpy::RealScalar * wptr = weights.is_none() ? NULL : weights_array.data();
+
+          Eigen::VectorXd counts;
+          double off_chart = 0;
+          {
+            py::gil_scoped_release gil_release;
+            histogram_count_many(h.params, values.data(), wptr, n, num_threads, counts, off_chart);
+          }
+
+          // add the counts into the existing bins array, in place, keeping its type
+          if (weights.is_none()) {
+            // integer counts, exactly representable in any type the bins may have
+            np.attr("add")(h.bins, py::cast(counts).attr("astype")(h.bins.attr("dtype")), "out"_a=h.bins);
+            h.off_chart = np.attr("add")(h.off_chart, py::cast((Eigen::Index)off_chart));
+          } else {
+            np.attr("add")(h.bins, py::cast(counts), "out"_a=h.bins);
+            h.off_chart = np.attr("add")(h.off_chart, py::cast(off_chart));
+          }
+        },
+        "values"_a, "weights"_a = py::none(), "num_threads"_a = 1,
+        // doc
+        "record_many(values[, weights=None, num_threads=1])\n\n"
+        "Record many data samples at once.  The effect is the same as calling :py:meth:`record()` for "
+        "each item of the `NumPy` array `values`, with the weight given by the corresponding item of "
+        "`weights` (or a weight of one for all values if `weights` is `None`).  `weights` may also be a "
+        "single number, which is then used for all values."
+        "\n\n"
+        "The bin indices are calculated without holding the Python GIL.  If `num_threads` is "
+        "different from one, the values are split over that many threads, each of which counts "
+        "into its own set of bins before they are added together (use `num_threads=0` to use as "
+        "many threads as there are CPUs)."
+        "\n\n"
+        ".. versionadded:: 5.5")
       .def("normalization", [](const Kl & h) {
           return h.normalization();
         },
@@ -410,6 +517,9 @@ void py_tomo_histogram(py::module rootmodule)
       .def("record", [](Kl & , py::args, py::kwargs) {
           throw tpy::TomographerCxxError("May not call record() on HistogramWithErrorBars");
         })
+      .def("record_many", [](Kl & , py::args, py::kwargs) {
+          throw tpy::TomographerCxxError("May not call record_many() on HistogramWithErrorBars");
+        })
       .def("errorBar", [](Kl & h, Eigen::Index i) {
           return h.delta[py::cast(i)];
           },
@@ -487,6 +597,365 @@ void py_tomo_histogram(py::module rootmodule)
   }
 
 
+  logger.debug("Histogram2DParams...");
+
+  // CLASS: Histogram2DParams
+  {
+    typedef tpy::Histogram2DParams Kl;
+    py::class_<tpy::Histogram2DParams>(
+        rootmodule,
+        "Histogram2DParams",
+        "Specify the bins of a two-dimensional histogram, given by a :py:class:`HistogramParams` for each "
+        "of the two axes."
+        "\n\n"
+        "|picklable|"
+        "\n\n"
+        ".. versionadded:: 5.5"
+        "\n\n"
+        ".. py:function:: Histogram2DParams(x=HistogramParams(), y=HistogramParams())"
+        "\n\n"
+        "    Construct the parameters of a two-dimensional histogram."
+        "\n\n"
+        ".. py:attribute:: x"
+        "\n\n"
+        "    The :py:class:`HistogramParams` of the first axis. (Read-write attribute)"
+        "\n\n"
+        ".. py:attribute:: y"
+        "\n\n"
+        "    The :py:class:`HistogramParams` of the second axis. (Read-write attribute)"
+        "\n\n")
+      .def(py::init<tpy::HistogramParams,tpy::HistogramParams>(),
+           "x"_a=tpy::HistogramParams(), "y"_a=tpy::HistogramParams())
+      .def_readwrite("x", & Kl::x)
+      .def_readwrite("y", & Kl::y)
+      .def("isWithinBounds", & Kl::isWithinBounds, "x"_a, "y"_a,
+           "isWithinBounds(x, y)"
+           "\n\n"
+           "Check whether the point `(x, y)` lies within the bounds of the histogram along both axes.")
+      .def("binIndex", [](const Kl & p, tpy::RealScalar x, tpy::RealScalar y) {
+          return py::make_tuple(p.x.binIndex(x), p.y.binIndex(y));
+        }, "x"_a, "y"_a,
+        "binIndex(x, y)"
+        "\n\n"
+        "Get the pair of indices `(i, j)` of the bin in which the point `(x, y)` would be saved.")
+      .def("binArea", & Kl::binArea,
+           "binArea()\n\n"
+           "Returns the area of a single bin, i.e., the product of the bin widths along each axis.")
+      .def("__repr__", [](const Kl& p) {
+          return streamstr("Histogram2DParams(x=HistogramParams(min="
+                           << fmt_hist_param_float(p.x.min) << ",max="
+                           << fmt_hist_param_float(p.x.max) << ",num_bins=" << p.x.num_bins
+                           << "),y=HistogramParams(min="
+                           << fmt_hist_param_float(p.y.min) << ",max="
+                           << fmt_hist_param_float(p.y.max) << ",num_bins=" << p.y.num_bins << "))");
+        })
+      .def(py::pickle(
+               [](const Kl& p) {
+                 return py::make_tuple(p.x, p.y) ;
+               },
+               [](py::tuple t) {
+                 return tpy::internal::unpack_tuple_and_construct<Kl, tpy::HistogramParams, tpy::HistogramParams>(t);
+               }))
+      ;
+  }
+
+  logger.debug("Histogram2D...");
+
+  // CLASS: Histogram2D
+  {
+    typedef tpy::Histogram2D Kl;
+    py::class_<tpy::Histogram2D>(
+        rootmodule,
+        "Histogram2D",
+        "A two-dimensional histogram object, recording pairs of values `(x, y)`.  The bins are "
+        "specified by a :py:class:`Histogram2DParams` object."
+        "\n\n"
+        "|picklable|"
+        "\n\n"
+        ".. seealso:: This python class mirrors the C++ class :tomocxx:`Tomographer::Histogram2D "
+        "<class_tomographer_1_1_histogram2_d.html>`."
+        "\n\n"
+        ".. versionadded:: 5.5"
+        "\n\n"
+        ".. py:function:: Histogram2D([params=Histogram2DParams()])\n\n"
+        "    Construct a new, empty two-dimensional histogram object with the given parameters.\n\n"
+        ".. py:attribute:: params\n\n"
+        "    The :py:class:`Histogram2DParams` object which stores the histogram parameters (read-only).\n\n"
+        ".. py:attribute:: bins\n\n"
+        "    The histogram bin counts, as a two-dimensional `NumPy` array of shape "
+        "`(params.x.num_bins, params.y.num_bins)`, such that `bins[i,j]` is the count in the bin with "
+        "index `i` along the first axis and index `j` along the second axis.\n\n"
+        ".. py:attribute:: off_chart\n\n"
+        "    The number of recorded data points which were beyond the histogram range.\n\n"
+        ".. py:attribute:: has_error_bars\n\n"
+        "    The constant `False`.\n\n"
+        )
+      .def(py::init<tpy::Histogram2DParams>(), "params"_a = tpy::Histogram2DParams())
+      .def_property_readonly("params", [](const Kl & h) -> tpy::Histogram2DParams { return h.params; })
+      .def_property("bins", [](const Kl & h) { return h.bins; }, & Kl::set_bins )
+      .def_property("off_chart", [](const Kl& h) { return h.off_chart; }, & Kl::set_off_chart )
+      .def_property_readonly("has_error_bars", [](py::object) { return false; })
+      .def("reset", [](Kl & h) {
+          h.bins.attr("fill")(0);
+          h.off_chart = py::cast(0);
+        },
+        "reset()\n\n"
+        "Clears the current histogram counts (including `off_chart` counts) to zero.")
+      .def("load", & Kl::load,
+           "bins"_a, "off_chart"_a = tpy::HistCountIntType(0),
+           "load(bins[, off_chart=0])\n\n"
+           "Load bin values from the two-dimensional `NumPy` array `bins`, and set the `off_chart` counts.")
+      .def("count", [](Kl & h, Eigen::Index i, Eigen::Index j) {
+          return h.bins[py::make_tuple(i, j)];
+        },
+        "i"_a, "j"_a,
+        "count(i, j)\n\n"
+        "Returns the number of counts in the bin with indices `(i, j)`.")
+      .def("record", [](Kl & h, tpy::RealScalar x, tpy::RealScalar y, py::object w) {
+          auto np = py::module::import("numpy");
+          if ( ! h.params.isWithinBounds(x, y) ) {
+            h.off_chart = np.attr("add")(h.off_chart, w);
+            return py::object(py::none());
+          }
+          py::tuple index = py::make_tuple(h.params.x.binIndexUnsafe(x), h.params.y.binIndexUnsafe(y));
+          np.attr("add").attr("at")(h.bins, index, w);
+          return py::object(index);
+        },
+        "x"_a, "y"_a, "weight"_a = py::cast(1),
+        "record(x, y[, weight=1])\n\n"
+        "Record a new data point `(x, y)`.  This increases the corresponding bin count by one, or by "
+        "`weight` if the latter argument is provided.  Returns the bin indices `(i, j)`, or `None` if the "
+        "point was off chart.")
+      .def("normalization", [](const Kl & h) { return h.normalization(); },
+           "normalization()\n\n"
+           "Calculate the normalization factor for the histogram, such that the bin counts divided by "
+           "this factor form a probability density on the plane.")
+      .def("totalCounts", & Kl::totalCounts,
+           "totalCounts()\n\n"
+           "Return the sum of all `bins` contents, plus the `off_chart` counts.")
+      .def("__repr__", [](const Kl& p) {
+          return streamstr("Histogram2D(x_num_bins=" << p.params.x.num_bins
+                           << ",y_num_bins=" << p.params.y.num_bins
+                           << ",off_chart=" << py::repr(p.off_chart).cast<std::string>() << ")");
+        })
+      .def(py::pickle(
+               [](py::object self) {
+                 return py::make_tuple(self.attr("params"), self.attr("bins"), self.attr("off_chart")) ;
+               },
+               [](py::tuple t) {
+                 check_pickle_tuple_size(py::len(t), 3);
+                 tpy::Histogram2D * histogram = new tpy::Histogram2D(t[0].cast<tpy::Histogram2DParams>()) ;
+                 histogram->bins = t[1];
+                 histogram->off_chart = t[2];
+                 return histogram;
+               }))
+      ;
+  }
+
+  logger.debug("Histogram2DWithErrorBars...");
+
+  // CLASS: Histogram2DWithErrorBars
+  {
+    typedef tpy::Histogram2DWithErrorBars Kl;
+    py::class_<tpy::Histogram2DWithErrorBars,tpy::Histogram2D>(
+        rootmodule,
+        "Histogram2DWithErrorBars",
+        "A two-dimensional histogram with error bars associated to each bin.  This class inherits "
+        ":py:class:`Histogram2D`, except for `record()`."
+        "\n\n"
+        "|picklable|"
+        "\n\n"
+        ".. versionadded:: 5.5"
+        "\n\n"
+        ".. py:attribute:: delta\n\n"
+        "    The error bars on each of the histogram bin counts, as a `NumPy` array with the same shape "
+        "as `bins`.\n\n"
+        ".. py:attribute:: has_error_bars\n\n"
+        "    The constant `True`.\n\n"
+        )
+      .def(py::init<tpy::Histogram2DParams>(), "params"_a = tpy::Histogram2DParams())
+      .def_property("delta", [](const Kl & h) { return h.delta; }, & Kl::set_delta )
+      .def_property_readonly("has_error_bars", [](py::object) { return true; })
+      .def("reset", [](Kl & h) {
+          h.bins.attr("fill")(0);
+          h.delta.attr("fill")(0);
+          h.off_chart = py::cast(0);
+        },
+        "reset()\n\n"
+        "Clears the current histogram counts, error bars and `off_chart` counts to zero.")
+      .def("load", & Kl::load,
+           "y"_a, "yerr"_a, "off_chart"_a = tpy::HistogramParams::Scalar(0),
+           "load(y, yerr[, off_chart=0])"
+           "\n\n"
+           "Load data into the histogram. The arrays `y` and `yerr` specify the bin counts and their "
+           "error bars.  The off-chart counter is set to `off_chart`.")
+      .def("record", [](Kl & , py::args, py::kwargs) {
+          throw tpy::TomographerCxxError("May not call record() on Histogram2DWithErrorBars");
+        })
+      .def("errorBar", [](Kl & h, Eigen::Index i, Eigen::Index j) {
+          return h.delta[py::make_tuple(i, j)];
+        },
+        "i"_a, "j"_a,
+        "errorBar(i, j)\n\n"
+        "Get the error bar associated to the bin with indices `(i, j)`.")
+      .def("__repr__", [](const Kl& p) {
+          return streamstr("Histogram2DWithErrorBars(x_num_bins=" << p.params.x.num_bins
+                           << ",y_num_bins=" << p.params.y.num_bins
+                           << ",off_chart=" << py::repr(p.off_chart).cast<std::string>() << ")");
+        })
+      .def(py::pickle(
+               [](py::object self) {
+                 return py::make_tuple(self.attr("params"), self.attr("bins"), self.attr("delta"),
+                                       self.attr("off_chart")) ;
+               },
+               [](py::tuple t) {
+                 check_pickle_tuple_size(py::len(t), 4);
+                 auto histogram = new tpy::Histogram2DWithErrorBars(t[0].cast<tpy::Histogram2DParams>()) ;
+                 histogram->bins = t[1];
+                 histogram->delta = t[2];
+                 histogram->off_chart = t[3];
+                 return histogram;
+               }))
+      ;
+  }
+
+
+  // fits of the histogram of a figure of merit, see tomographer/querrorbars.h
+  logger.debug("HistogramFitA2Result ...");
+  {
+    typedef Tomographer::HistogramFitA2Result<tpy::RealScalar> Kl;
+    py::class_<Kl>(
+        rootmodule,
+        "HistogramFitA2Result",
+        Tomographer::Tools::fmts(
+            // doc
+            "The result of :py:func:`fitHistogramA2()`.  The parameters `(a2, a1, m, c)` are those of "
+            "the fit model :py:func:`tomographer.querrorbars.fit_fn_a2()`.  See also the "
+            ":tomocxx:`C++ class documentation <struct_tomographer_1_1_histogram_fit_a2_result.html>`."
+            "\n\n"
+            "The following members are available as read-only properties:\n\n"
+            "  - `params`: a `NumPy` array with the fit parameters `[a2, a1, m, c]`\n\n"
+            "  - `cov`: the 4x4 covariance matrix of the fit parameters, as returned by "
+            "`scipy.optimize.curve_fit(..., absolute_sigma=True)`\n\n"
+            "  - `chi2`, `redchi2`: the chi-squared and reduced chi-squared statistics of the fit\n\n"
+            "  - `num_points`: the number of histogram bins which were used for the fit\n\n"
+            "  - `a2`, `a1`, `m`, `c`: the individual fit parameters\n\n"
+            ".. versionadded:: 5.5"
+            ).c_str()
+        )
+      .def_property_readonly("params", [](const Kl & r) { return Eigen::VectorXd(r.params); })
+      .def_property_readonly("cov", [](const Kl & r) { return Eigen::MatrixXd(r.cov); })
+      .def_readonly("chi2", & Kl::chi2)
+      .def_readonly("redchi2", & Kl::redchi2)
+      .def_readonly("num_points", & Kl::num_points)
+      .def_property_readonly("a2", & Kl::a2)
+      .def_property_readonly("a1", & Kl::a1)
+      .def_property_readonly("m", & Kl::m)
+      .def_property_readonly("c", & Kl::c)
+      .def("quantumErrorBars", [](const Kl & r, py::tuple ftox) {
+          auto q = Tomographer::quantumErrorBarsFromFitA2(r, ftox_from_tuple(ftox));
+          return py::make_tuple(q.f0, q.Delta, q.gamma, q.y0);
+        },
+        "ftox"_a = py::make_tuple(0, 1),
+        // doc
+        "quantumErrorBars([ftox=(0,1)])\n\n"
+        "Calculate the quantum error bars from the fit parameters, and return them as a tuple "
+        "`(f0, Delta, gamma, y0)`.  The argument `ftox` must be the same as the one given to "
+        ":py:func:`fitHistogramA2()`.  Raises :py:exc:`HistogramFitError` if `a2 < 0`.")
+      .def("__repr__", [](const Kl & r) {
+          return streamstr("HistogramFitA2Result(a2=" << r.a2() << ", a1=" << r.a1() << ", m=" << r.m()
+                           << ", c=" << r.c() << ", redchi2=" << r.redchi2 << ")");
+        })
+      ;
+  }
+
+  logger.debug("fitHistogramA2 ...");
+
+  rootmodule.def(
+      "fitHistogramA2",
+      [](const tpy::HistogramWithErrorBars & h, py::tuple ftox, tpy::RealScalar threshold_fraction) {
+        const auto cxxh = h.toCxxHistogram<tpy::RealScalar,tpy::CountRealType>();
+        const auto cxxftox = ftox_from_tuple(ftox);
+        py::gil_scoped_release gil_release;
+        return Tomographer::fitHistogramA2(cxxh, cxxftox, threshold_fraction);
+      },
+      "histogram"_a, "ftox"_a = py::make_tuple(0, 1), "threshold_fraction"_a = 0,
+      // doc
+      "fitHistogramA2(histogram[, ftox=(0,1), threshold_fraction=0])\n\n"
+      "Fit the logarithm of the normalized `histogram` (a :py:class:`HistogramWithErrorBars`) to the "
+      "default fit model :py:func:`tomographer.querrorbars.fit_fn_a2()`, with the constraints `a2 >= 0` "
+      "and `m >= 0`.  The figure of merit `f` is mapped to the fit variable `x = s*(f-h)` with "
+      "`ftox=(h,s)`, as for :py:class:`tomographer.querrorbars.HistogramAnalysis`.  Bins below "
+      "`threshold_fraction` times the maximal bin value, and bins where `x <= 0`, are ignored.  "
+      "Returns a :py:class:`HistogramFitA2Result`."
+      "\n\n"
+      "Since the fit model is linear in its parameters, the weighted least-squares problem is "
+      "solved exactly in C++, without an iterative optimizer and without holding the Python GIL.  "
+      "Raises :py:exc:`HistogramFitError` if there are not enough points for the fit."
+      "\n\n"
+      ".. versionadded:: 5.5");
+
+  rootmodule.def(
+      "fitHistogramsA2",
+      [](py::iterable histograms, py::tuple ftox, tpy::RealScalar threshold_fraction, int num_threads) {
+        typedef Tomographer::HistogramWithErrorBars<tpy::RealScalar,tpy::CountRealType> CxxHistogramType;
+        typedef Tomographer::HistogramFitA2Result<tpy::RealScalar> ResultType;
+
+        std::vector<CxxHistogramType> cxxhistograms;
+        for (auto h : histograms) {
+          cxxhistograms.push_back(h.cast<const tpy::HistogramWithErrorBars &>()
+                                  .toCxxHistogram<tpy::RealScalar,tpy::CountRealType>());
+        }
+        const auto cxxftox = ftox_from_tuple(ftox);
+
+        const Eigen::Index n = (Eigen::Index)cxxhistograms.size();
+        std::vector<ResultType, Eigen::aligned_allocator<ResultType> > results((std::size_t)n);
+        std::vector<char> ok((std::size_t)n, 0);
+        {
+          py::gil_scoped_release gil_release;
+          tpy::internal::parallel_for_chunks(n, num_threads, [&](Eigen::Index begin, Eigen::Index end) {
+              for (Eigen::Index k = begin; k < end; ++k) {
+                try {
+                  results[k] = Tomographer::fitHistogramA2(cxxhistograms[k], cxxftox, threshold_fraction);
+                  ok[k] = 1;
+                } catch (const Tomographer::HistogramFitError & ) {
+                  // reported as None
+                }
+              }
+            });
+        }
+
+        py::list pyresults;
+        for (Eigen::Index k = 0; k < n; ++k) {
+          if (ok[k]) {
+            pyresults.append(py::cast(results[k]));
+          } else {
+            pyresults.append(py::none());
+          }
+        }
+        return pyresults;
+      },
+      "histograms"_a, "ftox"_a = py::make_tuple(0, 1), "threshold_fraction"_a = 0, "num_threads"_a = 0,
+      // doc
+      "fitHistogramsA2(histograms[, ftox=(0,1), threshold_fraction=0, num_threads=0])\n\n"
+      "Fit many histograms at once, as :py:func:`fitHistogramA2()` does for a single histogram.  "
+      "Returns a list with a :py:class:`HistogramFitA2Result` for each of the given `histograms`, or "
+      "`None` for those histograms which could not be fitted."
+      "\n\n"
+      "The fits are split over `num_threads` threads, which run without holding the Python GIL (use "
+      "`num_threads=0`, the default, to use as many threads as there are CPUs)."
+      "\n\n"
+      ".. versionadded:: 5.5");
+
+  tpy::registerExceptionWithDocstring<Tomographer::HistogramFitError>(
+      rootmodule,
+      "HistogramFitError",
+      tpy::TomographerCxxErrorObj.ptr(),
+      // doc
+      "Exception raised by :py:func:`fitHistogramA2()` when a histogram cannot be fitted.\n\n"
+      ".. versionadded:: 5.5");
+
+
   // deprecated aliases
   auto & m = rootmodule;
   m.attr("AveragedSimpleHistogram") = m.attr("HistogramWithErrorBars");
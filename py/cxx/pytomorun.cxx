@@ -31,6 +31,7 @@
 #include "py_operators_p.h"
 
 #include <limits.h> // CHAR_BIT
+#include <cstdint> // std::uintptr_t
 #include <exception>
 #include <stdexcept>
 #include <limits>
@@ -46,6 +47,7 @@
 #include <tomographer/mhrwtasks.h>
 #include <tomographer/mhrw_valuehist_tools.h>
 #include <tomographer/multiprocthreads.h>
+#include <tomographer/tools/cputopology.h>
 #include <tomographer/valuecalculator.h>
 //#include <tomographer/tools/signal_status_report.h>
 #include <tomographer/mathtools/pos_semidef_util.h>
@@ -107,6 +109,158 @@ typedef Tomographer::MHRWParams<Tomographer::MHWalkerParamsStepSize<tpy::RealSca
 
 
 
+//
+// Address of a compiled function along with its user data pointer.  This is what gets
+// copied around to the tasks; it can be called from any thread without holding the GIL.
+// See the docstring of tomographer.tomorun.NativeFunction for the ABI.
+//
+struct NativeFunctionPtr
+{
+  typedef tpy::RealScalar (*FnPtrType)(const tpy::RealScalar * M, int dim, void * user_data);
+
+  FnPtrType fnptr;
+  void * user_data;
+
+  // Call the function for the dim x dim complex matrix M.  The function expects the
+  // entries of M in column-major order, with real and imaginary parts interleaved.
+  inline tpy::RealScalar call(const Eigen::Ref<const tpy::CplxMatrixType> & M) const
+  {
+    if (M.outerStride() != M.rows()) {
+      // not stored contiguously
+      const tpy::CplxMatrixType Mcopy(M);
+      return call(Mcopy);
+    }
+    return fnptr(reinterpret_cast<const tpy::RealScalar *>(M.data()), (int)M.rows(), user_data);
+  }
+};
+
+//
+// The Python-side object, which keeps the function's library and the user data alive
+//
+class NativeFunction
+{
+public:
+  NativeFunction(py::object fn_, py::object user_data_)
+    : fn(fn_),
+      lib(py::none()),
+      user_data(user_data_),
+      ptr{NULL, NULL}
+  {
+    py::module ctypes = py::module::import("ctypes");
+
+    py::object f = fn;
+    if (py::isinstance<py::tuple>(f)) {
+      // (library, symbol)
+      py::tuple libsym = f.cast<py::tuple>();
+      if (libsym.size() != 2) {
+        throw TomorunInvalidInputError("Expected (library, symbol_name) tuple for NativeFunction");
+      }
+      lib = ctypes.attr("CDLL")(libsym[0]);
+      f = lib.attr("__getitem__")(libsym[1]);
+    }
+
+    std::uintptr_t address = 0;
+    if (py::isinstance<py::int_>(f)) {
+      // raw address
+      address = f.cast<std::uintptr_t>();
+    } else if (py::hasattr(f, "address")) {
+      // e.g. Numba @cfunc
+      address = f.attr("address").cast<std::uintptr_t>();
+    } else if (PyObject_IsInstance(f.ptr(), ctypes.attr("_CFuncPtr").ptr()) == 1) {
+      // ctypes function pointer
+      address = ctypes.attr("cast")(f, ctypes.attr("c_void_p")).attr("value").cast<std::uintptr_t>();
+    } else if (f.attr("__class__").attr("__module__").cast<std::string>() == "_cffi_backend") {
+      // cffi function pointer (cdata object)
+      py::object ffi = py::module::import("cffi").attr("FFI")();
+      address = py::int_(ffi.attr("cast")("uintptr_t", f)).cast<std::uintptr_t>();
+    } else {
+      throw TomorunInvalidInputError("Can't get a function address from " + py::repr(fn).cast<std::string>()
+                                     + " (expected a ctypes or cffi function pointer, an object with an "
+                                     "`address' attribute such as a Numba cfunc, an integer address, or "
+                                     "a (library, symbol_name) tuple)");
+    }
+    if (address == 0) {
+      throw TomorunInvalidInputError("NULL function pointer given as NativeFunction");
+    }
+    ptr.fnptr = reinterpret_cast<NativeFunctionPtr::FnPtrType>(address);
+
+    if (user_data.is_none()) {
+      ptr.user_data = NULL;
+    } else if (py::isinstance<py::int_>(user_data)) {
+      ptr.user_data = reinterpret_cast<void*>(user_data.cast<std::uintptr_t>());
+    } else if (py::hasattr(user_data, "ctypes") && py::hasattr(user_data, "__array_interface__")) {
+      // NumPy array: pass pointer to its data
+      ptr.user_data = reinterpret_cast<void*>(user_data.attr("ctypes").attr("data").cast<std::uintptr_t>());
+    } else {
+      // ctypes object: pass its address
+      ptr.user_data = reinterpret_cast<void*>(ctypes.attr("addressof")(user_data).cast<std::uintptr_t>());
+    }
+  }
+
+  inline const NativeFunctionPtr & nativePtr() const { return ptr; }
+
+  const py::object fn;
+  py::object lib;
+  const py::object user_data;
+
+private:
+  NativeFunctionPtr ptr;
+};
+
+
+//
+// A figure of merit calculated by a compiled function
+//
+class NativeValueCalculator
+{
+public:
+  typedef tpy::RealScalar ValueType;
+
+  NativeValueCalculator(NativeFunctionPtr fn_)
+    : fn(fn_)
+  {
+  }
+
+  inline tpy::RealScalar getValue(const Eigen::Ref<const tpy::CplxMatrixType> & T) const
+  {
+    return fn.call(T);
+  }
+
+private:
+  const NativeFunctionPtr fn;
+};
+
+
+//
+// A DenseLLH-compatible type (see the pageInterfaceDenseLLH C++ doc) whose log-likelihood
+// is calculated from rho by a compiled function
+//
+class NativeDenseLLH
+{
+public:
+  typedef tpy::DMTypes DMTypes;
+  typedef tpy::RealScalar LLHValueType;
+
+  enum { LLHCalcType = Tomographer::DenseDM::LLHCalcTypeRho };
+
+  const DMTypes dmt;
+
+  NativeDenseLLH(DMTypes dmt_, NativeFunctionPtr fn_)
+    : dmt(dmt_), fn(fn_)
+  {
+  }
+
+  inline LLHValueType logLikelihoodRho(const DMTypes::MatrixType & rho) const
+  {
+    return fn.call(rho);
+  }
+
+private:
+  const NativeFunctionPtr fn;
+};
+
+
+
 #define SWITCH_WHICH_LLHWALKER( Code )                                  \
   switch (which) {                                                      \
   case Full:                                                            \
@@ -237,9 +391,14 @@ typedef Tomographer::MultiplexorValueCalculator<
   Tomographer::DenseDM::TSpace::PurifDistToRefCalculator<tpy::DMTypes, tpy::RealScalar>,
   Tomographer::DenseDM::TSpace::TrDistToRefCalculator<tpy::DMTypes, tpy::RealScalar>,
   Tomographer::DenseDM::TSpace::ObservableValueCalculator<tpy::DMTypes>,
-  tpy::CallableValueCalculator
+  tpy::CallableValueCalculator,
+  tpy::NativeValueCalculator
   > ValueCalculator;
 
+// the extra figures of merit (`extra_fig_of_merit=') are all calculated together
+typedef Tomographer::DenseDM::TSpace::MultipleFiguresOfMeritCalculator<tpy::DMTypes, tpy::RealScalar>
+  ExtraValueCalculator;
+
 
 typedef Tomographer::MHRWTasks::ValueHistogramTools::CDataBase<
   ValueCalculator, // our value calculator
@@ -258,12 +417,14 @@ typedef Tomographer::MHRWTasks::ValueHistogramTools::CDataBase<
 // object to the engine in Tomographer::MHRWTasks::ValueHistogramTools, which take care of
 // running the random walks etc. as needed.
 //
+template<typename DenseLLHType>
 struct OurCData : public CDataBaseType
 {
 public:
 
-  OurCData(const DenseLLH & llh_, // data from the the tomography experiment
+  OurCData(const DenseLLHType & llh_, // data from the the tomography experiment (or custom llh)
 	   ValueCalculator valcalc, // the figure-of-merit calculator
+	   ExtraValueCalculator extra_valcalc_, // the extra figures of merit, if any
 	   HistogramParams hist_params, // histogram parameters
 	   int binning_num_levels, // number of binning levels in the binning analysis
 	   tpy::MHRWParams mhrw_params, // parameters of the random walk
@@ -281,29 +442,87 @@ public:
             mhrw_params.n_sweep, mhrw_params.n_therm, mhrw_params.n_run),
         task_seeds),
       llh(llh_),
+      extra_valcalc(std::move(extra_valcalc_)),
+      extra_binning_num_levels(binning_num_levels),
       jumps_method_which(jumps_method_which_),
       ctrl_step_size_params(ctrl_step_size_params_),
       ctrl_converged_params(ctrl_converged_params_)
   {
   }
 
-  const DenseLLH llh;
+  const DenseLLHType llh;
+
+  const ExtraValueCalculator extra_valcalc;
+  const int extra_binning_num_levels;
 
   const tpy::LLH_MHWalker_Which jumps_method_which;
   const py::dict ctrl_step_size_params;
   const py::dict ctrl_converged_params;
 
 
-  // the value result is always the first of a tuple
+  typedef Tomographer::ValueHistogramWithBinningMHRWStatsCollectorParams<
+    Tomographer::MultiValueComponentCalculator<ExtraValueCalculator>,
+    tpy::HistCountIntType,
+    tpy::CountRealType
+    > ExtraValueStatsCollectorParams;
+  typedef std::vector<typename ExtraValueStatsCollectorParams::Result> ExtraValueResultsType;
+  typedef Tomographer::AggregatedHistogramWithErrorBars<
+    typename ExtraValueStatsCollectorParams::HistogramType,
+    tpy::CountRealType
+    > ExtraValueAggregatedHistogramType;
+
+  // the value result is always the first of a tuple, the extra values result is the last
   struct MHRWStatsResultsType : public MHRWStatsResultsBaseType
   {
     template<typename... Types>
     MHRWStatsResultsType(std::tuple<ValueStatsCollectorResultType, Types...> && r)
-      : MHRWStatsResultsBaseType(std::move(std::get<0>(r)))
+      : MHRWStatsResultsBaseType(std::move(std::get<0>(r))),
+        extra_values_results(std::move(std::get<sizeof...(Types)>(r)))
     { }
+
+    ExtraValueResultsType extra_values_results;
   };
 
 
+  //
+  // The histograms of the extra figures of merit always have an automatically chosen
+  // range (with the number of bins of `hist_params'), like tomorun's --extra-value-type.
+  // Without any extra figures of merit, this is an empty stats collector which does
+  // nothing.
+  //
+  template<typename LoggerType>
+  inline Tomographer::MultipleValueHistogramsWithBinningMHRWStatsCollector<
+    ExtraValueCalculator, tpy::HistCountIntType, tpy::CountRealType, LoggerType>
+  createExtraValueStatsCollector(LoggerType & logger) const
+  {
+    const std::size_t num_values = (std::size_t)extra_valcalc.numValues();
+    return Tomographer::mkMultipleValueHistogramsWithBinningMHRWStatsCollector<tpy::HistCountIntType,
+                                                                               tpy::CountRealType>(
+        std::vector<HistogramParams>(num_values, histogram_params),
+        num_values ? extra_valcalc : ExtraValueCalculator(),
+        extra_binning_num_levels,
+        logger,
+        std::vector<Tomographer::HistogramAdaptiveRange<tpy::RealScalar> >(
+            num_values,
+            Tomographer::HistogramAdaptiveRange<tpy::RealScalar>(256, 4096)
+            )
+        );
+  }
+
+  template<typename TaskResultType>
+  inline ExtraValueAggregatedHistogramType
+  aggregateExtraValueHistograms(std::size_t i, const std::vector<TaskResultType*> & task_result_list) const
+  {
+    return Tomographer::aggregateHistogramsOnCommonGrid<ExtraValueAggregatedHistogramType>(
+        task_result_list,
+        [i](const TaskResultType * task_result)
+        -> const typename ExtraValueAggregatedHistogramType::HistogramType &
+        {
+          return task_result->stats_results.extra_values_results[i].histogram;
+        });
+  }
+
+
   //
   // This function is called automatically by the task manager/dispatcher.  It should
   // return a LLHMHWalker object which controls the random walk.
@@ -330,7 +549,7 @@ public:
     // with that macro.
     //
 
-    tpy::LLH_MHWalker<DenseLLH,Rng,LoggerType> mhwalker(
+    tpy::LLH_MHWalker<DenseLLHType,Rng,LoggerType> mhwalker(
         jumps_method_which,
 	llh,
 	rng,
@@ -441,7 +660,9 @@ public:
     auto ctrl_combined =
       Tomographer::mkMHRWMultipleControllers(ctrl_step, ctrl_convergence);
 
-    auto stats = mkMultipleMHRWStatsCollectors(value_stats, movavg_accept_stats);
+    auto extra_value_stats = createExtraValueStatsCollector(baselogger);
+
+    auto stats = mkMultipleMHRWStatsCollectors(value_stats, movavg_accept_stats, extra_value_stats);
 
     logger.debug("random walk set up, ready to go") ;
 
@@ -500,6 +721,219 @@ std::vector<RngType::result_type> get_random_device_seeds(std::size_t num_seeds,
 }
 
 
+//
+// Run the random walk tasks and collect the results, for the given type of DenseLLH object
+//
+template<typename DenseLLHType>
+py::object run_tomorun_tasks(const DenseLLHType & llh, const ValueCalculator & valcalc,
+                             const ExtraValueCalculator & extra_valcalc,
+                             const tpy::HistogramParams & hist_params, int binning_num_levels,
+                             const tpy::MHRWParams & mhrw_params,
+                             const std::vector<RngType::result_type> & task_seeds,
+                             tpy::LLH_MHWalker_Which jumps_method_which,
+                             py::dict ctrl_step_size_params, py::dict ctrl_converged_params,
+                             tpy::TaskCountIntType num_repeats,
+                             int num_threads, const Tomographer::Tools::ThreadAffinity & thread_affinity,
+                             py::object progress_fn, int progress_interval_ms)
+{
+  Tomographer::Logger::LocalLogger<tpy::PyLogger> logger(TOMO_ORIGIN, *tpy::logger);
+
+  OurCData<DenseLLHType> taskcdat(llh, valcalc, extra_valcalc, hist_params, binning_num_levels, mhrw_params,
+                                  task_seeds, jumps_method_which, ctrl_step_size_params, ctrl_converged_params);
+
+  logger.debug([&](std::ostream & stream) {
+      stream << "about to create the task dispatcher.  this pid = " << getpid() << "; this thread id = "
+             << std::this_thread::get_id();
+    }) ;
+
+  tpy::GilProtectedPyLogger logger_with_gil(logger.parentLogger(), false);
+
+  typedef Tomographer::MHRWTasks::MHRandomWalkTask<OurCData<DenseLLHType>, RngType>  OurMHRandomWalkTask;
+
+  Tomographer::MultiProc::CxxThreads::TaskDispatcher<OurMHRandomWalkTask,OurCData<DenseLLHType>,tpy::GilProtectedPyLogger,
+                                                     tpy::TaskCountIntType>
+    tasks(
+        &taskcdat, // constant data
+        logger_with_gil, // the main logger object -- automatically acquires the GIL for emitting messages
+        num_repeats, // num_runs
+        num_threads
+        );
+
+  if (thread_affinity.policy != Tomographer::Tools::THREAD_AFFINITY_NONE) {
+    const Tomographer::Tools::CpuTopology topology = Tomographer::Tools::CpuTopology::detect();
+    logger.debug([&](std::ostream & stream) {
+        stream << "Detected " << topology.summary() << "\n"
+               << "Placement of " << num_threads << " worker threads (" << thread_affinity.toString() << "): "
+               << Tomographer::Tools::formatThreadCpus(thread_affinity.assignCpus(topology, num_threads));
+      });
+    tasks.setThreadAffinity(thread_affinity);
+  }
+
+  tpy::setTasksStatusReportPyCallback(tasks, progress_fn, progress_interval_ms, true /* GIL */);
+
+  typedef std::chrono::steady_clock StdClockType;
+  StdClockType::time_point time_start;
+
+  {
+    logger_with_gil.requireGilAcquisition(true);
+    py::gil_scoped_release gil_release;
+
+    // and run our tomo process
+
+    time_start = StdClockType::now();
+
+    try {
+      tasks.run();
+    } catch (tpy::PyFetchedException & pyerr) {
+
+      // acquire GIL for PyErr_Restore()
+      py::gil_scoped_acquire gil_acquire;
+
+      pyerr.restorePyException();
+      throw py::error_already_set();
+      
+    } catch (Tomographer::MultiProc::TasksInterruptedException & e) {
+
+      // acquire GIL for PyErr_Occurred()
+      py::gil_scoped_acquire gil_acquire;
+
+      // Tasks interrupted
+      logger.debug("Tasks interrupted."); // needs GIL, which we have acquired
+
+      if (PyErr_Occurred() != NULL) {
+        // tell pybind11 that the exception is already set
+        throw py::error_already_set();
+      }
+      // no Python exception set?? -- set a RuntimeError via pybind11
+      throw;
+
+    } catch (std::exception & e) {
+
+      // acquire GIL for PyErr_Occurred()
+      py::gil_scoped_acquire gil_acquire;
+
+      // another exception
+      logger.debug("Inner exception: %s", e.what()); // needs GIL, which we have acquired
+
+      if (PyErr_Occurred() != NULL) {
+        // an inner py::error_already_set() was caught & rethrown by MultiProc::CxxThreads
+        throw py::error_already_set();
+      }
+      throw; // error via pybind11
+    }
+
+  } // gil released scope
+  logger_with_gil.requireGilAcquisition(false);
+
+  auto time_end = StdClockType::now();
+
+  logger.debug("Random walks done.");
+
+  // delta-time, in seconds and fraction of seconds
+  std::string elapsed_s = Tomographer::Tools::fmtDuration(time_end - time_start);
+
+
+  // individual results from each task
+  const auto & task_results = tasks.collectedTaskResults();
+
+  // ... aggregated into a full averaged histogram
+  auto aggregated_histogram = taskcdat.aggregateResultHistograms(task_results) ;
+
+
+  py::dict res;
+
+  res["final_histogram"] = tpy::HistogramWithErrorBars(aggregated_histogram.final_histogram);
+  res["simple_final_histogram"] = tpy::HistogramWithErrorBars(aggregated_histogram.simple_final_histogram);
+
+  // ... and the histograms of the extra figures of merit, if any
+  py::list extra_final_histograms;
+  for (std::size_t i = 0; i < (std::size_t)extra_valcalc.numValues(); ++i) {
+    extra_final_histograms.append(
+        tpy::HistogramWithErrorBars(taskcdat.aggregateExtraValueHistograms(i, task_results).final_histogram)
+        );
+  }
+  res["extra_final_histograms"] = extra_final_histograms;
+  res["elapsed_seconds"] = 1.0e-6 * std::chrono::duration_cast<std::chrono::microseconds>(
+      time_end - time_start
+      ).count();
+
+  py::list runs_results;
+  for (std::size_t k = 0; k < task_results.size(); ++k) {
+    const auto & run_result = *task_results[k];
+    runs_results.append(
+        tpy::MHRandomWalkTaskResult(
+            py::cast(tpy::ValueHistogramWithBinningMHRWStatsCollectorResult(run_result.stats_results)),
+            tpy::MHRWParams(py::dict("step_size"_a=run_result.mhrw_params.mhwalker_params.step_size),
+                            run_result.mhrw_params.n_sweep,
+                            run_result.mhrw_params.n_therm,
+                            run_result.mhrw_params.n_run),
+            run_result.acceptance_ratio
+            )
+        );
+  }
+  res["runs_results"] = runs_results;
+
+  // full final report
+  std::string final_report;
+  { std::ostringstream ss;
+    Tomographer::MHRWTasks::ValueHistogramTools::printFinalReport(
+        ss, // where to output
+        taskcdat, // the cdata
+        task_results, // the results
+        aggregated_histogram // aggregated
+        );
+    final_report = ss.str();
+    res["final_report"] = final_report;
+  }
+
+  // final report of runs only
+  { std::ostringstream ss;
+    Tomographer::MHRWTasks::ValueHistogramTools::printFinalReport(
+        ss, // where to output
+        taskcdat, // the cdata
+        task_results, // the results
+        aggregated_histogram, // aggregated
+        0, // width -- use default
+        false // don't print the histogram
+        );
+    res["final_report_runs"] = ss.str();
+  }
+
+  logger.debug([&](std::ostream & stream) {
+      stream << final_report << "\n";
+      stream << "Computation time: " <<  elapsed_s << "\n";
+    });
+
+  return res;
+}
+
+
+//
+// Determine the T-parameterization and the density matrix of a reference state given by
+// the user, after making sure it is positive semidefinite
+//
+inline void get_ref_state_T_and_rho(const tpy::DMTypes::MatrixType & ref_state,
+                                    tpy::DMTypes::MatrixType & T_ref, tpy::DMTypes::MatrixType & rho_ref)
+{
+  typedef tpy::DMTypes::MatrixType MatrixType;
+
+  Eigen::SelfAdjointEigenSolver<MatrixType> eig(ref_state);
+
+  typedef typename Eigen::SelfAdjointEigenSolver<MatrixType>::RealVectorType RealVectorType;
+
+  MatrixType U = eig.eigenvectors();
+  RealVectorType d = eig.eigenvalues();
+
+  Tomographer::MathTools::forcePosVecKeepSum<RealVectorType>(
+      d,
+      Eigen::NumTraits<tpy::RealScalar>::dummy_precision()
+      );
+
+  rho_ref = U * d.asDiagonal() * U.adjoint();
+  T_ref = U * d.cwiseSqrt().asDiagonal() * U.adjoint();
+}
+
+
 py::object py_tomorun(
     const int dim,
     py::kwargs kwargs
@@ -523,59 +957,75 @@ py::object py_tomorun(
   // prepare llh object
   DenseLLH llh(dmt);
 
-  if (!kwargs.contains("Emn"_s) && !kwargs.contains("Exn"_s)) {
-    throw TomorunInvalidInputError("No measurements specified. Please specify either the `Emn' "
-                                   "or the `Exn' argument");
-  }
-  if (!kwargs.contains("Nm"_s)) {
-    throw TomorunInvalidInputError("No measurement outcome counts specified. "
-                                   "Please specify the `Nm' argument.");
-  }
-
-  NmType Nm = kwargs.attr("pop")("Nm"_s).cast<NmType>();
-
-  if (kwargs.contains("Exn"_s)) {
-    // use Exn
-    const DynRMatType Exn = kwargs.attr("pop")("Exn"_s).cast<DynRMatType>();
-    if (kwargs.contains("Emn"_s)) { // error: both Exn & Emn specified
-      throw TomorunInvalidInputError("You can't specify both Exn and Emn arguments");
+  // a compiled log-likelihood function may be given instead of the measurement data
+  py::object llh_native = py::none();
+  if (kwargs.contains("llh"_s)) {
+    llh_native = kwargs.attr("pop")("llh"_s);
+    if (!py::isinstance<tpy::NativeFunction>(llh_native)) {
+      throw TomorunInvalidInputError("The `llh=' argument must be a tomographer.tomorun.NativeFunction instance");
     }
-    if (Exn.cols() != dmt.dim2()) {
-      throw TomorunInvalidInputError("Exn argument is expected to have exactly dim^2 = "
-                                     + std::to_string(dmt.dim2()) + " columns");
+    if (kwargs.contains("Emn"_s) || kwargs.contains("Exn"_s) || kwargs.contains("Nm"_s)) {
+      throw TomorunInvalidInputError("You can't specify measurement data (`Emn', `Exn', `Nm') along with "
+                                     "a custom `llh' function");
     }
-    if (Exn.rows() != Nm.rows()) {
-      throw TomorunInvalidInputError("Mismatch in number of measurements: Exn.rows()="
-                                     + std::to_string(Exn.rows()) + " but Nm.rows()="
-                                     + std::to_string(Nm.rows()));
+    logger.debug("Using compiled function for the log-likelihood.");
+  } else {
+
+    if (!kwargs.contains("Emn"_s) && !kwargs.contains("Exn"_s)) {
+      throw TomorunInvalidInputError("No measurements specified. Please specify either the `Emn' "
+                                     "or the `Exn' argument");
     }
-    for (Eigen::Index k = 0; k < Nm.rows(); ++k) {
-      llh.addMeasEffect(Exn.row(k).transpose(), Nm(k), true);
+    if (!kwargs.contains("Nm"_s)) {
+      throw TomorunInvalidInputError("No measurement outcome counts specified. "
+                                     "Please specify the `Nm' argument.");
     }
-  } else {
-    // use Emn
-    tomographer_assert(kwargs.contains("Emn"_s)) ; // we did this check already before
 
-    py::object Emn = kwargs.attr("pop")("Emn"_s);
+    NmType Nm = kwargs.attr("pop")("Nm"_s).cast<NmType>();
+
+    if (kwargs.contains("Exn"_s)) {
+      // use Exn
+      const DynRMatType Exn = kwargs.attr("pop")("Exn"_s).cast<DynRMatType>();
+      if (kwargs.contains("Emn"_s)) { // error: both Exn & Emn specified
+        throw TomorunInvalidInputError("You can't specify both Exn and Emn arguments");
+      }
+      if (Exn.cols() != dmt.dim2()) {
+        throw TomorunInvalidInputError("Exn argument is expected to have exactly dim^2 = "
+                                       + std::to_string(dmt.dim2()) + " columns");
+      }
+      if (Exn.rows() != Nm.rows()) {
+        throw TomorunInvalidInputError("Mismatch in number of measurements: Exn.rows()="
+                                       + std::to_string(Exn.rows()) + " but Nm.rows()="
+                                       + std::to_string(Nm.rows()));
+      }
+      for (Eigen::Index k = 0; k < Nm.rows(); ++k) {
+        llh.addMeasEffect(Exn.row(k).transpose(), Nm(k), true);
+      }
+    } else {
+      // use Emn
+      tomographer_assert(kwargs.contains("Emn"_s)) ; // we did this check already before
+
+      py::object Emn = kwargs.attr("pop")("Emn"_s);
     
-    const std::size_t len_Emn = py::len(Emn);
-    if (len_Emn != (std::size_t)Nm.rows()) {
-      throw TomorunInvalidInputError("Mismatch in number of measurements: len(Emn)="
-                                     + std::to_string(len_Emn) +
-                                     " but Nm.rows()=" + std::to_string(Nm.rows()));
-    }
-    for (Eigen::Index k = 0; k < Nm.rows(); ++k) {
-      MatrixType POVMeffect = Emn[py::cast(k)].cast<MatrixType>();
-      llh.addMeasEffect(POVMeffect, Nm(k), true);
+      const std::size_t len_Emn = py::len(Emn);
+      if (len_Emn != (std::size_t)Nm.rows()) {
+        throw TomorunInvalidInputError("Mismatch in number of measurements: len(Emn)="
+                                       + std::to_string(len_Emn) +
+                                       " but Nm.rows()=" + std::to_string(Nm.rows()));
+      }
+      for (Eigen::Index k = 0; k < Nm.rows(); ++k) {
+        MatrixType POVMeffect = Emn[py::cast(k)].cast<MatrixType>();
+        llh.addMeasEffect(POVMeffect, Nm(k), true);
+      }
     }
-  }
 
-  logger.debug([&](std::ostream & ss) {
-      ss << "\n\nllh.Exn: size="<<llh.Exn().size()<<"\n"
-	 << llh.Exn() << "\n";
-      ss << "\n\nllh.Nx: size="<<llh.Nx().size()<<"\n"
-	 << llh.Nx() << "\n";
-    });
+    logger.debug([&](std::ostream & ss) {
+        ss << "\n\nllh.Exn: size="<<llh.Exn().size()<<"\n"
+           << llh.Exn() << "\n";
+        ss << "\n\nllh.Nx: size="<<llh.Nx().size()<<"\n"
+           << llh.Nx() << "\n";
+      });
+
+  }
 
 
   // prepare figure of merit
@@ -593,9 +1043,12 @@ py::object py_tomorun(
     fig_of_merit = "obs-value"_s;
   }
 
-  bool fig_of_merit_callable = py::hasattr(fig_of_merit, "__call__");
+  bool fig_of_merit_native = py::isinstance<tpy::NativeFunction>(fig_of_merit);
+  bool fig_of_merit_callable = !fig_of_merit_native && py::hasattr(fig_of_merit, "__call__");
   std::string fig_of_merit_s;
-  if (fig_of_merit_callable) {
+  if (fig_of_merit_native) {
+    fig_of_merit_s = "<native>";
+  } else if (fig_of_merit_callable) {
     fig_of_merit_s = "<custom>";
   } else {
     fig_of_merit_s = fig_of_merit.cast<std::string>();
@@ -620,20 +1073,7 @@ py::object py_tomorun(
                                                "`ref_state=' argument for fig_of_merit='"<<fig_of_merit_s<<"'")) ;
     }
 
-    Eigen::SelfAdjointEigenSolver<MatrixType> eig(ref_state);
-
-    typedef typename Eigen::SelfAdjointEigenSolver<MatrixType>::RealVectorType RealVectorType;
-    
-    MatrixType U = eig.eigenvectors();
-    RealVectorType d = eig.eigenvalues();
-  
-    Tomographer::MathTools::forcePosVecKeepSum<RealVectorType>(
-        d,
-        Eigen::NumTraits<tpy::RealScalar>::dummy_precision()
-        );
-
-    rho_ref = U * d.asDiagonal() * U.adjoint();
-    T_ref = U * d.cwiseSqrt().asDiagonal() * U.adjoint();
+    get_ref_state_T_and_rho(ref_state, T_ref, rho_ref);
 
   } else if (fig_of_merit_s == "obs-value") {
 
@@ -656,22 +1096,22 @@ py::object py_tomorun(
 
     A = observable;
     
-  } else if (fig_of_merit_callable) {
+  } else if (fig_of_merit_callable || fig_of_merit_native) {
 
-    // ok, custom callable
-    logger.debug("Using custom callable as figure of merit.");
+    // ok, custom callable or compiled function
+    logger.debug("Using custom callable or compiled function as figure of merit.");
 
     // allow the user to also specify observable= and/or ref_state=, but warn that those
     // arguments will be ignored
     if (kwargs.contains("ref_state"_s)) {
       kwargs.attr("pop")("ref_state"_s);
       logger.warning("Ignoring additional argument `ref_state=' which is not used for "
-                     "a custom callable figure of merit");
+                     "a custom figure of merit");
     }
     if (kwargs.contains("observable"_s)) {
       kwargs.attr("pop")("observable"_s);
       logger.warning("Ignoring additional argument `observable=' which is not used for "
-                     "a custom callable figure of merit");
+                     "a custom figure of merit");
     }
 
   } else {
@@ -686,21 +1126,62 @@ py::object py_tomorun(
         (fig_of_merit_s == "tr-dist" ? 2 :
          (fig_of_merit_s == "obs-value" ? 3 :
           (fig_of_merit_callable ? 4 :
-           throw TomorunInvalidInputError(std::string("Invalid valtype: ")
-                                          + py::repr(fig_of_merit).cast<std::string>())
-              ))))),
+           (fig_of_merit_native ? 5 :
+            throw TomorunInvalidInputError(std::string("Invalid valtype: ")
+                                           + py::repr(fig_of_merit).cast<std::string>())
+               )))))),
         // the valuecalculator instances which are available:
       [&]() { return new Tomographer::DenseDM::TSpace::FidelityToRefCalculator<tpy::DMTypes, tpy::RealScalar>(T_ref); },
       [&]() { return new Tomographer::DenseDM::TSpace::PurifDistToRefCalculator<tpy::DMTypes, tpy::RealScalar>(T_ref); },
       [&]() { return new Tomographer::DenseDM::TSpace::TrDistToRefCalculator<tpy::DMTypes, tpy::RealScalar>(rho_ref); },
       [&]() { return new Tomographer::DenseDM::TSpace::ObservableValueCalculator<tpy::DMTypes>(dmt, A); },
-      [&]() { return new tpy::CallableValueCalculator(fig_of_merit); }
+      [&]() { return new tpy::CallableValueCalculator(fig_of_merit); },
+      [&]() { return new tpy::NativeValueCalculator(fig_of_merit.cast<const tpy::NativeFunction &>().nativePtr()); }
         );
 
   logger.debug([&](std::ostream & stream) {
       stream << "Value calculator set up with fig_of_merit=" << py::repr(fig_of_merit).cast<std::string>();
     });
 
+  //
+  // Extra figures of merit, whose histograms are collected during the same random walks
+  //
+  ExtraValueCalculator extra_valcalc;
+  py::object extra_fig_of_merit = kwargs.attr("pop")("extra_fig_of_merit"_s, py::list());
+  for (py::handle extra : extra_fig_of_merit) {
+    if (!py::isinstance<py::tuple>(extra) || py::len(extra) != 2) {
+      throw TomorunInvalidInputError(std::string("Expected (name, matrix) tuple in `extra_fig_of_merit=', got ")
+                                     + py::repr(extra).cast<std::string>());
+    }
+    const py::tuple extra_t = py::reinterpret_borrow<py::tuple>(extra);
+    const std::string extra_s = extra_t[0].cast<std::string>();
+    const MatrixType M = extra_t[1].cast<MatrixType>();
+    if (M.rows() != dmt.dim() || M.cols() != dmt.dim()) {
+      throw TomorunInvalidInputError(streamstr("Expected " << dmt.dim() << " x " << dmt.dim() << " complex matrix "
+                                               "for extra figure of merit '" << extra_s << "'")) ;
+    }
+    if (extra_s == "fidelity" || extra_s == "tr-dist" || extra_s == "purif-dist") {
+      MatrixType extra_T_ref(dmt.initMatrixType());
+      MatrixType extra_rho_ref(dmt.initMatrixType());
+      get_ref_state_T_and_rho(M, extra_T_ref, extra_rho_ref);
+      if (extra_s == "fidelity") {
+        extra_valcalc.addFidelityToRef(extra_T_ref);
+      } else if (extra_s == "purif-dist") {
+        extra_valcalc.addPurifDistToRef(extra_T_ref);
+      } else {
+        extra_valcalc.addTrDistToRef(extra_rho_ref);
+      }
+    } else if (extra_s == "obs-value") {
+      extra_valcalc.addObservable(M);
+    } else {
+      throw TomorunInvalidInputError("Invalid extra figure of merit: '" + extra_s + "'");
+    }
+  }
+
+  logger.debug([&](std::ostream & stream) {
+      stream << "Extra value calculator set up with " << extra_valcalc.numValues() << " figure(s) of merit";
+    });
+
   //
   // Get the params for the histogram and the mhrw
   //
@@ -739,10 +1220,6 @@ py::object py_tomorun(
     throw TomorunInvalidInputError("num_repeats must be >= 1") ;
   }
 
-  // prepare the random walk tasks
-
-  typedef Tomographer::MHRWTasks::MHRandomWalkTask<OurCData, RngType>  OurMHRandomWalkTask;
-
   // seed for random number generator
   py::object rng_base_seed = py::none();
   if (kwargs.contains("rng_base_seed"_s)) {
@@ -843,6 +1320,34 @@ py::object py_tomorun(
   py::object progress_fn = kwargs.attr("pop")("progress_fn"_s, py::none());
   int progress_interval_ms = kwargs.attr("pop")("progress_interval_ms"_s, 500).cast<int>();
 
+  // placement of the worker threads on the CPUs
+  Tomographer::Tools::ThreadAffinity thread_affinity;
+  py::object thread_affinity_arg = kwargs.attr("pop")("thread_affinity"_s, py::none());
+  try {
+    if (py::isinstance<py::str>(thread_affinity_arg)) {
+      thread_affinity = Tomographer::Tools::ThreadAffinity::fromString(thread_affinity_arg.cast<std::string>());
+    } else if (!thread_affinity_arg.is_none()) {
+      // an explicit list of CPUs
+      std::vector<int> cpus;
+      for (py::handle cpu : thread_affinity_arg) {
+        cpus.push_back(cpu.cast<int>());
+      }
+      thread_affinity = Tomographer::Tools::ThreadAffinity(Tomographer::Tools::THREAD_AFFINITY_EXPLICIT, cpus);
+    }
+  } catch (const Tomographer::Tools::InvalidThreadAffinity & e) {
+    throw TomorunInvalidInputError(e.msg());
+  }
+
+  // number of worker threads -- by default, as suggested by the thread placement policy
+  int num_threads = kwargs.attr("pop")("num_threads"_s, 0).cast<int>();
+  if (num_threads < 0) {
+    throw TomorunInvalidInputError("num_threads must be >= 0") ;
+  }
+  if (num_threads == 0) {
+    num_threads = thread_affinity.defaultNumThreads(Tomographer::Tools::CpuTopology::detect());
+  }
+  num_threads = (int)std::min<tpy::TaskCountIntType>((tpy::TaskCountIntType)num_threads, num_repeats);
+
   //
   // At this point, we should have consumed all our arguments. Anything left in `kwargs'
   // is an error.
@@ -856,151 +1361,15 @@ py::object py_tomorun(
   // Prepare task dispatcher, do some GIL management, and run the tasks.
   //
 
-  OurCData taskcdat(llh, valcalc, hist_params, binning_num_levels, mhrw_params,
-                    task_seeds, jumps_method_which, ctrl_step_size_params, ctrl_converged_params);
-
-  logger.debug([&](std::ostream & stream) {
-      stream << "about to create the task dispatcher.  this pid = " << getpid() << "; this thread id = "
-             << std::this_thread::get_id();
-    }) ;
-
-  tpy::GilProtectedPyLogger logger_with_gil(logger.parentLogger(), false);
-
-  Tomographer::MultiProc::CxxThreads::TaskDispatcher<OurMHRandomWalkTask,OurCData,tpy::GilProtectedPyLogger,
-                                                     tpy::TaskCountIntType>
-    tasks(
-        &taskcdat, // constant data
-        logger_with_gil, // the main logger object -- automatically acquires the GIL for emitting messages
-        num_repeats // num_runs
-        );
-
-  tpy::setTasksStatusReportPyCallback(tasks, progress_fn, progress_interval_ms, true /* GIL */);
-
-  typedef std::chrono::steady_clock StdClockType;
-  StdClockType::time_point time_start;
-
-  {
-    logger_with_gil.requireGilAcquisition(true);
-    py::gil_scoped_release gil_release;
-
-    // and run our tomo process
-
-    time_start = StdClockType::now();
-
-    try {
-      tasks.run();
-    } catch (tpy::PyFetchedException & pyerr) {
-
-      // acquire GIL for PyErr_Restore()
-      py::gil_scoped_acquire gil_acquire;
-
-      pyerr.restorePyException();
-      throw py::error_already_set();
-      
-    } catch (Tomographer::MultiProc::TasksInterruptedException & e) {
-
-      // acquire GIL for PyErr_Occurred()
-      py::gil_scoped_acquire gil_acquire;
-
-      // Tasks interrupted
-      logger.debug("Tasks interrupted."); // needs GIL, which we have acquired
-
-      if (PyErr_Occurred() != NULL) {
-        // tell pybind11 that the exception is already set
-        throw py::error_already_set();
-      }
-      // no Python exception set?? -- set a RuntimeError via pybind11
-      throw;
-
-    } catch (std::exception & e) {
-
-      // acquire GIL for PyErr_Occurred()
-      py::gil_scoped_acquire gil_acquire;
-
-      // another exception
-      logger.debug("Inner exception: %s", e.what()); // needs GIL, which we have acquired
-
-      if (PyErr_Occurred() != NULL) {
-        // an inner py::error_already_set() was caught & rethrown by MultiProc::CxxThreads
-        throw py::error_already_set();
-      }
-      throw; // error via pybind11
-    }
-
-  } // gil released scope
-  logger_with_gil.requireGilAcquisition(false);
-
-  auto time_end = StdClockType::now();
-
-  logger.debug("Random walks done.");
-
-  // delta-time, in seconds and fraction of seconds
-  std::string elapsed_s = Tomographer::Tools::fmtDuration(time_end - time_start);
-
-
-  // individual results from each task
-  const auto & task_results = tasks.collectedTaskResults();
-
-  // ... aggregated into a full averaged histogram
-  auto aggregated_histogram = taskcdat.aggregateResultHistograms(task_results) ;
-
-
-  py::dict res;
-
-  res["final_histogram"] = tpy::HistogramWithErrorBars(aggregated_histogram.final_histogram);
-  res["simple_final_histogram"] = tpy::HistogramWithErrorBars(aggregated_histogram.simple_final_histogram);
-  res["elapsed_seconds"] = 1.0e-6 * std::chrono::duration_cast<std::chrono::microseconds>(
-      time_end - time_start
-      ).count();
-
-  py::list runs_results;
-  for (std::size_t k = 0; k < task_results.size(); ++k) {
-    const auto & run_result = *task_results[k];
-    runs_results.append(
-        tpy::MHRandomWalkTaskResult(
-            py::cast(tpy::ValueHistogramWithBinningMHRWStatsCollectorResult(run_result.stats_results)),
-            tpy::MHRWParams(py::dict("step_size"_a=run_result.mhrw_params.mhwalker_params.step_size),
-                            run_result.mhrw_params.n_sweep,
-                            run_result.mhrw_params.n_therm,
-                            run_result.mhrw_params.n_run),
-            run_result.acceptance_ratio
-            )
-        );
+  if (!llh_native.is_none()) {
+    const tpy::NativeDenseLLH native_llh(dmt, llh_native.cast<const tpy::NativeFunction &>().nativePtr());
+    return run_tomorun_tasks(native_llh, valcalc, extra_valcalc, hist_params, binning_num_levels, mhrw_params, task_seeds,
+                             jumps_method_which, ctrl_step_size_params, ctrl_converged_params,
+                             num_repeats, num_threads, thread_affinity, progress_fn, progress_interval_ms);
   }
-  res["runs_results"] = runs_results;
-
-  // full final report
-  std::string final_report;
-  { std::ostringstream ss;
-    Tomographer::MHRWTasks::ValueHistogramTools::printFinalReport(
-        ss, // where to output
-        taskcdat, // the cdata
-        task_results, // the results
-        aggregated_histogram // aggregated
-        );
-    final_report = ss.str();
-    res["final_report"] = final_report;
-  }
-
-  // final report of runs only
-  { std::ostringstream ss;
-    Tomographer::MHRWTasks::ValueHistogramTools::printFinalReport(
-        ss, // where to output
-        taskcdat, // the cdata
-        task_results, // the results
-        aggregated_histogram, // aggregated
-        0, // width -- use default
-        false // don't print the histogram
-        );
-    res["final_report_runs"] = ss.str();
-  }
-
-  logger.debug([&](std::ostream & stream) {
-      stream << final_report << "\n";
-      stream << "Computation time: " <<  elapsed_s << "\n";
-    });
-
-  return res;
+  return run_tomorun_tasks(llh, valcalc, extra_valcalc, hist_params, binning_num_levels, mhrw_params, task_seeds,
+                           jumps_method_which, ctrl_step_size_params, ctrl_converged_params,
+                           num_repeats, num_threads, thread_affinity, progress_fn, progress_interval_ms);
 }
 
 
@@ -1023,6 +1392,76 @@ void py_tomo_tomorun(py::module rootmodule)
         "figure of merit." )
       ) ;
 
+  logger.debug("tomorun.NativeFunction ...");
+  { typedef tpy::NativeFunction Kl;
+    py::class_<Kl>(
+        tomorunmodule,
+        "NativeFunction",
+        "A compiled function, which :py:func:`tomorun()` can use as a figure of merit (`fig_of_merit=`) or "
+        "as the log-likelihood function (`llh=`).  The function is called directly from the random walk "
+        "threads, without acquiring the Python GIL, and should have the following C signature::"
+        "\n\n"
+        "    double fn(const double * M, int dim, void * user_data);"
+        "\n\n"
+        "The argument `M` points to the entries of a :math:`\\textit{dim}\\times\\textit{dim}` complex "
+        "matrix, given as `2*dim*dim` doubles in column-major (Fortran) order, with the real and imaginary "
+        "parts of each entry interleaved: the entry :math:`M_{ij}` is `M[2*(i+dim*j)] + 1j*M[2*(i+dim*j)+1]`.  "
+        "The `user_data` pointer is passed on as is."
+        "\n\n"
+        "  - As a figure of merit, `M` is the T-parameterization of the density matrix (such that "
+        ":math:`\\rho=TT^\\dagger`), and the function should return the value of the figure of merit."
+        "\n\n"
+        "  - As a log-likelihood function, `M` is the density matrix :math:`\\rho`, and the function should "
+        "return the natural logarithm of the likelihood of :math:`\\rho` (up to an additive constant)."
+        "\n\n"
+        "The function may be called simultaneously from several threads, so it must be thread-safe.  It must "
+        "not call any Python API functions, and it cannot report errors."
+        "\n\n"
+        ".. py:function:: NativeFunction(fn, user_data=None)"
+        "\n\n"
+        "    The function `fn` may be given as a `ctypes` function pointer (e.g., an attribute of a "
+        "`ctypes.CDLL` instance), as a `cffi` function pointer, as an object with an `address` attribute "
+        "such as a Numba `@cfunc`, as an integer address, or as a tuple `(library_path, symbol_name)` "
+        "specifying a symbol in a shared library, which is then loaded with `ctypes`."
+        "\n\n"
+        "    The `user_data` may be `None` (a `NULL` pointer is passed), an integer address, a `NumPy` array "
+        "(a pointer to its data is passed) or a `ctypes` object (a pointer to it is passed).  The "
+        "`NativeFunction` object keeps a reference to `fn` and `user_data`, which must not be modified "
+        "while the random walks are running."
+        "\n\n"
+        "    For example, with Numba::"
+        "\n\n"
+        "        import numba\n"
+        "        from numba import types\n"
+        "        @numba.cfunc(types.double(types.CPointer(types.double), types.intc, types.voidptr))\n"
+        "        def purity(Tptr, dim, user_data):\n"
+        "            T = numba.carray(Tptr, (dim, dim, 2))  # T[j,i,:] is (Re, Im) of T_{ij}\n"
+        "            ...\n"
+        "        r = tomographer.tomorun.tomorun(..., fig_of_merit=tomographer.tomorun.NativeFunction(purity))"
+        "\n\n"
+        ".. py:attribute:: fn\n\n"
+        "    The `fn` object given to the constructor (read-only).\n\n"
+        ".. py:attribute:: user_data\n\n"
+        "    The `user_data` object given to the constructor (read-only).\n\n"
+        ".. py:attribute:: address\n\n"
+        "    The address of the function, as an integer (read-only).\n\n"
+        "\n\n"
+        ".. versionadded:: 5.5"
+        "\n\n"
+        )
+      .def(py::init<py::object, py::object>(), "fn"_a, "user_data"_a = py::none())
+      .def_property_readonly("fn", [](const Kl & f) { return f.fn; })
+      .def_property_readonly("user_data", [](const Kl & f) { return f.user_data; })
+      .def_property_readonly("address", [](const Kl & f) {
+          return reinterpret_cast<std::uintptr_t>(f.nativePtr().fnptr);
+        })
+      .def("__repr__", [](const Kl & f) {
+          return streamstr("NativeFunction(" << py::repr(f.fn).cast<std::string>() << ", user_data="
+                           << py::repr(f.user_data).cast<std::string>() << ")");
+        })
+      ;
+  }
+
   logger.debug("tomorun.tomorun() ...");
 
   // the main run call:
@@ -1049,8 +1488,14 @@ void py_tomo_tomorun(py::module rootmodule)
         ":param Emn: The observed POVM effects, specified as a list of :math:`\\textit{dim}\\times\\textit{dim}`\n"
         "            matrices.\n\n"
         ":param Nm:  the list of observed frequency counts for each POVM effect in `Emn` or `Exn`.\n\n"
-        ":param fig_of_merit:  The choice of the figure of merit to study.  This is either a Python string or a\n"
-        "            Python callable.  If it is a string, it must be one of 'obs-value',\n"
+        ":param llh: A compiled log-likelihood function, given as a :py:class:`NativeFunction` instance, which\n"
+        "            calculates the log-likelihood from the density matrix.  If you specify `llh`, you can't specify\n"
+        "            `Emn`, `Exn` or `Nm`.\n"
+        "            \n"
+        "            .. versionadded:: 5.5\n"
+        "               Added the `llh` argument\n\n"
+        ":param fig_of_merit:  The choice of the figure of merit to study.  This is either a Python string, a\n"
+        "            Python callable or a :py:class:`NativeFunction`.  If it is a string, it must be one of 'obs-value',\n"
         "            'fidelity', 'tr-dist' or 'purif-dist' (see below for more info).  If it is a callable, it\n"
         "            should accept a single argument, the T-parameterization of the density matrix, and should\n"
         "            calculate and return the figure of merit.  The T-parameterization is a matrix :math:`T`\n"
@@ -1059,6 +1504,15 @@ void py_tomo_tomorun(py::module rootmodule)
         "            and 'purif-dist'), this is the reference state to calculate the figure of merit with,\n"
         "            specified as a density matrix.\n\n"
         ":param observable:  For the 'obs-value' figure of merit, specify the observable here as a matrix.\n\n"
+        ":param extra_fig_of_merit:  A list of additional figures of merit whose histograms are collected\n"
+        "            during the same random walks.  Each item is a tuple `(name, matrix)`, where `name` is one\n"
+        "            of 'obs-value', 'fidelity', 'tr-dist' or 'purif-dist' and `matrix` is the corresponding\n"
+        "            observable or reference state.  These histograms have the number of bins given in\n"
+        "            `hist_params`, but their range is chosen automatically during thermalization.  They\n"
+        "            are returned in ``extra_final_histograms`` (see below).\n"
+        "            \n"
+        "            .. versionadded:: 5.5\n"
+        "               Added the `extra_fig_of_merit` argument\n\n"
         ":param hist_params:  The requested range of values to look at when collecting a histogram of the\n"
         "            figure of mert.  This should be a :py:class:`tomographer.HistogramParams`\n"
         "            instance.\n\n"
@@ -1070,6 +1524,23 @@ void py_tomo_tomorun(py::module rootmodule)
         "            deviation. This is done automatically by default (or if you specify the value `-1`),\n"
         "            so in normal circumstances you won't have to change the default value.\n\n"
         ":param num_repeats:  The number of independent random walks to run in parallel.\n\n"
+        ":param num_threads:  The number of worker threads which run the random walks.  By default (or if\n"
+        "            you specify `0`), one thread is used per CPU allowed by `thread_affinity`, and never\n"
+        "            more threads than `num_repeats`.\n"
+        "            \n"
+        "            .. versionadded:: 5.5\n"
+        "               Added the `num_threads` argument\n\n"
+        ":param thread_affinity:  How to pin the worker threads to the CPUs.  This may be `None` (the\n"
+        "            default; threads are not pinned), one of the strings \"compact\" (fill all the\n"
+        "            hardware threads of a core, then of a package, before moving on to the next),\n"
+        "            \"scatter\" (spread the threads over the packages and the physical cores first),\n"
+        "            \"cores\" (one thread per physical core, ignoring hyperthreads) or \"numa\" (pin each\n"
+        "            thread to all the CPUs of a NUMA node, alternating between nodes), a CPU list string\n"
+        "            such as \"0-3,8-11\", or a Python list of CPU numbers.  The resulting placement is\n"
+        "            written to the debug log.\n"
+        "            \n"
+        "            .. versionadded:: 5.5\n"
+        "               Added the `thread_affinity` argument\n\n"
         ":param progress_fn:  A python callback function to monitor progress.  The function should accept\n"
         "            a single argument of type :py:class:`tomographer.multiproc.FullStatusReport`.  Check\n"
         "            out :py:class:`tomographer.jpyutil.RandWalkProgressBar` if you are using a\n"
@@ -1174,6 +1645,10 @@ void py_tomo_tomorun(py::module rootmodule)
         "                                        fig_of_merit=lambda T: npl.norm(np.dot(T,T.T.conj())),\n"
         "                                        ...)\n"
         "\n"
+        "A Python callable is evaluated while holding the Python GIL, so the random walks can't evaluate it in\n"
+        "parallel.  For faster custom figures of merit, use a compiled function wrapped in a\n"
+        ":py:class:`NativeFunction` (e.g., a Numba `@cfunc`), which is called directly without the GIL.\n"
+        "\n"
         "\n"
         ".. rubric:: Return value\n"
         "\n"
@@ -1190,6 +1665,9 @@ void py_tomo_tomorun(py::module rootmodule)
         "reason you should ignore the binning analysis, so normally you should not be using this "
         "member.  This member is only useful if you want to test the error bars from the binning analysis "
         "against \"naive\" error bars\n\n"
+        "  - ``extra_final_histograms``: a list of :py:class:`~tomographer.HistogramWithErrorBars` instances, "
+        "one for each of the extra figures of merit given in `extra_fig_of_merit`, in the same order.  This "
+        "list is empty if no extra figures of merit were requested.\n\n"
         "  - ``elapsed_seconds``: the total time elapsed while running the random walks, in seconds.\n\n"
         "  - ``final_report_runs``: a human-readable summary report of each task run.  Allows the user to "
         "visually check that all error bars have converged in the binning analysis, and to get an approximate "
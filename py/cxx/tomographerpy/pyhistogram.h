@@ -209,6 +209,118 @@ public:
 
 
 
+/** \brief Two-dimensional histogram params. See \ref Tomographer::Histogram2DParams
+ */
+typedef Tomographer::Histogram2DParams<RealScalar> Histogram2DParams;
+
+
+//! Histogram class like \ref Tomographer::Histogram2D, but with NumPy arrays storage
+class Histogram2D
+{
+public:
+  Histogram2D(Histogram2DParams params_)
+    : params(params_),
+      bins(py::cast(Eigen::MatrixXd::Zero(params_.x.num_bins, params_.y.num_bins))),
+      off_chart(py::cast(0.0))
+  {
+  }
+
+  template<typename Scalar, typename CountType>
+  Histogram2D(const Tomographer::Histogram2D<Scalar,CountType> & h)
+    : params(h.params.x, h.params.y),
+      bins(py::cast(Eigen::Matrix<CountType,Eigen::Dynamic,Eigen::Dynamic>(h.countsArray().matrix()))),
+      off_chart(py::cast(h.off_chart))
+  {
+  }
+
+  inline void set_bins(py::object newbins)
+  {
+    check_shape(newbins, "Histogram2D.bins");
+    bins = newbins;
+  }
+  inline void set_off_chart(py::object o)
+  {
+    auto np = py::module::import("numpy");
+    if ( ! np.attr("isscalar")(o).cast<bool>() ) {
+      throw py::value_error("Expected scalar for assignment to Histogram2D.off_chart");
+    }
+    off_chart = o;
+  }
+
+  inline void load(py::object x, py::object o)
+  {
+    set_bins(x);
+    set_off_chart(o);
+  }
+
+  inline py::object normalization() const {
+    auto np = py::module::import("numpy");
+    // off_chart + binArea() * sum(bins)
+    return np.attr("add")(off_chart, np.attr("multiply")(py::cast(params.binArea()), bins.attr("sum")()));
+  }
+
+  inline py::object totalCounts() const {
+    auto np = py::module::import("numpy");
+    return np.attr("add")(off_chart, bins.attr("sum")());
+  }
+
+  Histogram2DParams params;
+  py::object bins;
+  py::object off_chart;
+
+  enum { HasErrorBars = 0 };
+
+protected:
+  inline void check_shape(py::object a, const char * what) const
+  {
+    py::tuple shape = a.attr("shape");
+    if (py::len(shape) != 2) {
+      throw py::value_error(streamstr("Expected 2-D NumPy array for assignment to " << what));
+    }
+    if (shape[0].cast<Eigen::Index>() != params.x.num_bins || shape[1].cast<Eigen::Index>() != params.y.num_bins) {
+      throw py::value_error(streamstr("Expected array of shape (" << params.x.num_bins << ", "
+                                      << params.y.num_bins << ") for assignment to " << what));
+    }
+  }
+};
+
+
+//! A two-dimensional histogram with error bars. See \ref Tomographer::Histogram2DWithErrorBars
+class Histogram2DWithErrorBars : public Histogram2D
+{
+public:
+  Histogram2DWithErrorBars(Histogram2DParams params_)
+    : Histogram2D(params_),
+      delta(py::cast(Eigen::MatrixXd::Zero(params_.x.num_bins, params_.y.num_bins)))
+  {
+  }
+
+  template<typename Scalar, typename CountType>
+  Histogram2DWithErrorBars(const Tomographer::Histogram2DWithErrorBars<Scalar,CountType> & h)
+    : Histogram2D(h),
+      delta(py::cast(Eigen::Matrix<CountType,Eigen::Dynamic,Eigen::Dynamic>(h.errorBarsArray().matrix())))
+  {
+  }
+
+  inline void set_delta(py::object newdelta)
+  {
+    check_shape(newdelta, "Histogram2DWithErrorBars.delta");
+    delta = newdelta;
+  }
+
+  inline void load(py::object x, py::object err, py::object o)
+  {
+    set_bins(x);
+    set_delta(err);
+    set_off_chart(o);
+  }
+
+  py::object delta;
+
+  enum { HasErrorBars = 1 };
+};
+
+
 
 } // namespace Py
 
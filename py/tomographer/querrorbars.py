@@ -185,6 +185,98 @@ def fit_histogram(normalized_histogram, fit_fn, ftox, **kwopts):
 
 
 
+def fit_histogram_native_a2(normalized_histogram, ftox_hs, threshold_fraction=0):
+    """
+    Fit the histogram data to the default fit model :py:func:`fit_fn_a2()`, using
+    the native C++ solver :py:func:`tomographer.fitHistogramA2()` instead of
+    `scipy.optimize.curve_fit(...)`.
+
+    The fit model is linear in its parameters, so the fit is solved exactly
+    without any iterative optimization.  The return value has the same
+    attributes as the one of :py:func:`fit_histogram()`.
+
+    You should prefer to use the higher-level :py:class:`HistogramAnalysis`
+    class with `fit_fn='a2-native'`, which calls this function internally.
+
+    :param normalized_histogram: the normalized histogram, as for
+        :py:func:`fit_histogram()`.
+
+    :param ftox_hs: the `f`-to-`x` transformation specified as a pair `(h, s)`,
+        as for :py:class:`HistogramAnalysis`.
+
+    :param threshold_fraction: ignore bins whose value is below this fraction of
+        the maximal bin value.
+
+    .. versionadded:: 5.5
+    """
+    import tomographer
+
+    f = normalized_histogram.values_center
+    x = ftox_hs[1]*(f - ftox_hs[0])
+    p = normalized_histogram.bins
+    errp = normalized_histogram.delta
+
+    fit = tomographer.fitHistogramA2(normalized_histogram, ftox=tuple(ftox_hs),
+                                     threshold_fraction=threshold_fraction)
+
+    # the points which the C++ solver kept for the fit
+    idxok = np.where((p > threshold_fraction*np.max(p)) & (p > 0) & (x > 0) & (errp > 0))
+
+    d = _Ns()
+    d.f = f
+    d.x = x
+    d.p = p
+    d.errp = errp
+    d.normalized_histogram = normalized_histogram
+    d.idxok = idxok
+    d.fok = f[idxok]
+    d.xok = x[idxok]
+    d.logpok = np.log(p[idxok])
+    d.errlogpok = np.divide(errp[idxok], p[idxok])
+    # fit data
+    d.popt = fit.params
+    d.pcov = fit.cov
+    d.native_fit = fit
+
+    return d
+
+
+def quantum_error_bars_many(histograms, ftox=(0,1), threshold_fraction=0, num_threads=0):
+    """
+    Fit many histograms with the default fit model and calculate their quantum
+    error bars, in parallel.
+
+    The fits are performed by the native C++ solver
+    :py:func:`tomographer.fitHistogramsA2()`, over `num_threads` threads
+    (by default, as many as there are CPUs) and without holding the Python GIL.
+    This is much faster than constructing a :py:class:`HistogramAnalysis` for
+    each histogram when analyzing a large number of data sets.
+
+    Returns a list with a :py:class:`QuantumErrorBars` named tuple for each of
+    the given `histograms` (instances of
+    :py:class:`tomographer.HistogramWithErrorBars`), or `None` for those
+    histograms which could not be fitted.
+
+    .. versionadded:: 5.5
+    """
+    import tomographer
+
+    fits = tomographer.fitHistogramsA2(histograms, ftox=tuple(ftox), threshold_fraction=threshold_fraction,
+                                       num_threads=num_threads)
+    qlist = []
+    for fit in fits:
+        if fit is None:
+            qlist.append(None)
+            continue
+        try:
+            qlist.append(QuantumErrorBars(*fit.quantumErrorBars(tuple(ftox))))
+        except tomographer.HistogramFitError as e:
+            logger.warning("Can't calculate the quantum error bars: {}".format(e))
+            qlist.append(None)
+    return qlist
+
+
+
 def deskew_logmu_curve(a2, a1, m, c):
     """
     .. deprecated:: 5.2
@@ -394,6 +486,7 @@ See :py:data:`fit_models`.
 fit_models = {
     'a2': FitModelSpec(fit_fn_a2, FitParamToQuErrorBars_a2()),
     'direct': FitModelSpec(fit_fn_direct, FitParamToQuErrorBars_direct()),
+    'a2-native': FitModelSpec(fit_fn_a2, FitParamToQuErrorBars_a2()),
 }
 """
 Dictionary of known, built-in fit models.  The key is the the built-in name
@@ -401,7 +494,13 @@ Dictionary of known, built-in fit models.  The key is the the built-in name
 information about the function to use as fit model as well as a converter
 implementation allowing to convert the fit parameters to quantum error bars.
 
+The 'a2-native' model is the same as 'a2', but the fit is solved by the native
+C++ solver (see :py:func:`fit_histogram_native_a2()`).
+
 .. versionadded:: 5.2
+
+.. versionchanged:: 5.5
+   Added the 'a2-native' fit model.
 """
 
 
@@ -503,6 +602,14 @@ class HistogramAnalysis(object):
         .. versionchanged:: 5.2
            Support for additional built-in fit models.
 
+        .. versionchanged:: 5.5
+           The 'a2-native' model fits the same model as 'a2', but with the
+           native C++ solver :py:func:`fit_histogram_native_a2()`.  The fit
+           is solved exactly, without `scipy.optimize.curve_fit()`, which is
+           much faster.  Of the additional arguments in `kwopts`, only
+           `threshold_fraction` and `redchi2_warn_threshold` are used in this
+           case.
+
       - additional named arguments in `kwopts` are passed on to
         :py:func:`fit_histogram`.
     """
@@ -531,19 +638,26 @@ class HistogramAnalysis(object):
             self.fit_fn = fit_models[fit_fn].fn
             self.fit_converter = fit_models[fit_fn].converter
 
-            if 'bounds' not in kwopts:
-                # a2, a1, m, c
-                kwopts['bounds'] = self.fit_converter.fitParamBounds()
+            # the native solver needs neither bounds nor an initial guess
+            if fit_fn != 'a2-native':
+                if 'bounds' not in kwopts:
+                    # a2, a1, m, c
+                    kwopts['bounds'] = self.fit_converter.fitParamBounds()
 
-            if 'p0' not in kwopts:
-                qxguess = guess_querrorbarsx_from_data(self.normalized_histogram, self.ftox)
-                kwopts['p0'] = self.fit_converter.guessFitParamsFromQuErrorBarsX(qxguess)
-                logger.debug("Guessing initial fit params = {!r}".format(kwopts['p0']))
+                if 'p0' not in kwopts:
+                    qxguess = guess_querrorbarsx_from_data(self.normalized_histogram, self.ftox)
+                    kwopts['p0'] = self.fit_converter.guessFitParamsFromQuErrorBarsX(qxguess)
+                    logger.debug("Guessing initial fit params = {!r}".format(kwopts['p0']))
 
         self.FitParamsType = collections.namedtuple('FitParamsType', inspect.getargspec(self.fit_fn).args[1:])
 
-        self.fit_histogram_result = fit_histogram(self.normalized_histogram, fit_fn=self.fit_fn,
-                                                  ftox=self.ftox, **kwopts)
+        if not self.custom_fit_fn and self.fit_fn_name == 'a2-native':
+            self.fit_histogram_result = fit_histogram_native_a2(
+                self.normalized_histogram, ftox_hs=self.ftox_hs,
+                threshold_fraction=kwopts.get('threshold_fraction', 0))
+        else:
+            self.fit_histogram_result = fit_histogram(self.normalized_histogram, fit_fn=self.fit_fn,
+                                                      ftox=self.ftox, **kwopts)
         self.fit_params = self.FitParamsType(*self.fit_histogram_result.popt)
         self.fit_params_cov = self.FitParamsType(*np.diagonal(self.fit_histogram_result.pcov))
 
@@ -0,0 +1,213 @@
+
+"""
+Read the results files written by the C++ class ``Tomographer::ResultsFileWriter``
+(e.g. by `tomorun` with the option ``--write-results``).
+
+A results file stores a sequence of records.  There is one record for the
+histogram of each random walk (together with its binning analysis error bars at
+each level and the convergence status of each bin, if available), and one record
+for the final histogram aggregated from all the random walks of a data set.
+Each record also stores the random walk parameters and acceptance ratio.
+Records can be appended to an existing file, so that the results of many runs
+can be collected in a single file; the records of a data set are identified by
+their `dataset_id` and `label`.
+
+All the arrays are aligned in the file, so that they can be accessed directly in
+the memory-mapped file without reading the whole file into memory.
+"""
+
+from __future__ import print_function
+
+import numpy as np
+
+
+HEADER_SIZE = 16
+"""
+The size of the file header, in bytes.
+"""
+
+RECORD_HEADER_SIZE = 128
+"""
+The size of the fixed-size fields at the beginning of each record, in bytes.
+"""
+
+FORMAT_VERSION = 1
+"""
+The version of the file format which we know how to read.
+"""
+
+TASK_RESULT = 1
+"""
+The `kind` of a record which holds the result of a single random walk.
+"""
+
+AGGREGATED_RESULT = 2
+"""
+The `kind` of a record which holds the histogram aggregated from all the random
+walks of a data set.
+"""
+
+
+class ResultsFileError(Exception):
+    """
+    Raised if a file is not a valid results file.
+    """
+    pass
+
+
+record_header_dtype = np.dtype([
+    ('magic', 'S4'),
+    ('kind', np.uint32),
+    ('record_size', np.uint64),
+    ('dataset_id', np.int64),
+    ('task_id', np.int64),
+    ('num_bins', np.uint64),
+    ('num_levels', np.uint64),
+    ('label_size', np.uint64),
+    ('min', np.float64),
+    ('max', np.float64),
+    ('off_chart', np.float64),
+    ('acceptance_ratio', np.float64),
+    ('n_sweep', np.int64),
+    ('n_therm', np.int64),
+    ('n_run', np.int64),
+    ('step_size', np.float64),
+    ('_reserved', np.uint64),
+])
+"""
+The `NumPy` structured data type of the fixed-size fields at the beginning of
+each record.
+"""
+
+
+def _padded(n):
+    return (n + 7) & ~7
+
+
+class ResultsRecord(object):
+    """
+    A record of a results file, as returned by :py:func:`load`.
+
+    The following attributes are available: `kind` (:py:data:`TASK_RESULT` or
+    :py:data:`AGGREGATED_RESULT`), `dataset_id`, `task_id` (-1 for an
+    aggregated result), `label`, `min`, `max`, `off_chart`, `acceptance_ratio`
+    (averaged over the random walks for an aggregated result), `n_sweep`,
+    `n_therm`, `n_run` and `step_size` (`NaN` if the random walk has no step
+    size).
+
+    The arrays `bins` and `delta` are the histogram bin values and error bars,
+    `error_levels` is a two-dimensional array with one row per bin giving the
+    error bars at each binning level, and `converged_status` gives the
+    convergence status of the binning analysis of each bin (see
+    :py:class:`tomographer.BinningAnalysis`).  The last two are empty if there
+    was no binning analysis.  These arrays point directly into the
+    memory-mapped file.
+    """
+    def __init__(self, hdr, label, bins, delta, error_levels, converged_status):
+        self.kind = int(hdr['kind'])
+        self.dataset_id = int(hdr['dataset_id'])
+        self.task_id = int(hdr['task_id'])
+        self.label = label
+        self.min = float(hdr['min'])
+        self.max = float(hdr['max'])
+        self.off_chart = float(hdr['off_chart'])
+        self.acceptance_ratio = float(hdr['acceptance_ratio'])
+        self.n_sweep = int(hdr['n_sweep'])
+        self.n_therm = int(hdr['n_therm'])
+        self.n_run = int(hdr['n_run'])
+        self.step_size = float(hdr['step_size'])
+        self.bins = bins
+        self.delta = delta
+        self.error_levels = error_levels
+        self.converged_status = converged_status
+
+    @property
+    def is_task_result(self):
+        """
+        Whether this record holds the result of a single random walk.
+        """
+        return self.kind == TASK_RESULT
+
+    @property
+    def is_aggregated_result(self):
+        """
+        Whether this record holds an aggregated histogram.
+        """
+        return self.kind == AGGREGATED_RESULT
+
+    def histogram(self):
+        """
+        Return a :py:class:`tomographer.HistogramWithErrorBars` with the
+        contents of the histogram stored in this record.
+        """
+        import tomographer
+        h = tomographer.HistogramWithErrorBars(self.min, self.max, len(self.bins))
+        h.load(self.bins, self.delta, self.off_chart)
+        return h
+
+    def __repr__(self):
+        return "<ResultsRecord {} dataset_id={} task_id={} label={!r} num_bins={}>".format(
+            'task' if self.is_task_result else 'aggregated',
+            self.dataset_id, self.task_id, self.label, len(self.bins))
+
+
+def read_header(filename):
+    """
+    Check the header of the results file `filename`.  Returns the format version.
+    """
+    with open(filename, 'rb') as f:
+        header = np.fromfile(f, dtype=np.uint8, count=HEADER_SIZE)
+    if len(header) < HEADER_SIZE or header[:8].tobytes() != b'TOMORSLT':
+        raise ResultsFileError("{}: Not a results file".format(filename))
+    version = int(header[8:12].view(np.uint32)[0])
+    if version != FORMAT_VERSION:
+        raise ResultsFileError("{}: Unsupported file format version {}".format(filename, version))
+    return version
+
+
+def load(filename):
+    """
+    Memory-map the results file `filename` and return the list of its records,
+    as :py:class:`ResultsRecord` objects, in the order in which they were
+    written.
+
+    If the file ends with an incomplete record (e.g. because the writing process
+    was interrupted), that record is ignored.
+    """
+    read_header(filename)
+    with open(filename, 'rb') as f:
+        f.seek(0, 2)
+        filesize = f.tell()
+    if filesize <= HEADER_SIZE:
+        return []
+    data = np.memmap(filename, dtype=np.uint8, mode='r')
+
+    records = []
+    offset = HEADER_SIZE
+    while offset + RECORD_HEADER_SIZE <= filesize:
+        hdr = data[offset:offset+RECORD_HEADER_SIZE].view(record_header_dtype)[0]
+        if hdr['magic'] != b'RSLT':
+            raise ResultsFileError("{}: Invalid record at offset {}".format(filename, offset))
+        nb, nl, label_size = int(hdr['num_bins']), int(hdr['num_levels']), int(hdr['label_size'])
+        bins_offset = offset + RECORD_HEADER_SIZE + _padded(label_size)
+        delta_offset = bins_offset + 8*nb
+        error_levels_offset = delta_offset + 8*nb
+        converged_status_offset = error_levels_offset + 8*nb*nl
+        end = converged_status_offset + (_padded(4*nb) if nl > 0 else 0)
+        if end - offset != int(hdr['record_size']):
+            raise ResultsFileError("{}: Inconsistent record size at offset {}".format(filename, offset))
+        if end > filesize:
+            # incomplete last record
+            break
+
+        label = data[offset+RECORD_HEADER_SIZE:offset+RECORD_HEADER_SIZE+label_size].tobytes().decode('utf-8')
+        bins = data[bins_offset:delta_offset].view(np.float64)
+        delta = data[delta_offset:error_levels_offset].view(np.float64)
+        # stored level after level, with one row per bin
+        error_levels = data[error_levels_offset:converged_status_offset].view(np.float64).reshape((nb, nl), order='F')
+        converged_status = data[converged_status_offset:converged_status_offset+4*(nb if nl > 0 else 0)].view(np.int32)
+
+        records.append(ResultsRecord(hdr, label, bins, delta, error_levels, converged_status))
+        offset = end
+
+    return records
@@ -0,0 +1,95 @@
+
+"""
+Read the sample stream files written by the C++ class
+``Tomographer::SampleStreamWriter`` (e.g. by `tomorun` with the option
+``--write-samples``).
+
+A sample stream file stores one fixed-size record for each sample of the random
+walk, consisting of the task ID, the value of the random walk function at that
+point (the log-likelihood for `tomorun`), and a list of values describing the
+sample point (for `tomorun`, the :math:`d^2` real parameters of the density
+matrix in the X-parameterization).  Since all the records have the same size,
+the file can be memory-mapped and is not read into memory all at once.
+"""
+
+from __future__ import print_function
+
+import numpy as np
+
+
+HEADER_SIZE = 32
+"""
+The size of the file header, in bytes.
+"""
+
+FORMAT_VERSION = 1
+"""
+The version of the file format which we know how to read.
+"""
+
+
+class SampleStreamFileError(Exception):
+    """
+    Raised if a file is not a valid sample stream file.
+    """
+    pass
+
+
+def record_dtype(num_values, value_bytes=8):
+    """
+    Return the `NumPy` structured data type of a single record, with fields
+    ``task_id``, ``fnval`` and ``values`` (an array of `num_values` single or
+    double precision floating-point values, depending on `value_bytes`).
+    """
+    if value_bytes not in (4, 8):
+        raise ValueError("Invalid value size {}, expected 4 or 8".format(value_bytes))
+    return np.dtype([
+        ('task_id', np.int32),
+        ('_reserved', np.int32),
+        ('fnval', np.float64),
+        ('values', np.float32 if value_bytes == 4 else np.float64, (num_values,)),
+    ])
+
+
+def read_header(filename):
+    """
+    Read the header of the sample stream file `filename`.  Returns a tuple
+    ``(num_values, value_bytes)``.
+    """
+    with open(filename, 'rb') as f:
+        header = np.fromfile(f, dtype=np.uint8, count=HEADER_SIZE)
+    if len(header) < HEADER_SIZE or header[:8].tobytes() != b'TOMOSMPL':
+        raise SampleStreamFileError("{}: Not a sample stream file".format(filename))
+    version, value_bytes = header[8:16].view(np.uint32)
+    num_values, record_size = header[16:32].view(np.uint64)
+    if version != FORMAT_VERSION:
+        raise SampleStreamFileError("{}: Unsupported file format version {}".format(filename, version))
+    num_values, value_bytes = int(num_values), int(value_bytes)
+    if record_dtype(num_values, value_bytes).itemsize != record_size:
+        raise SampleStreamFileError("{}: Inconsistent record size in header".format(filename))
+    return (num_values, value_bytes)
+
+
+def load(filename, mode='r'):
+    """
+    Memory-map the records of the sample stream file `filename`.
+
+    Returns a one-dimensional :py:class:`numpy.memmap` of records with the
+    structured data type given by :py:func:`record_dtype`.  For instance, the
+    values of all the samples are given by ``load(filename)['values']`` as a
+    two-dimensional array, with one row per sample.
+
+    If the file ends with an incomplete record (e.g. because the random walk was
+    interrupted), that record is ignored.  The `mode` is passed on to
+    :py:class:`numpy.memmap`.
+    """
+    num_values, value_bytes = read_header(filename)
+    dtype = record_dtype(num_values, value_bytes)
+    with open(filename, 'rb') as f:
+        f.seek(0, 2)
+        filesize = f.tell()
+    num_records = (filesize - HEADER_SIZE) // dtype.itemsize
+    if num_records == 0:
+        # numpy.memmap can't map an empty region
+        return np.zeros((0,), dtype=dtype)
+    return np.memmap(filename, dtype=dtype, mode=mode, offset=HEADER_SIZE, shape=(num_records,))
@@ -0,0 +1,209 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+//
+// Benchmark of the jump function of LLHMHWalkerLight, compared to the elementary rotation
+// jumps of Tomographer 5.0-5.4 (reproduced below as ReferenceLightJumps).
+//
+// This program is not run as part of the test suite.  Build it with "make
+// bench_densedm_tspacellhwalkerlight" (in Release mode), and run it with an optional
+// number of jumps per dimension as argument.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <iostream>
+
+#include <tomographer/tools/loggers.h>
+#include <tomographer/densedm/dmtypes.h>
+#include <tomographer/densedm/indepmeasllh.h>
+#include <tomographer/densedm/tspacellhwalker.h>
+
+
+typedef Tomographer::DenseDM::DMTypes<Eigen::Dynamic, double> DMTypes;
+typedef Tomographer::DenseDM::IndepMeasLLH<DMTypes> DenseLLH;
+typedef Tomographer::Logger::FileLogger BaseLoggerType;
+
+typedef DMTypes::MatrixType MatrixType;
+typedef DMTypes::RealScalar RealScalar;
+typedef DMTypes::ComplexScalar ComplexScalar;
+
+
+//
+// The jump function of LLHMHWalkerLight as of Tomographer 5.4
+//
+template<typename LoggerType>
+struct ReferenceLightJumps
+{
+  const DMTypes dmt;
+  std::mt19937 & rng;
+  std::normal_distribution<RealScalar> normal_distr_rnd;
+  std::uniform_int_distribution<int> jumptype_distr_rnd;
+  std::uniform_int_distribution<Eigen::Index> jumpdir_distr_rnd;
+  Tomographer::Logger::LocalLogger<LoggerType> llogger;
+
+  ReferenceLightJumps(const DMTypes dmt_, std::mt19937 & rng_, LoggerType & baselogger)
+    : dmt(dmt_), rng(rng_), normal_distr_rnd(0.0, 1.0), jumptype_distr_rnd(0, 2),
+      jumpdir_distr_rnd(0, (Eigen::Index)dmt.dim2()-1),
+      llogger("ReferenceLightJumps", baselogger)
+  {
+  }
+
+  inline MatrixType jumpFn(const MatrixType & cur_T, RealScalar step_size)
+  {
+    MatrixType new_T(cur_T);
+
+    auto logger = llogger.subLogger(TOMO_ORIGIN) ;
+
+    for (int j = 0; j < (int)dmt.dim(); ++j) {
+      Eigen::Index k1 = jumpdir_distr_rnd(rng);
+      Eigen::Index k2;
+      do { k2 = jumpdir_distr_rnd(rng); } while (k1 == k2);
+      if (k1 > k2) { std::swap(k1, k2); }
+      int xyz = jumptype_distr_rnd(rng);
+
+      RealScalar sina = step_size * normal_distr_rnd(rng);
+      if (sina < -1) { sina = -1; }
+      if (sina >  1) { sina =  1; }
+      RealScalar cosa = std::sqrt(1 - sina*sina);
+      Eigen::Matrix<ComplexScalar,2,2> tr2d;
+      switch (xyz) {
+      case 0: // X-type rotation
+        tr2d(0,0) = cosa;                   tr2d(0,1) = ComplexScalar(0,sina);
+        tr2d(1,0) = ComplexScalar(0,sina);  tr2d(1,1) = cosa;
+        break;
+      case 1: // Y-type rotation
+        tr2d(0,0) = cosa;   tr2d(0,1) = sina;
+        tr2d(1,0) = -sina;  tr2d(1,1) = cosa;
+        break;
+      case 2: // Z-type rotation
+        tr2d(0,0) = ComplexScalar(cosa, sina);  tr2d(0,1) = 0;
+        tr2d(1,0) = 0;                          tr2d(1,1) = ComplexScalar(cosa, -sina);
+        break;
+      default:
+        tomographer_assert(false && "Invalid rotation type number sampled!");
+      }
+      const Eigen::Index i1 = k1 / (Eigen::Index)dmt.dim();
+      const Eigen::Index j1 = k1 % (Eigen::Index)dmt.dim();
+      const Eigen::Index i2 = k2 / (Eigen::Index)dmt.dim();
+      const Eigen::Index j2 = k2 % (Eigen::Index)dmt.dim();
+
+      logger.longdebug([&](std::ostream & stream) {
+          stream << "Elementary jump rotation: "
+                 << "k1="<<k1<<" -> i1="<<i1<<" j1="<<j1<<"  k2="<<k2<<" -> i2="<<i2<<" j2="<<j2<<"\n"
+                 << "tr2d=" << tr2d;
+        }) ;
+
+      const auto x = tr2d(0,0) * new_T(i1,j1) + tr2d(0,1) * new_T(i2,j2) ;
+      const auto y = tr2d(1,0) * new_T(i1,j1) + tr2d(1,1) * new_T(i2,j2) ;
+      new_T(i1,j1) = x;
+      new_T(i2,j2) = y;
+    }
+
+    new_T /= new_T.norm();
+    return new_T;
+  }
+};
+
+
+//
+// Run n_jumps jumps starting from T, each time from the last point.  Returns the time per
+// jump in nanoseconds.
+//
+template<typename JumpsObject>
+double timeJumps(JumpsObject & jumps, MatrixType T, long n_jumps, RealScalar step_size)
+{
+  auto t_start = std::chrono::steady_clock::now();
+  for (long n = 0; n < n_jumps; ++n) {
+    T = jumps.jumpFn(T, step_size);
+  }
+  auto t_end = std::chrono::steady_clock::now();
+  // make sure the jumps are not optimized away
+  if (!(T.norm() > 0.5)) {
+    std::fprintf(stderr, "Unexpected norm of T!\n");
+  }
+  return std::chrono::duration<double, std::nano>(t_end - t_start).count() / n_jumps;
+}
+
+//
+// Average overlap Re tr(T_prev^\dagger T_new) between successive points, which should
+// coincide for both implementations
+//
+template<typename JumpsObject>
+RealScalar avgOverlap(JumpsObject & jumps, MatrixType T, long n_jumps, RealScalar step_size)
+{
+  RealScalar sum_overlap = 0;
+  for (long n = 0; n < n_jumps; ++n) {
+    MatrixType new_T = jumps.jumpFn(T, step_size);
+    sum_overlap += T.cwiseProduct(new_T.conjugate()).sum().real();
+    T = std::move(new_T);
+  }
+  return sum_overlap / n_jumps;
+}
+
+
+int main(int argc, char **argv)
+{
+  const long n_jumps_dim4 = (argc > 1) ? std::atol(argv[1]) : 400000;
+  const RealScalar step_size = 0.04;
+
+  // like in tomorun: logger with a run-time level, messages are not displayed
+  BaseLoggerType rootlogger(stderr, Tomographer::Logger::INFO);
+
+  std::printf("%5s %12s %14s %14s %8s %12s %12s\n", "dim", "jumps", "ref. [ns/jump]",
+              "new [ns/jump]", "speedup", "ref. overlap", "new overlap");
+
+  for (int dim = 4; dim <= 64; dim *= 2) {
+    const DMTypes dmt(dim);
+    DenseLLH llh(dmt);
+
+    // same total number of elementary rotations for each dimension
+    const long n_jumps = std::max(1L, n_jumps_dim4 * 4 / dim);
+
+    std::mt19937 rng(12345);
+    std::normal_distribution<RealScalar> normal_distr_rnd(0.0, 1.0);
+    MatrixType T0 = Tomographer::Tools::denseRandom<MatrixType>(rng, normal_distr_rnd, dim, dim);
+    T0 /= T0.norm();
+
+    ReferenceLightJumps<BaseLoggerType> refjumps(dmt, rng, rootlogger);
+    Tomographer::DenseDM::TSpace::LLHMHWalkerLight<DenseLLH, std::mt19937, BaseLoggerType>
+      mhwalker(T0, llh, rng, rootlogger);
+
+    const double t_ref = timeJumps(refjumps, T0, n_jumps, step_size);
+    const double t_new = timeJumps(mhwalker, T0, n_jumps, step_size);
+
+    const RealScalar ref_overlap = avgOverlap(refjumps, T0, n_jumps, step_size);
+    const RealScalar new_overlap = avgOverlap(mhwalker, T0, n_jumps, step_size);
+
+    std::printf("%5d %12ld %14.1f %14.1f %8.2f %12.6f %12.6f\n", dim, n_jumps, t_ref, t_new,
+                t_ref / t_new, (double)ref_overlap, (double)new_overlap);
+  }
+
+  return 0;
+}
@@ -50,7 +50,44 @@ class tParamX(unittest.TestCase):
         npt.assert_array_almost_equal(p.XToHerm(x), A)
         # also with keyword argument
         npt.assert_array_almost_equal(p.XToHerm(x=x), A)
-                                      
+
+    def test_batch(self):
+        p = tomographer.densedm.ParamX(tomographer.densedm.DMTypes(3))
+
+        np.random.seed(1234)
+        T = np.random.normal(size=(200,3,3)) + 1j*np.random.normal(size=(200,3,3))
+        Herms = np.einsum('nij,nkj->nik', T, T.conj())
+
+        X = p.HermToXBatch(Herms)
+        self.assertEqual(X.shape, (200, 9))
+        for i in [0, 1, 57, 199]:
+            npt.assert_array_almost_equal(X[i], p.HermToX(Herms[i]))
+
+        # also with a single thread and with keyword arguments
+        npt.assert_array_almost_equal(p.HermToXBatch(Herms=Herms, num_threads=1), X)
+
+        # and back
+        H = p.XToHermBatch(X)
+        self.assertEqual(H.shape, (200, 3, 3))
+        npt.assert_array_almost_equal(H, Herms)
+        npt.assert_array_almost_equal(p.XToHermBatch(X=X, num_threads=3), Herms)
+
+        # non-contiguous input is fine
+        npt.assert_array_almost_equal(p.XToHermBatch(X[::2]), Herms[::2])
+
+        # empty stacks
+        self.assertEqual(p.HermToXBatch(np.zeros((0,3,3))).shape, (0, 9))
+
+        # wrong shapes
+        with self.assertRaises(Exception):
+            p.HermToXBatch(Herms[0])
+        with self.assertRaises(Exception):
+            p.HermToXBatch(np.zeros((5,2,3)))
+        with self.assertRaises(Exception):
+            p.HermToXBatch(np.zeros((5,2,2)))
+        with self.assertRaises(Exception):
+            p.XToHermBatch(np.zeros((5,8)))
+
 
 class tIndepMeasLLH(unittest.TestCase):
     def test_basic(self):
@@ -138,6 +175,56 @@ class tIndepMeasLLH(unittest.TestCase):
                                                   [-0.1j, 0.6]]))
         self.assertAlmostEqual(llhval2, 15*np.log(0.4)+85*np.log(0.6))
 
+    def test_views(self):
+        llh = tomographer.densedm.IndepMeasLLH(tomographer.densedm.DMTypes(2))
+        llh.setMeas(np.array([ [1, 0, 0, 0], [0, 1, 0, 0] ]), np.array([15, 85]))
+
+        Exn = llh.Exn()
+        Nx = llh.Nx()
+        npt.assert_array_almost_equal(Exn, np.array([[1, 0, 0, 0], [0, 1, 0, 0]]))
+        npt.assert_array_equal(Nx, np.array([15, 85]))
+
+        # views onto the internal data, which can't be written to
+        self.assertFalse(Exn.flags.owndata)
+        self.assertFalse(Exn.flags.writeable)
+        self.assertFalse(Nx.flags.owndata)
+        self.assertFalse(Nx.flags.writeable)
+        with self.assertRaises(ValueError):
+            Exn[0,0] = 2
+
+        # a copy may still be modified
+        Exn2 = np.array(llh.Exn())
+        Exn2[0,0] = 2
+        npt.assert_array_almost_equal(llh.Exn(), np.array([[1, 0, 0, 0], [0, 1, 0, 0]]))
+
+    def test_batch(self):
+        dmt = tomographer.densedm.DMTypes(3)
+        p = tomographer.densedm.ParamX(dmt)
+        llh = tomographer.densedm.IndepMeasLLH(dmt)
+
+        np.random.seed(4321)
+        E = np.random.normal(size=(12,3,3)) + 1j*np.random.normal(size=(12,3,3))
+        llh.setMeas(np.einsum('nij,nkj->nik', E, E.conj()), np.random.randint(1, 50, size=12))
+
+        T = np.random.normal(size=(500,3,3)) + 1j*np.random.normal(size=(500,3,3))
+        rhos = np.einsum('nij,nkj->nik', T, T.conj())
+        rhos /= np.trace(rhos, axis1=1, axis2=2).real[:,np.newaxis,np.newaxis]
+        X = p.HermToXBatch(rhos)
+
+        values = llh.logLikelihoodXBatch(X)
+        self.assertEqual(values.shape, (500,))
+        for i in [0, 1, 250, 499]:
+            self.assertAlmostEqual(values[i], llh.logLikelihoodX(X[i]))
+
+        npt.assert_array_almost_equal(llh.logLikelihoodXBatch(X=X, num_threads=1), values)
+        npt.assert_array_almost_equal(llh.logLikelihoodRhoBatch(rhos), values)
+        npt.assert_array_almost_equal(llh.logLikelihoodRhoBatch(rhos=rhos, num_threads=2), values)
+
+        with self.assertRaises(Exception):
+            llh.logLikelihoodXBatch(np.zeros((5,4)))
+        with self.assertRaises(Exception):
+            llh.logLikelihoodRhoBatch(np.zeros((5,2,2)))
+
 
 # normally, this is not needed as we are being run via pyruntest.py, but it might be
 # useful if we want to run individually picked tests
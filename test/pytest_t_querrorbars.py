@@ -1,6 +1,8 @@
 
+import numpy as np
 import numpy.testing as npt
 
+import tomographer
 import tomographer.querrorbars
 
 import unittest
@@ -32,6 +34,49 @@ class TestQuErrBarsTransf(unittest.TestCase):
                                  [m] + list(desk) )
 
 
+class TestNativeFit(unittest.TestCase):
+
+    fitparams = (250.1, 100.0, 42.1, 8.3) # a2, a1, m, c
+
+    def mkhistogram(self, fitparams=None):
+        if fitparams is None:
+            fitparams = self.fitparams
+        h = tomographer.HistogramWithErrorBars(0.6, 1.0, 40)
+        x = 1 - h.values_center
+        bins = 1000*np.exp(tomographer.querrorbars.fit_fn_a2(x, *fitparams))
+        h.load(bins, 0.05*bins, 0.0)
+        return h
+
+    def test_fit(self):
+        h = self.mkhistogram()
+        fit = tomographer.fitHistogramA2(h, ftox=(1,-1))
+        self.assertEqual(fit.num_points, 40)
+        npt.assert_allclose(fit.params[:3], self.fitparams[:3], rtol=1e-6)
+        self.assertLess(fit.redchi2, 1e-10)
+        self.assertEqual(fit.cov.shape, (4,4))
+
+        with self.assertRaises(tomographer.HistogramFitError):
+            tomographer.fitHistogramA2(tomographer.HistogramWithErrorBars(0.6, 1.0, 40), ftox=(1,-1))
+
+    def test_analysis(self):
+        h = self.mkhistogram()
+        a = tomographer.querrorbars.HistogramAnalysis(h, ftox=(1,-1), fit_fn='a2-native')
+        a_scipy = tomographer.querrorbars.HistogramAnalysis(h, ftox=(1,-1))
+        npt.assert_allclose(a.fitParameters(), a_scipy.fitParameters(), rtol=1e-4)
+        npt.assert_allclose(a.quantumErrorBars(), a_scipy.quantumErrorBars(), rtol=1e-4)
+
+    def test_many(self):
+        hlist = [ self.mkhistogram(), tomographer.HistogramWithErrorBars(0.6, 1.0, 40),
+                  self.mkhistogram((200.0, 90.0, 30.0, 5.0)) ]
+        qlist = tomographer.querrorbars.quantum_error_bars_many(hlist, ftox=(1,-1), num_threads=2)
+        self.assertEqual(len(qlist), 3)
+        self.assertIsNone(qlist[1])
+        for h, q in ((hlist[0], qlist[0]), (hlist[2], qlist[2])):
+            qref = tomographer.querrorbars.HistogramAnalysis(h, ftox=(1,-1), fit_fn='a2-native').quantumErrorBars()
+            npt.assert_allclose(q, qref, rtol=1e-10)
+            self.assertIsInstance(q, tomographer.querrorbars.QuantumErrorBars)
+
+
 # normally, this is not needed as we are being run via pyruntest.py, but it might be
 # useful if we want to run individually picked tests
 if __name__ == '__main__':
@@ -0,0 +1,114 @@
+
+import os
+import tempfile
+
+import numpy as np
+import numpy.testing as npt
+
+import tomographer.resultsfile
+
+import unittest
+
+
+def _write_record(f, kind, dataset_id, task_id, label, bins, delta, error_levels=None,
+                  converged_status=None, off_chart=0.0, acceptance_ratio=0.25):
+    label = label.encode('utf-8')
+    nb = len(bins)
+    nl = error_levels.shape[1] if error_levels is not None else 0
+    padded_label = label + b'\x00' * (-len(label) % 8)
+    body = padded_label + np.asarray(bins, dtype=np.float64).tobytes() \
+           + np.asarray(delta, dtype=np.float64).tobytes()
+    if nl > 0:
+        status = np.asarray(converged_status, dtype=np.int32).tobytes()
+        body += np.asarray(error_levels, dtype=np.float64).tobytes(order='F') \
+                + status + b'\x00' * (-len(status) % 8)
+    hdr = np.zeros((1,), dtype=tomographer.resultsfile.record_header_dtype)
+    hdr['magic'] = b'RSLT'
+    hdr['kind'] = kind
+    hdr['record_size'] = tomographer.resultsfile.RECORD_HEADER_SIZE + len(body)
+    hdr['dataset_id'] = dataset_id
+    hdr['task_id'] = task_id
+    hdr['num_bins'] = nb
+    hdr['num_levels'] = nl
+    hdr['label_size'] = len(label)
+    hdr['min'] = 0.0
+    hdr['max'] = 1.0
+    hdr['off_chart'] = off_chart
+    hdr['acceptance_ratio'] = acceptance_ratio
+    hdr['n_sweep'] = 10
+    hdr['n_therm'] = 100
+    hdr['n_run'] = 1000
+    hdr['step_size'] = 0.04
+    f.write(hdr.tobytes() + body)
+
+
+def _write_header(f):
+    f.write(b'TOMORSLT')
+    f.write(np.array([1, 0], dtype=np.uint32).tobytes())
+
+
+class ResultsFileTest(unittest.TestCase):
+
+    def setUp(self):
+        fd, self.fname = tempfile.mkstemp(suffix='.bin')
+        os.close(fd)
+
+    def tearDown(self):
+        os.remove(self.fname)
+
+    def test_load(self):
+        error_levels = np.array([[0.1, 0.11, 0.12], [0.2, 0.21, 0.22], [0.3, 0.31, 0.32]])
+        with open(self.fname, 'wb') as f:
+            _write_header(f)
+            _write_record(f, tomographer.resultsfile.TASK_RESULT, 7, 0, 'data.mat',
+                          [1.0, 2.0, 3.0], [0.1, 0.2, 0.3], error_levels, [1, 2, 0])
+            _write_record(f, tomographer.resultsfile.AGGREGATED_RESULT, 7, -1, 'data.mat',
+                          [1.5, 2.5, 3.5], [0.5, 0.5, 0.5], off_chart=0.5)
+
+        recs = tomographer.resultsfile.load(self.fname)
+        self.assertEqual(len(recs), 2)
+
+        r = recs[0]
+        self.assertTrue(r.is_task_result)
+        self.assertEqual((r.dataset_id, r.task_id, r.label), (7, 0, 'data.mat'))
+        self.assertEqual((r.n_sweep, r.n_therm, r.n_run), (10, 100, 1000))
+        self.assertAlmostEqual(r.step_size, 0.04)
+        self.assertAlmostEqual(r.acceptance_ratio, 0.25)
+        npt.assert_array_almost_equal(r.bins, [1.0, 2.0, 3.0])
+        npt.assert_array_almost_equal(r.delta, [0.1, 0.2, 0.3])
+        npt.assert_array_almost_equal(r.error_levels, error_levels)
+        npt.assert_array_equal(r.converged_status, [1, 2, 0])
+
+        a = recs[1]
+        self.assertTrue(a.is_aggregated_result)
+        self.assertEqual(a.task_id, -1)
+        self.assertEqual(a.error_levels.shape, (3, 0))
+        self.assertEqual(len(a.converged_status), 0)
+        h = a.histogram()
+        npt.assert_array_almost_equal(h.bins, [1.5, 2.5, 3.5])
+        npt.assert_array_almost_equal(h.delta, [0.5, 0.5, 0.5])
+        self.assertAlmostEqual(h.off_chart, 0.5)
+        del recs, r, a # close the memory map
+
+    def test_incomplete_record(self):
+        with open(self.fname, 'wb') as f:
+            _write_header(f)
+            _write_record(f, tomographer.resultsfile.TASK_RESULT, 0, 0, 'x', [1.0, 2.0], [0.0, 0.0])
+            _write_record(f, tomographer.resultsfile.TASK_RESULT, 0, 1, 'x', [3.0, 4.0], [0.0, 0.0])
+        with open(self.fname, 'r+b') as f:
+            f.seek(-10, 2)
+            f.truncate()
+        recs = tomographer.resultsfile.load(self.fname)
+        self.assertEqual(len(recs), 1)
+        npt.assert_array_almost_equal(recs[0].bins, [1.0, 2.0])
+        del recs
+
+    def test_invalid(self):
+        with open(self.fname, 'wb') as f:
+            f.write(b'this is not a results file at all')
+        with self.assertRaises(tomographer.resultsfile.ResultsFileError):
+            tomographer.resultsfile.load(self.fname)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,68 @@
+
+import os
+import tempfile
+
+import numpy as np
+import numpy.testing as npt
+
+import tomographer.samplestream
+
+import unittest
+
+
+def _write_sample_stream(fname, task_ids, fnvals, values, value_bytes):
+    num_values = values.shape[1]
+    dtype = tomographer.samplestream.record_dtype(num_values, value_bytes)
+    with open(fname, 'wb') as f:
+        f.write(b'TOMOSMPL')
+        f.write(np.array([1, value_bytes], dtype=np.uint32).tobytes())
+        f.write(np.array([num_values, dtype.itemsize], dtype=np.uint64).tobytes())
+        recs = np.zeros((len(task_ids),), dtype=dtype)
+        recs['task_id'] = task_ids
+        recs['fnval'] = fnvals
+        recs['values'] = values
+        f.write(recs.tobytes())
+
+
+class SampleStreamTest(unittest.TestCase):
+
+    def setUp(self):
+        fd, self.fname = tempfile.mkstemp(suffix='.bin')
+        os.close(fd)
+
+    def tearDown(self):
+        os.remove(self.fname)
+
+    def test_load(self):
+        for value_bytes in (4, 8):
+            values = np.array([[1.0, 0.5, 0.25, 2.0], [0.0, -1.0, 3.0, 0.5], [4.0, 4.0, 4.0, 4.0]])
+            _write_sample_stream(self.fname, [0, 0, 1], [-1.5, -2.5, -3.5], values, value_bytes)
+
+            self.assertEqual(tomographer.samplestream.read_header(self.fname), (4, value_bytes))
+
+            d = tomographer.samplestream.load(self.fname)
+            self.assertEqual(len(d), 3)
+            npt.assert_array_equal(d['task_id'], [0, 0, 1])
+            npt.assert_array_almost_equal(d['fnval'], [-1.5, -2.5, -3.5])
+            npt.assert_array_almost_equal(d['values'], values)
+            del d # close the memory map
+
+    def test_incomplete_record(self):
+        values = np.array([[1.0, 2.0], [3.0, 4.0]])
+        _write_sample_stream(self.fname, [3, 4], [0.0, 0.0], values, 8)
+        with open(self.fname, 'ab') as f:
+            f.write(b'\x00' * 5)
+        d = tomographer.samplestream.load(self.fname)
+        self.assertEqual(len(d), 2)
+        npt.assert_array_equal(d['task_id'], [3, 4])
+        del d
+
+    def test_invalid(self):
+        with open(self.fname, 'wb') as f:
+            f.write(b'this is not a sample stream file at all')
+        with self.assertRaises(tomographer.samplestream.SampleStreamFileError):
+            tomographer.samplestream.load(self.fname)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -4,6 +4,7 @@ from __future__ import print_function
 
 #import sys
 import re
+import ctypes
 import numpy as np
 import numpy.linalg as npl
 import numpy.testing as npt
@@ -323,6 +324,111 @@ class test_tomorun(unittest.TestCase):
         self.assertGreaterEqual(glob.saw_parallel_runs, 2)
 
 
+    # signature of functions given to tomographer.tomorun.NativeFunction
+    NativeFnType = ctypes.CFUNCTYPE(ctypes.c_double, ctypes.POINTER(ctypes.c_double),
+                                    ctypes.c_int, ctypes.c_void_p)
+
+    @staticmethod
+    def _native_matrix(Mptr, dim):
+        # column-major, real & imaginary parts interleaved
+        return np.ctypeslib.as_array(Mptr, shape=(2*dim*dim,)).view(np.complex128).reshape((dim,dim), order='F')
+
+    def test_native_figofmerit(self):
+
+        print("test_native_figofmerit()")
+
+        # A ctypes callback is enough to test the interface, even if it won't run any
+        # faster than a Python callable (the callback acquires the GIL itself)
+        def purity(Tptr, dim, user_data):
+            T = self._native_matrix(Tptr, dim)
+            return npl.norm(np.dot(T,T.T.conj()))
+        purity_fn = self.NativeFnType(purity)
+
+        nfn = tomographer.tomorun.NativeFunction(purity_fn)
+        self.assertEqual(nfn.address, ctypes.cast(purity_fn, ctypes.c_void_p).value)
+
+        num_repeats = 2
+        hist_params = tomographer.HistogramParams(0.99, 1, 20)
+
+        r = tomographer.tomorun.tomorun(
+            dim=2,
+            Emn=self.Emn,
+            Nm=self.Nm,
+            fig_of_merit=nfn,
+            num_repeats=num_repeats,
+            mhrw_params=tomographer.MHRWParams(
+                step_size=0.04,
+                n_sweep=25,
+                n_run=8192,
+                n_therm=1024),
+            hist_params=hist_params,
+        )
+
+        print(r['final_report'])
+        # just make sure that less than 1% of points are out of [0.99,1]
+        self.assertLess(r['final_histogram'].off_chart, 0.01)
+
+    def test_native_llh(self):
+
+        print("test_native_llh()")
+
+        # the measurement data is passed as user_data
+        Nm = np.array(self.Nm, dtype=np.float64)
+        def llh(rhoptr, dim, user_data):
+            rho = self._native_matrix(rhoptr, dim)
+            Nmx = np.ctypeslib.as_array(ctypes.cast(user_data, ctypes.POINTER(ctypes.c_double)),
+                                        shape=(len(self.Emn),))
+            return sum( Nmx[k] * np.log(np.trace(np.dot(self.Emn[k], rho)).real)
+                        for k in range(len(self.Emn)) if Nmx[k] > 0 )
+        llh_fn = self.NativeFnType(llh)
+
+        num_repeats = 4
+        hist_params = tomographer.HistogramParams(0.985, 1, 50)
+
+        r = tomographer.tomorun.tomorun(
+            dim=2,
+            llh=tomographer.tomorun.NativeFunction(llh_fn, user_data=Nm),
+            fig_of_merit="fidelity",
+            ref_state=self.rho_ref,
+            num_repeats=num_repeats,
+            mhrw_params=tomographer.MHRWParams(
+                step_size=0.04,
+                n_sweep=25,
+                n_run=8192,
+                n_therm=512),
+            hist_params=hist_params,
+            ctrl_converged_params={'enabled': False},
+        )
+        print("Final report of everything :\n{}".format(r['final_report']))
+
+        # check the values against the analytical solution
+        pok = AnalyticalSolutionFn(np.sum(self.Nm))
+        self.assertLess(pok.get_histogram_chi2_red(r['final_histogram']), 5)
+
+    def test_native_invalid(self):
+
+        with self.assertRaises(tomographer.tomorun.TomorunInvalidInputError):
+            tomographer.tomorun.NativeFunction("not a function")
+
+        def llh(rhoptr, dim, user_data):
+            return 0.0
+        llh_fn = self.NativeFnType(llh)
+
+        # can't give both llh= and Emn=
+        with self.assertRaises(tomographer.tomorun.TomorunInvalidInputError):
+            tomographer.tomorun.tomorun(
+                dim=2,
+                llh=tomographer.tomorun.NativeFunction(llh_fn),
+                Emn=self.Emn,
+                Nm=self.Nm,
+                fig_of_merit="fidelity",
+                ref_state=self.rho_ref,
+                num_repeats=1,
+                mhrw_params=tomographer.MHRWParams(step_size=0.04, n_sweep=25, n_therm=128, n_run=128),
+                hist_params=tomographer.HistogramParams(),
+            )
+
+
     def test_verbose_logging(self):
 
         print("test_verbose_logging()")
@@ -819,6 +925,76 @@ class test_tomorun(unittest.TestCase):
         self.assertGreater(spread, 0.2)
 
 
+    def test_extra_fig_of_merit(self):
+
+        print("test_extra_fig_of_merit()")
+
+        num_repeats = 2
+        hist_params = tomographer.HistogramParams(0.985, 1, 20)
+
+        r = tomographer.tomorun.tomorun(
+            dim=2,
+            Emn=self.Emn,
+            Nm=self.Nm,
+            fig_of_merit="fidelity",
+            ref_state=self.rho_ref,
+            extra_fig_of_merit=[ ('purif-dist', self.rho_ref),
+                                 ('obs-value', np.array([[0, -1j], [1j, 0]])) ],
+            num_repeats=num_repeats,
+            mhrw_params=tomographer.MHRWParams(
+                step_size=0.04,
+                n_sweep=25,
+                n_run=4096,
+                n_therm=1024),
+            hist_params=hist_params,
+            rng_base_seed=12345,
+        )
+
+        extra_final_histograms = r['extra_final_histograms']
+        self.assertEqual(len(extra_final_histograms), 2)
+        for h in extra_final_histograms:
+            self.assertTrue(isinstance(h, tomographer.HistogramWithErrorBars))
+            self.assertGreater(np.sum(h.bins), 0)
+
+        # purified distance to +Y is small, and the expectation value of sigma_Y is close to one
+        self.assertLess(extra_final_histograms[0].params.max, 0.5)
+        self.assertGreater(extra_final_histograms[1].params.max, 0.9)
+
+        # without extra figures of merit, the list is empty
+        r = tomographer.tomorun.tomorun(
+            dim=2,
+            Emn=self.Emn,
+            Nm=self.Nm,
+            fig_of_merit="fidelity",
+            ref_state=self.rho_ref,
+            num_repeats=1,
+            mhrw_params=tomographer.MHRWParams(
+                step_size=0.04,
+                n_sweep=25,
+                n_run=1024,
+                n_therm=256),
+            hist_params=hist_params,
+        )
+        self.assertEqual(len(r['extra_final_histograms']), 0)
+
+        with self.assertRaises(tomographer.tomorun.TomorunInvalidInputError):
+            tomographer.tomorun.tomorun(
+                dim=2,
+                Emn=self.Emn,
+                Nm=self.Nm,
+                fig_of_merit="fidelity",
+                ref_state=self.rho_ref,
+                extra_fig_of_merit=[ ('no-such-figure', self.rho_ref) ],
+                num_repeats=1,
+                mhrw_params=tomographer.MHRWParams(
+                    step_size=0.04,
+                    n_sweep=25,
+                    n_run=1024,
+                    n_therm=256),
+                hist_params=hist_params,
+            )
+
+
     def test_chokes_on_extra_args(self):
 
         # just make sure that tomorun() raises an exception if unexpected arguments are
@@ -247,6 +247,46 @@ class Histograms(unittest.TestCase):
             h.record(2.981, cnttype(7))
             self.assertAlmostEqual(h.count(4), 58)
 
+        # record_many()
+        if not has_error_bars:
+            values = np.array([2.569, 2.981, 2.0, 3.0, 1.5, np.nan, 2.1999, 2.2])
+            h = HCl(2.0, 3.0, 5)
+            load_values_maybe_error_bars(h, np.array([10, 20, 30, 40, 50]), np.array([1, 2, 3, 4, 5]), 28)
+            bins = h.bins
+            h.record_many(values)
+            npt.assert_array_almost_equal(h.bins, np.array([12, 21, 31, 40, 51]))
+            self.assertAlmostEqual(h.off_chart, 31)
+            # bins were updated in place
+            self.assertTrue(bins is h.bins)
+            npt.assert_array_almost_equal(bins, np.array([12, 21, 31, 40, 51]))
+            # with weights, compare with record()
+            weights = np.array([1, 2, 3, 4, 5, 6, 7, 8], dtype=cnttype)
+            h1 = HCl(2.0, 3.0, 5)
+            h2 = HCl(2.0, 3.0, 5)
+            for v, w in zip(values, weights):
+                h1.record(v, w)
+            h2.record_many(values, weights)
+            npt.assert_array_almost_equal(h2.bins, h1.bins)
+            self.assertAlmostEqual(h2.off_chart, h1.off_chart)
+            # a single weight for all values
+            h2 = HCl(2.0, 3.0, 5)
+            h2.record_many(values, 2)
+            npt.assert_array_almost_equal(h2.bins, np.array([4, 2, 2, 0, 2]))
+            self.assertAlmostEqual(h2.off_chart, 6)
+            # many values, over several threads
+            np.random.seed(1)
+            values = np.random.uniform(1.9, 3.1, size=100000)
+            h1 = HCl(2.0, 3.0, 5)
+            h1.record_many(values, num_threads=4)
+            expected, _ = np.histogram(values, bins=5, range=(2.0, 3.0))
+            npt.assert_array_almost_equal(h1.bins, expected)
+            self.assertAlmostEqual(h1.off_chart, np.sum((values < 2.0) | (values >= 3.0)))
+            with self.assertRaises(Exception):
+                h1.record_many(values, np.ones(3))
+        else:
+            with self.assertRaises(Exception):
+                HCl(2.0, 3.0, 5).record_many(np.array([2.5]))
+
         # normalization(), normalized()
         h = HCl(2.0, 3.0, 5)
         load_values_maybe_error_bars(h, np.array([10, 20, 30, 40, 50]), np.array([1, 2, 3, 4, 5]), 28)
@@ -432,6 +472,46 @@ class Histograms(unittest.TestCase):
         npt.assert_array_almost_equal(avghist2.delta, avghist.delta)
         self.assertEqual(avghist2.num_histograms, avghist.num_histograms)
 
+    def test_Histogram2D(self):
+        p = tomographer.Histogram2DParams(tomographer.HistogramParams(0.0, 1.0, 4),
+                                          tomographer.HistogramParams(-1.0, 1.0, 2))
+        self.assertEqual(p.x.num_bins, 4)
+        self.assertEqual(p.y.num_bins, 2)
+        self.assertAlmostEqual(p.binArea(), 0.25)
+        self.assertTrue(p.isWithinBounds(0.5, 0.0))
+        self.assertFalse(p.isWithinBounds(0.5, 1.0))
+        self.assertEqual(p.binIndex(0.3, 0.5), (1, 1))
+
+        h = tomographer.Histogram2D(p)
+        self.assertFalse(h.has_error_bars)
+        self.assertEqual(h.bins.shape, (4, 2))
+        self.assertEqual(h.record(0.3, 0.5), (1, 1))
+        self.assertEqual(h.record(0.9, 0.99, 2), (3, 1))
+        self.assertIsNone(h.record(1.5, 0.0))
+        self.assertEqual(h.count(1, 1), 1)
+        self.assertEqual(h.count(3, 1), 2)
+        self.assertAlmostEqual(h.off_chart, 1)
+        self.assertAlmostEqual(h.totalCounts(), 4)
+        self.assertAlmostEqual(h.normalization(), 1 + 3*0.25)
+
+        try:
+            import cPickle as pickle
+        except ImportError:
+            import pickle
+        h2 = pickle.loads(pickle.dumps(h, 2))
+        self.assertEqual(h2.params.x.num_bins, 4)
+        npt.assert_array_almost_equal(h2.bins, h.bins)
+        self.assertAlmostEqual(h2.off_chart, h.off_chart)
+
+        he = tomographer.Histogram2DWithErrorBars(p)
+        self.assertTrue(he.has_error_bars)
+        he.load(np.ones((4, 2)), 0.1*np.ones((4, 2)), 2.0)
+        self.assertAlmostEqual(he.errorBar(2, 1), 0.1)
+        with self.assertRaises(ValueError):
+            he.load(np.ones((2, 4)), np.ones((2, 4)), 0.0)
+        he2 = pickle.loads(pickle.dumps(he, 2))
+        npt.assert_array_almost_equal(he2.delta, he.delta)
+
 
 
 
@@ -0,0 +1,352 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <cmath>
+
+#include <string>
+#include <sstream>
+#include <random>
+
+// include before <Eigen/*> !
+#include "test_tomographer.h"
+
+#include <tomographer/densedm/factoredmeasllh.h>
+#include <tomographer/densedm/indepmeasllh.h>
+#include <tomographer/densedm/param_herm_x.h>
+#include <tomographer/densedm/tspacellhwalker.h>
+#include <tomographer/mathtools/check_derivatives.h>
+#include <tomographer/tools/boost_test_logger.h>
+
+#include <boost/archive/text_oarchive.hpp>
+#include <boost/archive/text_iarchive.hpp>
+
+
+// -----------------------------------------------------------------------------
+// fixture(s)
+
+// compare the log-likelihood calculated by FactoredMeasLLH with the one of IndepMeasLLH,
+// for some random points T
+template<typename FactoredLLHType, typename IndepLLHType>
+void check_llh_agrees(const FactoredLLHType & fllh, const IndepLLHType & illh, int seed)
+{
+  typedef typename FactoredLLHType::DMTypes DMTypes;
+  const DMTypes dmt = fllh.dmt;
+  Tomographer::DenseDM::ParamX<DMTypes> px(dmt);
+
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> ndist;
+
+  for (int i = 0; i < 10; ++i) {
+    typename DMTypes::MatrixType T(dmt.initMatrixType());
+    for (Eigen::Index j = 0; j < T.rows(); ++j) {
+      for (Eigen::Index k = 0; k < T.cols(); ++k) {
+        T(j,k) = dmt.cplx(ndist(rng), ndist(rng));
+      }
+    }
+    T /= T.norm();
+
+    const typename DMTypes::MatrixType rho = T * T.adjoint();
+    const double llh_ref = illh.logLikelihoodX(px.HermToX(rho));
+
+    BOOST_CHECK_CLOSE(fllh.logLikelihoodT(T), llh_ref, 1e-8);
+    BOOST_CHECK_CLOSE(fllh.logLikelihoodRho(rho), llh_ref, 1e-8);
+  }
+}
+
+
+// check gradLogLikelihoodT() against finite differences, seeing T as the real vector of
+// the real and imaginary parts of its entries
+template<typename FactoredLLHType>
+void check_grad_t(const FactoredLLHType & fllh, int seed)
+{
+  typedef typename FactoredLLHType::DMTypes DMTypes;
+  typedef typename DMTypes::MatrixType MatrixType;
+  const DMTypes dmt = fllh.dmt;
+  const Eigen::Index d = (Eigen::Index)dmt.dim();
+
+  std::mt19937 rng(seed);
+  std::normal_distribution<double> ndist;
+
+  auto to_T = [d,dmt](const Eigen::Ref<const Eigen::VectorXd> & v) -> MatrixType {
+    MatrixType T(dmt.initMatrixType());
+    for (Eigen::Index j = 0; j < d*d; ++j) {
+      T(j % d, j / d) = dmt.cplx(v(2*j), v(2*j+1));
+    }
+    return T;
+  };
+
+  for (int i = 0; i < 3; ++i) {
+    Eigen::VectorXd v(2*d*d);
+    for (Eigen::Index j = 0; j < v.size(); ++j) {
+      v(j) = ndist(rng);
+    }
+    v /= v.norm();
+
+    const MatrixType G = fllh.gradLogLikelihoodT(to_T(v));
+    Eigen::ArrayXXd der(1, 2*d*d);
+    for (Eigen::Index j = 0; j < d*d; ++j) {
+      der(0, 2*j) = G(j % d, j / d).real();
+      der(0, 2*j+1) = G(j % d, j / d).imag();
+    }
+
+    std::stringstream stream;
+    bool ok = Tomographer::MathTools::check_derivatives(
+        der, v,
+        [&fllh,&to_T](Eigen::Ref<Eigen::VectorXd> val, const Eigen::Ref<const Eigen::VectorXd> & pt) {
+          val(0) = fllh.logLikelihoodT(to_T(pt));
+        },
+        1, 1e-7, 1e-2, stream);
+    BOOST_MESSAGE(stream.str()) ;
+    BOOST_CHECK(ok) ;
+  }
+}
+
+
+// -----------------------------------------------------------------------------
+// test suites
+
+
+BOOST_AUTO_TEST_SUITE(test_densedm_factoredmeasllh)
+
+BOOST_AUTO_TEST_CASE(qubit)
+{
+  typedef Tomographer::DenseDM::DMTypes<2> DMTypes;
+  DMTypes dmt;
+
+  typedef Tomographer::DenseDM::IndepMeasLLH<DMTypes> IndepMeasLLH;
+  IndepMeasLLH illh(dmt);
+  typedef Tomographer::DenseDM::FactoredMeasLLH<DMTypes> FactoredMeasLLH;
+  FactoredMeasLLH fllh(dmt);
+
+  TOMO_STATIC_ASSERT_EXPR((int)FactoredMeasLLH::LLHCalcType == (int)Tomographer::DenseDM::LLHCalcTypeT);
+
+  // Pauli measurements, and a non-projective effect
+  Tomographer::Tools::EigenStdVector<DMTypes::MatrixType>::type Emn(7);
+  Emn[0] << 0.5, 0.5, 0.5, 0.5;
+  Emn[1] << 0.5, -0.5, -0.5, 0.5;
+  Emn[2] << 0.5, dmt.cplx(0,-0.5), dmt.cplx(0,0.5), 0.5;
+  Emn[3] << 0.5, dmt.cplx(0,0.5), dmt.cplx(0,-0.5), 0.5;
+  Emn[4] << 1, 0, 0, 0;
+  Emn[5] << 0, 0, 0, 1;
+  Emn[6] << 0.7, 0.1, 0.1, 0.4;
+  Eigen::ArrayXi Nm(7);
+  Nm << 1500, 800, 300, 300, 10, 30, 0;
+  Nm(6) = 42;
+
+  for (std::size_t k = 0; k < Emn.size(); ++k) {
+    illh.addMeasEffect(Emn[k], Nm((Eigen::Index)k));
+    fllh.addMeasEffect(Emn[k], Nm((Eigen::Index)k));
+  }
+
+  BOOST_CHECK_EQUAL(fllh.numEffects(), 7);
+  for (Eigen::Index k = 0; k < 6; ++k) {
+    BOOST_CHECK_EQUAL(fllh.effectFactorRank(k), 1);
+  }
+  BOOST_CHECK_EQUAL(fllh.effectFactorRank(6), 2);
+  BOOST_CHECK_EQUAL(fllh.totalFactorRank(), 8);
+  for (Eigen::Index k = 0; k < 7; ++k) {
+    MY_BOOST_CHECK_EIGEN_EQUAL(fllh.effect(k), Emn[(std::size_t)k], tol);
+    BOOST_CHECK_EQUAL(fllh.Nx(k), Nm(k));
+  }
+
+  check_llh_agrees(fllh, illh, 1234);
+  check_grad_t(fllh, 1234);
+}
+
+BOOST_AUTO_TEST_CASE(w_state_complement)
+{
+  // 3-qubit W state; POVM {|W><W|, 1-|W><W|}
+  typedef Tomographer::DenseDM::DMTypes<Eigen::Dynamic> DMTypes;
+  DMTypes dmt(8);
+
+  DMTypes::MatrixType psiW(8, 1);
+  psiW.setZero();
+  psiW(1) = psiW(2) = psiW(4) = 1.0 / std::sqrt(3.0);
+  const DMTypes::MatrixType PW = psiW * psiW.adjoint();
+  const DMTypes::MatrixType PWc = DMTypes::MatrixType::Identity(8, 8) - PW;
+
+  typedef Tomographer::DenseDM::IndepMeasLLH<DMTypes> IndepMeasLLH;
+  IndepMeasLLH illh(dmt);
+  illh.addMeasEffect(PW, 430);
+  illh.addMeasEffect(PWc, 70);
+
+  typedef Tomographer::DenseDM::FactoredMeasLLH<DMTypes> FactoredMeasLLH;
+  FactoredMeasLLH fllh(dmt);
+  fllh.addMeasEffect(PW, 430);
+  fllh.addMeasEffect(PWc, 70);
+
+  BOOST_CHECK_EQUAL(fllh.numEffects(), 2);
+  BOOST_CHECK(!fllh.isComplementEffect(0));
+  BOOST_CHECK(fllh.isComplementEffect(1));
+  BOOST_CHECK_EQUAL(fllh.totalFactorRank(), 2);
+  MY_BOOST_CHECK_EIGEN_EQUAL(fllh.effect(0), PW, tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(fllh.effect(1), PWc, tol);
+
+  check_llh_agrees(fllh, illh, 5678);
+
+  // the same, specifying the factors directly
+  FactoredMeasLLH fllh2(dmt);
+  fllh2.addMeasEffectFactor(psiW, 430);
+  fllh2.addMeasEffectFactor(psiW, 70, true);
+  BOOST_CHECK_EQUAL(fllh2.totalFactorRank(), 2);
+
+  check_llh_agrees(fllh2, illh, 5678);
+  check_grad_t(fllh2, 5678);
+}
+
+BOOST_AUTO_TEST_CASE(invalid_effects)
+{
+  typedef Tomographer::DenseDM::DMTypes<2> DMTypes;
+  DMTypes dmt;
+  typedef Tomographer::DenseDM::FactoredMeasLLH<DMTypes> FactoredMeasLLH;
+  FactoredMeasLLH fllh(dmt);
+
+  DMTypes::MatrixType E;
+  E << 1, 0, 0, -0.5; // not positive semidefinite
+  BOOST_CHECK_THROW(fllh.addMeasEffect(E, 10), Tomographer::DenseDM::InvalidMeasData);
+  E << 1, 0.5, 0, 0; // not Hermitian
+  BOOST_CHECK_THROW(fllh.addMeasEffect(E, 10), Tomographer::DenseDM::InvalidMeasData);
+
+  FactoredMeasLLH::FactorType V(2, 1);
+  V << 1.5, 0; // 1 - V V' not positive semidefinite
+  BOOST_CHECK_THROW(fllh.addMeasEffectFactor(V, 10, true), Tomographer::DenseDM::InvalidMeasData);
+  V << 0, 0; // zero effect
+  BOOST_CHECK_THROW(fllh.addMeasEffectFactor(V, 10), Tomographer::DenseDM::InvalidMeasData);
+  // zero effect, as a complement
+  BOOST_CHECK_THROW(fllh.addMeasEffectFactor(FactoredMeasLLH::FactorType::Identity(2, 2), 10, true),
+                    Tomographer::DenseDM::InvalidMeasData);
+
+  BOOST_CHECK_EQUAL(fllh.numEffects(), 0);
+
+  // zero counts are ignored
+  V << 1, 0;
+  fllh.addMeasEffectFactor(V, 0);
+  BOOST_CHECK_EQUAL(fllh.numEffects(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(identity_effect)
+{
+  // the identity is stored as the complement of an empty factor
+  typedef Tomographer::DenseDM::DMTypes<2> DMTypes;
+  DMTypes dmt;
+
+  typedef Tomographer::DenseDM::IndepMeasLLH<DMTypes> IndepMeasLLH;
+  IndepMeasLLH illh(dmt);
+  typedef Tomographer::DenseDM::FactoredMeasLLH<DMTypes> FactoredMeasLLH;
+  FactoredMeasLLH fllh(dmt);
+
+  DMTypes::MatrixType E0;
+  E0 << 1, 0, 0, 0;
+  const DMTypes::MatrixType Id = DMTypes::MatrixType::Identity();
+
+  illh.addMeasEffect(E0, 20);
+  illh.addMeasEffect(Id, 15);
+  fllh.addMeasEffect(E0, 20);
+  fllh.addMeasEffect(Id, 15);
+
+  BOOST_CHECK_EQUAL(fllh.numEffects(), 2);
+  BOOST_CHECK(fllh.isComplementEffect(1));
+  BOOST_CHECK_EQUAL(fllh.effectFactorRank(1), 0);
+  BOOST_CHECK_EQUAL(fllh.totalFactorRank(), 1);
+  MY_BOOST_CHECK_EIGEN_EQUAL(fllh.effect(1), Id, tol);
+
+  check_llh_agrees(fllh, illh, 4321);
+  check_grad_t(fllh, 4321);
+
+  // the same, specifying the (empty) factor directly
+  FactoredMeasLLH fllh2(dmt);
+  fllh2.addMeasEffect(E0, 20);
+  fllh2.addMeasEffectFactor(FactoredMeasLLH::FactorType(2, 0), 15, true);
+  BOOST_CHECK_EQUAL(fllh2.numEffects(), 2);
+
+  check_llh_agrees(fllh2, illh, 4321);
+}
+
+BOOST_AUTO_TEST_CASE(llhmhwalker)
+{
+  typedef Tomographer::DenseDM::DMTypes<2> DMTypes;
+  DMTypes dmt;
+  typedef Tomographer::DenseDM::FactoredMeasLLH<DMTypes> DenseLLH;
+  DenseLLH llh(dmt);
+
+  DMTypes::MatrixType E;
+  E << 1, 0, 0, 0;
+  llh.addMeasEffect(E, 30);
+  E << 0, 0, 0, 1;
+  llh.addMeasEffect(E, 70);
+
+  typedef Tomographer::Logger::BoostTestLogger LoggerType;
+  LoggerType logger(Tomographer::Logger::DEBUG);
+  std::mt19937 rng(46570);
+
+  Tomographer::DenseDM::TSpace::LLHMHWalker<DenseLLH, std::mt19937, LoggerType>
+    dmmhrw(DMTypes::MatrixType::Zero(), llh, rng, logger);
+
+  DMTypes::MatrixType T;
+  T << 0.6, 0, 0, 0.8;
+  BOOST_CHECK_CLOSE(dmmhrw.fnLogVal(T), 30*std::log(0.36) + 70*std::log(0.64), tol_percent);
+}
+
+BOOST_AUTO_TEST_CASE(serialize)
+{
+  typedef Tomographer::DenseDM::DMTypes<Eigen::Dynamic> DMTypes;
+  DMTypes dmt(3);
+  typedef Tomographer::DenseDM::FactoredMeasLLH<DMTypes> FactoredMeasLLH;
+  FactoredMeasLLH * fllh = new FactoredMeasLLH(dmt);
+
+  FactoredMeasLLH::FactorType V(3, 2);
+  V << 1, 0,
+    0, dmt.cplx(0, std::sqrt(0.5)),
+    0, 0;
+  fllh->addMeasEffectFactor(V, 12);
+  fllh->addMeasEffectFactor(V.col(0), 34, true);
+
+  std::stringstream s;
+  {
+    boost::archive::text_oarchive oa(s);
+    oa << fllh;
+  }
+  FactoredMeasLLH * fllh2 = NULL;
+  {
+    boost::archive::text_iarchive ia(s);
+    ia >> fllh2;
+  }
+
+  BOOST_CHECK_EQUAL(fllh2->dmt.dim(), 3);
+  BOOST_CHECK_EQUAL(fllh2->numEffects(), 2);
+  BOOST_CHECK(!fllh2->isComplementEffect(0));
+  BOOST_CHECK(fllh2->isComplementEffect(1));
+  BOOST_CHECK_EQUAL(fllh2->Nx(1), 34);
+  MY_BOOST_CHECK_EIGEN_EQUAL(fllh2->effect(0), fllh->effect(0), tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(fllh2->effect(1), fllh->effect(1), tol);
+
+  delete fllh;
+  delete fllh2;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -38,6 +38,8 @@
 
 #include <tomographer/densedm/indepmeasllh.h>
 #include <tomographer/tools/eigenutil.h>
+#include <tomographer/mathtools/random_unitary.h>
+#include <tomographer/mathtools/check_derivatives.h>
 
 #include <boost/archive/text_oarchive.hpp>
 #include <boost/archive/text_iarchive.hpp>
@@ -46,6 +48,71 @@
 // -----------------------------------------------------------------------------
 // fixture(s)
 
+// POVM effects from projective measurements in many random bases, stored both in the
+// plain and in the padded layout
+template<typename DMTypes_>
+struct PaddedStorageFixture
+{
+  typedef DMTypes_ DMTypes;
+  typedef Tomographer::DenseDM::IndepMeasLLH<DMTypes> PlainLLH;
+  typedef Tomographer::DenseDM::IndepMeasLLH<DMTypes, double, int, Eigen::Dynamic, true, true> PaddedLLH;
+
+  DMTypes dmt;
+  typename PlainLLH::VectorParamListType Exn;
+  typename PlainLLH::FreqListType Nx;
+  PlainLLH plain;
+  PaddedLLH padded;
+
+  PaddedStorageFixture(Eigen::Index dim, int num_bases)
+    : dmt(dim), Exn(num_bases*dim, dmt.dim2()), Nx(num_bases*dim), plain(dmt), padded(dmt)
+  {
+    std::mt19937 rng(2468);
+    std::uniform_int_distribution<int> counts(1, 100);
+    Tomographer::DenseDM::ParamX<DMTypes> px(dmt);
+    typename DMTypes::MatrixType U(dmt.initMatrixType());
+    for (int b = 0; b < num_bases; ++b) {
+      Tomographer::MathTools::randomUnitary(U, rng);
+      for (Eigen::Index j = 0; j < dim; ++j) {
+        Exn.row(b*dim+j) = px.HermToX(U.col(j) * U.col(j).adjoint()).transpose();
+        Nx(b*dim+j) = counts(rng);
+      }
+    }
+    plain.setMeas(Exn, Nx);
+    padded.setMeas(Exn, Nx);
+  }
+
+  typename DMTypes::VectorParamType someState() const
+  {
+    // a full-rank state, so that all the log-likelihood terms are finite
+    typename DMTypes::MatrixType rho(dmt.initMatrixType());
+    rho.setZero();
+    for (Eigen::Index k = 0; k < dmt.dim(); ++k) {
+      rho(k,k) = 1.0 + k;
+    }
+    rho(1,0) = std::complex<double>(0.3, 0.2);
+    rho(0,1) = std::conj(rho(1,0));
+    rho /= rho.real().trace();
+    return Tomographer::DenseDM::ParamX<DMTypes>(dmt).HermToX(rho);
+  }
+
+  void checkSame()
+  {
+    BOOST_CHECK_EQUAL(padded.numEffects(), plain.numEffects());
+    BOOST_CHECK_EQUAL(padded.exnStorageCols() % PaddedLLH::ExnRowPadding, 0);
+    BOOST_CHECK(padded.exnStorageCols() >= dmt.dim2());
+    BOOST_CHECK_EQUAL(padded.Exn().rows(), plain.Exn().rows());
+    BOOST_CHECK_EQUAL(padded.Exn().cols(), dmt.dim2());
+    MY_BOOST_CHECK_EIGEN_EQUAL(padded.Exn(), plain.Exn(), tol);
+    MY_BOOST_CHECK_EIGEN_EQUAL(padded.Exn(3), plain.Exn(3), tol);
+    MY_BOOST_CHECK_EIGEN_EQUAL(padded.Nx(), plain.Nx(), tol);
+
+    const typename DMTypes::VectorParamType x = someState();
+    BOOST_CHECK_CLOSE(padded.logLikelihoodX(x), plain.logLikelihoodX(x), 1e-8);
+    MY_BOOST_CHECK_EIGEN_EQUAL(padded.gradLogLikelihoodX(x), plain.gradLogLikelihoodX(x),
+                               1e-8 * plain.gradLogLikelihoodX(x).norm());
+  }
+};
+
 
 // -----------------------------------------------------------------------------
 // test suites
@@ -116,6 +183,38 @@ BOOST_AUTO_TEST_CASE(basic_dyn)
   //std::cout << "llh @ mixed state = " << std::setprecision(15) << value << "\n";
 }
 
+BOOST_AUTO_TEST_CASE(set_meas_move)
+{
+  typedef Tomographer::DenseDM::DMTypes<Eigen::Dynamic> DMTypes;
+  DMTypes dmt(2);
+
+  typedef Tomographer::DenseDM::IndepMeasLLH<DMTypes> IndepMeasLLH;
+  IndepMeasLLH dat(dmt);
+
+  IndepMeasLLH::VectorParamListType Exn(6, dmt.dim2());
+  Exn <<
+    0.5, 0.5,  1./std::sqrt(2.0),  0,
+    0.5, 0.5, -1./std::sqrt(2.0),  0,
+    0.5, 0.5,  0,         1./std::sqrt(2.0),
+    0.5, 0.5,  0,        -1./std::sqrt(2.0),
+    1,   0,    0,         0,
+    0,   1,    0,         0
+    ;
+  IndepMeasLLH::FreqListType Nx(6);
+  Nx << 1500, 800, 300, 300, 10, 30;
+
+  const IndepMeasLLH::VectorParamListType Exn_copy(Exn);
+  dat.setMeas(std::move(Exn), std::move(Nx));
+
+  BOOST_CHECK_EQUAL(dat.numEffects(), 6);
+  MY_BOOST_CHECK_EIGEN_EQUAL(dat.Exn(), Exn_copy, tol);
+  BOOST_CHECK_EQUAL(dat.Nx(4), 10);
+
+  DMTypes::VectorParamType x(dmt.initVectorParamType());
+  x << 0.5, 0.5, 0, 0; // maximally mixed state
+  BOOST_CHECK_CLOSE(-2*dat.logLikelihoodX(x), 4075.70542169248, 1e-4);
+}
+
 BOOST_AUTO_TEST_CASE(reset_meas)
 {
   typedef Tomographer::DenseDM::DMTypes<2> DMTypes;
@@ -236,9 +335,136 @@ BOOST_AUTO_TEST_CASE(add_meas_checkmeas)
     auto call = [&Ebad,&dat]() { dat.addMeasEffect(Ebad, 500); };
     BOOST_CHECK_THROW(call(), Tomographer::DenseDM::InvalidMeasData);
   }
+
+  // rank-deficient effects, also with a tiny negative eigenvalue from rounding errors,
+  // are accepted
+  {
+    MatrixType Eok(dmt.initMatrixType());
+    Eok << 0.5, 0.5,
+           0.5, 0.5;
+    dat.addMeasEffect(Eok, 500);
+    Eok << -1e-14, 0,
+           0, 1;
+    dat.addMeasEffect(Eok, 500);
+    BOOST_CHECK_EQUAL(dat.numEffects(), 4);
+    dat.checkEffect(2);
+    dat.checkEffect(3);
+  }
   
 }
 
 
+BOOST_AUTO_TEST_CASE(grad)
+{
+  typedef Tomographer::DenseDM::DMTypes<2> DMTypes;
+  DMTypes dmt;
+
+  typedef Tomographer::DenseDM::IndepMeasLLH<DMTypes, double, int, Eigen::Dynamic, true> IndepMeasLLH;
+  IndepMeasLLH dat(dmt);
+
+  IndepMeasLLH::VectorParamListType Exn(6, dmt.dim2());
+  Exn <<
+    0.5, 0.5,  1./std::sqrt(2.0),  0,
+    0.5, 0.5, -1./std::sqrt(2.0),  0,
+    0.5, 0.5,  0,         1./std::sqrt(2.0),
+    0.5, 0.5,  0,        -1./std::sqrt(2.0),
+    1,   0,    0,         0,
+    0,   1,    0,         0
+    ;
+  IndepMeasLLH::FreqListType Nx(6);
+  Nx << 1500, 800, 300, 300, 10, 30;
+  dat.setMeas(Exn, Nx);
+  dat.setNMeasAmplifyFactor(2);
+
+  DMTypes::VectorParamType x(dmt.initVectorParamType());
+  x << 0.6, 0.4, 0.1, -0.05;
+
+  const DMTypes::VectorParamType g = dat.gradLogLikelihoodX(x);
+  BOOST_MESSAGE("gradient = " << g.transpose());
+
+  Eigen::ArrayXXd der(1, 4);
+  der.row(0) = g.transpose().array();
+  std::stringstream stream;
+  bool ok = Tomographer::MathTools::check_derivatives(
+      der, Eigen::VectorXd(x),
+      [&dat](Eigen::Ref<Eigen::VectorXd> val, const Eigen::Ref<const Eigen::VectorXd> & pt) {
+        val(0) = dat.logLikelihoodX(pt);
+      },
+      1, 1e-7, 1e-2, stream);
+  BOOST_MESSAGE(stream.str()) ;
+  BOOST_CHECK(ok) ;
+}
+
+
+
+
+BOOST_AUTO_TEST_SUITE(padded_storage)
+
+BOOST_AUTO_TEST_CASE(qutrit_dyn)
+{
+  PaddedStorageFixture<Tomographer::DenseDM::DMTypes<Eigen::Dynamic> > f(3, 20);
+  f.checkSame();
+}
+
+BOOST_AUTO_TEST_CASE(qutrit_fixed)
+{
+  PaddedStorageFixture<Tomographer::DenseDM::DMTypes<3> > f(3, 20);
+  f.checkSame();
+}
+
+BOOST_AUTO_TEST_CASE(dim6_many_tiles)
+{
+  // enough POVM effects to span several tiles
+  PaddedStorageFixture<Tomographer::DenseDM::DMTypes<Eigen::Dynamic> > f(6, 2000);
+  f.checkSame();
+}
+
+BOOST_AUTO_TEST_CASE(set_meas_move_and_add)
+{
+  PaddedStorageFixture<Tomographer::DenseDM::DMTypes<Eigen::Dynamic> > f(3, 4);
+
+  decltype(f)::PlainLLH::VectorParamListType Exn(f.Exn);
+  decltype(f)::PlainLLH::FreqListType Nx(f.Nx);
+  f.padded.resetMeas();
+  BOOST_CHECK_EQUAL(f.padded.numEffects(), 0);
+  f.padded.setMeas(std::move(Exn), std::move(Nx));
+  f.checkSame();
+
+  // add the effects one by one, the padding must be zero
+  f.padded.resetMeas();
+  for (Eigen::Index i = 0; i < f.Exn.rows(); ++i) {
+    f.padded.addMeasEffect(f.Exn.row(i).transpose(), f.Nx(i));
+  }
+  f.checkSame();
+
+  // an additional effect with a zero count is ignored
+  f.padded.addMeasEffect(f.Exn.row(0).transpose(), 0);
+  BOOST_CHECK_EQUAL(f.padded.numEffects(), f.plain.numEffects());
+}
+
+BOOST_AUTO_TEST_CASE(serialize)
+{
+  PaddedStorageFixture<Tomographer::DenseDM::DMTypes<Eigen::Dynamic> > f(3, 5);
+
+  std::stringstream stream;
+  {
+    boost::archive::text_oarchive oa(stream);
+    const decltype(f.padded) * p = &f.padded;
+    oa << p;
+  }
+  decltype(f.padded) * p2 = NULL;
+  {
+    boost::archive::text_iarchive ia(stream);
+    ia >> p2;
+  }
+  BOOST_REQUIRE(p2 != NULL);
+  MY_BOOST_CHECK_EIGEN_EQUAL(p2->Exn(), f.plain.Exn(), tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(p2->Nx(), f.plain.Nx(), tol);
+  BOOST_CHECK_EQUAL(p2->exnStorageCols(), f.padded.exnStorageCols());
+  delete p2;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -55,6 +55,12 @@ struct TestParamsFixture
     rhoback1 = px.XToHerm(x);
     //std::cout << " --> and back to rho = \n" << rhoback1 << "\n";
     BOOST_CHECK_SMALL((rho - rhoback1).norm(), tol);
+    // same from the real and imaginary parts, written into a row of a matrix
+    Eigen::Matrix<typename DMTypes::RealScalar, 2, Eigen::Dynamic> xrows(2, dmt.dim2());
+    xrows.setZero();
+    px.splitHermToX(xrows.row(1), rho.real(), rho.imag());
+    BOOST_CHECK_SMALL((xrows.row(1).transpose() - x).norm(), tol);
+    BOOST_CHECK_SMALL(xrows.row(0).norm(), tol);
   }
 
   void test_param_a(DMTypes dmt, const typename DMTypes::MatrixType & rho)
@@ -0,0 +1,206 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+
+#include <string>
+#include <random>
+
+// include before <Eigen/*> !
+#include "test_tomographer.h"
+
+#include <tomographer/densedm/povmvalidation.h>
+#include <tomographer/densedm/indepmeasllh.h>
+#include <tomographer/mathtools/random_unitary.h>
+
+
+// -----------------------------------------------------------------------------
+// fixture(s)
+
+template<int Dim>
+struct RandomBasesLLHFixture
+{
+  typedef Tomographer::DenseDM::DMTypes<Dim> DMTypes;
+  typedef Tomographer::DenseDM::IndepMeasLLH<DMTypes> IndepMeasLLH;
+
+  DMTypes dmt;
+  IndepMeasLLH llh;
+  Tomographer::DenseDM::POVMCompletenessChecker<DMTypes> completeness;
+
+  // measure in num_settings random bases, each basis vector was observed once
+  RandomBasesLLHFixture(int num_settings)
+    : dmt(Dim), llh(dmt), completeness(dmt)
+  {
+    std::mt19937 rng(4321); // seeded, deterministic random number generator
+    typename DMTypes::MatrixType U(dmt.initMatrixType());
+    for (int s = 0; s < num_settings; ++s) {
+      Tomographer::MathTools::randomUnitary(U, rng);
+      for (int k = 0; k < Dim; ++k) {
+        typename DMTypes::MatrixType E(dmt.initMatrixType());
+        E = U.col(k) * U.col(k).adjoint();
+        llh.addMeasEffect(E, 1, false);
+        completeness.addEffect(s, E);
+      }
+    }
+  }
+};
+
+
+// -----------------------------------------------------------------------------
+// test suites
+
+
+BOOST_AUTO_TEST_SUITE(test_densedm_povmvalidation)
+
+BOOST_AUTO_TEST_SUITE(check_all_meas_parallel)
+
+BOOST_AUTO_TEST_CASE(valid)
+{
+  RandomBasesLLHFixture<3> f(200);
+  BOOST_CHECK_EQUAL(f.llh.numEffects(), 600);
+
+  Tomographer::DenseDM::checkAllMeasParallel(f.llh, 4, 16);
+  Tomographer::DenseDM::checkAllMeasParallel(f.llh, 1);
+  Tomographer::DenseDM::checkAllMeasParallel(f.llh); // hardware concurrency
+  Tomographer::DenseDM::checkAllMeasParallel(f.llh, 64, 1000); // single chunk
+}
+
+BOOST_AUTO_TEST_CASE(empty)
+{
+  Tomographer::DenseDM::DMTypes<2> dmt;
+  Tomographer::DenseDM::IndepMeasLLH<Tomographer::DenseDM::DMTypes<2> > llh(dmt);
+  Tomographer::DenseDM::checkAllMeasParallel(llh, 4);
+}
+
+BOOST_AUTO_TEST_CASE(invalid)
+{
+  typedef RandomBasesLLHFixture<2>::DMTypes DMTypes;
+  RandomBasesLLHFixture<2> f(300);
+
+  // replace effects #123 and #457 by non-positive ones
+  typename DMTypes::MatrixType Ebad(f.dmt.initMatrixType());
+  Ebad << 1, 0,
+          0, -0.1;
+  Tomographer::DenseDM::ParamX<DMTypes> px(f.dmt);
+  typename RandomBasesLLHFixture<2>::IndepMeasLLH::VectorParamListType Exn = f.llh.Exn();
+  Exn.row(123) = px.HermToX(Ebad).transpose();
+  Exn.row(457) = px.HermToX(Ebad).transpose();
+  f.llh.setMeas(Exn, f.llh.Nx(), false);
+
+  for (int num_threads = 1; num_threads <= 8; num_threads *= 2) {
+    BOOST_MESSAGE("num_threads = " << num_threads);
+    try {
+      Tomographer::DenseDM::checkAllMeasParallel(f.llh, num_threads, 8);
+      BOOST_CHECK(false && "expected exception was not thrown");
+    } catch (const Tomographer::DenseDM::InvalidMeasData & e) {
+      BOOST_MESSAGE("Got exception: " << e.what());
+      // effect #123 is found first, whatever the order in which the chunks are checked
+      BOOST_CHECK_EQUAL(std::string(e.what()).substr(0, 17), std::string("POVM effect #123:"));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END() // check_all_meas_parallel
+
+BOOST_AUTO_TEST_SUITE(povm_completeness_checker)
+
+BOOST_AUTO_TEST_CASE(complete)
+{
+  RandomBasesLLHFixture<4> f(10);
+  BOOST_CHECK_EQUAL(f.completeness.numSettings(), 10u);
+  f.completeness.check();
+}
+
+BOOST_AUTO_TEST_CASE(split_re_im)
+{
+  typedef Tomographer::DenseDM::DMTypes<Eigen::Dynamic> DMTypes;
+  DMTypes dmt(2);
+  Tomographer::DenseDM::POVMCompletenessChecker<DMTypes> completeness(dmt);
+
+  // Pauli Y measurement, given as single-precision real and imaginary parts
+  Eigen::Matrix2f re, im;
+  re << 0.5f, 0,
+        0, 0.5f;
+  im << 0, -0.5f,
+        0.5f, 0;
+  completeness.addEffect(7, re, im);
+  completeness.addEffect(7, re, (-im).eval());
+  // Pauli Z measurement
+  DMTypes::MatrixType E(dmt.initMatrixType());
+  E << 1, 0,
+       0, 0;
+  completeness.addEffect(-2, E);
+  E << 0, 0,
+       0, 1;
+  completeness.addEffect(-2, E);
+
+  BOOST_CHECK_EQUAL(completeness.numSettings(), 2u);
+  completeness.check();
+}
+
+BOOST_AUTO_TEST_CASE(incomplete)
+{
+  typedef Tomographer::DenseDM::DMTypes<2> DMTypes;
+  DMTypes dmt;
+  Tomographer::DenseDM::POVMCompletenessChecker<DMTypes> completeness(dmt);
+
+  DMTypes::MatrixType E(dmt.initMatrixType());
+  E << 1, 0,
+       0, 0;
+  completeness.addEffect(1, E);
+  completeness.addEffect(2, E);
+  E << 0, 0,
+       0, 1;
+  completeness.addEffect(1, E);
+  // setting 2 misses an effect
+  BOOST_CHECK_THROW(completeness.check(), Tomographer::DenseDM::InvalidMeasData);
+}
+
+BOOST_AUTO_TEST_CASE(tolerance)
+{
+  typedef Tomographer::DenseDM::DMTypes<2> DMTypes;
+  DMTypes dmt;
+  Tomographer::DenseDM::POVMCompletenessChecker<DMTypes> strict(dmt, 1e-6);
+  Tomographer::DenseDM::POVMCompletenessChecker<DMTypes> loose(dmt, 1e-3);
+
+  DMTypes::MatrixType E(dmt.initMatrixType());
+  E << 1, 0,
+       0, 0;
+  strict.addEffect(0, E);
+  loose.addEffect(0, E);
+  E << 0, 0,
+       0, 1.0001;
+  strict.addEffect(0, E);
+  loose.addEffect(0, E);
+
+  BOOST_CHECK_THROW(strict.check(), Tomographer::DenseDM::InvalidMeasData);
+  loose.check();
+}
+
+BOOST_AUTO_TEST_SUITE_END() // povm_completeness_checker
+
+BOOST_AUTO_TEST_SUITE_END()
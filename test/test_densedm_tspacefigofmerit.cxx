@@ -37,6 +37,7 @@
 #include "test_tomographer.h"
 
 #include <tomographer/densedm/tspacefigofmerit.h>
+#include <tomographer/densedm/tspacepointcache.h>
 
 
 
@@ -228,6 +229,151 @@ BOOST_FIXTURE_TEST_CASE(ObservableValueCalculator_4_f, distmeasures_qudit4_fixtu
 
 
 
+// -----------------
+
+
+BOOST_FIXTURE_TEST_CASE(MultipleFiguresOfMeritCalculator_2_d, distmeasures_qubit_fixture<double>)
+{
+  typedef DMTypes::ComplexScalar Cplx;
+  MatrixType A;
+  A <<
+    Cplx( 6.528329762670850e-01, + 0.000000000000000e+00),    Cplx(-2.828700628152467e-02, - 4.752282889738084e-01),
+    Cplx(-2.828700628152467e-02, + 4.752282889738084e-01),    Cplx( 3.471670237329149e-01, + 0.000000000000000e+00) ;
+
+  Tomographer::DenseDM::TSpace::MultipleFiguresOfMeritCalculator<DMTypes, double> f;
+  BOOST_CHECK_EQUAL(f.addFidelityToRef(T1), 0);
+  BOOST_CHECK_EQUAL(f.addTrDistToRef(rho3), 1);
+  BOOST_CHECK_EQUAL(f.addObservable(A), 2);
+  BOOST_CHECK_EQUAL(f.addPurifDistToRef(T1), 3);
+  BOOST_CHECK_EQUAL(f.addFidelityToRef(T4), 4);
+  BOOST_CHECK_EQUAL(f.numValues(), 5);
+  BOOST_CHECK_EQUAL(f.kind(3), (f.PurifDistToRef));
+
+  Tomographer::DenseDM::TSpace::FidelityToRefCalculator<DMTypes, double> f_fid1(T1);
+  Tomographer::DenseDM::TSpace::TrDistToRefCalculator<DMTypes, double> f_tr3(rho3);
+  Tomographer::DenseDM::TSpace::ObservableValueCalculator<DMTypes> f_obs(dmt, A);
+  Tomographer::DenseDM::TSpace::PurifDistToRefCalculator<DMTypes, double> f_pd1(T1);
+  Tomographer::DenseDM::TSpace::FidelityToRefCalculator<DMTypes, double> f_fid4(T4);
+
+  Eigen::ArrayXd values(5);
+  for (const MatrixType * T : { &T1, &T2, &T2b, &T3, &T4, &T5, &T6 }) {
+    f.getValues(*T, values);
+    BOOST_MESSAGE("values = " << values.transpose());
+    MY_BOOST_CHECK_FLOATS_EQUAL(values(0), f_fid1.getValue(*T), tol);
+    MY_BOOST_CHECK_FLOATS_EQUAL(values(1), f_tr3.getValue(*T), tol);
+    MY_BOOST_CHECK_FLOATS_EQUAL(values(2), f_obs.getValue(*T), tol);
+    MY_BOOST_CHECK_FLOATS_EQUAL(values(3), f_pd1.getValue(*T), tol);
+    MY_BOOST_CHECK_FLOATS_EQUAL(values(4), f_fid4.getValue(*T), tol);
+  }
+}
+BOOST_FIXTURE_TEST_CASE(MultipleFiguresOfMeritCalculator_4_f, distmeasures_qudit4_fixture<float>)
+{
+  Tomographer::DenseDM::TSpace::MultipleFiguresOfMeritCalculator<DMTypes, float> f;
+  f.addPurifDistToRef(T1);
+  f.addTrDistToRef(rho1);
+  f.addObservable(rho1);
+
+  Eigen::ArrayXf values(3);
+  f.getValues(T2, values);
+  MY_BOOST_CHECK_FLOATS_EQUAL(values(0),
+                              (Tomographer::DenseDM::TSpace::PurifDistToRefCalculator<DMTypes, float>(T1).getValue(T2)),
+                              tol_f);
+  MY_BOOST_CHECK_FLOATS_EQUAL(values(1),
+                              (Tomographer::DenseDM::TSpace::TrDistToRefCalculator<DMTypes, float>(rho1).getValue(T2)),
+                              tol_f);
+  MY_BOOST_CHECK_FLOATS_EQUAL(values(2), (rho1*rho2).real().trace(), 32*tol_f);
+}
+
+
+// -----------------
+
+
+BOOST_FIXTURE_TEST_CASE(ObservableValueCalculator_lowrank, distmeasures_qudit4_fixture<double>)
+{
+  // rank-2 observable, with a negative eigenvalue
+  typedef DMTypes::ComplexScalar Cplx;
+  Eigen::Matrix<Cplx,4,1> u1, u2;
+  u1 << Cplx(0.5,0), Cplx(0,0.5), Cplx(-0.5,0), Cplx(0.5,0);
+  u2 << Cplx(0,0), Cplx(1,0), Cplx(0,0), Cplx(0,0);
+  MatrixType A = 2.0*u1*u1.adjoint() - 0.5*u2*u2.adjoint();
+
+  Tomographer::DenseDM::TSpace::ObservableValueCalculator<DMTypes> f(dmt, A);
+  MY_BOOST_CHECK_FLOATS_EQUAL(f.getValue(T1), (A*rho1).real().trace(), tol);
+  MY_BOOST_CHECK_FLOATS_EQUAL(f.getValue(T2), (A*rho2).real().trace(), tol);
+
+  Tomographer::DenseDM::TSpace::ObservableValueCalculator<DMTypes> fzero(dmt, MatrixType::Zero());
+  MY_BOOST_CHECK_FLOATS_EQUAL(fzero.getValue(T1), 0.0, tol);
+}
+
+BOOST_FIXTURE_TEST_CASE(point_cache, distmeasures_qudit4_fixture<double>)
+{
+  typedef Tomographer::DenseDM::TSpace::DensePointCache<DMTypes> PointCacheType;
+
+  PointCacheType cache(T2);
+  BOOST_CHECK(!cache.hasRho());
+  BOOST_CHECK(!cache.hasX());
+  MY_BOOST_CHECK_EIGEN_EQUAL(cache.T(), T2, tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(cache.rho(), rho2, tol);
+  BOOST_CHECK(cache.hasRho());
+  MY_BOOST_CHECK_EIGEN_EQUAL(cache.x(), Tomographer::DenseDM::ParamX<DMTypes>(dmt).HermToX(rho2), tol);
+  BOOST_CHECK(cache.hasX());
+  Eigen::SelfAdjointEigenSolver<MatrixType> eig(rho2);
+  MY_BOOST_CHECK_EIGEN_EQUAL(cache.rhoEigenvalues(), eig.eigenvalues(), tol);
+
+  cache.setT(T1);
+  BOOST_CHECK(!cache.hasRho());
+  BOOST_CHECK(!cache.hasX());
+  MY_BOOST_CHECK_EIGEN_EQUAL(cache.rho(), rho1, tol);
+
+  PointCacheType other(T2);
+  swap(cache, other);
+  MY_BOOST_CHECK_EIGEN_EQUAL(cache.T(), T2, tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(other.T(), T1, tol);
+  BOOST_CHECK(!cache.hasRho());
+  BOOST_CHECK(other.hasRho());
+  MY_BOOST_CHECK_EIGEN_EQUAL(other.rho(), rho1, tol);
+}
+
+BOOST_FIXTURE_TEST_CASE(calculators_with_point_cache, distmeasures_qudit4_fixture<double>)
+{
+  typedef Tomographer::DenseDM::TSpace::DensePointCache<DMTypes> PointCacheType;
+
+  Tomographer::DenseDM::TSpace::FidelityToRefCalculator<DMTypes, double> f_fid(T1);
+  Tomographer::DenseDM::TSpace::PurifDistToRefCalculator<DMTypes, double> f_pd(T1);
+  Tomographer::DenseDM::TSpace::TrDistToRefCalculator<DMTypes, double> f_tr(rho1);
+  Tomographer::DenseDM::TSpace::ObservableValueCalculator<DMTypes> f_obs(dmt, rho1);
+
+  PointCacheType cache(T2);
+  MY_BOOST_CHECK_FLOATS_EQUAL(f_fid.getValue(cache), f_fid.getValue(T2), tol);
+  MY_BOOST_CHECK_FLOATS_EQUAL(f_pd.getValue(cache), f_pd.getValue(T2), tol);
+  // observable value directly from T, the density matrix hasn't been calculated yet
+  BOOST_CHECK(!cache.hasRho());
+  MY_BOOST_CHECK_FLOATS_EQUAL(f_obs.getValue(cache), (rho1*rho2).real().trace(), tol);
+  BOOST_CHECK(!cache.hasRho());
+  MY_BOOST_CHECK_FLOATS_EQUAL(f_tr.getValue(cache), f_tr.getValue(T2), tol);
+  BOOST_CHECK(cache.hasRho());
+  // now it's a dot product with the X parameterization
+  MY_BOOST_CHECK_FLOATS_EQUAL(f_obs.getValue(cache), (rho1*rho2).real().trace(), tol);
+  BOOST_CHECK(cache.hasX());
+
+  Tomographer::DenseDM::TSpace::MultipleFiguresOfMeritCalculator<DMTypes, double> f;
+  f.addFidelityToRef(T1);
+  f.addTrDistToRef(rho1);
+  f.addObservable(rho1);
+  Eigen::ArrayXd values(3), values_cache(3);
+  f.getValues(T2, values);
+  f.getValues(PointCacheType(T2), values_cache);
+  MY_BOOST_CHECK_EIGEN_EQUAL(values_cache, values, tol);
+
+  Tomographer::DenseDM::TSpace::RhoParamXCalculator<DMTypes, double> f_x(dmt);
+  Eigen::ArrayXd x(dmt.dim2()), x_cache(dmt.dim2());
+  f_x.getValues(T2, x);
+  f_x.getValues(PointCacheType(T2), x_cache);
+  MY_BOOST_CHECK_EIGEN_EQUAL(x_cache, x, tol);
+}
+
+
+
 
 
 
@@ -0,0 +1,353 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+
+#include <string>
+#include <sstream>
+#include <random>
+
+#include <boost/math/constants/constants.hpp>
+
+// include before <Eigen/*> !
+#include "test_tomographer.h"
+
+#include <tomographer/densedm/tspacellhadaptivewalker.h>
+
+#include <unsupported/Eigen/MatrixFunctions>
+
+#include <tomographer/densedm/param_herm_x.h>
+#include <tomographer/densedm/indepmeasllh.h>
+#include <tomographer/densedm/tspacellhwalker.h>
+#include <tomographer/densedm/tspacefigofmerit.h>
+#include <tomographer/mhrw.h>
+#include <tomographer/mhrwstatscollectors.h>
+#include <tomographer/mhrwadaptivecovariancecontroller.h>
+
+#include <tomographer/tools/boost_test_logger.h>
+
+
+// -----------------------------------------------------------------------------
+// fixture(s)
+
+struct tspacellhadaptivewalker_fixture
+{
+  typedef Tomographer::DenseDM::DMTypes<2> DMTypes;
+  typedef Tomographer::DenseDM::IndepMeasLLH<DMTypes> DenseLLH;
+
+  DMTypes dmt;
+  DenseLLH llh;
+
+  DMTypes::MatrixType rho;
+  DMTypes::MatrixType T;
+
+  tspacellhadaptivewalker_fixture()
+    : dmt(), llh(dmt), rho(dmt.initMatrixType()), T(dmt.initMatrixType())
+  {
+    const double SQRT22 = boost::math::constants::half_root_two<double>();
+
+    // many more measurements in the X basis than in the Y and Z bases: the likelihood is
+    // much narrower in one direction than in the others
+    DenseLLH::VectorParamListType Exn(6, dmt.dim2());
+    Exn <<
+      0.5, 0.5,  SQRT22,  0,
+      0.5, 0.5, -SQRT22,  0,
+      0.5, 0.5,  0,       SQRT22,
+      0.5, 0.5,  0,      -SQRT22,
+      1,   0,    0,       0,
+      0,   1,    0,       0
+      ;
+    DenseLLH::FreqListType Nx(6);
+    Nx << 1500, 800, 30, 30, 10, 12;
+
+    llh.setMeas(Exn, Nx, false);
+
+    rho << 0.6, dmt.cplx(0.1,0.1),
+      dmt.cplx(0.1,-0.1), 0.4;
+    T = rho.sqrt();
+  }
+};
+
+// collects the average value of an observable
+template<typename ValueCalculator>
+struct AverageValueStatsCollector
+{
+  const ValueCalculator & vcalc;
+  double sum;
+  int num_samples;
+
+  AverageValueStatsCollector(const ValueCalculator & vcalc_) : vcalc(vcalc_), sum(0), num_samples(0) { }
+
+  void init() { }
+  void thermalizingDone() { }
+  void done() { }
+
+  template<typename... Args>
+  void rawMove(Args && ...) { }
+
+  template<typename CountIntType, typename PointType, typename FnValueType, typename MHRandomWalk>
+  void processSample(CountIntType, CountIntType, const PointType & curpt, FnValueType, MHRandomWalk &)
+  {
+    sum += vcalc.getValue(curpt);
+    ++num_samples;
+  }
+
+  double average() const { return sum / num_samples; }
+};
+
+// checks that the walker parameters don't change during the live runs
+template<typename WalkerParams>
+struct FixedWalkerParamsStatsCollector
+{
+  WalkerParams first_params;
+  bool has_first_params;
+  bool params_changed;
+
+  FixedWalkerParamsStatsCollector() : first_params(), has_first_params(false), params_changed(false) { }
+
+  void init() { }
+  void thermalizingDone() { }
+  void done() { }
+
+  template<typename... Args>
+  void rawMove(Args && ...) { }
+
+  template<typename CountIntType, typename PointType, typename FnValueType, typename MHRandomWalk>
+  void processSample(CountIntType, CountIntType, const PointType &, FnValueType, MHRandomWalk & rw)
+  {
+    if (!has_first_params) {
+      first_params = rw.mhWalkerParams();
+      has_first_params = true;
+    } else if (rw.mhWalkerParams().step_size != first_params.step_size ||
+               rw.mhWalkerParams().cov_factor != first_params.cov_factor) {
+      params_changed = true;
+    }
+  }
+};
+
+// a walker whose proposed jumps are all rejected, so that the visited points have a
+// vanishing covariance
+struct AlwaysRejectedMHWalker
+{
+  typedef Eigen::Vector2d PointType;
+  typedef double FnValueType;
+  typedef Tomographer::MHWalkerParamsCovariance<double> WalkerParams;
+  enum { UseFnSyntaxType = Tomographer::MHUseFnLogValue };
+
+  void init() { }
+  PointType startPoint() { return PointType::Zero(); }
+  void thermalizingDone() { }
+  void done() { }
+
+  PointType jumpFn(const PointType & curpt, const WalkerParams & params)
+  {
+    return curpt + PointType::Constant(params.step_size);
+  }
+  double fnLogVal(const PointType & pt) const
+  {
+    return pt.isZero() ? 0 : -std::numeric_limits<double>::infinity();
+  }
+  Eigen::Vector2d proposalCoordinates(const PointType & pt) const { return pt; }
+};
+
+// reports a fixed, acceptable moving average acceptance ratio, so that only the
+// adaptive covariance part of the controller can hold up thermalization
+struct FixedAcceptanceRatioStatsCollector
+{
+  void init() { }
+  void thermalizingDone() { }
+  void done() { }
+  template<typename... Args>
+  void rawMove(Args && ...) { }
+  template<typename... Args>
+  void processSample(Args && ...) { }
+
+  bool hasMovingAverageAcceptanceRatio() const { return true; }
+  double movingAverageAcceptanceRatio() const { return 0.27; }
+  int bufferSize() const { return 64; }
+};
+
+
+// -----------------------------------------------------------------------------
+// test suites
+
+
+BOOST_AUTO_TEST_SUITE(test_densedm_tspacellhadaptivewalker)
+// =============================================================================
+
+BOOST_FIXTURE_TEST_CASE(jumps, tspacellhadaptivewalker_fixture)
+{
+  typedef Tomographer::Logger::BoostTestLogger LoggerType;
+  LoggerType logger(Tomographer::Logger::DEBUG);
+
+  std::mt19937 rng(46570); // seeded rng, deterministic results
+
+  typedef Tomographer::DenseDM::TSpace::LLHAdaptiveMHWalker<DenseLLH, std::mt19937, LoggerType> MHWalkerType;
+  MHWalkerType mhwalker(DMTypes::MatrixType::Zero(), llh, rng, logger);
+
+  mhwalker.init();
+
+  const Tomographer::DenseDM::ParamX<DMTypes> px(dmt);
+  const DMTypes::VectorParamType x = px.HermToX(rho);
+  MY_BOOST_CHECK_EIGEN_EQUAL(mhwalker.proposalCoordinates(T), x, tol);
+  BOOST_CHECK_CLOSE(mhwalker.fnLogVal(T), llh.logLikelihoodX(x), tol_percent);
+
+  // jumps with a given shape: the displacements in X-space follow it, except along the
+  // trace, which is kept fixed
+  MHWalkerType::WalkerParams params(1e-3, Eigen::MatrixXd::Zero(4,4));
+  params.cov_factor.diagonal() << 1, 1, 3, 0.1;
+
+  const int N = 5000;
+  Eigen::Array4d sumsq = Eigen::Array4d::Zero();
+  for (int k = 0; k < N; ++k) {
+    const DMTypes::MatrixType newT = mhwalker.jumpFn(T, params);
+    BOOST_CHECK_EQUAL(mhwalker.jumpLogProposalRatio(), 0);
+    // the new point is the Cholesky factor of the new density matrix
+    BOOST_CHECK_SMALL(std::abs(newT(0,1)), tol);
+    BOOST_CHECK_CLOSE(newT.norm(), 1.0, 1e-8);
+    const DMTypes::VectorParamType dx = mhwalker.proposalCoordinates(newT) - x;
+    BOOST_CHECK_SMALL(dx(0) + dx(1), 1e-12);
+    sumsq += dx.array().square();
+  }
+  const Eigen::Array4d var = sumsq / N / (1e-3*1e-3);
+  BOOST_MESSAGE("Variances of the jumps = " << var.transpose());
+  BOOST_CHECK_CLOSE(var(0), 0.5, 10);
+  BOOST_CHECK_CLOSE(var(2), 9, 10);
+  BOOST_CHECK_CLOSE(var(3), 0.01, 10);
+
+  // huge jumps mostly end up outside of the state space, and are then rejected
+  int num_outside = 0;
+  for (int k = 0; k < 100; ++k) {
+    const DMTypes::MatrixType newT = mhwalker.jumpFn(T, MHWalkerType::WalkerParams(10));
+    if (mhwalker.jumpLogProposalRatio() == -std::numeric_limits<double>::infinity()) {
+      MY_BOOST_CHECK_EIGEN_EQUAL(newT, T, tol);
+      ++num_outside;
+    }
+  }
+  BOOST_CHECK_GT(num_outside, 90);
+
+  mhwalker.done();
+}
+
+BOOST_FIXTURE_TEST_CASE(random_walk, tspacellhadaptivewalker_fixture)
+{
+  Tomographer::Logger::BoostTestLogger logger(Tomographer::Logger::DEBUG);
+
+  typedef Tomographer::DenseDM::TSpace::ObservableValueCalculator<DMTypes> ValueCalculator;
+  DMTypes::MatrixType Y(dmt.initMatrixType());
+  Y << 0, dmt.cplx(0,-1), dmt.cplx(0,1), 0;
+  const ValueCalculator vcalc(dmt, Y);
+
+  // reference: the usual random walk
+  double ref_avg;
+  {
+    Tomographer::Logger::VacuumLogger vlogger;
+    std::mt19937 rng(1);
+    typedef Tomographer::DenseDM::TSpace::LLHMHWalkerLight<DenseLLH, std::mt19937, Tomographer::Logger::VacuumLogger>
+      MHWalkerType;
+    MHWalkerType mhwalker(DMTypes::MatrixType::Zero(), llh, rng, vlogger);
+    typedef AverageValueStatsCollector<ValueCalculator> StatsCollector;
+    StatsCollector stats(vcalc);
+    Tomographer::MHRWNoController ctrl;
+    Tomographer::MHRandomWalk<std::mt19937, MHWalkerType, StatsCollector, Tomographer::MHRWNoController,
+                              Tomographer::Logger::VacuumLogger>
+      rwalk(0.02, 50, 500, 40000, mhwalker, stats, ctrl, rng, vlogger);
+    rwalk.run();
+    ref_avg = stats.average();
+    BOOST_MESSAGE("Reference average = " << ref_avg << ", accept ratio = " << rwalk.acceptanceRatio());
+  }
+
+  std::mt19937 rng(2);
+  typedef Tomographer::DenseDM::TSpace::LLHAdaptiveMHWalker<DenseLLH, std::mt19937, Tomographer::Logger::BoostTestLogger>
+    MHWalkerType;
+  MHWalkerType mhwalker(DMTypes::MatrixType::Zero(), llh, rng, logger);
+
+  typedef Tomographer::MHRWMovingAverageAcceptanceRatioStatsCollector<> MovAvgStatsCollector;
+  MovAvgStatsCollector movavg_accept_stats(256);
+  AverageValueStatsCollector<ValueCalculator> avgstats(vcalc);
+  FixedWalkerParamsStatsCollector<MHWalkerType::WalkerParams> paramstats;
+  auto stats = Tomographer::mkMultipleMHRWStatsCollectors(movavg_accept_stats, avgstats, paramstats);
+
+  typedef Tomographer::MHRWParams<MHWalkerType::WalkerParams, int> MHRWParamsType;
+  auto ctrl = Tomographer::mkMHRWAdaptiveCovarianceController<MHRWParamsType>(movavg_accept_stats, logger);
+
+  typedef Tomographer::MHRandomWalk<std::mt19937, MHWalkerType, decltype(stats), decltype(ctrl),
+                                    Tomographer::Logger::BoostTestLogger>
+    MHRandomWalkType;
+  TOMO_STATIC_ASSERT_EXPR(MHRandomWalkType::HasPointCache) ;
+
+  MHRandomWalkType rwalk(MHRWParamsType(0.01, 20, 2000, 20000), mhwalker, stats, ctrl, rng, logger);
+  rwalk.run();
+
+  const auto p = rwalk.mhrwParams();
+  BOOST_MESSAGE("Final params = " << p << ", accept ratio = " << rwalk.acceptanceRatio()
+                << "\ncov_factor = \n" << p.mhwalker_params.cov_factor);
+  BOOST_MESSAGE("Adaptive average = " << avgstats.average());
+
+  BOOST_CHECK_GT(ctrl.numCovarianceUpdates(), 1);
+  BOOST_CHECK(!ctrl.isAdapting());
+  BOOST_CHECK(paramstats.has_first_params);
+  BOOST_CHECK(!paramstats.params_changed);
+  BOOST_CHECK_SMALL(avgstats.average() - ref_avg, 0.01);
+
+  // the learned covariance has (almost) no component along the trace, and is strongly
+  // anisotropic
+  BOOST_REQUIRE_EQUAL(p.mhwalker_params.cov_factor.rows(), 4);
+  const Eigen::MatrixXd cov = p.mhwalker_params.cov_factor * p.mhwalker_params.cov_factor.transpose();
+  Eigen::Vector4d trdir;
+  trdir << 1, 1, 0, 0;
+  BOOST_CHECK_SMALL(trdir.dot(cov * trdir) / 2, 1e-2);
+  BOOST_CHECK_GT(cov(3,3) / cov(2,2), 3);
+}
+
+
+BOOST_AUTO_TEST_CASE(always_rejected)
+{
+  Tomographer::Logger::BoostTestLogger logger(Tomographer::Logger::DEBUG);
+
+  std::mt19937 rng(3);
+  AlwaysRejectedMHWalker mhwalker;
+  FixedAcceptanceRatioStatsCollector stats;
+
+  typedef Tomographer::MHRWParams<AlwaysRejectedMHWalker::WalkerParams, int> MHRWParamsType;
+  auto ctrl = Tomographer::mkMHRWAdaptiveCovarianceController<MHRWParamsType>(stats, logger, 64);
+
+  Tomographer::MHRandomWalk<std::mt19937, AlwaysRejectedMHWalker, FixedAcceptanceRatioStatsCollector,
+                            decltype(ctrl), Tomographer::Logger::BoostTestLogger>
+    rwalk(MHRWParamsType(0.01, 10, 100, 100), mhwalker, stats, ctrl, rng, logger);
+  rwalk.run(); // must not hang
+
+  BOOST_CHECK_EQUAL(rwalk.acceptanceRatio(), 0);
+  BOOST_CHECK_EQUAL(ctrl.numCovarianceUpdates(), 0);
+  BOOST_CHECK(!ctrl.isAdapting());
+  // fell back to isotropic jumps
+  BOOST_CHECK_EQUAL(rwalk.mhrwParams().mhwalker_params.cov_factor.size(), 0);
+}
+
+
+// =============================================================================
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,288 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+
+#include <string>
+#include <sstream>
+#include <random>
+
+#include <boost/math/constants/constants.hpp>
+
+// include before <Eigen/*> !
+#include "test_tomographer.h"
+
+#include <tomographer/densedm/tspacellhhmcwalker.h>
+
+#include <unsupported/Eigen/MatrixFunctions>
+
+#include <tomographer/densedm/param_herm_x.h>
+#include <tomographer/densedm/indepmeasllh.h>
+#include <tomographer/densedm/tspacellhwalker.h>
+#include <tomographer/densedm/tspacefigofmerit.h>
+#include <tomographer/mathtools/check_derivatives.h>
+#include <tomographer/mhrw.h>
+#include <tomographer/mhrwstatscollectors.h>
+#include <tomographer/mhrwhmcstepsizecontroller.h>
+
+#include <tomographer/tools/boost_test_logger.h>
+
+
+// -----------------------------------------------------------------------------
+// fixture(s)
+
+struct tspacellhhmcwalker_fixture
+{
+  typedef Tomographer::DenseDM::DMTypes<2> DMTypes;
+  typedef Tomographer::DenseDM::IndepMeasLLH<DMTypes> DenseLLH;
+
+  DMTypes dmt;
+  DenseLLH llh;
+
+  DMTypes::MatrixType rho;
+  DMTypes::MatrixType T;
+
+  tspacellhhmcwalker_fixture()
+    : dmt(), llh(dmt), rho(dmt.initMatrixType()), T(dmt.initMatrixType())
+  {
+    const double SQRT22 = boost::math::constants::half_root_two<double>();
+
+    DenseLLH::VectorParamListType Exn(6, dmt.dim2());
+    Exn <<
+      0.5, 0.5,  SQRT22,  0,
+      0.5, 0.5, -SQRT22,  0,
+      0.5, 0.5,  0,       SQRT22,
+      0.5, 0.5,  0,      -SQRT22,
+      1,   0,    0,       0,
+      0,   1,    0,       0
+      ;
+    DenseLLH::FreqListType Nx(6);
+    Nx << 1500, 800, 300, 300, 10, 30;
+
+    llh.setMeas(Exn, Nx, false);
+
+    rho << 0.8, dmt.cplx(0,0.1),
+      dmt.cplx(0,-0.1), 0.2;
+    T = rho.sqrt();
+  }
+};
+
+// collects the average value of an observable
+template<typename ValueCalculator>
+struct AverageValueStatsCollector
+{
+  const ValueCalculator & vcalc;
+  double sum;
+  int num_samples;
+
+  AverageValueStatsCollector(const ValueCalculator & vcalc_) : vcalc(vcalc_), sum(0), num_samples(0) { }
+
+  void init() { }
+  void thermalizingDone() { }
+  void done() { }
+
+  template<typename... Args>
+  void rawMove(Args && ...) { }
+
+  template<typename CountIntType, typename PointType, typename FnValueType, typename MHRandomWalk>
+  void processSample(CountIntType, CountIntType, const PointType & curpt, FnValueType, MHRandomWalk &)
+  {
+    sum += vcalc.getValue(curpt);
+    ++num_samples;
+  }
+
+  double average() const { return sum / num_samples; }
+};
+
+
+// -----------------------------------------------------------------------------
+// test suites
+
+
+BOOST_AUTO_TEST_SUITE(test_densedm_tspacellhhmcwalker)
+// =============================================================================
+
+BOOST_FIXTURE_TEST_CASE(gradient, tspacellhhmcwalker_fixture)
+{
+  // the gradient with respect to T (seen as the real vector of the real and imaginary
+  // parts of its entries), calculated from the gradient of the IndepMeasLLH
+  const Tomographer::DenseDM::TSpace::tomo_internal::DenseLLHInvoker<DenseLLH> invoker(llh);
+
+  auto to_T = [this](const Eigen::Ref<const Eigen::VectorXd> & v) -> DMTypes::MatrixType {
+    DMTypes::MatrixType T2(dmt.initMatrixType());
+    for (Eigen::Index j = 0; j < 4; ++j) {
+      T2(j % 2, j / 2) = dmt.cplx(v(2*j), v(2*j+1));
+    }
+    return T2;
+  };
+
+  Eigen::VectorXd v(8);
+  for (Eigen::Index j = 0; j < 4; ++j) {
+    v(2*j) = T(j % 2, j / 2).real();
+    v(2*j+1) = T(j % 2, j / 2).imag();
+  }
+  MY_BOOST_CHECK_EIGEN_EQUAL(to_T(v), T, tol);
+
+  const DMTypes::MatrixType G = invoker.gradLogVal(T);
+  Eigen::ArrayXXd der(1, 8);
+  for (Eigen::Index j = 0; j < 4; ++j) {
+    der(0, 2*j) = G(j % 2, j / 2).real();
+    der(0, 2*j+1) = G(j % 2, j / 2).imag();
+  }
+
+  std::stringstream stream;
+  bool ok = Tomographer::MathTools::check_derivatives(
+      der, v,
+      [&invoker,&to_T](Eigen::Ref<Eigen::VectorXd> val, const Eigen::Ref<const Eigen::VectorXd> & pt) {
+        val(0) = invoker.fnLogVal(to_T(pt));
+      },
+      1, 1e-7, 1e-2, stream);
+  BOOST_MESSAGE(stream.str()) ;
+  BOOST_CHECK(ok) ;
+}
+
+BOOST_FIXTURE_TEST_CASE(jumps, tspacellhhmcwalker_fixture)
+{
+  typedef Tomographer::Logger::BoostTestLogger LoggerType;
+  LoggerType logger(Tomographer::Logger::DEBUG);
+
+  std::mt19937 rng(46570); // seeded rng, deterministic results
+
+  typedef Tomographer::DenseDM::TSpace::LLHHMCWalker<DenseLLH, std::mt19937, LoggerType> MHWalkerType;
+  MHWalkerType hmcwalker(DMTypes::MatrixType::Zero(), llh, rng, logger);
+
+  hmcwalker.init();
+
+  const DMTypes::MatrixType Tconst(T); // make sure that fnlogval() accepts const argument
+  BOOST_CHECK_CLOSE(hmcwalker.fnLogVal(Tconst),
+                    llh.logLikelihoodX(Tomographer::DenseDM::ParamX<DMTypes>(dmt).HermToX(rho)),
+                    tol_percent);
+
+  for (int k = 0; k < 100; ++k) {
+    // the proposal stays on the sphere, and for small steps the Hamiltonian is conserved
+    const DMTypes::MatrixType newT = hmcwalker.jumpFn(T, MHWalkerType::WalkerParams(1e-4, 20));
+    BOOST_CHECK_CLOSE(newT.norm(), 1.0, 1e-8);
+    const double dH = (hmcwalker.fnLogVal(newT) - hmcwalker.fnLogVal(T)) + hmcwalker.jumpLogProposalRatio();
+    BOOST_CHECK_SMALL(dH, 1e-3);
+  }
+
+  // the trajectory is determined by the random momentum: two walkers with the same rng
+  // state propose the same point
+  std::mt19937 rng2(1234);
+  std::mt19937 rng3(1234);
+  MHWalkerType hmcwalker2(DMTypes::MatrixType::Zero(), llh, rng2, logger);
+  MHWalkerType hmcwalker3(DMTypes::MatrixType::Zero(), llh, rng3, logger);
+  const DMTypes::MatrixType T2 = hmcwalker2.jumpFn(T, MHWalkerType::WalkerParams(0.05, 10));
+  const DMTypes::MatrixType T3 = hmcwalker3.jumpFn(T, MHWalkerType::WalkerParams(0.05, 10));
+  MY_BOOST_CHECK_EIGEN_EQUAL(T2, T3, tol);
+  BOOST_CHECK_CLOSE(hmcwalker2.jumpLogProposalRatio(), hmcwalker3.jumpLogProposalRatio(), tol_percent);
+
+  hmcwalker.done();
+}
+
+BOOST_FIXTURE_TEST_CASE(random_walk, tspacellhhmcwalker_fixture)
+{
+  Tomographer::Logger::VacuumLogger logger;
+
+  typedef Tomographer::DenseDM::TSpace::ObservableValueCalculator<DMTypes> ValueCalculator;
+  DMTypes::MatrixType Z(dmt.initMatrixType());
+  Z << 1, 0, 0, -1;
+  const ValueCalculator vcalc(dmt, Z);
+  typedef AverageValueStatsCollector<ValueCalculator> StatsCollector;
+
+  // reference: the usual random walk
+  double ref_avg;
+  {
+    std::mt19937 rng(1);
+    typedef Tomographer::DenseDM::TSpace::LLHMHWalkerLight<DenseLLH, std::mt19937, Tomographer::Logger::VacuumLogger>
+      MHWalkerType;
+    MHWalkerType mhwalker(DMTypes::MatrixType::Zero(), llh, rng, logger);
+    StatsCollector stats(vcalc);
+    Tomographer::MHRWNoController ctrl;
+    Tomographer::MHRandomWalk<std::mt19937, MHWalkerType, StatsCollector, Tomographer::MHRWNoController,
+                              Tomographer::Logger::VacuumLogger>
+      rwalk(0.04, 30, 500, 40000, mhwalker, stats, ctrl, rng, logger);
+    rwalk.run();
+    ref_avg = stats.average();
+    BOOST_MESSAGE("Reference average = " << ref_avg << ", accept ratio = " << rwalk.acceptanceRatio());
+  }
+
+  std::mt19937 rng(2);
+  typedef Tomographer::DenseDM::TSpace::LLHHMCWalker<DenseLLH, std::mt19937, Tomographer::Logger::VacuumLogger>
+    MHWalkerType;
+  MHWalkerType hmcwalker(DMTypes::MatrixType::Zero(), llh, rng, logger);
+  StatsCollector stats(vcalc);
+  Tomographer::MHRWNoController ctrl;
+  typedef Tomographer::MHRandomWalk<std::mt19937, MHWalkerType, StatsCollector, Tomographer::MHRWNoController,
+                                    Tomographer::Logger::VacuumLogger>
+    MHRandomWalkType;
+  TOMO_STATIC_ASSERT_EXPR(MHRandomWalkType::HasJumpLogProposalRatio) ;
+  TOMO_STATIC_ASSERT_EXPR(MHRandomWalkType::HasPointCache) ;
+
+  // one trajectory per sample: successive samples are nearly independent
+  MHRandomWalkType rwalk(MHWalkerType::WalkerParams(0.01, 30), 1, 500, 20000, hmcwalker, stats, ctrl, rng, logger);
+  rwalk.run();
+
+  BOOST_MESSAGE("HMC average = " << stats.average() << ", accept ratio = " << rwalk.acceptanceRatio());
+  BOOST_CHECK_GT(rwalk.acceptanceRatio(), 0.6);
+  BOOST_CHECK_SMALL(stats.average() - ref_avg, 0.005);
+}
+
+BOOST_FIXTURE_TEST_CASE(controlled_random_walk, tspacellhhmcwalker_fixture)
+{
+  Tomographer::Logger::BoostTestLogger logger(Tomographer::Logger::DEBUG);
+
+  std::mt19937 rng(3);
+  typedef Tomographer::DenseDM::TSpace::LLHHMCWalker<DenseLLH, std::mt19937, Tomographer::Logger::BoostTestLogger>
+    MHWalkerType;
+  MHWalkerType hmcwalker(DMTypes::MatrixType::Zero(), llh, rng, logger);
+
+  typedef Tomographer::MHRWMovingAverageAcceptanceRatioStatsCollector<> MovAvgStatsCollector;
+  MovAvgStatsCollector movavg_accept_stats(256);
+
+  typedef Tomographer::MHRWParams<MHWalkerType::WalkerParams, int> MHRWParamsType;
+  auto ctrl = Tomographer::mkMHRWHMCStepSizeController<MHRWParamsType>(movavg_accept_stats, logger);
+
+  // start with a step size which is much too large
+  Tomographer::MHRandomWalk<std::mt19937, MHWalkerType, MovAvgStatsCollector, decltype(ctrl),
+                            Tomographer::Logger::BoostTestLogger>
+    rwalk(MHRWParamsType(MHWalkerType::WalkerParams(0.2, 2), 1, 2048, 2048),
+          hmcwalker, movavg_accept_stats, ctrl, rng, logger);
+  rwalk.run();
+
+  const auto p = rwalk.mhrwParams();
+  BOOST_MESSAGE("Final params = " << p << ", accept ratio = " << rwalk.acceptanceRatio());
+  BOOST_CHECK_LT(p.mhwalker_params.step_size, 0.2);
+  // trajectory length is preserved
+  BOOST_CHECK_CLOSE(p.mhwalker_params.step_size * p.mhwalker_params.num_leapfrog_steps, 0.4, 10);
+  BOOST_CHECK_GT(rwalk.acceptanceRatio(), Tomographer::MHRWHMCStepSizeControllerDefaults::AcceptableAcceptanceRatioMin);
+}
+
+
+
+// =============================================================================
+BOOST_AUTO_TEST_SUITE_END()
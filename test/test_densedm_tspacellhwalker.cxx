@@ -43,6 +43,9 @@
 #include <tomographer/densedm/param_herm_x.h>
 #include <tomographer/densedm/densellh.h>
 #include <tomographer/densedm/indepmeasllh.h>
+#include <tomographer/densedm/tspacefigofmerit.h>
+#include <tomographer/mhrw.h>
+#include <tomographer/valuecalculator.h>
 
 #include <tomographer/tools/boost_test_logger.h>
 
@@ -50,6 +53,47 @@
 // -----------------------------------------------------------------------------
 // fixture(s)
 
+// checks that the random walk's point cache is always that of the current point
+template<typename ValueCalculator>
+struct CheckPointCacheStatsCollector
+{
+  const ValueCalculator & vcalc;
+  int num_checked;
+
+  CheckPointCacheStatsCollector(const ValueCalculator & vcalc_) : vcalc(vcalc_), num_checked(0) { }
+
+  void init() { }
+  void thermalizingDone() { }
+  void done() { }
+
+  template<typename CountIntType, typename PointType, typename FnValueType, typename MHRandomWalk>
+  void rawMove(CountIntType, bool, bool, bool, double, const PointType &, FnValueType,
+               const PointType & curpt, FnValueType curptval, MHRandomWalk & rw)
+  {
+    _check(curpt, curptval, rw);
+  }
+  template<typename CountIntType, typename PointType, typename FnValueType, typename MHRandomWalk>
+  void processSample(CountIntType, CountIntType, const PointType & curpt, FnValueType curptval,
+                     MHRandomWalk & rw)
+  {
+    _check(curpt, curptval, rw);
+    MY_BOOST_CHECK_FLOATS_EQUAL(Tomographer::getValueAtCurrentPoint(vcalc, curpt, rw),
+                                vcalc.getValue(curpt), tol);
+  }
+
+private:
+  template<typename PointType, typename FnValueType, typename MHRandomWalk>
+  void _check(const PointType & curpt, FnValueType curptval, MHRandomWalk & rw)
+  {
+    BOOST_CHECK(rw.getCurrentPointCache().T() == curpt);
+    if (rw.getCurrentPointCache().hasRho()) {
+      MY_BOOST_CHECK_EIGEN_EQUAL(rw.getCurrentPointCache().rho(), curpt*curpt.adjoint(), tol);
+    }
+    BOOST_CHECK_EQUAL(curptval, rw.getCurrentPointValue());
+    ++num_checked;
+  }
+};
+
 
 // -----------------------------------------------------------------------------
 // test suites
@@ -203,6 +247,115 @@ BOOST_AUTO_TEST_CASE(tspacellhmhwalkerlight)
 
 
 
+BOOST_AUTO_TEST_CASE(tspacellhmhwalkerlight_dyn)
+{
+  // dynamic dimension, so that several elementary rotations are applied for each jump
+  typedef Tomographer::DenseDM::DMTypes<Eigen::Dynamic> DMTypes;
+  DMTypes dmt(4);
+
+  typedef Tomographer::DenseDM::IndepMeasLLH<DMTypes> DenseLLH;
+  DenseLLH llh(dmt);
+
+  Tomographer::Logger::VacuumLogger logger;
+  std::mt19937 rng(1234); // seeded rng, deterministic results
+
+  Tomographer::DenseDM::TSpace::LLHMHWalkerLight<DenseLLH, std::mt19937, Tomographer::Logger::VacuumLogger>
+    dmmhrw(DMTypes::MatrixType::Zero(4,4), llh, rng, logger);
+
+  dmmhrw.init();
+  const DMTypes::MatrixType T = dmmhrw.startPoint();
+  BOOST_CHECK_CLOSE(T.norm(), 1.0, tol_percent);
+
+  // all entries of T should move, and the jumps should be symmetric around T
+  DMTypes::MatrixType sumT(dmt.initMatrixType());
+  Eigen::ArrayXXi num_moved = Eigen::ArrayXXi::Zero(4, 4);
+  const int N_SAMPLES = 10000;
+  for (int n = 0; n < N_SAMPLES; ++n) {
+    DMTypes::MatrixType newT = dmmhrw.jumpFn(T, 0.2);
+    BOOST_CHECK_CLOSE(newT.norm(), 1.0, tol_percent);
+    num_moved += ((newT - T).array().abs() > 1e-8).cast<int>();
+    sumT += newT;
+  }
+  sumT /= sumT.norm();
+  MY_BOOST_CHECK_EIGEN_EQUAL(sumT, T, 1.0/std::sqrt((double)N_SAMPLES));
+  BOOST_MESSAGE("num_moved = \n" << num_moved);
+  // each entry is rotated with probability ~ 1-(7/8)^4 ~ 41%
+  BOOST_CHECK( (num_moved > N_SAMPLES/3).all() ) ;
+  BOOST_CHECK( (num_moved < N_SAMPLES/2).all() ) ;
+
+  dmmhrw.done();
+}
+
+
+
+BOOST_AUTO_TEST_CASE(tspacellhmhwalker_pointcache)
+{
+  typedef Tomographer::DenseDM::DMTypes<2> DMTypes;
+  DMTypes dmt;
+
+  typedef Tomographer::DenseDM::IndepMeasLLH<DMTypes> DenseLLH;
+  DenseLLH llh(dmt);
+
+  const double SQRT22 = boost::math::constants::half_root_two<double>();
+
+  DenseLLH::VectorParamListType Exn(6, dmt.dim2());
+  Exn <<
+    0.5, 0.5,  SQRT22,  0,
+    0.5, 0.5, -SQRT22,  0,
+    0.5, 0.5,  0,       SQRT22,
+    0.5, 0.5,  0,      -SQRT22,
+    1,   0,    0,       0,
+    0,   1,    0,       0
+    ;
+  DenseLLH::FreqListType Nx(6);
+  Nx << 1500, 800, 300, 300, 10, 30;
+
+  llh.setMeas(Exn, Nx, false);
+
+  Tomographer::Logger::VacuumLogger logger;
+  std::mt19937 rng(46570); // seeded rng, deterministic results
+
+  typedef Tomographer::DenseDM::TSpace::LLHMHWalkerLight<DenseLLH, std::mt19937, Tomographer::Logger::VacuumLogger>
+    MHWalkerType;
+  MHWalkerType dmmhrw(DMTypes::MatrixType::Zero(), llh, rng, logger);
+
+  DMTypes::MatrixType rho(dmt.initMatrixType());
+  rho << 0.8, dmt.cplx(0,0.1),
+    dmt.cplx(0,-0.1), 0.2;
+  DMTypes::MatrixType T(dmt.initMatrixType());
+  T = rho.sqrt();
+
+  MHWalkerType::PointCacheType cache;
+  BOOST_CHECK_CLOSE(dmmhrw.fnLogVal(T, cache), dmmhrw.fnLogVal(T), tol_percent);
+  MY_BOOST_CHECK_EIGEN_EQUAL(cache.T(), T, tol);
+  BOOST_CHECK(cache.hasX()); // IndepMeasLLH calculates the X parameterization
+  MY_BOOST_CHECK_EIGEN_EQUAL(cache.x(), Tomographer::DenseDM::ParamX<DMTypes>(dmt).HermToX(rho), tol);
+
+  // now run a random walk, and check that the point cache follows the current point
+  typedef Tomographer::DenseDM::TSpace::ObservableValueCalculator<DMTypes> ValueCalculator;
+  const ValueCalculator vcalc(dmt, rho);
+  typedef CheckPointCacheStatsCollector<ValueCalculator> StatsCollector;
+  StatsCollector stats(vcalc);
+
+  typedef Tomographer::MHRandomWalk<std::mt19937, MHWalkerType, StatsCollector,
+                                    Tomographer::MHRWNoController, Tomographer::Logger::VacuumLogger>
+    MHRandomWalkType;
+  TOMO_STATIC_ASSERT_EXPR(MHRandomWalkType::HasPointCache) ;
+  TOMO_STATIC_ASSERT_EXPR(Tomographer::UsesPointCache<ValueCalculator, MHRandomWalkType>::value) ;
+
+  Tomographer::MHRWNoController ctrl;
+  MHRandomWalkType rwalk(0.1, 5, 20, 50, dmmhrw, stats, ctrl, rng, logger);
+  rwalk.run();
+
+  BOOST_CHECK_EQUAL(stats.num_checked, 5*20 + 5*50 + 50);
+
+  rwalk.setCurrentPoint(T);
+  MY_BOOST_CHECK_EIGEN_EQUAL(rwalk.getCurrentPointCache().T(), T, tol);
+  BOOST_CHECK_CLOSE(rwalk.getCurrentPointValue(), dmmhrw.fnLogVal(T), tol_percent);
+}
+
+
+
 // =============================================================================
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -711,6 +711,207 @@ BOOST_AUTO_TEST_SUITE_END()
 
 // -----------------------------------------------------------------------------
 
+BOOST_AUTO_TEST_SUITE(adaptive_range);
+
+BOOST_AUTO_TEST_CASE(freeze)
+{
+  typedef Tomographer::HistogramAdaptiveRange<double> AdaptiveRange;
+  const AdaptiveRange::Params fallback(0.0, 1.0, 8);
+
+  std::vector<double> values;
+  values.push_back(0.95);
+  values.push_back(0.93);
+  values.push_back(0.97);
+
+  AdaptiveRange r(128);
+  BOOST_CHECK(r.enabled());
+  BOOST_CHECK(!AdaptiveRange().enabled());
+
+  AdaptiveRange::Params p = r.freeze(values, fallback);
+  BOOST_MESSAGE("frozen params: [" << p.min << "," << p.max << "[ / " << p.num_bins);
+  BOOST_CHECK_EQUAL(p.num_bins, 8);
+  // bin width is a power of two, and the limits lie on the corresponding grid
+  const double w = p.binResolution();
+  MY_BOOST_CHECK_FLOATS_EQUAL(w, 1.0/64, tol);
+  MY_BOOST_CHECK_FLOATS_EQUAL(p.min, 58*w, tol);
+  MY_BOOST_CHECK_FLOATS_EQUAL(p.max, 66*w, tol);
+  BOOST_CHECK(p.isWithinBounds(0.93) && p.isWithinBounds(0.97));
+
+  // with an upper bound, the range is shifted down
+  AdaptiveRange r2(128, 0, 0.0, 1.0);
+  AdaptiveRange::Params p2 = r2.freeze(values, fallback);
+  BOOST_CHECK_EQUAL(p2.num_bins, 8);
+  MY_BOOST_CHECK_FLOATS_EQUAL(p2.min, 0.875, tol);
+  MY_BOOST_CHECK_FLOATS_EQUAL(p2.max, 1.0, tol);
+
+  // no pilot values -> fallback
+  AdaptiveRange::Params p3 = r.freeze(std::vector<double>(), fallback);
+  MY_BOOST_CHECK_FLOATS_EQUAL(p3.min, fallback.min, tol);
+  MY_BOOST_CHECK_FLOATS_EQUAL(p3.max, fallback.max, tol);
+  BOOST_CHECK_EQUAL(p3.num_bins, fallback.num_bins);
+}
+
+BOOST_AUTO_TEST_CASE(common_grid_rebinned)
+{
+  typedef Tomographer::HistogramWithErrorBars<double, double> HistogramType;
+
+  HistogramType h1(0.875, 1.0, 8); // bin width 1/64
+  h1.load( (Eigen::ArrayXd(8) << 1, 2, 3, 4, 5, 6, 7, 8).finished(),
+           (Eigen::ArrayXd(8) << 0.1, 0.1, 0.2, 0.2, 0.3, 0.3, 0.4, 0.4).finished(), 2 );
+  HistogramType h2(0.75, 1.0, 8); // bin width 1/32
+
+  std::vector<HistogramType::Params> params_list;
+  params_list.push_back(h1.params);
+  params_list.push_back(h2.params);
+  HistogramType::Params p = Tomographer::histogramCommonGridParams(params_list);
+  MY_BOOST_CHECK_FLOATS_EQUAL(p.min, 0.75, tol);
+  MY_BOOST_CHECK_FLOATS_EQUAL(p.max, 1.0, tol);
+  BOOST_CHECK_EQUAL(p.num_bins, 8);
+
+  HistogramType r = Tomographer::histogramRebinned(h1, p);
+  MY_BOOST_CHECK_EIGEN_EQUAL(r.bins, (Eigen::ArrayXd(8) << 0, 0, 0, 0, 3, 7, 11, 15).finished(), tol);
+  // error bars of merged bins are added linearly
+  MY_BOOST_CHECK_EIGEN_EQUAL(r.delta, (Eigen::ArrayXd(8) << 0, 0, 0, 0, 0.2, 0.4, 0.6, 0.8).finished(), tol);
+  MY_BOOST_CHECK_FLOATS_EQUAL(r.off_chart, 2, tol);
+
+  // rebinning onto a smaller range sends the rest off chart
+  Tomographer::Histogram<double, int> hs(0.75, 1.0, 8);
+  hs.load( (Eigen::ArrayXi(8) << 1, 2, 3, 4, 5, 6, 7, 8).finished(), 1 );
+  Tomographer::Histogram<double, int> rs =
+    Tomographer::histogramRebinned(hs, Tomographer::HistogramParams<double>(0.75, 0.875, 2));
+  MY_BOOST_CHECK_EIGEN_EQUAL(rs.bins, (Eigen::ArrayXi(2) << 3, 7).finished(), 0);
+  BOOST_CHECK_EQUAL(rs.off_chart, 1 + 5 + 6 + 7 + 8);
+}
+
+BOOST_AUTO_TEST_CASE(aggregate_on_common_grid)
+{
+  typedef Tomographer::Histogram<double, int> HistogramType;
+  typedef Tomographer::AggregatedHistogramSimple<HistogramType, double> AggregatedHistogramType;
+
+  std::vector<HistogramType> list;
+  list.push_back(HistogramType(0.5, 1.0, 2)); // bin width 1/4
+  list.back().load( (Eigen::ArrayXi(2) << 2, 6).finished() );
+  list.push_back(HistogramType(0.75, 1.0, 4)); // bin width 1/16
+  list.back().load( (Eigen::ArrayXi(4) << 1, 1, 3, 3).finished() );
+
+  AggregatedHistogramType agg =
+    Tomographer::aggregateHistogramsOnCommonGrid<AggregatedHistogramType>(
+        list, [](const HistogramType & h) -> const HistogramType & { return h; }
+        );
+
+  MY_BOOST_CHECK_FLOATS_EQUAL(agg.final_histogram.params.min, 0.5, tol);
+  MY_BOOST_CHECK_FLOATS_EQUAL(agg.final_histogram.params.max, 1.0, tol);
+  BOOST_CHECK_EQUAL(agg.final_histogram.params.num_bins, 2);
+  MY_BOOST_CHECK_EIGEN_EQUAL(agg.final_histogram.bins, (Eigen::ArrayXd(2) << 1, 7).finished(), tol);
+}
+
+BOOST_AUTO_TEST_SUITE_END(); // adaptive_range
+
+// -----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE(histogram_2d);
+
+BOOST_AUTO_TEST_CASE(basic)
+{
+  typedef Tomographer::Histogram2D<double, int> HistogramType;
+  HistogramType hist(HistogramType::AxisParams(0.0, 1.0, 4), HistogramType::AxisParams(-1.0, 1.0, 2));
+
+  BOOST_CHECK_EQUAL(hist.numBins(), 8);
+  BOOST_CHECK_EQUAL(hist.numBinsX(), 4);
+  BOOST_CHECK_EQUAL(hist.numBinsY(), 2);
+  BOOST_CHECK(hist.isWithinBounds(0.5, 0.0));
+  BOOST_CHECK(!hist.isWithinBounds(1.0, 0.0));
+  BOOST_CHECK(!hist.isWithinBounds(0.5, -1.5));
+  BOOST_CHECK(!hist.isWithinBounds(0.5, std::numeric_limits<double>::quiet_NaN()));
+  BOOST_CHECK_THROW(hist.binIndex(0.5, 2.0), std::out_of_range);
+
+  BOOST_CHECK_EQUAL(hist.record(0.1, -0.5), 0);
+  BOOST_CHECK_EQUAL(hist.record(0.3, -0.5), 1);
+  BOOST_CHECK_EQUAL(hist.record(0.3, 0.5), 5);
+  BOOST_CHECK_EQUAL(hist.record(0.9, 0.99), 7);
+  BOOST_CHECK_EQUAL(hist.record(0.9, 0.99, 2), 7);
+  BOOST_CHECK_EQUAL(hist.record(1.5, 0.0), -1);
+  BOOST_CHECK_EQUAL(hist.record(0.5, 1.0, 3), -1);
+
+  BOOST_CHECK_EQUAL(hist.count(0, 0), 1);
+  BOOST_CHECK_EQUAL(hist.count(1, 0), 1);
+  BOOST_CHECK_EQUAL(hist.count(1, 1), 1);
+  BOOST_CHECK_EQUAL(hist.count(3, 1), 3);
+  BOOST_CHECK_EQUAL(hist.count(2, 1), 0);
+  BOOST_CHECK_EQUAL(hist.off_chart, 4);
+  BOOST_CHECK_EQUAL(hist.totalCounts(), 10);
+
+  Eigen::ArrayXXi expected(4, 2);
+  expected << 1, 0,
+              1, 1,
+              0, 0,
+              0, 3;
+  BOOST_CHECK((hist.countsArray() == expected).all());
+
+  // bin area is 1/4 * 1 = 1/4
+  MY_BOOST_CHECK_FLOATS_EQUAL(hist.normalization(), 4 + 6*0.25, tol);
+  auto hn = hist.normalized();
+  MY_BOOST_CHECK_FLOATS_EQUAL(hn.normalization(), 1.0, tol);
+  MY_BOOST_CHECK_FLOATS_EQUAL(hn.count(3, 1), 3.0 / 5.5, tol);
+
+  hist.reset();
+  BOOST_CHECK_EQUAL(hist.totalCounts(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(aggregated)
+{
+  // the 2-D aggregation must coincide with the 1-D aggregation on the flattened bins
+  typedef Tomographer::Histogram2DWithErrorBars<double, float> HistogramType;
+  typedef Tomographer::HistogramWithErrorBars<double, float> FlatHistogramType;
+
+  HistogramType::Params p(HistogramType::AxisParams(0.0, 1.0, 2), HistogramType::AxisParams(0.0, 2.0, 2));
+  FlatHistogramType::Params pflat(0.0, 1.0, 4);
+
+  std::vector<HistogramType> list;
+  std::vector<FlatHistogramType> flatlist;
+  const float data[3][4] = { {15, 45, 42, 12}, {17, 43, 40, 18}, {20, 38, 47, 10} };
+  const float errs[3][4] = { {1, 1, 1, 1}, {2, 2, 5, 2}, {1, 2, 13, 4} };
+  for (int k = 0; k < 3; ++k) {
+    const Eigen::ArrayXf d = Eigen::Map<const Eigen::ArrayXf>(data[k], 4);
+    const Eigen::ArrayXf e = Eigen::Map<const Eigen::ArrayXf>(errs[k], 4);
+    list.push_back(HistogramType(p));
+    list.back().load(d, e, 30+k);
+    flatlist.push_back(FlatHistogramType(pflat));
+    flatlist.back().load(d, e, 30+k);
+  }
+
+  typedef Tomographer::AggregatedHistogram2DWithErrorBars<HistogramType, double> AggregatedType;
+  typedef Tomographer::AggregatedHistogramWithErrorBars<FlatHistogramType, double> FlatAggregatedType;
+  AggregatedType agg = AggregatedType::aggregate(
+      p, list, [](const HistogramType & h) -> const HistogramType & { return h; }
+      );
+  FlatAggregatedType flatagg = FlatAggregatedType::aggregate(
+      pflat, flatlist, [](const FlatHistogramType & h) -> const FlatHistogramType & { return h; }
+      );
+
+  BOOST_CHECK_EQUAL(agg.final_histogram.num_histograms, 3);
+  MY_BOOST_CHECK_EIGEN_EQUAL(agg.final_histogram.bins, flatagg.final_histogram.bins, tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(agg.final_histogram.delta, flatagg.final_histogram.delta, tol);
+  MY_BOOST_CHECK_FLOATS_EQUAL(agg.final_histogram.off_chart, flatagg.final_histogram.off_chart, tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(agg.simple_final_histogram.bins, flatagg.simple_final_histogram.bins, tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(agg.simple_final_histogram.delta, flatagg.simple_final_histogram.delta, tol);
+
+  MY_BOOST_CHECK_FLOATS_EQUAL(agg.final_histogram.errorBar(1, 1), flatagg.final_histogram.delta(3), tol);
+
+  std::stringstream csv;
+  agg.printHistogramCsv(csv, ",", "\n", 3);
+  std::string line;
+  std::getline(csv, line);
+  BOOST_CHECK_EQUAL(line, "ValueX,ValueY,Counts,Error,SimpleError");
+  std::getline(csv, line);
+  std::getline(csv, line);
+  BOOST_CHECK_EQUAL(line.substr(0, 20), "5.000e-01,0.000e+00,");
+}
+
+BOOST_AUTO_TEST_SUITE_END(); // histogram_2d
+
+// -----------------------------------------------------------------------------
+
 BOOST_AUTO_TEST_SUITE(formatting)
 
 BOOST_AUTO_TEST_SUITE(histogram_pretty_print)
@@ -0,0 +1,228 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <cmath>
+
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <random>
+
+// definitions for Tomographer test framework -- this must be included before any
+// <Eigen/...> or <tomographer/...> header
+#include "test_tomographer.h"
+
+#include <tomographer/mhrw_autocorrelation.h>
+#include <tomographer/tools/boost_test_logger.h>
+
+
+
+// -----------------------------------------------------------------------------
+// fixture(s)
+
+
+// the value calculator for the dummy random walk below: the point itself
+struct IdentValueCalculator
+{
+  typedef double ValueType;
+  inline double getValue(double pt) const { return pt; }
+};
+
+// same, but counts how many times it was called
+struct CountingValueCalculator
+{
+  CountingValueCalculator() : num_calls(0) { }
+  typedef double ValueType;
+  inline double getValue(double pt) const { ++num_calls; return pt; }
+  mutable int num_calls;
+};
+
+struct autocorrelation_fixture
+{
+  struct DummyMHRW { int x; };
+  DummyMHRW mhrw;
+
+  std::mt19937 rng;
+
+  autocorrelation_fixture()
+    : mhrw(), rng(3040)
+  {
+  }
+
+  // an AR(1) process x_{n+1} = phi*x_n + noise, with a constant offset.  Its integrated
+  // autocorrelation time is (1+phi)/(2*(1-phi)).  The point of the dummy random walk is
+  // x_n, and its function value is -x_n/2
+  template<typename StatsColl>
+  void run_ar1(StatsColl & statcoll, double phi, double offset, int num_samples)
+  {
+    std::normal_distribution<double> noise(0.0, 1.0);
+    double x = 0;
+    statcoll.init();
+    statcoll.thermalizingDone();
+    for (int n = 0; n < num_samples; ++n) {
+      x = phi*x + noise(rng);
+      statcoll.rawMove(n, false, true, true, 1.0, 0, 0.0, 0, 0.0, mhrw);
+      statcoll.processSample(n, n, offset + x, -(offset + x)/2, mhrw);
+    }
+    statcoll.done();
+  }
+};
+
+
+// -----------------------------------------------------------------------------
+// test suites
+
+
+BOOST_FIXTURE_TEST_SUITE(test_mhrw_autocorrelation, autocorrelation_fixture)
+
+BOOST_AUTO_TEST_CASE(uncorrelated)
+{
+  Tomographer::StreamingAutocorrelationAnalysis<double, long> analysis(2);
+
+  std::normal_distribution<double> dist(0.0, 1.0);
+  const long num_samples = 1L << 17;
+  for (long n = 0; n < num_samples; ++n) {
+    analysis.processNewValues(Eigen::Array2d(dist(rng), 1.5));
+  }
+
+  BOOST_CHECK_EQUAL(analysis.numSamples(), num_samples);
+  BOOST_CHECK_EQUAL(analysis.numLevels(), 18);
+  BOOST_CHECK_EQUAL(analysis.estimateLevel(), 11); // 2^17/2^11 = 64 bins
+  BOOST_CHECK_SMALL(analysis.mean()(0), 0.02);
+  BOOST_CHECK_CLOSE(analysis.mean()(1), 1.5, 1e-8);
+
+  auto tau = analysis.tauInt();
+  BOOST_MESSAGE("tau = " << tau.transpose());
+  BOOST_CHECK_CLOSE(tau(0), 0.5, 30);
+  BOOST_CHECK_EQUAL(tau(1), 0.5); // constant value
+}
+
+BOOST_AUTO_TEST_CASE(not_enough_samples)
+{
+  Tomographer::StreamingAutocorrelationAnalysis<double, int> analysis(1, 16);
+  for (int n = 0; n < 10; ++n) {
+    analysis.processNewValues(Eigen::Array<double,1,1>::Constant(n));
+  }
+  BOOST_CHECK_EQUAL(analysis.estimateLevel(), -1);
+  BOOST_CHECK(std::isnan(analysis.tauInt()(0)));
+  BOOST_CHECK_EQUAL(analysis.determineConvergence()(0), Tomographer::BINNING_UNKNOWN_CONVERGENCE);
+
+  analysis.reset();
+  BOOST_CHECK_EQUAL(analysis.numSamples(), 0);
+  BOOST_CHECK_EQUAL(analysis.numLevels(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(ar1_function_value)
+{
+  Tomographer::Logger::BoostTestLogger logger;
+  Tomographer::MHRWAutocorrelationStatsCollector<void, int, Tomographer::Logger::BoostTestLogger>
+    statcoll(logger);
+
+  const double phi = 0.8;
+  // a large offset, like a log-likelihood would have, shouldn't harm the estimate
+  run_ar1(statcoll, phi, 1e6, 1 << 18);
+
+  Tomographer::MHRWAutocorrelationResult result = statcoll.getResult();
+  BOOST_CHECK(result.isValid());
+  BOOST_CHECK_EQUAL(result.num_samples, 1 << 18);
+  BOOST_CHECK_EQUAL(result.labels.size(), 1u);
+  BOOST_CHECK_EQUAL(result.tau_int.size(), 1);
+  BOOST_MESSAGE("tau_int = " << result.tau_int.transpose() << ", ess = " << result.ess.transpose());
+
+  const double tau_exact = (1+phi) / (2*(1-phi)); // = 4.5
+  // 64 bins give an estimate of the variance which is only accurate to ~20%
+  BOOST_CHECK_CLOSE(result.tau_int(0), tau_exact, 25);
+  BOOST_CHECK_CLOSE(result.ess(0), (1 << 18) / (2*result.tau_int(0)), 1e-8);
+  BOOST_CHECK_EQUAL(result.converged_status(0), Tomographer::BINNING_CONVERGED);
+  BOOST_CHECK_CLOSE(result.mean(0), -1e6/2, 1e-4);
+
+  std::ostringstream summarystream;
+  result.printSummary(summarystream);
+  std::string summary = summarystream.str();
+  BOOST_MESSAGE(summary);
+  BOOST_CHECK(summary.find("fn value: tau_int = ") == 0);
+}
+
+BOOST_AUTO_TEST_CASE(ar1_with_figure_of_merit)
+{
+  Tomographer::Logger::BoostTestLogger logger;
+  IdentValueCalculator vcalc;
+  Tomographer::MHRWAutocorrelationStatsCollector<IdentValueCalculator, int, Tomographer::Logger::BoostTestLogger>
+    statcoll(vcalc, logger, 256);
+
+  const double phi = 0.9;
+  run_ar1(statcoll, phi, 0.0, 1 << 18);
+
+  BOOST_CHECK_EQUAL(statcoll.getAnalysis().minNumBins(), 256);
+
+  Tomographer::MHRWAutocorrelationResult result = statcoll.stealResult();
+  BOOST_CHECK_EQUAL(result.labels.size(), 2u);
+  BOOST_CHECK_EQUAL(result.labels[1], "fig. of merit");
+  BOOST_MESSAGE("tau_int = " << result.tau_int.transpose());
+
+  const double tau_exact = (1+phi) / (2*(1-phi)); // = 9.5
+  BOOST_CHECK_CLOSE(result.tau_int(0), tau_exact, 20);
+  // both values are the same up to a scaling, so the estimates coincide
+  BOOST_CHECK_CLOSE(result.tau_int(1), result.tau_int(0), 1e-6);
+  BOOST_CHECK_CLOSE(result.mean(1), -2*result.mean(0), 1e-6);
+
+  std::string status = Tomographer::Tools::StatusProvider<decltype(statcoll)>::getStatusLine(&statcoll);
+  BOOST_MESSAGE(status);
+  BOOST_CHECK(status.find("Autocorrelation: ") == 0);
+}
+
+BOOST_AUTO_TEST_CASE(figure_of_merit_optional)
+{
+  Tomographer::Logger::BoostTestLogger logger;
+  CountingValueCalculator vcalc;
+
+  // no value calculator given: the figure of merit is not calculated at all
+  Tomographer::MHRWAutocorrelationStatsCollector<CountingValueCalculator, int, Tomographer::Logger::BoostTestLogger>
+    statcoll(static_cast<const CountingValueCalculator*>(NULL), logger);
+  run_ar1(statcoll, 0.5, 0.0, 1000);
+  BOOST_CHECK_EQUAL(vcalc.num_calls, 0);
+  BOOST_CHECK_EQUAL(statcoll.getResult().labels.size(), 1u);
+  BOOST_CHECK_EQUAL(statcoll.getResult().tau_int.size(), 1);
+
+  Tomographer::MHRWAutocorrelationStatsCollector<CountingValueCalculator, int, Tomographer::Logger::BoostTestLogger>
+    statcoll2(&vcalc, logger);
+  run_ar1(statcoll2, 0.5, 0.0, 1000);
+  BOOST_CHECK_EQUAL(vcalc.num_calls, 1000);
+  BOOST_CHECK_EQUAL(statcoll2.getResult().labels.size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(empty_result)
+{
+  Tomographer::MHRWAutocorrelationResult result;
+  BOOST_CHECK(!result.isValid());
+  std::ostringstream summarystream;
+  result.printSummary(summarystream);
+  BOOST_CHECK_EQUAL(summarystream.str(), "(no autocorrelation analysis)");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,251 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <cmath>
+#include <cstdio>
+
+#include <string>
+#include <iostream>
+#include <fstream>
+
+// definitions for Tomographer test framework -- this must be included before any
+// <Eigen/...> or <tomographer/...> header
+#include "test_tomographer.h"
+
+#include <tomographer/mhrw_resultsfile.h>
+#include <tomographer/histogram.h>
+#include <tomographer/tools/boost_test_logger.h>
+
+
+
+// -----------------------------------------------------------------------------
+// fixture(s)
+
+
+struct resultsfile_fixture
+{
+  typedef Tomographer::HistogramWithErrorBars<double, double> HistogramType;
+  typedef Tomographer::BinningAnalysisParams<double> BinningAnalysisParamsType;
+  typedef Tomographer::ValueHistogramWithBinningMHRWStatsCollectorResult<HistogramType, BinningAnalysisParamsType>
+    StatsResultsType;
+  typedef Tomographer::MHRWParams<Tomographer::MHWalkerParamsStepSize<double>, int> MHRWParamsType;
+
+  // the fields of a MHRWTasks::MHRandomWalkTaskResult which are used
+  struct TaskResult {
+    StatsResultsType stats_results;
+    MHRWParamsType mhrw_params;
+    double acceptance_ratio;
+  };
+  struct CData {
+    MHRWParamsType mhrw_params;
+  };
+
+  const std::string fname;
+
+  resultsfile_fixture()
+    : fname("_tmp_test_mhrw_resultsfile.bin")
+  {
+    std::remove(fname.c_str());
+  }
+  ~resultsfile_fixture()
+  {
+    std::remove(fname.c_str());
+  }
+
+  static TaskResult make_task_result(double offset, double acceptance_ratio)
+  {
+    HistogramType h(0.0, 1.0, 4);
+    h.load(Eigen::Array4d(1, 2, 3, 4) + offset, Eigen::Array4d(0.1, 0.2, 0.3, 0.4), 0.5);
+    Eigen::ArrayXXd error_levels(4, 3);
+    error_levels << 0.1, 0.11, 0.12,
+      0.2, 0.21, 0.22,
+      0.3, 0.31, 0.32,
+      0.4, 0.41, 0.42;
+    Eigen::ArrayXi converged_status(4);
+    converged_status << Tomographer::BINNING_CONVERGED, Tomographer::BINNING_NOT_CONVERGED,
+      Tomographer::BINNING_UNKNOWN_CONVERGENCE, Tomographer::BINNING_CONVERGED;
+    return TaskResult{StatsResultsType(h, error_levels, converged_status),
+                      MHRWParamsType(0.04, 10, 100, 1000), acceptance_ratio};
+  }
+};
+
+
+// -----------------------------------------------------------------------------
+// test suites
+
+
+BOOST_FIXTURE_TEST_SUITE(test_mhrw_resultsfile, resultsfile_fixture)
+
+BOOST_AUTO_TEST_CASE(layout)
+{
+  Tomographer::ResultsFileRecordInfo info;
+  info.num_bins = 5;
+  info.num_levels = 0;
+  BOOST_CHECK_EQUAL(Tomographer::ResultsFileLayout::recordSize(info, 0), 128u + 2*5*8);
+  BOOST_CHECK_EQUAL(Tomographer::ResultsFileLayout::recordSize(info, 3), 128u + 8 + 2*5*8);
+  info.num_levels = 2;
+  // converged status: 5 int32's padded to 24 bytes
+  BOOST_CHECK_EQUAL(Tomographer::ResultsFileLayout::recordSize(info, 8), 128u + 8 + 4*5*8 + 24);
+}
+
+BOOST_AUTO_TEST_CASE(write_and_read)
+{
+  std::vector<TaskResult> results{ make_task_result(0, 0.25), make_task_result(10, 0.35) };
+  std::vector<const TaskResult*> result_ptrs{ &results[0], &results[1] };
+
+  typedef Tomographer::AggregatedHistogramSimple<Tomographer::Histogram<double, int>, double>
+    AggregatedHistogramType;
+  AggregatedHistogramType::FinalHistogramType final_histogram(0.0, 1.0, 4);
+  final_histogram.load(Eigen::Array4d(6, 7, 8, 9), Eigen::Array4d(1, 1, 2, 2), 0.5);
+  AggregatedHistogramType aggregated(std::move(final_histogram));
+
+  CData cdata{MHRWParamsType(0.04, 10, 100, 1000)};
+
+  {
+    Tomographer::ResultsFileWriter writer(fname);
+    Tomographer::writeValueHistogramResults(writer, 7, "data.mat", cdata, result_ptrs, aggregated);
+    BOOST_CHECK_EQUAL(writer.numRecordsWritten(), 3u);
+  }
+  {
+    // append the results of another data set
+    Tomographer::ResultsFileWriter writer(fname);
+    Tomographer::writeValueHistogramResults(writer, 8, "other-data.mat", cdata, result_ptrs, aggregated);
+  }
+
+  Tomographer::ResultsFileReader reader(fname);
+  BOOST_CHECK_EQUAL(reader.numRecords(), 6u);
+
+  auto r = reader.record(1);
+  BOOST_CHECK(r.isTaskResult());
+  BOOST_CHECK_EQUAL(r.info.dataset_id, 7);
+  BOOST_CHECK_EQUAL(r.info.task_id, 1);
+  BOOST_CHECK_EQUAL(r.label, "data.mat");
+  BOOST_CHECK_EQUAL(r.info.num_bins, 4u);
+  BOOST_CHECK_EQUAL(r.info.num_levels, 3u);
+  BOOST_CHECK_EQUAL(r.info.min, 0.0);
+  BOOST_CHECK_EQUAL(r.info.max, 1.0);
+  BOOST_CHECK_EQUAL(r.info.off_chart, 0.5);
+  BOOST_CHECK_EQUAL(r.info.acceptance_ratio, 0.35);
+  BOOST_CHECK_EQUAL(r.info.n_sweep, 10);
+  BOOST_CHECK_EQUAL(r.info.n_therm, 100);
+  BOOST_CHECK_EQUAL(r.info.n_run, 1000);
+  BOOST_CHECK_EQUAL(r.info.step_size, 0.04);
+  MY_BOOST_CHECK_EIGEN_EQUAL(r.bins, results[1].stats_results.histogram.bins, tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(r.delta, results[1].stats_results.histogram.delta, tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(r.error_levels, results[1].stats_results.error_levels, tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(r.converged_status, results[1].stats_results.converged_status, tol);
+
+  auto a = reader.record(5);
+  BOOST_CHECK(a.isAggregatedResult());
+  BOOST_CHECK_EQUAL(a.info.dataset_id, 8);
+  BOOST_CHECK_EQUAL(a.info.task_id, -1);
+  BOOST_CHECK_EQUAL(a.label, "other-data.mat");
+  BOOST_CHECK_EQUAL(a.info.num_levels, 0u);
+  BOOST_CHECK_EQUAL(a.converged_status.size(), 0);
+  BOOST_CHECK_CLOSE(a.info.acceptance_ratio, 0.3, 1e-8);
+  BOOST_CHECK_EQUAL(a.info.n_run, 1000);
+  auto h = a.histogram();
+  MY_BOOST_CHECK_EIGEN_EQUAL(h.bins, aggregated.final_histogram.bins, tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(h.delta, aggregated.final_histogram.delta, tol);
+  BOOST_CHECK_EQUAL(h.off_chart, 0.5);
+}
+
+BOOST_AUTO_TEST_CASE(incomplete_record)
+{
+  {
+    Tomographer::ResultsFileWriter writer(fname);
+    Tomographer::ResultsFileRecordInfo info;
+    info.num_bins = 3;
+    writer.writeRecord(info, "", Eigen::Array3d(1, 2, 3), Eigen::ArrayXd(), Eigen::ArrayXXd(0, 0),
+                       Eigen::ArrayXi());
+    writer.writeRecord(info, "", Eigen::Array3d(4, 5, 6), Eigen::ArrayXd(), Eigen::ArrayXXd(0, 0),
+                       Eigen::ArrayXi());
+  }
+  {
+    // simulate an interrupted write: truncate the last record
+    std::ifstream inf(fname, std::ios::in | std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(inf)), std::istreambuf_iterator<char>());
+    inf.close();
+    std::ofstream outf(fname, std::ios::out | std::ios::binary | std::ios::trunc);
+    outf.write(contents.data(), (std::streamsize)contents.size() - 10);
+  }
+  Tomographer::ResultsFileReader reader(fname);
+  BOOST_CHECK_EQUAL(reader.numRecords(), 1u);
+  auto r = reader.record(0);
+  MY_BOOST_CHECK_EIGEN_EQUAL(r.bins, Eigen::Array3d(1, 2, 3), tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(r.delta, Eigen::Array3d::Zero(), tol);
+  BOOST_CHECK(std::isnan(r.info.step_size));
+}
+
+BOOST_AUTO_TEST_CASE(append_after_incomplete_record)
+{
+  Tomographer::ResultsFileRecordInfo info;
+  info.num_bins = 3;
+  {
+    Tomographer::ResultsFileWriter writer(fname);
+    writer.writeRecord(info, "", Eigen::Array3d(1, 2, 3), Eigen::ArrayXd(), Eigen::ArrayXXd(0, 0),
+                       Eigen::ArrayXi());
+    writer.writeRecord(info, "", Eigen::Array3d(4, 5, 6), Eigen::ArrayXd(), Eigen::ArrayXXd(0, 0),
+                       Eigen::ArrayXi());
+  }
+  {
+    // simulate an interrupted write: truncate the last record
+    std::ifstream inf(fname, std::ios::in | std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(inf)), std::istreambuf_iterator<char>());
+    inf.close();
+    std::ofstream outf(fname, std::ios::out | std::ios::binary | std::ios::trunc);
+    outf.write(contents.data(), (std::streamsize)contents.size() - 10);
+  }
+  {
+    // a new writer must drop the incomplete record before appending
+    Tomographer::ResultsFileWriter writer(fname);
+    writer.writeRecord(info, "", Eigen::Array3d(7, 8, 9), Eigen::ArrayXd(), Eigen::ArrayXXd(0, 0),
+                       Eigen::ArrayXi());
+    writer.writeRecord(info, "", Eigen::Array3d(10, 11, 12), Eigen::ArrayXd(), Eigen::ArrayXXd(0, 0),
+                       Eigen::ArrayXi());
+  }
+  Tomographer::ResultsFileReader reader(fname);
+  BOOST_CHECK_EQUAL(reader.numRecords(), 3u);
+  MY_BOOST_CHECK_EIGEN_EQUAL(reader.record(0).bins, Eigen::Array3d(1, 2, 3), tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(reader.record(1).bins, Eigen::Array3d(7, 8, 9), tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(reader.record(2).bins, Eigen::Array3d(10, 11, 12), tol);
+}
+
+BOOST_AUTO_TEST_CASE(invalid)
+{
+  {
+    std::ofstream outf(fname);
+    outf << "this is not a results file";
+  }
+  BOOST_CHECK_THROW(Tomographer::ResultsFileReader reader(fname), Tomographer::ResultsFileError);
+  BOOST_CHECK_THROW(Tomographer::ResultsFileWriter writer(fname), Tomographer::ResultsFileError);
+  BOOST_CHECK_THROW(Tomographer::ResultsFileReader reader("_tmp_nonexistent_file.bin"),
+                    Tomographer::ResultsFileError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,228 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <cmath>
+#include <cstdio>
+
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <random>
+
+// definitions for Tomographer test framework -- this must be included before any
+// <Eigen/...> or <tomographer/...> header
+#include "test_tomographer.h"
+
+#include <tomographer/mhrw_samplestream.h>
+#include <tomographer/densedm/dmtypes.h>
+#include <tomographer/densedm/param_herm_x.h>
+#include <tomographer/densedm/tspacefigofmerit.h>
+#include <tomographer/tools/boost_test_logger.h>
+
+
+
+// -----------------------------------------------------------------------------
+// fixture(s)
+
+
+// stores (pt, pt/2) for an integer point
+struct TwoValuesCalculator
+{
+  typedef double ValueType;
+  typedef Eigen::Array<double,Eigen::Dynamic,1> ValueArrayType;
+  inline Eigen::Index numValues() const { return 2; }
+  inline void getValues(int pt, ValueArrayType & values) const
+  {
+    values << pt, pt/2.0;
+  }
+};
+
+struct samplestream_fixture
+{
+  struct DummyMHRW { int x; };
+  DummyMHRW mhrw;
+
+  const std::string fname;
+
+  samplestream_fixture()
+    : mhrw(), fname("_tmp_test_mhrw_samplestream.bin"), cur_task_id(0)
+  {
+  }
+  ~samplestream_fixture()
+  {
+    std::remove(fname.c_str());
+  }
+
+  // a pretend random walk, whose sample points are task_id*100+n, with function value -n
+  template<typename StatsColl>
+  void run_dummy_rw(StatsColl & statcoll, int num_samples)
+  {
+    statcoll.init();
+    statcoll.thermalizingDone();
+    for (int n = 0; n < num_samples; ++n) {
+      statcoll.rawMove(n, false, true, true, 1.0, 0, 0.0, 0, 0.0, mhrw);
+      statcoll.processSample(n, n, cur_task_id*100 + n, -double(n), mhrw);
+    }
+    statcoll.done();
+  }
+
+  int cur_task_id;
+};
+
+
+// -----------------------------------------------------------------------------
+// test suites
+
+
+BOOST_FIXTURE_TEST_SUITE(test_mhrw_samplestream, samplestream_fixture)
+
+BOOST_AUTO_TEST_CASE(layout)
+{
+  Tomographer::SampleStreamLayout layout(3, 4);
+  BOOST_CHECK_EQUAL(layout.recordSize(), 16u + 3*4);
+  BOOST_CHECK_EQUAL(Tomographer::SampleStreamLayout(3, 8).recordSize(), 16u + 3*8);
+  BOOST_CHECK_THROW(Tomographer::SampleStreamLayout(3, 2), Tomographer::SampleStreamError);
+
+  std::vector<char> rec(layout.recordSize());
+  layout.encodeRecord(rec.data(), 7, -12.5, Eigen::Vector3d(1.0, 0.5, -2.0));
+  int task_id;
+  double fnval;
+  Eigen::VectorXd values;
+  layout.decodeRecord(rec.data(), task_id, fnval, values);
+  BOOST_CHECK_EQUAL(task_id, 7);
+  BOOST_CHECK_EQUAL(fnval, -12.5);
+  MY_BOOST_CHECK_EIGEN_EQUAL(values, Eigen::Vector3d(1.0, 0.5, -2.0), tol);
+}
+
+BOOST_AUTO_TEST_CASE(write_read)
+{
+  Tomographer::Logger::BoostTestLogger logger;
+
+  {
+    Tomographer::SampleStreamWriter writer(fname, Tomographer::SampleStreamLayout(2, 8), 2);
+    // small buffers, to exercise the hand-over to the writer thread
+    for (cur_task_id = 0; cur_task_id < 3; ++cur_task_id) {
+      auto statcoll = Tomographer::mkSampleStreamMHRWStatsCollector(
+          &writer, TwoValuesCalculator(), cur_task_id, logger, 1, 3
+          );
+      run_dummy_rw(statcoll, 10);
+    }
+    writer.close();
+    BOOST_CHECK_EQUAL(writer.numRecordsWritten(), 30u);
+  }
+
+  Tomographer::SampleStreamReader reader(fname);
+  BOOST_CHECK_EQUAL(reader.layout().num_values, 2u);
+  BOOST_CHECK_EQUAL(reader.layout().value_bytes, 8u);
+  BOOST_CHECK_EQUAL(reader.numRecords(), 30u);
+
+  int task_id;
+  double fnval;
+  Eigen::VectorXd values;
+  BOOST_CHECK(reader.readNext(task_id, fnval, values));
+  BOOST_CHECK_EQUAL(task_id, 0);
+  BOOST_CHECK_EQUAL(fnval, 0.0);
+  MY_BOOST_CHECK_EIGEN_EQUAL(values, Eigen::Vector2d(0.0, 0.0), tol);
+
+  auto data = reader.readAll();
+  BOOST_CHECK_EQUAL(data.task_ids.size(), 30);
+  BOOST_CHECK_EQUAL(data.values.rows(), 2);
+  BOOST_CHECK_EQUAL(data.values.cols(), 30);
+  for (int k = 0; k < 30; ++k) {
+    const int tid = k / 10, n = k % 10;
+    BOOST_CHECK_EQUAL(data.task_ids(k), tid);
+    BOOST_CHECK_EQUAL(data.fnvals(k), -double(n));
+    BOOST_CHECK_EQUAL(data.values(0,k), double(tid*100+n));
+    BOOST_CHECK_EQUAL(data.values(1,k), (tid*100+n)/2.0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(thinning_float)
+{
+  Tomographer::Logger::BoostTestLogger logger;
+
+  {
+    Tomographer::SampleStreamWriter writer(fname, Tomographer::SampleStreamLayout(2, 4));
+    cur_task_id = 5;
+    auto statcoll = Tomographer::mkSampleStreamMHRWStatsCollector(&writer, TwoValuesCalculator(), 5, logger, 4);
+    run_dummy_rw(statcoll, 10);
+    // writer closed by destructor
+  }
+
+  Tomographer::SampleStreamReader reader(fname);
+  BOOST_CHECK_EQUAL(reader.layout().value_bytes, 4u);
+  auto data = reader.readAll();
+  BOOST_CHECK_EQUAL(data.task_ids.size(), 3); // samples n = 0, 4, 8
+  for (int k = 0; k < 3; ++k) {
+    BOOST_CHECK_EQUAL(data.task_ids(k), 5);
+    BOOST_CHECK_EQUAL(data.fnvals(k), -4.0*k);
+    BOOST_CHECK_EQUAL(data.values(0,k), 500.0+4*k);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(disabled)
+{
+  Tomographer::Logger::BoostTestLogger logger;
+  cur_task_id = 0;
+  auto statcoll = Tomographer::mkSampleStreamMHRWStatsCollector(NULL, TwoValuesCalculator(), 0, logger);
+  run_dummy_rw(statcoll, 10);
+  // nothing to check, just shouldn't crash
+}
+
+BOOST_AUTO_TEST_CASE(invalid_file)
+{
+  {
+    std::ofstream f(fname, std::ios::out | std::ios::binary);
+    f << "this is not a sample stream file, not at all";
+  }
+  BOOST_CHECK_THROW(Tomographer::SampleStreamReader reader(fname), Tomographer::SampleStreamError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+
+BOOST_AUTO_TEST_SUITE(test_rhoparamxcalculator)
+
+BOOST_AUTO_TEST_CASE(qubit)
+{
+  typedef Tomographer::DenseDM::DMTypes<2> DMTypes;
+  DMTypes dmt;
+  Tomographer::DenseDM::TSpace::RhoParamXCalculator<DMTypes> calc(dmt);
+  BOOST_CHECK_EQUAL(calc.numValues(), 4);
+
+  DMTypes::MatrixType T;
+  T << 0.8, 0,
+    std::complex<double>(0.1, 0.2), 0.4;
+  Tomographer::DenseDM::TSpace::RhoParamXCalculator<DMTypes>::ValueArrayType x(4);
+  calc.getValues(T, x);
+
+  Tomographer::DenseDM::ParamX<DMTypes> px(dmt);
+  MY_BOOST_CHECK_EIGEN_EQUAL(x.matrix(), px.HermToX(T*T.adjoint()), tol);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,161 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+
+#include <string>
+#include <iostream>
+#include <random>
+
+// definitions for Tomographer test framework -- this must be included before any
+// <Eigen/...> or <tomographer/...> header
+#include "test_tomographer.h"
+
+#include <tomographer/mhrwhmcstepsizecontroller.h>
+#include <tomographer/tools/boost_test_logger.h>
+
+
+
+// -----------------------------------------------------------------------------
+// fixture(s)
+
+struct SimulatorMovAvgStatsColl
+{
+  double accept_ratio_value;
+
+  // called by the controller
+  inline int bufferSize() const { return 1024; } // pretend we calculated the value from this many samples
+  inline bool hasMovingAverageAcceptanceRatio() const { return true; }
+  inline double movingAverageAcceptanceRatio() const { return accept_ratio_value; }
+};
+
+struct DummyMHWalker { };
+struct DummyMHRandomWalk { };
+
+struct mhrwhmcstepsizectrl_fixture
+{
+  SimulatorMovAvgStatsColl mvavg{0};
+
+  Tomographer::Logger::BoostTestLogger logger{Tomographer::Logger::LONGDEBUG};
+
+  // the controller
+  Tomographer::MHRWHMCStepSizeController<SimulatorMovAvgStatsColl,Tomographer::Logger::BoostTestLogger, float, long>
+    ctrl{mvavg, logger};
+
+  DummyMHWalker dmhwalker;
+  DummyMHRandomWalk drw;
+
+  Tomographer::MHRWParams<Tomographer::MHWalkerParamsHMC<float>,long> p{
+    Tomographer::MHWalkerParamsHMC<float>(0.05f, 20), 10, 2048, 32768
+  };
+
+  mhrwhmcstepsizectrl_fixture()
+  {
+  }
+
+};
+
+
+// -----------------------------------------------------------------------------
+// test suites
+
+
+BOOST_AUTO_TEST_SUITE(test_mhrwhmcstepsizecontroller)
+
+BOOST_FIXTURE_TEST_CASE(defaults, mhrwhmcstepsizectrl_fixture)
+{
+  const auto& ctrldefault = ctrl;
+
+  MY_BOOST_CHECK_FLOATS_EQUAL(ctrldefault.desiredAcceptRatioMin(),
+                              Tomographer::MHRWHMCStepSizeControllerDefaults::DesiredAcceptanceRatioMin,
+                              tol) ;
+  MY_BOOST_CHECK_FLOATS_EQUAL(ctrldefault.desiredAcceptRatioMax(),
+                              Tomographer::MHRWHMCStepSizeControllerDefaults::DesiredAcceptanceRatioMax,
+                              tol) ;
+  MY_BOOST_CHECK_FLOATS_EQUAL(ctrldefault.acceptableAcceptRatioMin(),
+                              Tomographer::MHRWHMCStepSizeControllerDefaults::AcceptableAcceptanceRatioMin,
+                              tol) ;
+  MY_BOOST_CHECK_FLOATS_EQUAL(ctrldefault.acceptableAcceptRatioMax(),
+                              Tomographer::MHRWHMCStepSizeControllerDefaults::AcceptableAcceptanceRatioMax,
+                              tol) ;
+}
+
+BOOST_FIXTURE_TEST_CASE(invalid_params, mhrwhmcstepsizectrl_fixture)
+{
+  p.mhwalker_params.step_size = 0;
+  ctrl.init(p, dmhwalker, drw) ;
+  BOOST_CHECK_GT(p.mhwalker_params.step_size, 0) ;
+  BOOST_CHECK_GT(p.mhwalker_params.num_leapfrog_steps, 1) ;
+  MY_BOOST_CHECK_FLOATS_EQUAL(p.mhwalker_params.step_size*p.mhwalker_params.num_leapfrog_steps, 1.0f,
+                              p.mhwalker_params.step_size) ;
+}
+
+BOOST_FIXTURE_TEST_CASE(corrects_lowar, mhrwhmcstepsizectrl_fixture)
+{
+  const auto & cdmhwalker = dmhwalker;
+  const auto & cdrw = drw;
+
+  // init() shouldn't modify the params, they are valid
+  ctrl.init(p, cdmhwalker, cdrw) ;
+  MY_BOOST_CHECK_FLOATS_EQUAL(p.mhwalker_params.step_size, 0.05f, tol_f) ;
+  BOOST_CHECK_EQUAL(p.mhwalker_params.num_leapfrog_steps, 20) ;
+  BOOST_CHECK_EQUAL(p.n_sweep, 10) ;
+
+  mvavg.accept_ratio_value = 0.2; // too low acceptance ratio
+
+  ctrl.adjustParams<true,false>(p, dmhwalker, 1024, drw); // iter_k must be mult of bufferSize
+  // check that step size decreased
+  BOOST_CHECK_LT(p.mhwalker_params.step_size, 0.045f) ;
+  // check that the number of leapfrog steps was compensated to the same trajectory length
+  MY_BOOST_CHECK_FLOATS_EQUAL(p.mhwalker_params.num_leapfrog_steps*p.mhwalker_params.step_size, 1.0f,
+                              p.mhwalker_params.step_size) ;
+  // the sweep size is not touched
+  BOOST_CHECK_EQUAL(p.n_sweep, 10) ;
+}
+
+BOOST_FIXTURE_TEST_CASE(corrects_highar, mhrwhmcstepsizectrl_fixture)
+{
+  ctrl.init(p, dmhwalker, drw) ;
+
+  mvavg.accept_ratio_value = 0.99; // too high acceptance ratio
+
+  ctrl.adjustParams<true,false>(p, dmhwalker, 1024, drw); // iter_k must be mult of bufferSize
+  // check that step size increased
+  BOOST_CHECK_GT(p.mhwalker_params.step_size, 0.055f) ;
+  MY_BOOST_CHECK_FLOATS_EQUAL(p.mhwalker_params.num_leapfrog_steps*p.mhwalker_params.step_size, 1.0f,
+                              p.mhwalker_params.step_size) ;
+  BOOST_CHECK_EQUAL(p.n_sweep, 10) ;
+
+  // the step size never exceeds the trajectory length
+  for (int k = 2; k < 50; ++k) {
+    ctrl.adjustParams<true,false>(p, dmhwalker, 1024*k, drw);
+  }
+  MY_BOOST_CHECK_FLOATS_EQUAL(p.mhwalker_params.step_size, 1.0f, tol_f) ;
+  BOOST_CHECK_EQUAL(p.mhwalker_params.num_leapfrog_steps, 1) ;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -467,6 +467,131 @@ BOOST_FIXTURE_TEST_CASE(mkfunc, TestStatsCollectorFixture)
   BOOST_CHECK_EQUAL( statcoll.histogram().bins(3) ,  0) ; // [3,4[
 }
 
+BOOST_FIXTURE_TEST_CASE(adaptive_range, TestStatsCollectorFixture)
+{
+  MyMinimalistValueCalculator valcalc;
+  Tomographer::Logger::BoostTestLogger logger;
+  typedef Tomographer::ValueHistogramMHRWStatsCollector<MyMinimalistValueCalculator, Tomographer::Logger::BoostTestLogger>
+    MyValueHistogramMHRWStatsCollector;
+
+  // pilot values are sqrt(1), sqrt(2), sqrt(0) -> range [-1,3[ with bins of width 1
+  MyValueHistogramMHRWStatsCollector statcoll(MyValueHistogramMHRWStatsCollector::HistogramParams(0,100,4),
+                                              valcalc, logger,
+                                              MyValueHistogramMHRWStatsCollector::AdaptiveRange(16, 16));
+
+  run_dummy_rw(statcoll);
+
+  BOOST_MESSAGE("The collected histogram is:\n" << statcoll.histogram().prettyPrint()) ;
+  MY_BOOST_CHECK_FLOATS_EQUAL( statcoll.histogram().params.min, -1.0, tol );
+  MY_BOOST_CHECK_FLOATS_EQUAL( statcoll.histogram().params.max, 3.0, tol );
+  BOOST_CHECK_EQUAL( statcoll.histogram().params.num_bins, 4 );
+  BOOST_CHECK_EQUAL( statcoll.histogram().bins(0) ,  0) ; // [-1,0[
+  BOOST_CHECK_EQUAL( statcoll.histogram().bins(1) ,  1) ; // [0,1[
+  BOOST_CHECK_EQUAL( statcoll.histogram().bins(2) ,  5) ; // [1,2[
+  BOOST_CHECK_EQUAL( statcoll.histogram().bins(3) ,  10); // [2,3[
+  BOOST_CHECK_EQUAL( statcoll.histogram().off_chart ,  0);
+  BOOST_CHECK_EQUAL( statcoll.overflowSamples().size(), 0u );
+}
+
+BOOST_FIXTURE_TEST_CASE(adaptive_range_overflow, TestStatsCollectorFixture)
+{
+  MyMinimalistValueCalculator valcalc;
+  Tomographer::Logger::BoostTestLogger logger;
+  typedef Tomographer::ValueHistogramMHRWStatsCollector<MyMinimalistValueCalculator, Tomographer::Logger::BoostTestLogger>
+    MyValueHistogramMHRWStatsCollector;
+  typedef MyValueHistogramMHRWStatsCollector::AdaptiveRange AdaptiveRange;
+  const double inf = std::numeric_limits<double>::infinity();
+
+  // no margin: pilot range [0,sqrt(2)] -> [0,2[ with bins of width 0.5, and 10 samples
+  // fall above the range
+  MyValueHistogramMHRWStatsCollector statcoll(MyValueHistogramMHRWStatsCollector::HistogramParams(0,100,4),
+                                              valcalc, logger,
+                                              AdaptiveRange(16, 16, -inf, inf, 0.0));
+  run_dummy_rw(statcoll);
+
+  BOOST_MESSAGE("The collected histogram is:\n" << statcoll.histogram().prettyPrint()) ;
+  BOOST_CHECK_EQUAL( statcoll.overflowSamples().size(), 10u );
+  MY_BOOST_CHECK_FLOATS_EQUAL( statcoll.histogram().params.min, 0.0, tol );
+  MY_BOOST_CHECK_FLOATS_EQUAL( statcoll.histogram().params.max, 3.0, tol );
+  BOOST_CHECK_EQUAL( statcoll.histogram().params.num_bins, 6 );
+  MY_BOOST_CHECK_EIGEN_EQUAL( statcoll.histogram().bins,
+                              (Eigen::ArrayXi(6) << 1, 0, 2, 3, 6, 4).finished(), 0 );
+  BOOST_CHECK_EQUAL( statcoll.histogram().off_chart ,  0);
+
+  // bounded overflow buffer: only the first 4 off-chart samples can be recovered
+  MyValueHistogramMHRWStatsCollector statcoll2(MyValueHistogramMHRWStatsCollector::HistogramParams(0,100,4),
+                                               valcalc, logger,
+                                               AdaptiveRange(16, 4, -inf, inf, 0.0));
+  run_dummy_rw(statcoll2);
+
+  BOOST_CHECK_EQUAL( statcoll2.overflowSamples().size(), 4u );
+  BOOST_CHECK_EQUAL( statcoll2.histogram().params.num_bins, 6 );
+  MY_BOOST_CHECK_EIGEN_EQUAL( statcoll2.histogram().bins,
+                              (Eigen::ArrayXi(6) << 1, 0, 2, 3, 2, 2).finished(), 0 );
+  BOOST_CHECK_EQUAL( statcoll2.histogram().off_chart ,  6);
+}
+
+BOOST_FIXTURE_TEST_CASE(adaptive_range_overflow_bounded, TestStatsCollectorFixture)
+{
+  MyMinimalistValueCalculator valcalc;
+  Tomographer::Logger::BoostTestLogger logger;
+  typedef Tomographer::ValueHistogramMHRWStatsCollector<MyMinimalistValueCalculator, Tomographer::Logger::BoostTestLogger>
+    MyValueHistogramMHRWStatsCollector;
+  typedef MyValueHistogramMHRWStatsCollector::AdaptiveRange AdaptiveRange;
+  const double inf = std::numeric_limits<double>::infinity();
+
+  // see adaptive_range_overflow; the range is only extended up to the bin containing the
+  // upper bound, and the samples above remain off-chart
+  MyValueHistogramMHRWStatsCollector statcoll(MyValueHistogramMHRWStatsCollector::HistogramParams(0,100,4),
+                                              valcalc, logger,
+                                              AdaptiveRange(16, 16, -inf, 2.2, 0.0));
+  run_dummy_rw(statcoll);
+
+  BOOST_MESSAGE("The collected histogram is:\n" << statcoll.histogram().prettyPrint()) ;
+  BOOST_CHECK_EQUAL( statcoll.overflowSamples().size(), 10u );
+  MY_BOOST_CHECK_FLOATS_EQUAL( statcoll.histogram().params.min, 0.0, tol );
+  MY_BOOST_CHECK_FLOATS_EQUAL( statcoll.histogram().params.max, 2.5, tol );
+  BOOST_CHECK_EQUAL( statcoll.histogram().params.num_bins, 5 );
+  MY_BOOST_CHECK_EIGEN_EQUAL( statcoll.histogram().bins,
+                              (Eigen::ArrayXi(5) << 1, 0, 2, 3, 6).finished(), 0 );
+  BOOST_CHECK_EQUAL( statcoll.histogram().off_chart ,  4);
+}
+
+struct MySquareValueCalculator {
+  typedef double ValueType;
+  MySquareValueCalculator() { }
+  double getValue(int pt) const {
+    return double(pt*pt);
+  };
+};
+
+BOOST_FIXTURE_TEST_CASE(adaptive_range_overflow_capped, TestStatsCollectorFixture)
+{
+  MySquareValueCalculator valcalc;
+  Tomographer::Logger::BoostTestLogger logger;
+  typedef Tomographer::ValueHistogramMHRWStatsCollector<MySquareValueCalculator, Tomographer::Logger::BoostTestLogger>
+    MyValueHistogramMHRWStatsCollector;
+  typedef MyValueHistogramMHRWStatsCollector::AdaptiveRange AdaptiveRange;
+  const double inf = std::numeric_limits<double>::infinity();
+
+  // pilot range [0,4] -> [0,8[ with bins of width 2.  Samples go up to 64, which would
+  // require 29 more bins; the range is only extended by 4 bins, and the samples above
+  // remain off-chart
+  MyValueHistogramMHRWStatsCollector statcoll(MyValueHistogramMHRWStatsCollector::HistogramParams(0,100,4),
+                                              valcalc, logger,
+                                              AdaptiveRange(16, 16, -inf, inf, 0.0));
+  run_dummy_rw(statcoll);
+
+  BOOST_MESSAGE("The collected histogram is:\n" << statcoll.histogram().prettyPrint()) ;
+  BOOST_CHECK_EQUAL( statcoll.overflowSamples().size(), 13u );
+  MY_BOOST_CHECK_FLOATS_EQUAL( statcoll.histogram().params.min, 0.0, tol );
+  MY_BOOST_CHECK_FLOATS_EQUAL( statcoll.histogram().params.max, 16.0, tol );
+  BOOST_CHECK_EQUAL( statcoll.histogram().params.num_bins, 8 );
+  MY_BOOST_CHECK_EIGEN_EQUAL( statcoll.histogram().bins,
+                              (Eigen::ArrayXi(8) << 1, 0, 2, 0, 3, 0, 0, 0).finished(), 0 );
+  BOOST_CHECK_EQUAL( statcoll.histogram().off_chart ,  10);
+}
+
 // BOOST_FIXTURE_TEST_CASE(customhistogramtype, TestStatsCollectorFixture)
 // {
 //   // checks necessary?
@@ -573,6 +698,44 @@ BOOST_FIXTURE_TEST_CASE(simple_mkfunc, TestStatsCollectorFixture)
 
 
 
+BOOST_FIXTURE_TEST_CASE(adaptive_range_overflow, TestStatsCollectorFixture)
+{
+  MyMinimalistValueCalculator valcalc;
+  Tomographer::Logger::BoostTestLogger logger;
+  typedef Tomographer::ValueHistogramWithBinningMHRWStatsCollectorParams<MyMinimalistValueCalculator> VHWBParams;
+  typedef Tomographer::ValueHistogramWithBinningMHRWStatsCollector<VHWBParams, Tomographer::Logger::BoostTestLogger>
+    MyStatsCollector;
+  const double inf = std::numeric_limits<double>::infinity();
+
+  MyStatsCollector statcoll(MyStatsCollector::HistogramParams(0,100,4),
+                            valcalc,
+                            2, // number of binning levels
+                            logger,
+                            MyStatsCollector::AdaptiveRange(16, 16, -inf, inf, 0.0));
+
+  run_dummy_rw(statcoll);
+
+  // see tValueHistogramMHRWStatsCollector/adaptive_range_overflow
+  const auto & fhist = statcoll.getResult().histogram;
+  BOOST_MESSAGE("The full histogram is:\n" << fhist.prettyPrint()) ;
+  MY_BOOST_CHECK_FLOATS_EQUAL( fhist.params.min, 0.0, tol );
+  MY_BOOST_CHECK_FLOATS_EQUAL( fhist.params.max, 3.0, tol );
+  BOOST_CHECK_EQUAL( fhist.params.num_bins, 6 );
+  MY_BOOST_CHECK_EIGEN_EQUAL( fhist.bins, (Eigen::ArrayXd(6) << 1, 0, 2, 3, 6, 4).finished() / 16.0, tol );
+  MY_BOOST_CHECK_FLOATS_EQUAL( fhist.off_chart, 0.0, tol );
+
+  // the error bars of the added bins are calculated in exactly the same way as the
+  // others: compare with a collector which had the full range from the start
+  MyStatsCollector statcoll_ref(MyStatsCollector::HistogramParams(0,3,6),
+                                valcalc,
+                                2, // number of binning levels
+                                logger);
+  run_dummy_rw(statcoll_ref);
+  MY_BOOST_CHECK_EIGEN_EQUAL( fhist.delta, statcoll_ref.getResult().histogram.delta, tol );
+  MY_BOOST_CHECK_EIGEN_EQUAL( statcoll.getResult().error_levels, statcoll_ref.getResult().error_levels, tol );
+  BOOST_CHECK( (statcoll.getResult().converged_status == statcoll_ref.getResult().converged_status).all() );
+}
+
 BOOST_AUTO_TEST_CASE(convergence_summary)
 {
   typedef Tomographer::ValueHistogramWithBinningMHRWStatsCollectorParams<MyMinimalistValueCalculator>
@@ -623,6 +786,196 @@ BOOST_AUTO_TEST_SUITE_END();
 
 // =============================================================================
 
+// calculates two values at once, sqrt(pt) and pt/2, and counts how often it is invoked
+struct MyMinimalistMultiValueCalculator {
+  typedef double ValueType;
+  MyMinimalistMultiValueCalculator(int * num_calls_) : num_calls(num_calls_) { }
+  int * num_calls;
+  Eigen::Index numValues() const { return 2; }
+  void getValues(int pt, Eigen::ArrayXd & values) const {
+    ++ *num_calls;
+    values(0) = std::sqrt(double(pt));
+    values(1) = pt / 2.0;
+  }
+};
+
+// calculates no values at all; it should never be invoked
+struct MyEmptyMultiValueCalculator {
+  typedef double ValueType;
+  MyEmptyMultiValueCalculator(int * num_calls_) : num_calls(num_calls_) { }
+  int * num_calls;
+  Eigen::Index numValues() const { return 0; }
+  void getValues(int /*pt*/, Eigen::ArrayXd & /*values*/) const {
+    ++ *num_calls;
+  }
+};
+
+struct MyMinimalistHalfValueCalculator {
+  typedef double ValueType;
+  MyMinimalistHalfValueCalculator() { }
+  double getValue(int pt) const {
+    return pt / 2.0;
+  };
+};
+
+BOOST_AUTO_TEST_SUITE(tMultipleValueHistogramsWithBinningMHRWStatsCollector)
+
+BOOST_FIXTURE_TEST_CASE(simple, TestStatsCollectorFixture)
+{
+  Tomographer::Logger::BoostTestLogger logger;
+  int num_calls = 0;
+
+  auto statcoll = Tomographer::mkMultipleValueHistogramsWithBinningMHRWStatsCollector(
+      std::vector<Tomographer::HistogramParams<> >{ Tomographer::HistogramParams<>(0,4,4),
+                                                    Tomographer::HistogramParams<>(0,5,5) },
+      MyMinimalistMultiValueCalculator(&num_calls),
+      2, // number of binning levels
+      logger);
+  BOOST_CHECK_EQUAL(statcoll.numValues(), 2u);
+
+  run_dummy_rw(statcoll);
+
+  // both values are calculated together, once for each sample
+  BOOST_CHECK_EQUAL(num_calls, (int)num_samples);
+
+  // compare with individual collectors for each value
+  auto statcoll_ref0 = Tomographer::mkValueHistogramWithBinningMHRWStatsCollector(
+      Tomographer::HistogramParams<>(0,4,4), MyMinimalistValueCalculator(), 2, logger);
+  run_dummy_rw(statcoll_ref0);
+  auto statcoll_ref1 = Tomographer::mkValueHistogramWithBinningMHRWStatsCollector(
+      Tomographer::HistogramParams<>(0,5,5), MyMinimalistHalfValueCalculator(), 2, logger);
+  run_dummy_rw(statcoll_ref1);
+
+  const auto & result = statcoll.getResult();
+  BOOST_CHECK_EQUAL(result.size(), 2u);
+  MY_BOOST_CHECK_EIGEN_EQUAL(result[0].histogram.bins, statcoll_ref0.getResult().histogram.bins, tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(result[0].histogram.delta, statcoll_ref0.getResult().histogram.delta, tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(result[0].error_levels, statcoll_ref0.getResult().error_levels, tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(result[1].histogram.bins, statcoll_ref1.getResult().histogram.bins, tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(result[1].histogram.delta, statcoll_ref1.getResult().histogram.delta, tol);
+  MY_BOOST_CHECK_FLOATS_EQUAL(result[1].histogram.off_chart, statcoll_ref1.getResult().histogram.off_chart, tol);
+
+  // the collector may be moved around (e.g. returned from a function) safely
+  auto statcoll2 = std::move(statcoll);
+  num_calls = 0;
+  run_dummy_rw(statcoll2);
+  BOOST_CHECK_EQUAL(num_calls, (int)num_samples);
+  MY_BOOST_CHECK_EIGEN_EQUAL(statcoll2.getResult()[1].histogram.bins,
+                             statcoll_ref1.getResult().histogram.bins, tol);
+}
+
+BOOST_FIXTURE_TEST_CASE(no_values, TestStatsCollectorFixture)
+{
+  Tomographer::Logger::BoostTestLogger logger;
+  int num_calls = 0;
+
+  auto statcoll = Tomographer::mkMultipleValueHistogramsWithBinningMHRWStatsCollector(
+      std::vector<Tomographer::HistogramParams<> >(),
+      MyEmptyMultiValueCalculator(&num_calls),
+      2, // number of binning levels
+      logger);
+  BOOST_CHECK_EQUAL(statcoll.numValues(), 0u);
+
+  run_dummy_rw(statcoll);
+
+  BOOST_CHECK_EQUAL(num_calls, 0);
+  BOOST_CHECK_EQUAL(statcoll.getResult().size(), 0u);
+}
+
+BOOST_FIXTURE_TEST_CASE(adaptive_range, TestStatsCollectorFixture)
+{
+  Tomographer::Logger::BoostTestLogger logger;
+  int num_calls = 0;
+  typedef Tomographer::MultipleValueHistogramsWithBinningMHRWStatsCollector<
+    MyMinimalistMultiValueCalculator, int, double, Tomographer::Logger::BoostTestLogger
+    > MyStatsCollector;
+  const double inf = std::numeric_limits<double>::infinity();
+
+  MyStatsCollector statcoll({ MyStatsCollector::HistogramParams(0,100,4),
+                              MyStatsCollector::HistogramParams(0,5,5) },
+                            MyMinimalistMultiValueCalculator(&num_calls),
+                            2,
+                            logger,
+                            { MyStatsCollector::AdaptiveRange(16, 16, -inf, inf, 0.0),
+                              MyStatsCollector::AdaptiveRange() });
+
+  run_dummy_rw(statcoll);
+
+  // pilot values are calculated once per thermalization iteration (the dummy random walk
+  // has no sweep size), and once per live sample
+  BOOST_CHECK_EQUAL(num_calls, 3 + (int)num_samples);
+
+  // see tValueHistogramWithBinningMHRWStatsCollector/adaptive_range_overflow
+  const auto & result = statcoll.getResult();
+  MY_BOOST_CHECK_FLOATS_EQUAL( result[0].histogram.params.min, 0.0, tol );
+  MY_BOOST_CHECK_FLOATS_EQUAL( result[0].histogram.params.max, 3.0, tol );
+  BOOST_CHECK_EQUAL( result[0].histogram.params.num_bins, 6 );
+  MY_BOOST_CHECK_FLOATS_EQUAL( result[1].histogram.params.min, 0.0, tol );
+  MY_BOOST_CHECK_FLOATS_EQUAL( result[1].histogram.params.max, 5.0, tol );
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+
+
+BOOST_AUTO_TEST_SUITE(tValueHistogram2DWithBinningMHRWStatsCollector)
+
+BOOST_FIXTURE_TEST_CASE(simple, TestStatsCollectorFixture)
+{
+  Tomographer::Logger::BoostTestLogger logger;
+  typedef Tomographer::HistogramParams<> AxisParams;
+
+  auto statcoll = Tomographer::mkValueHistogram2DWithBinningMHRWStatsCollector(
+      Tomographer::Histogram2DParams<>(AxisParams(0,4,4), AxisParams(0,5,5)),
+      MyMinimalistValueCalculator(),
+      MyMinimalistHalfValueCalculator(),
+      2, // number of binning levels
+      logger);
+
+  run_dummy_rw(statcoll);
+
+  BOOST_CHECK_EQUAL( (int)statcoll.histogram().totalCounts(), (int)num_samples) ;
+  BOOST_MESSAGE("The collected counts are:\n" << statcoll.histogram().countsArray()) ;
+
+  // the marginal along x is the 1-D histogram of the first value
+  auto statcoll_ref = Tomographer::mkValueHistogramWithBinningMHRWStatsCollector(
+      AxisParams(0,4,4), MyMinimalistValueCalculator(), 2, logger);
+  run_dummy_rw(statcoll_ref);
+  BOOST_CHECK( (statcoll.histogram().countsArray().rowwise().sum() == statcoll_ref.histogram().bins).all() );
+
+  const auto & result = statcoll.getResult();
+  BOOST_CHECK_EQUAL(result.histogram.numBinsX(), 4);
+  BOOST_CHECK_EQUAL(result.histogram.numBinsY(), 5);
+  MY_BOOST_CHECK_FLOATS_EQUAL(result.histogram.bins.sum() + result.histogram.off_chart, 1.0, tol);
+  BOOST_CHECK_EQUAL(result.error_levels.rows(), 20);
+  BOOST_CHECK_EQUAL(result.error_levels.cols(), 3); // two levels of binning
+  BOOST_CHECK_EQUAL(result.converged_status.rows(), 20);
+}
+
+BOOST_FIXTURE_TEST_CASE(single_y_bin, TestStatsCollectorFixture)
+{
+  // with a single bin covering all values along y, we recover the 1-D collector exactly
+  Tomographer::Logger::BoostTestLogger logger;
+  typedef Tomographer::HistogramParams<> AxisParams;
+  typedef Tomographer::ValueHistogram2DWithBinningMHRWStatsCollector<
+    MyMinimalistValueCalculator, MyMinimalistHalfValueCalculator, int, double, Tomographer::Logger::BoostTestLogger
+    > MyStatsCollector;
+
+  MyStatsCollector statcoll(MyStatsCollector::HistogramParams(AxisParams(0,4,4), AxisParams(0,100,1)),
+                            MyMinimalistValueCalculator(), MyMinimalistHalfValueCalculator(), 2, logger);
+  run_dummy_rw(statcoll);
+
+  auto statcoll_ref = Tomographer::mkValueHistogramWithBinningMHRWStatsCollector(
+      AxisParams(0,4,4), MyMinimalistValueCalculator(), 2, logger);
+  run_dummy_rw(statcoll_ref);
+
+  MY_BOOST_CHECK_EIGEN_EQUAL(statcoll.getResult().histogram.bins, statcoll_ref.getResult().histogram.bins, tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(statcoll.getResult().histogram.delta, statcoll_ref.getResult().histogram.delta, tol);
+  MY_BOOST_CHECK_EIGEN_EQUAL(statcoll.getResult().error_levels, statcoll_ref.getResult().error_levels, tol);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+
+
 BOOST_AUTO_TEST_SUITE(tMHRWStatsCollector_status)
 
 BOOST_AUTO_TEST_CASE(base_multi_status)
@@ -678,6 +1031,52 @@ BOOST_FIXTURE_TEST_CASE(status_for_valuehistogrambinning, TestStatsCollectorFixt
       "0|.x# |4   err(cnvg/?/x): 0/4/0");
 }
 
+
+BOOST_FIXTURE_TEST_CASE(status_for_multiplevaluehistograms, TestStatsCollectorFixture)
+{
+  Tomographer::Logger::BoostTestLogger logger;
+  int num_calls = 0;
+
+  auto statcoll = Tomographer::mkMultipleValueHistogramsWithBinningMHRWStatsCollector(
+      std::vector<Tomographer::HistogramParams<> >{ Tomographer::HistogramParams<>(0,4,4),
+                                                    Tomographer::HistogramParams<>(0,5,5) },
+      MyMinimalistMultiValueCalculator(&num_calls),
+      2, // number of binning levels
+      logger);
+
+  run_dummy_rw(statcoll);
+
+  typedef Tomographer::Tools::StatusQuery<decltype(statcoll)> StatusQuery;
+  BOOST_CHECK( StatusQuery::CanProvideStatusLine ) ;
+  const std::string status = StatusQuery::getStatusLine(&statcoll);
+  BOOST_MESSAGE("Status line:\n" << status) ;
+  // one line per value
+  const std::size_t nl = status.find('\n');
+  BOOST_CHECK( nl != std::string::npos && status.find('\n', nl+1) == std::string::npos ) ;
+  BOOST_CHECK_EQUAL( status.substr(0, nl), "0|.x# |4   err(cnvg/?/x): 0/4/0" ) ;
+}
+
+BOOST_FIXTURE_TEST_CASE(status_for_valuehistogram2d, TestStatsCollectorFixture)
+{
+  Tomographer::Logger::BoostTestLogger logger;
+  typedef Tomographer::HistogramParams<> AxisParams;
+
+  auto statcoll = Tomographer::mkValueHistogram2DWithBinningMHRWStatsCollector(
+      Tomographer::Histogram2DParams<>(AxisParams(0,4,4), AxisParams(0,2,2)),
+      MyMinimalistValueCalculator(),
+      MyMinimalistHalfValueCalculator(),
+      2, // number of binning levels
+      logger);
+
+  run_dummy_rw(statcoll);
+
+  typedef Tomographer::Tools::StatusQuery<decltype(statcoll)> StatusQuery;
+  BOOST_CHECK( StatusQuery::CanProvideStatusLine ) ;
+  const std::string status = StatusQuery::getStatusLine(&statcoll);
+  BOOST_MESSAGE("Status line:\n" << status) ;
+  BOOST_CHECK_EQUAL( status.substr(0, 37), "4x2 bins, 16 samples, 62.5% off chart" ) ;
+}
+
 BOOST_AUTO_TEST_SUITE_END();
 
 // =============================================================================
@@ -0,0 +1,292 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+
+#include <string>
+#include <iostream>
+#include <random>
+
+// definitions for Tomographer test framework -- this must be included before any
+// <Eigen/...> or <tomographer/...> header
+#include "test_tomographer.h"
+
+#include <tomographer/mhrwsweepsizecontroller.h>
+#include <tomographer/mhrwstepsizecontroller.h>
+#include <tomographer/mhrwstatscollectors.h>
+#include <tomographer/tools/boost_test_logger.h>
+
+
+
+// -----------------------------------------------------------------------------
+// fixture(s)
+
+struct SimulatorAutocorrStatsColl
+{
+  bool enabled;
+  bool has_estimate;
+  double tau_int;
+  int converged_status;
+
+  // called by the controller
+  inline bool isEnabled() const { return enabled; }
+  inline bool hasEstimate() const { return has_estimate; }
+  inline double tauIntIterations() const { return has_estimate ? tau_int : std::nan(""); }
+  inline int convergedStatus() const { return converged_status; }
+  inline int probeStride() const { return 10; }
+};
+
+struct DummyMHWalker { };
+struct DummyMHRandomWalk { };
+
+struct mhrwsweepsizectrl_fixture
+{
+  SimulatorAutocorrStatsColl autocorr{true, true, 36.2, Tomographer::BINNING_CONVERGED};
+
+  Tomographer::Logger::BoostTestLogger logger{Tomographer::Logger::LONGDEBUG};
+
+  DummyMHWalker dmhwalker;
+  DummyMHRandomWalk drw;
+
+  Tomographer::MHRWParams<Tomographer::MHWalkerParamsStepSize<double>,long> p{0.01, 150, 2048, 32768};
+};
+
+
+// the value calculator for the points of the dummy random walk below
+struct IdentValueCalculator
+{
+  typedef double ValueType;
+  inline double getValue(double pt) const { return pt; }
+};
+
+// provides what MHRWThermalizingAutocorrelationStatsCollector needs to know about the
+// random walk
+struct DummyMHRWWithParams
+{
+  long n_sweep;
+  long n_therm;
+  inline long nSweep() const { return n_sweep; }
+  inline long nTherm() const { return n_therm; }
+};
+
+
+// a Metropolis-Hastings walk on the real line, with a Gaussian target distribution.  The
+// smaller the step size, the longer the autocorrelation time (in iterations).
+struct GaussianMHWalker
+{
+  typedef double PointType;
+  typedef double FnValueType;
+  typedef Tomographer::MHWalkerParamsStepSize<double> WalkerParams;
+  enum { UseFnSyntaxType = Tomographer::MHUseFnLogValue };
+
+  std::mt19937 & rng;
+  std::normal_distribution<double> normal;
+
+  GaussianMHWalker(std::mt19937 & rng_) : rng(rng_), normal(0.0, 1.0) { }
+
+  inline void init() { }
+  inline double startPoint() { return 0.0; }
+  inline void thermalizingDone() { }
+  inline void done() { }
+
+  inline double jumpFn(double curpt, WalkerParams params)
+  {
+    return curpt + params.step_size * normal(rng);
+  }
+  inline double fnLogVal(double x) const
+  {
+    return -x*x/2;
+  }
+};
+
+
+// -----------------------------------------------------------------------------
+// test suites
+
+
+BOOST_AUTO_TEST_SUITE(test_mhrwsweepsizecontroller)
+
+BOOST_AUTO_TEST_SUITE(controller)
+
+BOOST_FIXTURE_TEST_CASE(constmembers, mhrwsweepsizectrl_fixture)
+{
+  auto ctrl = Tomographer::mkMHRWSweepSizeController<long>(autocorr, logger);
+  // adjusts params while thermalizing, but never after iterations or samples
+  BOOST_CHECK_EQUAL( (int)ctrl.AdjustmentStrategy, (int)Tomographer::MHRWControllerAdjustWhileThermalizing ) ;
+  // so that it can be combined with MHRWStepSizeController
+  typedef Tomographer::MHRWStepSizeController<Tomographer::MHRWMovingAverageAcceptanceRatioStatsCollector<long>,
+                                              Tomographer::Logger::BoostTestLogger, double, long>
+    StepSizeCtrlType;
+  BOOST_CHECK( (Tomographer::tomo_internal::controllers_compatible<StepSizeCtrlType, decltype(ctrl)>::value) );
+  BOOST_CHECK( (Tomographer::tomo_internal::controllers_compatible<decltype(ctrl), StepSizeCtrlType>::value) );
+  BOOST_CHECK( ! (Tomographer::tomo_internal::controllers_compatible<StepSizeCtrlType, StepSizeCtrlType>::value) );
+}
+
+BOOST_FIXTURE_TEST_CASE(sets_n_sweep, mhrwsweepsizectrl_fixture)
+{
+  auto ctrl = Tomographer::mkMHRWSweepSizeController<long>(autocorr, logger);
+
+  ctrl.init(p, dmhwalker, drw);
+  BOOST_CHECK_EQUAL(p.n_sweep, 150);
+  BOOST_CHECK(ctrl.allowDoneThermalization(p, dmhwalker, 150L*2048, drw));
+  BOOST_CHECK_EQUAL(p.n_sweep, 150);
+  BOOST_CHECK_EQUAL(ctrl.getLastSetNSweep(), 0);
+
+  ctrl.thermalizingDone(p, dmhwalker, drw);
+  BOOST_CHECK_EQUAL(p.n_sweep, 73); // ceil(2*36.2)
+  BOOST_CHECK_EQUAL(p.n_run, 32768);
+  BOOST_CHECK_EQUAL(ctrl.getLastSetNSweep(), 73);
+  BOOST_CHECK_CLOSE(ctrl.getLastTauInt(), 36.2, tol_percent);
+
+  BOOST_CHECK_EQUAL(Tomographer::Tools::StatusProvider<decltype(ctrl)>::getStatusLine(&ctrl),
+                    "sweep size = 73 (tau_int = 36.2 iter.)");
+}
+
+BOOST_FIXTURE_TEST_CASE(limits, mhrwsweepsizectrl_fixture)
+{
+  auto ctrl = Tomographer::mkMHRWSweepSizeController<long>(autocorr, logger, 2.0, 5L, 40L);
+  ctrl.init(p, dmhwalker, drw);
+  ctrl.thermalizingDone(p, dmhwalker, drw);
+  BOOST_CHECK_EQUAL(p.n_sweep, 40);
+
+  autocorr.tau_int = 0.5;
+  ctrl.thermalizingDone(p, dmhwalker, drw);
+  BOOST_CHECK_EQUAL(p.n_sweep, 5);
+}
+
+BOOST_FIXTURE_TEST_CASE(waits_for_convergence, mhrwsweepsizectrl_fixture)
+{
+  auto ctrl = Tomographer::mkMHRWSweepSizeController<long>(autocorr, logger);
+  ctrl.init(p, dmhwalker, drw);
+
+  autocorr.converged_status = Tomographer::BINNING_NOT_CONVERGED;
+  BOOST_CHECK(!ctrl.allowDoneThermalization(p, dmhwalker, 150L*2048, drw));
+  BOOST_CHECK(!ctrl.allowDoneThermalization(p, dmhwalker, 150L*3000, drw));
+  // but not forever
+  BOOST_CHECK(ctrl.allowDoneThermalization(p, dmhwalker, 150L*3100, drw));
+
+  autocorr.has_estimate = false;
+  BOOST_CHECK(!ctrl.allowDoneThermalization(p, dmhwalker, 150L*2048, drw));
+
+  autocorr.has_estimate = true;
+  autocorr.converged_status = Tomographer::BINNING_UNKNOWN_CONVERGENCE;
+  BOOST_CHECK(ctrl.allowDoneThermalization(p, dmhwalker, 150L*2048, drw));
+}
+
+BOOST_FIXTURE_TEST_CASE(disabled, mhrwsweepsizectrl_fixture)
+{
+  auto ctrl = Tomographer::mkMHRWSweepSizeController<long>(autocorr, logger);
+  autocorr.enabled = false;
+  autocorr.has_estimate = false;
+  ctrl.init(p, dmhwalker, drw);
+  BOOST_CHECK(ctrl.allowDoneThermalization(p, dmhwalker, 150L*2048, drw));
+  ctrl.thermalizingDone(p, dmhwalker, drw);
+  BOOST_CHECK_EQUAL(p.n_sweep, 150);
+  BOOST_CHECK_EQUAL(Tomographer::Tools::StatusProvider<decltype(ctrl)>::getStatusLine(&ctrl), "");
+}
+
+BOOST_AUTO_TEST_SUITE_END() // controller
+
+BOOST_AUTO_TEST_CASE(thermalizing_stats_collector)
+{
+  auto statcoll = Tomographer::mkMHRWThermalizingAutocorrelationStatsCollector<long>(IdentValueCalculator());
+  BOOST_CHECK(statcoll.isEnabled());
+
+  std::mt19937 rng(1234);
+  std::normal_distribution<double> noise(0.0, 1.0);
+
+  // feed the collector with an AR(1) process with tau_int = (1+phi)/(2(1-phi)) = 19.5
+  // iterations
+  const double phi = 0.95;
+  DummyMHRWWithParams rw{40, 8192};
+  double x = 0;
+  statcoll.init();
+  for (long k = 0; k < rw.n_sweep*rw.n_therm; ++k) {
+    if (k == rw.n_sweep*rw.n_therm*3/4 - 1) {
+      BOOST_CHECK(statcoll.hasEstimate());
+      BOOST_CHECK_EQUAL(statcoll.probeStride(), 5);
+      // pretend the parameters change, which should restart the analysis
+      rw.n_sweep = 32;
+    }
+    x = phi*x + noise(rng);
+    statcoll.rawMove(k, true, false, true, 1.0, 0.0, 0.0, x, 0.0, rw);
+  }
+  statcoll.thermalizingDone();
+  // nothing is measured during live runs
+  const long num_probes = (long)statcoll.getAnalysis().numSamples();
+  statcoll.rawMove(0L, false, true, true, 1.0, 0.0, 0.0, x, 0.0, rw);
+  BOOST_CHECK_EQUAL((long)statcoll.getAnalysis().numSamples(), num_probes);
+
+  BOOST_CHECK_EQUAL(statcoll.probeStride(), 4);
+  // probes restarted at 3/4 of 40*8192 iterations, with a stride of 4
+  BOOST_CHECK_EQUAL(num_probes, 40*8192/4/4 - 32*8192/4/4);
+  BOOST_MESSAGE("tau_int = " << statcoll.tauIntIterations());
+  BOOST_CHECK_CLOSE(statcoll.tauIntIterations(), 19.5, 25);
+}
+
+BOOST_AUTO_TEST_CASE(random_walk)
+{
+  Tomographer::Logger::BoostTestLogger logger(Tomographer::Logger::DEBUG);
+  std::mt19937 rng(5678);
+  GaussianMHWalker mhwalker(rng);
+
+  // run with the step size controller, as in tomorun
+  Tomographer::MHRWMovingAverageAcceptanceRatioStatsCollector<long> movavg_accept_stats(1024);
+  auto ctrl_step = Tomographer::mkMHRWStepSizeController<
+    Tomographer::MHRWParams<Tomographer::MHWalkerParamsStepSize<double>,long> >(movavg_accept_stats, logger);
+
+  auto autocorr_stats = Tomographer::mkMHRWThermalizingAutocorrelationStatsCollector<long>(
+      IdentValueCalculator(), 8
+      );
+  auto ctrl_sweep = Tomographer::mkMHRWSweepSizeController<long>(autocorr_stats, logger);
+
+  // measure the autocorrelation time of the live samples, in units of sweeps
+  Tomographer::MHRWAutocorrelationStatsCollector<void, long> live_autocorr(Tomographer::Logger::vacuum_logger);
+
+  auto stats = Tomographer::mkMultipleMHRWStatsCollectors(movavg_accept_stats, autocorr_stats, live_autocorr);
+  auto ctrl = Tomographer::mkMHRWMultipleControllers(ctrl_step, ctrl_sweep);
+
+  // start with a far too long sweep
+  Tomographer::MHRandomWalk<std::mt19937, GaussianMHWalker, decltype(stats), decltype(ctrl),
+                            Tomographer::Logger::BoostTestLogger, long>
+    rwalk(Tomographer::MHWalkerParamsStepSize<double>(0.5), 200, 512, 32768,
+          mhwalker, stats, ctrl, rng, logger);
+
+  rwalk.run();
+
+  BOOST_MESSAGE("Final params: " << rwalk.mhrwParams() << ", tau_int = " << ctrl_sweep.getLastTauInt());
+  BOOST_CHECK_EQUAL(rwalk.nSweep(), ctrl_sweep.getLastSetNSweep());
+  BOOST_CHECK_LT(rwalk.nSweep(), 100);
+  BOOST_CHECK_GT(rwalk.nSweep(), 2);
+
+  // live samples are now approximately independent
+  const auto result = live_autocorr.getResult();
+  BOOST_MESSAGE("Live samples: tau_int = " << result.tau_int(0));
+  BOOST_CHECK_LT(result.tau_int(0), 1.0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
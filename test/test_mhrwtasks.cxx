@@ -31,8 +31,11 @@
 #include <iostream>
 #include <random>
 #include <algorithm>
+#include <sstream>
 
 #include <boost/math/constants/constants.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
 
 // definitions for Tomographer test framework -- this must be included before any
 // <Eigen/...> or <tomographer/...> header
@@ -363,6 +366,79 @@ BOOST_AUTO_TEST_CASE(base)
 
 BOOST_AUTO_TEST_SUITE_END(); // tMHRandomWalkTask
 
+// -----------------------------------------------
+
+BOOST_AUTO_TEST_SUITE(tMHRandomWalkTaskResult) ;
+
+typedef Tomographer::MHRWTasks::MHRandomWalkTaskResult<bool, int, int> SerTaskResultType;
+
+// the layout of MHRandomWalkTaskResult before the autocorrelation analysis was added
+// (class version 0)
+struct OldTaskResult
+{
+  bool stats_results;
+  Tomographer::MHRWParams<int,int> mhrw_params;
+  double acceptance_ratio;
+
+  template<typename Archive>
+  void serialize(Archive & a, unsigned int /* version */)
+  {
+    a & stats_results;
+    a & mhrw_params;
+    a & acceptance_ratio;
+  }
+};
+
+BOOST_AUTO_TEST_CASE(serialize_autocorrelation)
+{
+  Tomographer::StreamingAutocorrelationAnalysis<double, int> analysis(1, 2);
+  for (int n = 0; n < 16; ++n) {
+    analysis.processNewValues(Eigen::Array<double,1,1>::Constant(n % 3));
+  }
+  SerTaskResultType result(true, Tomographer::MHRWParams<int,int>(2, 10, 50, 100), 0.3);
+  result.autocorrelation = Tomographer::MHRWAutocorrelationResult(analysis, {"fn value"});
+
+  std::stringstream stream;
+  {
+    boost::archive::binary_oarchive oa(stream);
+    oa << result;
+  }
+  SerTaskResultType result2;
+  {
+    boost::archive::binary_iarchive ia(stream);
+    ia >> result2;
+  }
+  BOOST_CHECK_EQUAL(result2.stats_results, true);
+  BOOST_CHECK_EQUAL(result2.mhrw_params.n_run, 100);
+  BOOST_CHECK_EQUAL(result2.acceptance_ratio, 0.3);
+  BOOST_CHECK(result2.autocorrelation.isValid());
+  BOOST_CHECK_EQUAL(result2.autocorrelation.num_samples, 16);
+  BOOST_CHECK_EQUAL(result2.autocorrelation.labels[0], "fn value");
+}
+
+BOOST_AUTO_TEST_CASE(load_version_0)
+{
+  OldTaskResult old{true, Tomographer::MHRWParams<int,int>(2, 10, 50, 100), 0.3};
+
+  std::stringstream stream;
+  {
+    boost::archive::binary_oarchive oa(stream);
+    oa << old;
+  }
+  SerTaskResultType result;
+  {
+    boost::archive::binary_iarchive ia(stream);
+    ia >> result;
+  }
+  BOOST_CHECK_EQUAL(result.stats_results, true);
+  BOOST_CHECK_EQUAL(result.mhrw_params.n_sweep, 10);
+  BOOST_CHECK_EQUAL(result.mhrw_params.n_run, 100);
+  BOOST_CHECK_EQUAL(result.acceptance_ratio, 0.3);
+  BOOST_CHECK(!result.autocorrelation.isValid());
+}
+
+BOOST_AUTO_TEST_SUITE_END(); // tMHRandomWalkTaskResult
+
 // =============================================================================
 BOOST_AUTO_TEST_SUITE_END() ;
 
@@ -0,0 +1,273 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+
+#include <string>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// definitions for Tomographer test framework -- this must be included before any
+// <Eigen/...> or <tomographer/...> header
+#include "test_tomographer.h"
+
+#include <tomographer/mhrwtempering.h>
+#include <tomographer/mhrwtasks.h>
+#include <tomographer/mhrwstatscollectors.h>
+#include <tomographer/multiproc.h>
+#include <tomographer/tools/loggers.h>
+
+
+
+// -----------------------------------------------------------------------------
+// fixture(s)
+
+
+// A random walk on the real line, for the distribution with two very narrow peaks at
+// x=-Center and x=+Center.  A plain Metropolis-Hastings random walk with small steps
+// essentially never crosses from one peak to the other.
+struct DoubleWellMHWalker
+{
+  typedef double PointType;
+  typedef double WalkerParams;
+  typedef double FnValueType;
+  enum { UseFnSyntaxType = Tomographer::MHUseFnLogValue };
+
+  static constexpr double Center = 5.0;
+  static constexpr double Width = 0.3;
+
+  std::mt19937 & rng;
+  std::normal_distribution<double> normdist;
+
+  DoubleWellMHWalker(std::mt19937 & rng_) : rng(rng_), normdist() { }
+
+  inline void init() { }
+  inline void thermalizingDone() { }
+  inline void done() { }
+
+  // always start in the right-hand peak
+  inline PointType startPoint() { return Center; }
+
+  inline PointType jumpFn(PointType curpt, WalkerParams step_size)
+  {
+    return curpt + step_size * normdist(rng);
+  }
+
+  inline FnValueType fnLogVal(PointType x) const
+  {
+    const double a = (x - Center) / Width;
+    const double b = (x + Center) / Width;
+    // log( exp(-a^2/2) + exp(-b^2/2) ), computed safely
+    const double m = std::max(-a*a/2, -b*b/2);
+    return m + std::log(std::exp(-a*a/2 - m) + std::exp(-b*b/2 - m));
+  }
+};
+constexpr double DoubleWellMHWalker::Center;
+constexpr double DoubleWellMHWalker::Width;
+
+// Counts the samples in the right-hand peak, and the number of calls
+struct PeakStatsCollector
+{
+  typedef double ResultType;
+
+  int num_samples;
+  int num_right;
+  int num_raw_moves;
+
+  PeakStatsCollector() : num_samples(0), num_right(0), num_raw_moves(0) { }
+
+  inline void init() { }
+  inline void thermalizingDone() { }
+  inline void done() { }
+
+  template<typename CountIntType, typename MHRandomWalk>
+  inline void rawMove(CountIntType /*k*/, bool /*is_thermalizing*/, bool /*is_live_iter*/, bool /*accepted*/,
+                      double /*a*/, double /*newpt*/, double /*newptval*/, double /*curpt*/,
+                      double /*curptval*/, MHRandomWalk & /*rw*/)
+  {
+    ++num_raw_moves;
+  }
+
+  template<typename CountIntType, typename MHRandomWalk>
+  inline void processSample(CountIntType /*k*/, CountIntType /*n*/, double curpt, double /*curptval*/,
+                            MHRandomWalk & /*rw*/)
+  {
+    ++num_samples;
+    if (curpt > 0) {
+      ++num_right;
+    }
+  }
+
+  inline bool isFinalized() const { return true; }
+  inline ResultType getResult() const { return (double)num_right / num_samples; }
+  inline ResultType stealResult() { return getResult(); }
+};
+
+
+struct DoubleWellCData : public Tomographer::MHRWTasks::CDataBase<double>
+{
+  typedef double MHRWStatsResultsType;
+
+  std::vector<double> tempering_betas;
+
+  DoubleWellCData(std::vector<double> tempering_betas_)
+    : Tomographer::MHRWTasks::CDataBase<double>(Tomographer::MHRWParams<double,int>(0.3, 10, 100, 2000), 1234),
+      tempering_betas(std::move(tempering_betas_))
+  {
+  }
+
+  template<typename Rng, typename LoggerType, typename ExecFn>
+  inline void setupRandomWalkAndRun(Rng & rng, LoggerType & /*logger*/, ExecFn run) const
+  {
+    DoubleWellMHWalker mhwalker(rng);
+    PeakStatsCollector stats;
+    Tomographer::MHRWNoController ctrl;
+    run(mhwalker, stats, ctrl, tempering_betas);
+  }
+};
+
+
+
+// -----------------------------------------------------------------------------
+// test suites
+
+BOOST_AUTO_TEST_SUITE(test_mhrwtempering)
+// =============================================================================
+
+BOOST_AUTO_TEST_CASE(geometric_ladder)
+{
+  const std::vector<double> betas = Tomographer::geometricTemperingLadder(5, 1e-4);
+  BOOST_CHECK_EQUAL(betas.size(), 5u);
+  MY_BOOST_CHECK_FLOATS_EQUAL(betas[0], 1.0, tol);
+  MY_BOOST_CHECK_FLOATS_EQUAL(betas[1], 0.1, tol);
+  MY_BOOST_CHECK_FLOATS_EQUAL(betas[2], 0.01, tol);
+  MY_BOOST_CHECK_FLOATS_EQUAL(betas[3], 0.001, tol);
+  MY_BOOST_CHECK_FLOATS_EQUAL(betas[4], 1e-4, tol);
+
+  const std::vector<double> betas1 = Tomographer::geometricTemperingLadder(1, 0.5);
+  BOOST_CHECK_EQUAL(betas1.size(), 1u);
+  MY_BOOST_CHECK_FLOATS_EQUAL(betas1[0], 1.0, tol);
+}
+
+BOOST_AUTO_TEST_CASE(single_replica)
+{
+  // with a single replica, this is a plain Metropolis-Hastings random walk which stays
+  // stuck in the peak it starts in
+  std::mt19937 rng(42);
+  std::mt19937 rng2(43);
+  Tomographer::Logger::VacuumLogger logger;
+
+  DoubleWellMHWalker mhwalker(rng2);
+  PeakStatsCollector stats;
+  Tomographer::MHRWNoController ctrl;
+
+  Tomographer::MHRandomWalkTempering<std::mt19937, DoubleWellMHWalker, PeakStatsCollector,
+                                     Tomographer::MHRWNoController, Tomographer::Logger::VacuumLogger, int>
+    rw(Tomographer::MHRWParams<double,int>(0.3, 10, 100, 2000), std::vector<double>{1.0},
+       mhwalker, stats, ctrl, rng, logger);
+
+  BOOST_CHECK_EQUAL(rw.numReplicas(), 1u);
+  BOOST_CHECK(!rw.hasAcceptanceRatio());
+
+  rw.run();
+
+  BOOST_CHECK_EQUAL(stats.num_samples, 2000);
+  BOOST_CHECK_EQUAL(stats.num_raw_moves, 10*(100+2000));
+  BOOST_CHECK_EQUAL(stats.num_right, stats.num_samples);
+  BOOST_CHECK(rw.hasAcceptanceRatio());
+  BOOST_MESSAGE("Acceptance ratio = " << rw.acceptanceRatio());
+}
+
+BOOST_AUTO_TEST_CASE(replicas_mix)
+{
+  std::mt19937 rng(42);
+  std::mt19937 rng2(43);
+  Tomographer::Logger::VacuumLogger logger;
+
+  DoubleWellMHWalker mhwalker(rng2);
+  PeakStatsCollector stats;
+  Tomographer::MHRWNoController ctrl;
+
+  const std::vector<double> betas = Tomographer::geometricTemperingLadder(6, 0.002);
+
+  Tomographer::MHRandomWalkTempering<std::mt19937, DoubleWellMHWalker, PeakStatsCollector,
+                                     Tomographer::MHRWNoController, Tomographer::Logger::VacuumLogger, int>
+    rw(Tomographer::MHRWParams<double,int>(0.3, 10, 100, 4000), betas,
+       mhwalker, stats, ctrl, rng, logger);
+
+  BOOST_CHECK_EQUAL(rw.numReplicas(), 6u);
+  MY_BOOST_CHECK_FLOATS_EQUAL(rw.beta(0), 1.0, tol);
+
+  rw.run();
+
+  // only the beta=1 replica is reported to the stats collector
+  BOOST_CHECK_EQUAL(stats.num_samples, 4000);
+  BOOST_CHECK_EQUAL(stats.num_raw_moves, 10*(100+4000));
+
+  // both peaks have the same weight
+  const double fright = (double)stats.num_right / stats.num_samples;
+  BOOST_MESSAGE("Fraction of samples in the right peak = " << fright);
+  BOOST_CHECK_GT(fright, 0.3);
+  BOOST_CHECK_LT(fright, 0.7);
+
+  // the beta=1 replica still samples the peaks themselves
+  BOOST_CHECK_LT(std::abs(std::abs(rw.getCurrentPoint()) - DoubleWellMHWalker::Center),
+                 5*DoubleWellMHWalker::Width);
+
+  for (std::size_t i = 0; i + 1 < rw.numReplicas(); ++i) {
+    BOOST_MESSAGE("beta = " << rw.beta(i) << ": acceptance ratio = " << rw.replicaAcceptanceRatio(i)
+                  << ", exchange acceptance ratio with next = " << rw.swapAcceptanceRatio(i));
+    BOOST_CHECK_GT(rw.swapAcceptanceRatio(i), 0.0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(task)
+{
+  typedef Tomographer::MHRWTasks::MHRandomWalkTask<DoubleWellCData, std::mt19937> TaskType;
+
+  Tomographer::Logger::BufferLogger buflog(Tomographer::Logger::DEBUG);
+
+  DoubleWellCData cdata(Tomographer::geometricTemperingLadder(6, 0.002));
+
+  Tomographer::MultiProc::Sequential::TaskDispatcher<TaskType, DoubleWellCData,
+                                                     Tomographer::Logger::BufferLogger, long>
+    tasks(&cdata, buflog, 2);
+
+  tasks.run();
+
+  BOOST_MESSAGE(buflog.getContents());
+
+  for (const auto * r : tasks.collectedTaskResults()) {
+    BOOST_MESSAGE("Fraction of samples in the right peak = " << r->stats_results);
+    BOOST_CHECK_GT(r->stats_results, 0.3);
+    BOOST_CHECK_LT(r->stats_results, 0.7);
+    BOOST_CHECK(r->acceptance_ratio > 0 && r->acceptance_ratio < 1);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
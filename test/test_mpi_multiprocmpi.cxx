@@ -258,11 +258,17 @@ struct test_task_dispatcher_MPI_fixture {
 // test suites
 
 
+// the MPI environment must outlive all test cases (MPI can't be re-initialized)
+struct MPIEnvironmentFixture {
+  mpi::environment env;
+};
+BOOST_GLOBAL_FIXTURE(MPIEnvironmentFixture);
+
+
 BOOST_AUTO_TEST_SUITE(test_mpi_multiprocmpi)
 
 BOOST_FIXTURE_TEST_CASE(tasks_run, test_task_dispatcher_MPI_fixture)
 {
-  mpi::environment env;
   mpi::communicator world;
 
   Tomographer::Logger::FileLogger filelogger(stderr, Tomographer::Logger::DEBUG);//LONGDEBUG);
@@ -302,5 +308,50 @@ BOOST_FIXTURE_TEST_CASE(tasks_run, test_task_dispatcher_MPI_fixture)
   }
 }
 
+BOOST_FIXTURE_TEST_CASE(completed_task_results, test_task_dispatcher_MPI_fixture)
+{
+  mpi::communicator world;
+
+  Tomographer::Logger::FileLogger filelogger(stderr, Tomographer::Logger::DEBUG);
+  typedef Tomographer::Logger::OriginPrefixedLogger<Tomographer::Logger::FileLogger>
+    LoggerType;
+
+  LoggerType logger(filelogger, streamstr(world.rank() << "/" << world.size()<<"|"));
+
+  TestBasicCDataMPI * pcdata = (world.rank() == 0) ? &cData : NULL;
+
+  Tomographer::MultiProc::MPI::TaskDispatcher<TestTaskMPI, TestBasicCDataMPI,
+                                              LoggerType, long>
+    task_dispatcher(pcdata, world, logger, num_runs);
+
+  std::map<int, int> completed_values;
+  if (world.rank() == 0) {
+    // pretend that tasks #1 and #5 were already completed
+    task_dispatcher.setCompletedTaskResult(1, new TestTaskMPI::ResultType(-1));
+    task_dispatcher.setCompletedTaskResult(5, new TestTaskMPI::ResultType(-5));
+    task_dispatcher.setTaskCompletedHandler(
+        [&completed_values](long k, const TestTaskMPI::ResultType & r) {
+          completed_values[(int)k] = r.value;
+        });
+  }
+
+  task_dispatcher.run();
+
+  if (world.rank() == 0) {
+    const std::vector<TestTaskMPI::ResultType*> results = task_dispatcher.collectedTaskResults();
+    BOOST_CHECK_EQUAL(results.size(), correct_result_values.size());
+    for (std::size_t k = 0; k < results.size(); ++k) {
+      if (k == 1 || k == 5) {
+        BOOST_CHECK_EQUAL(results[k]->value, -(int)k);
+        BOOST_CHECK(completed_values.find((int)k) == completed_values.end());
+      } else {
+        BOOST_CHECK_EQUAL(results[k]->value, correct_result_values[k]);
+        BOOST_CHECK_EQUAL(completed_values[(int)k], correct_result_values[k]);
+      }
+    }
+    BOOST_CHECK_EQUAL(completed_values.size(), correct_result_values.size() - 2);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -29,6 +29,7 @@
 #define TEST_MULTI_TASKS_COMMON_H
 
 #include <string>
+#include <map>
 #include <functional>
 #include <chrono>
 
@@ -229,6 +230,39 @@ struct test_task_dispatcher_fixture {
       BOOST_CHECK_EQUAL(task_dispatcher.collectedTaskResult(k).value, correct_result_values[k]) ;
     }
   }
+
+  // pretend that tasks #1 and #5 were already completed, and run the others
+  template<typename TaskDispatcherType>
+  void run_with_completed_task_results(TaskDispatcherType & task_dispatcher)
+  {
+    typedef typename TaskDispatcherType::TaskCountIntType TaskCountIntType;
+
+    task_dispatcher.setCompletedTaskResult(1, new TestTask::ResultType(-1, "precomputed"));
+    task_dispatcher.setCompletedTaskResult(5, new TestTask::ResultType(-5, "precomputed"));
+
+    // (don't use BOOST_CHECK in the handler, which may be called from other threads)
+    std::map<int, int> completed_values;
+    task_dispatcher.setTaskCompletedHandler(
+        [&completed_values](TaskCountIntType k, const TestTask::ResultType & r) {
+          completed_values[(int)k] = r.value;
+        });
+
+    task_dispatcher.run();
+
+    const std::vector<TestTask::ResultType*> results = task_dispatcher.collectedTaskResults();
+    BOOST_CHECK_EQUAL(results.size(), correct_result_values.size());
+    for (std::size_t k = 0; k < correct_result_values.size(); ++k) {
+      if (k == 1 || k == 5) {
+        BOOST_CHECK_EQUAL(results[k]->value, -(int)k);
+        BOOST_CHECK(completed_values.find((int)k) == completed_values.end());
+      } else {
+        BOOST_CHECK_EQUAL(results[k]->value, correct_result_values[k]);
+        BOOST_CHECK(completed_values.find((int)k) != completed_values.end());
+        BOOST_CHECK_EQUAL(completed_values[(int)k], correct_result_values[k]);
+      }
+    }
+    BOOST_CHECK_EQUAL(completed_values.size(), correct_result_values.size() - 2);
+  }
 };
 
 
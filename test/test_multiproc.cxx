@@ -70,6 +70,16 @@ BOOST_FIXTURE_TEST_CASE(runs, test_task_dispatcher_fixture)
   check_correct_results_collected(task_dispatcher);
 }
 
+BOOST_FIXTURE_TEST_CASE(completed_task_results, test_task_dispatcher_fixture)
+{
+  Tomographer::Logger::BoostTestLogger logger(Tomographer::Logger::LONGDEBUG);
+  Tomographer::MultiProc::Sequential::TaskDispatcher<TestTask, TestBasicCData,
+                                                     Tomographer::Logger::BoostTestLogger, long>
+      task_dispatcher(&cData, logger, num_runs);
+
+  run_with_completed_task_results(task_dispatcher);
+}
+
 BOOST_FIXTURE_TEST_SUITE(status_reporting, test_task_dispatcher_status_reporting_fixture) ;
 
 BOOST_AUTO_TEST_CASE(status_report_periodic)
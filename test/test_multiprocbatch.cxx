@@ -0,0 +1,172 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include <string>
+#include <vector>
+#include <map>
+
+// definitions for Tomographer test framework -- this must be included before any
+// <Eigen/...> or <tomographer/...> header
+#include "test_tomographer.h"
+
+#include <tomographer/multiprocbatch.h>
+#include <tomographer/multiproc.h>
+#include <tomographer/multiprocthreads.h>
+
+#include <tomographer/tools/boost_test_logger.h>
+
+#include "test_multi_tasks_common.h"
+
+
+// -----------------------------------------------------------------------------
+// fixture(s)
+
+typedef Tomographer::MultiProc::BatchTaskCData<TestBasicCData> TestBatchCData;
+typedef Tomographer::MultiProc::BatchTask<TestTask, TestBasicCData> TestBatchTask;
+typedef Tomographer::MultiProc::BatchItemResults<TestTaskResultType, TestBasicCData> TestBatchItemResults;
+
+struct test_batch_fixture {
+  // three computations with different constant data and different numbers of tasks; the
+  // second one has no tasks at all
+  TestBasicCData cdata1;
+  TestBasicCData cdata2;
+  TestBasicCData cdata3;
+
+  TestBatchCData batch;
+
+  test_batch_fixture()
+    : cdata1(10), cdata2(20), cdata3(-1), batch()
+  {
+    cdata1.inputs = mkvec<MyTaskInput>() << MyTaskInput(1, 2) << MyTaskInput(3, 4) << MyTaskInput(5, 6);
+    cdata3.inputs = mkvec<MyTaskInput>() << MyTaskInput(1, 0) << MyTaskInput(2, 0) << MyTaskInput(3, 0)
+                                         << MyTaskInput(4, 0) << MyTaskInput(5, 0);
+    batch.addItem(&cdata1, 3);
+    batch.addItem(&cdata2, 0);
+    batch.addItem(&cdata3, 5);
+  }
+
+  // the expected result values of each item
+  std::vector<std::vector<int> > correct_item_values() const
+  {
+    return mkvec<std::vector<int> >()
+      << (std::vector<int>)(mkvec<int>() << 30 << 70 << 110)
+      << std::vector<int>()
+      << (std::vector<int>)(mkvec<int>() << -1 << -2 << -3 << -4 << -5);
+  }
+
+  template<typename TaskDispatcherType>
+  void run_and_check(TaskDispatcherType & tasks)
+  {
+    // (don't use BOOST_CHECK in the handler, which may be called from other threads)
+    std::vector<std::size_t> completed_items;
+    std::map<std::size_t, std::vector<int> > item_values;
+    TestBatchItemResults item_results(
+        &batch,
+        [&](std::size_t i, const std::vector<const TestTaskResultType*> & results) {
+          completed_items.push_back(i);
+          for (auto r : results) {
+            item_values[i].push_back(r != NULL ? r->value : -9999);
+          }
+        });
+    item_results.attach(tasks);
+
+    tasks.run();
+
+    const std::vector<TestTaskResultType*> results = tasks.collectedTaskResults();
+    BOOST_CHECK_EQUAL(results.size(), 8u);
+    BOOST_CHECK_EQUAL(results[0]->value, 30);
+    BOOST_CHECK_EQUAL(results[2]->value, 110);
+    BOOST_CHECK_EQUAL(results[3]->value, -1);
+    BOOST_CHECK_EQUAL(results[7]->value, -5);
+
+    // item #1 has no tasks, so it is never reported
+    BOOST_CHECK_EQUAL(completed_items.size(), 2u);
+    BOOST_CHECK_EQUAL(item_results.numCompletedItems(), 2u);
+    BOOST_CHECK(item_results.itemCompleted(0));
+    BOOST_CHECK(item_results.itemCompleted(2));
+    const auto correct = correct_item_values();
+    for (std::size_t i : {(std::size_t)0, (std::size_t)2}) {
+      BOOST_CHECK_EQUAL_COLLECTIONS(item_values[i].begin(), item_values[i].end(),
+                                    correct[i].begin(), correct[i].end());
+    }
+  }
+};
+
+
+// -----------------------------------------------------------------------------
+// test suites
+
+
+BOOST_AUTO_TEST_SUITE(t__MultiProc__Batch)
+
+BOOST_FIXTURE_TEST_CASE(batch_cdata, test_batch_fixture)
+{
+  BOOST_CHECK_EQUAL(batch.numItems(), 3u);
+  BOOST_CHECK_EQUAL(batch.numTaskRuns(), 8);
+  BOOST_CHECK_EQUAL(batch.itemNumTaskRuns(0), 3);
+  BOOST_CHECK_EQUAL(batch.itemNumTaskRuns(1), 0);
+  BOOST_CHECK_EQUAL(batch.itemNumTaskRuns(2), 5);
+  BOOST_CHECK_EQUAL(batch.itemFirstTask(2), 3);
+  BOOST_CHECK(batch.itemCData(2) == &cdata3);
+
+  BOOST_CHECK_EQUAL(batch.itemOfTask(0), 0u);
+  BOOST_CHECK_EQUAL(batch.itemOfTask(2), 0u);
+  BOOST_CHECK_EQUAL(batch.itemOfTask(3), 2u);
+  BOOST_CHECK_EQUAL(batch.itemOfTask(7), 2u);
+
+  auto input = batch.getTaskInput(4);
+  BOOST_CHECK_EQUAL(input.item, 2u);
+  BOOST_CHECK_EQUAL(input.item_task_k, 1);
+  BOOST_CHECK_EQUAL(input.input.a, 2);
+  BOOST_CHECK_EQUAL(input.input.b, 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(run_sequential, test_batch_fixture)
+{
+  Tomographer::Logger::BoostTestLogger logger(Tomographer::Logger::LONGDEBUG);
+
+  Tomographer::MultiProc::Sequential::TaskDispatcher<TestBatchTask, TestBatchCData,
+                                                     Tomographer::Logger::BoostTestLogger>
+      tasks(&batch, logger, batch.numTaskRuns());
+
+  run_and_check(tasks);
+}
+
+BOOST_FIXTURE_TEST_CASE(run_cxxthreads, test_batch_fixture)
+{
+  Tomographer::Logger::BoostTestLogger logger(Tomographer::Logger::LONGDEBUG);
+
+  Tomographer::MultiProc::CxxThreads::TaskDispatcher<TestBatchTask, TestBatchCData,
+                                                     Tomographer::Logger::BoostTestLogger>
+      tasks(&batch, logger, batch.numTaskRuns(), 3);
+
+  run_and_check(tasks);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,273 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <cstdio>
+#include <string>
+#include <map>
+#include <fstream>
+#include <iterator>
+#include <memory>
+
+#include <boost/serialization/string.hpp>
+
+// definitions for Tomographer test framework -- this must be included before any
+// <Eigen/...> or <tomographer/...> header
+#include "test_tomographer.h"
+
+#include <tomographer/multiproccheckpoint.h>
+#include <tomographer/multiproc.h>
+#include <tomographer/multiprocthreads.h>
+
+#include <tomographer/tools/boost_test_logger.h>
+
+#include "test_multi_tasks_common.h"
+
+
+// -----------------------------------------------------------------------------
+// fixture(s)
+
+// result type which is default-constructible and serializable
+struct SerializableTestTaskResultType {
+  SerializableTestTaskResultType(int value_ = -1, std::string msg_ = std::string())
+    : msg(msg_), value(value_) { }
+
+  std::string msg;
+  int value;
+
+  SerializableTestTaskResultType explicitCopy() const { return SerializableTestTaskResultType(value, msg); }
+
+private:
+  friend class boost::serialization::access;
+  template<typename Archive>
+  void serialize(Archive & a, unsigned int /* version */)
+  {
+    a & msg;
+    a & value;
+  }
+};
+
+typedef TestTaskBase<TestBasicCData, SerializableTestTaskResultType> SerializableTestTask;
+
+typedef Tomographer::MultiProc::TaskResultsCheckpoint<SerializableTestTaskResultType>
+  TestCheckpointType;
+
+
+struct test_checkpoint_fixture : public test_task_dispatcher_fixture {
+  const std::string filename;
+
+  test_checkpoint_fixture()
+    : filename("test_multiproccheckpoint_checkpoint.dat")
+  {
+    std::remove(filename.c_str());
+  }
+  ~test_checkpoint_fixture()
+  {
+    std::remove(filename.c_str());
+  }
+
+  template<typename TaskDispatcherType>
+  void check_results(const TaskDispatcherType & task_dispatcher)
+  {
+    const std::vector<SerializableTestTaskResultType*> results = task_dispatcher.collectedTaskResults();
+    BOOST_CHECK_EQUAL(results.size(), correct_result_values.size());
+    for (std::size_t k = 0; k < results.size(); ++k) {
+      BOOST_CHECK_EQUAL(results[k]->value, correct_result_values[k]);
+    }
+  }
+};
+
+
+// -----------------------------------------------------------------------------
+// test suites
+
+
+BOOST_AUTO_TEST_SUITE(t__MultiProc__TaskResultsCheckpoint)
+
+BOOST_FIXTURE_TEST_CASE(write_and_load, test_checkpoint_fixture)
+{
+  {
+    TestCheckpointType checkpoint(filename, num_runs, "signature");
+    BOOST_CHECK(!checkpoint.load()); // file doesn't exist
+    BOOST_CHECK_EQUAL(checkpoint.numCompletedTasks(), 0);
+
+    checkpoint.recordTaskResult(2, SerializableTestTaskResultType(42, "task two"));
+    checkpoint.recordTaskResult(7, SerializableTestTaskResultType(-3, "task seven"));
+    BOOST_CHECK_EQUAL(checkpoint.numCompletedTasks(), 2);
+  }
+
+  TestCheckpointType checkpoint(filename, num_runs, "signature");
+  BOOST_CHECK(checkpoint.load());
+  BOOST_CHECK_EQUAL(checkpoint.fileName(), filename);
+  BOOST_CHECK_EQUAL(checkpoint.numTaskRuns(), num_runs);
+  BOOST_CHECK_EQUAL(checkpoint.numCompletedTasks(), 2);
+  BOOST_CHECK(!checkpoint.hasTaskResult(0));
+  BOOST_CHECK(checkpoint.hasTaskResult(2));
+  BOOST_CHECK(checkpoint.hasTaskResult(7));
+
+  std::unique_ptr<SerializableTestTaskResultType> r2(checkpoint.getTaskResult(2));
+  BOOST_CHECK_EQUAL(r2->value, 42);
+  BOOST_CHECK_EQUAL(r2->msg, "task two");
+  std::unique_ptr<SerializableTestTaskResultType> r7(checkpoint.getTaskResult(7));
+  BOOST_CHECK_EQUAL(r7->value, -3);
+  BOOST_CHECK_EQUAL(r7->msg, "task seven");
+
+  checkpoint.remove();
+  TestCheckpointType checkpoint2(filename, num_runs, "signature");
+  BOOST_CHECK(!checkpoint2.load());
+}
+
+BOOST_FIXTURE_TEST_CASE(mismatch, test_checkpoint_fixture)
+{
+  {
+    TestCheckpointType checkpoint(filename, num_runs, "signature");
+    checkpoint.recordTaskResult(0, SerializableTestTaskResultType(1));
+  }
+  {
+    TestCheckpointType checkpoint(filename, num_runs, "other signature");
+    BOOST_CHECK_THROW(checkpoint.load(), Tomographer::MultiProc::CheckpointError);
+  }
+  {
+    TestCheckpointType checkpoint(filename, num_runs + 1, "signature");
+    BOOST_CHECK_THROW(checkpoint.load(), Tomographer::MultiProc::CheckpointError);
+  }
+  {
+    // not a checkpoint file
+    std::ofstream stream(filename);
+    stream << "this is not a checkpoint file\n";
+  }
+  {
+    TestCheckpointType checkpoint(filename, num_runs, "signature");
+    BOOST_CHECK_THROW(checkpoint.load(), Tomographer::MultiProc::CheckpointError);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(incomplete_record, test_checkpoint_fixture)
+{
+  {
+    TestCheckpointType checkpoint(filename, num_runs, "signature");
+    checkpoint.recordTaskResult(2, SerializableTestTaskResultType(42, "task two"));
+    checkpoint.recordTaskResult(7, SerializableTestTaskResultType(-3, "task seven"));
+  }
+  {
+    // simulate an interrupted write: truncate the last record
+    std::ifstream inf(filename, std::ios::in | std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(inf)), std::istreambuf_iterator<char>());
+    inf.close();
+    std::ofstream outf(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    outf.write(contents.data(), (std::streamsize)contents.size() - 5);
+  }
+  {
+    TestCheckpointType checkpoint(filename, num_runs, "signature");
+    BOOST_CHECK(checkpoint.load());
+    BOOST_CHECK_EQUAL(checkpoint.numCompletedTasks(), 1);
+    BOOST_CHECK(checkpoint.hasTaskResult(2));
+    BOOST_CHECK(!checkpoint.hasTaskResult(7));
+    // the incomplete record is dropped before new ones are appended
+    checkpoint.write();
+    checkpoint.recordTaskResult(5, SerializableTestTaskResultType(5, "task five"));
+    checkpoint.recordTaskResult(7, SerializableTestTaskResultType(7, "task seven again"));
+  }
+
+  TestCheckpointType checkpoint(filename, num_runs, "signature");
+  BOOST_CHECK(checkpoint.load());
+  BOOST_CHECK_EQUAL(checkpoint.numCompletedTasks(), 3);
+  std::unique_ptr<SerializableTestTaskResultType> r2(checkpoint.getTaskResult(2));
+  BOOST_CHECK_EQUAL(r2->msg, "task two");
+  std::unique_ptr<SerializableTestTaskResultType> r5(checkpoint.getTaskResult(5));
+  BOOST_CHECK_EQUAL(r5->msg, "task five");
+  std::unique_ptr<SerializableTestTaskResultType> r7(checkpoint.getTaskResult(7));
+  BOOST_CHECK_EQUAL(r7->value, 7);
+  BOOST_CHECK_EQUAL(r7->msg, "task seven again");
+}
+
+BOOST_FIXTURE_TEST_CASE(resume_sequential, test_checkpoint_fixture)
+{
+  Tomographer::Logger::BoostTestLogger logger(Tomographer::Logger::LONGDEBUG);
+
+  // simulate an interrupted computation, where tasks #0, #3 and #4 had completed
+  {
+    TestCheckpointType checkpoint(filename, num_runs, "signature");
+    checkpoint.recordTaskResult(0, SerializableTestTaskResultType(correct_result_values[0]));
+    checkpoint.recordTaskResult(3, SerializableTestTaskResultType(correct_result_values[3]));
+    // wrong value, to make sure that this task is not run again
+    checkpoint.recordTaskResult(4, SerializableTestTaskResultType(-4));
+  }
+
+  TestCheckpointType checkpoint(filename, num_runs, "signature");
+  BOOST_CHECK(checkpoint.load());
+
+  Tomographer::MultiProc::Sequential::TaskDispatcher<SerializableTestTask, TestBasicCData,
+                                                     Tomographer::Logger::BoostTestLogger>
+      task_dispatcher(&cData, logger, num_runs);
+
+  checkpoint.attach(task_dispatcher);
+  task_dispatcher.run();
+
+  const std::vector<SerializableTestTaskResultType*> results = task_dispatcher.collectedTaskResults();
+  BOOST_CHECK_EQUAL(results[4]->value, -4);
+  results[4]->value = correct_result_values[4];
+  check_results(task_dispatcher);
+
+  // all results were saved in the checkpoint file
+  TestCheckpointType checkpoint2(filename, num_runs, "signature");
+  BOOST_CHECK(checkpoint2.load());
+  BOOST_CHECK_EQUAL(checkpoint2.numCompletedTasks(), num_runs);
+  for (int k = 0; k < num_runs; ++k) {
+    std::unique_ptr<SerializableTestTaskResultType> r(checkpoint2.getTaskResult(k));
+    BOOST_CHECK_EQUAL(r->value, (k == 4) ? -4 : correct_result_values[(std::size_t)k]);
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(resume_cxxthreads, test_checkpoint_fixture)
+{
+  Tomographer::Logger::BoostTestLogger logger(Tomographer::Logger::LONGDEBUG);
+
+  {
+    TestCheckpointType checkpoint(filename, num_runs, "signature");
+    checkpoint.recordTaskResult(1, SerializableTestTaskResultType(correct_result_values[1]));
+    checkpoint.recordTaskResult(8, SerializableTestTaskResultType(correct_result_values[8]));
+  }
+
+  TestCheckpointType checkpoint(filename, num_runs, "signature");
+  BOOST_CHECK(checkpoint.load());
+
+  Tomographer::MultiProc::CxxThreads::TaskDispatcher<SerializableTestTask, TestBasicCData,
+                                                     Tomographer::Logger::BoostTestLogger>
+      task_dispatcher(&cData, logger, num_runs, 3);
+
+  checkpoint.attach(task_dispatcher);
+  task_dispatcher.run();
+
+  check_results(task_dispatcher);
+
+  TestCheckpointType checkpoint2(filename, num_runs, "signature");
+  BOOST_CHECK(checkpoint2.load());
+  BOOST_CHECK_EQUAL(checkpoint2.numCompletedTasks(), num_runs);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
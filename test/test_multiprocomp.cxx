@@ -175,6 +175,16 @@ BOOST_FIXTURE_TEST_CASE(tasks_run, test_task_dispatcher_fixture)
   check_correct_results_collected(task_dispatcher);
 }
 
+BOOST_FIXTURE_TEST_CASE(completed_task_results, test_task_dispatcher_fixture)
+{
+  Tomographer::Logger::BoostTestLogger logger(Tomographer::Logger::LONGDEBUG);
+  Tomographer::MultiProc::OMP::TaskDispatcher<TestTask, TestBasicCData,
+                                              Tomographer::Logger::BoostTestLogger, long>
+      task_dispatcher(&cData, logger, num_runs, 4);
+
+  run_with_completed_task_results(task_dispatcher);
+}
+
 BOOST_FIXTURE_TEST_CASE(make_task_dispatcher, test_task_dispatcher_fixture)
 {
   typedef Tomographer::MultiProc::OMP::TaskDispatcher<TestTask, TestBasicCData, 
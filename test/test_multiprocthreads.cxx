@@ -185,6 +185,51 @@ BOOST_FIXTURE_TEST_CASE(tasks_run, test_task_dispatcher_fixture)
   check_correct_results_collected(task_dispatcher);
 }
 
+BOOST_FIXTURE_TEST_CASE(completed_task_results, test_task_dispatcher_fixture)
+{
+  Tomographer::Logger::BoostTestLogger logger(Tomographer::Logger::LONGDEBUG);
+  Tomographer::MultiProc::CxxThreads::TaskDispatcher<TestTask, TestBasicCData,
+                                                     Tomographer::Logger::BoostTestLogger, long>
+      task_dispatcher(&cData, logger, num_runs, 4);
+
+  run_with_completed_task_results(task_dispatcher);
+}
+
+BOOST_FIXTURE_TEST_CASE(tasks_run_numa_aware, test_task_dispatcher_fixture)
+{
+  Tomographer::Logger::BoostTestLogger logger(Tomographer::Logger::LONGDEBUG);
+  Tomographer::MultiProc::CxxThreads::TaskDispatcher<TestTask, TestBasicCData,
+                                                     Tomographer::Logger::BoostTestLogger, long>
+      task_dispatcher(&cData, logger, num_runs, 4);
+  task_dispatcher.setNumaAware(true);
+
+  const std::vector<int> affinity_before = Tomographer::Tools::getCurrentThreadAffinity();
+
+  task_dispatcher.run();
+
+  check_correct_results_collected(task_dispatcher);
+
+  // the affinity of the calling thread is restored
+  BOOST_CHECK(Tomographer::Tools::getCurrentThreadAffinity() == affinity_before);
+}
+
+BOOST_FIXTURE_TEST_CASE(tasks_run_thread_affinity, test_task_dispatcher_fixture)
+{
+  Tomographer::Logger::BoostTestLogger logger(Tomographer::Logger::LONGDEBUG);
+  Tomographer::MultiProc::CxxThreads::TaskDispatcher<TestTask, TestBasicCData,
+                                                     Tomographer::Logger::BoostTestLogger, long>
+      task_dispatcher(&cData, logger, num_runs, 3);
+  task_dispatcher.setThreadAffinity(Tomographer::Tools::ThreadAffinity::fromString("compact"));
+
+  const std::vector<int> affinity_before = Tomographer::Tools::getCurrentThreadAffinity();
+
+  task_dispatcher.run();
+
+  check_correct_results_collected(task_dispatcher);
+
+  BOOST_CHECK(Tomographer::Tools::getCurrentThreadAffinity() == affinity_before);
+}
+
 struct TestTaskCheckAlignedStack : public TestTask {
   template<typename... Args>
   TestTaskCheckAlignedStack(Args&&... x)
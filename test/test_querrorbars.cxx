@@ -0,0 +1,188 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <cmath>
+
+#include <string>
+#include <sstream>
+#include <iostream>
+
+// definitions for Tomographer test framework -- this must be included before any
+// <Eigen/...> or <tomographer/...> header
+#include "test_tomographer.h"
+
+#include <tomographer/querrorbars.h>
+#include <tomographer/histogram.h>
+#include <tomographer/tools/boost_test_logger.h>
+
+
+
+// -----------------------------------------------------------------------------
+// fixture(s)
+
+
+struct querrorbars_fixture
+{
+  typedef Tomographer::HistogramWithErrorBars<double, double> HistogramType;
+
+  // the figure of merit f = 1 - x, as for the fidelity
+  Tomographer::FigureOfMeritToX<double> ftox;
+
+  querrorbars_fixture()
+    : ftox(1.0, -1)
+  {
+  }
+
+  static double model(double x, double a2, double a1, double m, double c)
+  {
+    return -a2*x*x - a1*x + m*std::log(x) + c;
+  }
+
+  // histogram of f in [0.6, 1], with bin values exactly following the model in x = 1-f
+  // and relative error bars of 5%
+  HistogramType make_histogram(double a2, double a1, double m, double c) const
+  {
+    HistogramType h(0.6, 1.0, 40);
+    const Eigen::ArrayXd fvals = h.params.valuesCenter();
+    for (Eigen::Index k = 0; k < h.numBins(); ++k) {
+      h.bins(k) = 1000 * std::exp(model(ftox.x(fvals(k)), a2, a1, m, c));
+      h.delta(k) = 0.05 * h.bins(k);
+    }
+    return h;
+  }
+};
+
+
+// -----------------------------------------------------------------------------
+// test suites
+
+
+BOOST_FIXTURE_TEST_SUITE(test_querrorbars, querrorbars_fixture)
+
+BOOST_AUTO_TEST_CASE(figure_of_merit_to_x)
+{
+  BOOST_CHECK_CLOSE(ftox.x(0.9), 0.1, 1e-8);
+  BOOST_CHECK_CLOSE(ftox.f(0.1), 0.9, 1e-8);
+  Tomographer::FigureOfMeritToX<double> ident;
+  BOOST_CHECK_EQUAL(ident.x(0.25), 0.25);
+  BOOST_CHECK_THROW(Tomographer::FigureOfMeritToX<double>(0.0, 2), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(fit_exact_data)
+{
+  HistogramType h = make_histogram(250.1, 100.0, 42.1, 8.3);
+
+  auto fit = Tomographer::fitHistogramA2(h, ftox);
+
+  BOOST_MESSAGE("fit params = " << fit.params.transpose() << ", redchi2 = " << fit.redchi2);
+  BOOST_CHECK_EQUAL(fit.num_points, 40);
+  BOOST_CHECK_CLOSE(fit.a2(), 250.1, 1e-6);
+  BOOST_CHECK_CLOSE(fit.a1(), 100.0, 1e-6);
+  BOOST_CHECK_CLOSE(fit.m(), 42.1, 1e-6);
+  // the histogram is normalized before the fit
+  const double norm = h.normalization();
+  BOOST_CHECK_CLOSE(fit.c(), 8.3 + std::log(1000.0) - std::log(norm), 1e-6);
+  BOOST_CHECK_SMALL(fit.redchi2, 1e-12);
+  // covariance matrix is symmetric with positive diagonal
+  BOOST_CHECK_SMALL((fit.cov - fit.cov.transpose()).norm() / fit.cov.norm(), 1e-10);
+  BOOST_CHECK((fit.cov.diagonal().array() > 0).all());
+}
+
+BOOST_AUTO_TEST_CASE(fit_threshold)
+{
+  HistogramType h = make_histogram(250.1, 100.0, 42.1, 8.3);
+
+  auto fit = Tomographer::fitHistogramA2(h, ftox, 0.1);
+
+  BOOST_CHECK_LT(fit.num_points, 40);
+  BOOST_CHECK_GT(fit.num_points, 4);
+  BOOST_CHECK_CLOSE(fit.a2(), 250.1, 1e-6);
+  BOOST_CHECK_CLOSE(fit.m(), 42.1, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(fit_bounds)
+{
+  // data following a model with a2 < 0 must be fitted with a2 = 0
+  HistogramType h = make_histogram(-50.0, 20.0, 3.0, 1.0);
+
+  auto fit = Tomographer::fitHistogramA2(h, ftox);
+
+  BOOST_MESSAGE("fit params = " << fit.params.transpose() << ", chi2 = " << fit.chi2);
+  BOOST_CHECK_EQUAL(fit.a2(), 0.0);
+  BOOST_CHECK_GE(fit.m(), 0.0);
+  BOOST_CHECK_GT(fit.chi2, 0.0);
+
+  // the result is optimal: moving any free parameter only increases chi2
+  const Eigen::ArrayXd fvals = h.params.valuesCenter();
+  const double N = h.normalization();
+  auto chi2 = [&](const Eigen::Vector4d & p) {
+    double s = 0;
+    for (Eigen::Index k = 0; k < h.numBins(); ++k) {
+      const double x = ftox.x(fvals(k));
+      const double r = (std::log(h.bins(k)/N) - model(x, p(0), p(1), p(2), p(3))) / (h.delta(k)/h.bins(k));
+      s += r*r;
+    }
+    return s;
+  };
+  BOOST_CHECK_CLOSE(chi2(fit.params), fit.chi2, 1e-6);
+  for (int j = 0; j < 4; ++j) {
+    for (double eps : { -1e-3, 1e-3 }) {
+      Eigen::Vector4d p = fit.params;
+      p(j) += eps;
+      if (p(0) < 0 || p(2) < 0) {
+        continue;
+      }
+      BOOST_CHECK_GE(chi2(p), fit.chi2);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(not_enough_points)
+{
+  HistogramType h = make_histogram(250.1, 100.0, 42.1, 8.3);
+  h.bins.segment(4, 36).setZero();
+  BOOST_CHECK_THROW(Tomographer::fitHistogramA2(h, ftox), Tomographer::HistogramFitError);
+}
+
+BOOST_AUTO_TEST_CASE(quantum_error_bars)
+{
+  // same values as computed by tomographer.querrorbars.FitParamToQuErrorBars_a2
+  Tomographer::HistogramFitA2Result<double> fit;
+  fit.params << 250.1, 100.0, 42.1, 8.3;
+
+  auto q = Tomographer::quantumErrorBarsFromFitA2(fit, ftox);
+  BOOST_CHECK_CLOSE(q.f0, 0.7931077090704597, 1e-8);
+  BOOST_CHECK_CLOSE(q.Delta, 0.03671433059980818, 1e-8);
+  BOOST_CHECK_CLOSE(q.gamma, 0.001439595156232577, 1e-8);
+  BOOST_CHECK_CLOSE(q.y0, -89.4255623440214, 1e-8);
+
+  fit.params(0) = -1;
+  BOOST_CHECK_THROW(Tomographer::quantumErrorBarsFromFitA2(fit, ftox), Tomographer::HistogramFitError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
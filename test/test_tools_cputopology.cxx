@@ -0,0 +1,279 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+// definitions for Tomographer test framework -- this must be included before any
+// <Eigen/...> or <tomographer/...> header
+#include "test_tomographer.h"
+
+#include <tomographer/tools/cputopology.h>
+
+
+
+// -----------------------------------------------------------------------------
+// fixture(s)
+
+// a machine with 2 packages with 2 cores each, each core with 2 hardware threads; CPUs are
+// numbered as by Linux on Intel machines (the SMT siblings of CPU c are c and c+4)
+struct TwoSocketTopologyFixture
+{
+  Tomographer::Tools::CpuTopology t;
+
+  TwoSocketTopologyFixture()
+  {
+    t.cpus = {0,1,2,3,4,5,6,7};
+    t.cpu_node = {0,0,1,1,0,0,1,1};
+    t.nodes = {0,1};
+    t.cpu_core = {0,1,2,3,0,1,2,3};
+    t.cpu_package = {0,0,1,1,0,0,1,1};
+  }
+
+  std::vector<int> assigned(const Tomographer::Tools::ThreadAffinity & a, int num_threads) const
+  {
+    std::vector<int> cpus;
+    for (const auto & c : a.assignCpus(t, num_threads)) {
+      BOOST_CHECK_EQUAL(c.size(), 1u);
+      cpus.push_back(c[0]);
+    }
+    return cpus;
+  }
+};
+
+
+// -----------------------------------------------------------------------------
+// test suites
+
+BOOST_AUTO_TEST_SUITE(test_tools_cputopology)
+
+BOOST_AUTO_TEST_CASE(parse_cpu_list)
+{
+  BOOST_CHECK(Tomographer::Tools::parseCpuList("0") == std::vector<int>({0}));
+  BOOST_CHECK(Tomographer::Tools::parseCpuList("0-3,8,10-11\n") == std::vector<int>({0,1,2,3,8,10,11}));
+  BOOST_CHECK(Tomographer::Tools::parseCpuList("5,1-2,2") == std::vector<int>({1,2,5}));
+  BOOST_CHECK(Tomographer::Tools::parseCpuList("") == std::vector<int>());
+  BOOST_CHECK(Tomographer::Tools::parseCpuList("x,3-1,4") == std::vector<int>({4}));
+}
+
+BOOST_AUTO_TEST_CASE(format_cpu_list)
+{
+  BOOST_CHECK_EQUAL(Tomographer::Tools::formatCpuList({0,1,2,3,8,10,11}), "0-3,8,10-11");
+  BOOST_CHECK_EQUAL(Tomographer::Tools::formatCpuList({7}), "7");
+  BOOST_CHECK_EQUAL(Tomographer::Tools::formatCpuList({4,2,3}), "2-4");
+  BOOST_CHECK_EQUAL(Tomographer::Tools::formatCpuList({}), "");
+}
+
+BOOST_AUTO_TEST_CASE(detect)
+{
+  const Tomographer::Tools::CpuTopology t = Tomographer::Tools::CpuTopology::detect();
+  BOOST_MESSAGE("Topology: " << t.summary());
+
+  BOOST_CHECK_GE(t.numCpus(), 1);
+  BOOST_CHECK_GE(t.numNodes(), 1);
+  BOOST_CHECK_EQUAL(t.cpu_node.size(), t.cpus.size());
+  BOOST_CHECK(std::is_sorted(t.cpus.begin(), t.cpus.end()));
+  int total = 0;
+  for (int n = 0; n < t.numNodes(); ++n) {
+    const std::vector<int> cpus = t.nodeCpus(n);
+    BOOST_CHECK(!cpus.empty());
+    for (int c : cpus) {
+      BOOST_CHECK_EQUAL(t.nodeOfCpu(c), n);
+    }
+    total += (int)cpus.size();
+  }
+  BOOST_CHECK_EQUAL(total, t.numCpus());
+  BOOST_CHECK_EQUAL(t.nodeOfCpu(-1), -1);
+  BOOST_CHECK_EQUAL(t.cpu_core.size(), t.cpus.size());
+  BOOST_CHECK_EQUAL(t.cpu_package.size(), t.cpus.size());
+  BOOST_CHECK_GE(t.numPhysicalCores(), 1);
+  BOOST_CHECK_LE(t.numPhysicalCores(), t.numCpus());
+}
+
+BOOST_AUTO_TEST_SUITE(thread_affinity_policies)
+
+BOOST_AUTO_TEST_CASE(from_string)
+{
+  using namespace Tomographer::Tools;
+  BOOST_CHECK_EQUAL(ThreadAffinity::fromString("none").policy, THREAD_AFFINITY_NONE);
+  BOOST_CHECK_EQUAL(ThreadAffinity::fromString("numa").policy, THREAD_AFFINITY_NUMA_NODES);
+  BOOST_CHECK_EQUAL(ThreadAffinity::fromString("compact").policy, THREAD_AFFINITY_COMPACT);
+  BOOST_CHECK_EQUAL(ThreadAffinity::fromString("scatter").policy, THREAD_AFFINITY_SCATTER);
+  BOOST_CHECK_EQUAL(ThreadAffinity::fromString("cores").policy, THREAD_AFFINITY_PHYSICAL_CORES);
+  const ThreadAffinity a = ThreadAffinity::fromString("4-6,1");
+  BOOST_CHECK_EQUAL(a.policy, THREAD_AFFINITY_EXPLICIT);
+  BOOST_CHECK(a.cpus == std::vector<int>({1,4,5,6}));
+  BOOST_CHECK_EQUAL(a.toString(), "1,4-6");
+  BOOST_CHECK_EQUAL(ThreadAffinity::fromString("scatter").toString(), "scatter");
+  BOOST_CHECK_THROW(ThreadAffinity::fromString("spread"), InvalidThreadAffinity);
+  BOOST_CHECK_THROW(ThreadAffinity::fromString(","), InvalidThreadAffinity);
+}
+
+BOOST_FIXTURE_TEST_CASE(summary, TwoSocketTopologyFixture)
+{
+  BOOST_CHECK_EQUAL(t.numPhysicalCores(), 4);
+  BOOST_CHECK_EQUAL(t.summary(), "8 CPUs on 4 physical cores in 2 NUMA nodes: node 0: CPUs 0-1,4-5; "
+                    "node 1: CPUs 2-3,6-7");
+}
+
+BOOST_FIXTURE_TEST_CASE(compact, TwoSocketTopologyFixture)
+{
+  Tomographer::Tools::ThreadAffinity a(Tomographer::Tools::THREAD_AFFINITY_COMPACT);
+  BOOST_CHECK_EQUAL(a.defaultNumThreads(t), 8);
+  BOOST_CHECK(assigned(a, 8) == std::vector<int>({0,4,1,5,2,6,3,7}));
+  BOOST_CHECK(assigned(a, 3) == std::vector<int>({0,4,1}));
+}
+
+BOOST_FIXTURE_TEST_CASE(scatter, TwoSocketTopologyFixture)
+{
+  Tomographer::Tools::ThreadAffinity a(Tomographer::Tools::THREAD_AFFINITY_SCATTER);
+  BOOST_CHECK_EQUAL(a.defaultNumThreads(t), 8);
+  BOOST_CHECK(assigned(a, 8) == std::vector<int>({0,2,1,3,4,6,5,7}));
+  BOOST_CHECK(assigned(a, 2) == std::vector<int>({0,2}));
+}
+
+BOOST_FIXTURE_TEST_CASE(physical_cores, TwoSocketTopologyFixture)
+{
+  Tomographer::Tools::ThreadAffinity a(Tomographer::Tools::THREAD_AFFINITY_PHYSICAL_CORES);
+  BOOST_CHECK_EQUAL(a.defaultNumThreads(t), 4);
+  BOOST_CHECK(assigned(a, 4) == std::vector<int>({0,2,1,3}));
+  // more threads than cores: wraps around
+  BOOST_CHECK(assigned(a, 6) == std::vector<int>({0,2,1,3,0,2}));
+}
+
+BOOST_FIXTURE_TEST_CASE(explicit_list, TwoSocketTopologyFixture)
+{
+  Tomographer::Tools::ThreadAffinity a(Tomographer::Tools::THREAD_AFFINITY_EXPLICIT, {6,7});
+  BOOST_CHECK_EQUAL(a.defaultNumThreads(t), 2);
+  BOOST_CHECK(assigned(a, 3) == std::vector<int>({6,7,6}));
+  BOOST_CHECK_THROW(Tomographer::Tools::ThreadAffinity(Tomographer::Tools::THREAD_AFFINITY_EXPLICIT),
+                    Tomographer::Tools::InvalidThreadAffinity);
+}
+
+BOOST_FIXTURE_TEST_CASE(numa_nodes, TwoSocketTopologyFixture)
+{
+  Tomographer::Tools::ThreadAffinity a(Tomographer::Tools::THREAD_AFFINITY_NUMA_NODES);
+  const auto thread_cpus = a.assignCpus(t, 3);
+  BOOST_CHECK_EQUAL(thread_cpus.size(), 3u);
+  BOOST_CHECK(thread_cpus[0] == std::vector<int>({0,1,4,5}));
+  BOOST_CHECK(thread_cpus[1] == std::vector<int>({0,1,4,5}));
+  BOOST_CHECK(thread_cpus[2] == std::vector<int>({2,3,6,7}));
+  BOOST_CHECK_EQUAL(Tomographer::Tools::formatThreadCpus(thread_cpus), "#0->0-1,4-5, #1->0-1,4-5, #2->2-3,6-7");
+
+  // single node: threads are not pinned
+  Tomographer::Tools::CpuTopology t1 = t;
+  t1.cpu_node.assign(t.cpus.size(), 0);
+  t1.nodes = {0};
+  BOOST_CHECK(a.assignCpus(t1, 3).empty());
+}
+
+BOOST_FIXTURE_TEST_CASE(none, TwoSocketTopologyFixture)
+{
+  Tomographer::Tools::ThreadAffinity a;
+  BOOST_CHECK(a.assignCpus(t, 4).empty());
+  BOOST_CHECK_EQUAL(Tomographer::Tools::formatThreadCpus(a.assignCpus(t, 4)), "threads are not pinned");
+}
+
+BOOST_AUTO_TEST_SUITE_END() // thread_affinity_policies
+
+BOOST_AUTO_TEST_CASE(thread_affinity)
+{
+  const std::vector<int> affinity = Tomographer::Tools::getCurrentThreadAffinity();
+  if (affinity.empty()) {
+    BOOST_MESSAGE("Thread pinning is not supported on this platform");
+    BOOST_CHECK(!Tomographer::Tools::setCurrentThreadAffinity({0}));
+    return;
+  }
+  // pin a separate thread to a single CPU
+  const int cpu = affinity.back();
+  bool ok = false;
+  int running_on = -2;
+  std::vector<int> pinned;
+  std::thread thread([&]() {
+      ok = Tomographer::Tools::setCurrentThreadAffinity({cpu});
+      pinned = Tomographer::Tools::getCurrentThreadAffinity();
+      running_on = Tomographer::Tools::currentCpu();
+    });
+  thread.join();
+  BOOST_CHECK(ok);
+  BOOST_CHECK(pinned == std::vector<int>({cpu}));
+  BOOST_CHECK_EQUAL(running_on, cpu);
+  // our own affinity did not change
+  BOOST_CHECK(Tomographer::Tools::getCurrentThreadAffinity() == affinity);
+}
+
+BOOST_AUTO_TEST_CASE(numa_replicated_disabled)
+{
+  const std::vector<double> data(100, 1.5);
+  Tomographer::Tools::NumaReplicated<std::vector<double> > r(data, false);
+  BOOST_CHECK(!r.enabled());
+  BOOST_CHECK_EQUAL(&r.local(), &data);
+  BOOST_CHECK_EQUAL(r.numReplicas(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(numa_replicated_two_nodes)
+{
+  // pretend CPUs 0,1 are on node 0 and CPUs 2,3 on node 1
+  Tomographer::Tools::CpuTopology t;
+  t.cpus = {0,1,2,3};
+  t.cpu_node = {0,0,1,1};
+  t.nodes = {0,1};
+
+  const std::vector<int> affinity = Tomographer::Tools::getCurrentThreadAffinity();
+  const std::vector<double> data(100, 1.5);
+  Tomographer::Tools::NumaReplicated<std::vector<double> > r(data, true, t);
+  BOOST_CHECK(r.enabled());
+  BOOST_CHECK_EQUAL(r.topology().numNodes(), 2);
+
+  if (std::find(affinity.begin(), affinity.end(), 0) == affinity.end() ||
+      std::find(affinity.begin(), affinity.end(), 2) == affinity.end()) {
+    BOOST_MESSAGE("Can't run on CPUs 0 and 2, skipping the rest of the test");
+    return;
+  }
+
+  const std::vector<double> * p[3] = {NULL, NULL, NULL};
+  int k = 0;
+  for (int cpu : {0, 2, 1}) {
+    std::thread thread([&]() {
+        Tomographer::Tools::setCurrentThreadAffinity({cpu});
+        p[k] = &r.local();
+      });
+    thread.join();
+    ++k;
+  }
+  BOOST_CHECK(p[0] != &data);
+  BOOST_CHECK(p[1] != &data);
+  BOOST_CHECK(p[0] != p[1]);
+  BOOST_CHECK_EQUAL(p[0], p[2]); // CPUs 0 and 1 share their copy
+  BOOST_CHECK(*p[0] == data);
+  BOOST_CHECK(*p[1] == data);
+  BOOST_CHECK_EQUAL(r.numReplicas(), 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -197,6 +197,52 @@ BOOST_AUTO_TEST_CASE(mcd_2x3x2x2_rowmaj)
 }
 BOOST_AUTO_TEST_SUITE_END(); // stdvec_of_eigen
 
+BOOST_AUTO_TEST_SUITE(matrix_slice_reader);
+BOOST_AUTO_TEST_CASE(mcd_2x3x2x2)
+{
+  typedef Tomographer::MAT::VarMatrixSliceReader<double> ReaderType;
+  // read two matrices at a time
+  ReaderType reader(f, "mcd_2x3x2x2", 2*2*3*2*sizeof(double));
+  BOOST_CHECK_EQUAL(reader.rows(), 2);
+  BOOST_CHECK_EQUAL(reader.cols(), 3);
+  BOOST_CHECK_EQUAL(reader.numSlices(), 4u);
+  BOOST_CHECK(reader.isComplex());
+
+  typedef Tomographer::Tools::EigenStdVector<Eigen::MatrixXcd>::type OkType;
+  OkType ok = f.var("mcd_2x3x2x2").value<OkType>();
+
+  std::size_t count = 0;
+  reader.forEachSlice([&](std::size_t k, const ReaderType::RealMatrixMapType & re,
+                          const ReaderType::RealMatrixMapType & im) {
+      BOOST_CHECK_EQUAL(k, count);
+      MY_BOOST_CHECK_EIGEN_EQUAL(re, ok[k].real(), tol);
+      MY_BOOST_CHECK_EIGEN_EQUAL(im, ok[k].imag(), tol);
+      ++count;
+    });
+  BOOST_CHECK_EQUAL(count, 4u);
+}
+BOOST_AUTO_TEST_CASE(mu32_3x3)
+{
+  typedef Tomographer::MAT::VarMatrixSliceReader<double> ReaderType;
+  ReaderType reader(f, "mu32_3x3");
+  BOOST_CHECK_EQUAL(reader.numSlices(), 1u);
+  BOOST_CHECK(!reader.isComplex());
+
+  Eigen::Matrix3d ok;
+  ok << 1, 1, 1, 2, 2, 2, 4294967295.0, 0, 0 ;
+
+  std::size_t count = 0;
+  reader.forEachSlice([&](std::size_t k, const ReaderType::RealMatrixMapType & re,
+                          const ReaderType::RealMatrixMapType & im) {
+      BOOST_CHECK_EQUAL(k, 0u);
+      MY_BOOST_CHECK_EIGEN_EQUAL(re, ok, tol);
+      MY_BOOST_CHECK_EIGEN_EQUAL(im, Eigen::Matrix3d::Zero(), tol);
+      ++count;
+    });
+  BOOST_CHECK_EQUAL(count, 1u);
+}
+BOOST_AUTO_TEST_SUITE_END(); // matrix_slice_reader
+
 
 BOOST_AUTO_TEST_SUITE(psdeigen);
 
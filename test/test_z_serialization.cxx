@@ -180,6 +180,34 @@ BOOST_AUTO_TEST_CASE(observablevaluecalculator)
   MY_BOOST_CHECK_FLOATS_EQUAL(a.getValue(T_ref), b.getValue(T_ref), tol) ;
 }
 
+BOOST_AUTO_TEST_CASE(multiplefiguresofmeritcalculator)
+{
+  typedef Tomographer::DenseDM::DMTypes<2> DMTypes;
+  typedef Tomographer::DenseDM::TSpace::MultipleFiguresOfMeritCalculator<DMTypes> TheType;
+  DMTypes::MatrixType A;
+  A << 2, std::complex<double>(0,-1),
+    std::complex<double>(0,1), -1 ;
+  DMTypes::MatrixType T_ref;
+  T_ref << std::sqrt(0.2), std::complex<double>(0,std::sqrt(0.1)),
+    std::complex<double>(-std::sqrt(0.4), std::sqrt(0.2)), -std::sqrt(0.1) ;
+  TheType a;
+  a.addFidelityToRef(T_ref);
+  a.addObservable(A);
+  a.addTrDistToRef(T_ref*T_ref.adjoint());
+  a.addPurifDistToRef(T_ref);
+
+  TheType b;
+  save_and_reload(a, b);
+
+  BOOST_CHECK_EQUAL(a.numValues(), b.numValues());
+  Eigen::ArrayXd va(4), vb(4);
+  DMTypes::MatrixType T;
+  T << std::sqrt(0.8), 0, 0, std::sqrt(0.2) ;
+  a.getValues(T, va);
+  b.getValues(T, vb);
+  MY_BOOST_CHECK_EIGEN_EQUAL(va, vb, tol) ;
+}
+
 BOOST_AUTO_TEST_SUITE_END() // tspacefigofmerit
 
 
@@ -226,6 +254,59 @@ BOOST_AUTO_TEST_CASE(valuehisttools_cdata)
 }
 
 
+BOOST_AUTO_TEST_CASE(valuehisttools_results_simple)
+{
+  typedef Tomographer::Histogram<double, int> RawHistogramType;
+  typedef Tomographer::Histogram<double, double> ScaledHistogramType;
+  typedef Tomographer::MHRWTasks::ValueHistogramTools::MHRWStatsResultsBaseSimple<
+    RawHistogramType, ScaledHistogramType
+    > TheType;
+
+  RawHistogramType h(0.0, 1.0, 4);
+  h.load( (Eigen::ArrayXi(4) << 3, 1, 4, 1).finished(), 1 );
+  TheType a(std::move(h));
+
+  TheType b;
+  save_and_reload(a, b);
+
+  BOOST_CHECK_EQUAL(b.raw_histogram.numBins(), 4);
+  MY_BOOST_CHECK_EIGEN_EQUAL(a.raw_histogram.bins, b.raw_histogram.bins, tol) ;
+  BOOST_CHECK_EQUAL(a.raw_histogram.off_chart, b.raw_histogram.off_chart) ;
+  MY_BOOST_CHECK_FLOATS_EQUAL(a.histogram.params.max, b.histogram.params.max, tol) ;
+  MY_BOOST_CHECK_EIGEN_EQUAL(a.histogram.bins, b.histogram.bins, tol) ;
+  MY_BOOST_CHECK_FLOATS_EQUAL(a.histogram.off_chart, b.histogram.off_chart, tol) ;
+}
+
+
+BOOST_AUTO_TEST_CASE(histogram2d)
+{
+  typedef Tomographer::Histogram2D<double, int> BaseHistogramType;
+  typedef Tomographer::AveragedHistogram2D<BaseHistogramType, double> TheType;
+  BaseHistogramType::Params p(BaseHistogramType::AxisParams(0.0, 1.0, 3),
+                              BaseHistogramType::AxisParams(-2.0, 2.0, 2));
+
+  BaseHistogramType h1(p);
+  h1.load( (Eigen::ArrayXi(6) << 1, 2, 3, 4, 5, 6).finished(), 7 );
+  BaseHistogramType h2(p);
+  h2.load( (Eigen::ArrayXi(6) << 2, 2, 4, 3, 6, 1).finished(), 5 );
+  TheType a(p);
+  a.addHistogram(h1);
+  a.addHistogram(h2);
+  a.finalize();
+
+  TheType b;
+  save_and_reload(a, b);
+
+  BOOST_CHECK_EQUAL(a.numBinsX(), b.numBinsX());
+  BOOST_CHECK_EQUAL(a.numBinsY(), b.numBinsY());
+  MY_BOOST_CHECK_FLOATS_EQUAL(a.params.y.min, b.params.y.min, tol) ;
+  MY_BOOST_CHECK_FLOATS_EQUAL(a.params.y.max, b.params.y.max, tol) ;
+  MY_BOOST_CHECK_EIGEN_EQUAL(a.bins, b.bins, tol) ;
+  MY_BOOST_CHECK_EIGEN_EQUAL(a.delta, b.delta, tol) ;
+  MY_BOOST_CHECK_FLOATS_EQUAL(a.off_chart, b.off_chart, tol) ;
+  BOOST_CHECK_EQUAL(a.num_histograms, b.num_histograms);
+}
+
 
 
 BOOST_AUTO_TEST_SUITE_END() // serializing
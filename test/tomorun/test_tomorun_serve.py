@@ -0,0 +1,128 @@
+
+from __future__ import print_function
+
+import sys
+import os
+import os.path
+import time
+import socket
+import subprocess
+import argparse
+
+import logging
+logging.basicConfig(level=logging.DEBUG, format='[%(levelname)s] %(message)s')
+logger = logging.getLogger(__name__)
+
+
+def submit_job(socket_file, job_line):
+    """
+    Submit a job to the tomorun server, and return the pair `(output, result)` where
+    `output` is the text output of the job, and `result` is either `('RESULT', <bytes>)` or
+    `('ERROR', <message>)`.
+    """
+    s = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    s.connect(socket_file)
+    s.sendall(job_line.encode('utf-8') + b"\n")
+    data = b""
+    while True:
+        d = s.recv(65536)
+        if not d:
+            break
+        data += d
+    s.close()
+
+    k = data.rfind(b"TOMORUN-SERVER-")
+    if k < 0:
+        raise ValueError("No result marker in server reply: {!r}".format(data[-1000:]))
+    output = data[:k].decode('utf-8', 'replace')
+    markerline, _, payload = data[k:].partition(b"\n")
+    markerline = markerline.decode('utf-8', 'replace')
+    if markerline.startswith("TOMORUN-SERVER-ERROR "):
+        return output, ('ERROR', markerline[len("TOMORUN-SERVER-ERROR "):])
+    nbytes = int(markerline[len("TOMORUN-SERVER-RESULT "):])
+    if len(payload) != nbytes:
+        raise ValueError("Expected {} bytes of results, got {}".format(nbytes, len(payload)))
+    return output, ('RESULT', payload)
+
+
+def run_main():
+    parser = argparse.ArgumentParser("test_tomorun_serve")
+    parser.add_argument("--socket-file", action='store', default='test_tomorun_serve.sock')
+    parser.add_argument("--data-file-name", action='store', required=True)
+    parser.add_argument("tomorun_argv", nargs='+')
+
+    args = parser.parse_args()
+
+    socket_file = os.path.abspath(args.socket_file)
+    if os.path.exists(socket_file):
+        os.remove(socket_file)
+
+    server = subprocess.Popen(args.tomorun_argv + ["--serve=" + socket_file])
+    try:
+        for _ in range(100):
+            if os.path.exists(socket_file):
+                break
+            time.sleep(0.1)
+        else:
+            raise RuntimeError("tomorun server did not create socket {}".format(socket_file))
+
+        # a few jobs in a row, run by the same server
+        for value_type in ("fidelity", "tr-dist", "purif-dist"):
+            output, result = submit_job(
+                socket_file,
+                "\"--data-file-name={}\" --value-type={} --value-hist=0:1/20".format(args.data_file_name, value_type)
+            )
+            logger.debug("Output of job (value type %s):\n%s", value_type, output)
+            if result[0] != 'RESULT':
+                raise RuntimeError("Job failed: {}".format(result[1]))
+            if "Final Histogram" not in output:
+                raise RuntimeError("Job output doesn't contain the final report")
+            logger.info("Job with value type %s: got %d bytes of results", value_type, len(result[1]))
+
+        # a job with invalid options must fail, and not bring down the server
+        output, result = submit_job(socket_file, "--verbose")
+        if result[0] != 'ERROR':
+            raise RuntimeError("Job with invalid options didn't fail")
+        logger.info("Job with invalid options failed as expected: %s", result[1])
+
+        # an overlong job line is rejected without a reply
+        s = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        s.connect(socket_file)
+        try:
+            s.sendall(b"x" * 200000 + b"\n")
+            data = s.recv(65536)
+        except socket.error:
+            data = b""
+        s.close()
+        if data:
+            raise RuntimeError("Server replied to an overlong job line: {!r}".format(data[:1000]))
+        logger.info("Overlong job line was rejected as expected")
+
+        # a client which goes away while its job is running must not disturb the server
+        s = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        s.connect(socket_file)
+        s.sendall("\"--data-file-name={}\" --value-type=fidelity --value-hist=0:1/20\n"
+                  .format(args.data_file_name).encode('utf-8'))
+        s.close()
+
+        output, result = submit_job(
+            socket_file,
+            "\"--data-file-name={}\" --value-type=fidelity --value-hist=0:1/20".format(args.data_file_name)
+        )
+        if result[0] != 'RESULT':
+            raise RuntimeError("Job after a disconnected client failed: {}".format(result[1]))
+
+        if server.poll() is not None:
+            raise RuntimeError("tomorun server exited unexpectedly")
+
+    finally:
+        server.kill()
+        server.wait()
+        if os.path.exists(socket_file):
+            os.remove(socket_file)
+
+    logger.info("Test passed.")
+
+
+if __name__ == '__main__':
+    run_main()
@@ -63,7 +63,15 @@ enum {
   /** \brief The DenseLLH-compatible object exposes a method \c logLikelihoodX(), taking as
    *         argument a (const ref to a) DMTypes::VectorParamType
    */
-  LLHCalcTypeX = 2
+  LLHCalcTypeX = 2,
+
+  /** \brief The DenseLLH-compatible object exposes a method \c logLikelihoodT(), taking as
+   *         argument a (const ref to a) DMTypes::MatrixType \f$ T \f$, where the density
+   *         matrix is \f$ \rho = TT^\dagger \f$
+   *
+   * \since Added in %Tomographer 5.5.
+   */
+  LLHCalcTypeT = 3
 
 };
 
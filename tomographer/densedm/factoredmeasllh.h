@@ -0,0 +1,478 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TOMOGRAPHER_DENSEDM_FACTOREDMEASLLH_H
+#define TOMOGRAPHER_DENSEDM_FACTOREDMEASLLH_H
+
+#include <cstddef>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm> // std::max
+#include <iomanip> // std::setprecision
+
+#include <Eigen/Eigen>
+
+#include <boost/serialization/serialization.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <tomographer/tools/cxxutil.h> // tomographer_assert()
+#include <tomographer/tools/fmt.h> // streamstr
+#include <tomographer/tools/eigenutil.h> // Eigen objects & Boost.Serialization
+#include <tomographer/densedm/dmtypes.h>
+#include <tomographer/densedm/densellh.h>
+
+/** \file factoredmeasllh.h
+ *
+ * \brief Log-likelihood function for independent measurements with low-rank POVM
+ *        effects, calculated directly from \f$ T \f$
+ *
+ * See \ref Tomographer::DenseDM::FactoredMeasLLH.
+ */
+
+
+namespace Tomographer {
+namespace DenseDM {
+
+
+
+/** \brief Log-likelihood function for independent measurements, with POVM effects stored
+ *         in factored form
+ *
+ * Each POVM effect is stored as a factor \f$ V_k \f$, a \f$ d\times r_k \f$ matrix with
+ * \f$ E_k = V_k V_k^\dagger \f$.  For the random walk in \f$ T \f$-space (\ref
+ * TSpace::LLHMHWalker), where \f$ \rho = TT^\dagger \f$, the probability of each outcome
+ * is then calculated directly from \f$ T \f$ as
+ * \f[
+ *   \mathrm{tr}(E_k\,TT^\dagger) = \Vert V_k^\dagger T \Vert_F^2 ,
+ * \f]
+ * which costs \f$ O(d^2 r_k) \f$ operations instead of the \f$ O(d^3) \f$ needed to form
+ * \f$ \rho \f$.  This is much faster than \ref IndepMeasLLH in high dimensions when the
+ * effects have small rank, as is typically the case for projective measurements.
+ *
+ * An effect may also be stored as a <em>complement</em> \f$ E_k = \mathbb{1} - V_k
+ * V_k^\dagger \f$, so that e.g. the effect \f$ \mathbb{1} - |W\rangle\langle W| \f$ is
+ * also stored with a single vector.  Its probability is \f$ \mathrm{tr}(TT^\dagger) -
+ * \Vert V_k^\dagger T \Vert_F^2 \f$.
+ *
+ * The effects may be specified directly in factored form with \ref addMeasEffectFactor(),
+ * or as full matrices with \ref addMeasEffect(), in which case they are diagonalized to
+ * find the factored form of lowest rank.
+ *
+ * Implements the \ref pageInterfaceDenseLLH, with \ref LLHCalcTypeT.
+ *
+ * \since Added in %Tomographer 5.5.
+ */
+template<typename DMTypes_, typename LLHValueType_ = typename DMTypes_::RealScalar,
+         typename IntFreqType_ = int>
+class TOMOGRAPHER_EXPORT FactoredMeasLLH
+{
+public:
+  //! The \ref DMTypes in use here
+  typedef DMTypes_ DMTypes;
+  //! Type used to calculate the log-likelihood function (see \ref pageInterfaceDenseLLH)
+  typedef LLHValueType_ LLHValueType;
+  //! Type used to store integer measurement counts
+  typedef IntFreqType_ IntFreqType;
+
+  typedef typename DMTypes::RealScalar RealScalar;
+  typedef typename DMTypes::ComplexScalar ComplexScalar;
+
+  /** \brief Declare some stuff as part of the \ref pageInterfaceDenseLLH compliance
+   *
+   * See \ref DenseDM::LLHCalcTypeT and \ref pageInterfaceDenseLLH for details.
+   */
+  enum {
+    //! Declare that this DenseLLH object exposes a logLikelihoodT() method.
+    LLHCalcType = LLHCalcTypeT
+  } ;
+
+  /** \brief Matrix type with \a dim rows, storing the factors of one or several effects
+   *         side by side as columns
+   */
+  typedef Eigen::Matrix<ComplexScalar, DMTypes::FixedDim, Eigen::Dynamic>  FactorType;
+  //! Const ref to a FactorType
+  typedef const Eigen::Ref<const FactorType> & FactorTypeConstRef;
+
+  //! Type used to index the POVM effects
+  typedef Eigen::Index IndexType;
+
+  //! Dynamic array of integers, storing frequency counts
+  typedef Eigen::Array<IntFreqType, Eigen::Dynamic, 1>  FreqListType;
+
+
+  /** \brief Simple constructor
+   *
+   * The measurement data is initialially empty.  Call \ref addMeasEffect() or \ref
+   * addMeasEffectFactor() to specify the measurement data.
+   */
+  inline FactoredMeasLLH(DMTypes dmt_)
+    : dmt(dmt_),
+      _V(FactorType::Zero((Eigen::Index)dmt.dim(), 0)),
+      _offsets(1, 0),
+      _complement(),
+      _Nx(FreqListType::Zero(0))
+  {
+  }
+
+  //! The \ref DMTypes object, storing e.g. the dimension of the problem.
+  const DMTypes dmt;
+
+  //! The number of POVM effects in the list
+  inline IndexType numEffects() const { return _Nx.size(); }
+
+  /** \brief The rank of the factor of the i-th POVM effect
+   *
+   * This is the number of columns of \ref effectFactor(i).  If the effect is stored as a
+   * complement, this is the rank of \f$ \mathbb{1}-E_i \f$.
+   */
+  inline IndexType effectFactorRank(IndexType i) const
+  {
+    return _offsets[(std::size_t)i+1] - _offsets[(std::size_t)i];
+  }
+
+  /** \brief The sum of the ranks of all factors
+   *
+   * The log-likelihood function is calculated in \f$ O(d^2\cdot r) \f$ operations, where
+   * \f$ r \f$ is the value returned by this function.
+   */
+  inline IndexType totalFactorRank() const { return _V.cols(); }
+
+  //! The factor \f$ V_i \f$ of the i-th POVM effect
+  inline Eigen::Block<const FactorType, DMTypes::FixedDim, Eigen::Dynamic, true>
+  effectFactor(IndexType i) const
+  {
+    return _V.middleCols(_offsets[(std::size_t)i], effectFactorRank(i));
+  }
+
+  /** \brief Whether the i-th POVM effect is stored as a complement
+   *
+   * If \a true, then \f$ E_i = \mathbb{1} - V_i V_i^\dagger \f$, otherwise \f$ E_i = V_i
+   * V_i^\dagger \f$.
+   */
+  inline bool isComplementEffect(IndexType i) const { return _complement[(std::size_t)i]; }
+
+  //! The i-th POVM effect, as a full matrix
+  inline typename DMTypes::MatrixType effect(IndexType i) const
+  {
+    typename DMTypes::MatrixType E(dmt.initMatrixType());
+    E = effectFactor(i) * effectFactor(i).adjoint();
+    if (_complement[(std::size_t)i]) {
+      E = DMTypes::MatrixType::Identity((Eigen::Index)dmt.dim(), (Eigen::Index)dmt.dim()) - E;
+    }
+    return E;
+  }
+
+  //! The stored frequency counts for each POVM effect
+  inline const FreqListType & Nx() const { return _Nx; }
+
+  //! The number of counts stored for the i-th POVM effect
+  inline IntFreqType Nx(IndexType i) const { return _Nx(i); }
+
+  //! Reset the measurement data to an empty list
+  inline void resetMeas()
+  {
+    _V.resize((Eigen::Index)dmt.dim(), 0);
+    _offsets.assign(1, 0);
+    _complement.clear();
+    _Nx.resize(0);
+  }
+
+  /** \brief Store a POVM effect given in factored form, along with a frequency count
+   *
+   * \param V the factor of the POVM effect, a matrix with \a dim rows and as many columns
+   *        as the rank of the effect (or of its complement).
+   *
+   * \param n the number of times this POVM effect was observed in the experiment.  If \a
+   *        n is zero, the effect is ignored (see \ref IndepMeasLLH::addMeasEffect()).
+   *
+   * \param complement if \a false, the effect is \f$ E = V V^\dagger \f$; if \a true, the
+   *        effect is \f$ E = \mathbb{1} - V V^\dagger \f$.
+   *
+   * \param check_validity Check that \a V specifies a valid, nonzero POVM effect.
+   */
+  inline void addMeasEffectFactor(FactorTypeConstRef V, IntFreqType n, bool complement = false,
+                                  bool check_validity = true)
+  {
+    tomographer_assert(V.rows() == (IndexType)dmt.dim());
+
+    if (n == 0) {
+      return;
+    }
+    tomographer_assert(n > 0);
+
+    if (check_validity) {
+      _check_factor(V, complement);
+    }
+
+    const IndexType offset = _V.cols();
+    _V.conservativeResize(Eigen::NoChange, offset + V.cols());
+    _V.middleCols(offset, V.cols()) = V;
+    _offsets.push_back(offset + V.cols());
+    _complement.push_back(complement);
+
+    const IndexType newi = _Nx.size();
+    _Nx.conservativeResize(newi + 1);
+    _Nx(newi) = n;
+  }
+
+  /** \brief Store a POVM effect given as a full matrix, along with a frequency count
+   *
+   * The effect is diagonalized, and stored either as \f$ E = V V^\dagger \f$ or as \f$ E
+   * = \mathbb{1} - V V^\dagger \f$, whichever requires the factor \f$ V \f$ with the
+   * fewest columns.  Eigenvalues of \f$ E \f$ (resp. of \f$ \mathbb{1}-E \f$) smaller than
+   * \a tol are considered to be zero.
+   *
+   * \param E_m the POVM effect
+   * \param n the number of times this POVM effect was observed in the experiment
+   * \param check_validity Check that \a E_m is a valid, nonzero POVM effect.
+   * \param tol tolerance used to determine the rank of the effect
+   */
+  inline void addMeasEffect(typename DMTypes::MatrixTypeConstRef E_m, IntFreqType n,
+                            bool check_validity = true,
+                            RealScalar tol = Eigen::NumTraits<RealScalar>::dummy_precision())
+  {
+    tomographer_assert(E_m.rows() == E_m.cols());
+    tomographer_assert(E_m.rows() == (IndexType)dmt.dim());
+
+    if (n == 0) {
+      return;
+    }
+
+    if (check_validity) {
+      if ( ! (double( (E_m - E_m.adjoint()).norm() ) < 1e-8) ) { // matrix not Hermitian
+        throw InvalidMeasData(streamstr("POVM effect is not hermitian : E_m =\n"
+                                        << std::setprecision(10) << E_m));
+      }
+    }
+
+    Eigen::SelfAdjointEigenSolver<typename DMTypes::MatrixType> slv(E_m);
+    const auto & eigvals = slv.eigenvalues();
+    const auto & U = slv.eigenvectors();
+
+    if (check_validity && !(eigvals.minCoeff() >= -tol)) {
+      throw InvalidMeasData(streamstr("POVM effect is not positive semidefinite (min eigval="
+                                      << eigvals.minCoeff() << ") : E_m =\n"
+                                      << std::setprecision(10) << E_m));
+    }
+
+    // compare the ranks of E_m and of (1 - E_m)
+    const IndexType rank = (eigvals.array() > tol).count();
+    const IndexType rank_compl = (eigvals.array() < RealScalar(1) - tol).count();
+    const bool complement = (rank_compl < rank && (eigvals.array() <= RealScalar(1) + tol).all());
+
+    FactorType V((Eigen::Index)dmt.dim(), complement ? rank_compl : rank);
+    IndexType j = 0;
+    for (IndexType k = 0; k < eigvals.size(); ++k) {
+      const RealScalar lam = complement ? (RealScalar(1) - eigvals(k)) : eigvals(k);
+      if (complement ? (eigvals(k) < RealScalar(1) - tol) : (eigvals(k) > tol)) {
+        V.col(j) = U.col(k) * std::sqrt(std::max(lam, RealScalar(0)));
+        ++j;
+      }
+    }
+    tomographer_assert(j == V.cols());
+
+    addMeasEffectFactor(V, n, complement, check_validity);
+  }
+
+  /** \brief Calculates the log-likelihood function at the point \f$ \rho = TT^\dagger \f$
+   *
+   * \returns the value of the log-likelihood function of this data at the point \f$ \rho
+   * = TT^\dagger \f$, i.e. \f[
+   *    \log\Lambda = \sum_k \texttt{Nx[k]}\,\ln\mathrm{tr}(E_k\,TT^\dagger) .
+   * \f]
+   *
+   * The matrix products for all effects are calculated together, as a single product
+   * \f$ V^\dagger T \f$ where \f$ V \f$ contains all the factors side by side.
+   *
+   * \note this does not include a sometimes conventional factor \f$ -2\f$.
+   */
+  inline LLHValueType logLikelihoodT(typename DMTypes::MatrixTypeConstRef T) const
+  {
+    // squared norms of the rows of V^\dagger T
+    const Eigen::Matrix<RealScalar, Eigen::Dynamic, 1> sqnorms =
+      (_V.adjoint() * T).rowwise().squaredNorm();
+    const RealScalar trTT = T.squaredNorm();
+
+    LLHValueType value = 0;
+    for (IndexType k = 0; k < _Nx.size(); ++k) {
+      const std::size_t uk = (std::size_t)k;
+      RealScalar p = sqnorms.segment(_offsets[uk], _offsets[uk+1] - _offsets[uk]).sum();
+      if (_complement[uk]) {
+        p = trTT - p;
+      }
+      value += LLHValueType(_Nx(k)) * std::log(LLHValueType(p));
+    }
+    return value;
+  }
+
+  /** \brief Calculates the gradient of the log-likelihood function with respect to \f$ T \f$
+   *
+   * \returns the matrix \f$ G \f$ whose real and imaginary parts are the partial
+   * derivatives of \ref logLikelihoodT() with respect to the real and imaginary parts of
+   * the entries of \a T, i.e., \f[
+   *    G = 2 \sum_k \frac{\texttt{Nx[k]}}{\mathrm{tr}(E_k\,TT^\dagger)}\,E_k\,T .
+   * \f]
+   * As for \ref logLikelihoodT(), the products with the factors of all effects are
+   * calculated together.  This is used by the Hamiltonian random walk \ref
+   * TSpace::LLHHMCWalker (see \ref pageInterfaceDenseLLH).
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  inline typename DMTypes::MatrixType gradLogLikelihoodT(typename DMTypes::MatrixTypeConstRef T) const
+  {
+    const Eigen::Matrix<ComplexScalar, Eigen::Dynamic, DMTypes::FixedDim> W = _V.adjoint() * T;
+    const Eigen::Matrix<RealScalar, Eigen::Dynamic, 1> sqnorms = W.rowwise().squaredNorm();
+    const RealScalar trTT = T.squaredNorm();
+
+    // weight of each column of V, and total weight of the identity in the complement effects
+    Eigen::Matrix<RealScalar, Eigen::Dynamic, 1> colweights(_V.cols());
+    RealScalar identweight = 0;
+    for (IndexType k = 0; k < _Nx.size(); ++k) {
+      const std::size_t uk = (std::size_t)k;
+      const IndexType r = _offsets[uk+1] - _offsets[uk];
+      RealScalar p = sqnorms.segment(_offsets[uk], r).sum();
+      if (_complement[uk]) {
+        p = trTT - p;
+      }
+      const RealScalar c = RealScalar(_Nx(k)) / p;
+      if (_complement[uk]) {
+        colweights.segment(_offsets[uk], r).setConstant(-c);
+        identweight += c;
+      } else {
+        colweights.segment(_offsets[uk], r).setConstant(c);
+      }
+    }
+
+    typename DMTypes::MatrixType G(2 * identweight * T);
+    G.noalias() += 2 * _V * (colweights.asDiagonal() * W);
+    return G;
+  }
+
+  /** \brief Calculates the log-likelihood function at the density matrix \a rho
+   *
+   * This is provided for convenience (e.g. to compare with other \a DenseLLH
+   * implementations); the random walk uses \ref logLikelihoodT().
+   */
+  inline LLHValueType logLikelihoodRho(typename DMTypes::MatrixTypeConstRef rho) const
+  {
+    const RealScalar trrho = rho.trace().real();
+    LLHValueType value = 0;
+    for (IndexType k = 0; k < _Nx.size(); ++k) {
+      const auto V = effectFactor(k);
+      RealScalar p = (V.adjoint() * rho * V).trace().real();
+      if (_complement[(std::size_t)k]) {
+        p = trrho - p;
+      }
+      value += LLHValueType(_Nx(k)) * std::log(LLHValueType(p));
+    }
+    return value;
+  }
+
+private:
+  inline void _check_factor(FactorTypeConstRef V, bool complement) const
+  {
+    if (!complement) {
+      if ( ! (double(V.norm()) > 1e-6) ) { // POVM effect is zero
+        throw InvalidMeasData(streamstr("POVM effect factor is zero : V =\n" << V));
+      }
+      return;
+    }
+    // an empty (or zero) V is fine here, it stands for the identity effect
+    if (V.cols() > 0) {
+      // need 1 - V V^\dagger >= 0, i.e., all singular values of V are at most one
+      Eigen::JacobiSVD<FactorType> svd(V);
+      const RealScalar maxsv = svd.singularValues().maxCoeff();
+      if ( ! (maxsv <= RealScalar(1) + Eigen::NumTraits<RealScalar>::dummy_precision()) ) {
+        throw InvalidMeasData(streamstr("POVM effect 1 - V*V' is not positive semidefinite (max singular "
+                                        "value of V=" << maxsv << ") : V =\n"
+                                        << std::setprecision(10) << V));
+      }
+    }
+    // tr(1 - V V^\dagger) = dim - |V|^2 vanishes iff the (positive semidefinite) effect is zero
+    if ( ! (double(RealScalar(dmt.dim()) - V.squaredNorm()) > 1e-6) ) {
+      throw InvalidMeasData(streamstr("POVM effect 1 - V*V' is zero : V =\n" << V));
+    }
+  }
+
+  //! All factors, side by side
+  FactorType _V;
+  //! The factor of the i-th effect is given by the columns _offsets[i] ... _offsets[i+1]-1 of _V
+  std::vector<IndexType> _offsets;
+  //! Whether each effect is stored as a complement
+  std::vector<bool> _complement;
+  //! Frequency counts
+  FreqListType _Nx;
+
+  friend boost::serialization::access;
+  template<typename Archive>
+  void serialize(Archive & a, const unsigned int /* version */)
+  {
+    a & _V;
+    a & _offsets;
+    a & _complement;
+    a & _Nx;
+  }
+};
+
+
+} // namespace DenseDM
+} // namespace Tomographer
+
+
+//
+// As for IndepMeasLLH, serializing a pointer requires the constructor arguments
+//
+namespace boost {
+namespace serialization {
+template<typename Archive, typename DMTypes_, typename LLHValueType_, typename IntFreqType_>
+inline void save_construct_data(
+    Archive & a,
+    const Tomographer::DenseDM::FactoredMeasLLH<DMTypes_, LLHValueType_, IntFreqType_> * t,
+    const unsigned int /*version*/)
+{
+  Eigen::Index dim = t->dmt.dim();
+  a << dim;
+}
+
+template<class Archive, typename DMTypes_, typename LLHValueType_, typename IntFreqType_>
+inline void load_construct_data(
+    Archive & a,
+    Tomographer::DenseDM::FactoredMeasLLH<DMTypes_, LLHValueType_, IntFreqType_> * t,
+    const unsigned int /*version*/)
+{
+  typedef Tomographer::DenseDM::FactoredMeasLLH<DMTypes_, LLHValueType_, IntFreqType_>  LLHType;
+  Eigen::Index dim;
+  a >> dim;
+  ::new(t) LLHType(typename LLHType::DMTypes(dim));
+}
+} // namespace serialization
+} // namespace boost
+
+
+
+#endif
@@ -30,11 +30,15 @@
 
 #include <cstddef>
 #include <string>
+#include <utility> // std::move
+#include <algorithm> // std::min, std::max
+#include <type_traits> // std::conditional
 #include <iomanip> // std::setprecision, std::setw and friends.
 
 #include <Eigen/Eigen>
 
 #include <boost/serialization/serialization.hpp>
+#include <boost/serialization/split_member.hpp>
 
 #include <tomographer/tools/cxxutil.h> // StaticOrDynamic, TOMOGRAPHER_ENABLED_IF
 #include <tomographer/tools/needownoperatornew.h>
@@ -60,12 +64,28 @@ namespace DenseDM {
  *
  * Implements the \ref pageInterfaceDenseLLH.
  *
+ * If \a PaddedExnStorage_ is \c true, the POVM effects are stored internally with each
+ * row padded with zeros to a multiple of the SIMD packet size of the scalar type, so that
+ * every row starts on an aligned address and the product with the (likewise padded) point
+ * \a x uses full-width aligned vector operations, even when \f$ d^2\f$ is not a multiple
+ * of the SIMD width (e.g. \f$ d=3\f$ or \f$ d=6\f$).  The log-likelihood and its gradient
+ * are then computed over tiles of POVM effects sized to stay in the L1/L2 caches.  This
+ * is transparent to the user: \ref Exn() still returns the logical \f$ d^2\f$-column
+ * matrix (as a strided view instead of a reference to a \ref VectorParamListType).
+ *
+ * The padding also increases the amount of memory which has to be streamed for each
+ * evaluation of the log-likelihood, so whether this layout pays off depends on the CPU
+ * and on the number of POVM effects; benchmark before enabling it.
+ *
  * \since Since %Tomographer 5.3, <em>a pointer to</em> this class can be
  *        serialized with Boost.Serialization.
+ *
+ * \since Since %Tomographer 5.5, the template parameter \a PaddedExnStorage_ selects the
+ *        padded storage layout described above.
  */
 template<typename DMTypes_, typename LLHValueType_ = typename DMTypes_::RealScalar,
          typename IntFreqType_ = int, int FixedMaxParamList_ = Eigen::Dynamic,
-	 bool UseNMeasAmplifyFactor_ = false>
+	 bool UseNMeasAmplifyFactor_ = false, bool PaddedExnStorage_ = false>
 class TOMOGRAPHER_EXPORT IndepMeasLLH
 // : public Tools::NeedEigenAlignedOperatorNew::ProviderType -- not needed, matrices are Eigen::Dynamic for now
 {
@@ -82,6 +102,15 @@ public:
   static constexpr bool IsDynamicMaxParamList = (FixedMaxParamList_ == Eigen::Dynamic);
   //! Whether we allow NMeasAmplifyFactor to be set
   static constexpr bool UseNMeasAmplifyFactor = UseNMeasAmplifyFactor_;
+  //! Whether the POVM effects are stored with rows padded to the SIMD width (see class doc)
+  static constexpr bool PaddedExnStorage = PaddedExnStorage_;
+  /** \brief The number of scalars each stored row is padded to a multiple of
+   *
+   * This is the SIMD packet size for \a DMTypes::RealScalar if \ref PaddedExnStorage is
+   * set, or one otherwise.
+   */
+  static constexpr int ExnRowPadding =
+    PaddedExnStorage_ ? (int)Eigen::internal::packet_traits<typename DMTypes_::RealScalar>::size : 1;
 
   /** \brief Declare some stuff as part of the \ref pageInterfaceDenseLLH compliance
    *
@@ -100,6 +129,31 @@ public:
   //! Const ref to a VectorParamListType
   typedef const Eigen::Ref<const VectorParamListType> & VectorParamListTypeConstRef;
 
+  /** \brief Type used internally to store the POVM effects
+   *
+   * This is the same as \ref VectorParamListType, unless \ref PaddedExnStorage is set, in
+   * which case each row has \ref exnStorageCols() columns (the last ones are zero).
+   */
+  typedef Eigen::Matrix<typename DMTypes::RealScalar, Eigen::Dynamic,
+                        (DMTypes::FixedDim2 == Eigen::Dynamic) ? Eigen::Dynamic
+                        : (DMTypes::FixedDim2 + ExnRowPadding - 1) / ExnRowPadding * ExnRowPadding,
+                        Eigen::RowMajor, FixedMaxParamList,
+                        (DMTypes::FixedDim2 == Eigen::Dynamic) ? Eigen::Dynamic
+                        : (DMTypes::FixedDim2 + ExnRowPadding - 1) / ExnRowPadding * ExnRowPadding>
+    ExnStorageType;
+
+  /** \brief Type returned by \ref Exn()
+   *
+   * This is a const reference to the stored \ref VectorParamListType, or with \ref
+   * PaddedExnStorage, a strided \a Eigen::Map which exposes only the \f$ d^2\f$ logical
+   * columns of the padded storage.
+   */
+  typedef typename std::conditional<
+    PaddedExnStorage,
+    Eigen::Map<const VectorParamListType, Eigen::Unaligned, Eigen::OuterStride<> >,
+    const VectorParamListType &
+    >::type  ExnConstViewType;
+
   /** \brief Type used to index entries in VectorParamListType (and also used for indexing
    *         entries in FreqListType)
    */
@@ -119,7 +173,7 @@ public:
    * \ref setMeas() to specify the measurement data.
    */
   inline IndepMeasLLH(DMTypes dmt_)
-    : dmt(dmt_), _Exn(VectorParamListType::Zero(0, (Eigen::Index)dmt.dim2())), _Nx(FreqListType::Zero(0)),
+    : dmt(dmt_), _Exn(ExnStorageType::Zero(0, exnStorageCols())), _Nx(FreqListType::Zero(0)),
       _NMeasAmplifyFactor(1)
   {
   }
@@ -129,7 +183,7 @@ public:
    * The measurement data is set to \a Exn_ and \a Nx_ via a call to \ref setMeas().
    */
   inline IndepMeasLLH(DMTypes dmt_, VectorParamListTypeConstRef Exn_, FreqListTypeConstRef Nx_)
-    : dmt(dmt_), _Exn(VectorParamListType::Zero(0, dmt.dim2())), _Nx(FreqListType::Zero(0)), _NMeasAmplifyFactor(1)
+    : dmt(dmt_), _Exn(ExnStorageType::Zero(0, exnStorageCols())), _Nx(FreqListType::Zero(0)), _NMeasAmplifyFactor(1)
   {
     setMeas(Exn_, Nx_);
   }
@@ -155,7 +209,7 @@ public:
    *
    * See also \ref Exn(IndexType i) const
    */
-  inline const VectorParamListType & Exn() const { return _Exn; }
+  inline ExnConstViewType Exn() const { return _exn_view(); }
 
   /** \brief  The i-th stored POVM effect, in \ref pageParamsX
    *
@@ -165,7 +219,16 @@ public:
    */
   inline Eigen::Ref<const typename DMTypes::VectorParamType>  Exn(IndexType i) const
   {
-    return _Exn.row(i).transpose();
+    return _Exn.row(i).head(dmt.dim2()).transpose();
+  }
+
+  /** \brief The number of columns of the internal storage of the POVM effects
+   *
+   * This is \f$ d^2\f$ rounded up to a multiple of \ref ExnRowPadding.
+   */
+  inline Eigen::Index exnStorageCols() const
+  {
+    return (dmt.dim2() + ExnRowPadding - 1) / ExnRowPadding * ExnRowPadding;
   }
 
 
@@ -198,7 +261,7 @@ public:
    */
   inline void resetMeas()
   {
-    _Exn.resize(0, (Eigen::Index)dmt.dim2());
+    _Exn.resize(0, exnStorageCols());
     _Nx.resize(0);
   }
 
@@ -237,7 +300,8 @@ public:
     tomographer_assert(newi == _Nx.rows());
 
     _Exn.conservativeResize(newi + 1, Eigen::NoChange);
-    _Exn.row(newi) = E_x.transpose();
+    _Exn.row(newi).head(dmt.dim2()) = E_x.transpose();
+    _Exn.row(newi).tail(exnStorageCols() - dmt.dim2()).setZero();
     _Nx.conservativeResize(newi + 1, Eigen::NoChange);
     _Nx(newi) = n;
 
@@ -266,6 +330,9 @@ public:
 
     if (check_validity) { // check validity of measurement data
       tomographer_assert(n > 0);
+      // HermToX() only reads the lower triangular part, so this is the only place where
+      // we can tell whether the effect is hermitian
+      _check_hermitian(E_m);
       _check_effect(E_m);
     }
 
@@ -284,8 +351,7 @@ public:
 
     if ((Nx_ > 0).all()) {
       // all measurements are OK, so we can just copy the data.
-      _Exn.resize(Exn_.rows(), (Eigen::Index)dmt.dim2());
-      _Exn = Exn_;
+      _assign_Exn(Exn_);
       _Nx.resize(Nx_.rows(), 1);
       _Nx = Nx_;
     } else {
@@ -300,9 +366,32 @@ public:
     }
   }
 
+  /** \brief Specify the full measurement data at once, taking over the given arrays
+   *
+   * This overload moves the arrays \a Exn_ and \a Nx_ into this object instead of copying
+   * them, which avoids holding two copies of a large list of POVM effects in memory.  All
+   * the frequency counts in \a Nx_ must be positive (filter out the POVM effects which
+   * were never observed beforehand).
+   *
+   * With \ref PaddedExnStorage, \a Exn_ is copied into the padded storage and released
+   * afterwards.
+   */
+  inline void setMeas(VectorParamListType && Exn_, FreqListType && Nx_, bool check_validity = true)
+  {
+    tomographer_assert(Exn_.cols() == (IndexType)dmt.dim2());
+    tomographer_assert(Exn_.rows() == Nx_.rows());
+    tomographer_assert((Nx_ > 0).all());
+
+    _move_Exn(std::move(Exn_));
+    _Nx = std::move(Nx_);
+    if (check_validity) {
+      checkAllMeas();
+    }
+  }
+
   inline void checkAllMeas() const
   {
-    tomographer_assert(_Exn.cols() == (IndexType)dmt.dim2());
+    tomographer_assert(_Exn.cols() == exnStorageCols());
     tomographer_assert(_Exn.rows() == _Nx.rows());
     tomographer_assert(_Nx.cols() == 1);
 
@@ -311,37 +400,52 @@ public:
       tomographer_assert(_Nx(i) > 0);
 
       typename DMTypes::MatrixType E_m(dmt.initMatrixType());
-      E_m = ParamX<DMTypes>(dmt).XToHerm(_Exn.row(i).transpose());
+      E_m = ParamX<DMTypes>(dmt).XToHerm(Exn(i));
       _check_effect(E_m);
     }
   }
   inline void checkEffect(IndexType i) const
   {
-    tomographer_assert(_Exn.cols() == (IndexType)dmt.dim2());
+    tomographer_assert(_Exn.cols() == exnStorageCols());
     tomographer_assert(_Exn.rows() == _Nx.rows());
     tomographer_assert(_Nx.cols() == 1);
     tomographer_assert(i >= 0 && i < _Exn.rows());
     tomographer_assert(_Nx(i) > 0);
 
     typename DMTypes::MatrixType E_m(dmt.initMatrixType());
-    E_m = ParamX<DMTypes>(dmt).XToHerm(_Exn.row(i).transpose());
+    E_m = ParamX<DMTypes>(dmt).XToHerm(Exn(i));
     _check_effect(E_m);
   }
 
 private:
-  inline void _check_effect(typename DMTypes::MatrixType E_m) const
+  inline void _check_hermitian(typename DMTypes::MatrixTypeConstRef E_m) const
   {
     if ( ! (double( (E_m - E_m.adjoint()).norm() ) < 1e-8) ) { // matrix not Hermitian
       throw InvalidMeasData(streamstr("POVM effect is not hermitian : E_m =\n"
 				      << std::setprecision(10) << E_m));
     }
-    Eigen::SelfAdjointEigenSolver<typename DMTypes::MatrixType> slv(E_m);
-    const typename DMTypes::RealScalar mineigval = slv.eigenvalues().minCoeff();
-    if ( ! (mineigval >= -Eigen::NumTraits<typename DMTypes::RealScalar>::dummy_precision()) ) {
-      // not positive semidef
-      throw InvalidMeasData(streamstr("POVM effect is not positive semidefinite (min eigval="
-                                      << mineigval << ") : E_m =\n"
-				      << std::setprecision(10) << E_m));
+  }
+  // E_m is hermitian here, either checked by _check_hermitian() or obtained from an
+  // X-parameterization
+  inline void _check_effect(const typename DMTypes::MatrixType & E_m) const
+  {
+    typedef typename DMTypes::RealScalar RealScalar;
+    // E_m + eps*Id is positive definite iff all eigenvalues of E_m are larger than -eps.
+    // A Cholesky decomposition is much cheaper than the eigenvalues, which we only compute
+    // if it fails, to decide for sure and to report the smallest eigenvalue.
+    const RealScalar eps = Eigen::NumTraits<RealScalar>::dummy_precision();
+    typename DMTypes::MatrixType E_shifted(E_m);
+    E_shifted.diagonal().array() += eps;
+    Eigen::LLT<typename DMTypes::MatrixType> llt(E_shifted);
+    if (llt.info() != Eigen::Success) {
+      Eigen::SelfAdjointEigenSolver<typename DMTypes::MatrixType> slv(E_m, Eigen::EigenvaluesOnly);
+      const RealScalar mineigval = slv.eigenvalues().minCoeff();
+      if ( ! (mineigval >= -eps) ) {
+        // not positive semidef
+        throw InvalidMeasData(streamstr("POVM effect is not positive semidefinite (min eigval="
+                                        << mineigval << ") : E_m =\n"
+                                        << std::setprecision(10) << E_m));
+      }
     }
     if ( ! (double(E_m.norm()) > 1e-6) ) { // POVM effect is zero
       throw InvalidMeasData(streamstr("POVM effect is zero : E_m =\n" << E_m));
@@ -383,9 +487,140 @@ public:
    */
   inline LLHValueType logLikelihoodX(typename DMTypes::VectorParamTypeConstRef x) const
   {
-    return _mult_by_nmeasfactor(
-	(_Nx.template cast<LLHValueType>() * (_Exn * x).template cast<LLHValueType>().array().log()).sum()
-	);
+    return _mult_by_nmeasfactor(_log_likelihood_x(x));
+  }
+
+  /** \brief Calculates the gradient of the log-likelihood function, in X parameterization
+   *
+   * \returns the vector of partial derivatives of \ref logLikelihoodX() with respect to
+   * the components of \a x, \f[
+   *    \frac{\partial\log\Lambda}{\partial\texttt{x}} = \sum_k
+   *    \frac{\texttt{Nx[k]}}{\mathrm{tr}(\texttt{Exn[k]}\,\rho(\texttt{x}))}\,\texttt{Exn[k]} .
+   * \f]
+   * This is used by the Hamiltonian random walk \ref TSpace::LLHHMCWalker (see \ref
+   * pageInterfaceDenseLLH).
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  inline typename DMTypes::VectorParamType gradLogLikelihoodX(typename DMTypes::VectorParamTypeConstRef x) const
+  {
+    return _grad_log_likelihood_x(x);
+  }
+
+private:
+  //
+  // Plain storage: one product with the whole Exn matrix
+  //
+  TOMOGRAPHER_ENABLED_IF(!PaddedExnStorage)
+  inline LLHValueType _log_likelihood_x(typename DMTypes::VectorParamTypeConstRef x) const
+  {
+    return (_Nx.template cast<LLHValueType>() * (_Exn * x).template cast<LLHValueType>().array().log()).sum();
+  }
+  TOMOGRAPHER_ENABLED_IF(!PaddedExnStorage)
+  inline typename DMTypes::VectorParamType _grad_log_likelihood_x(typename DMTypes::VectorParamTypeConstRef x) const
+  {
+    typedef typename DMTypes::RealScalar RealScalar;
+    const Eigen::Array<RealScalar, Eigen::Dynamic, 1> w =
+      RealScalar(NMeasAmplifyFactor()) * _Nx.template cast<RealScalar>() / (_Exn * x).array();
+    return _Exn.transpose() * w.matrix();
+  }
+
+  //
+  // Padded storage: pad x with zeros to match the rows, and go through the POVM effects
+  // tile by tile
+  //
+  typedef Eigen::Matrix<typename DMTypes::RealScalar, ExnStorageType::ColsAtCompileTime, 1> _PaddedVectorType;
+
+  inline _PaddedVectorType _padded_x(typename DMTypes::VectorParamTypeConstRef x) const
+  {
+    _PaddedVectorType xp(exnStorageCols());
+    xp.head(dmt.dim2()) = x;
+    xp.tail(exnStorageCols() - dmt.dim2()).setZero();
+    return xp;
+  }
+
+  /** \brief Number of POVM effects processed at once with \ref PaddedExnStorage
+   *
+   * A tile of POVM effects should fit in (half) the L2 cache, so that it is still there for
+   * the second pass of the gradient calculation, and the vector of \f$ \mathrm{tr}(E_k\rho)\f$
+   * for the tile should fit in (half) the L1 cache.
+   */
+  inline IndexType _tile_rows() const
+  {
+    const std::ptrdiff_t row_bytes = (std::ptrdiff_t)(exnStorageCols() * sizeof(typename DMTypes::RealScalar));
+    const std::ptrdiff_t l1_rows = Eigen::l1CacheSize() / 2 / (std::ptrdiff_t)sizeof(typename DMTypes::RealScalar);
+    const std::ptrdiff_t l2_rows = Eigen::l2CacheSize() / 2 / std::max<std::ptrdiff_t>(row_bytes, 1);
+    const std::ptrdiff_t rows = std::min(l1_rows, l2_rows) / ExnRowPadding * ExnRowPadding;
+    return (IndexType)std::max<std::ptrdiff_t>(rows, ExnRowPadding);
+  }
+
+  TOMOGRAPHER_ENABLED_IF(PaddedExnStorage)
+  inline LLHValueType _log_likelihood_x(typename DMTypes::VectorParamTypeConstRef x) const
+  {
+    const _PaddedVectorType xp = _padded_x(x);
+    const IndexType num_effects = _Exn.rows();
+    const IndexType tile_rows = std::min(_tile_rows(), num_effects);
+    Eigen::Matrix<typename DMTypes::RealScalar, Eigen::Dynamic, 1> trErho(tile_rows);
+
+    LLHValueType value = 0;
+    for (IndexType k = 0; k < num_effects; k += tile_rows) {
+      const IndexType n = std::min(tile_rows, num_effects - k);
+      trErho.head(n).noalias() = _Exn.middleRows(k, n) * xp;
+      value += (_Nx.segment(k, n).template cast<LLHValueType>()
+                * trErho.head(n).template cast<LLHValueType>().array().log()).sum();
+    }
+    return value;
+  }
+  TOMOGRAPHER_ENABLED_IF(PaddedExnStorage)
+  inline typename DMTypes::VectorParamType _grad_log_likelihood_x(typename DMTypes::VectorParamTypeConstRef x) const
+  {
+    typedef typename DMTypes::RealScalar RealScalar;
+    const _PaddedVectorType xp = _padded_x(x);
+    const IndexType num_effects = _Exn.rows();
+    const IndexType tile_rows = std::min(_tile_rows(), num_effects);
+    Eigen::Matrix<RealScalar, Eigen::Dynamic, 1> w(tile_rows);
+
+    _PaddedVectorType grad = _PaddedVectorType::Zero(exnStorageCols());
+    for (IndexType k = 0; k < num_effects; k += tile_rows) {
+      const IndexType n = std::min(tile_rows, num_effects - k);
+      w.head(n).noalias() = _Exn.middleRows(k, n) * xp;
+      w.head(n).array() = _Nx.segment(k, n).template cast<RealScalar>() / w.head(n).array();
+      grad.noalias() += _Exn.middleRows(k, n).transpose() * w.head(n);
+    }
+    return RealScalar(NMeasAmplifyFactor()) * grad.head(dmt.dim2());
+  }
+
+  //
+  // Storing the POVM effects
+  //
+  TOMOGRAPHER_ENABLED_IF(!PaddedExnStorage)
+  inline ExnConstViewType _exn_view() const
+  {
+    return _Exn;
+  }
+  TOMOGRAPHER_ENABLED_IF(PaddedExnStorage)
+  inline ExnConstViewType _exn_view() const
+  {
+    return ExnConstViewType(_Exn.data(), _Exn.rows(), dmt.dim2(), Eigen::OuterStride<>(_Exn.cols()));
+  }
+
+  inline void _assign_Exn(VectorParamListTypeConstRef Exn_)
+  {
+    _Exn.resize(Exn_.rows(), exnStorageCols());
+    _Exn.leftCols(dmt.dim2()) = Exn_;
+    _Exn.rightCols(exnStorageCols() - dmt.dim2()).setZero();
+  }
+
+  TOMOGRAPHER_ENABLED_IF(!PaddedExnStorage)
+  inline void _move_Exn(VectorParamListType && Exn_)
+  {
+    _Exn = std::move(Exn_);
+  }
+  TOMOGRAPHER_ENABLED_IF(PaddedExnStorage)
+  inline void _move_Exn(VectorParamListType && Exn_)
+  {
+    _assign_Exn(Exn_);
+    Exn_.resize(0, dmt.dim2()); // release the memory right away
   }
 
 private:
@@ -401,22 +636,56 @@ private:
   }
 
 private:
-  //! Store the data returned by \ref Exn() 
-  VectorParamListType _Exn;
+  //! Store the data returned by \ref Exn() (possibly with padded rows)
+  ExnStorageType _Exn;
   //! Store the data returned by \ref Nx() 
   FreqListType _Nx;
 
   //! Number by which to artificially amplify the frequency vector (for tests)
   Tomographer::Tools::StoreIfEnabled<LLHValueType, UseNMeasAmplifyFactor> _NMeasAmplifyFactor;
 
+  // the POVM effects are always serialized in their logical, unpadded form, so that the
+  // archive doesn't depend on the storage layout
   friend boost::serialization::access;
   template<typename Archive>
-  void serialize(Archive & a, const unsigned int version)
+  void save(Archive & a, const unsigned int version) const
   {
-    a & _Exn;
-    a & _Nx;
+    _save_Exn(a);
+    a << _Nx;
+    const_cast<IndepMeasLLH*>(this)->maybe_serialize_nmeasamplifyfactor(a, version);
+  }
+  template<typename Archive>
+  void load(Archive & a, const unsigned int version)
+  {
+    _load_Exn(a);
+    a >> _Nx;
     maybe_serialize_nmeasamplifyfactor(a, version);
   }
+  BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+  template<typename Archive, TOMOGRAPHER_ENABLED_IF_TMPL(!PaddedExnStorage)>
+  inline void _save_Exn(Archive & a) const
+  {
+    a << _Exn;
+  }
+  template<typename Archive, TOMOGRAPHER_ENABLED_IF_TMPL(PaddedExnStorage)>
+  inline void _save_Exn(Archive & a) const
+  {
+    const VectorParamListType Exn_(Exn());
+    a << Exn_;
+  }
+  template<typename Archive, TOMOGRAPHER_ENABLED_IF_TMPL(!PaddedExnStorage)>
+  inline void _load_Exn(Archive & a)
+  {
+    a >> _Exn;
+  }
+  template<typename Archive, TOMOGRAPHER_ENABLED_IF_TMPL(PaddedExnStorage)>
+  inline void _load_Exn(Archive & a)
+  {
+    VectorParamListType Exn_;
+    a >> Exn_;
+    _assign_Exn(Exn_);
+  }
   template<typename Archive, TOMOGRAPHER_ENABLED_IF_TMPL(UseNMeasAmplifyFactor)>
   inline void maybe_serialize_nmeasamplifyfactor(Archive & a, const unsigned int /*version*/)
   {
@@ -428,19 +697,29 @@ private:
 // define static members:
 template<typename DMTypes_, typename LLHValueType_,
          typename IntFreqType_, int FixedMaxParamList_,
-	 bool UseNMeasAmplifyFactor_>
+	 bool UseNMeasAmplifyFactor_, bool PaddedExnStorage_>
 constexpr int
-IndepMeasLLH<DMTypes_,LLHValueType_,IntFreqType_,FixedMaxParamList_,UseNMeasAmplifyFactor_>::FixedMaxParamList;
+IndepMeasLLH<DMTypes_,LLHValueType_,IntFreqType_,FixedMaxParamList_,UseNMeasAmplifyFactor_,PaddedExnStorage_>::FixedMaxParamList;
 template<typename DMTypes_, typename LLHValueType_,
          typename IntFreqType_, int FixedMaxParamList_,
-	 bool UseNMeasAmplifyFactor_>
+	 bool UseNMeasAmplifyFactor_, bool PaddedExnStorage_>
 constexpr bool
-IndepMeasLLH<DMTypes_,LLHValueType_,IntFreqType_,FixedMaxParamList_,UseNMeasAmplifyFactor_>::IsDynamicMaxParamList;
+IndepMeasLLH<DMTypes_,LLHValueType_,IntFreqType_,FixedMaxParamList_,UseNMeasAmplifyFactor_,PaddedExnStorage_>::IsDynamicMaxParamList;
 template<typename DMTypes_, typename LLHValueType_,
          typename IntFreqType_, int FixedMaxParamList_,
-	 bool UseNMeasAmplifyFactor_>
+	 bool UseNMeasAmplifyFactor_, bool PaddedExnStorage_>
 constexpr bool
-IndepMeasLLH<DMTypes_,LLHValueType_,IntFreqType_,FixedMaxParamList_,UseNMeasAmplifyFactor_>::UseNMeasAmplifyFactor;
+IndepMeasLLH<DMTypes_,LLHValueType_,IntFreqType_,FixedMaxParamList_,UseNMeasAmplifyFactor_,PaddedExnStorage_>::UseNMeasAmplifyFactor;
+template<typename DMTypes_, typename LLHValueType_,
+         typename IntFreqType_, int FixedMaxParamList_,
+	 bool UseNMeasAmplifyFactor_, bool PaddedExnStorage_>
+constexpr bool
+IndepMeasLLH<DMTypes_,LLHValueType_,IntFreqType_,FixedMaxParamList_,UseNMeasAmplifyFactor_,PaddedExnStorage_>::PaddedExnStorage;
+template<typename DMTypes_, typename LLHValueType_,
+         typename IntFreqType_, int FixedMaxParamList_,
+	 bool UseNMeasAmplifyFactor_, bool PaddedExnStorage_>
+constexpr int
+IndepMeasLLH<DMTypes_,LLHValueType_,IntFreqType_,FixedMaxParamList_,UseNMeasAmplifyFactor_,PaddedExnStorage_>::ExnRowPadding;
 
 } // namespace DenseDM
 } // namespace Tomographer
@@ -454,11 +733,11 @@ namespace boost {
 namespace serialization {
 template<typename Archive,
          typename DMTypes_, typename LLHValueType_, typename IntFreqType_,
-         int FixedMaxParamList_, bool UseNMeasAmplifyFactor_>
+         int FixedMaxParamList_, bool UseNMeasAmplifyFactor_, bool PaddedExnStorage_>
 inline void save_construct_data(
     Archive & a,
     const Tomographer::DenseDM::IndepMeasLLH<DMTypes_, LLHValueType_, IntFreqType_,
-                                             FixedMaxParamList_, UseNMeasAmplifyFactor_> * t,
+                                             FixedMaxParamList_, UseNMeasAmplifyFactor_, PaddedExnStorage_> * t,
     const unsigned int /*version*/)
 {
   // save data required to construct instance
@@ -468,15 +747,15 @@ inline void save_construct_data(
 
 template<class Archive,
          typename DMTypes_, typename LLHValueType_, typename IntFreqType_,
-         int FixedMaxParamList_, bool UseNMeasAmplifyFactor_>
+         int FixedMaxParamList_, bool UseNMeasAmplifyFactor_, bool PaddedExnStorage_>
 inline void load_construct_data(
     Archive & a,
     Tomographer::DenseDM::IndepMeasLLH<DMTypes_, LLHValueType_, IntFreqType_,
-                                       FixedMaxParamList_, UseNMeasAmplifyFactor_> * t,
+                                       FixedMaxParamList_, UseNMeasAmplifyFactor_, PaddedExnStorage_> * t,
     const unsigned int /*version*/)
 {
   typedef Tomographer::DenseDM::IndepMeasLLH<DMTypes_, LLHValueType_, IntFreqType_,
-                                             FixedMaxParamList_, UseNMeasAmplifyFactor_>  TheFreakinType;
+                                             FixedMaxParamList_, UseNMeasAmplifyFactor_, PaddedExnStorage_>  TheFreakinType;
   // retrieve data from archive required to construct new instance
   Eigen::Index dim;
   a >> dim;
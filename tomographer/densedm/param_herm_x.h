@@ -105,7 +105,49 @@ public:
 
     return x;
   }
-  
+
+  /** \brief Get the X-parameterization of a hermitian matrix given by its real and
+   *         imaginary parts
+   *
+   * This does the same as \ref HermToX(), but reads the hermitian matrix from two real
+   * matrices \a HermRe and \a HermIm holding its real and imaginary parts (e.g. the
+   * split complex data of a MATLAB file, see \ref Tomographer::MAT::VarMatrixSliceReader),
+   * and writes the result into the existing vector (or row) \a x, without forming a
+   * temporary complex matrix.  The matrices may have any real scalar type.
+   *
+   * \note This function only accesses lower triangular part of \c HermRe and \c HermIm.
+   */
+  template<typename DerivedX, typename DerivedRe, typename DerivedIm>
+  inline void splitHermToX(const Eigen::DenseBase<DerivedX> & x_,
+                           const Eigen::DenseBase<DerivedRe> & HermRe,
+                           const Eigen::DenseBase<DerivedIm> & HermIm) const
+  {
+    // write into the given expression, see "Writing Functions Taking Eigen Types as
+    // Parameters" in Eigen's documentation
+    Eigen::DenseBase<DerivedX> & x = const_cast<Eigen::DenseBase<DerivedX>&>(x_);
+
+    const Eigen::Index dim2 = dim*dim;
+    const Eigen::Index dimtri = (dim2 - dim)/2;
+
+    tomographer_assert(x.size() == dim2);
+    tomographer_assert(HermRe.rows() == dim && HermRe.cols() == dim);
+    tomographer_assert(HermIm.rows() == dim && HermIm.cols() == dim);
+
+    for (IndexType n = 0; n < dim; ++n) {
+      x(n) = RealScalar(HermRe(n,n));
+    }
+
+    IndexType k = dim;
+    IndexType n, m;
+    for (n = 1; n < dim; ++n) {
+      for (m = 0; m < n; ++m) {
+        x(k)          = RealScalar(HermRe(n,m)) * boost::math::constants::root_two<RealScalar>();
+        x(dimtri + k) = RealScalar(HermIm(n,m)) * boost::math::constants::root_two<RealScalar>();
+        ++k;
+      }
+    }
+  }
+
   /** \brief Get the Hermitian matrix parameterized by the "X-parameter" vector \c x
    *
    * This calculates the hermitian matrix which is parameterized by \c x.
@@ -0,0 +1,257 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TOMOGRAPHER_DENSEDM_POVMVALIDATION_H
+#define TOMOGRAPHER_DENSEDM_POVMVALIDATION_H
+
+
+/** \file povmvalidation.h
+ *
+ * \brief Checks of the validity of POVM effects, run in parallel over several threads
+ *
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <exception>
+#include <algorithm>
+#include <iomanip>
+
+#include <Eigen/Core>
+
+#include <tomographer/tools/cxxutil.h> // TOMOGRAPHER_EXPORT, tomographer_assert()
+#include <tomographer/tools/fmt.h> // streamstr
+#include <tomographer/densedm/densellh.h> // InvalidMeasData
+
+
+namespace Tomographer {
+namespace DenseDM {
+
+
+/** \brief Check all the POVM effects of a likelihood object, using several threads
+ *
+ * This does the same as calling \a llh.checkAllMeas(), e.g. for an \ref IndepMeasLLH,
+ * but distributes the POVM effects over \a num_threads threads.  The effects are checked
+ * individually by calling \a llh.checkEffect(i), which must be safe to call concurrently
+ * (this is the case for \ref IndepMeasLLH).  If \a num_threads is zero or negative, as
+ * many threads as there are hardware cores are used.
+ *
+ * The threads pick up the effects in chunks of \a chunk_size effects.  As soon as an
+ * invalid effect is found, no further chunks are started.  Then the \ref InvalidMeasData
+ * exception of the invalid effect with the lowest index among those which were checked is
+ * thrown, with the index of the effect in the message.  (Any other exception raised by
+ * \a checkEffect() is rethrown as is.)
+ */
+template<typename DenseLLHType>
+inline void checkAllMeasParallel(const DenseLLHType & llh, int num_threads = 0,
+                                 Eigen::Index chunk_size = 64)
+{
+  typedef Eigen::Index IndexType;
+
+  const IndexType num_effects = llh.numEffects();
+  tomographer_assert(chunk_size > 0);
+
+  if (num_threads <= 0) {
+    num_threads = (int)std::thread::hardware_concurrency();
+  }
+  const IndexType num_chunks = (num_effects + chunk_size - 1) / chunk_size;
+  num_threads = (int)std::max<IndexType>(1, std::min<IndexType>(num_threads, num_chunks));
+
+  std::atomic<IndexType> next_chunk(0);
+  std::atomic<bool> failed(false);
+
+  std::mutex error_mutex;
+  IndexType error_index = num_effects;
+  std::string error_msg;
+  std::exception_ptr other_error;
+
+  auto worker = [&]() {
+    while (!failed.load()) {
+      const IndexType chunk = next_chunk.fetch_add(1);
+      if (chunk >= num_chunks) {
+        return;
+      }
+      const IndexType end = std::min(num_effects, (chunk+1)*chunk_size);
+      for (IndexType i = chunk*chunk_size; i < end; ++i) {
+        try {
+          llh.checkEffect(i);
+        } catch (const InvalidMeasData & e) {
+          std::lock_guard<std::mutex> lock(error_mutex);
+          if (i < error_index) {
+            error_index = i;
+            error_msg = e.msg();
+          }
+          failed.store(true);
+          return;
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(error_mutex);
+          if (!other_error) {
+            other_error = std::current_exception();
+          }
+          failed.store(true);
+          return;
+        }
+      }
+    }
+  };
+
+  if (num_threads == 1) {
+    worker();
+  } else {
+    std::vector<std::thread> threads;
+    threads.reserve((std::size_t)num_threads);
+    for (int k = 0; k < num_threads; ++k) {
+      threads.push_back(std::thread(worker));
+    }
+    for (auto & t : threads) {
+      t.join();
+    }
+  }
+
+  if (other_error) {
+    std::rethrow_exception(other_error);
+  }
+  if (error_index < num_effects) {
+    throw InvalidMeasData(streamstr("POVM effect #" << error_index << ": " << error_msg));
+  }
+}
+
+
+
+/** \brief Check that the POVM effects of each measurement setting sum up to the identity
+ *
+ * Add the POVM effects one by one with \ref addEffect(), specifying for each effect the
+ * measurement setting it belongs to.  Settings are labeled by arbitrary integers.  Then
+ * call \ref check() to verify that the effects of each setting sum up to the identity
+ * operator.
+ *
+ * This check only makes sense if all the effects of each setting are given, including the
+ * effects which were never observed (and which are not stored in an \ref IndepMeasLLH).
+ */
+template<typename DMTypes_>
+class TOMOGRAPHER_EXPORT POVMCompletenessChecker
+{
+public:
+  typedef DMTypes_ DMTypes;
+  typedef typename DMTypes::RealScalar RealScalar;
+  typedef typename DMTypes::MatrixTypeConstRef MatrixTypeConstRef;
+
+  //! Type used to store the real and imaginary parts of the sums of the effects
+  typedef Eigen::Matrix<RealScalar, Eigen::Dynamic, Eigen::Dynamic> RealMatrixType;
+
+  /** \brief Constructor
+   *
+   * The effects of a setting are considered to sum up to the identity if the Frobenius
+   * norm of the difference between their sum and the identity is at most \a tol.
+   */
+  POVMCompletenessChecker(DMTypes dmt_, RealScalar tol_ = RealScalar(1e-6))
+    : dmt(dmt_), tol(tol_)
+  {
+  }
+
+  /** \brief Add a POVM effect given by its real and imaginary parts
+   *
+   * The matrices \a ERe and \a EIm may have any real scalar type.
+   */
+  template<typename DerivedRe, typename DerivedIm>
+  inline void addEffect(long setting, const Eigen::MatrixBase<DerivedRe> & ERe,
+                        const Eigen::MatrixBase<DerivedIm> & EIm)
+  {
+    tomographer_assert(ERe.rows() == (Eigen::Index)dmt.dim() && ERe.cols() == (Eigen::Index)dmt.dim());
+    tomographer_assert(EIm.rows() == (Eigen::Index)dmt.dim() && EIm.cols() == (Eigen::Index)dmt.dim());
+
+    const std::size_t k = _settingIndex(setting);
+    _sum_re[k] += ERe.template cast<RealScalar>();
+    _sum_im[k] += EIm.template cast<RealScalar>();
+  }
+
+  /** \brief Add a POVM effect
+   */
+  inline void addEffect(long setting, MatrixTypeConstRef E)
+  {
+    addEffect(setting, E.real(), E.imag());
+  }
+
+  //! The number of distinct measurement settings seen so far
+  inline std::size_t numSettings() const { return _settings.size(); }
+
+  /** \brief Check that the effects of each setting sum up to the identity
+   *
+   * Throws \ref InvalidMeasData if this is not the case for one of the settings.
+   */
+  inline void check() const
+  {
+    const RealMatrixType Ident = RealMatrixType::Identity(dmt.dim(), dmt.dim());
+    for (const auto & s : _settings) {
+      const RealScalar dev = std::sqrt( (_sum_re[s.second] - Ident).squaredNorm()
+                                        + _sum_im[s.second].squaredNorm() );
+      if ( ! (dev <= tol) ) {
+        throw InvalidMeasData(streamstr("POVM effects of measurement setting " << s.first
+                                        << " do not sum up to the identity (deviation = "
+                                        << dev << "), sum =\n" << std::setprecision(10)
+                                        << (_sum_re[s.second].template cast<typename DMTypes::ComplexScalar>()
+                                            + typename DMTypes::ComplexScalar(0,1)
+                                            * _sum_im[s.second].template cast<typename DMTypes::ComplexScalar>())));
+      }
+    }
+  }
+
+private:
+  const DMTypes dmt;
+  const RealScalar tol;
+
+  std::map<long, std::size_t> _settings;
+  std::vector<RealMatrixType> _sum_re;
+  std::vector<RealMatrixType> _sum_im;
+
+  inline std::size_t _settingIndex(long setting)
+  {
+    auto it = _settings.find(setting);
+    if (it != _settings.end()) {
+      return it->second;
+    }
+    const std::size_t k = _sum_re.size();
+    _settings[setting] = k;
+    _sum_re.push_back(RealMatrixType::Zero(dmt.dim(), dmt.dim()));
+    _sum_im.push_back(RealMatrixType::Zero(dmt.dim(), dmt.dim()));
+    return k;
+  }
+};
+
+
+
+} // namespace DenseDM
+} // namespace Tomographer
+
+
+#endif
@@ -30,12 +30,19 @@
 #define TOMOGRAPHER_DENSEDM_TSPACEFIGOFMERIT_H
 
 
+#include <cmath>
+#include <algorithm> // std::max
+#include <vector>
+
 #include <boost/serialization/serialization.hpp>
+#include <boost/serialization/vector.hpp>
 
 #include <tomographer/tools/needownoperatornew.h>
+#include <tomographer/tools/eigenutil.h>
 #include <tomographer/densedm/dmtypes.h>
 #include <tomographer/densedm/distmeasures.h>
 #include <tomographer/densedm/param_herm_x.h>
+#include <tomographer/densedm/tspacepointcache.h>
 
 
 /** \file tspacefigofmerit.h
@@ -70,6 +77,11 @@ public:
   //! For ValueCalculator interface : value type
   typedef ValueType_ ValueType;
 
+  /** \brief Point cache type for which we can reuse precomputed quantities (see \ref
+   *         PointCacheTypeOf)
+   */
+  typedef DensePointCache<DMTypes> PointCacheType;
+
 private:
   MatrixType _ref_T;
 
@@ -86,6 +98,12 @@ public:
     return fidelityT<ValueType>(T, _ref_T);
   }
 
+  //! Calculate the fidelity of the state stored in the point cache \a p to the reference state
+  inline ValueType getValue(const PointCacheType & p) const
+  {
+    return fidelityT<ValueType>(p.T(), _ref_T);
+  }
+
 
   //! Construct an invalid object -- ONLY for use with Boost.serialization
   FidelityToRefCalculator() : _ref_T() { }
@@ -123,6 +141,11 @@ public:
   //! For ValueCalculator interface : value type
   typedef ValueType_ ValueType;
 
+  /** \brief Point cache type for which we can reuse precomputed quantities (see \ref
+   *         PointCacheTypeOf)
+   */
+  typedef DensePointCache<DMTypes> PointCacheType;
+
 private:
   MatrixType _ref_T;
 
@@ -143,6 +166,12 @@ public:
     return std::sqrt(ValueType(1) - F*F);
   }
 
+  //! Calculate the purified distance of the state stored in the point cache \a p to the reference state
+  inline ValueType getValue(const PointCacheType & p) const
+  {
+    return getValue(p.T());
+  }
+
 
   //! Construct an invalid object -- ONLY for use with Boost.serialization
   PurifDistToRefCalculator() : _ref_T()  { }
@@ -172,6 +201,11 @@ public:
   //! For ValueCalculator interface : value type
   typedef ValueType_ ValueType;
 
+  /** \brief Point cache type for which we can reuse precomputed quantities (see \ref
+   *         PointCacheTypeOf)
+   */
+  typedef DensePointCache<DMTypes> PointCacheType;
+
 private:
   MatrixType _ref_rho;
 
@@ -188,6 +222,12 @@ public:
     return traceDistance<ValueType>(T*T.adjoint(), _ref_rho);
   }
 
+  //! Calculate the trace distance of the state stored in the point cache \a p to the reference state
+  inline ValueType getValue(const PointCacheType & p) const
+  {
+    return traceDistance<ValueType>(p.rho(), _ref_rho);
+  }
+
   //! Construct an invalid object -- ONLY for use with Boost.serialization
   TrDistToRefCalculator() : _ref_rho()  { }
 private:
@@ -203,8 +243,17 @@ private:
 
 /** \brief Calculate expectation value of an observable for each sample
  *
+ * The observable \f$ A \f$ is diagonalized once in the constructor, \f$ A = \sum_i
+ * \lambda_i\, u_i u_i^\dagger \f$, keeping only the nonzero eigenvalues.  The expectation
+ * value is then calculated directly from \f$ T \f$ as \f$ \operatorname{tr}(A\,TT^\dagger)
+ * = \sum_i \lambda_i \lVert u_i^\dagger T \rVert^2 \f$, without forming \f$ \rho =
+ * TT^\dagger \f$.  If the \ref pageParamsX of \f$ \rho \f$ is already known (see \ref
+ * DensePointCache), the value is the single dot product \f$ A_x \cdot x_\rho \f$.
  *
  * \since Since %Tomographer 5.3, this class can be serialized with Boost.Serialization.
+ *
+ * \since Changed in %Tomographer 5.5: the value is calculated from the eigendecomposition
+ *        of \f$ A \f$, and may be calculated from a \ref DensePointCache.
  */
 template<typename DMTypes_>
 class TOMOGRAPHER_EXPORT ObservableValueCalculator
@@ -216,10 +265,22 @@ public:
   typedef typename DMTypes::MatrixTypeConstRef MatrixTypeConstRef;
   typedef typename DMTypes::VectorParamType VectorParamType;
   typedef typename DMTypes::VectorParamTypeConstRef VectorParamTypeConstRef;
+  typedef typename DMTypes::RealScalar RealScalar;
+  typedef typename DMTypes::ComplexScalar ComplexScalar;
 
   //! For ValueCalculator interface : value type
   typedef typename DMTypes::RealScalar ValueType;
 
+  /** \brief Point cache type for which we can reuse precomputed quantities (see \ref
+   *         PointCacheTypeOf)
+   */
+  typedef DensePointCache<DMTypes> PointCacheType;
+
+  //! The type used to store the eigenvectors of \f$ A \f$ with nonzero eigenvalue, as columns
+  typedef Eigen::Matrix<ComplexScalar, DMTypes::FixedDim, Eigen::Dynamic> EigenvectorsType;
+  //! The type used to store the nonzero eigenvalues of \f$ A \f$
+  typedef Eigen::Matrix<RealScalar, Eigen::Dynamic, 1> EigenvaluesType;
+
 private:
   //! The parametrization object, allowing us to convert rho to its \ref pageParamsX
   ParamX<DMTypes> _param_x;
@@ -227,31 +288,82 @@ private:
   //! The observable we wish to watch the expectation value with (in \ref pageParamsX)
   VectorParamType _A_x;
 
+  //! The eigenvectors of A with nonzero eigenvalue
+  EigenvectorsType _A_U;
+  //! The corresponding eigenvalues
+  EigenvaluesType _A_lambda;
+
+  inline void _init_eigendecomposition()
+  {
+    if (_A_x.size() == 0) {
+      // invalid object, e.g. before being loaded with Boost.Serialization
+      return;
+    }
+    Eigen::SelfAdjointEigenSolver<MatrixType> eig(_param_x.XToHerm(_A_x));
+    const RealScalar tol = Eigen::NumTraits<RealScalar>::dummy_precision()
+      * std::max(RealScalar(1), eig.eigenvalues().cwiseAbs().maxCoeff());
+    Eigen::Index rank = 0;
+    for (Eigen::Index i = 0; i < eig.eigenvalues().size(); ++i) {
+      if (std::abs(eig.eigenvalues()(i)) > tol) {
+        ++rank;
+      }
+    }
+    _A_U.resize(eig.eigenvectors().rows(), rank);
+    _A_lambda.resize(rank);
+    Eigen::Index j = 0;
+    for (Eigen::Index i = 0; i < eig.eigenvalues().size(); ++i) {
+      if (std::abs(eig.eigenvalues()(i)) > tol) {
+        _A_U.col(j) = eig.eigenvectors().col(i);
+        _A_lambda(j) = eig.eigenvalues()(i);
+        ++j;
+      }
+    }
+  }
+
 public:
   /** \brief Constructor directly accepting \a A as a hermitian matrix
    *
    */
   ObservableValueCalculator(DMTypes dmt, MatrixTypeConstRef A)
-    : _param_x(dmt), _A_x(_param_x.HermToX(A))
+    : _param_x(dmt), _A_x(_param_x.HermToX(A)), _A_U(), _A_lambda()
   {
+    _init_eigendecomposition();
   }
   /** \brief Constructor directly accepting the X parameterization of \a A
    *
    */
   ObservableValueCalculator(DMTypes dmt, VectorParamTypeConstRef A_x)
-    : _param_x(dmt), _A_x(A_x)
+    : _param_x(dmt), _A_x(A_x), _A_U(), _A_lambda()
   {
+    _init_eigendecomposition();
   }
 
   //! Calculate the expectation value of the observable for the state represented by T
   inline ValueType getValue(MatrixTypeConstRef T) const
   {
-    return _A_x.transpose() * _param_x.HermToX(T*T.adjoint());
+    if (_A_lambda.size() == 0) {
+      return ValueType(0);
+    }
+    return (ValueType) (_A_U.adjoint() * T).rowwise().squaredNorm().dot(_A_lambda);
+  }
+
+  /** \brief Calculate the expectation value of the observable for the state stored in the
+   *         point cache \a p
+   *
+   * If the density matrix of the point has already been calculated, this is a single dot
+   * product with its \ref pageParamsX; otherwise we calculate the value from \f$ T \f$.
+   */
+  inline ValueType getValue(const PointCacheType & p) const
+  {
+    if (p.hasX() || p.hasRho()) {
+      return (ValueType) _A_x.dot(p.x());
+    }
+    return getValue(p.T());
   }
 
 
   //! Construct an invalid object -- ONLY for use with Boost.serialization
-  ObservableValueCalculator() : _param_x(), _A_x() { }
+  ObservableValueCalculator() : _param_x(), _A_x(), _A_U(), _A_lambda() { }
 private:
   friend boost::serialization::access;
   template<typename Archive>
@@ -259,6 +371,270 @@ private:
   {
     a & _param_x;
     a & _A_x;
+    if (Archive::is_loading::value) {
+      _init_eigendecomposition();
+    }
+  }
+};
+
+
+
+/** \brief Calculate several of the above figures of merit at once for each sample
+ *
+ * This is a multi-value calculator, suitable for use with \ref MultiValueCalculatorCache
+ * and \ref MultipleValueHistogramsWithBinningMHRWStatsCollector.  It computes the same
+ * values as \ref FidelityToRefCalculator, \ref PurifDistToRefCalculator, \ref
+ * TrDistToRefCalculator and \ref ObservableValueCalculator, but shares the work which is
+ * common to several figures of merit: the density matrix \f$ \rho = TT^\dagger \f$ is
+ * computed only once per sample, and the fidelity to a given reference state (which
+ * requires a singular value decomposition) is computed only once even if both the
+ * fidelity and the purified distance to that state are requested.  Reference states and
+ * observables which are given several times are only stored once.
+ *
+ * Add the figures of merit using \ref addFidelityToRef(), \ref addPurifDistToRef(), \ref
+ * addTrDistToRef() and \ref addObservable(); the values are returned by \ref getValues()
+ * in the order in which they were added.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename DMTypes_, typename ValueType_ = double>
+class TOMOGRAPHER_EXPORT MultipleFiguresOfMeritCalculator
+  : public virtual Tools::NeedOwnOperatorNew<typename DMTypes_::MatrixType>::ProviderType
+{
+public:
+  typedef DMTypes_ DMTypes;
+  typedef typename DMTypes::MatrixType MatrixType;
+  typedef typename DMTypes::MatrixTypeConstRef MatrixTypeConstRef;
+
+  //! The type of each calculated value
+  typedef ValueType_ ValueType;
+  //! The type in which all values of a sample are returned
+  typedef Eigen::Array<ValueType,Eigen::Dynamic,1> ValueArrayType;
+
+  /** \brief Point cache type for which we can reuse precomputed quantities (see \ref
+   *         PointCacheTypeOf)
+   */
+  typedef DensePointCache<DMTypes> PointCacheType;
+
+  //! The kinds of figures of merit we can calculate
+  enum FigureOfMeritKind {
+    FidelityToRef = 0,   //!< See \ref FidelityToRefCalculator
+    PurifDistToRef = 1,  //!< See \ref PurifDistToRefCalculator
+    TrDistToRef = 2,     //!< See \ref TrDistToRefCalculator
+    ObservableValue = 3  //!< See \ref ObservableValueCalculator
+  };
+
+private:
+  typedef typename Tools::EigenStdVector<MatrixType>::type MatrixListType;
+
+  //! Reference states in T parameterization (for fidelity and purified distance)
+  MatrixListType _refs_T;
+  //! Reference states (for the trace distance)
+  MatrixListType _refs_rho;
+  //! Observables (full hermitian matrices)
+  MatrixListType _observables;
+
+  //! The kind of each value
+  std::vector<int> _kinds;
+  //! For each value, index in the relevant list of matrices above
+  std::vector<std::size_t> _which;
+
+  // scratch space for the fidelities to each reference state of the current sample
+  mutable ValueArrayType _fid;
+
+  static inline std::size_t _find_or_add(MatrixListType & list, MatrixTypeConstRef M)
+  {
+    for (std::size_t j = 0; j < list.size(); ++j) {
+      if (list[j].rows() == M.rows() && list[j].cols() == M.cols() && list[j] == M) {
+        return j;
+      }
+    }
+    list.push_back(M);
+    return list.size() - 1;
+  }
+
+  inline Eigen::Index _add(int kind, std::size_t which)
+  {
+    _kinds.push_back(kind);
+    _which.push_back(which);
+    return (Eigen::Index)_kinds.size() - 1;
+  }
+
+public:
+  //! Constructor. Initially no figures of merit are calculated.
+  MultipleFiguresOfMeritCalculator()
+    : _refs_T(), _refs_rho(), _observables(), _kinds(), _which(), _fid()
+  {
+  }
+
+  //! Add the fidelity to the reference state \a T_ref (in \ref pageParamsT); returns the value index
+  inline Eigen::Index addFidelityToRef(MatrixTypeConstRef T_ref)
+  {
+    return _add(FidelityToRef, _find_or_add(_refs_T, T_ref));
+  }
+  //! Add the purified distance to the reference state \a T_ref (in \ref pageParamsT); returns the value index
+  inline Eigen::Index addPurifDistToRef(MatrixTypeConstRef T_ref)
+  {
+    return _add(PurifDistToRef, _find_or_add(_refs_T, T_ref));
+  }
+  //! Add the trace distance to the reference state \a rho_ref; returns the value index
+  inline Eigen::Index addTrDistToRef(MatrixTypeConstRef rho_ref)
+  {
+    return _add(TrDistToRef, _find_or_add(_refs_rho, rho_ref));
+  }
+  /** \brief Add the expectation value of the observable \a A; returns the value index
+   *
+   * As for \ref ObservableValueCalculator, only the lower triangular part of \a A is used.
+   */
+  inline Eigen::Index addObservable(MatrixTypeConstRef A)
+  {
+    MatrixType A_herm = A.template selfadjointView<Eigen::Lower>();
+    return _add(ObservableValue, _find_or_add(_observables, A_herm));
+  }
+
+  //! The number of values calculated for each sample
+  inline Eigen::Index numValues() const { return (Eigen::Index)_kinds.size(); }
+
+  //! The kind of figure of merit of the \a i-th value
+  inline FigureOfMeritKind kind(Eigen::Index i) const { return (FigureOfMeritKind)_kinds[(std::size_t)i]; }
+
+  /** \brief Calculate all figures of merit for the state represented by T
+   *
+   * The \a values must already have \ref numValues() entries.
+   */
+  inline void getValues(MatrixTypeConstRef T, ValueArrayType & values) const
+  {
+    getValues(PointCacheType(T), values);
+  }
+
+  /** \brief Calculate all figures of merit for the state stored in the point cache \a p
+   *
+   * The density matrix \f$ \rho \f$ is taken from the cache, and is only calculated if it
+   * is needed and if it hasn't been calculated yet.  The \a values must already have \ref
+   * numValues() entries.
+   */
+  inline void getValues(const PointCacheType & p, ValueArrayType & values) const
+  {
+    tomographer_assert(values.size() == numValues());
+
+    _fid.setConstant((Eigen::Index)_refs_T.size(), ValueType(-1));
+
+    const MatrixType & T = p.T();
+
+    for (std::size_t i = 0; i < _kinds.size(); ++i) {
+      const std::size_t j = _which[i];
+      switch (_kinds[i]) {
+      case FidelityToRef:
+      case PurifDistToRef:
+        {
+          ValueType & F = _fid((Eigen::Index)j);
+          if (F < 0) {
+            F = fidelityT<ValueType>(T, _refs_T[j]);
+          }
+          if (_kinds[i] == FidelityToRef) {
+            values((Eigen::Index)i) = F;
+          } else {
+            values((Eigen::Index)i) = (F >= ValueType(1)) ? ValueType(0) : std::sqrt(ValueType(1) - F*F);
+          }
+          break;
+        }
+      case TrDistToRef:
+        values((Eigen::Index)i) = traceDistance<ValueType>(p.rho(), _refs_rho[j]);
+        break;
+      case ObservableValue:
+        // tr(A*rho) = sum_{ij} A_{ij} conj(rho_{ij}) for hermitian rho
+        values((Eigen::Index)i) = (ValueType) _observables[j].cwiseProduct(p.rho().conjugate()).sum().real();
+        break;
+      default:
+        tomographer_assert(false && "Invalid figure of merit kind");
+      }
+    }
+  }
+
+private:
+  friend boost::serialization::access;
+  template<typename Archive>
+  void serialize(Archive & a, unsigned int /* version */)
+  {
+    a & _refs_T;
+    a & _refs_rho;
+    a & _observables;
+    a & _kinds;
+    a & _which;
+  }
+};
+
+
+/** \brief Calculate the \ref pageParamsX of the density matrix of each sample
+ *
+ * This is a multi-value calculator (see \ref MultiValueCalculatorCache) which returns the
+ * \f$ d^2 \f$ real parameters of \f$ \rho = TT^\dagger \f$ in \ref pageParamsX.  This is
+ * useful for storing the samples themselves, e.g. with \ref SampleStreamMHRWStatsCollector,
+ * as any figure of merit can later be computed from them.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename DMTypes_, typename ValueType_ = double>
+class TOMOGRAPHER_EXPORT RhoParamXCalculator
+  : public virtual Tools::NeedOwnOperatorNew<typename DMTypes_::VectorParamType>::ProviderType
+{
+public:
+  typedef DMTypes_ DMTypes;
+  typedef typename DMTypes::MatrixType MatrixType;
+  typedef typename DMTypes::MatrixTypeConstRef MatrixTypeConstRef;
+
+  //! The type of each calculated value
+  typedef ValueType_ ValueType;
+  //! The type in which all values of a sample are returned
+  typedef Eigen::Array<ValueType,Eigen::Dynamic,1> ValueArrayType;
+
+  /** \brief Point cache type for which we can reuse precomputed quantities (see \ref
+   *         PointCacheTypeOf)
+   */
+  typedef DensePointCache<DMTypes> PointCacheType;
+
+private:
+  //! The parametrization object, allowing us to convert rho to its \ref pageParamsX
+  ParamX<DMTypes> _param_x;
+  //! The number of parameters, \f$ d^2 \f$
+  Eigen::Index _dim2;
+
+public:
+  //! Constructor
+  RhoParamXCalculator(DMTypes dmt)
+    : _param_x(dmt), _dim2(dmt.dim2())
+  {
+  }
+
+  //! The number of values calculated for each sample, \f$ d^2 \f$
+  inline Eigen::Index numValues() const { return _dim2; }
+
+  /** \brief Calculate the X parameterization of the state represented by T
+   *
+   * The \a values must already have \ref numValues() entries.
+   */
+  inline void getValues(MatrixTypeConstRef T, ValueArrayType & values) const
+  {
+    tomographer_assert(values.size() == numValues());
+    values = _param_x.HermToX(T*T.adjoint()).template cast<ValueType>();
+  }
+
+  //! Get the X parameterization of the state stored in the point cache \a p
+  inline void getValues(const PointCacheType & p, ValueArrayType & values) const
+  {
+    tomographer_assert(values.size() == numValues());
+    values = p.x().template cast<ValueType>();
+  }
+
+  //! Construct an invalid object -- ONLY for use with Boost.serialization
+  RhoParamXCalculator() : _param_x(), _dim2(0) { }
+private:
+  friend boost::serialization::access;
+  template<typename Archive>
+  void serialize(Archive & a, unsigned int /* version */)
+  {
+    a & _param_x;
+    a & _dim2;
   }
 };
 
@@ -0,0 +1,304 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TOMOGRAPHER_DENSEDM_TSPACELLHADAPTIVEWALKER_H
+#define TOMOGRAPHER_DENSEDM_TSPACELLHADAPTIVEWALKER_H
+
+#include <cstddef>
+#include <cmath>
+
+#include <limits>
+#include <random>
+
+#include <Eigen/Eigen>
+
+#include <tomographer/tools/loggers.h>
+#include <tomographer/tools/needownoperatornew.h>
+#include <tomographer/densedm/densellh.h>
+#include <tomographer/densedm/dmtypes.h>
+#include <tomographer/densedm/param_herm_x.h>
+#include <tomographer/densedm/tspacepointcache.h>
+#include <tomographer/densedm/tspacellhwalker.h>
+#include <tomographer/mhrw.h>
+#include <tomographer/mhrwadaptivecovariancecontroller.h>
+
+/** \file tspacellhadaptivewalker.h
+ *
+ * \brief A random walk with correlated jumps on a quantum state space with dense matrix
+ *        type
+ *
+ * See \ref Tomographer::DenseDM::TSpace::LLHAdaptiveMHWalker.
+ */
+
+namespace Tomographer {
+namespace DenseDM {
+namespace TSpace {
+
+
+/** \brief A random walk in the density matrix space of a Hilbert state space of a
+ *         quantum system, with correlated Gaussian jumps in \ref pageParamsX
+ *
+ * This walker explores the same distribution as \ref LLHMHWalker, i.e. the likelihood
+ * function on the Hilbert-Schmidt uniform prior.  The Hilbert-Schmidt measure is the
+ * flat (Lebesgue) measure on the set of density matrices, seen as a convex body in \ref
+ * pageParamsX.  The jumps are hence carried out directly in \ref pageParamsX: the jump
+ * \f$ \epsilon\, L\, z \f$ (see \ref MHWalkerParamsCovariance) is added to the \ref
+ * pageParamsX of the current point, keeping the trace equal to one.  Since the jump
+ * distribution is a fixed Gaussian, the proposal is symmetric.  If the new point is not
+ * a positive definite matrix, it lies outside of the state space and the jump is
+ * rejected.
+ *
+ * The points of the random walk are still given as \ref pageParamsT, such that all the
+ * figure of merit calculators of \ref tspacefigofmerit.h can be used as with \ref
+ * LLHMHWalker.  Here \f$ T \f$ is the Cholesky factor of \f$ \rho \f$.
+ *
+ * The shape \f$ L \f$ of the jumps should follow the shape of the distribution; use \ref
+ * MHRWAdaptiveCovarianceController to learn it during thermalization.  (With isotropic
+ * jumps, this walker is not more efficient than \ref LLHMHWalker.)
+ *
+ * \since Added in %Tomographer 5.5
+ *
+ * \tparam DenseLLHType A type satisfying the \ref pageInterfaceDenseLLH
+ *
+ * \tparam RngType A \c std::random random number \a generator (such as \ref std::mt19937)
+ *
+ * \tparam LoggerType A logger type (see \ref pageLoggers)
+ */
+template<typename DenseLLHType_, typename RngType_, typename LoggerType_>
+class TOMOGRAPHER_EXPORT LLHAdaptiveMHWalker
+  : public Tools::NeedOwnOperatorNew<typename DenseLLHType_::DMTypes::MatrixType,
+                                     typename DenseLLHType_::DMTypes::VectorParamType>::ProviderType
+{
+public:
+  //! The DenseLLH interface object type
+  typedef DenseLLHType_ DenseLLHType;
+  //! The random number generator type
+  typedef RngType_ RngType;
+  //! The logger type
+  typedef LoggerType_ LoggerType;
+
+  //! The data types of our problem
+  typedef typename DenseLLHType::DMTypes DMTypes;
+  //! The loglikelihood function value type (see \ref pageInterfaceDenseLLH e.g. \ref IndepMeasLLH)
+  typedef typename DenseLLHType::LLHValueType LLHValueType;
+  //! The matrix type for a density operator on our quantum system
+  typedef typename DMTypes::MatrixType MatrixType;
+  //! Type of an X-parameterization of a density operator (see \ref pageParamsX)
+  typedef typename DMTypes::VectorParamType VectorParamType;
+  //! The real scalar corresponding to our data types. Usually a \c double.
+  typedef typename DMTypes::RealScalar RealScalar;
+
+  //! The step size and the shape of the jumps in \ref pageParamsX
+  typedef MHWalkerParamsCovariance<RealScalar> WalkerParams;
+
+  //! Provided for MHRandomWalk. A point in our random walk = a density matrix
+  typedef MatrixType PointType;
+  //! Provided for MHRandomWalk. The function value type is the loglikelihood value type
+  typedef LLHValueType FnValueType;
+  //! Provided for MHRandomWalk (see \ref pageInterfaceMHWalker)
+  typedef DensePointCache<DMTypes> PointCacheType;
+  //! see \ref pageInterfaceMHWalker
+  enum {
+    /** \brief We will calculate the log-likelihood function, which is the logarithm of
+     *         the Metropolis-Hastings function we should be calculating
+     */
+    UseFnSyntaxType = MHUseFnLogValue
+  };
+
+private:
+
+  const DenseLLHType & _llh;
+  const tomo_internal::DenseLLHInvoker<DenseLLHType> _llhinvoker;
+  const ParamX<DMTypes> _px;
+  RngType & _rng;
+  std::normal_distribution<RealScalar> _normal_distr_rnd;
+
+  Logger::LocalLogger<LoggerType> _llogger;
+
+  MatrixType _startpt;
+
+  RealScalar _last_log_proposal_ratio;
+
+  long _num_jumps;
+  long _num_jumps_outside;
+
+public:
+
+  /** \brief Constructor which just initializes the given fields
+   *
+   * The arguments are the same as for \ref LLHMHWalker.  If you provide a zero \a
+   * startpt here, then a random starting point will be chosen using the \a rng random
+   * number generator to generate a random point on the sphere.
+   */
+  LLHAdaptiveMHWalker(const MatrixType & startpt, const DenseLLHType & llh, RngType & rng,
+                      LoggerType & baselogger)
+    : _llh(llh),
+      _llhinvoker(llh),
+      _px(llh.dmt),
+      _rng(rng),
+      _normal_distr_rnd(0.0, 1.0),
+      _llogger("Tomographer::DenseDM::TSpace::LLHAdaptiveMHWalker", baselogger),
+      _startpt(startpt),
+      _last_log_proposal_ratio(0),
+      _num_jumps(0),
+      _num_jumps_outside(0)
+  {
+  }
+
+
+  //! Provided for \ref MHRandomWalk. Initializes some fields and prepares for a random walk.
+  inline void init()
+  {
+    auto logger = _llogger.subLogger(TOMO_ORIGIN) ;
+    logger.debug("Starting random walk");
+  }
+
+  //! Return the starting point given in the constructor, or a random start point
+  inline const MatrixType & startPoint()
+  {
+    auto logger = _llogger.subLogger(TOMO_ORIGIN) ;
+
+    // It's fine to hard-code "1e-3" because for any type, valid T-matrices have norm == 1
+    if (_startpt.norm() > 1e-3) {
+      // nonzero matrix given: that's the starting point.
+      return _startpt;
+    }
+
+    // zero matrix given: means to choose random starting point
+    MatrixType T(_llh.dmt.initMatrixType());
+    T = Tools::denseRandom<MatrixType>(
+	_rng, _normal_distr_rnd, (Eigen::Index)_llh.dmt.dim(), (Eigen::Index)_llh.dmt.dim()
+	);
+    _startpt = T/T.norm(); // normalize to be on surface of the sphere
+
+    logger.debug([&](std::ostream & str) {
+	str << "Chosen random start point T = \n" << _startpt;
+      });
+
+    // return start point
+    return _startpt;
+  }
+
+  //! Callback for after thermalizing is done. No-op.
+  inline void thermalizingDone()
+  {
+  }
+
+  //! Callback for after random walk is finished.  Reports jumps outside of the state space.
+  inline void done()
+  {
+    auto logger = _llogger.subLogger(TOMO_ORIGIN) ;
+    logger.debug([&](std::ostream & stream) {
+        stream << _num_jumps_outside << " out of " << _num_jumps
+               << " jumps fell outside of the state space";
+      });
+  }
+
+  /** \brief Calculate the logarithm of the Metropolis-Hastings function value.
+   *
+   * \return the log-likelihood, which is computed via the \a DenseLLH object.
+   */
+  inline LLHValueType fnLogVal(const MatrixType & T) const
+  {
+    return _llhinvoker.fnLogVal(T);
+  }
+
+  //! Calculate the logarithm of the Metropolis-Hastings function value, filling the given point cache.
+  inline LLHValueType fnLogVal(const MatrixType & T, PointCacheType & cache) const
+  {
+    return _llhinvoker.fnLogVal(T, cache);
+  }
+
+  /** \brief The \ref pageParamsX of the point \a T, in which the jumps are carried out
+   *
+   * Provided for \ref MHRWAdaptiveCovarianceController.
+   */
+  inline VectorParamType proposalCoordinates(const MatrixType & T) const
+  {
+    return _px.HermToX(T * T.adjoint());
+  }
+
+  /** \brief Jump to a new point in \ref pageParamsX
+   *
+   * If the new point lies outside of the state space, then \a cur_T is returned and the
+   * proposal will be rejected.
+   */
+  inline MatrixType jumpFn(const MatrixType & cur_T, const WalkerParams & params)
+  {
+    const Eigen::Index dim = (Eigen::Index)_llh.dmt.dim();
+
+    ++_num_jumps;
+
+    VectorParamType z(Tools::denseRandom<VectorParamType>(
+                          _rng, _normal_distr_rnd, dim*dim, 1
+                          ));
+    VectorParamType dx(_llh.dmt.initVectorParamType());
+    if (params.cov_factor.size() == 0) {
+      dx = params.step_size * z;
+    } else {
+      tomographer_assert(params.cov_factor.rows() == dim*dim && params.cov_factor.cols() == dim*dim);
+      dx.noalias() = params.cov_factor.template triangularView<Eigen::Lower>() * z;
+      dx *= params.step_size;
+    }
+    // stay on the hyperplane of unit-trace matrices
+    dx.head(dim).array() -= dx.head(dim).sum() / RealScalar(dim);
+
+    const MatrixType newrho(_px.template XToHerm<true>(proposalCoordinates(cur_T) + dx));
+
+    Eigen::LLT<MatrixType> llt(newrho);
+    if (llt.info() != Eigen::Success) {
+      ++_num_jumps_outside;
+      _last_log_proposal_ratio = -std::numeric_limits<RealScalar>::infinity();
+      return cur_T;
+    }
+
+    _last_log_proposal_ratio = 0;
+    return llt.matrixL();
+  }
+
+  /** \brief Zero if the last jump proposed by jumpFn() stayed inside the state space,
+   *         minus infinity otherwise
+   *
+   * See \ref pageInterfaceMHWalker.  This ensures that a jump outside of the state space
+   * is counted as rejected.
+   */
+  inline RealScalar jumpLogProposalRatio() const
+  {
+    return _last_log_proposal_ratio;
+  }
+
+};
+
+
+
+} // namespace TSpace
+} // namespace DenseDM
+} // namespace Tomographer
+
+
+#endif
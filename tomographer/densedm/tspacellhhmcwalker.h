@@ -0,0 +1,362 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TOMOGRAPHER_DENSEDM_TSPACELLHHMCWALKER_H
+#define TOMOGRAPHER_DENSEDM_TSPACELLHHMCWALKER_H
+
+#include <cstddef>
+#include <cmath>
+
+#include <limits>
+#include <random>
+#include <utility> // std::swap
+
+#include <tomographer/tools/loggers.h>
+#include <tomographer/tools/needownoperatornew.h>
+#include <tomographer/densedm/densellh.h>
+#include <tomographer/densedm/dmtypes.h>
+#include <tomographer/densedm/tspacepointcache.h>
+#include <tomographer/densedm/tspacellhwalker.h>
+#include <tomographer/mhrw.h>
+
+/** \file tspacellhhmcwalker.h
+ *
+ * \brief A Hamiltonian Monte Carlo random walk on a quantum state space with dense matrix
+ *        type
+ *
+ * See \ref Tomographer::DenseDM::TSpace::LLHHMCWalker.
+ */
+
+namespace Tomographer {
+namespace DenseDM {
+namespace TSpace {
+
+
+/** \brief A Hamiltonian Monte Carlo random walk in the density matrix space of a Hilbert
+ *         state space of a quantum system
+ *
+ * This walker explores the same distribution as \ref LLHMHWalker, i.e. the likelihood
+ * function on the Hilbert-Schmidt uniform prior, which is the uniform distribution of the
+ * purification \f$ T \f$ on the unit sphere of \ref pageParamsT, weighted by the
+ * likelihood function.
+ *
+ * Instead of a random jump, a new point is proposed by following a Hamiltonian trajectory
+ * on the sphere: a random momentum is drawn in the tangent space of the sphere at the
+ * current point, and the trajectory is integrated with \a num_leapfrog_steps leapfrog
+ * steps of size \a step_size, where the momentum is updated with the gradient of the
+ * log-likelihood and the position follows the great circle given by the momentum
+ * ("geodesic" Hamiltonian Monte Carlo, [Byrne & Girolami, Scand. J. Stat. 40, 825
+ * (2013)]).  The proposals are guided by the likelihood function, such that long
+ * trajectories are still accepted with a high probability; this decorrelates successive
+ * samples much faster than random jumps in high dimensions.
+ *
+ * The proposal is not symmetric: the random walk must also account for the change of the
+ * kinetic energy along the trajectory, which this walker reports with \ref
+ * jumpLogProposalRatio() (see \ref pageInterfaceMHWalker).
+ *
+ * The walker parameters are \ref MHWalkerParamsHMC; use \ref MHRWHMCStepSizeController to
+ * adjust them dynamically.  The gradient of the log-likelihood function is calculated by
+ * the \a DenseLLHType object (see \ref pageInterfaceDenseLLH); the gradient at the
+ * endpoint of a trajectory is reused to start the next one.
+ *
+ * \since Added in %Tomographer 5.5
+ *
+ * \tparam DenseLLHType A type satisfying the \ref pageInterfaceDenseLLH, which provides
+ *         the gradient of the log-likelihood function
+ *
+ * \tparam RngType A \c std::random random number \a generator (such as \ref std::mt19937)
+ *
+ * \tparam LoggerType A logger type (see \ref pageLoggers)
+ */
+template<typename DenseLLHType_, typename RngType_, typename LoggerType_>
+class TOMOGRAPHER_EXPORT LLHHMCWalker
+  : public Tools::NeedOwnOperatorNew<typename DenseLLHType_::DMTypes::MatrixType>::ProviderType
+{
+public:
+  //! The DenseLLH interface object type
+  typedef DenseLLHType_ DenseLLHType;
+  //! The random number generator type
+  typedef RngType_ RngType;
+  //! The logger type
+  typedef LoggerType_ LoggerType;
+
+  //! The data types of our problem
+  typedef typename DenseLLHType::DMTypes DMTypes;
+  //! The loglikelihood function value type (see \ref pageInterfaceDenseLLH e.g. \ref IndepMeasLLH)
+  typedef typename DenseLLHType::LLHValueType LLHValueType;
+  //! The matrix type for a density operator on our quantum system
+  typedef typename DMTypes::MatrixType MatrixType;
+  //! The real scalar corresponding to our data types. Usually a \c double.
+  typedef typename DMTypes::RealScalar RealScalar;
+
+  //! The leapfrog step size and the number of leapfrog steps of each trajectory
+  typedef MHWalkerParamsHMC<RealScalar> WalkerParams;
+
+  //! Provided for MHRandomWalk. A point in our random walk = a density matrix
+  typedef MatrixType PointType;
+  //! Provided for MHRandomWalk. The function value type is the loglikelihood value type
+  typedef LLHValueType FnValueType;
+  //! Provided for MHRandomWalk (see \ref pageInterfaceMHWalker)
+  typedef DensePointCache<DMTypes> PointCacheType;
+  //! see \ref pageInterfaceMHWalker
+  enum {
+    /** \brief We will calculate the log-likelihood function, which is the logarithm of
+     *         the Metropolis-Hastings function we should be calculating
+     */
+    UseFnSyntaxType = MHUseFnLogValue
+  };
+
+private:
+
+  const DenseLLHType & _llh;
+  const tomo_internal::DenseLLHInvoker<DenseLLHType> _llhinvoker;
+  RngType & _rng;
+  std::normal_distribution<RealScalar> _normal_distr_rnd;
+
+  Logger::LocalLogger<LoggerType> _llogger;
+
+  MatrixType _startpt;
+
+  // gradient at the starting point of the last trajectory, and at its endpoint
+  MatrixType _grad_start_T;
+  MatrixType _grad_start;
+  bool _has_grad_start;
+  MatrixType _grad_end_T;
+  MatrixType _grad_end;
+  bool _has_grad_end;
+
+  RealScalar _last_log_proposal_ratio;
+
+  long _num_trajectories;
+  long _num_divergent_trajectories;
+
+public:
+
+  /** \brief Constructor which just initializes the given fields
+   *
+   * The arguments are the same as for \ref LLHMHWalker.  If you provide a zero \a
+   * startpt here, then a random starting point will be chosen using the \a rng random
+   * number generator to generate a random point on the sphere.
+   */
+  LLHHMCWalker(const MatrixType & startpt, const DenseLLHType & llh, RngType & rng, LoggerType & baselogger)
+    : _llh(llh),
+      _llhinvoker(llh),
+      _rng(rng),
+      _normal_distr_rnd(0.0, 1.0),
+      _llogger("Tomographer::DenseDM::TSpace::LLHHMCWalker", baselogger),
+      _startpt(startpt),
+      _grad_start_T(llh.dmt.initMatrixType()),
+      _grad_start(llh.dmt.initMatrixType()),
+      _has_grad_start(false),
+      _grad_end_T(llh.dmt.initMatrixType()),
+      _grad_end(llh.dmt.initMatrixType()),
+      _has_grad_end(false),
+      _last_log_proposal_ratio(0),
+      _num_trajectories(0),
+      _num_divergent_trajectories(0)
+  {
+  }
+
+
+  //! Provided for \ref MHRandomWalk. Initializes some fields and prepares for a random walk.
+  inline void init()
+  {
+    auto logger = _llogger.subLogger(TOMO_ORIGIN) ;
+    logger.debug("Starting random walk");
+  }
+
+  //! Return the starting point given in the constructor, or a random start point
+  inline const MatrixType & startPoint()
+  {
+    auto logger = _llogger.subLogger(TOMO_ORIGIN) ;
+
+    // It's fine to hard-code "1e-3" because for any type, valid T-matrices have norm == 1
+    if (_startpt.norm() > 1e-3) {
+      // nonzero matrix given: that's the starting point.
+      return _startpt;
+    }
+
+    // zero matrix given: means to choose random starting point
+    MatrixType T(_llh.dmt.initMatrixType());
+    T = Tools::denseRandom<MatrixType>(
+	_rng, _normal_distr_rnd, (Eigen::Index)_llh.dmt.dim(), (Eigen::Index)_llh.dmt.dim()
+	);
+    _startpt = T/T.norm(); // normalize to be on surface of the sphere
+
+    logger.debug([&](std::ostream & str) {
+	str << "Chosen random start point T = \n" << _startpt;
+      });
+
+    // return start point
+    return _startpt;
+  }
+
+  //! Callback for after thermalizing is done. No-op.
+  inline void thermalizingDone()
+  {
+  }
+
+  //! Callback for after random walk is finished.  Reports diverging trajectories, if any.
+  inline void done()
+  {
+    auto logger = _llogger.subLogger(TOMO_ORIGIN) ;
+    logger.debug([&](std::ostream & stream) {
+        stream << _num_divergent_trajectories << " out of " << _num_trajectories
+               << " trajectories diverged";
+      });
+  }
+
+  /** \brief Calculate the logarithm of the Metropolis-Hastings function value.
+   *
+   * \return the log-likelihood, which is computed via the \a DenseLLH object.
+   */
+  inline LLHValueType fnLogVal(const MatrixType & T) const
+  {
+    return _llhinvoker.fnLogVal(T);
+  }
+
+  //! Calculate the logarithm of the Metropolis-Hastings function value, filling the given point cache.
+  inline LLHValueType fnLogVal(const MatrixType & T, PointCacheType & cache) const
+  {
+    return _llhinvoker.fnLogVal(T, cache);
+  }
+
+  /** \brief Follow a Hamiltonian trajectory from \a cur_T, and return its endpoint
+   *
+   * If the trajectory runs into a point where the gradient is not finite (e.g., where
+   * some outcome has zero probability), then \a cur_T is returned and the proposal will
+   * be rejected.
+   */
+  inline MatrixType jumpFn(const MatrixType & cur_T, WalkerParams params)
+  {
+    const RealScalar eps = params.step_size;
+
+    _update_start_gradient(cur_T);
+    ++_num_trajectories;
+
+    MatrixType T(cur_T);
+    MatrixType grad(_grad_start);
+
+    // random momentum in the tangent space of the sphere at T
+    MatrixType v(Tools::denseRandom<MatrixType>(
+                     _rng, _normal_distr_rnd,
+                     (Eigen::Index)_llh.dmt.dim(), (Eigen::Index)_llh.dmt.dim()
+                     ));
+    _project_tangent(v, T);
+    const RealScalar kinetic_start = v.squaredNorm() / 2;
+
+    for (int j = 0; j < (int)params.num_leapfrog_steps; ++j) {
+      v += (eps / 2) * grad;
+      _project_tangent(v, T);
+
+      _geodesic_flow(T, v, eps);
+
+      grad = _llhinvoker.gradLogVal(T);
+      if ( ! grad.allFinite() ) {
+        ++_num_divergent_trajectories;
+        _has_grad_end = false;
+        _last_log_proposal_ratio = -std::numeric_limits<RealScalar>::infinity();
+        return cur_T;
+      }
+
+      v += (eps / 2) * grad;
+      _project_tangent(v, T);
+    }
+
+    _last_log_proposal_ratio = kinetic_start - v.squaredNorm() / 2;
+
+    _grad_end_T = T;
+    _grad_end = grad;
+    _has_grad_end = true;
+
+    return T;
+  }
+
+  /** \brief The change of kinetic energy along the last trajectory computed by jumpFn()
+   *
+   * This is the term which completes the Metropolis-Hastings acceptance probability of
+   * the Hamiltonian proposal (see \ref pageInterfaceMHWalker).
+   */
+  inline RealScalar jumpLogProposalRatio() const
+  {
+    return _last_log_proposal_ratio;
+  }
+
+private:
+
+  // Make sure _grad_start is the gradient at cur_T.  If the previous trajectory was
+  // accepted, we already know the gradient at its endpoint.
+  inline void _update_start_gradient(const MatrixType & cur_T)
+  {
+    if (_has_grad_end && cur_T == _grad_end_T) {
+      _grad_start_T.swap(_grad_end_T);
+      _grad_start.swap(_grad_end);
+      std::swap(_has_grad_start, _has_grad_end);
+      return;
+    }
+    if (_has_grad_start && cur_T == _grad_start_T) {
+      return;
+    }
+    _grad_start_T = cur_T;
+    _grad_start = _llhinvoker.gradLogVal(cur_T);
+    _has_grad_start = true;
+  }
+
+  // remove from v its component along T (seen as real vectors), where T has unit norm
+  inline static void _project_tangent(MatrixType & v, const MatrixType & T)
+  {
+    const RealScalar vT = (T.array().conjugate() * v.array()).sum().real();
+    v -= vT * T;
+  }
+
+  // move T along the great circle in direction v during time eps, and rotate v along
+  inline static void _geodesic_flow(MatrixType & T, MatrixType & v, RealScalar eps)
+  {
+    using std::cos;
+    using std::sin;
+    const RealScalar vnorm = v.norm();
+    if (vnorm <= 0) {
+      return;
+    }
+    const RealScalar c = cos(vnorm * eps);
+    const RealScalar s = sin(vnorm * eps);
+    MatrixType newT(c * T + (s / vnorm) * v);
+    v = c * v - (vnorm * s) * T;
+    T = newT / newT.norm(); // avoid accumulating rounding errors
+  }
+
+};
+
+
+
+} // namespace TSpace
+} // namespace DenseDM
+} // namespace Tomographer
+
+
+#endif
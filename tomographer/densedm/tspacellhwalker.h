@@ -40,6 +40,7 @@
 #include <tomographer/densedm/densellh.h>
 #include <tomographer/densedm/dmtypes.h>
 #include <tomographer/densedm/param_herm_x.h>
+#include <tomographer/densedm/tspacepointcache.h>
 #include <tomographer/mhrw.h>
 
 /** \file tspacellhwalker.h
@@ -59,6 +60,14 @@ namespace TSpace {
 
 namespace tomo_internal {
 
+// Plain complex product, without the checks for infinite and NaN components of
+// std::complex's operator*, which keeps the compiler from vectorizing the arithmetic
+template<typename ComplexScalar>
+inline ComplexScalar cplx_mul(const ComplexScalar & x, const ComplexScalar & y)
+{
+  return ComplexScalar(x.real()*y.real() - x.imag()*y.imag(), x.real()*y.imag() + x.imag()*y.real());
+}
+
 template<typename DenseLLHType, typename = void>
 struct DenseLLHInvoker
 {
@@ -96,6 +105,57 @@ struct DenseLLHInvoker
     return llhval;
   }
 
+  // This implementation deals for \a DenseLLH objects which expose a \a logLikelihoodT()
+  // function (see \ref pageInterfaceDenseLLH)
+  TOMOGRAPHER_ENABLED_IF(DenseLLHType::LLHCalcType == LLHCalcTypeT)
+  inline LLHValueType fnLogVal(const MatrixType & T) const
+  {
+    LLHValueType llhval =  llh.logLikelihoodT(T);
+    return llhval;
+  }
+
+  // Same as above, but storing T in the given point cache and using the quantities stored
+  // there, so that they are calculated only once for this point
+  TOMOGRAPHER_ENABLED_IF(DenseLLHType::LLHCalcType == LLHCalcTypeX)
+  inline LLHValueType fnLogVal(const MatrixType & T, DensePointCache<DMTypes> & cache) const
+  {
+    cache.setT(T);
+    return llh.logLikelihoodX(cache.x());
+  }
+  TOMOGRAPHER_ENABLED_IF(DenseLLHType::LLHCalcType == LLHCalcTypeRho)
+  inline LLHValueType fnLogVal(const MatrixType & T, DensePointCache<DMTypes> & cache) const
+  {
+    cache.setT(T);
+    return llh.logLikelihoodRho(cache.rho());
+  }
+  TOMOGRAPHER_ENABLED_IF(DenseLLHType::LLHCalcType == LLHCalcTypeT)
+  inline LLHValueType fnLogVal(const MatrixType & T, DensePointCache<DMTypes> & cache) const
+  {
+    cache.setT(T);
+    return llh.logLikelihoodT(cache.T());
+  }
+
+  // Gradient of the log-likelihood with respect to the real and imaginary parts of the
+  // entries of T, for the Hamiltonian random walk (see \ref pageInterfaceDenseLLH).  With
+  // \rho = TT^\dagger and a gradient G_\rho with respect to \rho, this is 2 G_\rho T.
+  TOMOGRAPHER_ENABLED_IF(DenseLLHType::LLHCalcType == LLHCalcTypeX)
+  inline MatrixType gradLogVal(const MatrixType & T) const
+  {
+    MatrixType rho(T*T.adjoint());
+    VectorParamType gradx = llh.gradLogLikelihoodX(param_x.value.HermToX(rho));
+    return MatrixType(typename DMTypes::RealScalar(2) * param_x.value.XToHerm(gradx) * T);
+  }
+  TOMOGRAPHER_ENABLED_IF(DenseLLHType::LLHCalcType == LLHCalcTypeRho)
+  inline MatrixType gradLogVal(const MatrixType & T) const
+  {
+    return MatrixType(typename DMTypes::RealScalar(2) * llh.gradLogLikelihoodRho(T*T.adjoint()) * T);
+  }
+  TOMOGRAPHER_ENABLED_IF(DenseLLHType::LLHCalcType == LLHCalcTypeT)
+  inline MatrixType gradLogVal(const MatrixType & T) const
+  {
+    return llh.gradLogLikelihoodT(T);
+  }
+
 };
 
 } // namespace tomo_internal
@@ -150,6 +210,12 @@ public:
   typedef MatrixType PointType;
   //! Provided for MHRandomWalk. The function value type is the loglikelihood value type
   typedef LLHValueType FnValueType;
+  /** \brief Provided for MHRandomWalk. Quantities derived from a point, such as \f$ \rho =
+   *         TT^\dagger \f$, are calculated only once (see \ref pageInterfaceMHWalker)
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  typedef DensePointCache<DMTypes> PointCacheType;
   //! see \ref pageInterfaceMHWalker
   enum {
     /** \brief We will calculate the log-likelihood function, which is the logarithm of
@@ -250,6 +316,19 @@ public:
     return _llhinvoker.fnLogVal(T);
   }
 
+  /** \brief Calculate the logarithm of the Metropolis-Hastings function value, filling the
+   *         given point cache.
+   *
+   * \a T is stored in \a cache, and any quantities derived from \a T which are needed
+   * to calculate the log-likelihood are stored there as well.
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  inline LLHValueType fnLogVal(const MatrixType & T, PointCacheType & cache) const
+  {
+    return _llhinvoker.fnLogVal(T, cache);
+  }
+
   //! Decides of a new point to jump to for the random walk
   inline MatrixType jumpFn(const MatrixType& cur_T, WalkerParams params)
   {
@@ -329,8 +408,17 @@ using LLHMHWalkerLightParams = MHWalkerParamsStepSize<StepRealType>;
  * stationary distribution of the Markov chain is the same, so the same distribution is
  * explored, but because less calculations are involved this method can be much faster.
  *
+ * Each jump is composed of \a dim elementary rotations.  All the random numbers needed
+ * for a jump are drawn at once, and each elementary rotation is then applied as a
+ * branch-free \f$ SU(2) \f$ rotation on the relevant pair of entries of \f$ T \f$ (see
+ * \ref jumpFn()).
+ *
  * \since Added in %Tomographer 5.0
  *
+ * \since Changed in %Tomographer 5.5: the random numbers of a jump are drawn in bulk,
+ *        and the elementary rotations are applied without branching.  The proposal
+ *        distribution is unchanged, but the jumps obtained with a given seed differ.
+ *
  * \tparam DenseLLHType A type satisfying the \ref pageInterfaceDenseLLH
  *
  * \tparam RngType A \c std::random random number \a generator (such as \ref std::mt19937)
@@ -375,6 +463,12 @@ public:
   typedef MatrixType PointType;
   //! Provided for MHRandomWalk. The function value type is the loglikelihood value type
   typedef LLHValueType FnValueType;
+  /** \brief Provided for MHRandomWalk. Quantities derived from a point, such as \f$ \rho =
+   *         TT^\dagger \f$, are calculated only once (see \ref pageInterfaceMHWalker)
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  typedef DensePointCache<DMTypes> PointCacheType;
   //! see \ref pageInterfaceMHWalker
   enum {
     /** \brief We will calculate the log-likelihood function, which is the logarithm of
@@ -389,13 +483,23 @@ private:
   const tomo_internal::DenseLLHInvoker<DenseLLHType> _llhinvoker;
   RngType & _rng;
   std::normal_distribution<RealScalar> _normal_distr_rnd;
-  std::uniform_int_distribution<std::int_fast8_t> _jumptype_distr_rnd;
-  std::uniform_int_distribution<Eigen::Index> _jumpdir_distr_rnd;
+  // a single random integer encodes the rotation type and both (distinct) indices
+  std::uniform_int_distribution<Eigen::Index> _jump_distr_rnd;
 
   Logger::LocalLogger<LoggerType> _llogger;
   
   MatrixType _startpt;
 
+  typedef Eigen::Array<RealScalar, Eigen::Dynamic, 1> RealArrayType;
+  typedef Eigen::Array<ComplexScalar, Eigen::Dynamic, 1> ComplexArrayType;
+
+  // work buffers for jumpFn(), with one entry per elementary rotation
+  Eigen::Array<Eigen::Index, Eigen::Dynamic, 2> _jump_k;
+  Eigen::Array<RealScalar, Eigen::Dynamic, 3> _jump_n;
+  RealArrayType _jump_sina;
+  ComplexArrayType _jump_alpha;
+  ComplexArrayType _jump_beta;
+
 public:
 
   /** \brief Constructor which just initializes the given fields
@@ -413,10 +517,15 @@ public:
       _llhinvoker(llh),
       _rng(rng),
       _normal_distr_rnd(0.0, 1.0),
-      _jumptype_distr_rnd(0, 2), // choice in {0, 1, 2}
-      _jumpdir_distr_rnd(0, (Eigen::Index)llh.dmt.dim2()-1), // choice in {0,1,...,dim^2-1}
+      // choice in {0,1,...,3*dim^2*(dim^2-1)-1}
+      _jump_distr_rnd(0, 3*(Eigen::Index)llh.dmt.dim2()*((Eigen::Index)llh.dmt.dim2()-1) - 1),
       _llogger("Tomographer::DenseDM::TSpace::LLHMHWalkerLight", baselogger),
-      _startpt(startpt)
+      _startpt(startpt),
+      _jump_k((Eigen::Index)llh.dmt.dim(), 2),
+      _jump_n((Eigen::Index)llh.dmt.dim(), 3),
+      _jump_sina((Eigen::Index)llh.dmt.dim()),
+      _jump_alpha((Eigen::Index)llh.dmt.dim()),
+      _jump_beta((Eigen::Index)llh.dmt.dim())
   {
   }
 
@@ -482,7 +591,33 @@ public:
     return _llhinvoker.fnLogVal(T);
   }
 
-  //! Decides of a new point to jump to for the random walk
+  /** \brief Calculate the logarithm of the Metropolis-Hastings function value, filling the
+   *         given point cache.
+   *
+   * \a T is stored in \a cache, and any quantities derived from \a T which are needed
+   * to calculate the log-likelihood are stored there as well.
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  inline LLHValueType fnLogVal(const MatrixType & T, PointCacheType & cache) const
+  {
+    return _llhinvoker.fnLogVal(T, cache);
+  }
+
+  /** \brief Decides of a new point to jump to for the random walk
+   *
+   * The new point is obtained by applying \a dim elementary rotations to \a cur_T, seen
+   * as a vector.  Each elementary rotation acts on two random distinct entries \f$ (a,b)
+   * \f$ of \f$ T \f$ as the \f$ SU(2) \f$ matrix \f$ e^{i\phi\,\vec{n}\cdot\vec{\sigma}} =
+   * \begin{pmatrix} \alpha & \beta \\ -\bar\beta & \bar\alpha \end{pmatrix} \f$, where \f$
+   * \vec{n} \f$ is chosen at random among the \f$ x \f$, \f$ y \f$ and \f$ z \f$
+   * directions, and where \f$ \sin\phi \f$ is normally distributed with standard
+   * deviation given by the step size (and truncated to \f$ [-1,1] \f$).
+   *
+   * The random indices and angles are drawn for all elementary rotations first, and the
+   * coefficients \f$ \alpha,\beta \f$ are then calculated in bulk.  Finally, the
+   * rotations are applied in sequence without any branching.
+   */
   inline MatrixType jumpFn(const MatrixType& cur_T, WalkerParams params)
   {
     MatrixType new_T(cur_T);
@@ -490,58 +625,56 @@ public:
     auto logger = _llogger.subLogger(TOMO_ORIGIN) ;
 
     // repeat several times, to have some chance of the effect not just rotating the purification ...
-    for (int j = 0; j < (int)_llh.dmt.dim(); ++j) {
-
-      // select two random indices, and randomly select whether we apply an elementary x, y or z rotation
-      Eigen::Index k1 = _jumpdir_distr_rnd(_rng);
-      Eigen::Index k2;
-      do { k2 = _jumpdir_distr_rnd(_rng); } while (k1 == k2); // choose also randomly, but different than k1.
-      if (k1 > k2) { std::swap(k1, k2); } // ensure that k1 < k2
-      std::int_fast8_t xyz = _jumptype_distr_rnd(_rng);
-
-      RealScalar sina = params.step_size * _normal_distr_rnd(_rng);
-      if (sina < -1) { sina = -1; }
-      if (sina >  1) { sina =  1; }
-      RealScalar cosa = std::sqrt(1 - sina*sina);
-      // apply transformation
-      Eigen::Matrix<ComplexScalar,2,2> tr2d;
-      // remember: e^{i\phi(\vec{n}\cdot\vec{\sigma})} = \cos\phi \Ident + i\sin\phi (\vec{n}\cdot\vec{\sigma})
-      switch (xyz) {
-      case 0: // X-type rotation
-        tr2d(0,0) = cosa;                   tr2d(0,1) = ComplexScalar(0,sina);
-        tr2d(1,0) = ComplexScalar(0,sina);  tr2d(1,1) = cosa;
-        break;
-      case 1: // Y-type rotation
-        tr2d(0,0) = cosa;   tr2d(0,1) = sina;
-        tr2d(1,0) = -sina;  tr2d(1,1) = cosa;
-        break;
-      case 2: // Z-type rotation
-        tr2d(0,0) = ComplexScalar(cosa, sina);  tr2d(0,1) = 0;
-        tr2d(1,0) = 0;                          tr2d(1,1) = ComplexScalar(cosa, -sina);
-        break;
-      default:
-        tomographer_assert(false && "Invalid rotation type number sampled!");
-      }
-      // apply the elementary rotation onto new_T, seen as a vector
-      const Eigen::Index i1 = k1 / (Eigen::Index)_llh.dmt.dim();
-      const Eigen::Index j1 = k1 % (Eigen::Index)_llh.dmt.dim();
-      const Eigen::Index i2 = k2 / (Eigen::Index)_llh.dmt.dim();
-      const Eigen::Index j2 = k2 % (Eigen::Index)_llh.dmt.dim();
-
-      logger.longdebug([&](std::ostream & stream) {
-          stream << "Elementary jump rotation: "
-                 << "k1="<<k1<<" -> i1="<<i1<<" j1="<<j1<<"  k2="<<k2<<" -> i2="<<i2<<" j2="<<j2<<"\n"
-                 << "tr2d=" << tr2d;
-        }) ;
-
-      const auto x = tr2d(0,0) * new_T(i1,j1) + tr2d(0,1) * new_T(i2,j2) ;
-      const auto y = tr2d(1,0) * new_T(i1,j1) + tr2d(1,1) * new_T(i2,j2) ;
-      new_T(i1,j1) = x;
-      new_T(i2,j2) = y;
+    const Eigen::Index num_rot = _jump_k.rows();
+
+    // draw all the random numbers we need.  For each rotation, select two distinct random
+    // indices, and randomly select whether we apply an elementary x, y or z rotation.
+    // These are all decoded from a single random integer r = (3*k1 + xyz)*(dim^2-1) + k2'
+    // with k2' in {0,...,dim^2-2}, and where k2 = k2' if k2' < k1 or k2 = k2'+1 otherwise
+    const Eigen::Index dim2m1 = (Eigen::Index)_llh.dmt.dim2() - 1;
+    _jump_n.setZero();
+    for (Eigen::Index j = 0; j < num_rot; ++j) {
+      const Eigen::Index r = _jump_distr_rnd(_rng);
+      const Eigen::Index q = r / dim2m1;
+      const Eigen::Index k1 = q / 3;
+      const Eigen::Index k2 = r - q * dim2m1;
+      _jump_k(j, 0) = k1;
+      _jump_k(j, 1) = k2 + (Eigen::Index)(k2 >= k1);
+      _jump_n(j, q - 3*k1) = 1;
+      _jump_sina(j) = _normal_distr_rnd(_rng);
+    }
+
+    // calculate the rotation coefficients, remember:
+    //   e^{i\phi(\vec{n}\cdot\vec{\sigma})} = \cos\phi \Ident + i\sin\phi (\vec{n}\cdot\vec{\sigma})
+    // so that alpha = \cos\phi + i n_z\sin\phi  and  beta = (n_y + i n_x)\sin\phi
+    _jump_sina = (params.step_size * _jump_sina).cwiseMax(RealScalar(-1)).cwiseMin(RealScalar(1));
+    _jump_alpha.real() = (RealScalar(1) - _jump_sina.square()).sqrt();
+    _jump_alpha.imag() = _jump_n.col(2) * _jump_sina;
+    _jump_beta.real() = _jump_n.col(1) * _jump_sina;
+    _jump_beta.imag() = _jump_n.col(0) * _jump_sina;
+
+    logger.longdebug([&](std::ostream & stream) {
+        stream << "Elementary jump rotations: k1,k2 = \n" << _jump_k.transpose() << "\n"
+               << "alpha = " << _jump_alpha.transpose() << "\n"
+               << "beta = " << _jump_beta.transpose();
+      }) ;
+
+    // apply the elementary rotations onto new_T, seen as a vector.  (We don't need to
+    // enforce k1 < k2, since exchanging k1 and k2 amounts to flipping the sign of \phi,
+    // which is symmetrically distributed.)
+    ComplexScalar * const Tdata = new_T.data();
+    for (Eigen::Index j = 0; j < num_rot; ++j) {
+      ComplexScalar & a = Tdata[_jump_k(j, 0)];
+      ComplexScalar & b = Tdata[_jump_k(j, 1)];
+      const ComplexScalar x = tomo_internal::cplx_mul(_jump_alpha(j), a) + tomo_internal::cplx_mul(_jump_beta(j), b);
+      const ComplexScalar y = tomo_internal::cplx_mul(std::conj(_jump_alpha(j)), b)
+        - tomo_internal::cplx_mul(std::conj(_jump_beta(j)), a);
+      a = x;
+      b = y;
     }
 
     // ensure continued normalization
-    new_T /= new_T.norm(); // norm is Frobenius norm
+    new_T *= RealScalar(1) / new_T.norm(); // norm is Frobenius norm
 
     // new_T is ready, return it
     return new_T;
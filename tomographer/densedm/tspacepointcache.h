@@ -0,0 +1,185 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TOMOGRAPHER_DENSEDM_TSPACEPOINTCACHE_H
+#define TOMOGRAPHER_DENSEDM_TSPACEPOINTCACHE_H
+
+#include <utility> // std::swap
+
+#include <Eigen/Eigen>
+
+#include <tomographer/tools/cxxutil.h> // tomographer_assert()
+#include <tomographer/tools/needownoperatornew.h>
+#include <tomographer/densedm/dmtypes.h>
+#include <tomographer/densedm/param_herm_x.h>
+
+
+/** \file tspacepointcache.h
+ *
+ * \brief Cache of quantities derived from a point \f$ T \f$ of a random walk in T space
+ *
+ * See \ref Tomographer::DenseDM::TSpace::DensePointCache.
+ */
+
+
+namespace Tomographer {
+namespace DenseDM {
+namespace TSpace {
+
+
+/** \brief Quantities derived from a point \f$ T \f$ in \ref pageParamsT, calculated at
+ *         most once
+ *
+ * This object stores a point \f$ T \f$ of a random walk in T space, along with the
+ * density matrix \f$ \rho = TT^\dagger \f$, its \ref pageParamsX and its eigenvalues.
+ * The derived quantities are only calculated the first time they are requested, and are
+ * then reused until a new point is set with \ref setT().
+ *
+ * This is the \a PointCacheType of \ref LLHMHWalker and \ref LLHMHWalkerLight (see \ref
+ * pageInterfaceMHWalker).  The \ref MHRandomWalk then keeps such a cache for its current
+ * point, which is filled while the log-likelihood is evaluated and which the figure of
+ * merit calculators of \ref tspacefigofmerit.h can use instead of recalculating \f$
+ * TT^\dagger \f$ for each sample.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename DMTypes_>
+class TOMOGRAPHER_EXPORT DensePointCache
+  : public virtual Tools::NeedOwnOperatorNew<typename DMTypes_::MatrixType>::ProviderType
+{
+public:
+  typedef DMTypes_ DMTypes;
+  typedef typename DMTypes::MatrixType MatrixType;
+  typedef typename DMTypes::MatrixTypeConstRef MatrixTypeConstRef;
+  typedef typename DMTypes::VectorParamType VectorParamType;
+  typedef typename DMTypes::RealScalar RealScalar;
+  //! Type used to store the eigenvalues of \f$ \rho \f$
+  typedef Eigen::Matrix<RealScalar, DMTypes::FixedDim, 1> RealVectorType;
+
+  //! Lets \ref Tools::NeedOwnOperatorNew know how to allocate objects which store us
+  typedef typename Tools::NeedOwnOperatorNew<MatrixType>::ProviderType OperatorNewProviderType;
+
+private:
+  MatrixType _T;
+
+  mutable MatrixType _rho;
+  mutable VectorParamType _x;
+  mutable RealVectorType _eigvals;
+
+  mutable bool _has_rho;
+  mutable bool _has_x;
+  mutable bool _has_eigvals;
+
+public:
+  //! Construct an empty cache.  Call \ref setT() before querying any value.
+  DensePointCache()
+    : _T(), _rho(), _x(), _eigvals(), _has_rho(false), _has_x(false), _has_eigvals(false)
+  {
+  }
+
+  //! Construct a cache for the point \a T
+  explicit DensePointCache(MatrixTypeConstRef T)
+    : _T(T), _rho(), _x(), _eigvals(), _has_rho(false), _has_x(false), _has_eigvals(false)
+  {
+  }
+
+  //! Store a new point \f$ T \f$, discarding all previously calculated quantities
+  inline void setT(MatrixTypeConstRef T)
+  {
+    _T = T;
+    _has_rho = false;
+    _has_x = false;
+    _has_eigvals = false;
+  }
+
+  //! The point \f$ T \f$ in \ref pageParamsT
+  inline const MatrixType & T() const { return _T; }
+
+  //! The density matrix \f$ \rho = TT^\dagger \f$
+  inline const MatrixType & rho() const
+  {
+    if (!_has_rho) {
+      _rho.noalias() = _T * _T.adjoint();
+      _has_rho = true;
+    }
+    return _rho;
+  }
+
+  //! The density matrix \f$ \rho = TT^\dagger \f$ in \ref pageParamsX
+  inline const VectorParamType & x() const
+  {
+    if (!_has_x) {
+      _x = ParamX<DMTypes>(DMTypes(_T.rows())).HermToX(rho());
+      _has_x = true;
+    }
+    return _x;
+  }
+
+  //! The eigenvalues of \f$ \rho = TT^\dagger \f$, in increasing order
+  inline const RealVectorType & rhoEigenvalues() const
+  {
+    if (!_has_eigvals) {
+      Eigen::SelfAdjointEigenSolver<MatrixType> eig(rho(), Eigen::EigenvaluesOnly);
+      _eigvals = eig.eigenvalues();
+      _has_eigvals = true;
+    }
+    return _eigvals;
+  }
+
+  //! Whether \f$ \rho \f$ has already been calculated for the current point
+  inline bool hasRho() const { return _has_rho; }
+  //! Whether the \ref pageParamsX of \f$ \rho \f$ has already been calculated for the current point
+  inline bool hasX() const { return _has_x; }
+
+  //! Exchange the contents of two caches (without any reallocation)
+  inline void swap(DensePointCache & other)
+  {
+    using std::swap;
+    _T.swap(other._T);
+    _rho.swap(other._rho);
+    _x.swap(other._x);
+    _eigvals.swap(other._eigvals);
+    swap(_has_rho, other._has_rho);
+    swap(_has_x, other._has_x);
+    swap(_has_eigvals, other._has_eigvals);
+  }
+};
+
+//! Exchange the contents of two \ref DensePointCache objects
+template<typename DMTypes>
+inline void swap(DensePointCache<DMTypes> & a, DensePointCache<DMTypes> & b)
+{
+  a.swap(b);
+}
+
+
+} // namespace TSpace
+} // namespace DenseDM
+} // namespace Tomographer
+
+
+#endif
@@ -38,6 +38,8 @@
 #include <stdexcept> // std::out_of_range
 #include <type_traits> // std::enable_if
 #include <algorithm> // std::max
+#include <limits> // std::numeric_limits
+#include <vector>
 
 #include <boost/math/constants/constants.hpp>
 // histogram types can be serialized with boost::serialization
@@ -217,6 +219,150 @@ private:
 
 
 
+/** \brief Rules to choose the range of a histogram automatically from pilot samples
+ *
+ * Instead of fixing the range \f$[\text{min},\text{max}]\f$ of a histogram beforehand,
+ * one may record a number of pilot values (typically during the thermalization sweeps of
+ * a random walk) and choose the range from those values with \ref freeze().
+ *
+ * The number of bins is always kept fixed (it is given by the fallback parameters passed
+ * to \ref freeze()).  The bin width is always chosen to be a power of two, and the range
+ * limits are chosen to be integer multiples of the bin width.  This way, histograms which
+ * were frozen independently (e.g. in different tasks) lie on a common grid and can be
+ * combined exactly after rebinning, see \ref histogramCommonGridParams() and \ref
+ * histogramRebinned().
+ *
+ * Set \a num_pilot_samples to zero to disable the adaptive range altogether (this is the
+ * default).
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename Scalar_ = double>
+struct TOMOGRAPHER_EXPORT HistogramAdaptiveRange
+{
+  //! The scalar type used to specify the "value" (horizontal axis) of the histogram
+  typedef Scalar_ Scalar;
+
+  //! The histogram parameters type we produce
+  typedef HistogramParams<Scalar> Params;
+
+  //! Constructor. The default constructor gives a disabled adaptive range.
+  inline HistogramAdaptiveRange(Eigen::Index num_pilot_samples_ = 0,
+                                Eigen::Index max_overflow_ = 0,
+                                Scalar lower_bound_ = -std::numeric_limits<Scalar>::infinity(),
+                                Scalar upper_bound_ = std::numeric_limits<Scalar>::infinity(),
+                                Scalar margin_ = Scalar(0.25))
+    : num_pilot_samples(num_pilot_samples_),
+      max_overflow(max_overflow_),
+      lower_bound(lower_bound_),
+      upper_bound(upper_bound_),
+      margin(margin_)
+  {
+  }
+
+  /** \brief The number of pilot values to base the range on
+   *
+   * Stats collectors keep only the most recent \a num_pilot_samples pilot values.  If
+   * zero, the adaptive range is disabled.
+   */
+  Eigen::Index num_pilot_samples;
+
+  /** \brief Maximum number of off-chart values to remember once the range is frozen
+   *
+   * Values which fall outside of the frozen range are kept aside (up to this number), so
+   * that the range can be extended to include them at the end instead of losing them to
+   * the off-chart counter.
+   */
+  Eigen::Index max_overflow;
+
+  //! A hard lower limit for the histogram range (e.g. zero for a distance measure)
+  Scalar lower_bound;
+  //! A hard upper limit for the histogram range (e.g. one for the fidelity)
+  Scalar upper_bound;
+
+  //! Extra room to leave on each side of the pilot values, as a fraction of their spread
+  Scalar margin;
+
+  //! Whether the adaptive range is enabled at all
+  inline bool enabled() const { return num_pilot_samples > 0; }
+
+  /** \brief Choose the histogram parameters from the given pilot values
+   *
+   * The number of bins is taken from \a fallback.  The bin width is the smallest power of
+   * two such that the pilot values, widened by \a margin on each side, fit in <code>num_bins
+   * - 1</code> bins.  The range is then shifted such that it stays within \a lower_bound
+   * and \a upper_bound if possible.
+   *
+   * If \a values does not contain any finite value, then \a fallback is returned as is.
+   */
+  template<typename ContainerType>
+  inline Params freeze(const ContainerType & values, const Params & fallback) const
+  {
+    Scalar lo = std::numeric_limits<Scalar>::infinity();
+    Scalar hi = -std::numeric_limits<Scalar>::infinity();
+    for (const auto & v : values) {
+      if (!Tools::isFinite(v)) {
+        continue;
+      }
+      lo = std::min<Scalar>(lo, v);
+      hi = std::max<Scalar>(hi, v);
+    }
+    if (lo > hi) {
+      // no (finite) pilot values
+      return fallback;
+    }
+    lo = std::max(lo, lower_bound);
+    hi = std::min(hi, upper_bound);
+
+    const Eigen::Index num_bins = fallback.num_bins;
+    tomographer_assert(num_bins >= 2);
+
+    Scalar span = hi - lo;
+    if (!(span > 0)) {
+      // all pilot values are the same -- use the resolution we were given by default
+      span = fallback.binResolution() * (num_bins - 1);
+    }
+    lo -= margin * span;
+    span *= 1 + 2*margin;
+
+    const Scalar w = std::ldexp(Scalar(1), (int)std::ceil(std::log2(span / (num_bins - 1))));
+
+    Scalar min = std::floor(lo / w) * w;
+    if (min + num_bins * w > upper_bound) {
+      min = std::ceil(upper_bound / w) * w - num_bins * w;
+    }
+    if (min < lower_bound) {
+      min = std::floor(lower_bound / w) * w;
+    }
+    return Params(min, min + num_bins * w, num_bins);
+  }
+
+private:
+  friend boost::serialization::access;
+  template<typename Archive>
+  void serialize(Archive & a, unsigned int /* version */)
+  {
+    a & num_pilot_samples;
+    a & max_overflow;
+    // infinite bounds can't be stored in text archives; store a flag and a finite value
+    _serialize_bound(a, lower_bound, -1);
+    _serialize_bound(a, upper_bound, +1);
+    a & margin;
+  }
+  template<typename Archive>
+  static void _serialize_bound(Archive & a, Scalar & bound, int inf_sign)
+  {
+    bool is_set = std::isfinite(bound);
+    Scalar value = is_set ? bound : Scalar(0);
+    a & is_set;
+    a & value;
+    bound = is_set ? value : inf_sign * std::numeric_limits<Scalar>::infinity();
+  }
+};
+
+
+
+
 /** \brief Stores a histogram
  *
  * Splits the range of values \f$[\text{min},\text{max}]\f$ into \c num_bins number of
@@ -1374,6 +1520,952 @@ private:
 
 
 
+/** \brief The smallest common grid which covers all the given histogram ranges
+ *
+ * The resulting parameters use the largest bin width among \a params_list, and cover the
+ * union of all the given ranges, with limits rounded to integer multiples of that bin
+ * width.
+ *
+ * This is meant for histograms whose range was chosen with \ref
+ * HistogramAdaptiveRange::freeze(), whose bin widths are powers of two and whose limits
+ * are integer multiples of the bin width.  Each bin of such a histogram then falls
+ * entirely within a single bin of the common grid, and \ref histogramRebinned() is exact.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename HistogramParamsType>
+inline HistogramParamsType histogramCommonGridParams(const std::vector<HistogramParamsType> & params_list)
+{
+  typedef typename HistogramParamsType::Scalar Scalar;
+
+  tomographer_assert(params_list.size() > 0);
+
+  Scalar w = 0;
+  Scalar lo = std::numeric_limits<Scalar>::infinity();
+  Scalar hi = -std::numeric_limits<Scalar>::infinity();
+  for (const auto & p : params_list) {
+    w = std::max(w, p.binResolution());
+    lo = std::min(lo, p.min);
+    hi = std::max(hi, p.max);
+  }
+
+  const Scalar min = std::floor(lo / w) * w;
+  const Eigen::Index num_bins = (Eigen::Index)std::ceil((hi - min) / w - Scalar(1e-6));
+  return HistogramParamsType(min, min + num_bins * w, num_bins);
+}
+
+/** \brief Redistribute the counts of a histogram onto different bins
+ *
+ * Each bin of \a histogram is added to the bin of the new histogram which contains its
+ * center.  Bins whose center is outside of the range given by \a params are added to the
+ * off-chart counts.  The result is exact if each original bin is entirely contained in a
+ * single new bin, see \ref histogramCommonGridParams().
+ *
+ * This version is for histograms without error bars.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename HistogramType, TOMOGRAPHER_ENABLED_IF_TMPL(!HistogramType::HasErrorBars)>
+inline HistogramType histogramRebinned(const HistogramType & histogram,
+                                       const typename HistogramType::Params & params)
+{
+  HistogramType h(params);
+  h.off_chart = histogram.off_chart;
+  for (Eigen::Index k = 0; k < histogram.numBins(); ++k) {
+    const auto x = histogram.params.binCenterValue(k);
+    if (params.isWithinBounds(x)) {
+      h.bins(params.binIndexUnsafe(x)) += histogram.bins(k);
+    } else {
+      h.off_chart += histogram.bins(k);
+    }
+  }
+  return h;
+}
+
+/** \brief Redistribute the counts of a histogram onto different bins
+ *
+ * As for the version without error bars, each bin of \a histogram is added to the bin of
+ * the new histogram which contains its center.
+ *
+ * The error bars of bins which are merged together are added linearly.  Since the
+ * standard deviation of a sum of (possibly correlated) variables is at most the sum of
+ * their standard deviations, this may overestimate, but never underestimate, the error
+ * bar of the merged bin.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename HistogramType, TOMOGRAPHER_ENABLED_IF_TMPL(HistogramType::HasErrorBars)>
+inline HistogramType histogramRebinned(const HistogramType & histogram,
+                                       const typename HistogramType::Params & params)
+{
+  HistogramType h(params);
+  h.off_chart = histogram.off_chart;
+  for (Eigen::Index k = 0; k < histogram.numBins(); ++k) {
+    const auto x = histogram.params.binCenterValue(k);
+    if (params.isWithinBounds(x)) {
+      const Eigen::Index j = params.binIndexUnsafe(x);
+      h.bins(j) += histogram.bins(k);
+      h.delta(j) += histogram.delta(k);
+    } else {
+      h.off_chart += histogram.bins(k);
+    }
+  }
+  return h;
+}
+
+
+/** \brief Aggregate histograms which may have different ranges, on their common grid
+ *
+ * The histograms returned by \a extract_histogram_fn for each item in \a list are rebinned
+ * onto the grid given by \ref histogramCommonGridParams() using \ref
+ * histogramRebinned(), and are then aggregated with \a AggregatedHistogramType::aggregate()
+ * (e.g. \ref AggregatedHistogramSimple or \ref AggregatedHistogramWithErrorBars).
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename AggregatedHistogramType, typename ContainerType, typename ExtractHistogramFn>
+inline AggregatedHistogramType aggregateHistogramsOnCommonGrid(const ContainerType & list,
+                                                               ExtractHistogramFn extract_histogram_fn)
+{
+  typedef typename AggregatedHistogramType::HistogramType TaskHistogramType;
+  typedef typename AggregatedHistogramType::HistogramParams HistogramParamsType;
+
+  std::vector<HistogramParamsType> params_list;
+  for (const auto & item : list) {
+    params_list.push_back(extract_histogram_fn(item).params);
+  }
+  const HistogramParamsType common_params = histogramCommonGridParams(params_list);
+
+  std::vector<TaskHistogramType> rebinned;
+  rebinned.reserve(params_list.size());
+  for (const auto & item : list) {
+    rebinned.push_back(histogramRebinned(extract_histogram_fn(item), common_params));
+  }
+  return AggregatedHistogramType::aggregate(
+      common_params,
+      rebinned,
+      [](const TaskHistogramType & h) -> const TaskHistogramType & { return h; }
+      );
+}
+
+
+
+
+
+
+// -----------------------------------------------------------------------------
+// Two-Dimensional Histograms
+// -----------------------------------------------------------------------------
+
+
+
+/** \brief The parameters of a \ref Histogram2D
+ *
+ * These are simply the \ref HistogramParams of each axis.  The first value ("x") is binned
+ * according to \ref x and the second value ("y") according to \ref y.
+ *
+ * The bins are numbered with a single flat index, the x-bin index running fastest: the
+ * bin \f$(i,j)\f$ has flat index <code>i + j*x.num_bins</code>.  This coincides with
+ * Eigen's default column-major storage of a <code>x.num_bins</code>-by-<code>y.num_bins</code>
+ * array.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename Scalar_ = double>
+struct TOMOGRAPHER_EXPORT Histogram2DParams
+{
+  //! The scalar type used to specify the values of the histogram
+  typedef Scalar_ Scalar;
+
+  //! The parameters type of each axis
+  typedef HistogramParams<Scalar> AxisParams;
+
+  //! The obvious constructor
+  inline Histogram2DParams(AxisParams x_ = AxisParams(), AxisParams y_ = AxisParams())
+    : x(x_), y(y_)
+  {
+  }
+
+  //! Range and number of bins for the first value
+  AxisParams x;
+  //! Range and number of bins for the second value
+  AxisParams y;
+
+  //! The total number of bins, <code>x.num_bins * y.num_bins</code>
+  inline Eigen::Index numBins() const
+  {
+    return x.num_bins * y.num_bins;
+  }
+
+  //! Tests whether the given point lies in the range of the histogram along both axes
+  inline bool isWithinBounds(Scalar vx, Scalar vy) const
+  {
+    return x.isWithinBounds(vx) && y.isWithinBounds(vy);
+  }
+
+  /** \brief Returns the flat index of the bin this point should be counted in
+   *
+   * \note Raises \a std::out_of_range if the point is not within the bounds of the
+   * histogram.
+   */
+  inline Eigen::Index binIndex(Scalar vx, Scalar vy) const
+  {
+    return x.binIndex(vx) + x.num_bins * y.binIndex(vy);
+  }
+
+  /** \brief Returns the flat index of the bin this point should be counted in
+   *
+   * This function blindly assumes its arguments are within bounds, i.e. they must satisfy
+   * <code>isWithinBounds(vx, vy)</code>.
+   */
+  inline Eigen::Index binIndexUnsafe(Scalar vx, Scalar vy) const
+  {
+    return x.binIndexUnsafe(vx) + x.num_bins * y.binIndexUnsafe(vy);
+  }
+
+  //! The flat index of the bin \f$(i,j)\f$
+  inline Eigen::Index flatIndex(Eigen::Index i, Eigen::Index j) const
+  {
+    tomographer_assert(Tools::isPositive(i) && i < x.num_bins);
+    tomographer_assert(Tools::isPositive(j) && j < y.num_bins);
+    return i + x.num_bins * j;
+  }
+
+  //! The area of a single bin, <code>x.binResolution() * y.binResolution()</code>
+  inline Scalar binArea() const
+  {
+    return x.binResolution() * y.binResolution();
+  }
+
+private:
+  friend boost::serialization::access;
+  template<typename Archive>
+  void serialize(Archive & a, unsigned int /* version */)
+  {
+    a & x;
+    a & y;
+  }
+};
+
+
+/** \brief Stores a histogram of pairs of values
+ *
+ * The plane \f$[x_{\text{min}},x_{\text{max}}[\times[y_{\text{min}},y_{\text{max}}[\f$ is
+ * divided into a grid of bins as specified by the \ref Histogram2DParams.  The counts are
+ * stored contiguously in the single array \ref bins, with the flat bin numbering explained
+ * in \ref Histogram2DParams; recording a point thus only requires to compute two bin
+ * indices and to increment a single entry.  Use \ref countsArray() to view the counts as
+ * a two-dimensional array.
+ *
+ * The API mirrors that of \ref Histogram as far as it makes sense.  Does not store any
+ * form of error bars.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename Scalar_, typename CountType_ = int>
+class TOMOGRAPHER_EXPORT Histogram2D
+{
+public:
+  //! The scalar type of the values which are being histogrammed (usually \c double)
+  typedef Scalar_ Scalar;
+
+  //! The type that serves to count how many hits in each bin
+  typedef CountType_ CountType;
+
+  //! This histogram type does not provide error bars
+  static constexpr bool HasErrorBars = false;
+
+  //! The type for specifying parameters of this histogram (ranges, numbers of bins)
+  typedef Histogram2DParams<Scalar_> Params;
+
+  //! The type for specifying parameters of each axis
+  typedef typename Params::AxisParams AxisParams;
+
+  //! Parameters of this histogram (ranges and # of bins along each axis)
+  Params params;
+  //! The counts for each bin, indexed by the flat bin index (see \ref Histogram2DParams)
+  Eigen::Array<CountType, Eigen::Dynamic, 1> bins;
+  //! The number of points that fell outside of the histogram range
+  CountType off_chart;
+
+  //! Constructor: stores the parameters and initializes the histogram to zero counts everywhere
+  Histogram2D(Params p = Params())
+    : params(p), bins(Eigen::Array<CountType,Eigen::Dynamic,1>::Zero(p.numBins())),
+      off_chart(0)
+  {
+  }
+
+  //! Constructor: stores the parameters and initializes the histogram to zero counts everywhere
+  Histogram2D(AxisParams px, AxisParams py)
+    : params(px, py), bins(Eigen::Array<CountType,Eigen::Dynamic,1>::Zero(params.numBins())),
+      off_chart(0)
+  {
+  }
+
+  //! Constructor: move another histogram type
+  Histogram2D(Histogram2D && x)
+    : params(std::move(x.params)),
+      bins(std::move(x.bins)),
+      off_chart(x.off_chart)
+  {
+  }
+
+  //! Constructor: copy another histogram type
+  Histogram2D(const Histogram2D & x)
+    : params(x.params),
+      bins(x.bins),
+      off_chart(x.off_chart)
+  {
+  }
+
+  //! explicitly copy another two-dimensional histogram type
+  template<typename HistogramType,
+           TOMOGRAPHER_ENABLED_IF_TMPL(HistogramType::HasErrorBars == 0 ||
+                                       HistogramType::HasErrorBars == 1)>
+  static Histogram2D copy(const HistogramType & other)
+  {
+    Histogram2D h(other.params);
+    h.bins = other.bins.template cast<CountType>();
+    h.off_chart = other.off_chart;
+    return h;
+  }
+
+  //! Resets the histogram to zero counts everywhere (including the off-chart counts)
+  inline void reset()
+  {
+    bins.resize(params.numBins());
+    bins.setZero();
+    off_chart = 0;
+  }
+
+  /** \brief Load data for the histogram. Uses current histogram parameters, just sets the bin
+   * counts.
+   *
+   * \param x is an Eigen Vector or 1-D Array of the bin counts, indexed by the flat bin
+   *     index.  It must be dense, have one column and exactly \ref numBins() rows.
+   *
+   * \param off_chart_ if provided, then set the \ref off_chart count to this
+   *     number. Otherwise, reset the \ref off_chart counts to zero.
+   */
+  template<typename EigenType>
+  inline void load(const Eigen::DenseBase<EigenType> & x, CountType off_chart_ = 0)
+  {
+    tomographer_assert(x.cols() == 1);
+    tomographer_assert(x.rows() == params.numBins());
+    bins = x.derived().template cast<CountType>();
+    off_chart = off_chart_;
+  }
+
+  /** \brief Add data to the histogram.
+   *
+   * Adds the values contained in the other histogram \a x to the current histogram. This
+   * also updates the \ref off_chart counts.
+   *
+   * \warning The histogram \a x must have the same params as the current one. An
+   * assertion check is performed that this is the case (up to some small tolerance).
+   */
+  template<typename OtherScalar, typename OtherCountType>
+  inline void add(const Histogram2D<OtherScalar,OtherCountType> & x)
+  {
+    tomographer_assert(x.params.x.num_bins == params.x.num_bins);
+    tomographer_assert(x.params.y.num_bins == params.y.num_bins);
+    tomographer_assert(std::fabs(x.params.x.min - params.x.min) < 1e-8);
+    tomographer_assert(std::fabs(x.params.x.max - params.x.max) < 1e-8);
+    tomographer_assert(std::fabs(x.params.y.min - params.y.min) < 1e-8);
+    tomographer_assert(std::fabs(x.params.y.max - params.y.max) < 1e-8);
+    bins += x.bins.template cast<CountType>();
+    off_chart += x.off_chart;
+  }
+
+  //! The total number of bins. Shorthand for <code>params.numBins()</code>
+  inline Eigen::Index numBins() const
+  {
+    return params.numBins();
+  }
+  //! Number of bins along the first axis
+  inline Eigen::Index numBinsX() const
+  {
+    return params.x.num_bins;
+  }
+  //! Number of bins along the second axis
+  inline Eigen::Index numBinsY() const
+  {
+    return params.y.num_bins;
+  }
+
+  //! The counts in the bin \f$(i,j)\f$
+  inline CountType count(Eigen::Index i, Eigen::Index j) const
+  {
+    return bins(params.flatIndex(i, j));
+  }
+
+  /** \brief The bin counts, viewed as a <code>numBinsX()</code>-by-<code>numBinsY()</code> array
+   *
+   * The returned object is an Eigen::Map pointing to the data in \ref bins, no copy is
+   * performed.
+   */
+  inline Eigen::Map<const Eigen::Array<CountType, Eigen::Dynamic, Eigen::Dynamic> > countsArray() const
+  {
+    return Eigen::Map<const Eigen::Array<CountType, Eigen::Dynamic, Eigen::Dynamic> >(
+        bins.data(), params.x.num_bins, params.y.num_bins
+        );
+  }
+
+  //! Shorthand for Params::isWithinBounds()
+  inline bool isWithinBounds(Scalar vx, Scalar vy) const
+  {
+    return params.isWithinBounds(vx, vy);
+  }
+  //! Shorthand for Params::binIndex()
+  inline Eigen::Index binIndex(Scalar vx, Scalar vy) const
+  {
+    return params.binIndex(vx, vy);
+  }
+
+  /** \brief Record a new point in the histogram
+   *
+   * This adds one to the bin corresponding to the given values \a vx and \a vy.
+   *
+   * If the point is out of the histogram range, then \a off_chart is incremented by one.
+   *
+   * Returns the flat index of the bin in which the point was added, or \a -1 if
+   * off-chart.
+   */
+  inline Eigen::Index record(Scalar vx, Scalar vy)
+  {
+    if ( !isWithinBounds(vx, vy) ) {
+      ++off_chart;
+      return -1;
+    }
+    const Eigen::Index index = params.binIndexUnsafe(vx, vy);
+    ++bins( index );
+    return index;
+  }
+
+  /** \brief Record a new point in the histogram, with a certain weight.
+   *
+   * This adds \a weight to the histogram bin corresponding to the given values \a vx and
+   * \a vy.  If the point is out of the histogram range, then \a off_chart is incremented by
+   * \a weight.
+   *
+   * Returns the flat index of the bin in which the point was added, or \a -1 if
+   * off-chart.
+   */
+  inline Eigen::Index record(Scalar vx, Scalar vy, CountType weight)
+  {
+    if ( !isWithinBounds(vx, vy) ) {
+      off_chart += weight;
+      return -1;
+    }
+    const Eigen::Index index = params.binIndexUnsafe(vx, vy);
+    bins(index) += weight;
+    return index;
+  }
+
+  /** \brief Calculate the total weight stored in this histogram
+   *
+   * This is the factor by which the bin counts (and possibly error bars) should be divided
+   * in order to get a normalized probability density on the plane, i.e.
+   * \f[
+   *   \mathit{normalization} ~=~ \texttt{off_chart} ~+~
+   *       \texttt{params.binArea()} \times \sum_i \texttt{bins[}i\texttt{]}
+   * \f]
+   */
+  template<typename NewCountType = decltype(Scalar(1) + CountType(1))>
+  inline NewCountType normalization() const
+  {
+    return NewCountType(off_chart) + NewCountType(params.binArea() * bins.sum());
+  }
+
+  //! Get a normalized version of this histogram (see \ref normalization())
+  template<typename NewCountType = Scalar>
+  inline Histogram2D<Scalar, NewCountType> normalized() const
+  {
+    Histogram2D<Scalar, NewCountType> h(params);
+    const NewCountType f = normalization<NewCountType>();
+    h.load(bins.template cast<NewCountType>() / f, NewCountType(off_chart) / f);
+    return h;
+  }
+
+  //! Return the total number of histogram counts, <code>bins.sum() + off_chart</code>
+  inline CountType totalCounts() const
+  {
+    return bins.sum() + off_chart;
+  }
+
+  //! Get a version of this histogram, normalized by total counts (see \ref Histogram::normalizedCounts())
+  template<typename NewCountType = Scalar>
+  inline Histogram2D<Scalar, NewCountType> normalizedCounts() const
+  {
+    Histogram2D<Scalar, NewCountType> h(params);
+    const NewCountType f = totalCounts();
+    h.load(bins.template cast<NewCountType>() / f, NewCountType(off_chart) / f);
+    return h;
+  }
+
+private:
+  friend boost::serialization::access;
+  template<typename Archive>
+  void serialize(Archive & a, unsigned int /* version */)
+  {
+    a & params;
+    a & bins;
+    a & off_chart;
+  }
+
+};
+// static members:
+template<typename Scalar_, typename CountType_>
+constexpr bool Histogram2D<Scalar_,CountType_>::HasErrorBars;
+
+
+
+/** \brief Stores a two-dimensional histogram along with error bars
+ *
+ * Builds on top of \ref Histogram2D to store an error bar for each bin, in the array
+ * \ref delta which uses the same flat bin numbering as \ref Histogram2D::bins "bins".
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename Scalar_, typename CountType_ = double>
+class TOMOGRAPHER_EXPORT Histogram2DWithErrorBars
+  : public Histogram2D<Scalar_, CountType_>
+{
+public:
+  //! The Scalar Type. See Histogram2D::Scalar.
+  typedef Scalar_ Scalar;
+  //! The Type used to keep track of counts. See Histogram2D::CountType.
+  typedef CountType_ CountType;
+
+  //! Shortcut for our base class type.
+  typedef Histogram2D<Scalar_, CountType_> Base_;
+  //! Shortcut for our base class' histogram parameters. See Histogram2D::Params.
+  typedef typename Base_::Params Params;
+  //! See Histogram2D::AxisParams.
+  typedef typename Base_::AxisParams AxisParams;
+
+  //! This type of histogram does provide error bars
+  static constexpr bool HasErrorBars = true;
+
+  //! The error bars associated with each histogram bin (flat bin index)
+  Eigen::Array<CountType, Eigen::Dynamic, 1> delta;
+
+  using Base_::params;
+  using Base_::bins;
+  using Base_::off_chart;
+
+  //! Constructs an empty histogram with the given parameters.
+  Histogram2DWithErrorBars(Params params = Params())
+    : Base_(params), delta(Eigen::Array<CountType, Eigen::Dynamic, 1>::Zero(params.numBins()))
+  {
+  }
+
+  //! Constructs an empty histogram with the given parameters.
+  Histogram2DWithErrorBars(AxisParams px, AxisParams py)
+    : Base_(px, py), delta(Eigen::Array<CountType, Eigen::Dynamic, 1>::Zero(Base_::numBins()))
+  {
+  }
+
+  //! Constructor: move another histogram type
+  Histogram2DWithErrorBars(Histogram2DWithErrorBars && x)
+    : Base_(std::move(x)),
+      delta(std::move(x.delta))
+  {
+  }
+
+  //! Constructor: copy another histogram type
+  Histogram2DWithErrorBars(const Histogram2DWithErrorBars & x)
+    : Base_(x),
+      delta(x.delta)
+  {
+  }
+
+  //! explicitly copy another two-dimensional histogram type
+  template<typename HistogramType,
+           TOMOGRAPHER_ENABLED_IF_TMPL(HistogramType::HasErrorBars == 1)>
+  static Histogram2DWithErrorBars copy(const HistogramType & other)
+  {
+    Histogram2DWithErrorBars h(other.params);
+    h.bins = other.bins.template cast<CountType>();
+    h.delta = other.delta.template cast<CountType>();
+    h.off_chart = other.off_chart;
+    return h;
+  }
+
+  //! Resets the histogram to zero counts everywhere, and zero error bars.
+  inline void reset()
+  {
+    Base_::reset();
+    delta.resize(Base_::numBins());
+    delta.setZero();
+  }
+
+  //! Get the error bar for the bin \f$(i,j)\f$
+  inline CountType errorBar(Eigen::Index i, Eigen::Index j) const
+  {
+    return delta(params.flatIndex(i, j));
+  }
+
+  //! The error bars, viewed as a <code>numBinsX()</code>-by-<code>numBinsY()</code> array
+  inline Eigen::Map<const Eigen::Array<CountType, Eigen::Dynamic, Eigen::Dynamic> > errorBarsArray() const
+  {
+    return Eigen::Map<const Eigen::Array<CountType, Eigen::Dynamic, Eigen::Dynamic> >(
+        delta.data(), params.x.num_bins, params.y.num_bins
+        );
+  }
+
+  /** \brief Load data for the histogram. Uses current histogram parameters, just sets the bin
+   *         counts and the error bars.
+   *
+   * Both \a d and \a derr are indexed by the flat bin index, and must be dense, have one
+   * column and exactly \ref numBins() rows.
+   */
+  template<typename EigenType, typename EigenType2 = EigenType>
+  inline void load(const Eigen::DenseBase<EigenType> & d,
+                   const Eigen::DenseBase<EigenType2> & derr,
+                   CountType off_chart_ = 0)
+  {
+    Base_::load(d, off_chart_);
+    tomographer_assert(derr.cols() == 1);
+    tomographer_assert(derr.rows() == params.numBins());
+    delta = derr.derived().template cast<CountType>();
+  }
+
+  //! Get a normalized version of this histogram, including the error bars
+  template<typename NewCountType = Scalar>
+  inline Histogram2DWithErrorBars<Scalar, NewCountType> normalized() const
+  {
+    Histogram2DWithErrorBars<Scalar, NewCountType> h(params);
+    const NewCountType f = Base_::template normalization<NewCountType>();
+    h.load(bins.template cast<NewCountType>() / f,
+           delta.template cast<NewCountType>() / f,
+           NewCountType(off_chart) / f);
+    return h;
+  }
+
+  //! Get a version of this histogram, normalized by total counts, including the error bars
+  template<typename NewCountType = Scalar>
+  inline Histogram2DWithErrorBars<Scalar, NewCountType> normalizedCounts() const
+  {
+    Histogram2DWithErrorBars<Scalar, NewCountType> h(params);
+    const NewCountType f = Base_::totalCounts();
+    h.load(bins.template cast<NewCountType>() / f,
+           delta.template cast<NewCountType>() / f,
+           NewCountType(off_chart) / f);
+    return h;
+  }
+
+private:
+  // disable add() and record(), which don't take care of error bars. To combine
+  // histograms, use AveragedHistogram2D.
+  template<typename... Args>
+  inline void add(Args && ... )
+  {
+  }
+  template<typename... Args>
+  inline void record(Args && ... )
+  {
+  }
+
+  friend boost::serialization::access;
+  template<typename Archive>
+  void serialize(Archive & a, unsigned int /* version */)
+  {
+    a & boost::serialization::base_object<Base_>(*this);
+    a & delta;
+  }
+
+};
+// static members:
+template<typename Scalar_, typename CountType_>
+constexpr bool Histogram2DWithErrorBars<Scalar_,CountType_>::HasErrorBars;
+
+
+
+/** \brief Combines several two-dimensional histograms (with same parameters) into an
+ *         averaged histogram
+ *
+ * This is the two-dimensional counterpart of \ref AveragedHistogram; the averaging and
+ * the combination of error bars is carried out in exactly the same way, independently for
+ * each bin (see \ref pageTheoryAveragedHistogram).
+ *
+ * Add histograms with repeated calls to \ref addHistogram(), and then call \ref
+ * finalize().
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename HistogramType_, typename RealAvgType = double>
+class TOMOGRAPHER_EXPORT AveragedHistogram2D
+  : public Histogram2DWithErrorBars<typename HistogramType_::Scalar, RealAvgType>
+{
+public:
+  //! Type of the individual histograms we are averaging.
+  typedef HistogramType_ HistogramType;
+  //! Shortcut for our base class' type.
+  typedef Histogram2DWithErrorBars<typename HistogramType_::Scalar, RealAvgType> Base_;
+
+  //! The histogram parameters' type. See \ref Histogram2D::Params
+  typedef typename Base_::Params Params;
+  //! The histogram's scalar type. See \ref Histogram2D::Scalar
+  typedef typename Base_::Scalar Scalar;
+  //! The histogram' count type. This is exactly the same as \a RealAvgType.
+  typedef typename Base_::CountType CountType;
+
+  //! This histogram type does provide error bars.
+  static constexpr bool HasErrorBars = true;
+
+  //! The number of histograms averaged so far.
+  int num_histograms;
+
+  //! Constructs an AveragedHistogram2D with the given histogram parameters.
+  AveragedHistogram2D(const Params& params = Params())
+    : Base_(params), num_histograms(0)
+  {
+  }
+
+  AveragedHistogram2D(const AveragedHistogram2D& copy)
+    : Base_(copy), num_histograms(copy.num_histograms)
+  {
+  }
+  AveragedHistogram2D(AveragedHistogram2D && x)
+    : Base_(std::move(x)),
+      num_histograms(x.num_histograms)
+  {
+  }
+
+  //! Resets the data and sets new params.
+  inline void reset(const Params& params_)
+  {
+    Base_::params = params_;
+    Base_::reset();
+    num_histograms = 0;
+  }
+
+  //! Resets the data keeping the exisiting params.
+  inline void reset()
+  {
+    Base_::reset();
+    num_histograms = 0;
+  }
+
+  /** \brief Add a new histogram in the data series
+   *
+   * This implementation deals with the case where the individual histograms don't have
+   * themselves error bars.  See \ref AveragedHistogram::addHistogram().
+   */
+  TOMOGRAPHER_ENABLED_IF(!HistogramType::HasErrorBars)
+  inline void addHistogram(const HistogramType& histogram)
+  {
+    // bins collects the sum of the histograms, delta the sum of squares for now
+    tomographer_assert(histogram.numBins() == Base_::numBins());
+
+    const Eigen::Array<RealAvgType,Eigen::Dynamic,1> binvalues =
+      histogram.bins.template cast<RealAvgType>();
+    Base_::bins += binvalues;
+    Base_::delta += binvalues * binvalues;
+
+    Base_::off_chart += histogram.off_chart;
+    ++num_histograms;
+  }
+
+  /** \brief Finalize the averaging procedure
+   *
+   * This implementation deals with the case where the individual histograms don't have
+   * themselves error bars.  See \ref AveragedHistogram::finalize().
+   */
+  TOMOGRAPHER_ENABLED_IF(!HistogramType::HasErrorBars)
+  inline void finalize()
+  {
+    Base_::bins /= num_histograms;
+    Base_::delta /= num_histograms;
+    Base_::off_chart /= num_histograms;
+
+    // delta = sqrt(< X^2 > - < X >^2) / sqrt(Nrepeats-1)
+    auto finhist2 = Base_::bins*Base_::bins; // for array, this is c-wise product
+    Base_::delta = ( (Base_::delta - finhist2) / (num_histograms-1) ).sqrt();
+  }
+
+  /** \brief Add a new histogram in the data series
+   *
+   * This implementation deals with the case where the individual histograms do have
+   * themselves error bars.  See \ref AveragedHistogram::addHistogram().
+   */
+  TOMOGRAPHER_ENABLED_IF(HistogramType::HasErrorBars)
+  inline void addHistogram(const HistogramType& histogram)
+  {
+    // bins collects the sum of the histograms, delta the sum of squared error bars for now
+    tomographer_assert(histogram.numBins() == Base_::numBins());
+
+    Base_::bins += histogram.bins.template cast<RealAvgType>();
+    const Eigen::Array<RealAvgType,Eigen::Dynamic,1> bindeltas =
+      histogram.delta.template cast<RealAvgType>();
+    Base_::delta += bindeltas * bindeltas;
+
+    Base_::off_chart += histogram.off_chart;
+    ++num_histograms;
+  }
+
+  /** \brief Finalize the averaging procedure
+   *
+   * This implementation deals with the case where the individual histograms do have
+   * themselves error bars.  See \ref AveragedHistogram::finalize().
+   */
+  TOMOGRAPHER_ENABLED_IF(HistogramType::HasErrorBars)
+  inline void finalize()
+  {
+    Base_::bins /= num_histograms;
+    Base_::off_chart /= num_histograms;
+
+    Base_::delta = Base_::delta.sqrt();
+    Base_::delta /= num_histograms;
+  }
+
+private:
+  friend boost::serialization::access;
+  template<typename Archive>
+  void serialize(Archive & a, unsigned int /* version */)
+  {
+    a & boost::serialization::base_object<Base_>(*this);
+    a & num_histograms;
+  }
+
+};
+// static members:
+template<typename HistogramType_, typename RealAvgType>
+constexpr bool AveragedHistogram2D<HistogramType_,RealAvgType>::HasErrorBars;
+
+
+
+/** \brief Aggregator of two-dimensional histograms which each have error bars
+ *
+ * This is the two-dimensional counterpart of \ref AggregatedHistogramWithErrorBars.  The
+ * \ref final_histogram combines the (binning analysis) error bars of each histogram,
+ * while the \ref simple_final_histogram ignores them and determines error bars from the
+ * standard deviation of the different histograms.
+ *
+ * Use the static \a aggregate() function to construct an object instance, aggregating
+ * histograms from a list.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename HistogramType_, typename CountRealType_>
+class TOMOGRAPHER_EXPORT AggregatedHistogram2DWithErrorBars
+{
+public:
+  /** \brief The histogram type corresponding to the result of a task
+   *
+   * \warning This histogram type must provide error bars.
+   */
+  typedef HistogramType_ HistogramType;
+
+  TOMO_STATIC_ASSERT_EXPR( HistogramType::HasErrorBars ) ;
+
+  //! The parameters type used to describe our histogram ranges and numbers of bins
+  typedef typename HistogramType::Params HistogramParams;
+
+  //! The scalar type of the histogram
+  typedef typename HistogramType::Scalar HistogramScalarType;
+
+  //! Type used for averaged histogram counts (e.g. \a double)
+  typedef CountRealType_ CountRealType;
+
+  //! The type of the final resulting, averaged histogram
+  typedef AveragedHistogram2D<HistogramType, CountRealType> FinalHistogramType;
+
+  //! The "simple" histogram, as if without binning analysis
+  typedef Histogram2D<typename HistogramType::Scalar, typename HistogramType::CountType> SimpleHistogramType;
+  /** \brief Properly averaged "simple" histogram, with naive statistical standard
+   *         deviation error bars from the several task runs
+   */
+  typedef AveragedHistogram2D<SimpleHistogramType, CountRealType> SimpleFinalHistogramType;
+
+  AggregatedHistogram2DWithErrorBars(AggregatedHistogram2DWithErrorBars && x)
+    : final_histogram(std::move(x.final_histogram)),
+      simple_final_histogram(std::move(x.simple_final_histogram))
+  {
+  }
+
+  AggregatedHistogram2DWithErrorBars(FinalHistogramType && x, SimpleFinalHistogramType && y)
+    : final_histogram(std::move(x)),
+      simple_final_histogram(std::move(y))
+  {
+  }
+
+  //! The final histogram, properly combining the error bars of each histogram
+  FinalHistogramType final_histogram;
+
+  //! The "naive" final histogram, ignoring the error bars of each histogram (see class doc)
+  SimpleFinalHistogramType simple_final_histogram;
+
+  /** \brief Aggregate a list of histograms
+   *
+   * Works exactly like \ref AggregatedHistogramWithErrorBars::aggregate().
+   */
+  template<typename ContainerType, typename ExtractHistogramFn>
+  static inline AggregatedHistogram2DWithErrorBars aggregate(const HistogramParams & params,
+                                                             const ContainerType & list,
+                                                             ExtractHistogramFn extract_histogram_fn)
+  {
+    // initializes with zeros
+    FinalHistogramType hist(params);
+    SimpleFinalHistogramType histsimple(params);
+
+    for (const auto& item : list) {
+      const auto& h = extract_histogram_fn(item);
+      hist.addHistogram(h);
+      histsimple.addHistogram(h);
+    }
+
+    hist.finalize();
+    histsimple.finalize();
+
+    return AggregatedHistogram2DWithErrorBars(std::move(hist), std::move(histsimple));
+  }
+
+  /** \brief Produce a comma-separated-value (CSV) representation of the final aggregated
+   *         histogram data
+   *
+   * Same as \ref AggregatedHistogramWithErrorBars::printHistogramCsv(), except that there
+   * is one row per bin of the two-dimensional grid, and that the first two columns
+   * ("ValueX", "ValueY") hold the lower values of the bin along each axis.  Rows are
+   * ordered by flat bin index, i.e., the x value changes fastest.
+   */
+  inline void printHistogramCsv(std::ostream & stream,
+                                const std::string sep = "\t",
+                                const std::string linesep = "\n",
+                                const int precision = 10)
+  {
+    stream << "ValueX" << sep << "ValueY" << sep << "Counts" << sep << "Error" << sep << "SimpleError"
+           << linesep << std::scientific << std::setprecision(precision);
+    const HistogramParams & p = final_histogram.params;
+    for (Eigen::Index j = 0; j < p.y.num_bins; ++j) {
+      for (Eigen::Index i = 0; i < p.x.num_bins; ++i) {
+        const Eigen::Index kk = p.flatIndex(i, j);
+        stream << p.x.binLowerValue(i) << sep
+               << p.y.binLowerValue(j) << sep
+               << final_histogram.bins(kk) << sep
+               << final_histogram.delta(kk) << sep
+               << simple_final_histogram.delta(kk) << linesep;
+      }
+    }
+  }
+
+private:
+  friend boost::serialization::access;
+  template<typename Archive>
+  void serialize(Archive & a, unsigned int /* version */)
+  {
+    a & final_histogram;
+    a & simple_final_histogram;
+  }
+
+}; // class AggregatedHistogram2DWithErrorBars
+
+
+
+
+
+
 
 // -----------------------------------------------------------------------------
 // Pretty Print Histogram Utilities
@@ -36,6 +36,7 @@
 #include <sstream>
 #include <iomanip>
 #include <type_traits>
+#include <utility> // std::swap
 
 #include <boost/serialization/serialization.hpp>
 
@@ -119,6 +120,45 @@ inline std::ostream & operator<<(std::ostream & stream, MHWalkerParamsStepSize<S
 }
 
 
+/** \brief An MHWalkerParams type for a Hamiltonian Monte Carlo walker
+ *
+ * Stores the step size of a leapfrog integration step, and the number of leapfrog steps
+ * which form the trajectory leading to a new proposal point (see, e.g., \ref
+ * DenseDM::TSpace::LLHHMCWalker).  The length of a trajectory is <code>step_size *
+ * num_leapfrog_steps</code>.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename StepRealType_ = double, typename LeapfrogCountIntType_ = int>
+struct TOMOGRAPHER_EXPORT MHWalkerParamsHMC
+{
+  typedef StepRealType_ StepRealType;
+  typedef LeapfrogCountIntType_ LeapfrogCountIntType;
+
+  MHWalkerParamsHMC() : step_size(), num_leapfrog_steps(1) { }
+  MHWalkerParamsHMC(StepRealType step_size_, LeapfrogCountIntType num_leapfrog_steps_ = 1)
+    : step_size(step_size_), num_leapfrog_steps(num_leapfrog_steps_) { }
+
+  StepRealType step_size;
+  LeapfrogCountIntType num_leapfrog_steps;
+
+private:
+  friend boost::serialization::access;
+  template<typename Archive>
+  void serialize(Archive & a, unsigned int /* version */)
+  {
+    a & step_size;
+    a & num_leapfrog_steps;
+  }
+};
+
+template<typename StepRealType, typename LeapfrogCountIntType>
+inline std::ostream & operator<<(std::ostream & stream, MHWalkerParamsHMC<StepRealType,LeapfrogCountIntType> p)
+{
+  return stream << "step_size=" << p.step_size << ", num_leapfrog_steps=" << p.num_leapfrog_steps;
+}
+
+
 /** \brief Specify the parameters of a Metropolis-Hastings random walk
  *
  * Specifies the parameters of a Metropolis-Hastings random walk (number of
@@ -223,6 +263,12 @@ inline std::ostream & operator<<(std::ostream & str, const MHRWParams<MHWalkerPa
  *     move in the random walk), or only after processing a live sample (only during live
  *     runs)
  *
+ * A controller may also set \ref MHRWControllerAdjustWhileThermalizing without any
+ * frequency flag.  Its \a adjustParams() callback is then never called, but it may
+ * change the parameters in its \a thermalizingDone() callback, i.e., between the last
+ * thermalization iteration and the first live iteration (see, e.g., \ref
+ * MHRWSweepSizeController).
+ *
  *
  * \since Added in %Tomographer 5.0.
  */
@@ -338,38 +384,50 @@ public:
 
 namespace tomo_internal {
 
-template<unsigned int AdjustmentStrategy, unsigned int OtherAdjustmentStrategy>
+// the stages of the random walk during which the controller adjusts the params after
+// iterations or samples.  A controller which sets a stage flag but no frequency flag only
+// changes the params in its thermalizingDone() callback, and can't conflict with others.
+template<unsigned int AdjustmentStrategy>
+struct controller_adjusting_stages {
+  static constexpr unsigned int value =
+    ((AdjustmentStrategy & MHRWControllerAdjustFrequencyMASK) != 0)
+    ? (AdjustmentStrategy & MHRWControllerAdjustRWStageMASK)
+    : 0u;
+};
+
+template<unsigned int AdjustmentStrategy, unsigned int OtherAdjustingStages>
 struct controller_flags_compatible {
   static constexpr bool value =
     // adjustments are done on different stages of the random walk
-    ((AdjustmentStrategy & OtherAdjustmentStrategy & MHRWControllerAdjustRWStageMASK) == 0) ;
+    ((controller_adjusting_stages<AdjustmentStrategy>::value & OtherAdjustingStages) == 0) ;
 };
 
 
-template<bool RestOk, unsigned int ProcessedAdjustmentStrategyFlags,
+template<bool RestOk, unsigned int ProcessedAdjustingStages, unsigned int ProcessedAdjustmentStrategyFlags,
          typename... MHRWControllerTypes>
 struct controllers_compatible_helper;
 
-template<bool RestOk, unsigned int ProcessedAdjustmentStrategyFlags, typename MHRWControllerAType,
-         typename... MHRWControllerRestTypes>
-struct controllers_compatible_helper<RestOk, ProcessedAdjustmentStrategyFlags, MHRWControllerAType,
-                                   MHRWControllerRestTypes...>
+template<bool RestOk, unsigned int ProcessedAdjustingStages, unsigned int ProcessedAdjustmentStrategyFlags,
+         typename MHRWControllerAType, typename... MHRWControllerRestTypes>
+struct controllers_compatible_helper<RestOk, ProcessedAdjustingStages, ProcessedAdjustmentStrategyFlags,
+                                     MHRWControllerAType, MHRWControllerRestTypes...>
   : controllers_compatible_helper<
       RestOk && controller_flags_compatible<MHRWControllerAType::AdjustmentStrategy,
-                                            ProcessedAdjustmentStrategyFlags>::value ,
+                                            ProcessedAdjustingStages>::value ,
+      ProcessedAdjustingStages | controller_adjusting_stages<MHRWControllerAType::AdjustmentStrategy>::value,
       ProcessedAdjustmentStrategyFlags | MHRWControllerAType::AdjustmentStrategy,
       MHRWControllerRestTypes...
   > { };
 
-template<bool RestOk, unsigned int ProcessedAdjustmentStrategyFlags>
-struct controllers_compatible_helper<RestOk, ProcessedAdjustmentStrategyFlags> {
+template<bool RestOk, unsigned int ProcessedAdjustingStages, unsigned int ProcessedAdjustmentStrategyFlags>
+struct controllers_compatible_helper<RestOk, ProcessedAdjustingStages, ProcessedAdjustmentStrategyFlags> {
   static constexpr bool value = RestOk;
   static constexpr unsigned int CombinedAdjustmentStrategy = ProcessedAdjustmentStrategyFlags;
 };
 
 
 template<typename... MHRWControllerTypes>
-struct controllers_compatible : controllers_compatible_helper<true, 0, MHRWControllerTypes...> { };
+struct controllers_compatible : controllers_compatible_helper<true, 0, 0, MHRWControllerTypes...> { };
 
 } // namespace tomo_internal
 
@@ -385,7 +443,9 @@ struct controllers_compatible : controllers_compatible_helper<true, 0, MHRWContr
  * The random walk controllers must be \a compatible.  Two controllers \a A and \a B are
  * \a compatible if they perform adjustments at different stages of the random walk (e.g.,
  * one during thermalization and the other during the live runs) as given by their \a
- * AdjustmentStrategy flags.
+ * AdjustmentStrategy flags.  Controllers which don't set any frequency flag (i.e., which
+ * only adjust the parameters in their \a thermalizingDone() callback) are compatible with
+ * all other controllers.
  *
  * The \a allowDoneRuns() and \a allowDoneThermalization() callbacks do not affect whether
  * controllers are compatible.  The thermalization runs end only after all the controllers'
@@ -587,6 +647,51 @@ template<typename MHWalker>
 struct helper_FnValueType_or_dummy<MHWalker,false> {
   typedef int type; // dummy
 };
+
+// helper_PointCacheType_or_void: MHWalker::PointCacheType if that type exists, otherwise
+// void
+template<typename MHWalker, typename = void>
+struct helper_PointCacheType_or_void {
+  typedef void type;
+};
+template<typename MHWalker>
+struct helper_PointCacheType_or_void<MHWalker,
+                                     typename Tools::tomo_internal::sfinae_void<typename MHWalker::PointCacheType>::type> {
+  typedef typename MHWalker::PointCacheType type;
+};
+
+// helper_HasJumpLogProposalRatio: whether MHWalker has a method jumpLogProposalRatio()
+template<typename MHWalker, typename = void>
+struct helper_HasJumpLogProposalRatio {
+  enum { value = 0 };
+};
+template<typename MHWalker>
+struct helper_HasJumpLogProposalRatio<
+  MHWalker,
+  typename Tools::tomo_internal::sfinae_void<
+    decltype(std::declval<const MHWalker &>().jumpLogProposalRatio())
+    >::type> {
+  enum { value = 1 };
+};
+
+// storage for the point caches of the current and of the proposed points, if the
+// MHWalker has a PointCacheType
+template<typename PointCacheType>
+struct MHRWPointCacheStorage {
+  typedef PointCacheType CacheType;
+  CacheType cur;
+  CacheType next;
+  inline void acceptNext()
+  {
+    using std::swap;
+    swap(cur, next);
+  }
+};
+template<>
+struct MHRWPointCacheStorage<void> {
+  typedef int CacheType; // dummy
+  inline void acceptNext() { }
+};
 } // namespace tomo_internal
 
 
@@ -641,7 +746,12 @@ template<typename Rng_, typename MHWalker_, typename MHRWStatsCollector_,
          typename LoggerType_ = Logger::VacuumLogger,
          typename CountIntType_ = int>
 class TOMOGRAPHER_EXPORT MHRandomWalk
-  : public virtual Tools::NeedOwnOperatorNew<typename MHWalker_::PointType>::ProviderType
+  : public virtual Tools::NeedOwnOperatorNew<
+      typename MHWalker_::PointType,
+      typename tomo_internal::MHRWPointCacheStorage<
+        typename tomo_internal::helper_PointCacheType_or_void<MHWalker_>::type
+        >::CacheType
+      >::ProviderType
 {
 public:
   //! Random number generator type (see C++ std::random)
@@ -685,7 +795,43 @@ public:
     UseFnSyntaxType = MHWalker::UseFnSyntaxType
   };
 
+  /** \brief The cache of quantities derived from a point, or \c void
+   *
+   * This is \a MHWalker::PointCacheType if the \a MHWalker declares such a type, and \c
+   * void otherwise (see \ref pageInterfaceMHWalker).
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  typedef typename tomo_internal::helper_PointCacheType_or_void<MHWalker>::type PointCacheType;
+
+  enum {
+    /** \brief Whether the \a MHWalker provides a cache for the current point (see \ref
+     *         getCurrentPointCache())
+     *
+     * \since Added in %Tomographer 5.5
+     */
+    HasPointCache = !std::is_same<PointCacheType, void>::value
+  };
+
+  static_assert(!HasPointCache || (int)UseFnSyntaxType == (int)MHUseFnLogValue,
+                "A MHWalker with a PointCacheType must use UseFnSyntaxType == MHUseFnLogValue");
+
+  enum {
+    /** \brief Whether the proposal distribution of the \a MHWalker is not symmetric, and
+     *         the walker provides the correction to the acceptance probability with \a
+     *         jumpLogProposalRatio() (see \ref pageInterfaceMHWalker)
+     *
+     * \since Added in %Tomographer 5.5
+     */
+    HasJumpLogProposalRatio = tomo_internal::helper_HasJumpLogProposalRatio<MHWalker>::value
+  };
+
+  static_assert(!HasJumpLogProposalRatio || (int)UseFnSyntaxType == (int)MHUseFnLogValue,
+                "A MHWalker with jumpLogProposalRatio() must use UseFnSyntaxType == MHUseFnLogValue");
+
 private:
+  typedef tomo_internal::MHRWPointCacheStorage<PointCacheType> PointCacheStorage;
+
   // declare const if no adjustments are to be made. This expands to "MHRWParamsType _n;"
   // or "const MHRWParamsType _n;"
   typename tomo_internal::const_type_helper<
@@ -707,6 +853,11 @@ private:
    */
   FnValueType curptval;
 
+  /** \brief The point caches of the current point and of the proposed new point, if the
+   * \a MHWalker has a \a PointCacheType (see \ref pageInterfaceMHWalker)
+   */
+  PointCacheStorage _ptcache;
+
   /** \brief Keeps track of the total number of accepted moves during the "live" runs
    * (i.e., not thermalizing). This is used to track the acceptance ratio (see \ref
    * acceptanceRatio())
@@ -732,6 +883,7 @@ public:
       _logger(TOMO_ORIGIN, logger_),
       curpt(),
       curptval(),
+      _ptcache(),
       num_accepted(0),
       num_live_points(0)
   {
@@ -753,6 +905,7 @@ public:
       _logger(TOMO_ORIGIN, logger_),
       curpt(),
       curptval(),
+      _ptcache(),
       num_accepted(0),
       num_live_points(0)
   {
@@ -820,6 +973,22 @@ public:
     return curptval;
   }
 
+  /** \brief Access the cache of quantities derived from the current point
+   *
+   * This is only available if the \a MHWalker declares a \a PointCacheType (see \ref
+   * pageInterfaceMHWalker).  The cache was filled by the \a MHWalker when it calculated
+   * the function value at the current point; other objects which need quantities derived
+   * from the current point, such as value calculators, can reuse them from here instead
+   * of recalculating them.
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  TOMOGRAPHER_ENABLED_IF(HasPointCache)
+  inline const typename PointCacheStorage::CacheType & getCurrentPointCache() const
+  {
+    return _ptcache.cur;
+  }
+
   /** \brief Force manual state of random walk
    *
    * This may be called to force setting the current state of the random walk to the given
@@ -828,7 +997,7 @@ public:
   inline void setCurrentPoint(const PointType& pt)
   {
     curpt = pt;
-    curptval = _get_ptval(curpt);
+    curptval = _get_curptval();
     _logger.longdebug([&](std::ostream & s) {
 	s << "setCurrentPoint: set internal state. Value = " << curptval << "; Point =\n" << pt << "\n";
       });
@@ -846,7 +1015,7 @@ private:
 
     // starting point
     curpt = _mhwalker.startPoint();
-    curptval = _get_ptval(curpt);
+    curptval = _get_curptval();
 
     _mhwalker.init();
     _stats.init();
@@ -895,7 +1064,7 @@ private:
     // class.
     const PointType newpt = _mhwalker.jumpFn(curpt, _n.mhwalker_params);
 
-    const FnValueType newptval = _get_ptval(newpt);
+    const FnValueType newptval = _get_newptval(newpt);
 
     const double a = _get_a_value(newpt, newptval, curpt, curptval);
 
@@ -923,6 +1092,7 @@ private:
       // update the internal state of the random walk
       curpt = newpt;
       curptval = newptval;
+      _ptcache.acceptNext();
     }
     _logger.longdebug("_move() done.");
   }
@@ -988,13 +1158,24 @@ private:
   {
     return _mhwalker.fnLogVal(curpt);
   }
-  template<typename PtType1, typename PtType2, TOMOGRAPHER_ENABLED_IF_TMPL(UseFnSyntaxType == MHUseFnLogValue)>
+  template<typename PtType1, typename PtType2,
+           TOMOGRAPHER_ENABLED_IF_TMPL(UseFnSyntaxType == MHUseFnLogValue && !HasJumpLogProposalRatio)>
   inline double _get_a_value(PtType1 && /*newpt*/, FnValueType newptval,
                              PtType2 && /*curpt*/, FnValueType curptval) const
   {
     using namespace std;
     return (newptval > curptval) ? 1.0 : exp(double(newptval - curptval));
   }
+  // asymmetric proposal: the walker tells us the correction for the last jump it proposed
+  template<typename PtType1, typename PtType2,
+           TOMOGRAPHER_ENABLED_IF_TMPL(UseFnSyntaxType == MHUseFnLogValue && HasJumpLogProposalRatio)>
+  inline double _get_a_value(PtType1 && /*newpt*/, FnValueType newptval,
+                             PtType2 && /*curpt*/, FnValueType curptval) const
+  {
+    using namespace std;
+    const double loga = double(newptval - curptval) + double(_mhwalker.jumpLogProposalRatio());
+    return (loga > 0) ? 1.0 : exp(loga);
+  }
 
   // case UseFnSyntaxType==MHUseFnRelativeValue
   template<typename PtType, TOMOGRAPHER_ENABLED_IF_TMPL(UseFnSyntaxType == MHUseFnRelativeValue)>
@@ -1012,6 +1193,29 @@ private:
 
 #endif
 
+  // Calculate the function value at the current point, or at a new proposal point.  If
+  // the MHWalker has a point cache, we let it fill the cache of the corresponding point.
+  TOMOGRAPHER_ENABLED_IF(!HasPointCache)
+  inline FnValueType _get_curptval()
+  {
+    return _get_ptval(curpt);
+  }
+  TOMOGRAPHER_ENABLED_IF(HasPointCache)
+  inline FnValueType _get_curptval()
+  {
+    return _mhwalker.fnLogVal(curpt, _ptcache.cur);
+  }
+  template<typename PtType, TOMOGRAPHER_ENABLED_IF_TMPL(!HasPointCache)>
+  inline FnValueType _get_newptval(PtType && newpt)
+  {
+    return _get_ptval(std::forward<PtType>(newpt));
+  }
+  template<typename PtType, TOMOGRAPHER_ENABLED_IF_TMPL(HasPointCache)>
+  inline FnValueType _get_newptval(PtType && newpt)
+  {
+    return _mhwalker.fnLogVal(std::forward<PtType>(newpt), _ptcache.next);
+  }
+
 
   // adjustments
   template<bool IsThermalizing>
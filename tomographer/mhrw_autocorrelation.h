@@ -0,0 +1,566 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TOMOGRAPHER_MHRW_AUTOCORRELATION_H
+#define TOMOGRAPHER_MHRW_AUTOCORRELATION_H
+
+#include <cmath>
+
+#include <limits>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <sstream>
+#include <type_traits>
+
+#include <Eigen/Core>
+
+#include <boost/serialization/serialization.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <tomographer/tools/cxxutil.h>
+#include <tomographer/tools/fmt.h>
+#include <tomographer/tools/loggers.h>
+#include <tomographer/tools/eigenutil.h> // serialization of Eigen arrays
+#include <tomographer/tools/statusprovider.h>
+#include <tomographer/mhrw_bin_err.h> // BINNING_CONVERGED etc.
+#include <tomographer/valuecalculator.h> // getValueAtCurrentPoint()
+
+
+/** \file mhrw_autocorrelation.h
+ *
+ * \brief Estimate the integrated autocorrelation time and the effective sample size of a
+ *        random walk, while it is running.
+ *
+ * See \ref Tomographer::MHRWAutocorrelationStatsCollector and \ref
+ * Tomographer::StreamingAutocorrelationAnalysis.
+ */
+
+
+namespace Tomographer {
+
+
+/** \brief Streaming estimate of the integrated autocorrelation time of a sequence of
+ *         values, by the method of batch means
+ *
+ * The samples are averaged two by two, then the averages two by two again, and so on
+ * (see \ref pageTheoryBinningAnalysis).  The variance of the bin means at level \f$ k
+ * \f$, i.e. of averages of \f$ 2^k \f$ consecutive samples, behaves for large \f$ 2^k \f$
+ * like \f$ 2\tau_{\mathrm{int}}\,\sigma^2/2^k \f$, where \f$ \sigma^2 \f$ is the variance
+ * of the samples.  This gives the estimate
+ * \f[
+ *   \tau_{\mathrm{int}} \approx \frac{2^k\,\sigma_k^2}{2\,\sigma_0^2}\ ,
+ * \f]
+ * which is evaluated at the highest level which still has at least \a minNumBins() bins.
+ * With this convention \f$ \tau_{\mathrm{int}} = 1/2 \f$ for uncorrelated samples, and
+ * the effective sample size is \f$ n / (2\tau_{\mathrm{int}}) \f$.
+ *
+ * Unlike \ref BinningAnalysis, no buffer of samples is kept: each level only stores the
+ * first member of its current pair of values, together with the running mean and
+ * variance of its bin means (Welford's update, which does not suffer from cancellations
+ * if the values have a large offset, as a log-likelihood typically does).  Levels are
+ * added as the samples come in, so that the memory grows like \f$ \log_2 n \f$.
+ *
+ * Several values may be tracked in parallel, each being one component of the arrays
+ * given to \ref processNewValues().
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename ValueType_ = double, typename CountIntType_ = int>
+class TOMOGRAPHER_EXPORT StreamingAutocorrelationAnalysis
+{
+public:
+  //! Type of the values we are analyzing
+  typedef ValueType_ ValueType;
+  //! Type used to count samples
+  typedef CountIntType_ CountIntType;
+  //! Array type, holding one entry per tracked value
+  typedef Eigen::Array<ValueType, Eigen::Dynamic, 1> ValueArrayType;
+
+private:
+
+  struct Level {
+    Level(Eigen::Index num_values)
+      : pending(ValueArrayType::Zero(num_values)), has_pending(false), count(0),
+        mean(ValueArrayType::Zero(num_values)), m2(ValueArrayType::Zero(num_values))
+    {
+    }
+    ValueArrayType pending;
+    bool has_pending;
+    CountIntType count;
+    ValueArrayType mean;
+    ValueArrayType m2;
+  };
+
+  const Eigen::Index num_values;
+  const CountIntType min_num_bins;
+  std::vector<Level> levels;
+  ValueArrayType tmp;
+
+public:
+
+  /** \brief Constructor
+   *
+   * \param num_values_ the number of values which are tracked in parallel
+   *
+   * \param min_num_bins_ the minimal number of bins at the binning level used for the
+   *        estimate.  Fewer bins give a noisier estimate, but allow to detect longer
+   *        autocorrelation times.
+   */
+  StreamingAutocorrelationAnalysis(Eigen::Index num_values_, CountIntType min_num_bins_ = 64)
+    : num_values(num_values_), min_num_bins(min_num_bins_), levels(), tmp(num_values_)
+  {
+    tomographer_assert(min_num_bins >= 2);
+  }
+
+  //! Forget all samples seen so far
+  inline void reset()
+  {
+    levels.clear();
+  }
+
+  //! The number of values tracked in parallel
+  inline Eigen::Index numTrackValues() const { return num_values; }
+
+  //! The number of samples processed so far
+  inline CountIntType numSamples() const { return levels.size() ? levels[0].count : 0; }
+
+  //! The number of binning levels so far, including the level of the raw samples
+  inline int numLevels() const { return (int)levels.size(); }
+
+  //! The minimal number of bins at the level used for the estimate
+  inline CountIntType minNumBins() const { return min_num_bins; }
+
+  //! Process a new sample, given as an array of \ref numTrackValues() values
+  template<typename Derived>
+  inline void processNewValues(const Eigen::ArrayBase<Derived> & values)
+  {
+    tomographer_assert(values.size() == num_values);
+    tmp = values;
+    for (std::size_t k = 0; ; ++k) {
+      if (k == levels.size()) {
+        levels.push_back(Level(num_values));
+      }
+      Level & L = levels[k];
+      ++L.count;
+      const ValueArrayType delta = tmp - L.mean;
+      L.mean += delta / ValueType(L.count);
+      L.m2 += delta * (tmp - L.mean);
+      if (!L.has_pending) {
+        L.pending = tmp;
+        L.has_pending = true;
+        return;
+      }
+      // second member of the pair: push the average up to the next level
+      tmp = (L.pending + tmp) / ValueType(2);
+      L.has_pending = false;
+    }
+  }
+
+  //! The mean of all samples processed so far
+  inline ValueArrayType mean() const
+  {
+    return levels.size() ? levels[0].mean : ValueArrayType::Zero(num_values);
+  }
+
+  //! The variance of the bin means at level \a k, i.e., of averages of \f$ 2^k \f$ samples
+  inline ValueArrayType binVariance(int k) const
+  {
+    tomographer_assert(k >= 0 && k < numLevels());
+    const Level & L = levels[(std::size_t)k];
+    if (L.count < 2) {
+      return ValueArrayType::Constant(num_values, std::numeric_limits<ValueType>::quiet_NaN());
+    }
+    return L.m2 / ValueType(L.count - 1);
+  }
+
+  /** \brief The estimate of the integrated autocorrelation time from binning level \a k
+   *
+   * The autocorrelation time is in units of samples.  If a value is constant, its
+   * autocorrelation time is reported as 1/2.
+   */
+  inline ValueArrayType tauIntAtLevel(int k) const
+  {
+    const ValueArrayType var0 = binVariance(0);
+    const ValueArrayType vark = binVariance(k);
+    ValueArrayType tau(num_values);
+    for (Eigen::Index i = 0; i < num_values; ++i) {
+      tau(i) = (var0(i) > 0)
+        ? std::ldexp(vark(i), k) / (2 * var0(i))
+        : ValueType(0.5);
+    }
+    return tau;
+  }
+
+  /** \brief The highest binning level which has at least \a minNumBins() bins, or -1 if
+   *         there aren't enough samples yet
+   */
+  inline int estimateLevel() const
+  {
+    int k = numLevels() - 1;
+    while (k >= 0 && levels[(std::size_t)k].count < min_num_bins) {
+      --k;
+    }
+    return k;
+  }
+
+  /** \brief The estimated integrated autocorrelation time of each value, in units of
+   *         samples
+   *
+   * Returns NaN's if there are not yet enough samples.
+   */
+  inline ValueArrayType tauInt() const
+  {
+    const int k = estimateLevel();
+    if (k < 0) {
+      return ValueArrayType::Constant(num_values, std::numeric_limits<ValueType>::quiet_NaN());
+    }
+    return tauIntAtLevel(k);
+  }
+
+  /** \brief Whether the estimated autocorrelation times seem to have converged
+   *
+   * This is the same criterion as \ref BinningAnalysis::determineErrorConvergence(), on
+   * the error bars \f$ \propto \sqrt{\tau_{\mathrm{int}}} \f$ given by the last levels
+   * before \a estimateLevel(): if the estimate still increases notably with the binning
+   * level, then the bins are not yet much longer than the autocorrelation time.
+   *
+   * \returns an array of \ref BINNING_CONVERGED, \ref BINNING_NOT_CONVERGED and \ref
+   * BINNING_UNKNOWN_CONVERGENCE values.
+   */
+  inline Eigen::ArrayXi determineConvergence() const
+  {
+    const int range = 4;
+    const int k = estimateLevel();
+    if (k < range - 1) {
+      return Eigen::ArrayXi::Constant(num_values, BINNING_UNKNOWN_CONVERGENCE);
+    }
+    Eigen::ArrayXi converged_status = Eigen::ArrayXi::Constant(num_values, BINNING_CONVERGED);
+    const ValueArrayType errors = tauIntAtLevel(k).sqrt();
+    for (int level = k + 1 - range; level < k; ++level) {
+      const ValueArrayType errors_thislevel = tauIntAtLevel(level).sqrt();
+      for (Eigen::Index i = 0; i < num_values; ++i) {
+        if (errors_thislevel(i) >= errors(i) && converged_status(i) != BINNING_NOT_CONVERGED) {
+          converged_status(i) = BINNING_CONVERGED;
+        } else if (errors_thislevel(i) < 0.824 * errors(i)) {
+          converged_status(i) = BINNING_NOT_CONVERGED;
+        } else if (errors_thislevel(i) < 0.9 * errors(i) && converged_status(i) != BINNING_NOT_CONVERGED) {
+          converged_status(i) = BINNING_UNKNOWN_CONVERGENCE;
+        }
+      }
+    }
+    return converged_status;
+  }
+};
+
+
+
+/** \brief Integrated autocorrelation times and effective sample sizes of values tracked
+ *         along a random walk
+ *
+ * The autocorrelation times are given in units of samples, i.e., of sweeps.  Two samples
+ * which are \f$ 2\tau_{\mathrm{int}} \f$ sweeps apart are approximately independent, and
+ * a sweep size which is \f$ 2\tau_{\mathrm{int}} \f$ times larger would give samples
+ * which are roughly uncorrelated.
+ *
+ * An invalid (empty) object is used if no autocorrelation analysis was carried out; see
+ * \ref isValid().
+ *
+ * \since Added in %Tomographer 5.5
+ */
+struct TOMOGRAPHER_EXPORT MHRWAutocorrelationResult
+{
+  //! Construct an invalid (empty) result
+  MHRWAutocorrelationResult()
+    : num_samples(0), labels(), mean(), tau_int(), ess(), converged_status()
+  {
+  }
+
+  //! Collect the results of an autocorrelation analysis
+  template<typename AnalysisType>
+  MHRWAutocorrelationResult(const AnalysisType & analysis, std::vector<std::string> labels_)
+    : num_samples((long)analysis.numSamples()),
+      labels(std::move(labels_)),
+      mean(analysis.mean().template cast<double>()),
+      tau_int(analysis.tauInt().template cast<double>()),
+      ess((double)num_samples / (2 * tau_int)),
+      converged_status(analysis.determineConvergence())
+  {
+    tomographer_assert((Eigen::Index)labels.size() == tau_int.size());
+  }
+
+  //! Number of samples which were analyzed
+  long num_samples;
+  //! A short description of each tracked value, e.g. "log-likelihood"
+  std::vector<std::string> labels;
+  //! The mean of each tracked value
+  Eigen::ArrayXd mean;
+  //! The integrated autocorrelation time of each tracked value, in units of samples
+  Eigen::ArrayXd tau_int;
+  //! The effective sample size of each tracked value
+  Eigen::ArrayXd ess;
+  //! Whether the autocorrelation time estimate has converged (see \ref StreamingAutocorrelationAnalysis::determineConvergence())
+  Eigen::ArrayXi converged_status;
+
+  //! Whether this object holds any results
+  inline bool isValid() const { return tau_int.size() > 0; }
+
+  //! Print a one-line summary of the autocorrelation times and effective sample sizes
+  inline void printSummary(std::ostream & stream) const
+  {
+    if (!isValid()) {
+      stream << "(no autocorrelation analysis)";
+      return;
+    }
+    for (Eigen::Index i = 0; i < tau_int.size(); ++i) {
+      if (i > 0) {
+        stream << "; ";
+      }
+      stream << labels[(std::size_t)i] << ": tau_int = "
+             << Tools::fmts("%.3g", tau_int(i))
+             << (converged_status(i) == BINNING_CONVERGED ? "" : "(?)")
+             << ", ESS = " << Tools::fmts("%.0f", ess(i));
+    }
+  }
+
+private:
+  friend boost::serialization::access;
+  template<typename Archive>
+  void serialize(Archive & a, unsigned int /* version */)
+  {
+    a & num_samples;
+    a & labels;
+    a & mean;
+    a & tau_int;
+    a & ess;
+    a & converged_status;
+  }
+};
+
+
+
+/** \brief A \ref pageInterfaceMHRWStatsCollector which estimates the integrated
+ *         autocorrelation time of the function value and of a figure of merit
+ *
+ * The value of the Metropolis-Hastings function at each sample (e.g. the log-likelihood,
+ * for \ref DenseDM::TSpace::LLHMHWalker) is always tracked; it comes for free from the
+ * random walk.  If \a ValueCalculator is not \c void and a value calculator is given to
+ * the constructor, then the value calculated by the given value calculator is tracked as
+ * well.  Note that this calculates the figure of merit a second time at each sample, in
+ * addition to e.g. a \ref ValueHistogramMHRWStatsCollector.  The estimate is carried out on the live samples with a \ref
+ * StreamingAutocorrelationAnalysis, i.e., in memory which only grows logarithmically
+ * with the number of samples; see \ref MHRWAutocorrelationResult for the meaning of the
+ * results.
+ *
+ * This collector provides a status line with the current estimates, which is included
+ * in the status reports of the random walk.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename ValueCalculator_ = void,
+         typename CountIntType_ = int,
+         typename LoggerType_ = Logger::VacuumLogger>
+class TOMOGRAPHER_EXPORT MHRWAutocorrelationStatsCollector
+{
+public:
+  //! The value calculator for the figure of merit, or \c void
+  typedef ValueCalculator_ ValueCalculator;
+  //! The type used to count samples
+  typedef CountIntType_ CountIntType;
+  //! The logger type
+  typedef LoggerType_ LoggerType;
+
+  //! Whether a figure of merit is tracked in addition to the function value
+  static constexpr bool HasValueCalculator = !std::is_void<ValueCalculator>::value;
+
+  //! The analysis type we use
+  typedef StreamingAutocorrelationAnalysis<double, CountIntType> AnalysisType;
+
+  //! The result type
+  typedef MHRWAutocorrelationResult ResultType;
+
+private:
+  // so that we can still declare the constructor which takes a value calculator
+  typedef typename std::conditional<HasValueCalculator, ValueCalculator, int>::type ValueCalculatorOrInt;
+
+  // points to a ValueCalculator object if HasValueCalculator, or is NULL
+  const ValueCalculatorOrInt * vcalc;
+
+  AnalysisType analysis;
+  typename AnalysisType::ValueArrayType values;
+
+  Logger::LocalLogger<LoggerType> llogger;
+
+public:
+
+  //! Constructor, tracking only the function value
+  TOMOGRAPHER_ENABLED_IF(!HasValueCalculator)
+  MHRWAutocorrelationStatsCollector(LoggerType & logger_, CountIntType min_num_bins = 64)
+    : vcalc(NULL),
+      analysis(1, min_num_bins),
+      values(1),
+      llogger("Tomographer::MHRWAutocorrelationStatsCollector", logger_)
+  {
+  }
+
+  //! Constructor, tracking the function value and the value calculated by \a vcalc_
+  TOMOGRAPHER_ENABLED_IF(HasValueCalculator)
+  MHRWAutocorrelationStatsCollector(const ValueCalculatorOrInt & vcalc_, LoggerType & logger_,
+                                    CountIntType min_num_bins = 64)
+    : vcalc(&vcalc_),
+      analysis(2, min_num_bins),
+      values(2),
+      llogger("Tomographer::MHRWAutocorrelationStatsCollector", logger_)
+  {
+  }
+
+  /** \brief Constructor, tracking the function value and, if \a vcalc_ is not \c NULL,
+   *         the value calculated by \a *vcalc_
+   */
+  TOMOGRAPHER_ENABLED_IF(HasValueCalculator)
+  MHRWAutocorrelationStatsCollector(const ValueCalculatorOrInt * vcalc_, LoggerType & logger_,
+                                    CountIntType min_num_bins = 64)
+    : vcalc(vcalc_),
+      analysis(vcalc_ != NULL ? 2 : 1, min_num_bins),
+      values(vcalc_ != NULL ? 2 : 1),
+      llogger("Tomographer::MHRWAutocorrelationStatsCollector", logger_)
+  {
+  }
+
+  //! Access the underlying analysis
+  inline const AnalysisType & getAnalysis() const { return analysis; }
+
+  //! Labels of the tracked values in the result
+  inline std::vector<std::string> labels() const
+  {
+    std::vector<std::string> l{"fn value"};
+    if (vcalc != NULL) {
+      l.push_back("fig. of merit");
+    }
+    return l;
+  }
+
+  //! Get the result of the analysis
+  inline ResultType getResult() const
+  {
+    return ResultType(analysis, labels());
+  }
+
+  //! Get the result of the analysis (there is nothing to steal, this is the same as getResult())
+  inline ResultType stealResult()
+  {
+    return getResult();
+  }
+
+  // stats collector callbacks
+
+  inline void init()
+  {
+    analysis.reset();
+  }
+  inline void thermalizingDone()
+  {
+  }
+  inline void done()
+  {
+    auto logger = llogger.subLogger(TOMO_ORIGIN);
+    logger.debug([&](std::ostream & stream) {
+        stream << "Autocorrelation: ";
+        getResult().printSummary(stream);
+      });
+  }
+
+  template<typename... Args>
+  inline void rawMove(Args && ...)
+  {
+  }
+
+  template<typename CountIntType2, typename PointType, typename FnValueType, typename MHRandomWalk>
+  inline void processSample(CountIntType2 /*k*/, CountIntType2 /*n*/, const PointType & curpt,
+                            FnValueType curptval, MHRandomWalk & rw)
+  {
+    values(0) = (double)curptval;
+    _fill_value(curpt, rw);
+    analysis.processNewValues(values);
+  }
+
+private:
+  template<typename PointType, typename MHRandomWalk, bool Enabled = HasValueCalculator,
+           TOMOGRAPHER_ENABLED_IF_TMPL(Enabled)>
+  inline void _fill_value(const PointType & curpt, const MHRandomWalk & rw)
+  {
+    if (vcalc != NULL) {
+      values(1) = (double)getValueAtCurrentPoint(*vcalc, curpt, rw);
+    }
+  }
+  template<typename PointType, typename MHRandomWalk, bool Enabled = HasValueCalculator,
+           TOMOGRAPHER_ENABLED_IF_TMPL(!Enabled)>
+  inline void _fill_value(const PointType & , const MHRandomWalk & )
+  {
+  }
+};
+template<typename ValueCalculator_, typename CountIntType_, typename LoggerType_>
+constexpr bool MHRWAutocorrelationStatsCollector<ValueCalculator_,CountIntType_,LoggerType_>::HasValueCalculator;
+
+
+
+namespace Tools {
+
+/** \brief Provide status reporting for a \ref MHRWAutocorrelationStatsCollector
+ *
+ */
+template<typename ValueCalculator_, typename CountIntType_, typename LoggerType_>
+struct TOMOGRAPHER_EXPORT StatusProvider<MHRWAutocorrelationStatsCollector<ValueCalculator_, CountIntType_, LoggerType_> >
+{
+  typedef MHRWAutocorrelationStatsCollector<ValueCalculator_, CountIntType_, LoggerType_> MHRWStatsCollector;
+
+  static constexpr bool CanProvideStatusLine = true;
+
+  static inline std::string getStatusLine(const MHRWStatsCollector * stats)
+  {
+    if (stats->getAnalysis().estimateLevel() < 0) {
+      return std::string();
+    }
+    std::ostringstream stream;
+    stream << "Autocorrelation: ";
+    stats->getResult().printSummary(stream);
+    return stream.str();
+  }
+};
+template<typename ValueCalculator_, typename CountIntType_, typename LoggerType_>
+constexpr bool
+StatusProvider<MHRWAutocorrelationStatsCollector<ValueCalculator_, CountIntType_, LoggerType_> >::CanProvideStatusLine;
+
+} // namespace Tools
+
+
+} // namespace Tomographer
+
+
+#endif
@@ -0,0 +1,812 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TOMOGRAPHER_MHRW_RESULTSFILE_H
+#define TOMOGRAPHER_MHRW_RESULTSFILE_H
+
+#include <cstdint>
+#include <cstring> // std::memcpy
+#include <limits>
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include <Eigen/Core>
+
+#include <tomographer/tools/cxxutil.h>
+#include <tomographer/mhrw.h>
+#include <tomographer/mhrw_valuehist_tools.h>
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(TOMOGRAPHER_RESULTSFILE_NO_MMAP)
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  define TOMOGRAPHER_RESULTSFILE_HAVE_MMAP
+#endif
+
+
+/** \file mhrw_resultsfile.h
+ *
+ * \brief Store the results of value histogram random walk tasks in a compact binary file.
+ *
+ * See \ref Tomographer::ResultsFileWriter, \ref Tomographer::ResultsFileReader and \ref
+ * Tomographer::writeValueHistogramResults().
+ */
+
+
+namespace Tomographer {
+
+
+/** \brief Error while writing or reading a results file
+ *
+ * \since Added in %Tomographer 5.5
+ */
+TOMOGRAPHER_DEFINE_MSG_EXCEPTION(ResultsFileError, "Results file error: ") ;
+
+
+/** \brief The kind of a record stored in a results file
+ *
+ * \since Added in %Tomographer 5.5
+ */
+enum ResultsFileRecordKind {
+  //! The result of a single random walk task
+  RESULTSFILE_TASK_RESULT = 1,
+  //! The histogram aggregated from all the tasks of a data set
+  RESULTSFILE_AGGREGATED_RESULT = 2
+};
+
+
+/** \brief The fixed-size fields of a record of a results file
+ *
+ * See \ref ResultsFileLayout for the file format.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+struct TOMOGRAPHER_EXPORT ResultsFileRecordInfo
+{
+  ResultsFileRecordInfo()
+    : kind(RESULTSFILE_TASK_RESULT), dataset_id(0), task_id(-1), num_bins(0), num_levels(0),
+      min(0), max(0), off_chart(0), acceptance_ratio(std::numeric_limits<double>::quiet_NaN()),
+      n_sweep(0), n_therm(0), n_run(0), step_size(std::numeric_limits<double>::quiet_NaN())
+  {
+  }
+
+  //! The kind of record, one of \ref ResultsFileRecordKind
+  std::uint32_t kind;
+  //! Identifies the data set the results belong to (e.g. the item of a batch)
+  std::int64_t dataset_id;
+  //! The index of the task, or -1 for an aggregated result
+  std::int64_t task_id;
+  //! The number of histogram bins
+  std::uint64_t num_bins;
+  //! The number of binning levels for which error bars are stored (zero if none)
+  std::uint64_t num_levels;
+  //! The lower end of the histogram range
+  double min;
+  //! The upper end of the histogram range
+  double max;
+  //! The off-chart count of the histogram
+  double off_chart;
+  //! The acceptance ratio of the random walk (averaged over the tasks for an aggregated result)
+  double acceptance_ratio;
+  //! The number of iterations per sweep
+  std::int64_t n_sweep;
+  //! The number of thermalization sweeps
+  std::int64_t n_therm;
+  //! The number of live sweeps
+  std::int64_t n_run;
+  //! The step size of the random walk (NaN if the walker isn't parameterized by a step size)
+  double step_size;
+};
+
+
+/** \brief Layout of a results file
+ *
+ * A results file starts with a header of \ref HeaderSize bytes: the 8 characters
+ * <code>TOMORSLT</code>, followed by the format version as a 32-bit unsigned integer
+ * (currently \ref FormatVersion) and four zero bytes.
+ *
+ * The header is followed by any number of records.  Each record starts with \ref
+ * RecordHeaderSize bytes:
+ *
+ * | Offset | Type    | Field                                                            |
+ * |--------|---------|------------------------------------------------------------------|
+ * |      0 | char[4] | the characters <code>RSLT</code>                                 |
+ * |      4 | uint32  | \a kind, see \ref ResultsFileRecordKind                          |
+ * |      8 | uint64  | size of the full record in bytes (a multiple of eight)           |
+ * |     16 | int64   | \a dataset_id                                                    |
+ * |     24 | int64   | \a task_id                                                       |
+ * |     32 | uint64  | \a num_bins                                                      |
+ * |     40 | uint64  | \a num_levels                                                    |
+ * |     48 | uint64  | size of the label in bytes                                       |
+ * |     56 | double  | \a min                                                           |
+ * |     64 | double  | \a max                                                           |
+ * |     72 | double  | \a off_chart                                                     |
+ * |     80 | double  | \a acceptance_ratio                                              |
+ * |     88 | int64   | \a n_sweep                                                       |
+ * |     96 | int64   | \a n_therm                                                       |
+ * |    104 | int64   | \a n_run                                                         |
+ * |    112 | double  | \a step_size                                                     |
+ * |    120 | uint64  | reserved (zero)                                                  |
+ *
+ * (see \ref ResultsFileRecordInfo), and continues with, in this order:
+ *
+ *   - the label (e.g. the name of the data file), zero-padded to a multiple of eight bytes;
+ *   - the histogram bin values, \a num_bins doubles;
+ *   - the histogram error bars, \a num_bins doubles (zero if the histogram has no error
+ *     bars);
+ *   - the error bars at each binning level, \a num_bins times \a num_levels doubles, stored
+ *     level after level (i.e. column-major, as an Eigen matrix with one row per bin);
+ *   - the binning analysis convergence status of each bin (see \ref BinningConvergence),
+ *     \a num_bins 32-bit integers if \a num_levels is nonzero, zero-padded to a multiple
+ *     of eight bytes.
+ *
+ * All numbers are stored in native byte order.  All the arrays are aligned to eight
+ * bytes relative to the start of the file, so that they can be accessed in place when
+ * the file is memory-mapped.  New records can be appended at any time; a reader ignores
+ * an incomplete record at the end of the file (e.g. if the writing process was
+ * interrupted), and a writer truncates the file to its last complete record before
+ * appending new ones.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+struct TOMOGRAPHER_EXPORT ResultsFileLayout
+{
+  //! The size of the file header, in bytes
+  static constexpr std::size_t HeaderSize = 16;
+  //! The size of the fixed-size fields of each record, in bytes
+  static constexpr std::size_t RecordHeaderSize = 128;
+  //! The version of the file format written by this code
+  static constexpr std::uint32_t FormatVersion = 1;
+
+  //! Round up \a n to a multiple of eight
+  static inline std::size_t padded(std::size_t n)
+  {
+    return (n + 7) & ~std::size_t(7);
+  }
+
+  //! Offset of the bin values from the start of the record
+  static inline std::size_t binsOffset(std::size_t label_size)
+  {
+    return RecordHeaderSize + padded(label_size);
+  }
+  //! Offset of the error bars from the start of the record
+  static inline std::size_t deltaOffset(const ResultsFileRecordInfo & info, std::size_t label_size)
+  {
+    return binsOffset(label_size) + 8*(std::size_t)info.num_bins;
+  }
+  //! Offset of the error bars at each binning level from the start of the record
+  static inline std::size_t errorLevelsOffset(const ResultsFileRecordInfo & info, std::size_t label_size)
+  {
+    return deltaOffset(info, label_size) + 8*(std::size_t)info.num_bins;
+  }
+  //! Offset of the convergence status from the start of the record
+  static inline std::size_t convergedStatusOffset(const ResultsFileRecordInfo & info, std::size_t label_size)
+  {
+    return errorLevelsOffset(info, label_size) + 8*(std::size_t)(info.num_bins*info.num_levels);
+  }
+  //! The total size of a record
+  static inline std::size_t recordSize(const ResultsFileRecordInfo & info, std::size_t label_size)
+  {
+    return convergedStatusOffset(info, label_size)
+      + (info.num_levels > 0 ? padded(4*(std::size_t)info.num_bins) : 0);
+  }
+
+  //! Write the file header
+  static inline void writeHeader(std::ostream & stream)
+  {
+    char header[HeaderSize];
+    std::memcpy(header, "TOMORSLT", 8);
+    const std::uint32_t version = FormatVersion;
+    std::memcpy(header + 8, &version, 4);
+    std::memset(header + 12, 0, 4);
+    stream.write(header, HeaderSize);
+  }
+
+  /** \brief Check the file header in the memory pointed to by \a src
+   *
+   * \a size is the number of bytes available at \a src.  Throws \ref ResultsFileError if
+   * the header is invalid.
+   */
+  static inline void checkHeader(const char * src, std::size_t size)
+  {
+    if (size < HeaderSize || std::memcmp(src, "TOMORSLT", 8) != 0) {
+      throw ResultsFileError("Not a results file");
+    }
+    std::uint32_t version;
+    std::memcpy(&version, src + 8, 4);
+    if (version != FormatVersion) {
+      throw ResultsFileError(streamstr("Unsupported file format version " << version));
+    }
+  }
+
+  //! Encode the fixed-size fields of a record into \a dest (\ref RecordHeaderSize bytes)
+  static inline void encodeRecordHeader(char * dest, const ResultsFileRecordInfo & info,
+                                        std::size_t label_size)
+  {
+    const std::uint64_t recsize = recordSize(info, label_size);
+    const std::uint64_t labelsize = label_size;
+    std::memset(dest, 0, RecordHeaderSize);
+    std::memcpy(dest, "RSLT", 4);
+    std::memcpy(dest + 4, &info.kind, 4);
+    std::memcpy(dest + 8, &recsize, 8);
+    std::memcpy(dest + 16, &info.dataset_id, 8);
+    std::memcpy(dest + 24, &info.task_id, 8);
+    std::memcpy(dest + 32, &info.num_bins, 8);
+    std::memcpy(dest + 40, &info.num_levels, 8);
+    std::memcpy(dest + 48, &labelsize, 8);
+    std::memcpy(dest + 56, &info.min, 8);
+    std::memcpy(dest + 64, &info.max, 8);
+    std::memcpy(dest + 72, &info.off_chart, 8);
+    std::memcpy(dest + 80, &info.acceptance_ratio, 8);
+    std::memcpy(dest + 88, &info.n_sweep, 8);
+    std::memcpy(dest + 96, &info.n_therm, 8);
+    std::memcpy(dest + 104, &info.n_run, 8);
+    std::memcpy(dest + 112, &info.step_size, 8);
+  }
+
+  /** \brief Decode the fixed-size fields of a record from \a src
+   *
+   * Returns the total size of the record, and stores the size of the label in \a
+   * label_size.  Throws \ref ResultsFileError if the record is invalid.
+   */
+  static inline std::size_t decodeRecordHeader(const char * src, ResultsFileRecordInfo & info,
+                                               std::size_t & label_size)
+  {
+    if (std::memcmp(src, "RSLT", 4) != 0) {
+      throw ResultsFileError("Invalid record");
+    }
+    std::uint64_t recsize, labelsize;
+    std::memcpy(&info.kind, src + 4, 4);
+    std::memcpy(&recsize, src + 8, 8);
+    std::memcpy(&info.dataset_id, src + 16, 8);
+    std::memcpy(&info.task_id, src + 24, 8);
+    std::memcpy(&info.num_bins, src + 32, 8);
+    std::memcpy(&info.num_levels, src + 40, 8);
+    std::memcpy(&labelsize, src + 48, 8);
+    std::memcpy(&info.min, src + 56, 8);
+    std::memcpy(&info.max, src + 64, 8);
+    std::memcpy(&info.off_chart, src + 72, 8);
+    std::memcpy(&info.acceptance_ratio, src + 80, 8);
+    std::memcpy(&info.n_sweep, src + 88, 8);
+    std::memcpy(&info.n_therm, src + 96, 8);
+    std::memcpy(&info.n_run, src + 104, 8);
+    std::memcpy(&info.step_size, src + 112, 8);
+    label_size = (std::size_t)labelsize;
+    if (recsize != recordSize(info, label_size)) {
+      throw ResultsFileError("Inconsistent record size");
+    }
+    return (std::size_t)recsize;
+  }
+};
+
+
+
+/** \brief Append records to a results file
+ *
+ * The file is opened in append mode: if it already exists, the new records are added
+ * after the existing ones (this way, the results of many runs can be streamed into a
+ * single file); otherwise it is created.  If the existing file ends with an incomplete
+ * record (e.g. because a previous writing process was interrupted), that record is first
+ * removed from the file.  Each record is written to the file with a single
+ * call, and the file is flushed after each record.
+ *
+ * See \ref ResultsFileLayout for the file format, and \ref writeValueHistogramResults()
+ * for writing the results of value histogram random walk tasks.
+ *
+ * A results file should not be written to by several writers at the same time.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+class TOMOGRAPHER_EXPORT ResultsFileWriter
+{
+public:
+  /** \brief Open the file \a filename for appending records
+   *
+   * Throws \ref ResultsFileError if the file can't be opened, or if it exists and is not a
+   * results file.
+   */
+  ResultsFileWriter(const std::string & filename)
+    : _filename(filename), _num_records(0)
+  {
+    std::uint64_t existing_size = 0;
+    {
+      std::ifstream inf(filename, std::ios::in | std::ios::binary);
+      if (inf) {
+        char header[ResultsFileLayout::HeaderSize];
+        inf.read(header, ResultsFileLayout::HeaderSize);
+        existing_size = (std::uint64_t)inf.gcount();
+        if (existing_size > 0) {
+          ResultsFileLayout::checkHeader(header, (std::size_t)existing_size);
+          inf.clear();
+          inf.seekg(0, std::ios::end);
+          existing_size = (std::uint64_t)inf.tellg();
+          const std::uint64_t valid_size = _find_end_of_records(inf, existing_size);
+          inf.close();
+          if (valid_size < existing_size) {
+            // the last record was not completely written (e.g. the writing process was
+            // interrupted); drop it so that the new records are appended after the last
+            // complete one
+            _truncate_file(filename, valid_size);
+          }
+        }
+      }
+    }
+    _stream.open(filename, std::ios::out | std::ios::binary | std::ios::app);
+    if (!_stream) {
+      throw ResultsFileError("Can't open file " + filename + " for writing");
+    }
+    if (existing_size == 0) {
+      ResultsFileLayout::writeHeader(_stream);
+      _stream.flush();
+    }
+  }
+
+  //! The number of records written by this writer so far
+  inline std::uint64_t numRecordsWritten() const
+  {
+    return _num_records;
+  }
+
+  /** \brief Append a record to the file
+   *
+   * The arrays \a bins and \a delta must have \a info.num_bins items, \a error_levels must
+   * be a matrix of \a info.num_bins rows and \a info.num_levels columns, and \a
+   * converged_status must have \a info.num_bins items if \a info.num_levels is nonzero
+   * (otherwise it is ignored).  If the histogram has no error bars, pass an empty \a delta
+   * and the error bars are stored as zeros.
+   *
+   * Throws \ref ResultsFileError if writing to the file failed.
+   */
+  template<typename BinsType, typename DeltaType, typename ErrorLevelsType, typename ConvergedStatusType>
+  inline void writeRecord(const ResultsFileRecordInfo & info, const std::string & label,
+                          const Eigen::DenseBase<BinsType> & bins, const Eigen::DenseBase<DeltaType> & delta,
+                          const Eigen::DenseBase<ErrorLevelsType> & error_levels,
+                          const Eigen::DenseBase<ConvergedStatusType> & converged_status)
+  {
+    const Eigen::Index nb = (Eigen::Index)info.num_bins;
+    const Eigen::Index nl = (Eigen::Index)info.num_levels;
+    tomographer_assert(bins.size() == nb);
+    tomographer_assert(delta.size() == nb || delta.size() == 0);
+    tomographer_assert(nl == 0 || (error_levels.rows() == nb && error_levels.cols() == nl));
+    tomographer_assert(nl == 0 || converged_status.size() == nb);
+
+    // the buffer is zero-initialized, which takes care of the padding
+    _buffer.assign(ResultsFileLayout::recordSize(info, label.size()), 0);
+    char * rec = _buffer.data();
+    ResultsFileLayout::encodeRecordHeader(rec, info, label.size());
+    std::memcpy(rec + ResultsFileLayout::RecordHeaderSize, label.data(), label.size());
+
+    typedef Eigen::Map<Eigen::ArrayXd> DoubleMap;
+    DoubleMap(_double_ptr(rec + ResultsFileLayout::binsOffset(label.size())), nb)
+      = bins.derived().template cast<double>();
+    if (delta.size() == nb) {
+      DoubleMap(_double_ptr(rec + ResultsFileLayout::deltaOffset(info, label.size())), nb)
+        = delta.derived().template cast<double>();
+    }
+    if (nl > 0) {
+      Eigen::Map<Eigen::ArrayXXd>(_double_ptr(rec + ResultsFileLayout::errorLevelsOffset(info, label.size())),
+                                  nb, nl)
+        = error_levels.derived().template cast<double>();
+      char * cs = rec + ResultsFileLayout::convergedStatusOffset(info, label.size());
+      for (Eigen::Index k = 0; k < nb; ++k) {
+        const std::int32_t s = (std::int32_t)converged_status(k);
+        std::memcpy(cs + 4*k, &s, 4);
+      }
+    }
+
+    _stream.write(_buffer.data(), (std::streamsize)_buffer.size());
+    _stream.flush();
+    if (!_stream) {
+      throw ResultsFileError("Failed to write to file " + _filename);
+    }
+    ++_num_records;
+  }
+
+private:
+  // Return the end offset of the last complete record of the file.  Scanning stops at the
+  // first record which is incomplete or whose header is invalid.
+  static inline std::uint64_t _find_end_of_records(std::istream & inf, std::uint64_t size)
+  {
+    std::uint64_t offset = ResultsFileLayout::HeaderSize;
+    char rechdr[ResultsFileLayout::RecordHeaderSize];
+    while (offset + ResultsFileLayout::RecordHeaderSize <= size) {
+      inf.seekg((std::streamoff)offset);
+      inf.read(rechdr, ResultsFileLayout::RecordHeaderSize);
+      if (!inf) {
+        break;
+      }
+      ResultsFileRecordInfo info;
+      std::size_t label_size;
+      std::uint64_t recsize;
+      try {
+        recsize = ResultsFileLayout::decodeRecordHeader(rechdr, info, label_size);
+      } catch (const ResultsFileError & ) {
+        break;
+      }
+      if (offset + recsize > size) {
+        break;
+      }
+      offset += recsize;
+    }
+    return offset;
+  }
+
+  static inline void _truncate_file(const std::string & filename, std::uint64_t size)
+  {
+#ifdef TOMOGRAPHER_RESULTSFILE_HAVE_MMAP
+    if (::truncate(filename.c_str(), (off_t)size) != 0) {
+      throw ResultsFileError("Can't truncate incomplete record at end of file " + filename);
+    }
+#else
+    std::vector<char> contents((std::size_t)size);
+    {
+      std::ifstream inf(filename, std::ios::in | std::ios::binary);
+      inf.read(contents.data(), (std::streamsize)size);
+      if (!inf) {
+        throw ResultsFileError("Can't read file " + filename);
+      }
+    }
+    std::ofstream outf(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    outf.write(contents.data(), (std::streamsize)size);
+    if (!outf) {
+      throw ResultsFileError("Can't truncate incomplete record at end of file " + filename);
+    }
+#endif
+  }
+
+  // the buffer comes from std::vector<char>, whose memory is suitably aligned for doubles,
+  // and all offsets are multiples of eight
+  static inline double * _double_ptr(char * p)
+  {
+    return reinterpret_cast<double*>(p);
+  }
+
+  const std::string _filename;
+  std::ofstream _stream;
+  std::vector<char> _buffer;
+  std::uint64_t _num_records;
+};
+
+
+
+/** \brief A record of a results file, accessed in place
+ *
+ * The arrays are Eigen maps which point directly into the memory of the \ref
+ * ResultsFileReader which returned this record, and remain valid as long as that reader
+ * exists.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+struct TOMOGRAPHER_EXPORT ResultsFileRecordView
+{
+  typedef Eigen::Map<const Eigen::ArrayXd> ArrayMapType;
+  typedef Eigen::Map<const Eigen::ArrayXXd> ArrayXXMapType;
+  typedef Eigen::Map<const Eigen::Array<std::int32_t, Eigen::Dynamic, 1> > StatusMapType;
+
+  ResultsFileRecordView(const ResultsFileRecordInfo & info_, std::string label_, const char * rec)
+    : info(info_),
+      label(std::move(label_)),
+      bins(_double_ptr(rec + ResultsFileLayout::binsOffset(label.size())), (Eigen::Index)info.num_bins),
+      delta(_double_ptr(rec + ResultsFileLayout::deltaOffset(info, label.size())), (Eigen::Index)info.num_bins),
+      error_levels(_double_ptr(rec + ResultsFileLayout::errorLevelsOffset(info, label.size())),
+                   (Eigen::Index)info.num_bins, (Eigen::Index)info.num_levels),
+      converged_status(reinterpret_cast<const std::int32_t*>(
+                           rec + ResultsFileLayout::convergedStatusOffset(info, label.size())),
+                       info.num_levels > 0 ? (Eigen::Index)info.num_bins : 0)
+  {
+  }
+
+  //! The fixed-size fields of the record
+  ResultsFileRecordInfo info;
+  //! The label of the record
+  std::string label;
+  //! The histogram bin values
+  ArrayMapType bins;
+  //! The histogram error bars
+  ArrayMapType delta;
+  //! The error bars at each binning level, one row per bin and one column per level
+  ArrayXXMapType error_levels;
+  //! The convergence status of each bin (empty if there is no binning analysis)
+  StatusMapType converged_status;
+
+  //! Whether this record is the result of a single task
+  inline bool isTaskResult() const { return info.kind == RESULTSFILE_TASK_RESULT; }
+  //! Whether this record is an aggregated result
+  inline bool isAggregatedResult() const { return info.kind == RESULTSFILE_AGGREGATED_RESULT; }
+
+  //! Return a copy of the histogram stored in this record
+  template<typename Scalar = double, typename CountType = double>
+  inline HistogramWithErrorBars<Scalar, CountType> histogram() const
+  {
+    HistogramWithErrorBars<Scalar, CountType> h((Scalar)info.min, (Scalar)info.max, (Eigen::Index)info.num_bins);
+    h.load(bins.template cast<CountType>(), delta.template cast<CountType>(), (CountType)info.off_chart);
+    return h;
+  }
+
+private:
+  static inline const double * _double_ptr(const char * p)
+  {
+    return reinterpret_cast<const double*>(p);
+  }
+};
+
+
+
+/** \brief Read the records of a results file
+ *
+ * The whole file is memory-mapped (on systems which support \a mmap(); otherwise it is
+ * read into memory), and the records are accessed in place, without copying the stored
+ * arrays (see \ref ResultsFileRecordView).
+ *
+ * See \ref ResultsFileLayout for the file format.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+class TOMOGRAPHER_EXPORT ResultsFileReader
+{
+public:
+  /** \brief Open and map the file \a filename, and index its records
+   *
+   * Throws \ref ResultsFileError if the file can't be opened or is not a valid results
+   * file.
+   */
+  ResultsFileReader(const std::string & filename)
+    : _data(NULL), _size(0)
+  {
+    _map_file(filename);
+    try {
+      ResultsFileLayout::checkHeader(_data, _size);
+      _index_records();
+    } catch (...) {
+      _unmap_file();
+      throw;
+    }
+  }
+
+  ~ResultsFileReader()
+  {
+    _unmap_file();
+  }
+
+  ResultsFileReader(const ResultsFileReader & ) = delete;
+  ResultsFileReader & operator=(const ResultsFileReader & ) = delete;
+
+  //! The number of (complete) records stored in the file
+  inline std::size_t numRecords() const
+  {
+    return _offsets.size();
+  }
+
+  //! Access the record number \a i
+  inline ResultsFileRecordView record(std::size_t i) const
+  {
+    tomographer_assert(i < _offsets.size());
+    const char * rec = _data + _offsets[i];
+    ResultsFileRecordInfo info;
+    std::size_t label_size;
+    ResultsFileLayout::decodeRecordHeader(rec, info, label_size);
+    return ResultsFileRecordView(info, std::string(rec + ResultsFileLayout::RecordHeaderSize, label_size), rec);
+  }
+
+private:
+  inline void _index_records()
+  {
+    std::size_t offset = ResultsFileLayout::HeaderSize;
+    while (offset + ResultsFileLayout::RecordHeaderSize <= _size) {
+      ResultsFileRecordInfo info;
+      std::size_t label_size;
+      const std::size_t recsize = ResultsFileLayout::decodeRecordHeader(_data + offset, info, label_size);
+      if (offset + recsize > _size) {
+        // incomplete last record
+        break;
+      }
+      _offsets.push_back(offset);
+      offset += recsize;
+    }
+  }
+
+#ifdef TOMOGRAPHER_RESULTSFILE_HAVE_MMAP
+  inline void _map_file(const std::string & filename)
+  {
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw ResultsFileError("Can't open file " + filename + " for reading");
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw ResultsFileError("Can't determine size of file " + filename);
+    }
+    _size = (std::size_t)st.st_size;
+    if (_size > 0) {
+      void * p = ::mmap(NULL, _size, PROT_READ, MAP_SHARED, fd, 0);
+      if (p == MAP_FAILED) {
+        ::close(fd);
+        throw ResultsFileError("Can't map file " + filename + " into memory");
+      }
+      _data = static_cast<const char*>(p);
+    }
+    ::close(fd); // the mapping stays valid
+  }
+  inline void _unmap_file()
+  {
+    if (_data != NULL) {
+      ::munmap(const_cast<char*>(_data), _size);
+      _data = NULL;
+    }
+  }
+#else
+  inline void _map_file(const std::string & filename)
+  {
+    std::ifstream inf(filename, std::ios::in | std::ios::binary);
+    if (!inf) {
+      throw ResultsFileError("Can't open file " + filename + " for reading");
+    }
+    inf.seekg(0, std::ios::end);
+    _size = (std::size_t)inf.tellg();
+    inf.seekg(0, std::ios::beg);
+    // use doubles as storage, to ensure that the arrays are suitably aligned
+    _storage.resize((_size + 7) / 8);
+    inf.read(reinterpret_cast<char*>(_storage.data()), (std::streamsize)_size);
+    if (!inf) {
+      throw ResultsFileError("Can't read file " + filename);
+    }
+    _data = reinterpret_cast<const char*>(_storage.data());
+  }
+  inline void _unmap_file()
+  {
+    _data = NULL;
+  }
+  std::vector<double> _storage;
+#endif
+
+  const char * _data;
+  std::size_t _size;
+  std::vector<std::size_t> _offsets;
+};
+
+
+
+
+namespace tomo_internal {
+
+template<typename MHWalkerParams>
+inline double resultsfile_step_size(const MHWalkerParams & )
+{
+  return std::numeric_limits<double>::quiet_NaN();
+}
+template<typename StepRealType>
+inline double resultsfile_step_size(const MHWalkerParamsStepSize<StepRealType> & p)
+{
+  return (double)p.step_size;
+}
+
+template<typename MHRWParamsType>
+inline void resultsfile_set_mhrw_params(ResultsFileRecordInfo & info, const MHRWParamsType & p)
+{
+  info.n_sweep = (std::int64_t)p.n_sweep;
+  info.n_therm = (std::int64_t)p.n_therm;
+  info.n_run = (std::int64_t)p.n_run;
+  info.step_size = resultsfile_step_size(p.mhwalker_params);
+}
+
+// version WITH binning analysis
+template<typename HistogramType, typename BinningAnalysisParamsType>
+inline void resultsfile_write_task_stats(
+    ResultsFileWriter & writer, ResultsFileRecordInfo & info, const std::string & label,
+    const ValueHistogramWithBinningMHRWStatsCollectorResult<HistogramType,BinningAnalysisParamsType> & r)
+{
+  const auto & h = r.histogram;
+  info.num_bins = (std::uint64_t)h.numBins();
+  info.num_levels = (std::uint64_t)r.error_levels.cols();
+  info.min = (double)h.params.min;
+  info.max = (double)h.params.max;
+  info.off_chart = (double)h.off_chart;
+  writer.writeRecord(info, label, h.bins, h.delta, r.error_levels, r.converged_status);
+}
+// version WITHOUT binning analysis
+template<typename RawHistogramType, typename ScaledHistogramType>
+inline void resultsfile_write_task_stats(
+    ResultsFileWriter & writer, ResultsFileRecordInfo & info, const std::string & label,
+    const MHRWTasks::ValueHistogramTools::MHRWStatsResultsBaseSimple<RawHistogramType,ScaledHistogramType> & r)
+{
+  const auto & h = r.histogram;
+  info.num_bins = (std::uint64_t)h.numBins();
+  info.num_levels = 0;
+  info.min = (double)h.params.min;
+  info.max = (double)h.params.max;
+  info.off_chart = (double)h.off_chart;
+  writer.writeRecord(info, label, h.bins, Eigen::ArrayXd(), Eigen::ArrayXXd(0, 0), Eigen::ArrayXi());
+}
+
+} // namespace tomo_internal
+
+
+/** \brief Append the results of the value histogram random walk tasks of a data set to a
+ *         results file
+ *
+ * One record is written for each task result in \a task_results (see \ref
+ * MHRWTasks::MHRandomWalkTaskResult), followed by a record for the \a aggregated
+ * histogram (an \ref AggregatedHistogramSimple or \ref AggregatedHistogramWithErrorBars,
+ * e.g. obtained with \ref MHRWTasks::ValueHistogramTools::CDataBase::aggregateResultHistograms()).
+ * The random walk parameters of the aggregated record are taken from the \a cdata, and
+ * its acceptance ratio is the average of those of the tasks.
+ *
+ * The task results must be those of a \ref MHRWTasks::ValueHistogramTools::CDataBase, or
+ * of a class whose \a MHRWStatsResults derive from \ref
+ * MHRWTasks::ValueHistogramTools::CDataBase::MHRWStatsResultsBaseType.
+ *
+ * All records are given the same \a dataset_id and \a label, which identify the data set
+ * in a file holding the results of many runs.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename CDataType, typename TaskResultPtrType, typename AggregatedHistogramType>
+inline void writeValueHistogramResults(ResultsFileWriter & writer, std::int64_t dataset_id,
+                                       const std::string & label, const CDataType & cdata,
+                                       const std::vector<TaskResultPtrType> & task_results,
+                                       const AggregatedHistogramType & aggregated)
+{
+  double acceptance_ratio_sum = 0;
+  for (std::size_t k = 0; k < task_results.size(); ++k) {
+    const auto & r = *task_results[k];
+    ResultsFileRecordInfo info;
+    info.kind = RESULTSFILE_TASK_RESULT;
+    info.dataset_id = dataset_id;
+    info.task_id = (std::int64_t)k;
+    info.acceptance_ratio = r.acceptance_ratio;
+    tomo_internal::resultsfile_set_mhrw_params(info, r.mhrw_params);
+    tomo_internal::resultsfile_write_task_stats(writer, info, label, r.stats_results);
+    acceptance_ratio_sum += r.acceptance_ratio;
+  }
+
+  const auto & h = aggregated.final_histogram;
+  ResultsFileRecordInfo info;
+  info.kind = RESULTSFILE_AGGREGATED_RESULT;
+  info.dataset_id = dataset_id;
+  info.task_id = -1;
+  info.num_bins = (std::uint64_t)h.numBins();
+  info.num_levels = 0;
+  info.min = (double)h.params.min;
+  info.max = (double)h.params.max;
+  info.off_chart = (double)h.off_chart;
+  if (task_results.size()) {
+    info.acceptance_ratio = acceptance_ratio_sum / task_results.size();
+  }
+  tomo_internal::resultsfile_set_mhrw_params(info, cdata.mhrw_params);
+  writer.writeRecord(info, label, h.bins, h.delta, Eigen::ArrayXXd(0, 0), Eigen::ArrayXi());
+}
+
+
+
+} // namespace Tomographer
+
+
+
+#endif
@@ -0,0 +1,635 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TOMOGRAPHER_MHRW_SAMPLESTREAM_H
+#define TOMOGRAPHER_MHRW_SAMPLESTREAM_H
+
+#include <cstdint>
+#include <cstring> // std::memcpy
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+
+#include <Eigen/Core>
+
+#include <tomographer/tools/cxxutil.h>
+#include <tomographer/tools/loggers.h>
+#include <tomographer/valuecalculator.h> // getValuesAtCurrentPoint()
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+// see comment in multiprocthreads.h
+#ifdef TOMOGRAPHER_USE_MINGW_STD_THREAD
+#  include <mingw.thread.h>
+#  include <mingw.mutex.h>
+#  include <mingw.condition_variable.h>
+#endif
+
+
+/** \file mhrw_samplestream.h
+ *
+ * \brief Write the samples of a random walk to a binary file, and read them back.
+ *
+ * See \ref Tomographer::SampleStreamMHRWStatsCollector, \ref
+ * Tomographer::SampleStreamWriter and \ref Tomographer::SampleStreamReader.
+ */
+
+
+namespace Tomographer {
+
+
+/** \brief Error while writing or reading a sample stream file
+ *
+ * \since Added in %Tomographer 5.5
+ */
+TOMOGRAPHER_DEFINE_MSG_EXCEPTION(SampleStreamError, "Sample stream error: ") ;
+
+
+/** \brief Layout of the records of a sample stream file
+ *
+ * A sample stream file starts with a header of \ref HeaderSize bytes:
+ *
+ *   - the 8 characters <code>TOMOSMPL</code>;
+ *   - the format version, as a 32-bit unsigned integer (currently \ref FormatVersion);
+ *   - the size in bytes of each stored value, as a 32-bit unsigned integer (4 for single
+ *     precision, 8 for double precision floating-point values);
+ *   - the number of values stored for each sample, as a 64-bit unsigned integer;
+ *   - the size of each record in bytes, as a 64-bit unsigned integer.
+ *
+ * The header is followed by records of fixed size \ref recordSize(), one per sample:
+ *
+ *   - the task ID, as a 32-bit signed integer;
+ *   - four padding bytes (zero);
+ *   - the value of the random walk function at the sample (e.g. the log-likelihood), as a
+ *     double precision floating-point value;
+ *   - the \ref num_values values which describe the sample point, in single or double
+ *     precision as specified by \ref value_bytes.
+ *
+ * All numbers are stored in native byte order.  Since all records have the same size, the
+ * file can be memory-mapped directly, e.g. with \a numpy.memmap.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+struct TOMOGRAPHER_EXPORT SampleStreamLayout
+{
+  //! The size of the file header, in bytes
+  static constexpr std::size_t HeaderSize = 32;
+  //! The size of the fields preceding the values in each record, in bytes
+  static constexpr std::size_t RecordPrefixSize = 16;
+  //! The version of the file format written by this code
+  static constexpr std::uint32_t FormatVersion = 1;
+
+  //! Constructor
+  SampleStreamLayout(std::uint64_t num_values_ = 0, std::uint32_t value_bytes_ = 8)
+    : num_values(num_values_), value_bytes(value_bytes_)
+  {
+    if (value_bytes != 4 && value_bytes != 8) {
+      throw SampleStreamError(streamstr("Invalid value size " << value_bytes << ", expected 4 or 8"));
+    }
+  }
+
+  //! The number of values stored for each sample
+  std::uint64_t num_values;
+  //! The size of each stored value in bytes, 4 (\a float) or 8 (\a double)
+  std::uint32_t value_bytes;
+
+  //! The size of a single record, in bytes
+  inline std::size_t recordSize() const
+  {
+    return RecordPrefixSize + (std::size_t)value_bytes * (std::size_t)num_values;
+  }
+
+  /** \brief Encode a single record into the memory pointed to by \a dest
+   *
+   * \a dest must point to at least \ref recordSize() bytes.
+   */
+  template<typename Derived>
+  inline void encodeRecord(char * dest, int task_id, double fnval,
+                           const Eigen::DenseBase<Derived> & values) const
+  {
+    tomographer_assert((std::uint64_t)values.size() == num_values);
+    const std::int32_t tid = (std::int32_t)task_id;
+    std::memcpy(dest, &tid, 4);
+    std::memset(dest + 4, 0, 4);
+    std::memcpy(dest + 8, &fnval, 8);
+    char * p = dest + RecordPrefixSize;
+    for (Eigen::Index j = 0; j < values.size(); ++j) {
+      if (value_bytes == 4) {
+        const float v = (float)values(j);
+        std::memcpy(p, &v, 4);
+      } else {
+        const double v = (double)values(j);
+        std::memcpy(p, &v, 8);
+      }
+      p += value_bytes;
+    }
+  }
+
+  /** \brief Decode a single record from the memory pointed to by \a src
+   *
+   * The values are stored into \a values, which is resized if necessary.
+   */
+  template<typename Derived>
+  inline void decodeRecord(const char * src, int & task_id, double & fnval,
+                           Eigen::PlainObjectBase<Derived> & values) const
+  {
+    std::int32_t tid;
+    std::memcpy(&tid, src, 4);
+    task_id = (int)tid;
+    std::memcpy(&fnval, src + 8, 8);
+    values.resize((Eigen::Index)num_values, 1);
+    const char * p = src + RecordPrefixSize;
+    for (Eigen::Index j = 0; j < (Eigen::Index)num_values; ++j) {
+      if (value_bytes == 4) {
+        float v;
+        std::memcpy(&v, p, 4);
+        values(j) = v;
+      } else {
+        double v;
+        std::memcpy(&v, p, 8);
+        values(j) = v;
+      }
+      p += value_bytes;
+    }
+  }
+
+  //! Write the file header describing this layout
+  inline void writeHeader(std::ostream & stream) const
+  {
+    char header[HeaderSize];
+    std::memcpy(header, "TOMOSMPL", 8);
+    const std::uint32_t version = FormatVersion;
+    std::memcpy(header + 8, &version, 4);
+    std::memcpy(header + 12, &value_bytes, 4);
+    std::memcpy(header + 16, &num_values, 8);
+    const std::uint64_t recsize = recordSize();
+    std::memcpy(header + 24, &recsize, 8);
+    stream.write(header, HeaderSize);
+  }
+
+  /** \brief Read a file header and return the corresponding layout
+   *
+   * Throws \ref SampleStreamError if the header is invalid.
+   */
+  static inline SampleStreamLayout readHeader(std::istream & stream)
+  {
+    char header[HeaderSize];
+    stream.read(header, HeaderSize);
+    if (!stream || std::memcmp(header, "TOMOSMPL", 8) != 0) {
+      throw SampleStreamError("Not a sample stream file");
+    }
+    std::uint32_t version, value_bytes;
+    std::uint64_t num_values, recsize;
+    std::memcpy(&version, header + 8, 4);
+    std::memcpy(&value_bytes, header + 12, 4);
+    std::memcpy(&num_values, header + 16, 8);
+    std::memcpy(&recsize, header + 24, 8);
+    if (version != FormatVersion) {
+      throw SampleStreamError(streamstr("Unsupported file format version " << version));
+    }
+    SampleStreamLayout layout(num_values, value_bytes);
+    if (recsize != layout.recordSize()) {
+      throw SampleStreamError("Inconsistent record size in header");
+    }
+    return layout;
+  }
+};
+
+
+
+/** \brief Write records to a sample stream file from a background thread
+ *
+ * Any number of producers (typically one \ref SampleStreamMHRWStatsCollector per task,
+ * running in different threads) hand over buffers of encoded records with \ref
+ * submit().  The buffers are written to the file in the order in which they were
+ * submitted, by a dedicated writer thread, so that the random walks don't wait for disk
+ * I/O.
+ *
+ * At most \a max_pending_buffers buffers may be waiting to be written; if the disk can't
+ * keep up, \ref submit() blocks until there is room again.  This bounds the memory used by
+ * the writer.
+ *
+ * The writer is closed by \ref close() or by the destructor, which wait until all pending
+ * buffers have been written.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+class TOMOGRAPHER_EXPORT SampleStreamWriter
+{
+public:
+  /** \brief Open the file \a filename for writing and write the header
+   *
+   * Throws \ref SampleStreamError if the file can't be opened.
+   */
+  SampleStreamWriter(const std::string & filename, SampleStreamLayout layout,
+                     std::size_t max_pending_buffers = 16)
+    : _layout(layout),
+      _max_pending(max_pending_buffers > 0 ? max_pending_buffers : 1),
+      _num_records(0),
+      _closing(false),
+      _io_error(false)
+  {
+    _stream.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!_stream) {
+      throw SampleStreamError("Can't open file " + filename + " for writing");
+    }
+    _layout.writeHeader(_stream);
+    _thread = std::thread([this]() { _writer_thread_fn(); });
+  }
+
+  SampleStreamWriter(const SampleStreamWriter & ) = delete;
+  SampleStreamWriter & operator=(const SampleStreamWriter & ) = delete;
+
+  ~SampleStreamWriter()
+  {
+    try {
+      close();
+    } catch (const SampleStreamError & ) {
+      // can't throw from the destructor; the error was reported to the producers already
+    }
+  }
+
+  //! The layout of the records written to this stream
+  inline const SampleStreamLayout & layout() const
+  {
+    return _layout;
+  }
+
+  //! The number of records written to the file so far
+  inline std::uint64_t numRecordsWritten() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _num_records;
+  }
+
+  /** \brief Hand over a buffer of encoded records to be written
+   *
+   * The size of \a buffer must be a multiple of the record size.  The contents of \a buffer
+   * are moved into the write queue, and \a buffer is replaced by an empty buffer (possibly
+   * recycled from an earlier write, so that its memory can be reused).
+   *
+   * Blocks if there are already too many pending buffers.  Throws \ref SampleStreamError
+   * if an earlier write to the file failed.
+   */
+  inline void submit(std::vector<char> & buffer)
+  {
+    tomographer_assert(buffer.size() % _layout.recordSize() == 0);
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cond_space.wait(lock, [this]() { return _pending.size() < _max_pending || _io_error || _closing; });
+    if (_io_error) {
+      throw SampleStreamError("Failed to write sample stream to file");
+    }
+    if (_closing) {
+      throw SampleStreamError("Sample stream was already closed");
+    }
+    _pending.push_back(std::move(buffer));
+    if (!_spare.empty()) {
+      buffer = std::move(_spare.back());
+      _spare.pop_back();
+    } else {
+      buffer = std::vector<char>();
+    }
+    buffer.clear();
+    _cond_work.notify_one();
+  }
+
+  /** \brief Write all pending buffers and close the file
+   *
+   * Throws \ref SampleStreamError if writing to the file failed.  Calling \ref close()
+   * more than once has no effect.
+   */
+  inline void close()
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _closing = true;
+    }
+    _cond_work.notify_all();
+    _cond_space.notify_all();
+    if (_thread.joinable()) {
+      _thread.join();
+      _stream.close();
+      if (_io_error || !_stream) {
+        _io_error = true;
+        throw SampleStreamError("Failed to write sample stream to file");
+      }
+    }
+  }
+
+private:
+  inline void _writer_thread_fn()
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+      _cond_work.wait(lock, [this]() { return !_pending.empty() || _closing; });
+      if (_pending.empty()) {
+        // closing, and nothing left to write
+        return;
+      }
+      std::vector<char> buffer = std::move(_pending.front());
+      _pending.pop_front();
+      _cond_space.notify_all();
+
+      // write without holding the lock
+      lock.unlock();
+      _stream.write(buffer.data(), (std::streamsize)buffer.size());
+      const bool ok = (bool)_stream;
+      lock.lock();
+
+      if (!ok) {
+        _io_error = true;
+        _pending.clear();
+        _cond_space.notify_all();
+        return;
+      }
+      _num_records += buffer.size() / _layout.recordSize();
+      if (_spare.size() < _max_pending) {
+        _spare.push_back(std::move(buffer));
+      }
+    }
+  }
+
+  const SampleStreamLayout _layout;
+  const std::size_t _max_pending;
+
+  std::ofstream _stream;
+  std::thread _thread;
+
+  mutable std::mutex _mutex;
+  std::condition_variable _cond_work;
+  std::condition_variable _cond_space;
+  std::deque<std::vector<char> > _pending;
+  std::vector<std::vector<char> > _spare;
+  std::uint64_t _num_records;
+  bool _closing;
+  bool _io_error;
+};
+
+
+
+/** \brief Read the records of a sample stream file
+ *
+ * See \ref SampleStreamLayout for the file format.  Records may be read one by one with
+ * \ref readNext(), or all at once with \ref readAll().
+ *
+ * \since Added in %Tomographer 5.5
+ */
+class TOMOGRAPHER_EXPORT SampleStreamReader
+{
+public:
+  /** \brief Open the file \a filename and read its header
+   *
+   * Throws \ref SampleStreamError if the file can't be opened or is not a valid sample
+   * stream file.
+   */
+  SampleStreamReader(const std::string & filename)
+    : _stream(filename, std::ios::in | std::ios::binary),
+      _layout(_read_header(_stream, filename)),
+      _num_records(0),
+      _buffer(_layout.recordSize())
+  {
+    _stream.seekg(0, std::ios::end);
+    const std::uint64_t filesize = (std::uint64_t)_stream.tellg();
+    // an incomplete last record (e.g. if the run was interrupted) is ignored
+    _num_records = (filesize - SampleStreamLayout::HeaderSize) / _layout.recordSize();
+    _stream.seekg(SampleStreamLayout::HeaderSize, std::ios::beg);
+  }
+
+  //! The layout of the records of this file
+  inline const SampleStreamLayout & layout() const
+  {
+    return _layout;
+  }
+
+  //! The number of (complete) records stored in the file
+  inline std::uint64_t numRecords() const
+  {
+    return _num_records;
+  }
+
+  /** \brief Read the next record
+   *
+   * Returns \a false if there are no more records to read.
+   */
+  template<typename Derived>
+  inline bool readNext(int & task_id, double & fnval, Eigen::PlainObjectBase<Derived> & values)
+  {
+    if (!_stream.read(_buffer.data(), (std::streamsize)_buffer.size())) {
+      return false;
+    }
+    _layout.decodeRecord(_buffer.data(), task_id, fnval, values);
+    return true;
+  }
+
+  //! All the data stored in a sample stream file, see \ref readAll()
+  struct Data {
+    //! The task ID of each sample
+    Eigen::VectorXi task_ids;
+    //! The value of the random walk function at each sample (e.g. the log-likelihood)
+    Eigen::VectorXd fnvals;
+    //! The values stored for each sample; the values of the k-th sample are in the k-th column
+    Eigen::MatrixXd values;
+  };
+
+  //! Read all the records of the file
+  inline Data readAll()
+  {
+    _stream.clear();
+    _stream.seekg(SampleStreamLayout::HeaderSize, std::ios::beg);
+    Data data;
+    data.task_ids.resize((Eigen::Index)_num_records);
+    data.fnvals.resize((Eigen::Index)_num_records);
+    data.values.resize((Eigen::Index)_layout.num_values, (Eigen::Index)_num_records);
+    Eigen::VectorXd v;
+    for (Eigen::Index k = 0; k < (Eigen::Index)_num_records; ++k) {
+      int task_id;
+      const bool ok = readNext(task_id, data.fnvals(k), v);
+      if (!ok) {
+        throw SampleStreamError("Unexpected end of file");
+      }
+      data.task_ids(k) = task_id;
+      data.values.col(k) = v;
+    }
+    return data;
+  }
+
+private:
+  static inline SampleStreamLayout _read_header(std::ifstream & stream, const std::string & filename)
+  {
+    if (!stream) {
+      throw SampleStreamError("Can't open file " + filename + " for reading");
+    }
+    return SampleStreamLayout::readHeader(stream);
+  }
+
+  std::ifstream _stream;
+  const SampleStreamLayout _layout;
+  std::uint64_t _num_records;
+  std::vector<char> _buffer;
+};
+
+
+
+/** \brief Write the samples of a random walk to a sample stream file
+ *
+ * At each live sample, the \a MultiValueCalculator (see \ref MultiValueCalculatorCache for
+ * the interface) is used to calculate a list of values which describe the sample point;
+ * these values are written, along with the task ID and the value of the random walk
+ * function at the sample point, to a \ref SampleStreamWriter.  Only every \a thin -th
+ * sample is written.
+ *
+ * Records are accumulated in a buffer of at most \a buffer_records records which is owned
+ * by this collector (and thus local to the thread running the random walk), and handed over
+ * to the writer whenever it is full and at the end of the random walk.
+ *
+ * If the writer is \a NULL, then this stats collector does nothing at all.
+ *
+ * This stats collector does not produce any result.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename MultiValueCalculator_, typename LoggerType_ = Logger::VacuumLogger>
+class TOMOGRAPHER_EXPORT SampleStreamMHRWStatsCollector
+{
+public:
+  //! The type which calculates the values to be stored for each sample
+  typedef MultiValueCalculator_ MultiValueCalculator;
+  //! The type of the values calculated by the \a MultiValueCalculator
+  typedef typename MultiValueCalculator::ValueType ValueType;
+  //! A logger type
+  typedef LoggerType_ LoggerType;
+
+private:
+  SampleStreamWriter * _writer;
+  const MultiValueCalculator _mvcalc;
+  const int _task_id;
+  const int _thin;
+  const std::size_t _buffer_records;
+
+  std::vector<char> _buffer;
+  Eigen::Array<ValueType, Eigen::Dynamic, 1> _values;
+
+  Logger::LocalLogger<LoggerType> _logger;
+
+public:
+  //! Constructor
+  SampleStreamMHRWStatsCollector(SampleStreamWriter * writer, MultiValueCalculator mvcalc,
+                                 int task_id, LoggerType & logger_, int thin = 1,
+                                 std::size_t buffer_records = 1024)
+    : _writer(writer),
+      _mvcalc(std::move(mvcalc)),
+      _task_id(task_id),
+      _thin(thin > 0 ? thin : 1),
+      _buffer_records(buffer_records > 0 ? buffer_records : 1),
+      _buffer(),
+      _values(_mvcalc.numValues()),
+      _logger("Tomographer::SampleStreamMHRWStatsCollector", logger_)
+  {
+    tomographer_assert(_writer == NULL || _writer->layout().num_values == (std::uint64_t)_mvcalc.numValues());
+  }
+
+  //! Part of the \ref pageInterfaceMHRWStatsCollector.
+  inline void init()
+  {
+    if (_writer != NULL) {
+      _buffer.reserve(_buffer_records * _writer->layout().recordSize());
+    }
+  }
+  //! Part of the \ref pageInterfaceMHRWStatsCollector. No-op.
+  inline void thermalizingDone()
+  {
+  }
+  //! Part of the \ref pageInterfaceMHRWStatsCollector. Writes out the remaining samples.
+  inline void done()
+  {
+    if (_writer != NULL && !_buffer.empty()) {
+      _flush();
+    }
+  }
+
+  //! Part of the \ref pageInterfaceMHRWStatsCollector. No-op.
+  template<typename CountIntType2, typename PointType, typename FnValueType, typename MHRandomWalk>
+  inline void rawMove(CountIntType2 , bool , bool , bool , double , const PointType & , FnValueType ,
+                      const PointType & , FnValueType , MHRandomWalk & )
+  {
+  }
+
+  //! Part of the \ref pageInterfaceMHRWStatsCollector. Stores the sample.
+  template<typename CountIntType2, typename PointType, typename FnValueType, typename MHRandomWalk>
+  inline void processSample(CountIntType2 , CountIntType2 n, const PointType & curpt,
+                            FnValueType curptval, MHRandomWalk & mh)
+  {
+    if (_writer == NULL || (n % _thin) != 0) {
+      return;
+    }
+    const SampleStreamLayout & layout = _writer->layout();
+    getValuesAtCurrentPoint(_mvcalc, curpt, mh, _values);
+    const std::size_t offset = _buffer.size();
+    _buffer.resize(offset + layout.recordSize());
+    layout.encodeRecord(_buffer.data() + offset, _task_id, (double)curptval, _values);
+    if (_buffer.size() >= _buffer_records * layout.recordSize()) {
+      _flush();
+    }
+  }
+
+private:
+  inline void _flush()
+  {
+    _logger.longdebug([&](std::ostream & stream) {
+        stream << "handing over " << _buffer.size() / _writer->layout().recordSize() << " records";
+      });
+    _writer->submit(_buffer);
+    _buffer.reserve(_buffer_records * _writer->layout().recordSize());
+  }
+};
+
+
+/** \brief Convenience function to create a \ref SampleStreamMHRWStatsCollector (using template
+ *         argument deduction)
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename MultiValueCalculator, typename LoggerType>
+inline SampleStreamMHRWStatsCollector<MultiValueCalculator, LoggerType>
+mkSampleStreamMHRWStatsCollector(SampleStreamWriter * writer, MultiValueCalculator mvcalc,
+                                 int task_id, LoggerType & logger, int thin = 1,
+                                 std::size_t buffer_records = 1024)
+{
+  return SampleStreamMHRWStatsCollector<MultiValueCalculator, LoggerType>(
+      writer, std::move(mvcalc), task_id, logger, thin, buffer_records
+      );
+}
+
+
+
+} // namespace Tomographer
+
+
+
+#endif
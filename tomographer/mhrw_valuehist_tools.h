@@ -66,6 +66,8 @@ namespace ValueHistogramTools {
  *
  * You shouldn't have to use this class directly.  Use \ref
  * CDataBase::MHRWStatsResultsBaseType instead.
+ *
+ * \since Since %Tomographer 5.5, this class can be serialized with Boost.Serialization.
  */
 template<typename RawHistogramType_, typename ScaledHistogramType_>
 struct TOMOGRAPHER_EXPORT MHRWStatsResultsBaseSimple
@@ -83,9 +85,25 @@ struct TOMOGRAPHER_EXPORT MHRWStatsResultsBaseSimple
                    raw_histogram.off_chart / ncounts);
   }
 
+  //! Construct an invalid object -- ONLY for use with Boost.serialization
+  MHRWStatsResultsBaseSimple()
+    : raw_histogram(),
+      histogram()
+  {
+  }
+
   RawHistogramType raw_histogram;
 
   ScaledHistogramType histogram;
+
+private:
+  friend boost::serialization::access;
+  template<typename Archive>
+  void serialize(Archive & a, unsigned int /* version */)
+  {
+    a & raw_histogram;
+    a & histogram;
+  }
 };
 
 
@@ -322,7 +340,9 @@ struct TOMOGRAPHER_EXPORT CDataBase
   CDataBase(const ValueCalculator & valcalc_, HistogramParams histogram_params_,
 	    MHRWParamsType p, RngSeedType base_seed = 0)
     : Base(std::move(p), base_seed), valcalc(valcalc_), histogram_params(histogram_params_),
-      binningNumLevels()
+      binningNumLevels(),
+      histogram_adaptive_range(),
+      autocorrelation_include_value(false)
   {
   }
   //! Constructor (use only without binning analysis), with full list of rng seeds
@@ -330,7 +350,9 @@ struct TOMOGRAPHER_EXPORT CDataBase
   CDataBase(const ValueCalculator & valcalc_, HistogramParams histogram_params_,
 	    MHRWParamsType p, std::vector<RngSeedType> seeds)
     : Base(std::move(p), std::move(seeds)), valcalc(valcalc_), histogram_params(histogram_params_),
-      binningNumLevels()
+      binningNumLevels(),
+      histogram_adaptive_range(),
+      autocorrelation_include_value(false)
   {
   }
 
@@ -339,7 +361,9 @@ struct TOMOGRAPHER_EXPORT CDataBase
   CDataBase(const ValueCalculator & valcalc_, HistogramParams histogram_params_, int binning_num_levels_,
 	    MHRWParamsType p, RngSeedType base_seed = 0)
     : Base(std::move(p), base_seed), valcalc(valcalc_), histogram_params(histogram_params_),
-      binningNumLevels(binning_num_levels_)
+      binningNumLevels(binning_num_levels_),
+      histogram_adaptive_range(),
+      autocorrelation_include_value(false)
   {
   }
   //! Constructor (use only with binning analysis), with full list of rng seeds
@@ -347,13 +371,16 @@ struct TOMOGRAPHER_EXPORT CDataBase
     CDataBase(const ValueCalculator & valcalc_, HistogramParams histogram_params_, int binning_num_levels_,
 	    MHRWParamsType p, std::vector<RngSeedType> seeds)
     : Base(std::move(p), std::move(seeds)), valcalc(valcalc_), histogram_params(histogram_params_),
-      binningNumLevels(binning_num_levels_)
+      binningNumLevels(binning_num_levels_),
+      histogram_adaptive_range(),
+      autocorrelation_include_value(false)
   {
   }
 
   //! Construct an invalid object -- ONLY for use with Boost.serialization
   TOMOGRAPHER_ENABLED_IF(std::is_default_constructible<ValueCalculator>::value)
-  CDataBase() : Base(), valcalc(), histogram_params(), binningNumLevels() { }
+  CDataBase() : Base(), valcalc(), histogram_params(), binningNumLevels(), histogram_adaptive_range(),
+                autocorrelation_include_value(false) { }
 
 
   /** \brief The value calculator instance
@@ -378,6 +405,26 @@ struct TOMOGRAPHER_EXPORT CDataBase
    *        const pointer to this class is kept ensuring const-ness already)
    */
   Tools::StoreIfEnabled<int, UseBinningAnalysis> binningNumLevels;
+  /** \brief How to choose the histogram range automatically during thermalization
+   *
+   * This is disabled by default, in which case \ref histogram_params is used as is.  If
+   * enabled, each task chooses its own range (see \ref HistogramAdaptiveRange) with the
+   * number of bins given in \ref histogram_params, and \ref aggregateResultHistograms()
+   * brings all task histograms onto a common grid before aggregating them.
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  HistogramAdaptiveRange<typename HistogramParams::Scalar> histogram_adaptive_range;
+  /** \brief Whether to estimate the autocorrelation time of the figure of merit
+   *
+   * The autocorrelation time of the log-likelihood is always estimated and included in
+   * the task results (see \ref createAutocorrelationStatsCollector()).  If this is set,
+   * the figure of merit is included as well; this is disabled by default, because it
+   * calculates the figure of merit a second time at each sample.
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  bool autocorrelation_include_value;
 
 
   /** \brief Create the stats collector (without binning analysis)
@@ -395,7 +442,8 @@ struct TOMOGRAPHER_EXPORT CDataBase
     return ValueHistogramMHRWStatsCollector<ValueCalculator,LoggerType,HistogramType>(
 	histogram_params,
 	valcalc,
-	logger
+	logger,
+        histogram_adaptive_range
 	);
   }
 
@@ -420,11 +468,30 @@ struct TOMOGRAPHER_EXPORT CDataBase
 	histogram_params,
 	valcalc,
         binningNumLevels.value,
-	logger
+	logger,
+        histogram_adaptive_range
 	);
   }
 
 
+  /** \brief Create the stats collector estimating the autocorrelation times of the
+   *         log-likelihood and, if \ref autocorrelation_include_value is set, of the
+   *         figure of merit
+   *
+   * This is picked up automatically by \ref MHRandomWalkTask (see \ref
+   * pageInterfaceMHRandomWalkTaskCData).
+   */
+  template<typename LoggerType>
+  inline MHRWAutocorrelationStatsCollector<ValueCalculator, IterCountIntType, LoggerType>
+  createAutocorrelationStatsCollector(LoggerType & logger) const
+  {
+    return MHRWAutocorrelationStatsCollector<ValueCalculator, IterCountIntType, LoggerType>(
+        autocorrelation_include_value ? &valcalc : NULL,
+        logger
+        );
+  }
+
+
   typedef typename tomo_internal::valuehist_types<CDataBase, UseBinningAnalysis>::AggregatedHistogramType
     AggregatedHistogramType;
 
@@ -436,10 +503,24 @@ struct TOMOGRAPHER_EXPORT CDataBase
    * you have defined your custom \a MHRWStatsResults type (see \ref
    * pageInterfaceMHRandomWalkTaskCData) using \a CDataBase::MHRWStatsResultsBaseType as base
    * class.
+   *
+   * If \ref histogram_adaptive_range is enabled, then the task histograms may have
+   * different ranges.  They are then all rebinned onto their common grid before being
+   * aggregated (see \ref aggregateHistogramsOnCommonGrid()).
    */
   template<typename TaskResultType>
   AggregatedHistogramType aggregateResultHistograms(const std::vector<TaskResultType*> & task_result_list)
   {
+    if (histogram_adaptive_range.enabled()) {
+      return aggregateHistogramsOnCommonGrid<AggregatedHistogramType>(
+          task_result_list,
+          [](const TaskResultType * task_result)
+          -> const typename AggregatedHistogramType::HistogramType &
+          {
+            return task_result->stats_results.histogram;
+          });
+    }
+
     return AggregatedHistogramType::aggregate(
         histogram_params,
         task_result_list,
@@ -465,6 +546,8 @@ private:
     a & valcalc_ref;
     a & histogram_params;
     maybe_serialize_binning(a, version);
+    a & histogram_adaptive_range;
+    a & autocorrelation_include_value;
   }
   template<typename Archive, TOMOGRAPHER_ENABLED_IF_TMPL(UseBinningAnalysis)>
   void maybe_serialize_binning(Archive & a, const unsigned int /* version */)
@@ -547,6 +630,11 @@ inline void print_hist_short_bar_summary(std::ostream & stream, int dig_w, std::
            << "] ! Adapt step size ***\n";
   }
   maybe_show_error_summary(stream, task_result->stats_results);
+  if (task_result->autocorrelation.isValid()) {
+    stream << "    autocorrelation [sweeps]: ";
+    task_result->autocorrelation.printSummary(stream);
+    stream << "\n";
+  }
 }
 
 } // namespace tomo_internal
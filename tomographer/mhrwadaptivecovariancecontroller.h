@@ -0,0 +1,527 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef _TOMOGRAPHER_MHRWADAPTIVECOVARIANCECONTROLLER_H
+#define _TOMOGRAPHER_MHRWADAPTIVECOVARIANCECONTROLLER_H
+
+#include <cstddef>
+#include <cmath>
+
+#include <algorithm>
+
+#include <limits>
+#include <ostream>
+
+#include <Eigen/Eigen>
+
+#include <boost/serialization/serialization.hpp>
+
+#include <tomographer/tools/loggers.h>
+#include <tomographer/tools/fmt.h>
+#include <tomographer/tools/cxxutil.h>
+#include <tomographer/tools/eigenutil.h> // serialization of Eigen matrices
+#include <tomographer/mhrw.h>
+#include <tomographer/mhrwstatscollectors.h>
+#include <tomographer/mhrwstepsizecontroller.h>
+
+
+/** \file mhrwadaptivecovariancecontroller.h
+ * \brief Tools for learning the covariance of the proposal distribution of a random walk
+ *        during thermalization
+ *
+ * See \ref Tomographer::MHRWAdaptiveCovarianceController
+ */
+
+
+namespace Tomographer {
+
+
+/** \brief An MHWalkerParams type for a random walk with a correlated Gaussian proposal
+ *
+ * Stores a step size, along with a lower triangular matrix \f$ L \f$ such that the
+ * proposed jumps are \f$ \epsilon\, L\, z \f$, where \f$ \epsilon \f$ is the \a step_size
+ * and where \f$ z \f$ is a vector of independent standard normal variables.  The
+ * covariance matrix of the jumps is thus \f$ \epsilon^2 L L^T \f$.  If \a cov_factor is
+ * empty, then \f$ L \f$ is the identity matrix and the jumps are isotropic.
+ *
+ * See, e.g., \ref DenseDM::TSpace::LLHAdaptiveMHWalker and \ref
+ * MHRWAdaptiveCovarianceController.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename StepRealType_ = double>
+struct TOMOGRAPHER_EXPORT MHWalkerParamsCovariance
+{
+  typedef StepRealType_ StepRealType;
+  //! Type used to store the factor \f$ L \f$ of the covariance matrix of the jumps
+  typedef Eigen::Matrix<StepRealType, Eigen::Dynamic, Eigen::Dynamic> CovFactorType;
+
+  MHWalkerParamsCovariance() : step_size(), cov_factor() { }
+  MHWalkerParamsCovariance(StepRealType step_size_) : step_size(step_size_), cov_factor() { }
+  MHWalkerParamsCovariance(StepRealType step_size_, const CovFactorType & cov_factor_)
+    : step_size(step_size_), cov_factor(cov_factor_) { }
+
+  StepRealType step_size;
+
+  /** \brief Lower triangular factor of the covariance matrix of the jumps, in units of
+   *         the step size.  Empty for isotropic jumps.
+   */
+  CovFactorType cov_factor;
+
+private:
+  friend boost::serialization::access;
+  template<typename Archive>
+  void serialize(Archive & a, unsigned int /* version */)
+  {
+    a & step_size;
+    a & cov_factor;
+  }
+};
+
+template<typename StepRealType>
+inline std::ostream & operator<<(std::ostream & stream, const MHWalkerParamsCovariance<StepRealType> & p)
+{
+  stream << "step_size=" << p.step_size << ", cov_factor=";
+  if (p.cov_factor.size() == 0) {
+    return stream << "<identity>";
+  }
+  return stream << "<" << p.cov_factor.rows() << "x" << p.cov_factor.cols() << " learned>";
+}
+
+
+
+/** \brief Default parameters for MHRWAdaptiveCovarianceController
+ *
+ * \since Added in %Tomographer 5.5
+ */
+namespace MHRWAdaptiveCovarianceControllerDefaults {
+
+//! Number of iterations after which the proposal covariance is updated for the first time
+static constexpr int InitialWindow = 1024;
+//! Relative amount of the identity added to the estimated covariance matrix
+static constexpr double Regularization = 1e-3;
+
+} // MHRWAdaptiveCovarianceControllerDefaults
+
+
+
+/** \brief A \ref pageInterfaceMHRWController which learns the covariance of the jumps
+ *         during thermalization, in addition to adjusting the step size
+ *
+ * When the target distribution is strongly anisotropic, isotropic jumps must be as small
+ * as the narrowest direction of the distribution, and the random walk then explores the
+ * wide directions very slowly.  This controller estimates the covariance matrix of the
+ * points visited during thermalization, and uses it as the shape of the jumps (the \a
+ * cov_factor of \ref MHWalkerParamsCovariance), such that the jumps follow the shape of
+ * the distribution ("adaptive Metropolis", [Haario, Saksman & Tamminen, Bernoulli 7, 223
+ * (2001)]).
+ *
+ * The mean and covariance matrix are accumulated with Welford's streaming update after
+ * each thermalization iteration, without storing any samples.  The covariance is
+ * estimated on successive windows of iterations, each twice as long as the previous one,
+ * such that the points visited far from equilibrium at the beginning of the random walk
+ * are eventually forgotten; the proposal is updated at the end of each window.  The last
+ * window stops before the last fraction \a ensure_n_therm_fixed_params_fraction of
+ * thermalization sweeps, which are run with a fixed covariance.
+ *
+ * If no window yields a usable estimate, e.g. because all the proposed jumps were
+ * rejected and the covariance of the visited points vanishes, the proposal stays
+ * isotropic and thermalization ends as with a plain \ref MHRWStepSizeController.
+ *
+ * The proposal never changes during the live runs (see \a AdjustmentStrategy), hence
+ * the samples are collected from a random walk with a fixed proposal, which satisfies
+ * detailed balance.
+ *
+ * The step size is adjusted to keep a good acceptance ratio exactly as with a \ref
+ * MHRWStepSizeController, from which this class derives.  The covariance matrix is
+ * normalized such that the mean variance of its directions is one, so that the step size
+ * keeps its meaning when the covariance is updated.
+ *
+ * The \ref pageInterfaceMHWalker must use \ref MHWalkerParamsCovariance as \a
+ * WalkerParams, and it must provide the following method, which returns the coordinates
+ * of a point in which the jumps are proposed:
+ * \code
+ *   VectorType proposalCoordinates(const PointType & pt) const;
+ * \endcode
+ * where \a VectorType is an Eigen column vector type.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename MHRWMovingAverageAcceptanceRatioStatsCollectorType_,
+         typename BaseLoggerType_ = Logger::VacuumLogger,
+         typename StepRealType_ = double,
+         typename IterCountIntType_ = int>
+class TOMOGRAPHER_EXPORT MHRWAdaptiveCovarianceController
+  : public MHRWStepSizeController<MHRWMovingAverageAcceptanceRatioStatsCollectorType_,
+                                  BaseLoggerType_, StepRealType_, IterCountIntType_>
+{
+public:
+  typedef MHRWStepSizeController<MHRWMovingAverageAcceptanceRatioStatsCollectorType_,
+                                 BaseLoggerType_, StepRealType_, IterCountIntType_> Base;
+
+  using Base::AdjustmentStrategy;
+
+  typedef MHRWMovingAverageAcceptanceRatioStatsCollectorType_
+    MHRWMovingAverageAcceptanceRatioStatsCollectorType;
+  typedef BaseLoggerType_ BaseLoggerType;
+  typedef StepRealType_ StepRealType;
+  typedef IterCountIntType_ IterCountIntType;
+
+  //! Vector type used to accumulate the mean of the visited points
+  typedef Eigen::Matrix<StepRealType, Eigen::Dynamic, 1> VectorType;
+  //! Matrix type used to accumulate the covariance of the visited points
+  typedef Eigen::Matrix<StepRealType, Eigen::Dynamic, Eigen::Dynamic> MatrixType;
+
+private:
+
+  const IterCountIntType initial_window;
+  const StepRealType regularization;
+
+  // streaming estimate of mean & covariance over the current window (Welford)
+  IterCountIntType num_samples;
+  VectorType mean;
+  MatrixType m2; // only the lower triangular part is used
+
+  IterCountIntType window_size;
+  IterCountIntType window_end;
+  IterCountIntType adapt_end;
+  bool adapting;
+
+  int num_cov_updates;
+  IterCountIntType last_cov_update_iter_k;
+
+  Logger::LocalLogger<BaseLoggerType> llogger;
+
+public:
+  MHRWAdaptiveCovarianceController(
+    const MHRWMovingAverageAcceptanceRatioStatsCollectorType & accept_ratio_stats_collector_,
+    BaseLoggerType & baselogger_,
+    IterCountIntType initial_window_ = MHRWAdaptiveCovarianceControllerDefaults::InitialWindow,
+    StepRealType regularization_ = MHRWAdaptiveCovarianceControllerDefaults::Regularization,
+    double desired_accept_ratio_min_ =
+      MHRWAcceptRatioWalkerParamsControllerDefaults::DesiredAcceptanceRatioMin,
+    double desired_accept_ratio_max_ =
+      MHRWAcceptRatioWalkerParamsControllerDefaults::DesiredAcceptanceRatioMax,
+    double acceptable_accept_ratio_min_ =
+      MHRWAcceptRatioWalkerParamsControllerDefaults::AcceptableAcceptanceRatioMin,
+    double acceptable_accept_ratio_max_ =
+      MHRWAcceptRatioWalkerParamsControllerDefaults::AcceptableAcceptanceRatioMax,
+    double ensure_n_therm_fixed_params_fraction_ =
+      MHRWAcceptRatioWalkerParamsControllerDefaults::EnsureNThermFixedParamsFraction
+    )
+  : Base(accept_ratio_stats_collector_,
+         baselogger_,
+         desired_accept_ratio_min_,
+         desired_accept_ratio_max_,
+         acceptable_accept_ratio_min_,
+         acceptable_accept_ratio_max_,
+         ensure_n_therm_fixed_params_fraction_),
+    initial_window(initial_window_),
+    regularization(regularization_),
+    num_samples(0),
+    mean(),
+    m2(),
+    window_size(0),
+    window_end(0),
+    adapt_end(0),
+    adapting(false),
+    num_cov_updates(0),
+    last_cov_update_iter_k(0),
+    llogger("Tomographer::MHRWAdaptiveCovarianceController", baselogger_)
+  {
+    tomographer_assert(initial_window > 0);
+  }
+
+
+  template<typename MHRWParamsType, typename MHWalker, typename MHRandomWalkType>
+  inline void init(MHRWParamsType & params, const MHWalker & mhwalker, const MHRandomWalkType & mhrw)
+  {
+    Base::init(params, mhwalker, mhrw);
+
+    auto logger = llogger.subLogger(TOMO_ORIGIN) ;
+
+    num_samples = 0;
+    window_size = initial_window;
+    window_end = initial_window;
+    // leave the last thermalization sweeps with a fixed covariance
+    adapt_end = (IterCountIntType)(
+        (1 - Base::ensureNThermFixedParamsFraction()) * params.n_therm * params.n_sweep
+        );
+    adapting = true;
+    num_cov_updates = 0;
+    last_cov_update_iter_k = 0;
+
+    logger.debug([&](std::ostream & stream) {
+        stream << "Learning the proposal covariance until iteration " << adapt_end
+               << ", first window of " << window_size << " iterations";
+      });
+  }
+
+  template<bool IsThermalizing, bool IsAfterSample,
+           typename MHRWParamsType, typename MHWalker, typename MHRandomWalkType,
+           TOMOGRAPHER_ENABLED_IF_TMPL(IsThermalizing)> // Only while thermalizing
+  inline void adjustParams(MHRWParamsType & params, const MHWalker & mhwalker,
+                           IterCountIntType iter_k, const MHRandomWalkType & mhrw)
+  {
+    if (adapting) {
+      _record_point(mhwalker.proposalCoordinates(mhrw.getCurrentPoint()));
+      if (iter_k + 1 >= window_end) {
+        _end_window(params, iter_k);
+      }
+    }
+
+    Base::template adjustParams<IsThermalizing, IsAfterSample>(params, mhwalker, iter_k, mhrw);
+  }
+
+  template<typename MHRWParamsType, typename MHWalker, typename MHRandomWalkType>
+  inline bool allowDoneThermalization(const MHRWParamsType & params, const MHWalker & mhwalker,
+                                      IterCountIntType iter_k, const MHRandomWalkType & mhrw)
+  {
+    auto logger = llogger.subLogger(TOMO_ORIGIN);
+
+    if (adapting && num_cov_updates == 0) {
+      logger.longdebug("not allowing, the proposal covariance hasn't been learned yet");
+      return false;
+    }
+    if ((iter_k - last_cov_update_iter_k)
+        < params.n_sweep*(Base::ensureNThermFixedParamsFraction()*Base::originalNTherm())) {
+      logger.longdebug([&](std::ostream & stream) {
+          stream << "not allowing, based on iter_k=" << iter_k
+                 << " & last_cov_update_iter_k=" << last_cov_update_iter_k;
+        }) ;
+      return false;
+    }
+    return Base::allowDoneThermalization(params, mhwalker, iter_k, mhrw);
+  }
+
+  template<typename MHRWParamsType, typename MHWalker, typename MHRandomWalkType>
+  inline void thermalizingDone(MHRWParamsType & params, const MHWalker & mhwalker,
+                               const MHRandomWalkType & mhrw)
+  {
+    auto logger = llogger.subLogger(TOMO_ORIGIN) ;
+
+    // the proposal is frozen from now on
+    adapting = false;
+    mean.resize(0);
+    m2.resize(0, 0);
+
+    logger.debug([&](std::ostream & stream) {
+        stream << "Proposal covariance was updated " << num_cov_updates
+               << " times, now fixed for the live runs; params = " << params;
+      });
+
+    Base::thermalizingDone(params, mhwalker, mhrw);
+  }
+
+  //! The number of times the covariance of the proposal was updated
+  inline int numCovarianceUpdates() const { return num_cov_updates; }
+  //! Whether the covariance of the proposal is still being learned
+  inline bool isAdapting() const { return adapting; }
+
+private:
+
+  template<typename Derived>
+  inline void _record_point(const Eigen::MatrixBase<Derived> & x)
+  {
+    if (num_samples == 0) {
+      mean = x;
+      m2 = MatrixType::Zero(x.size(), x.size());
+      num_samples = 1;
+      return;
+    }
+    ++num_samples;
+    const VectorType delta = x - mean;
+    mean += delta / StepRealType(num_samples);
+    // Welford: M2 += delta_old * delta_new^T = (n-1)/n * delta_old * delta_old^T
+    m2.template selfadjointView<Eigen::Lower>().rankUpdate(
+        delta, StepRealType(num_samples-1) / StepRealType(num_samples)
+        );
+  }
+
+  template<typename MHRWParamsType>
+  inline void _end_window(MHRWParamsType & params, IterCountIntType iter_k)
+  {
+    auto logger = llogger.subLogger(TOMO_ORIGIN) ;
+
+    const Eigen::Index dim = mean.size();
+
+    if (num_samples < 2*dim + 2 && iter_k + 1 < adapt_end) {
+      // not enough points for a meaningful estimate -- keep accumulating over a longer window
+      window_end = std::min<IterCountIntType>(iter_k + 1 + window_size, adapt_end);
+      return;
+    }
+
+    _update_cov(params, iter_k);
+
+    // start the next window
+    num_samples = 0;
+    window_size *= 2;
+    window_end = iter_k + 1 + window_size;
+    if (window_end + 2*window_size > adapt_end) {
+      // the window after that one wouldn't fit -- extend this one to the end instead
+      window_end = adapt_end;
+    }
+    if (window_end <= iter_k + 1) {
+      adapting = false;
+      if (num_cov_updates == 0) {
+        // e.g. all jumps were rejected -- don't hold up thermalization forever
+        params.mhwalker_params.cov_factor.resize(0, 0);
+        logger.warning("Couldn't learn the proposal covariance, falling back to isotropic jumps");
+      } else {
+        logger.debug("Done learning the proposal covariance");
+      }
+    }
+
+    // ensure there are enough n_therm sweeps left with a fixed covariance
+    const typename MHRWParamsType::CountIntType n_therm_min =
+      (typename MHRWParamsType::CountIntType)(
+          (iter_k/params.n_sweep) + 1 + (Base::ensureNThermFixedParamsFraction() * Base::originalNTherm())
+          );
+    if (!adapting && params.n_therm < n_therm_min) {
+      logger.longdebug([&](std::ostream & stream) {
+          stream << "There aren't enough thermalization sweeps. I'm setting n_therm = " << n_therm_min;
+        });
+      params.n_therm = n_therm_min;
+    }
+  }
+
+  // update the proposal from the covariance of the current window, if it is usable
+  template<typename MHRWParamsType>
+  inline void _update_cov(MHRWParamsType & params, IterCountIntType iter_k)
+  {
+    auto logger = llogger.subLogger(TOMO_ORIGIN) ;
+
+    const Eigen::Index dim = mean.size();
+    if (num_samples < 2*dim + 2) {
+      logger.warning([&](std::ostream & stream) {
+          stream << "Only " << num_samples << " points in the last window, keeping the previous "
+                 << "proposal covariance";
+        });
+      return;
+    }
+
+    MatrixType cov = m2.template selfadjointView<Eigen::Lower>();
+    cov /= StepRealType(num_samples - 1);
+
+    // normalize to unit mean variance, and regularize
+    const StepRealType mean_var = cov.trace() / StepRealType(dim);
+    bool ok = std::isfinite(mean_var) && mean_var > 0;
+    Eigen::LLT<MatrixType> llt;
+    if (ok) {
+      cov /= mean_var;
+      cov.diagonal().array() += regularization;
+      llt.compute(cov);
+      ok = (llt.info() == Eigen::Success);
+    }
+    if (ok) {
+      params.mhwalker_params.cov_factor = llt.matrixL();
+      ++num_cov_updates;
+      last_cov_update_iter_k = iter_k;
+      logger.debug([&](std::ostream & stream) {
+          stream << "Updated proposal covariance from " << num_samples << " points (window #"
+                 << num_cov_updates << "), mean variance = " << mean_var;
+        });
+    } else {
+      logger.warning([&](std::ostream & stream) {
+          stream << "Couldn't update the proposal covariance from " << num_samples
+                 << " points, keeping the previous one";
+        });
+    }
+  }
+
+};
+
+
+template<typename MHRWParamsType,
+         typename MHRWMovingAverageAcceptanceRatioStatsCollectorType_,
+         typename BaseLoggerType_
+         >
+inline
+MHRWAdaptiveCovarianceController<MHRWMovingAverageAcceptanceRatioStatsCollectorType_,
+                                 BaseLoggerType_,
+                                 typename MHRWParamsType::MHWalkerParams::StepRealType,
+                                 typename MHRWParamsType::CountIntType>
+mkMHRWAdaptiveCovarianceController(
+    const MHRWMovingAverageAcceptanceRatioStatsCollectorType_ & accept_ratio_stats_collector_,
+    BaseLoggerType_ & baselogger_,
+    typename MHRWParamsType::CountIntType initial_window_ =
+      MHRWAdaptiveCovarianceControllerDefaults::InitialWindow,
+    typename MHRWParamsType::MHWalkerParams::StepRealType regularization_ =
+      MHRWAdaptiveCovarianceControllerDefaults::Regularization
+    )
+{
+  return MHRWAdaptiveCovarianceController<MHRWMovingAverageAcceptanceRatioStatsCollectorType_,
+                                          BaseLoggerType_,
+                                          typename MHRWParamsType::MHWalkerParams::StepRealType,
+                                          typename MHRWParamsType::CountIntType>(
+                                              accept_ratio_stats_collector_,
+                                              baselogger_,
+                                              initial_window_,
+                                              regularization_
+                                              );
+}
+
+
+
+
+
+
+namespace Tools {
+
+template<typename MHRWMovingAverageAcceptanceRatioStatsCollectorType,
+         typename BaseLoggerType,
+         typename StepRealType,
+         typename IterCountIntType>
+struct TOMOGRAPHER_EXPORT
+StatusProvider<MHRWAdaptiveCovarianceController<MHRWMovingAverageAcceptanceRatioStatsCollectorType,
+                                                BaseLoggerType, StepRealType, IterCountIntType> >
+{
+  typedef MHRWAdaptiveCovarianceController<MHRWMovingAverageAcceptanceRatioStatsCollectorType,
+                                           BaseLoggerType, StepRealType, IterCountIntType> StatusableObject;
+
+  static constexpr bool CanProvideStatusLine = true;
+
+  static inline std::string getStatusLine(const StatusableObject * obj) {
+    double last_step = (double)obj->getLastSetStepSize();
+    std::string s = std::isfinite(last_step)
+      ? Tomographer::Tools::fmts("step size = %.3g, ", last_step) : std::string();
+    return s + Tomographer::Tools::fmts("proposal covariance %s (%d updates)",
+                                        obj->isAdapting() ? "learning" : "fixed",
+                                        obj->numCovarianceUpdates());
+  }
+};
+
+}
+
+
+
+} // namespace Tomographer
+
+
+
+#endif
@@ -0,0 +1,335 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef _TOMOGRAPHER_MHRWHMCSTEPSIZECONTROLLER_H
+#define _TOMOGRAPHER_MHRWHMCSTEPSIZECONTROLLER_H
+
+#include <cstddef>
+#include <cmath>
+
+#include <algorithm> // std::max
+#include <limits>
+
+#include <tomographer/tools/loggers.h>
+#include <tomographer/tools/fmt.h>
+#include <tomographer/tools/cxxutil.h>
+#include <tomographer/mhrw.h>
+#include <tomographer/mhrwstatscollectors.h>
+#include <tomographer/mhrwacceptratiowalkerparamscontroller.h>
+
+
+/** \file mhrwhmcstepsizecontroller.h
+ * \brief Tools for automatically adjusting the leapfrog step size and the number of
+ *        leapfrog steps of a Hamiltonian random walk
+ *
+ * See \ref Tomographer::MHRWHMCStepSizeController
+ */
+
+
+namespace Tomographer {
+
+
+/** \brief Default parameters for MHRWHMCStepSizeController
+ *
+ * The acceptance ratio of a Hamiltonian random walk is best kept much higher than that
+ * of a random walk with symmetric random jumps, around 0.65.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+namespace MHRWHMCStepSizeControllerDefaults {
+
+static constexpr double AcceptableAcceptanceRatioMin = 0.4;
+static constexpr double AcceptableAcceptanceRatioMax = 0.95;
+static constexpr double DesiredAcceptanceRatioMin = 0.6;
+static constexpr double DesiredAcceptanceRatioMax = 0.85;
+static constexpr double EnsureNThermFixedParamsFraction =
+  MHRWAcceptRatioWalkerParamsControllerDefaults::EnsureNThermFixedParamsFraction;
+
+} // MHRWHMCStepSizeControllerDefaults
+
+
+
+/** \brief A \ref pageInterfaceMHRWController adjusting the leapfrog step size of a
+ *         Hamiltonian random walk to keep a good acceptance ratio
+ *
+ * This is the analogue of \ref MHRWStepSizeController for a random walk whose \a
+ * MHWalkerParams are \ref MHWalkerParamsHMC, such as \ref
+ * DenseDM::TSpace::LLHHMCWalker.  During thermalization, the leapfrog step size is
+ * adjusted according to the acceptance ratio, and the number of leapfrog steps is
+ * adjusted such that the trajectory length <code>step_size*num_leapfrog_steps</code>
+ * remains approximately constant.  (The sweep size is left untouched: each iteration is
+ * a full trajectory, whose length does not change.)
+ *
+ * This class conforms both to \ref pageInterfaceMHRWController and \ref
+ * pageInterfaceMHRWAcceptanceRatioBasedParamsAdjuster.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename MHRWMovingAverageAcceptanceRatioStatsCollectorType_,
+         typename BaseLoggerType_ = Logger::VacuumLogger,
+         typename StepRealType_ = double,
+         typename IterCountIntType_ = int>
+class TOMOGRAPHER_EXPORT MHRWHMCStepSizeController
+  : public MHRWAcceptRatioWalkerParamsController<
+  // we will be our own MHRWAcceptanceRatioBasedParamsAdjusterType
+  MHRWHMCStepSizeController<MHRWMovingAverageAcceptanceRatioStatsCollectorType_,
+                            BaseLoggerType_, StepRealType_, IterCountIntType_>,
+  // other params
+  MHRWMovingAverageAcceptanceRatioStatsCollectorType_,
+  BaseLoggerType_,
+  IterCountIntType_
+  >
+{
+public:
+  typedef  MHRWAcceptRatioWalkerParamsController<
+    // we will be our own MHRWAcceptanceRatioBasedParamsAdjusterType
+    MHRWHMCStepSizeController<MHRWMovingAverageAcceptanceRatioStatsCollectorType_,
+                              BaseLoggerType_, StepRealType_, IterCountIntType_>,
+    // other params
+    MHRWMovingAverageAcceptanceRatioStatsCollectorType_,
+    BaseLoggerType_,
+    IterCountIntType_
+    > Base;
+
+  using Base::AdjustmentStrategy;
+
+  typedef MHRWMovingAverageAcceptanceRatioStatsCollectorType_
+    MHRWMovingAverageAcceptanceRatioStatsCollectorType;
+  typedef BaseLoggerType_ BaseLoggerType;
+  typedef StepRealType_ StepRealType;
+  typedef IterCountIntType_ IterCountIntType;
+
+private:
+
+  StepRealType last_set_step_size;
+
+  StepRealType orig_trajectory_length;
+
+  Logger::LocalLogger<BaseLoggerType> llogger;
+
+public:
+  MHRWHMCStepSizeController(
+    const MHRWMovingAverageAcceptanceRatioStatsCollectorType & accept_ratio_stats_collector_,
+    BaseLoggerType & baselogger_,
+    double desired_accept_ratio_min_ =
+      MHRWHMCStepSizeControllerDefaults::DesiredAcceptanceRatioMin,
+    double desired_accept_ratio_max_ =
+      MHRWHMCStepSizeControllerDefaults::DesiredAcceptanceRatioMax,
+    double acceptable_accept_ratio_min_ =
+      MHRWHMCStepSizeControllerDefaults::AcceptableAcceptanceRatioMin,
+    double acceptable_accept_ratio_max_ =
+      MHRWHMCStepSizeControllerDefaults::AcceptableAcceptanceRatioMax,
+    double ensure_n_therm_fixed_params_fraction_ =
+      MHRWHMCStepSizeControllerDefaults::EnsureNThermFixedParamsFraction
+    )
+  : Base(accept_ratio_stats_collector_,
+         baselogger_,
+         *this,
+         desired_accept_ratio_min_,
+         desired_accept_ratio_max_,
+         acceptable_accept_ratio_min_,
+         acceptable_accept_ratio_max_,
+         ensure_n_therm_fixed_params_fraction_),
+    last_set_step_size(std::numeric_limits<StepRealType>::quiet_NaN()),
+    orig_trajectory_length(0),
+    llogger("Tomographer::MHRWHMCStepSizeController", baselogger_)
+  {
+  }
+
+
+  // callbacks for MHRWAcceptanceRatioBasedParamsAdjusterType:
+
+  template<typename MHRWParamsType, typename MHWalker, typename MHRandomWalkType>
+  inline void initParams(MHRWParamsType & params, const MHWalker & , const MHRandomWalkType & )
+  {
+    auto logger = llogger.subLogger(TOMO_ORIGIN) ;
+
+    if (std::isfinite(params.mhwalker_params.step_size) &&
+        params.mhwalker_params.step_size > 0 && params.mhwalker_params.num_leapfrog_steps > 0) {
+      // valid parameters
+      orig_trajectory_length = params.mhwalker_params.num_leapfrog_steps * params.mhwalker_params.step_size;
+    } else {
+      // invalid parameters -- start with trajectories of length 1, e.g. about a radian
+      // on the sphere of T-space
+      const StepRealType default_start_step_size = StepRealType(0.05);
+      logger.debug([&](std::ostream & stream) {
+          stream << "Invalid params " << params.mhwalker_params
+                 << ", set default step_size = " << default_start_step_size;
+        });
+      params.mhwalker_params.step_size = default_start_step_size;
+      params.mhwalker_params.num_leapfrog_steps =
+        (typename MHRWParamsType::MHWalkerParams::LeapfrogCountIntType)(StepRealType(1)/default_start_step_size);
+      orig_trajectory_length = 1;
+    }
+  }
+
+  template<typename MHRWParamsType, typename MeType, typename MHWalker, typename MHRandomWalkType>
+  inline void adjustParamsForAcceptRatio(MHRWParamsType & params, double accept_ratio, const MeType & /* self */,
+                                         const MHWalker & /*mhwalker*/, IterCountIntType iter_k,
+                                         const MHRandomWalkType & /*mhrw*/)
+  {
+    typedef typename MHRWParamsType::MHWalkerParams::LeapfrogCountIntType LeapfrogCountIntType;
+
+    auto logger = llogger.subLogger(TOMO_ORIGIN) ;
+
+    const auto desired_accept_ratio_min = Base::desiredAcceptRatioMin();
+    const auto desired_accept_ratio_max = Base::desiredAcceptRatioMax();
+
+    // The error in the energy of a leapfrog trajectory scales like step_size^2, so the
+    // acceptance ratio reacts strongly to the step size: use smaller corrections than
+    // MHRWStepSizeController
+    const auto cur_step_size = params.mhwalker_params.step_size;
+    StepRealType new_step_size = cur_step_size;
+    if (accept_ratio >= desired_accept_ratio_max) {
+      new_step_size *= (accept_ratio >= StepRealType(0.5)*(1+desired_accept_ratio_max))
+        ? StepRealType(1.2) : StepRealType(1.05);
+    } else if (accept_ratio <= StepRealType(0.5)*desired_accept_ratio_min) {
+      new_step_size *= StepRealType(0.5);
+    } else if (accept_ratio <= StepRealType(0.8)*desired_accept_ratio_min) {
+      new_step_size *= StepRealType(0.75);
+    } else {// if (accept_ratio <= desired_accept_ratio_min
+      new_step_size *= StepRealType(0.9);
+    }
+
+    // never make a trajectory out of less than one leapfrog step
+    if (new_step_size > orig_trajectory_length) {
+      new_step_size = orig_trajectory_length;
+    }
+
+    logger.longdebug([&](std::ostream & stream) {
+        stream << "Corrected step_size to " << new_step_size;
+      });
+
+    params.mhwalker_params.step_size = new_step_size;
+
+    // store last set step size
+    last_set_step_size = new_step_size;
+
+    // keep the trajectory length constant
+    params.mhwalker_params.num_leapfrog_steps =
+      std::max<LeapfrogCountIntType>(1, (LeapfrogCountIntType)(orig_trajectory_length / new_step_size + StepRealType(0.5)));
+
+    // ensure there are enough n_therm sweeps left
+    const typename MHRWParamsType::CountIntType n_therm_min =
+      (typename MHRWParamsType::CountIntType)(
+          (iter_k/params.n_sweep) + 1 + (Base::ensureNThermFixedParamsFraction() * Base::originalNTherm())
+          );
+    if (params.n_therm < n_therm_min) {
+      logger.longdebug([&](std::ostream & stream) {
+          stream << "There aren't enough thermalization sweeps. I'm setting n_therm = " << n_therm_min;
+        });
+      params.n_therm = n_therm_min;
+    }
+
+    logger.longdebug([&](std::ostream & stream) {
+        stream << "New params = " << params;
+      });
+  }
+
+  inline StepRealType getLastSetStepSize() const { return last_set_step_size; }
+
+};
+
+
+template<typename MHRWParamsType,
+         typename MHRWMovingAverageAcceptanceRatioStatsCollectorType_,
+         typename BaseLoggerType_
+         >
+inline
+MHRWHMCStepSizeController<MHRWMovingAverageAcceptanceRatioStatsCollectorType_,
+                          BaseLoggerType_,
+                          typename MHRWParamsType::MHWalkerParams::StepRealType,
+                          typename MHRWParamsType::CountIntType>
+mkMHRWHMCStepSizeController(
+    const MHRWMovingAverageAcceptanceRatioStatsCollectorType_ & accept_ratio_stats_collector_,
+    BaseLoggerType_ & baselogger_,
+    double desired_accept_ratio_min_ =
+      MHRWHMCStepSizeControllerDefaults::DesiredAcceptanceRatioMin,
+    double desired_accept_ratio_max_ =
+      MHRWHMCStepSizeControllerDefaults::DesiredAcceptanceRatioMax,
+    double acceptable_accept_ratio_min_ =
+      MHRWHMCStepSizeControllerDefaults::AcceptableAcceptanceRatioMin,
+    double acceptable_accept_ratio_max_ =
+      MHRWHMCStepSizeControllerDefaults::AcceptableAcceptanceRatioMax,
+    double ensure_n_therm_fixed_params_fraction_ =
+      MHRWHMCStepSizeControllerDefaults::EnsureNThermFixedParamsFraction
+    )
+{
+  return MHRWHMCStepSizeController<MHRWMovingAverageAcceptanceRatioStatsCollectorType_,
+                                   BaseLoggerType_,
+                                   typename MHRWParamsType::MHWalkerParams::StepRealType,
+                                   typename MHRWParamsType::CountIntType>(
+                                       accept_ratio_stats_collector_,
+                                       baselogger_,
+                                       desired_accept_ratio_min_,
+                                       desired_accept_ratio_max_,
+                                       acceptable_accept_ratio_min_,
+                                       acceptable_accept_ratio_max_,
+                                       ensure_n_therm_fixed_params_fraction_
+                                       );
+}
+
+
+
+
+
+
+namespace Tools {
+
+template<typename MHRWMovingAverageAcceptanceRatioStatsCollectorType,
+         typename BaseLoggerType,
+         typename StepRealType,
+         typename IterCountIntType>
+struct TOMOGRAPHER_EXPORT
+StatusProvider<MHRWHMCStepSizeController<MHRWMovingAverageAcceptanceRatioStatsCollectorType,
+                                         BaseLoggerType, StepRealType, IterCountIntType> >
+{
+  typedef MHRWHMCStepSizeController<MHRWMovingAverageAcceptanceRatioStatsCollectorType,
+                                    BaseLoggerType, StepRealType, IterCountIntType> StatusableObject;
+
+  static constexpr bool CanProvideStatusLine = true;
+
+  static inline std::string getStatusLine(const StatusableObject * obj) {
+    double last_step = (double)obj->getLastSetStepSize();
+    if (std::isfinite(last_step)) {
+      return Tomographer::Tools::fmts("leapfrog step size = %.3g", last_step);
+    } else {
+      return std::string();
+    }
+  }
+};
+
+}
+
+
+
+} // namespace Tomographer
+
+
+
+#endif
@@ -32,6 +32,8 @@
 
 #include <limits>
 #include <tuple>
+#include <vector>
+#include <memory>
 #include <utility>
 #include <type_traits>
 #include <typeinfo>
@@ -41,6 +43,7 @@
 #include <tomographer/tools/loggers.h>
 #include <tomographer/tools/statusprovider.h>
 #include <tomographer/histogram.h>
+#include <tomographer/valuecalculator.h>
 #include <tomographer/mhrw.h> // MHRWStatusReport
 #include <tomographer/mhrw_bin_err.h>
 
@@ -125,6 +128,28 @@ struct multistatscoll_result_type_helper2 {
   }
 };
 
+// number of iterations per sweep of the random walk, if the random walk can tell us
+// (otherwise, consider every iteration)
+template<typename MHRandomWalk, typename dummy = void>
+struct mhrw_sweep_size_helper {
+  template<typename CountIntType>
+  static inline CountIntType get(const MHRandomWalk & ) { return 1; }
+};
+template<typename MHRandomWalk>
+struct mhrw_sweep_size_helper<
+  MHRandomWalk,
+  decltype((void)std::declval<const MHRandomWalk&>().nSweep())
+  >
+{
+  template<typename CountIntType>
+  static inline CountIntType get(const MHRandomWalk & rw) { return (CountIntType)rw.nSweep(); }
+};
+template<typename CountIntType, typename MHRandomWalk>
+inline CountIntType mhrw_sweep_size(const MHRandomWalk & rw)
+{
+  return mhrw_sweep_size_helper<MHRandomWalk>::template get<CountIntType>(rw);
+}
+
 } // namespace tomo_internal
 
 
@@ -431,6 +456,18 @@ public:
  * same type as the point type of the random walk; the current point of the random walk is
  * passed on as is.
  *
+ * The range of the histogram may optionally be chosen automatically during the
+ * thermalization sweeps, see \ref HistogramAdaptiveRange.  In this case, the value is
+ * calculated once per sweep during thermalization, and the range is frozen at \ref
+ * thermalizingDone() based on the most recent values.  The number of bins given in the
+ * histogram parameters is kept.  The histogram parameters given to the constructor are
+ * used as a fallback in case no pilot value could be collected.  Samples which fall
+ * outside of the frozen range are remembered (up to \ref
+ * HistogramAdaptiveRange::max_overflow of them), and the range is extended to include
+ * them in \ref done().  The range is extended by at most the original number of bins on
+ * each side, and never beyond HistogramAdaptiveRange::lower_bound and
+ * HistogramAdaptiveRange::upper_bound; samples beyond that are counted as off-chart.
+ *
  */
 template<typename ValueCalculator_,
 	 typename LoggerType = Logger::VacuumLogger,
@@ -457,6 +494,12 @@ public:
   //! Structure which holds the parameters of the histogram we're recording
   typedef typename HistogramType::Params HistogramParams;
 
+  //! How to choose the histogram range automatically (see \ref HistogramAdaptiveRange)
+  typedef HistogramAdaptiveRange<typename HistogramParams::Scalar> AdaptiveRange;
+
+  //! A sample which fell outside of the adaptive histogram range: (sample index, value)
+  typedef std::pair<Eigen::Index, ValueType> OverflowSample;
+
 private:
 
   //! Store the histogram
@@ -470,14 +513,32 @@ private:
 
   LoggerType & _logger;
 
+  //! Parameters to use if the adaptive range could not be determined
+  const HistogramParams _fallback_params;
+
+  const AdaptiveRange _adaptive_range;
+
+  //! Ring buffer of the most recent pilot values recorded during thermalization
+  std::vector<ValueType> _pilot_values;
+  std::size_t _pilot_pos;
+
+  //! Off-chart samples, remembered in case we want to extend the histogram range
+  std::vector<OverflowSample> _overflow;
+
 public:
   //! Simple constructor, initializes with the given values
   ValueHistogramMHRWStatsCollector(HistogramParams histogram_params,
 				   const ValueCalculator & vcalc,
-				   LoggerType & logger)
+				   LoggerType & logger,
+                                   AdaptiveRange adaptive_range = AdaptiveRange())
     : _histogram(histogram_params),
       _vcalc(vcalc),
-      _logger(logger)
+      _logger(logger),
+      _fallback_params(histogram_params),
+      _adaptive_range(adaptive_range),
+      _pilot_values(),
+      _pilot_pos(0),
+      _overflow()
   {
   }
 
@@ -513,6 +574,23 @@ public:
     return std::move(_histogram);
   }
 
+  //! The settings for choosing the histogram range automatically
+  inline const AdaptiveRange & adaptiveRange() const
+  {
+    return _adaptive_range;
+  }
+
+  /** \brief The samples which fell outside of the adaptive histogram range
+   *
+   * Only samples with a finite value are remembered, and at most \ref
+   * HistogramAdaptiveRange::max_overflow of them.  These samples remain listed here after
+   * the histogram range was extended in \ref done().
+   */
+  inline const std::vector<OverflowSample> & overflowSamples() const
+  {
+    return _overflow;
+  }
+
   // stats collector part
 
   //! Part of the \ref pageInterfaceMHRWStatsCollector. Initializes the histogram to zeros.
@@ -520,21 +598,47 @@ public:
   {
     // reset our array
     _histogram.reset();
+    _pilot_values.clear();
+    _pilot_pos = 0;
+    _overflow.clear();
+    if (_adaptive_range.enabled()) {
+      _pilot_values.reserve((std::size_t)_adaptive_range.num_pilot_samples);
+    }
   }
-  //! Part of the \ref pageInterfaceMHRWStatsCollector. No-op.
+  /** \brief Part of the \ref pageInterfaceMHRWStatsCollector.
+   *
+   * If an adaptive range was requested, then this is where the range of the histogram is
+   * frozen.  Otherwise, this is a no-op.
+   */
   inline void thermalizingDone()
   {
+    if (!_adaptive_range.enabled()) {
+      return;
+    }
+    _histogram.params = _adaptive_range.freeze(_pilot_values, _fallback_params);
+    _histogram.reset();
+    _logger.debug("ValueHistogramMHRWStatsCollector", [&](std::ostream & stream) {
+        stream << "Histogram range frozen from " << _pilot_values.size() << " pilot values to ["
+               << _histogram.params.min << ", " << _histogram.params.max << "[ with "
+               << _histogram.params.num_bins << " bins";
+      });
+    _pilot_values.clear();
+    _pilot_values.shrink_to_fit();
   }
   /** \brief Part of the \ref pageInterfaceMHRWStatsCollector.
+   *
+   * If some samples were recorded in \ref overflowSamples(), then the histogram range is
+   * extended by whole bins in order to include those samples.
    *
    * If you call this function with \a PrintHistogram=true (the default), then this will
    * display the final histogram in the logger at logging level \a Logger::LONGDEBUG.
-   *
-   * If this function is called with \a PrintHistogram=false, then this is a no-op.
    */
   template<bool PrintHistogram = true>
   inline void done()
   {
+    if (_overflow.size()) {
+      _extend_to_overflow();
+    }
     if (PrintHistogram) {
       if (_logger.enabledFor(Logger::LONGDEBUG)) {
 	// _logger.longdebug("ValueHistogramMHRWStatsCollector", "done()");
@@ -545,23 +649,38 @@ public:
     }
   }
 
-  //! Part of the \ref pageInterfaceMHRWStatsCollector. No-op.
+  /** \brief Part of the \ref pageInterfaceMHRWStatsCollector.
+   *
+   * Records pilot values during thermalization if an adaptive range was requested,
+   * otherwise this is a no-op.
+   */
   template<typename CountIntType, typename PointType, typename LLHValueType, typename MHRandomWalk>
-  void rawMove(CountIntType k, bool /*is_thermalizing*/, bool /*is_live_iter*/, bool /*accepted*/,
+  void rawMove(CountIntType k, bool is_thermalizing, bool /*is_live_iter*/, bool /*accepted*/,
                 double /*a*/, const PointType & /*newpt*/, LLHValueType /*newptval*/,
-                const PointType & /*curpt*/, LLHValueType /*curptval*/, MHRandomWalk & /*mh*/)
+                const PointType & curpt, LLHValueType /*curptval*/, MHRandomWalk & mh)
   {
     _logger.longdebug("ValueHistogramMHRWStatsCollector", [&](std::ostream & stream) {
 	stream << "rawMove(): k=" << k;
       });
+
+    if (is_thermalizing && _adaptive_range.enabled() &&
+        (k+1) % tomo_internal::mhrw_sweep_size<CountIntType>(mh) == 0) {
+      const ValueType val = getValueAtCurrentPoint(_vcalc, curpt, mh);
+      if (_pilot_values.size() < (std::size_t)_adaptive_range.num_pilot_samples) {
+        _pilot_values.push_back(val);
+      } else {
+        _pilot_values[_pilot_pos] = val;
+        _pilot_pos = (_pilot_pos + 1) % _pilot_values.size();
+      }
+    }
   }
 
   //! Part of the \ref pageInterfaceMHRWStatsCollector. Records the sample in the histogram.
   template<typename CountIntType, typename PointType, typename LLHValueType, typename MHRandomWalk>
   Eigen::Index processSample(CountIntType k, CountIntType n, const PointType & curpt,
-                             LLHValueType /*curptval*/, MHRandomWalk & /*mh*/)
+                             LLHValueType /*curptval*/, MHRandomWalk & mh)
   {
-    ValueType val = _vcalc.getValue(curpt);
+    ValueType val = getValueAtCurrentPoint(_vcalc, curpt, mh);
 
     _logger.longdebug("ValueHistogramMHRWStatsCollector", [&](std::ostream & stream) {
 	stream << "in processSample(): "
@@ -572,11 +691,79 @@ public:
 	       << " [with ValueType=" << typeid(ValueType).name() << "]" ;
       });
 
-    return _histogram.record(val);
+    const Eigen::Index index = _histogram.record(val);
+    if (index < 0 && _adaptive_range.enabled() && Tools::isFinite(val) &&
+        _overflow.size() < (std::size_t)_adaptive_range.max_overflow) {
+      // remember the position of this sample in the sequence of recorded samples
+      _overflow.push_back(OverflowSample((Eigen::Index)_histogram.totalCounts() - 1, val));
+    }
+    return index;
 
     //_logger.longdebug("ValueHistogramMHRWStatsCollector", "processSample() finished");
   }
- 
+
+private:
+
+  void _extend_to_overflow()
+  {
+    typedef typename HistogramParams::Scalar Scalar;
+    const HistogramParams p = _histogram.params;
+    const Scalar w = p.binResolution();
+
+    // the range is never extended beyond the hard bounds of the adaptive range, nor by
+    // more than the original number of bins on each side; samples beyond that remain
+    // off-chart
+    Scalar max_nlo = Scalar(p.num_bins);
+    Scalar max_nhi = Scalar(p.num_bins);
+    if (Tools::isFinite(_adaptive_range.lower_bound)) {
+      max_nlo = std::min(max_nlo, std::max(Scalar(0), std::ceil((p.min - _adaptive_range.lower_bound) / w)));
+    }
+    if (Tools::isFinite(_adaptive_range.upper_bound)) {
+      // the upper limit of the range is excluded, so a value equal to upper_bound needs
+      // one more bin
+      max_nhi = std::min(max_nhi, std::max(Scalar(0), std::floor((_adaptive_range.upper_bound - p.max) / w) + 1));
+    }
+
+    // number of bins to add below and above the current range, keeping bin edges on the
+    // same grid
+    Scalar nlo_s = 0;
+    Scalar nhi_s = 0;
+    for (const auto & ov : _overflow) {
+      if (ov.second < p.min) {
+        nlo_s = std::max(nlo_s, std::min(max_nlo, std::ceil((p.min - ov.second) / w)));
+      } else if (ov.second >= p.max) {
+        nhi_s = std::max(nhi_s, std::min(max_nhi, std::floor((ov.second - p.max) / w) + 1));
+      }
+    }
+    const Eigen::Index nlo = (Eigen::Index)nlo_s;
+    const Eigen::Index nhi = (Eigen::Index)nhi_s;
+    if (nlo == 0 && nhi == 0) {
+      _logger.debug("ValueHistogramMHRWStatsCollector", [&](std::ostream & stream) {
+          stream << "Can't extend histogram range beyond its bounds, " << _overflow.size()
+                 << " samples remain off-chart";
+        });
+      return;
+    }
+
+    _histogram.params = HistogramParams(p.min - nlo*w, p.max + nhi*w, p.num_bins + nlo + nhi);
+    decltype(_histogram.bins) newbins(_histogram.params.num_bins);
+    newbins.setZero();
+    newbins.segment(nlo, p.num_bins) = _histogram.bins;
+    _histogram.bins = std::move(newbins);
+
+    for (const auto & ov : _overflow) {
+      if (_histogram.params.isWithinBounds(ov.second)) {
+        ++_histogram.bins(_histogram.params.binIndexUnsafe(ov.second));
+        --_histogram.off_chart;
+      }
+    }
+
+    _logger.debug("ValueHistogramMHRWStatsCollector", [&](std::ostream & stream) {
+        stream << "Extended histogram range to [" << _histogram.params.min << ", "
+               << _histogram.params.max << "[ to include off-chart samples, "
+               << _histogram.off_chart << " samples remain off-chart";
+      });
+  }
 
 };
 
@@ -841,11 +1028,29 @@ private:
 
 public:
     
+  //! How to choose the histogram range automatically (see \ref HistogramAdaptiveRange)
+  typedef typename ValueHistogramMHRWStatsCollectorType::AdaptiveRange AdaptiveRange;
+
+  /** \brief Constructor
+   *
+   * If \a adaptive_range is enabled, the histogram range is chosen during thermalization
+   * (see \ref ValueHistogramMHRWStatsCollector).  The number of bins is fixed by \a
+   * histogram_params in any case.  Samples which fell outside of the range are included
+   * in the final result by extending the histogram range, and their error bars are
+   * determined by a separate binning analysis at the end of the random walk; this is only
+   * possible if the number of tracked values is dynamic (\a NumTrackValuesCTime is \a
+   * Eigen::Dynamic), otherwise such samples are simply counted as off-chart.
+   */
   ValueHistogramWithBinningMHRWStatsCollector(HistogramParams histogram_params,
                                               const ValueCalculator & vcalc,
                                               int num_levels,
-                                              LoggerType & logger_)
-    : value_histogram(histogram_params, vcalc, logger_),
+                                              LoggerType & logger_,
+                                              AdaptiveRange adaptive_range = AdaptiveRange())
+    : value_histogram(histogram_params, vcalc, logger_,
+                      (NumTrackValuesCTime == Eigen::Dynamic
+                       ? adaptive_range
+                       : AdaptiveRange(adaptive_range.num_pilot_samples, 0, adaptive_range.lower_bound,
+                                       adaptive_range.upper_bound, adaptive_range.margin))),
       binning_analysis((int)histogram_params.num_bins, num_levels, logger_),
       logger(logger_),
       result(histogram_params, binning_analysis)
@@ -917,6 +1122,9 @@ public:
   {
     logger.longdebug("ValueHistogramWithBinningMHRWStatsCollector::done()", "finishing up ...");
 
+    // the range the binning analysis refers to, before any extension to off-chart samples
+    const HistogramParams tracked_params = value_histogram.histogram().params;
+
     value_histogram.template done<false>();
 
     //
@@ -932,12 +1140,16 @@ public:
     result.histogram.params = h.params;
     CountRealAvgType numsamples = h.bins.sum() + h.off_chart;
     result.histogram.bins = h.bins.template cast<CountRealAvgType>() / numsamples;
-    result.error_levels = binning_analysis.calcErrorLevels(result.histogram.bins);
+    if (h.numBins() == binning_analysis.numTrackValues()) {
+      result.error_levels = binning_analysis.calcErrorLevels(result.histogram.bins);
+      result.converged_status = binning_analysis.determineErrorConvergence(result.error_levels);
+    } else {
+      // the histogram range was extended to include off-chart samples
+      _calc_error_levels_extended(tracked_params);
+    }
     result.histogram.delta = result.error_levels.col(binning_analysis.numLevels()).template cast<CountRealAvgType>();
     result.histogram.off_chart = h.off_chart / numsamples;
 
-    result.converged_status = binning_analysis.determineErrorConvergence(result.error_levels);
-
     logger.debug("ValueHistogramWithBinningMHRWStatsCollector", [&,this](std::ostream & str) {
         str << "Binning analysis: bin sqmeans at different binning levels are:\n"
             << binning_analysis.getBinSqmeans() << "\n"
@@ -972,6 +1184,66 @@ public:
 	);
   }
 
+private:
+
+  // Error bars when the histogram range was extended to include the overflow samples.  The
+  // bins within tracked_params are taken care of by our binning analysis.  For the added
+  // bins, we know exactly which samples fell into them, so we can run a separate binning
+  // analysis on their indicator functions (which are zero for all other samples).
+  template<bool dummy = true, TOMOGRAPHER_ENABLED_IF_TMPL(dummy && NumTrackValuesCTime == Eigen::Dynamic)>
+  inline void _calc_error_levels_extended(const HistogramParams & tracked_params)
+  {
+    const BaseHistogramType & h = value_histogram.histogram();
+    const auto & overflow = value_histogram.overflowSamples();
+
+    const Eigen::Index num_tracked = tracked_params.num_bins;
+    const Eigen::Index nlo = (Eigen::Index)std::floor((tracked_params.min - h.params.min)
+                                                      / h.params.binResolution() + 0.5);
+    const Eigen::Index nhi = h.numBins() - num_tracked - nlo;
+
+    BinningAnalysisType overflow_analysis((int)(nlo + nhi), binning_analysis.numLevels(), logger);
+
+    const CountIntType numsamples = h.bins.sum() + h.off_chart;
+    Eigen::Array<ValueType,Eigen::Dynamic,1> x(nlo + nhi);
+    auto it = overflow.begin();
+    for (CountIntType n = 0; n < numsamples; ++n) {
+      x.setZero();
+      for ( ; it != overflow.end() && it->first == (Eigen::Index)n; ++it) {
+        if (h.params.isWithinBounds(it->second)) {
+          const Eigen::Index j = h.params.binIndexUnsafe(it->second);
+          x(j < nlo ? j : j - num_tracked) = 1;
+        }
+      }
+      overflow_analysis.processNewValues(x);
+    }
+
+    Eigen::Array<CountRealAvgType,Eigen::Dynamic,1> overflow_means(nlo + nhi);
+    overflow_means << result.histogram.bins.head(nlo), result.histogram.bins.tail(nhi);
+    const typename BinningAnalysisType::BinSumSqArray overflow_error_levels =
+      overflow_analysis.calcErrorLevels(overflow_means);
+    const typename BinningAnalysisType::BinSumSqArray tracked_error_levels =
+      binning_analysis.calcErrorLevels(result.histogram.bins.segment(nlo, num_tracked));
+
+    result.error_levels.resize(h.numBins(), binning_analysis.numLevels()+1);
+    result.error_levels.topRows(nlo) = overflow_error_levels.topRows(nlo);
+    result.error_levels.middleRows(nlo, num_tracked) = tracked_error_levels;
+    result.error_levels.bottomRows(nhi) = overflow_error_levels.bottomRows(nhi);
+
+    const Eigen::ArrayXi overflow_converged_status =
+      overflow_analysis.determineErrorConvergence(overflow_error_levels);
+    result.converged_status.resize(h.numBins());
+    result.converged_status.head(nlo) = overflow_converged_status.head(nlo);
+    result.converged_status.segment(nlo, num_tracked) =
+      binning_analysis.determineErrorConvergence(tracked_error_levels);
+    result.converged_status.tail(nhi) = overflow_converged_status.tail(nhi);
+  }
+  template<bool dummy = true, TOMOGRAPHER_ENABLED_IF_TMPL(dummy && NumTrackValuesCTime != Eigen::Dynamic)>
+  inline void _calc_error_levels_extended(const HistogramParams & )
+  {
+    // we never ask value_histogram to remember overflow samples in this case
+    tomographer_assert(false && "Histogram with fixed number of bins can't be extended");
+  }
+
 };
 
 
@@ -985,13 +1257,16 @@ ValueHistogramMHRWStatsCollector<ValueCalculator_, LoggerType, HistogramType_>
 mkValueHistogramMHRWStatsCollector(
     typename HistogramType_::Params hist_params,
     ValueCalculator_ valcalc,
-    LoggerType & logger
+    LoggerType & logger,
+    HistogramAdaptiveRange<typename HistogramType_::Params::Scalar> adaptive_range =
+        HistogramAdaptiveRange<typename HistogramType_::Params::Scalar>()
     )
 {
   return ValueHistogramMHRWStatsCollector<ValueCalculator_, LoggerType, HistogramType_>(
       std::move(hist_params),
       std::move(valcalc), 
-      logger
+      logger,
+      adaptive_range
       ) ;
 }
 
@@ -1014,7 +1289,9 @@ mkValueHistogramWithBinningMHRWStatsCollector(
     HistogramParams<typename ValueCalculator_::ValueType> hist_params,
     ValueCalculator_ valcalc,
     int num_binning_levels,
-    LoggerType & logger
+    LoggerType & logger,
+    HistogramAdaptiveRange<typename ValueCalculator_::ValueType> adaptive_range =
+        HistogramAdaptiveRange<typename ValueCalculator_::ValueType>()
     )
 {
   return
@@ -1023,7 +1300,442 @@ mkValueHistogramWithBinningMHRWStatsCollector(
                                                         CountRealAvgType_, NumTrackValues_,
                                                         NumLevels_>,
       LoggerType
-    >(std::move(hist_params), std::move(valcalc), num_binning_levels, logger) ;
+    >(std::move(hist_params), std::move(valcalc), num_binning_levels, logger, adaptive_range) ;
+}
+
+
+
+/** \brief Collect histograms of several values from a MH random walk, with binning analysis
+ *
+ * The values are calculated by a single \a MultiValueCalculator (see \ref
+ * MultiValueCalculatorCache for the required interface), which is invoked at most once
+ * per sample point.  Each value is then histogrammed by its own \ref
+ * ValueHistogramWithBinningMHRWStatsCollector, so that the result is a list of histograms
+ * with binning analysis error bars, one for each value.
+ *
+ * This allows to study several figures of merit with a single random walk, while sharing
+ * common intermediate computations among the figures of merit.
+ *
+ * If there are no values, then no cache is allocated and the stats collector callbacks
+ * return immediately, so the collector may be included unconditionally in a random walk
+ * at no cost and its result is an empty list.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename MultiValueCalculator_,
+         typename CountIntType_ = int,
+         typename CountRealAvgType_ = double,
+         typename LoggerType_ = Logger::VacuumLogger>
+class TOMOGRAPHER_EXPORT MultipleValueHistogramsWithBinningMHRWStatsCollector
+{
+public:
+  //! The type which calculates all our values at once
+  typedef MultiValueCalculator_ MultiValueCalculator;
+  //! Type used to count the number of hits in each bin
+  typedef CountIntType_ CountIntType;
+  //! Type used to store the averages of the histogram bins
+  typedef CountRealAvgType_ CountRealAvgType;
+  //! Somewhere where this object may log what it's doing
+  typedef LoggerType_ LoggerType;
+
+  //! The cache which remembers all the values of the current point
+  typedef MultiValueCalculatorCache<MultiValueCalculator> CacheType;
+  //! The value calculator used by each individual histogram collector
+  typedef MultiValueComponentCalculator<MultiValueCalculator> ComponentValueCalculator;
+  //! The \ref ValueHistogramWithBinningMHRWStatsCollectorParams for each value
+  typedef ValueHistogramWithBinningMHRWStatsCollectorParams<ComponentValueCalculator,
+                                                            CountIntType,
+                                                            CountRealAvgType>  ComponentParams;
+  //! The stats collector which takes care of each value
+  typedef ValueHistogramWithBinningMHRWStatsCollector<ComponentParams, LoggerType>  ComponentStatsCollector;
+
+  //! The histogram parameters for each value
+  typedef typename ComponentParams::HistogramParams HistogramParams;
+  //! How to choose the histogram range automatically for each value
+  typedef typename ComponentStatsCollector::AdaptiveRange AdaptiveRange;
+
+  //! The result for each value
+  typedef typename ComponentParams::Result ComponentResultType;
+  //! The result type: a list with the result for each value, in order
+  typedef std::vector<ComponentResultType> ResultType;
+
+private:
+  // these are held by pointer, because the component value calculators refer to the cache
+  // and should remain valid if we are moved
+  std::unique_ptr<CacheType> _cache;
+  std::vector<std::unique_ptr<ComponentStatsCollector> > _collectors;
+
+  ResultType _result;
+
+  LoggerType & _logger;
+
+public:
+  /** \brief Constructor
+   *
+   * \param histogram_params_list The histogram parameters for each value; there must be
+   *        exactly <code>mvcalc.numValues()</code> entries.
+   *
+   * \param mvcalc The multi-value calculator.
+   *
+   * \param num_levels The number of binning levels for the binning analysis.
+   *
+   * \param logger Where to log our messages.
+   *
+   * \param adaptive_range_list If nonempty, then it must have one entry for each value,
+   *        specifying whether and how to choose the corresponding histogram range during
+   *        thermalization (see \ref HistogramAdaptiveRange).
+   */
+  MultipleValueHistogramsWithBinningMHRWStatsCollector(const std::vector<HistogramParams> & histogram_params_list,
+                                                       MultiValueCalculator mvcalc,
+                                                       int num_levels,
+                                                       LoggerType & logger,
+                                                       const std::vector<AdaptiveRange> & adaptive_range_list
+                                                       = std::vector<AdaptiveRange>())
+    : _cache(),
+      _collectors(),
+      _result(),
+      _logger(logger)
+  {
+    tomographer_assert((Eigen::Index)histogram_params_list.size() == mvcalc.numValues()
+                       && "There must be exactly one HistogramParams for each value") ;
+    tomographer_assert((adaptive_range_list.size() == 0 ||
+                        adaptive_range_list.size() == histogram_params_list.size())
+                       && "There must be exactly one AdaptiveRange for each value, if any") ;
+
+    if (histogram_params_list.empty()) {
+      // nothing to collect; the stats collector callbacks are all no-ops
+      return;
+    }
+
+    _cache.reset(new CacheType(std::move(mvcalc)));
+
+    for (std::size_t i = 0; i < histogram_params_list.size(); ++i) {
+      _collectors.push_back(std::unique_ptr<ComponentStatsCollector>(
+          new ComponentStatsCollector(histogram_params_list[i],
+                                      ComponentValueCalculator(_cache.get(), (Eigen::Index)i),
+                                      num_levels,
+                                      _logger,
+                                      (adaptive_range_list.size() ? adaptive_range_list[i] : AdaptiveRange()))
+          ));
+    }
+  }
+
+  //! The number of values we are collecting histograms for
+  inline std::size_t numValues() const { return _collectors.size(); }
+
+  //! The stats collector which takes care of the \a i-th value
+  inline const ComponentStatsCollector & getStatsCollector(std::size_t i) const
+  {
+    return *_collectors[i];
+  }
+
+  /** \brief Get the final histograms, one for each value (\ref pageInterfaceResultable)
+   *
+   * This will only yield a valid value AFTER the all the data has been collected and \ref
+   * done() was called.
+   */
+  inline const ResultType & getResult() const
+  {
+    return _result;
+  }
+
+  /** \brief Retrieve the final histograms, one for each value (\ref pageInterfaceResultable)
+   *
+   * \warning Calling this function moves the result type to the returned type.  Further
+   *          calls to getResult() and/or stealResult() have undefined behavior.
+   */
+  inline ResultType stealResult()
+  {
+    return std::move(_result);
+  }
+
+  // stats collector part
+
+  //! Part of the \ref pageInterfaceMHRWStatsCollector.
+  inline void init()
+  {
+    if (_collectors.empty()) {
+      return;
+    }
+    _cache->invalidate();
+    for (auto & c : _collectors) {
+      c->init();
+    }
+  }
+  //! Part of the \ref pageInterfaceMHRWStatsCollector.
+  inline void thermalizingDone()
+  {
+    for (auto & c : _collectors) {
+      c->thermalizingDone();
+    }
+  }
+  //! Part of the \ref pageInterfaceMHRWStatsCollector. Collects the results of all values.
+  inline void done()
+  {
+    _result.clear();
+    _result.reserve(_collectors.size());
+    for (auto & c : _collectors) {
+      c->done();
+      _result.push_back(c->stealResult());
+    }
+  }
+
+  //! Part of the \ref pageInterfaceMHRWStatsCollector.
+  template<typename CountIntType2, typename PointType, typename LLHValueType, typename MHRandomWalk>
+  inline void rawMove(CountIntType2 k, bool is_thermalizing, bool is_live_iter, bool accepted,
+                      double a, const PointType & newpt, LLHValueType newptval,
+                      const PointType & curpt, LLHValueType curptval, MHRandomWalk & mh)
+  {
+    if (_collectors.empty()) {
+      return;
+    }
+    _cache->invalidate();
+    for (auto & c : _collectors) {
+      c->rawMove(k, is_thermalizing, is_live_iter, accepted, a, newpt, newptval, curpt, curptval, mh);
+    }
+  }
+
+  //! Part of the \ref pageInterfaceMHRWStatsCollector. Records the sample in each histogram.
+  template<typename CountIntType2, typename PointType, typename LLHValueType, typename MHRandomWalk>
+  inline void processSample(CountIntType2 k, CountIntType2 n, const PointType & curpt,
+                            LLHValueType curptval, MHRandomWalk & mh)
+  {
+    if (_collectors.empty()) {
+      return;
+    }
+    _cache->invalidate();
+    for (auto & c : _collectors) {
+      c->processSample(k, n, curpt, curptval, mh);
+    }
+  }
+};
+
+
+/** \brief Helper to easily instantiate a \ref MultipleValueHistogramsWithBinningMHRWStatsCollector
+ *
+ */
+template<typename CountIntType_ = int, typename CountRealAvgType_ = double,
+         typename MultiValueCalculator_ = void, typename LoggerType = Logger::VacuumLogger>
+inline
+MultipleValueHistogramsWithBinningMHRWStatsCollector<MultiValueCalculator_, CountIntType_,
+                                                     CountRealAvgType_, LoggerType>
+mkMultipleValueHistogramsWithBinningMHRWStatsCollector(
+    const std::vector<HistogramParams<typename MultiValueCalculator_::ValueType> > & hist_params_list,
+    MultiValueCalculator_ mvcalc,
+    int num_binning_levels,
+    LoggerType & logger,
+    const std::vector<HistogramAdaptiveRange<typename MultiValueCalculator_::ValueType> > & adaptive_range_list =
+        std::vector<HistogramAdaptiveRange<typename MultiValueCalculator_::ValueType> >()
+    )
+{
+  return MultipleValueHistogramsWithBinningMHRWStatsCollector<MultiValueCalculator_, CountIntType_,
+                                                              CountRealAvgType_, LoggerType>(
+      hist_params_list, std::move(mvcalc), num_binning_levels, logger, adaptive_range_list
+      ) ;
+}
+
+
+
+/** \brief Collect a joint histogram of two values from a MH random walk, with binning analysis.
+ *
+ * Two values are calculated at each sample point by two \ref
+ * pageInterfaceValueCalculator's, \a ValueCalculatorX_ and \a ValueCalculatorY_, and the
+ * pair is recorded in a \ref Histogram2D.  This allows to study the correlations between
+ * two figures of merit without having to store the samples themselves.
+ *
+ * Error bars are determined by a binning analysis applied to the indicator function of
+ * each bin of the two-dimensional grid, in the same way as for \ref
+ * ValueHistogramWithBinningMHRWStatsCollector.  Note that the memory required by the
+ * binning analysis grows as the total number of bins times <code>2^num_levels</code>.
+ *
+ * The result is a \ref ValueHistogramWithBinningMHRWStatsCollectorResult whose histogram
+ * is a \ref Histogram2DWithErrorBars; results of several tasks may be combined with \ref
+ * AggregatedHistogram2DWithErrorBars.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename ValueCalculatorX_, typename ValueCalculatorY_ = ValueCalculatorX_,
+         typename CountIntType_ = int, typename CountRealAvgType_ = double,
+         typename LoggerType_ = Logger::VacuumLogger>
+class TOMOGRAPHER_EXPORT ValueHistogram2DWithBinningMHRWStatsCollector
+{
+public:
+  //! The value calculator for the first value
+  typedef ValueCalculatorX_ ValueCalculatorX;
+  //! The value calculator for the second value
+  typedef ValueCalculatorY_ ValueCalculatorY;
+  //! Type used to count the number of hits in each bin
+  typedef CountIntType_ CountIntType;
+  //! Type used to store the averages of the histogram bins
+  typedef CountRealAvgType_ CountRealAvgType;
+  //! Somewhere where this object may log what it's doing
+  typedef LoggerType_ LoggerType;
+
+  //! The type of the values which are histogrammed
+  typedef typename std::common_type<typename ValueCalculatorX::ValueType,
+                                    typename ValueCalculatorY::ValueType>::type ValueType;
+
+  //! The histogram type which simply stores the bin counts
+  typedef Histogram2D<ValueType, CountIntType> BaseHistogramType;
+  //! The final histogram type (with error bars)
+  typedef Histogram2DWithErrorBars<ValueType, CountRealAvgType> HistogramType;
+  //! The corresponding histogram params type
+  typedef typename HistogramType::Params HistogramParams;
+
+  //! The relevant \ref BinningAnalysis parameters for us
+  typedef BinningAnalysisParams<ValueType, Eigen::Dynamic, Eigen::Dynamic, false/*StoreBinSums*/, CountIntType>
+  BinningAnalysisParamsType;
+  //! The corresponding \ref BinningAnalysis type
+  typedef BinningAnalysis<BinningAnalysisParamsType, LoggerType> BinningAnalysisType;
+
+  //! The result type of this stats collector
+  typedef ValueHistogramWithBinningMHRWStatsCollectorResult<HistogramType, BinningAnalysisParamsType> ResultType;
+
+private:
+  ValueCalculatorX _vcalc_x;
+  ValueCalculatorY _vcalc_y;
+
+  BaseHistogramType _histogram;
+
+  BinningAnalysisType _binning_analysis;
+
+  LoggerType & _logger;
+
+  ResultType _result;
+
+public:
+
+  //! Constructor
+  ValueHistogram2DWithBinningMHRWStatsCollector(HistogramParams histogram_params,
+                                                const ValueCalculatorX & vcalc_x,
+                                                const ValueCalculatorY & vcalc_y,
+                                                int num_levels,
+                                                LoggerType & logger_)
+    : _vcalc_x(vcalc_x),
+      _vcalc_y(vcalc_y),
+      _histogram(histogram_params),
+      _binning_analysis((int)histogram_params.numBins(), num_levels, logger_),
+      _logger(logger_),
+      _result(histogram_params, _binning_analysis)
+  {
+    _logger.longdebug("ValueHistogram2DWithBinningMHRWStatsCollector", "constructor()");
+  }
+
+  //! Get the histogram data collected so far. See \ref BaseHistogramType .
+  inline const BaseHistogramType & histogram() const
+  {
+    return _histogram;
+  }
+
+  inline const BinningAnalysisType & getBinningAnalysis() const
+  {
+    return _binning_analysis;
+  }
+
+  //! Get the current bin means collected so far.
+  inline Eigen::Array<CountRealAvgType,Eigen::Dynamic,1> binMeans() const
+  {
+    return _histogram.bins.template cast<CountRealAvgType>() /
+      (CountRealAvgType)(_histogram.bins.sum() + _histogram.off_chart);
+  }
+
+  /** \brief Get the final histogram data, in compliance with \ref pageInterfaceResultable.
+   *
+   * This will only yield a valid value AFTER the all the data has been collected and \ref
+   * done() was called.
+   */
+  inline const ResultType & getResult() const
+  {
+    return _result;
+  }
+
+  /** \brief Retrieve the final histogram data, in compliance with \ref
+   *         pageInterfaceResultable.
+   *
+   * \warning Calling this function moves the result type to the returned type.  Further
+   *          calls to getResult() and/or stealResult() have undefined behavior.
+   */
+  inline ResultType stealResult()
+  {
+    return std::move(_result);
+  }
+
+  //! Part of the \ref pageInterfaceMHRWStatsCollector. Initializes the histogram to zeros.
+  inline void init()
+  {
+    _histogram.reset();
+  }
+  //! Part of the \ref pageInterfaceMHRWStatsCollector. No-op.
+  inline void thermalizingDone()
+  {
+  }
+  //! Finalize the data collection. Part of the \ref pageInterfaceMHRWStatsCollector.
+  inline void done()
+  {
+    _logger.longdebug("ValueHistogram2DWithBinningMHRWStatsCollector::done()", "finishing up ...");
+
+    // see ValueHistogramWithBinningMHRWStatsCollector::done()
+    const CountRealAvgType numsamples = _histogram.bins.sum() + _histogram.off_chart;
+    _result.histogram.params = _histogram.params;
+    _result.histogram.bins = _histogram.bins.template cast<CountRealAvgType>() / numsamples;
+    _result.error_levels = _binning_analysis.calcErrorLevels(_result.histogram.bins);
+    _result.converged_status = _binning_analysis.determineErrorConvergence(_result.error_levels);
+    _result.histogram.delta =
+      _result.error_levels.col(_binning_analysis.numLevels()).template cast<CountRealAvgType>();
+    _result.histogram.off_chart = _histogram.off_chart / numsamples;
+
+    _logger.debug("ValueHistogram2DWithBinningMHRWStatsCollector", [&,this](std::ostream & str) {
+        str << "Binning analysis: convergence analysis of the error bars:\n";
+        _result.dumpConvergenceAnalysis(str);
+      });
+  }
+
+  //! Part of the \ref pageInterfaceMHRWStatsCollector. No-op.
+  template<typename CountIntType2, typename PointType, typename LLHValueType, typename MHRandomWalk>
+  inline void rawMove(CountIntType2 , bool , bool , bool , double , const PointType & , LLHValueType ,
+                      const PointType & , LLHValueType , MHRandomWalk & )
+  {
+  }
+
+  //! Part of the \ref pageInterfaceMHRWStatsCollector. Records the sample in the histogram.
+  template<typename CountIntType2, typename PointType, typename LLHValueType, typename MHRandomWalk>
+  inline void processSample(CountIntType2 , CountIntType2 , const PointType & curpt,
+                            LLHValueType , MHRandomWalk & mh)
+  {
+    const Eigen::Index histindex = _histogram.record(getValueAtCurrentPoint(_vcalc_x, curpt, mh),
+                                                     getValueAtCurrentPoint(_vcalc_y, curpt, mh));
+    _binning_analysis.processNewValues(
+        Tools::canonicalBasisVec<Eigen::Array<ValueType,Eigen::Dynamic,1> >(
+            histindex,
+            _histogram.numBins()
+            )
+        );
+  }
+};
+
+
+/** \brief Helper to easily instantiate a \ref ValueHistogram2DWithBinningMHRWStatsCollector
+ *
+ */
+template<typename CountIntType_ = int, typename CountRealAvgType_ = double,
+         typename ValueCalculatorX_ = void, typename ValueCalculatorY_ = void,
+         typename LoggerType = Logger::VacuumLogger>
+inline
+ValueHistogram2DWithBinningMHRWStatsCollector<ValueCalculatorX_, ValueCalculatorY_, CountIntType_,
+                                              CountRealAvgType_, LoggerType>
+mkValueHistogram2DWithBinningMHRWStatsCollector(
+    typename ValueHistogram2DWithBinningMHRWStatsCollector<ValueCalculatorX_, ValueCalculatorY_>::HistogramParams
+        hist_params,
+    ValueCalculatorX_ vcalc_x,
+    ValueCalculatorY_ vcalc_y,
+    int num_binning_levels,
+    LoggerType & logger
+    )
+{
+  return ValueHistogram2DWithBinningMHRWStatsCollector<ValueCalculatorX_, ValueCalculatorY_, CountIntType_,
+                                                       CountRealAvgType_, LoggerType>(
+      std::move(hist_params), std::move(vcalc_x), std::move(vcalc_y), num_binning_levels, logger
+      ) ;
 }
 
 
@@ -1284,6 +1996,92 @@ constexpr bool
 StatusProvider<ValueHistogramWithBinningMHRWStatsCollector<Params_, LoggerType_> >::CanProvideStatusLine;
 
 
+/** \brief Provide status reporting for a \ref MultipleValueHistogramsWithBinningMHRWStatsCollector
+ *
+ * The status of each value histogram is reported on a separate line.
+ */
+template<typename MultiValueCalculator_, typename CountIntType_, typename CountRealAvgType_,
+         typename LoggerType_>
+struct TOMOGRAPHER_EXPORT StatusProvider<MultipleValueHistogramsWithBinningMHRWStatsCollector<
+                                           MultiValueCalculator_, CountIntType_, CountRealAvgType_, LoggerType_
+                                           > >
+{
+  typedef MultipleValueHistogramsWithBinningMHRWStatsCollector<
+    MultiValueCalculator_, CountIntType_, CountRealAvgType_, LoggerType_
+    > MHRWStatsCollector;
+  typedef typename MHRWStatsCollector::ComponentStatsCollector ComponentStatsCollector;
+
+  static constexpr bool CanProvideStatusLine = true;
+
+  static inline std::string getStatusLine(const MHRWStatsCollector * stats)
+  {
+    std::string s;
+    for (std::size_t i = 0; i < stats->numValues(); ++i) {
+      if (i > 0) {
+        s += "\n";
+      }
+      s += StatusProvider<ComponentStatsCollector>::getStatusLine(& stats->getStatsCollector(i));
+    }
+    return s;
+  }
+};
+// static members:
+template<typename MultiValueCalculator_, typename CountIntType_, typename CountRealAvgType_,
+         typename LoggerType_>
+constexpr bool
+StatusProvider<MultipleValueHistogramsWithBinningMHRWStatsCollector<
+                 MultiValueCalculator_, CountIntType_, CountRealAvgType_, LoggerType_
+                 > >::CanProvideStatusLine;
+
+
+/** \brief Provide status reporting for a \ref ValueHistogram2DWithBinningMHRWStatsCollector
+ *
+ */
+template<typename ValueCalculatorX_, typename ValueCalculatorY_, typename CountIntType_,
+         typename CountRealAvgType_, typename LoggerType_>
+struct TOMOGRAPHER_EXPORT StatusProvider<ValueHistogram2DWithBinningMHRWStatsCollector<
+                                           ValueCalculatorX_, ValueCalculatorY_, CountIntType_,
+                                           CountRealAvgType_, LoggerType_
+                                           > >
+{
+  typedef ValueHistogram2DWithBinningMHRWStatsCollector<
+    ValueCalculatorX_, ValueCalculatorY_, CountIntType_, CountRealAvgType_, LoggerType_
+    > MHRWStatsCollector;
+
+  static constexpr bool CanProvideStatusLine = true;
+
+  static inline std::string getStatusLine(const MHRWStatsCollector * stats)
+  {
+    const auto & histogram = stats->histogram();
+
+    const auto& binning_analysis = stats->getBinningAnalysis();
+    const auto binmeans = stats->binMeans();
+
+    auto error_levels = binning_analysis.calcErrorLevels(binmeans);
+    auto conv_status = binning_analysis.determineErrorConvergence(error_levels);
+
+    auto conv_summary = BinningErrorBarConvergenceSummary::fromConvergedStatus(conv_status);
+
+    return Tools::fmts("%ldx%ld bins, %ld samples, %.1f%% off chart",
+                       (long)histogram.numBinsX(), (long)histogram.numBinsY(),
+                       (long)histogram.totalCounts(),
+                       histogram.totalCounts() > 0
+                       ? 100.0 * (double)histogram.off_chart / (double)histogram.totalCounts()
+                       : 0.0)
+      + Tools::fmts("   err(cnvg/?/x): %d/%d/%d",
+                    (int)conv_summary.n_converged, (int)conv_summary.n_unknown,
+                    (int)conv_summary.n_not_converged);
+  }
+};
+// static members:
+template<typename ValueCalculatorX_, typename ValueCalculatorY_, typename CountIntType_,
+         typename CountRealAvgType_, typename LoggerType_>
+constexpr bool
+StatusProvider<ValueHistogram2DWithBinningMHRWStatsCollector<
+                 ValueCalculatorX_, ValueCalculatorY_, CountIntType_, CountRealAvgType_, LoggerType_
+                 > >::CanProvideStatusLine;
+
+
 /** \brief Provide status reporting for a \ref MHRWMovingAverageAcceptanceRatioStatsCollector
  *
  */
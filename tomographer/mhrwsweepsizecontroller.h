@@ -0,0 +1,517 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TOMOGRAPHER_MHRWSWEEPSIZECONTROLLER_H
+#define _TOMOGRAPHER_MHRWSWEEPSIZECONTROLLER_H
+
+#include <cstddef>
+#include <cmath>
+
+#include <algorithm> // std::max
+#include <limits>
+#include <string>
+
+#include <tomographer/tools/loggers.h>
+#include <tomographer/tools/fmt.h>
+#include <tomographer/tools/cxxutil.h>
+#include <tomographer/tools/statusprovider.h>
+#include <tomographer/mhrw.h>
+#include <tomographer/mhrw_autocorrelation.h>
+#include <tomographer/valuecalculator.h> // getValueAtCurrentPoint()
+
+
+/** \file mhrwsweepsizecontroller.h
+ * \brief Tools for choosing the sweep size of the random walk from the autocorrelation
+ *        time of the figure of merit measured during thermalization
+ *
+ * See \ref Tomographer::MHRWSweepSizeController
+ */
+
+
+namespace Tomographer {
+
+
+/** \brief Default values for \ref MHRWThermalizingAutocorrelationStatsCollector and \ref
+ *         MHRWSweepSizeController
+ *
+ * \since Added in %Tomographer 5.5
+ */
+namespace MHRWSweepSizeControllerDefaults {
+
+//! Number of times per sweep the figure of merit is calculated during thermalization
+static constexpr int ProbesPerSweep = 8;
+//! Fraction of the thermalization sweeps which are skipped before we start measuring
+static constexpr double SkipNThermFraction = 0.5;
+//! Spacing between live samples, in units of the integrated autocorrelation time
+static constexpr double SampleSpacingTauInt = 2.0;
+//! Maximal number of thermalization iterations, relative to the set number of iterations
+static constexpr double MaxAddThermIters = 1.5;
+
+} // MHRWSweepSizeControllerDefaults
+
+
+
+/** \brief A \ref pageInterfaceMHRWStatsCollector which measures the autocorrelation time
+ *         of a figure of merit during thermalization, in units of iterations
+ *
+ * During the thermalization sweeps, the figure of merit is calculated at the current
+ * point every \a probeStride() iterations, where the stride is \a n_sweep divided by the
+ * number of probes per sweep.  These values are analyzed with a \ref
+ * StreamingAutocorrelationAnalysis.  The probes start only after the first \a
+ * skip_n_therm_fraction of the thermalization sweeps, and the analysis is restarted
+ * whenever \a n_sweep changes (which is what \ref MHRWStepSizeController does when it
+ * adjusts the step size), so that it measures the autocorrelation of the random walk with
+ * its final parameters.
+ *
+ * This is the buddy stats collector of \ref MHRWSweepSizeController.  Nothing is
+ * calculated during the live runs.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename ValueCalculator_, typename IterCountIntType_ = int>
+class TOMOGRAPHER_EXPORT MHRWThermalizingAutocorrelationStatsCollector
+{
+public:
+  typedef ValueCalculator_ ValueCalculator;
+  typedef IterCountIntType_ IterCountIntType;
+
+  //! The analysis type we use
+  typedef StreamingAutocorrelationAnalysis<double, IterCountIntType> AnalysisType;
+
+private:
+  const ValueCalculator vcalc;
+
+  const int probes_per_sweep;
+  const double skip_n_therm_fraction;
+
+  IterCountIntType cur_n_sweep;
+  IterCountIntType probe_stride;
+
+  AnalysisType analysis;
+  Eigen::Array<double,1,1> value;
+
+public:
+  /** \brief Constructor
+   *
+   * \param vcalc_ the value calculator for the figure of merit
+   *
+   * \param probes_per_sweep_ how many times per sweep the figure of merit is calculated.
+   *        This is the resolution of the measured autocorrelation time.  You may disable
+   *        the measurement entirely by setting \a probes_per_sweep_=0 (then \ref
+   *        MHRWSweepSizeController leaves the sweep size untouched).
+   *
+   * \param skip_n_therm_fraction_ fraction of the thermalization sweeps to skip before
+   *        starting the measurement
+   */
+  MHRWThermalizingAutocorrelationStatsCollector(
+      const ValueCalculator & vcalc_,
+      int probes_per_sweep_ = MHRWSweepSizeControllerDefaults::ProbesPerSweep,
+      double skip_n_therm_fraction_ = MHRWSweepSizeControllerDefaults::SkipNThermFraction
+      )
+    : vcalc(vcalc_),
+      probes_per_sweep(probes_per_sweep_),
+      skip_n_therm_fraction(skip_n_therm_fraction_),
+      cur_n_sweep(0),
+      probe_stride(0),
+      analysis(1),
+      value(0)
+  {
+    tomographer_assert(probes_per_sweep >= 0);
+  }
+
+  //! Whether we are measuring anything at all (see constructor)
+  inline bool isEnabled() const { return probes_per_sweep > 0; }
+
+  //! The underlying analysis, whose samples are spaced by \a probeStride() iterations
+  inline const AnalysisType & getAnalysis() const { return analysis; }
+
+  //! The number of iterations between two calculations of the figure of merit
+  inline IterCountIntType probeStride() const { return probe_stride; }
+
+  //! Whether enough values were collected for an estimate of the autocorrelation time
+  inline bool hasEstimate() const { return analysis.estimateLevel() >= 0; }
+
+  /** \brief The integrated autocorrelation time of the figure of merit, in units of
+   *         iterations
+   *
+   * Note that if the autocorrelation time is shorter than \a probeStride() iterations,
+   * then this is only an upper bound.  Returns NaN if there is no estimate yet.
+   */
+  inline double tauIntIterations() const
+  {
+    return analysis.tauInt()(0) * probe_stride;
+  }
+
+  //! Whether the estimate of the autocorrelation time has converged (see \ref StreamingAutocorrelationAnalysis::determineConvergence())
+  inline int convergedStatus() const
+  {
+    return analysis.determineConvergence()(0);
+  }
+
+  inline void init()
+  {
+    cur_n_sweep = 0;
+    probe_stride = 0;
+    analysis.reset();
+  }
+  inline void thermalizingDone()
+  {
+  }
+  inline void done()
+  {
+  }
+
+  template<typename CountIntType, typename PointType, typename FnValueType, typename PointType2,
+           typename MHRandomWalk>
+  inline void rawMove(
+      CountIntType k, bool is_thermalizing, bool /*is_live_iter*/, bool /*accepted*/,
+      double /*a*/, PointType && /*newpt*/, FnValueType /*newptval*/,
+      PointType2 && curpt, FnValueType /*curptval*/,
+      MHRandomWalk && rw
+      )
+  {
+    if (!is_thermalizing || !isEnabled()) {
+      return;
+    }
+    if (k < skip_n_therm_fraction * rw.nTherm() * rw.nSweep()) {
+      return;
+    }
+    if ((IterCountIntType)rw.nSweep() != cur_n_sweep) {
+      // parameters changed, start over
+      cur_n_sweep = (IterCountIntType)rw.nSweep();
+      probe_stride = std::max<IterCountIntType>(1, cur_n_sweep / (IterCountIntType)probes_per_sweep);
+      analysis.reset();
+    }
+    if (k % probe_stride != 0) {
+      return;
+    }
+    // curpt is still the current point of the random walk (the move hasn't been applied yet)
+    value(0) = (double)getValueAtCurrentPoint(vcalc, curpt, rw);
+    analysis.processNewValues(value);
+  }
+
+  template<typename CountIntType, typename PointType, typename FnValueType, typename MHRandomWalk>
+  inline void processSample(CountIntType /*k*/, CountIntType /*n*/, PointType && /*curpt*/,
+                            FnValueType /*curptval*/, MHRandomWalk && /*rw*/)
+  {
+  }
+};
+
+
+/** \brief Convenience function to create a \ref
+ *         MHRWThermalizingAutocorrelationStatsCollector (using template argument
+ *         deduction)
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename IterCountIntType_ = int, typename ValueCalculator_ = void>
+inline MHRWThermalizingAutocorrelationStatsCollector<ValueCalculator_, IterCountIntType_>
+mkMHRWThermalizingAutocorrelationStatsCollector(
+    const ValueCalculator_ & vcalc_,
+    int probes_per_sweep_ = MHRWSweepSizeControllerDefaults::ProbesPerSweep,
+    double skip_n_therm_fraction_ = MHRWSweepSizeControllerDefaults::SkipNThermFraction
+    )
+{
+  return MHRWThermalizingAutocorrelationStatsCollector<ValueCalculator_, IterCountIntType_>(
+      vcalc_, probes_per_sweep_, skip_n_therm_fraction_
+      );
+}
+
+
+
+/** \brief A \ref pageInterfaceMHRWController which sets the sweep size to the
+ *         autocorrelation time of the figure of merit measured during thermalization
+ *
+ * The integrated autocorrelation time \f$ \tau_{\mathrm{int}} \f$ of the figure of merit,
+ * in units of iterations, is measured by the buddy stats collector \ref
+ * MHRWThermalizingAutocorrelationStatsCollector.  At the end of the thermalization, the
+ * sweep size is set to the smallest value for which consecutive live samples are
+ * approximately independent, namely \f$ n_{\mathrm{sweep}} = \lceil
+ * c\,\tau_{\mathrm{int}} \rceil \f$ with \f$ c \f$ given by \a sample_spacing_tau_int
+ * (by default \f$ c=2 \f$).  If sweeps are longer, CPU time is wasted on samples which
+ * are not used; if they are shorter, the binning analysis needs more levels to produce
+ * reliable error bars.
+ *
+ * The adjustment strategy is \ref MHRWControllerAdjustWhileThermalizing, without any
+ * frequency flag: the parameters are never adjusted after individual iterations, and
+ * the new sweep size is set once, in the \a thermalizingDone() callback, i.e., after the
+ * last thermalization iteration and before the first live iteration.  All live samples
+ * are thus taken with the same parameters, and the collected statistics remain valid.
+ * (The number of live samples \a n_run is left unchanged.)  This also means that this
+ * controller can be combined with \ref MHRWStepSizeController using \ref
+ * MHRWMultipleControllers.
+ *
+ * The thermalization is extended as long as the estimate of the autocorrelation time
+ * has not converged, but at most up to \a max_add_therm_iters times the set number of
+ * thermalization iterations.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename ThermalizingAutocorrelationStatsCollectorType_,
+         typename BaseLoggerType_ = Logger::VacuumLogger,
+         typename IterCountIntType_ = int>
+class TOMOGRAPHER_EXPORT MHRWSweepSizeController
+{
+public:
+  // the sweep size is only changed in thermalizingDone(), adjustParams() is never called
+  enum { AdjustmentStrategy = MHRWControllerAdjustWhileThermalizing };
+
+  typedef ThermalizingAutocorrelationStatsCollectorType_ ThermalizingAutocorrelationStatsCollectorType;
+  typedef BaseLoggerType_ BaseLoggerType;
+  typedef IterCountIntType_ IterCountIntType;
+
+private:
+  const ThermalizingAutocorrelationStatsCollectorType & autocorr_stats_collector;
+
+  const double sample_spacing_tau_int;
+  const IterCountIntType min_n_sweep;
+  const IterCountIntType max_n_sweep;
+  const double max_add_therm_iters;
+
+  double last_tau_int;
+  IterCountIntType last_set_n_sweep;
+
+  Logger::LocalLogger<BaseLoggerType> llogger;
+
+public:
+  /** \brief Constructor
+   *
+   * \param autocorr_stats_collector_ the stats collector which measures the
+   *        autocorrelation time during thermalization.  It must be part of the stats
+   *        collectors of the random walk.
+   *
+   * \param baselogger_ a logger to log messages to
+   *
+   * \param sample_spacing_tau_int_ the spacing between live samples, in units of the
+   *        integrated autocorrelation time
+   *
+   * \param min_n_sweep_ never set a sweep size smaller than this
+   *
+   * \param max_n_sweep_ never set a sweep size larger than this (no limit if zero)
+   *
+   * \param max_add_therm_iters_ maximal number of thermalization iterations, relative to
+   *        \a n_sweep*n_therm, while waiting for the autocorrelation time estimate to
+   *        converge (don't wait at all if negative)
+   */
+  MHRWSweepSizeController(
+      const ThermalizingAutocorrelationStatsCollectorType & autocorr_stats_collector_,
+      BaseLoggerType & baselogger_,
+      double sample_spacing_tau_int_ = MHRWSweepSizeControllerDefaults::SampleSpacingTauInt,
+      IterCountIntType min_n_sweep_ = 1,
+      IterCountIntType max_n_sweep_ = 0,
+      double max_add_therm_iters_ = MHRWSweepSizeControllerDefaults::MaxAddThermIters
+      )
+    : autocorr_stats_collector(autocorr_stats_collector_),
+      sample_spacing_tau_int(sample_spacing_tau_int_),
+      min_n_sweep(min_n_sweep_),
+      max_n_sweep(max_n_sweep_),
+      max_add_therm_iters(max_add_therm_iters_),
+      last_tau_int(std::numeric_limits<double>::quiet_NaN()),
+      last_set_n_sweep(0),
+      llogger("Tomographer::MHRWSweepSizeController", baselogger_)
+  {
+    tomographer_assert(min_n_sweep >= 1);
+  }
+
+  //! The last measured autocorrelation time in units of iterations, or NaN
+  inline double getLastTauInt() const { return last_tau_int; }
+
+  //! The sweep size set by this controller, or zero if it wasn't set (yet)
+  inline IterCountIntType getLastSetNSweep() const { return last_set_n_sweep; }
+
+  template<typename MHRWParamsType, typename MHWalker, typename MHRandomWalkType>
+  inline void init(MHRWParamsType & /*params*/, const MHWalker & /*mhwalker*/,
+                   const MHRandomWalkType & /*mhrw*/)
+  {
+    last_tau_int = std::numeric_limits<double>::quiet_NaN();
+    last_set_n_sweep = 0;
+  }
+
+  template<typename MHRWParamsType, typename MHWalker, typename CountIntType, typename MHRandomWalkType>
+  bool allowDoneThermalization(const MHRWParamsType & params, const MHWalker & /*mhwalker*/,
+                               CountIntType iter_k, const MHRandomWalkType & /*mhrw*/)
+  {
+    if (!autocorr_stats_collector.isEnabled()) {
+      return true;
+    }
+
+    auto logger = llogger.subLogger(TOMO_ORIGIN);
+
+    last_tau_int = autocorr_stats_collector.tauIntIterations();
+
+    if (max_add_therm_iters < 0) {
+      return true;
+    }
+    if (iter_k > max_add_therm_iters * params.n_therm * params.n_sweep) {
+      logger.debug([&](std::ostream & stream) {
+          stream << "Reached maximum number of thermalization iterations, iter_k = " << iter_k;
+        });
+      return true;
+    }
+
+    if (!autocorr_stats_collector.hasEstimate() ||
+        autocorr_stats_collector.convergedStatus() == BINNING_NOT_CONVERGED) {
+      logger.longdebug([&](std::ostream & stream) {
+          stream << "Autocorrelation time estimate (" << last_tau_int << ") not converged yet, "
+                 << "iter_k = " << iter_k;
+        });
+      return false;
+    }
+    return true;
+  }
+
+  template<typename MHRWParamsType, typename MHWalker, typename CountIntType, typename MHRandomWalkType>
+  bool allowDoneRuns(const MHRWParamsType & /*params*/, const MHWalker & /*mhwalker*/,
+                     CountIntType /*iter_k*/, const MHRandomWalkType & /*mhrw*/) const
+  {
+    return true;
+  }
+
+  template<typename MHRWParamsType, typename MHWalker, typename MHRandomWalkType>
+  inline void thermalizingDone(MHRWParamsType & params, const MHWalker & /*mhwalker*/,
+                               const MHRandomWalkType & /*mhrw*/)
+  {
+    if (!autocorr_stats_collector.isEnabled()) {
+      return;
+    }
+
+    typedef typename MHRWParamsType::CountIntType CountIntType;
+
+    auto logger = llogger.subLogger(TOMO_ORIGIN);
+
+    last_tau_int = autocorr_stats_collector.tauIntIterations();
+    if (!std::isfinite(last_tau_int)) {
+      logger.warning([&](std::ostream & stream) {
+          stream << "No estimate of the autocorrelation time is available, keeping n_sweep = "
+                 << params.n_sweep;
+        });
+      return;
+    }
+    if (autocorr_stats_collector.convergedStatus() == BINNING_NOT_CONVERGED) {
+      logger.warning([&](std::ostream & stream) {
+          stream << "The estimate of the autocorrelation time of the figure of merit ("
+                 << last_tau_int << " iterations) has not converged, the chosen sweep size "
+                 << "might be too small";
+        });
+    }
+
+    double new_n_sweep_d = std::ceil(sample_spacing_tau_int * last_tau_int);
+    if (max_n_sweep > 0 && new_n_sweep_d > (double)max_n_sweep) {
+      new_n_sweep_d = (double)max_n_sweep;
+    }
+    // make sure that n_sweep*n_run does not overflow
+    const double max_no_overflow =
+      (double)std::numeric_limits<CountIntType>::max() / std::max<double>(1, (double)params.n_run);
+    if (new_n_sweep_d > max_no_overflow) {
+      new_n_sweep_d = std::floor(max_no_overflow);
+    }
+    const CountIntType new_n_sweep = std::max<CountIntType>((CountIntType)min_n_sweep,
+                                                            (CountIntType)new_n_sweep_d);
+
+    logger.debug([&](std::ostream & stream) {
+        stream << "Autocorrelation time of the figure of merit is " << last_tau_int
+               << " iterations (measured every " << autocorr_stats_collector.probeStride()
+               << " iterations), setting n_sweep = " << new_n_sweep << " (was " << params.n_sweep << ")";
+      });
+
+    params.n_sweep = new_n_sweep;
+    last_set_n_sweep = (IterCountIntType)new_n_sweep;
+  }
+
+  template<typename MHRWParamsType, typename MHWalker, typename MHRandomWalkType>
+  inline void done(MHRWParamsType & /*params*/, const MHWalker & /*mhwalker*/,
+                   const MHRandomWalkType & /*mhrw*/) const
+  {
+  }
+};
+
+
+/** \brief Convenience function to create a \ref MHRWSweepSizeController (using template
+ *         argument deduction)
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename IterCountIntType_ = int,
+         // these types are deduced from the args anyway:
+         typename ThermalizingAutocorrelationStatsCollectorType_ = void,
+         typename BaseLoggerType_ = void>
+inline MHRWSweepSizeController<ThermalizingAutocorrelationStatsCollectorType_, BaseLoggerType_,
+                               IterCountIntType_>
+mkMHRWSweepSizeController(
+    const ThermalizingAutocorrelationStatsCollectorType_ & autocorr_stats_collector_,
+    BaseLoggerType_ & baselogger_,
+    double sample_spacing_tau_int_ = MHRWSweepSizeControllerDefaults::SampleSpacingTauInt,
+    IterCountIntType_ min_n_sweep_ = 1,
+    IterCountIntType_ max_n_sweep_ = 0,
+    double max_add_therm_iters_ = MHRWSweepSizeControllerDefaults::MaxAddThermIters
+    )
+{
+  return MHRWSweepSizeController<ThermalizingAutocorrelationStatsCollectorType_, BaseLoggerType_,
+                                 IterCountIntType_>(
+                                     autocorr_stats_collector_,
+                                     baselogger_,
+                                     sample_spacing_tau_int_,
+                                     min_n_sweep_,
+                                     max_n_sweep_,
+                                     max_add_therm_iters_
+                                     );
+}
+
+
+
+namespace Tools {
+
+template<typename ThermalizingAutocorrelationStatsCollectorType,
+         typename BaseLoggerType,
+         typename IterCountIntType>
+struct TOMOGRAPHER_EXPORT
+StatusProvider<MHRWSweepSizeController<ThermalizingAutocorrelationStatsCollectorType,
+                                       BaseLoggerType, IterCountIntType> >
+{
+  typedef MHRWSweepSizeController<ThermalizingAutocorrelationStatsCollectorType,
+                                  BaseLoggerType, IterCountIntType> StatusableObject;
+
+  static constexpr bool CanProvideStatusLine = true;
+
+  static inline std::string getStatusLine(const StatusableObject * obj) {
+    if (obj->getLastSetNSweep() > 0) {
+      return Tomographer::Tools::fmts("sweep size = %ld (tau_int = %.3g iter.)",
+                                      (long)obj->getLastSetNSweep(), obj->getLastTauInt());
+    }
+    return std::string();
+  }
+};
+
+} // namespace Tools
+
+
+
+} // namespace Tomographer
+
+
+
+#endif
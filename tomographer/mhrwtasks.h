@@ -42,14 +42,18 @@
 #include <random>
 #include <sstream>
 #include <stdexcept>
+#include <utility> // std::declval
 
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
 
 #include <tomographer/tools/fmt.h>
 #include <tomographer/tools/needownoperatornew.h>
 #include <tomographer/mhrw.h>
+#include <tomographer/mhrwtempering.h>
 #include <tomographer/mhrwstatscollectors.h>
+#include <tomographer/mhrw_autocorrelation.h>
 #include <tomographer/multiproc.h> // StatusReport Base
 
 
@@ -267,6 +271,11 @@ private:
  *
  * \since Since %Tomographer 5.3, this class can be serialized with Boost.Serialization as
  *        long as \a MHRWStatsResultsType can be serialized.
+ *
+ * \since Since %Tomographer 5.5, the result includes an estimate of the integrated
+ *        autocorrelation times (see \ref autocorrelation).  The serialization class
+ *        version is 1; results serialized by earlier versions (class version 0) can
+ *        still be loaded, with an empty \ref autocorrelation.
  */
 template<typename MHRWStatsResultsType_, typename IterCountIntType, typename MHWalkerParams>
 struct TOMOGRAPHER_EXPORT MHRandomWalkTaskResult
@@ -296,7 +305,8 @@ struct TOMOGRAPHER_EXPORT MHRandomWalkTaskResult
                          double acceptance_ratio_)
     : stats_results(std::forward<MHRWStatsResultsTypeInit>(stats_results_)),
       mhrw_params(std::forward<MHRWParamsTypeInit>(mhrw_params_)),
-      acceptance_ratio(acceptance_ratio_)
+      acceptance_ratio(acceptance_ratio_),
+      autocorrelation()
   {
   }
 
@@ -306,22 +316,26 @@ struct TOMOGRAPHER_EXPORT MHRandomWalkTaskResult
    *        that type
    *
    * \param mhrandomwalk should be a \ref MHRandomWalk instance
+   *
+   * \param autocorrelation_ the autocorrelation analysis of the random walk, if any
    */
   template<typename MHRWStatsResultsTypeInit, typename MHRandomWalkType>
   MHRandomWalkTaskResult(MHRWStatsResultsTypeInit && stats_results_,
-                         const MHRandomWalkType & mhrandomwalk)
+                         const MHRandomWalkType & mhrandomwalk,
+                         MHRWAutocorrelationResult autocorrelation_ = MHRWAutocorrelationResult())
     : stats_results(std::forward<MHRWStatsResultsTypeInit>(stats_results_)),
       mhrw_params(mhrandomwalk.mhrwParams()),
       acceptance_ratio(mhrandomwalk.hasAcceptanceRatio() ?
                        mhrandomwalk.acceptanceRatio() :
-                       std::numeric_limits<double>::quiet_NaN())
+                       std::numeric_limits<double>::quiet_NaN()),
+      autocorrelation(std::move(autocorrelation_))
   {
   }
 
 
   //! Construct an invalid object -- ONLY for use with Boost.serialization
   TOMOGRAPHER_ENABLED_IF(std::is_default_constructible<MHRWStatsResultsType>::value)
-  MHRandomWalkTaskResult() : stats_results(), mhrw_params(), acceptance_ratio() { }
+  MHRandomWalkTaskResult() : stats_results(), mhrw_params(), acceptance_ratio(), autocorrelation() { }
 
     
   /** \brief The result(s) coming from stats collecting (may be processed, see \ref
@@ -335,6 +349,15 @@ struct TOMOGRAPHER_EXPORT MHRandomWalkTaskResult
   //! The acceptance ratio of the Metropolis-Hastings random walk
   double acceptance_ratio;
 
+  /** \brief The integrated autocorrelation times and effective sample sizes of the
+   *         function value and of the figure of merit
+   *
+   * See \ref MHRWAutocorrelationResult.  The figure of merit is only included if the
+   * CData provides a \a createAutocorrelationStatsCollector() method (see \ref
+   * pageInterfaceMHRandomWalkTaskCData).
+   */
+  MHRWAutocorrelationResult autocorrelation;
+
 
   MHRandomWalkTaskResult(MHRandomWalkTaskResult && ) = default;
   MHRandomWalkTaskResult(const MHRandomWalkTaskResult & ) = default;
@@ -343,15 +366,51 @@ private:
   friend boost::serialization::access;
   template<typename Archive,
            typename MHRWStatsResultsType2 = MHRWStatsResultsType>
-  void serialize(Archive & a, unsigned int /* version */)
+  void serialize(Archive & a, unsigned int version)
   {
     MHRWStatsResultsType2 & stats_results_ref = stats_results;
     a & stats_results_ref;
     a & mhrw_params;
     a & acceptance_ratio;
+    // version 1 (Tomographer 5.5) added the autocorrelation analysis
+    if (version >= 1) {
+      a & autocorrelation;
+    }
+  }
+};
+
+
+
+
+namespace tomo_internal {
+
+// the CData may provide createAutocorrelationStatsCollector(logger), e.g. to include
+// the figure of merit; otherwise only the function value is analyzed
+template<typename CData, typename LoggerType, typename = void>
+struct autocorrelation_stats_collector_helper
+{
+  typedef MHRWAutocorrelationStatsCollector<void, typename CData::IterCountIntType, LoggerType> Type;
+  static inline Type create(const CData * /*pcdata*/, LoggerType & logger)
+  {
+    return Type(logger);
+  }
+};
+template<typename CData, typename LoggerType>
+struct autocorrelation_stats_collector_helper<
+  CData, LoggerType,
+  typename Tools::tomo_internal::sfinae_void<
+    decltype(std::declval<const CData&>().createAutocorrelationStatsCollector(std::declval<LoggerType&>()))
+    >::type
+  >
+{
+  typedef decltype(std::declval<const CData&>().createAutocorrelationStatsCollector(std::declval<LoggerType&>())) Type;
+  static inline Type create(const CData * pcdata, LoggerType & logger)
+  {
+    return pcdata->createAutocorrelationStatsCollector(logger);
   }
 };
 
+} // namespace tomo_internal
 
 
 
@@ -449,6 +508,31 @@ private:
     template<typename MHWalkerType, typename MHRWStatsCollectorType, typename MHRWControllerType>
     inline void operator()(MHWalkerType & mhwalker, MHRWStatsCollectorType & stats,
                            MHRWControllerType & controller)
+    {
+      _run<MHRandomWalk>(mhwalker, stats, controller);
+    }
+
+    template<typename MHWalkerType, typename MHRWStatsCollectorType>
+    inline void operator()(MHWalkerType & mhwalker, MHRWStatsCollectorType & stats)
+    {
+      MHRWNoController ctrl;
+      operator()<MHWalkerType, MHRWStatsCollectorType, MHRWNoController>(mhwalker, stats, ctrl) ;
+    }
+
+    // run with parallel tempering, see MHRandomWalkTempering
+    template<typename MHWalkerType, typename MHRWStatsCollectorType, typename MHRWControllerType>
+    inline void operator()(MHWalkerType & mhwalker, MHRWStatsCollectorType & stats,
+                           MHRWControllerType & controller, std::vector<double> tempering_betas)
+    {
+      _run<MHRandomWalkTempering>(mhwalker, stats, controller, std::move(tempering_betas));
+    }
+
+  private:
+    template<template<typename...> class MHRandomWalkTmpl,
+             typename MHWalkerType, typename MHRWStatsCollectorType, typename MHRWControllerType,
+             typename... ExtraArgs>
+    inline void _run(MHWalkerType & mhwalker, MHRWStatsCollectorType & stats,
+                     MHRWControllerType & controller, ExtraArgs&&... extra_args)
     {
       // here we actually run the stuff
 
@@ -463,18 +547,26 @@ private:
           [&](StatusReportType report) { this->tmgriface->submitStatusReport(std::move(report)); }
           );
 
-      typedef MultipleMHRWStatsCollectors<MHRWStatsCollectorType, OurStatusReportCheck>
+      // estimate the autocorrelation times, to be included in the task result
+      typedef tomo_internal::autocorrelation_stats_collector_helper<MHRandomWalkTaskCData, LoggerType>
+        AutocorrelationHelper;
+      typename AutocorrelationHelper::Type autocorrstats = AutocorrelationHelper::create(pcdata, baselogger);
+
+      typedef MultipleMHRWStatsCollectors<MHRWStatsCollectorType, typename AutocorrelationHelper::Type,
+                                          OurStatusReportCheck>
         OurStatsCollectors;
-      OurStatsCollectors ourstatscollectors(stats, statreportcheck);
+      OurStatsCollectors ourstatscollectors(stats, autocorrstats, statreportcheck);
 
       logger.longdebug("About to creat MHRandomWalk instance");
 
-      typedef MHRandomWalk<Rng,MHWalkerType,OurStatsCollectors,MHRWControllerType,LoggerType,IterCountIntType>
+      typedef MHRandomWalkTmpl<Rng,MHWalkerType,OurStatsCollectors,MHRWControllerType,LoggerType,IterCountIntType>
         MHRandomWalkType;
 
       MHRandomWalkType rwalk(
           // MH random walk parameters
           pcdata->mhrw_params,
+          // any further parameters specific to MHRandomWalkType
+          std::forward<ExtraArgs>(extra_args)...,
           // the MHWalker
           mhwalker,
           // our stats collectors
@@ -493,14 +585,7 @@ private:
 
       logger.longdebug("MHRandomWalk run finished.");
 
-      *ppresult = new ResultType(stats.stealResult(), rwalk);
-    }
-
-    template<typename MHWalkerType, typename MHRWStatsCollectorType>
-    inline void operator()(MHWalkerType & mhwalker, MHRWStatsCollectorType & stats)
-    {
-      MHRWNoController ctrl;
-      operator()<MHWalkerType, MHRWStatsCollectorType, MHRWNoController>(mhwalker, stats, ctrl) ;
+      *ppresult = new ResultType(stats.stealResult(), rwalk, autocorrstats.getResult());
     }
   };
 
@@ -551,5 +636,21 @@ public:
 } // namespace Tomographer
 
 
+namespace boost {
+namespace serialization {
+// BOOST_CLASS_VERSION() doesn't work with class templates
+template<typename MHRWStatsResultsType, typename IterCountIntType, typename MHWalkerParams>
+struct version<Tomographer::MHRWTasks::MHRandomWalkTaskResult<MHRWStatsResultsType, IterCountIntType,
+                                                              MHWalkerParams> >
+{
+  typedef mpl::int_<1> type;
+  typedef mpl::integral_c_tag tag;
+  BOOST_STATIC_CONSTANT(int, value = version::type::value);
+};
+} // namespace serialization
+} // namespace boost
+
+
+
 
 #endif
@@ -0,0 +1,595 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#ifndef TOMOGRAPHER_MHRWTEMPERING_H
+#define TOMOGRAPHER_MHRWTEMPERING_H
+
+#include <cstddef>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <algorithm> // std::fill
+#include <iomanip>
+#include <type_traits>
+#include <utility> // std::swap
+
+#include <boost/core/demangle.hpp>
+
+#include <tomographer/tools/loggers.h>
+#include <tomographer/tools/fmt.h>
+#include <tomographer/tools/cxxutil.h>
+#include <tomographer/tools/needownoperatornew.h>
+#include <tomographer/mhrw.h>
+
+
+/** \file mhrwtempering.h
+ *
+ * \brief A Metropolis-Hastings random walk with parallel tempering (replica exchange).
+ *
+ * See \ref Tomographer::MHRandomWalkTempering.
+ */
+
+
+namespace Tomographer {
+
+
+/** \brief A geometric ladder of inverse temperatures for \ref MHRandomWalkTempering
+ *
+ * Returns \a num_replicas inverse temperatures, starting at \f$ \beta_0 = 1 \f$ and
+ * decreasing geometrically down to \f$ \beta_{n-1} = \f$ \a beta_min.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+inline std::vector<double> geometricTemperingLadder(std::size_t num_replicas, double beta_min)
+{
+  tomographer_assert(num_replicas >= 1);
+  tomographer_assert(beta_min > 0 && beta_min <= 1);
+
+  std::vector<double> betas(num_replicas, 1.0);
+  if (num_replicas > 1) {
+    const double ratio = std::pow(beta_min, 1.0 / (double)(num_replicas - 1));
+    for (std::size_t i = 1; i < num_replicas; ++i) {
+      betas[i] = betas[i-1] * ratio;
+    }
+    betas[num_replicas-1] = beta_min; // avoid rounding errors
+  }
+  return betas;
+}
+
+
+/** \brief A Metropolis-Hastings random walk with parallel tempering (replica exchange)
+ *
+ * This random walk runs a ladder of \em replicas of the same random walk.  The replica
+ * number \f$ i \f$ samples the tempered distribution \f$ f(x)^{\beta_i} \f$, where \f$ f
+ * \f$ is the function of the \a MHWalker and where the inverse temperatures are
+ * \f$ 1 = \beta_0 > \beta_1 > \ldots > \beta_{n-1} > 0 \f$.  Hot replicas (small \f$ \beta
+ * \f$) explore the state space more freely, which helps the \f$ \beta_0 = 1 \f$ replica to
+ * mix when \f$ f \f$ is very peaked, for instance for a log-likelihood function with a
+ * large number of measurements.  (Scaling the log-likelihood by \f$ \beta \f$ is the same
+ * as scaling the number of measurements, see \ref DenseDM::IndepMeasLLH::setNMeasAmplifyFactor().)
+ *
+ * Each iteration of the random walk performs one Metropolis-Hastings move for each of
+ * the replicas.  At the end of each sweep, we propose to exchange the states of
+ * neighbouring replicas \f$ (i, i+1) \f$, alternately for even and for odd \f$ i \f$.  The
+ * exchange is accepted with probability \f$ \min\left(1, \left[f(x_{i+1})/f(x_i)\right]^{
+ * \beta_i - \beta_{i+1}}\right) \f$.
+ *
+ * This class can be used as a drop-in replacement for \ref MHRandomWalk.  The stats
+ * collector and the random walk controller only see the \f$ \beta_0 = 1 \f$ replica: its
+ * moves are reported with \a rawMove(), its samples with \a processSample(), and \ref
+ * getCurrentPoint(), \ref acceptanceRatio() etc. refer to it.  The statistics collected
+ * are thus those of the random walk for \f$ f \f$ itself.  All replicas use the same
+ * parameters \ref mhWalkerParams(), which may be adjusted by the controller.
+ *
+ * The replicas share the same \a MHWalker, which must use \ref MHUseFnLogValue (see
+ * \ref pageInterfaceMHWalker) and must be able to provide several independent start
+ * points with \a startPoint().  The replicas are advanced in turn in the calling thread;
+ * run several independent random walks in parallel with a task dispatcher (see \ref
+ * MHRWTasks::MHRandomWalkTask) to use several threads.
+ *
+ * The template parameters are the same as for \ref MHRandomWalk.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename Rng_, typename MHWalker_, typename MHRWStatsCollector_,
+         typename MHRWController_ = MHRWNoController,
+         typename LoggerType_ = Logger::VacuumLogger,
+         typename CountIntType_ = int>
+class TOMOGRAPHER_EXPORT MHRandomWalkTempering
+{
+public:
+  //! Random number generator type (see C++ std::random)
+  typedef Rng_ Rng;
+  //! The random walker type which knows about the state space and jump function
+  typedef MHWalker_ MHWalker;
+  //! The stats collector type (see \ref pageInterfaceMHRWStatsCollector)
+  typedef MHRWStatsCollector_ MHRWStatsCollector;
+  //! The logger type which will be provided by user to constructor (see \ref pageLoggers)
+  typedef LoggerType_ LoggerType;
+  //! The type used for counting numbers of iterations
+  typedef CountIntType_ CountIntType;
+
+  //! The type of a point in the random walk
+  typedef typename MHWalker::PointType PointType;
+  //! The parameters type of the MHWalker implememtation
+  typedef typename MHWalker::WalkerParams MHWalkerParams;
+
+  //! The struct which can hold the parameters of this random walk
+  typedef MHRWParams<MHWalkerParams, CountIntType> MHRWParamsType;
+
+  //! The type which will take care of dynamically adjusting the parameters of the random walk
+  typedef MHRWController_ MHRWController;
+  enum { MHRWControllerStrategy = MHRWController::AdjustmentStrategy };
+
+  //! The MHRWControllerInvoker for our random walk controller, for convenience
+  typedef MHRWControllerInvoker<MHRWController> MHRWControllerInvokerType;
+
+  //! The type of the logarithm of the Metropolis-Hastings function value
+  typedef typename MHWalker::FnValueType FnValueType;
+
+  enum {
+    //! How to calculate the Metropolis-Hastings jump probability ratio
+    UseFnSyntaxType = MHWalker::UseFnSyntaxType
+  };
+
+  static_assert((int)UseFnSyntaxType == (int)MHUseFnLogValue,
+                "MHRandomWalkTempering requires a MHWalker with UseFnSyntaxType == MHUseFnLogValue");
+  // the proposals of e.g. a Hamiltonian walker are tied to the untempered function
+  static_assert(!tomo_internal::helper_HasJumpLogProposalRatio<MHWalker>::value,
+                "MHRandomWalkTempering requires a MHWalker with a symmetric proposal distribution");
+
+  //! The cache of quantities derived from a point, or \c void (see \ref MHRandomWalk::PointCacheType)
+  typedef typename tomo_internal::helper_PointCacheType_or_void<MHWalker>::type PointCacheType;
+
+  enum {
+    //! Whether the \a MHWalker provides a cache for the current point
+    HasPointCache = !std::is_same<PointCacheType, void>::value
+  };
+
+private:
+  typedef tomo_internal::MHRWPointCacheStorage<PointCacheType> PointCacheStorage;
+
+  // The state of a replica.  These are exchanged between the temperatures of the ladder.
+  struct Replica
+    : public virtual Tools::NeedOwnOperatorNew<PointType, typename PointCacheStorage::CacheType>::ProviderType
+  {
+    PointType curpt;
+    FnValueType curptval; // log of the MH function value, *not* multiplied by beta
+    PointCacheStorage ptcache;
+  };
+
+  typedef std::vector<Replica, typename Tools::NeedOwnOperatorNew<Replica>::AllocatorType> ReplicaList;
+
+  // declare const if no adjustments are to be made (see MHRandomWalk)
+  typename tomo_internal::const_type_helper<
+    MHRWParamsType,
+    (int)MHRWControllerStrategy==(int)MHRWControllerDoNotAdjust
+    >::type _n;
+
+  const std::vector<double> _betas;
+
+  Rng & _rng;
+  MHWalker & _mhwalker;
+  MHRWStatsCollector & _stats;
+  MHRWController & _mhrw_controller;
+
+  Logger::LocalLogger<LoggerType> _logger;
+
+  //! The state of the replica at each temperature; _replicas[0] is at \f$ \beta = 1 \f$.
+  ReplicaList _replicas;
+
+  //! Number of accepted moves, and total number of moves, at each temperature during the live runs
+  std::vector<CountIntType> _num_accepted;
+  std::vector<CountIntType> _num_live_points;
+
+  //! Number of accepted and proposed exchanges between the temperatures \a i and \a i+1
+  std::vector<CountIntType> _num_swaps_accepted;
+  std::vector<CountIntType> _num_swaps_proposed;
+
+  //! Whether the next exchanges are proposed for the even or for the odd pairs of neighbours
+  bool _swap_odd;
+
+public:
+
+  /** \brief Constructor
+   *
+   * \param n_rw the parameters of the random walk (\ref MHRWParams or an initializer for
+   *        it)
+   *
+   * \param betas the inverse temperatures of the replicas.  The first one must be equal
+   *        to one, and they must be decreasing and positive (see \ref
+   *        geometricTemperingLadder()).
+   *
+   * The other parameters are the same as for \ref MHRandomWalk.
+   */
+  template<typename MHRWParamsTypeInit>
+  MHRandomWalkTempering(MHRWParamsTypeInit&& n_rw, std::vector<double> betas,
+                        MHWalker & mhwalker, MHRWStatsCollector & stats, MHRWController & mhrw_controller,
+                        Rng & rng, LoggerType & logger_)
+    : _n(std::forward<MHRWParamsTypeInit>(n_rw)),
+      _betas(std::move(betas)),
+      _rng(rng),
+      _mhwalker(mhwalker),
+      _stats(stats),
+      _mhrw_controller(mhrw_controller),
+      _logger(TOMO_ORIGIN, logger_),
+      _replicas(_betas.size()),
+      _num_accepted(_betas.size(), 0),
+      _num_live_points(_betas.size(), 0),
+      _num_swaps_accepted(_betas.size() > 0 ? _betas.size() - 1 : 0, 0),
+      _num_swaps_proposed(_betas.size() > 0 ? _betas.size() - 1 : 0, 0),
+      _swap_odd(false)
+  {
+    tomographer_assert(_betas.size() >= 1 && "Need at least one replica");
+    tomographer_assert(_betas[0] == 1.0 && "The first replica must be at beta = 1");
+    for (std::size_t i = 1; i < _betas.size(); ++i) {
+      tomographer_assert(_betas[i] > 0 && _betas[i] < _betas[i-1] &&
+                         "Inverse temperatures must be positive and decreasing");
+    }
+    _logger.debug([&](std::ostream & s) {
+        s << "constructor(). mhrw parameters = " << _n << ", betas = [";
+        for (std::size_t i = 0; i < _betas.size(); ++i) {
+          s << (i ? ", " : "") << _betas[i];
+        }
+        s << "]";
+      });
+  }
+
+  MHRandomWalkTempering(const MHRandomWalkTempering & other) = delete;
+
+
+  //! Access the stats collector
+  inline const MHRWStatsCollector & statsCollector() const { return _stats; }
+
+  //! Access the random walk controller
+  inline const MHRWController & mhrwController() const { return _mhrw_controller; }
+
+  //! The parameters of the random walk.
+  inline MHRWParamsType mhrwParams() const { return _n; }
+
+  //! Get the MHWalker parameters
+  inline MHWalkerParams mhWalkerParams() const { return _n.mhwalker_params; }
+
+  //! Number of iterations in a sweep.
+  inline CountIntType nSweep() const { return _n.n_sweep; }
+  //! Number of thermalizing sweeps.
+  inline CountIntType nTherm() const { return _n.n_therm; }
+  //! Number of live run sweeps.
+  inline CountIntType nRun() const { return _n.n_run; }
+
+  //! Number of replicas, i.e. of temperatures in the ladder
+  inline std::size_t numReplicas() const { return _betas.size(); }
+
+  //! The inverse temperature of the replica number \a i
+  inline double beta(std::size_t i) const { return _betas[i]; }
+
+  //! Whether we have any statistics about the acceptance ratio (see \ref MHRandomWalk::hasAcceptanceRatio())
+  inline bool hasAcceptanceRatio() const
+  {
+    return (_num_live_points[0] > 0);
+  }
+  //! The acceptance ratio of the moves of the \f$ \beta = 1 \f$ replica so far
+  template<typename RatioType = double>
+  inline RatioType acceptanceRatio() const
+  {
+    return replicaAcceptanceRatio<RatioType>(0);
+  }
+  //! The acceptance ratio of the moves at the temperature number \a i so far
+  template<typename RatioType = double>
+  inline RatioType replicaAcceptanceRatio(std::size_t i) const
+  {
+    return RatioType(_num_accepted[i]) / RatioType(_num_live_points[i]);
+  }
+  /** \brief The fraction of accepted exchanges between the temperatures number \a i and
+   *         \a i+1
+   *
+   * This accounts for all exchanges proposed so far, including during thermalization.
+   * Returns NaN if no exchange was proposed yet.
+   */
+  template<typename RatioType = double>
+  inline RatioType swapAcceptanceRatio(std::size_t i) const
+  {
+    if (_num_swaps_proposed[i] == 0) {
+      return std::numeric_limits<RatioType>::quiet_NaN();
+    }
+    return RatioType(_num_swaps_accepted[i]) / RatioType(_num_swaps_proposed[i]);
+  }
+
+  //! The current point of the \f$ \beta = 1 \f$ replica
+  inline const PointType & getCurrentPoint() const
+  {
+    return _replicas[0].curpt;
+  }
+  //! The log of the function value at the current point of the \f$ \beta = 1 \f$ replica
+  inline const FnValueType & getCurrentPointValue() const
+  {
+    return _replicas[0].curptval;
+  }
+  //! The cache of the current point of the \f$ \beta = 1 \f$ replica (see \ref MHRandomWalk::getCurrentPointCache())
+  TOMOGRAPHER_ENABLED_IF(HasPointCache)
+  inline const typename PointCacheStorage::CacheType & getCurrentPointCache() const
+  {
+    return _replicas[0].ptcache.cur;
+  }
+  //! The current point of the replica at the temperature number \a i
+  inline const PointType & getReplicaPoint(std::size_t i) const
+  {
+    return _replicas[i].curpt;
+  }
+
+private:
+
+  inline void _init()
+  {
+    std::fill(_num_accepted.begin(), _num_accepted.end(), 0);
+    std::fill(_num_live_points.begin(), _num_live_points.end(), 0);
+    std::fill(_num_swaps_accepted.begin(), _num_swaps_accepted.end(), 0);
+    std::fill(_num_swaps_proposed.begin(), _num_swaps_proposed.end(), 0);
+    _swap_odd = false;
+
+    // starting points
+    for (auto & r : _replicas) {
+      r.curpt = _mhwalker.startPoint();
+      r.curptval = _get_curptval(r);
+    }
+
+    _mhwalker.init();
+    _stats.init();
+
+    _mhrw_controller.init(_n, _mhwalker, *this);
+
+    _logger.longdebug("_init() done.");
+  }
+  inline void _thermalizing_done()
+  {
+    _mhwalker.thermalizingDone();
+    _stats.thermalizingDone();
+
+    _mhrw_controller.thermalizingDone(_n, _mhwalker, *this);
+
+    _logger.longdebug("_thermalizing_done() done.");
+  }
+  inline void _done()
+  {
+    _mhwalker.done();
+    _stats.done();
+
+    _mhrw_controller.done(_n, _mhwalker, *this);
+
+    _logger.debug([&](std::ostream & s) {
+        s << "Random walk done.  Acceptance ratios = [";
+        for (std::size_t i = 0; i < _betas.size(); ++i) {
+          s << (i ? ", " : "") << Tools::fmts("%.2f", replicaAcceptanceRatio(i));
+        }
+        s << "], exchange acceptance ratios = [";
+        for (std::size_t i = 0; i + 1 < _betas.size(); ++i) {
+          s << (i ? ", " : "") << Tools::fmts("%.2f", swapAcceptanceRatio(i));
+        }
+        s << "]";
+      });
+  }
+
+  inline bool _accept(double log_a)
+  {
+    if (log_a >= 0) {
+      return true;
+    }
+    using namespace std;
+    const double a = exp(log_a);
+    return bool( _rng()-_rng.min() <= a*(_rng.max()-_rng.min()) );
+  }
+
+  // Process a single move of the replica at temperature number i
+  template<bool IsThermalizing>
+  inline void _move(std::size_t i, CountIntType k, bool is_live_iter)
+  {
+    Replica & r = _replicas[i];
+
+    const PointType newpt = _mhwalker.jumpFn(r.curpt, _n.mhwalker_params);
+
+    const FnValueType newptval = _get_newptval(r, newpt);
+
+    // tempered Metropolis-Hastings ratio
+    const double log_a = _betas[i] * double(newptval - r.curptval);
+    const bool accept = _accept(log_a);
+
+    if (!IsThermalizing) {
+      _num_accepted[i] += accept ? 1 : 0;
+      ++_num_live_points[i];
+    }
+
+    if (i == 0) {
+      using namespace std;
+      const double a = (log_a >= 0) ? 1.0 : exp(log_a);
+      _stats.rawMove(k, IsThermalizing, is_live_iter, accept, a, newpt, newptval, r.curpt, r.curptval, *this);
+    }
+
+    if (accept) {
+      r.curpt = newpt;
+      r.curptval = newptval;
+      r.ptcache.acceptNext();
+    }
+  }
+
+  // Propose to exchange the states of neighbouring replicas, alternately for the even and
+  // for the odd pairs
+  inline void _swap_replicas()
+  {
+    for (std::size_t i = (_swap_odd ? 1 : 0); i + 1 < _replicas.size(); i += 2) {
+      const double log_a = (_betas[i] - _betas[i+1]) *
+        double(_replicas[i+1].curptval - _replicas[i].curptval);
+      ++_num_swaps_proposed[i];
+      if (_accept(log_a)) {
+        ++_num_swaps_accepted[i];
+        using std::swap;
+        swap(_replicas[i].curpt, _replicas[i+1].curpt);
+        swap(_replicas[i].curptval, _replicas[i+1].curptval);
+        swap(_replicas[i].ptcache, _replicas[i+1].ptcache);
+      }
+    }
+    _swap_odd = !_swap_odd;
+  }
+
+  inline void _process_sample(CountIntType k, CountIntType n)
+  {
+    _stats.processSample(k, n, _replicas[0].curpt, _replicas[0].curptval, *this);
+    _logger.longdebug("_process_sample() done.");
+  }
+
+  // Calculate the function value at the current point of a replica, or at a new proposal
+  // point.  If the MHWalker has a point cache, we let it fill the cache of the
+  // corresponding point.
+  TOMOGRAPHER_ENABLED_IF(!HasPointCache)
+  inline FnValueType _get_curptval(Replica & r)
+  {
+    return _mhwalker.fnLogVal(r.curpt);
+  }
+  TOMOGRAPHER_ENABLED_IF(HasPointCache)
+  inline FnValueType _get_curptval(Replica & r)
+  {
+    return _mhwalker.fnLogVal(r.curpt, r.ptcache.cur);
+  }
+  TOMOGRAPHER_ENABLED_IF(!HasPointCache)
+  inline FnValueType _get_newptval(Replica & /*r*/, const PointType & newpt)
+  {
+    return _mhwalker.fnLogVal(newpt);
+  }
+  TOMOGRAPHER_ENABLED_IF(HasPointCache)
+  inline FnValueType _get_newptval(Replica & r, const PointType & newpt)
+  {
+    return _mhwalker.fnLogVal(newpt, r.ptcache.next);
+  }
+
+  // adjustments
+  template<bool IsThermalizing>
+  inline void _controller_adjust_afteriter(CountIntType iter_k)
+  {
+    MHRWControllerInvokerType::template invokeAdjustParams<IsThermalizing, false>(
+        _mhrw_controller, _n, _mhwalker, iter_k, *this
+        );
+  }
+  inline void _controller_adjust_aftersample(CountIntType iter_k)
+  {
+    MHRWControllerInvokerType::template invokeAdjustParams<false, true>(
+        _mhrw_controller, _n, _mhwalker, iter_k, *this
+        );
+  }
+  inline bool _controller_allow_therm_done(CountIntType iter_k)
+  {
+    return (iter_k % _n.n_sweep == 0) &&
+      MHRWControllerInvokerType::template invokeAllowDoneThermalization(
+        _mhrw_controller, _n, _mhwalker, iter_k, *this
+        );
+  }
+  inline bool _controller_allow_runs_done(CountIntType iter_k)
+  {
+    return (iter_k % _n.n_sweep == 0) &&
+      MHRWControllerInvokerType::template invokeAllowDoneRuns(
+        _mhrw_controller, _n, _mhwalker, iter_k, *this
+        );
+  }
+
+public:
+
+  /** \brief Run the random walk
+   *
+   * As \ref MHRandomWalk::run(), except that each iteration moves all the replicas, and
+   * that exchanges between replicas are proposed at the end of each sweep.
+   */
+  void run()
+  {
+    _init();
+
+    // make sure that the iteration counter will not overflow.
+    if (Tomographer::Tools::multiplicationWillOverflow(_n.n_sweep, _n.n_therm) ||
+        Tomographer::Tools::multiplicationWillOverflow(_n.n_sweep, _n.n_run)) {
+      std::string msg = streamstr(
+          "Error: integer type " << boost::core::demangle(typeid(CountIntType).name())
+          << " cannot be used to represent number of iterations, will overflow with given params "
+          << _n
+          );
+      _logger.error([&](std::ostream & stream) {
+          stream << msg;
+        });
+      throw std::runtime_error(msg);
+    }
+
+    CountIntType k;
+
+    _logger.longdebug([&](std::ostream & s) {
+	s << "Starting random walk, parameters are = " << _n;
+      });
+
+    for ( k = 0 ; (k < (_n.n_sweep * _n.n_therm)) || !_controller_allow_therm_done(k) ; ++k ) {
+      for (std::size_t i = 0; i < _replicas.size(); ++i) {
+        _move<true>(i, k, false);
+      }
+      _controller_adjust_afteriter<true>(k);
+      if ((k+1) % _n.n_sweep == 0) {
+        _swap_replicas();
+      }
+    }
+
+    _thermalizing_done();
+
+    _logger.longdebug("Thermalizing done, starting live runs.");
+
+    CountIntType n = 0; // number of live samples
+
+    for (k = 0 ; (k < (_n.n_sweep * _n.n_run)) || !_controller_allow_runs_done(k) ; ++k) {
+
+      bool is_live_iter = ((k+1) % _n.n_sweep == 0);
+
+      for (std::size_t i = 0; i < _replicas.size(); ++i) {
+        _move<false>(i, k, is_live_iter);
+      }
+      _controller_adjust_afteriter<false>(k);
+
+      if (is_live_iter) {
+        _process_sample(k, n);
+        ++n;
+        _controller_adjust_aftersample(k);
+        // exchange replicas only after the sample was taken
+        _swap_replicas();
+      }
+
+    }
+
+    _done();
+
+    _logger.longdebug("Random walk completed.");
+  }
+};
+
+
+} // namespace Tomographer
+
+
+#endif
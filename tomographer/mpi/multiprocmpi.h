@@ -145,6 +145,8 @@ public:
 
   typedef std::function<void(const FullStatusReportType&)> FullStatusReportCallbackType;
 
+  typedef std::function<void(TaskCountIntType, const TaskResultType&)> TaskCompletedCallbackType;
+
   TOMO_STATIC_ASSERT_EXPR(std::is_signed<TaskCountIntType>::value) ;
 
 private:
@@ -182,15 +184,19 @@ private:
         tasks_start_time(),
         interrupt_requested(0),
         interrupt_reacted(0),
-        full_task_results(),
-        task_results()
+        full_task_results((std::size_t)num_total_runs_, NULL),
+        task_results((std::size_t)num_total_runs_, NULL),
+        task_completed_fn()
     {
     }
 
     inline void start(int num_workers)
     {
-      // everything is left to do
-      num_tasks_completed = 0;
+      // everything is left to do, except for tasks whose results were provided already
+      num_tasks_completed = (TaskCountIntType)std::count_if(
+          task_results.begin(), task_results.end(),
+          [](const TaskResultType * r) { return r != NULL; }
+          );
       num_tasks_launched = 0;
       num_workers_running = num_workers;
       workers_running.resize((std::size_t)num_workers, 0);
@@ -206,6 +212,11 @@ private:
 
     inline TaskCountIntType pop_task()
     {
+      // skip tasks which are already completed
+      while (num_tasks_launched < num_total_runs
+             && task_results[(std::size_t)num_tasks_launched] != NULL) {
+        ++num_tasks_launched;
+      }
       if (num_tasks_launched >= num_total_runs) {
         return -1;
       }
@@ -237,6 +248,8 @@ private:
 
     std::vector<FullTaskResult*> full_task_results;
     std::vector<TaskResultType*> task_results; // for convenience, same as full_task_results[k].task_result's
+
+    TaskCompletedCallbackType task_completed_fn;
   };
 
   struct MasterStatusReportController {
@@ -847,6 +860,8 @@ private:
       // task ran into an error, we should interrupt everything.  This flag will
       // be picked up by us later.
       ctrl->interrupt_requested = true;
+    } else if (result->task_result != NULL && ctrl->task_completed_fn) {
+      ctrl->task_completed_fn(task_id, *result->task_result);
     }
 
     logger.debug("Saved into results.");
@@ -1080,6 +1095,55 @@ public:
     tomographer_assert(k >= 0 && k < ctrl->task_results.size()) ;
     return *ctrl->task_results[k];
   }
+
+
+  /** \brief Provide the result of a task which has already been completed
+   *
+   * The task number \a k will not be run; instead, \a result is reported as its result.
+   * This is useful to resume a computation which was interrupted, see \ref
+   * TaskResultsCheckpoint.  This function must be called before \ref run().
+   *
+   * The task dispatcher takes ownership of \a result, which must have been allocated with
+   * \a new.
+   *
+   * \warning Only the master process can call this function.
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  inline void setCompletedTaskResult(TaskCountIntType k, TaskResultType * result)
+  {
+    tomographer_assert(is_master);
+    tomographer_assert(ctrl != NULL) ;
+    tomographer_assert(k >= 0 && (std::size_t)k < ctrl->full_task_results.size()) ;
+    tomographer_assert(result != NULL) ;
+    FullTaskResult * & r = ctrl->full_task_results[(std::size_t)k];
+    if (r != NULL) {
+      if (r->task_result != NULL) {
+        delete r->task_result;
+      }
+      delete r;
+    }
+    r = new FullTaskResult(k, result);
+    ctrl->task_results[(std::size_t)k] = result;
+  }
+
+  /** \brief Assign a callable to be called each time a task has completed
+   *
+   * The callable \a fn is invoked in the master process as <code>fn(k, result)</code>
+   * each time the master has received the result of the task number \a k, where \a
+   * result is a const reference to the task's result.  It is not called for tasks whose
+   * result was set by \ref setCompletedTaskResult().
+   *
+   * \warning Only the master process can call this function.
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  template<typename Fn>
+  inline void setTaskCompletedHandler(Fn fn)
+  {
+    tomographer_assert(is_master);
+    ctrl->task_completed_fn = fn;
+  }
   
   
   /** \brief assign a callable to be called whenever a status report is requested
@@ -269,12 +269,16 @@ public:
 
   typedef std::function<void(const FullStatusReportType&)> FullStatusReportCallbackType;
 
+  typedef std::function<void(TaskCountIntType, const TaskResultType&)> TaskCompletedCallbackType;
+
 private:
   
   const TaskCData * pcdata;
   std::vector<TaskResultType*> results;
   LoggerType & logger;
 
+  TaskCompletedCallbackType task_completed_fn;
+
   TaskCountIntType num_total_runs;
   
   /** \brief current executing task number == number of completed tasks
@@ -380,7 +384,8 @@ private:
   
 public:
   TaskDispatcher(TaskCData * pcdata_, LoggerType & logger_, TaskCountIntType num_total_runs_)
-    : pcdata(pcdata_), results(), logger(logger_), num_total_runs(num_total_runs_),
+    : pcdata(pcdata_), results((std::size_t)num_total_runs_, NULL), logger(logger_),
+      task_completed_fn(), num_total_runs(num_total_runs_),
       mgriface(this)
   {
   }
@@ -398,11 +403,15 @@ public:
    */
   void run()
   {
-    results.resize((std::size_t)num_total_runs, NULL);
-    
     logger.debug("MultiProc::Sequential::TaskDispatcher::run()", "preparing for sequential runs");
     
     for (task_k = 0; task_k < num_total_runs; ++task_k) {
+
+      if (results[(std::size_t)task_k] != NULL) {
+        logger.debug("Tomographer::MultiProc::Sequential::TaskDispatcher::run()",
+                     [&](std::ostream & stream) { stream << "Task #" << task_k << " already completed"; });
+        continue;
+      }
       
       logger.debug("Tomographer::MultiProc::Sequential::TaskDispatcher::run()",
                    [&](std::ostream & stream) { stream << "Running task #" << task_k << " ..."; });
@@ -418,6 +427,10 @@ public:
       // and collect the result
       logger.longdebug("MultiProc::Sequential::TaskDispatcher::run()", "collecting result");
       results[(std::size_t)task_k] = new TaskResultType(t.stealResult());
+
+      if (task_completed_fn) {
+        task_completed_fn(task_k, *results[(std::size_t)task_k]);
+      }
     }
 
     // all done
@@ -442,6 +455,41 @@ public:
   inline const TaskResultType & collectedTaskResult(std::size_t k) const { return *results[k]; }
   
   
+  /** \brief Provide the result of a task which has already been completed
+   *
+   * The task number \a k will not be run; instead, \a result is reported as its result.
+   * This is useful to resume a computation which was interrupted, see \ref
+   * TaskResultsCheckpoint.  This function must be called before \ref run().
+   *
+   * The task dispatcher takes ownership of \a result, which must have been allocated with
+   * \a new.
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  inline void setCompletedTaskResult(TaskCountIntType k, TaskResultType * result)
+  {
+    tomographer_assert(k >= 0 && k < num_total_runs);
+    tomographer_assert(result != NULL);
+    if (results[(std::size_t)k] != NULL) {
+      delete results[(std::size_t)k];
+    }
+    results[(std::size_t)k] = result;
+  }
+
+  /** \brief Assign a callable to be called each time a task has completed
+   *
+   * The callable \a fn is invoked as <code>fn(k, result)</code> after the task number \a
+   * k has completed, where \a result is a const reference to the task's result.  It is
+   * not called for tasks whose result was set by \ref setCompletedTaskResult().
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  template<typename Fn>
+  inline void setTaskCompletedHandler(Fn fn)
+  {
+    task_completed_fn = fn;
+  }
+
   /** \brief assign a callable to be called whenever a status report is requested
    *
    * This function remembers the given \a fnstatus callable, so that each time that \ref
@@ -0,0 +1,383 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TOMOGRAPHER_MULTIPROCBATCH_H
+#define TOMOGRAPHER_MULTIPROCBATCH_H
+
+#include <cstddef>
+
+#include <vector>
+#include <algorithm> // std::upper_bound
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include <boost/serialization/serialization.hpp>
+
+#include <tomographer/tools/cxxutil.h>
+
+
+/** \file multiprocbatch.h
+ *
+ * \brief Run the tasks of several independent computations with a single task
+ *        dispatcher.
+ *
+ * See \ref Tomographer::MultiProc::BatchTaskCData, \ref
+ * Tomographer::MultiProc::BatchTask and \ref Tomographer::MultiProc::BatchItemResults.
+ */
+
+
+namespace Tomographer {
+namespace MultiProc {
+
+
+/** \brief The input to a \ref BatchTask
+ *
+ * Stores which item of the batch the task belongs to, the number of the task within that
+ * item, and the input of the task as returned by the item's \a getTaskInput().
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename ItemTaskInputType_, typename TaskCountIntType_ = int>
+struct TOMOGRAPHER_EXPORT BatchTaskInput
+{
+  //! The input type of the tasks of each item
+  typedef ItemTaskInputType_ ItemTaskInputType;
+  //! Integer type used to count the number of tasks
+  typedef TaskCountIntType_ TaskCountIntType;
+
+  //! Constructor
+  BatchTaskInput(std::size_t item_ = 0, TaskCountIntType item_task_k_ = 0,
+                 ItemTaskInputType input_ = ItemTaskInputType())
+    : item(item_), item_task_k(item_task_k_), input(std::move(input_))
+  {
+  }
+
+  //! The index of the item of the batch this task belongs to
+  std::size_t item;
+  //! The number of this task among the tasks of its item
+  TaskCountIntType item_task_k;
+  //! The input to the task, as returned by the item's \a getTaskInput()
+  ItemTaskInputType input;
+
+private:
+  friend class boost::serialization::access;
+  template<typename Archive>
+  void serialize(Archive & a, unsigned int /* version */)
+  {
+    a & item;
+    a & item_task_k;
+    a & input;
+  }
+};
+
+
+/** \brief A \ref pageInterfaceTaskCData which combines several independent computations
+ *
+ * Several computations (the "items" of the batch) which use the same task type \a Task
+ * and the same \a TaskCData type, but different \a TaskCData objects (e.g. the same
+ * analysis of different data sets), can be run with a single task dispatcher.  Combined
+ * with \ref BatchTask, each task is then run with the \a TaskCData of the item it belongs
+ * to.
+ *
+ * The tasks of all items are numbered consecutively: the tasks of the first item come
+ * first, then those of the second item, and so on.  Because the task dispatchers hand
+ * out tasks in order, the first items are completed first, while workers which become
+ * available near the end of an item already start with the tasks of the next item
+ * instead of waiting for the last tasks of the item to complete.  Use \ref
+ * BatchItemResults to process the results of each item as soon as all its tasks have
+ * completed.
+ *
+ * \code
+ *   BatchTaskCData<MyCData> batch;
+ *   batch.addItem(&cdata_1, num_runs_1);
+ *   batch.addItem(&cdata_2, num_runs_2);
+ *   TaskDispatcher<BatchTask<MyTask, MyCData>, BatchTaskCData<MyCData>, ...>
+ *     tasks(&batch, logger, batch.numTaskRuns(), ...);
+ *   tasks.run();
+ * \endcode
+ *
+ * This object only stores pointers to the \a TaskCData objects of the items, which must
+ * remain valid for as long as the tasks may run.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename TaskCData_, typename TaskCountIntType_ = int>
+class TOMOGRAPHER_EXPORT BatchTaskCData
+{
+public:
+  //! The \ref pageInterfaceTaskCData type of each item
+  typedef TaskCData_ TaskCData;
+  //! Integer type used to count the number of tasks
+  typedef TaskCountIntType_ TaskCountIntType;
+
+  //! The type returned by the \a getTaskInput() method of each item's \a TaskCData
+  typedef typename std::decay<
+    decltype(std::declval<const TaskCData &>().getTaskInput(std::declval<TaskCountIntType>()))
+    >::type  ItemTaskInputType;
+
+  //! The input type of the tasks of the batch, see \ref getTaskInput()
+  typedef BatchTaskInput<ItemTaskInputType, TaskCountIntType> TaskInputType;
+
+private:
+  std::vector<const TaskCData *> _items;
+  // _item_first_task[i] is the number of the first task of item i; the last element is the
+  // total number of tasks
+  std::vector<TaskCountIntType> _item_first_task;
+
+public:
+  //! Construct an empty batch.  Add items with \ref addItem().
+  BatchTaskCData()
+    : _items(), _item_first_task(1, 0)
+  {
+  }
+
+  /** \brief Add an item to the batch
+   *
+   * The item consists of \a num_task_runs tasks, whose inputs are provided by \a
+   * pcdata's \a getTaskInput().  Returns the index of the new item.
+   */
+  inline std::size_t addItem(const TaskCData * pcdata, TaskCountIntType num_task_runs)
+  {
+    tomographer_assert(pcdata != NULL);
+    tomographer_assert(num_task_runs >= 0);
+    _items.push_back(pcdata);
+    _item_first_task.push_back(_item_first_task.back() + num_task_runs);
+    return _items.size() - 1;
+  }
+
+  //! The number of items in the batch
+  inline std::size_t numItems() const { return _items.size(); }
+
+  //! The total number of tasks of all items.  Pass this number to the task dispatcher.
+  inline TaskCountIntType numTaskRuns() const { return _item_first_task.back(); }
+
+  //! The \a TaskCData of the item \a i
+  inline const TaskCData * itemCData(std::size_t i) const
+  {
+    tomographer_assert(i < _items.size());
+    return _items[i];
+  }
+
+  //! The number of tasks of the item \a i
+  inline TaskCountIntType itemNumTaskRuns(std::size_t i) const
+  {
+    tomographer_assert(i < _items.size());
+    return _item_first_task[i+1] - _item_first_task[i];
+  }
+
+  //! The number (in the batch) of the first task of the item \a i
+  inline TaskCountIntType itemFirstTask(std::size_t i) const
+  {
+    tomographer_assert(i < _items.size());
+    return _item_first_task[i];
+  }
+
+  //! The index of the item which the task number \a k belongs to
+  inline std::size_t itemOfTask(TaskCountIntType k) const
+  {
+    tomographer_assert(k >= 0 && k < numTaskRuns());
+    // the last item whose first task is <= k; this skips items without any tasks
+    return (std::size_t)(std::upper_bound(_item_first_task.begin(), _item_first_task.end(), k)
+                         - _item_first_task.begin()) - 1;
+  }
+
+  /** \brief Provide the input to the task number \a k of the batch
+   *
+   * Determines which item the task belongs to and queries that item's \a TaskCData for
+   * the task's input.
+   */
+  inline TaskInputType getTaskInput(TaskCountIntType k) const
+  {
+    const std::size_t i = itemOfTask(k);
+    const TaskCountIntType item_task_k = k - _item_first_task[i];
+    return TaskInputType(i, item_task_k, _items[i]->getTaskInput(item_task_k));
+  }
+};
+
+
+/** \brief A \ref pageInterfaceTask which runs a task of an item of a \ref BatchTaskCData
+ *
+ * This type wraps a \ref pageInterfaceTask \a Task such that it can be run by a task
+ * dispatcher whose \a TaskCData is a \ref BatchTaskCData.  The wrapped task is
+ * constructed and run with the \a TaskCData of the item it belongs to.  The result and
+ * status report types are those of \a Task.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename Task_, typename TaskCData_, typename TaskCountIntType_ = int>
+class TOMOGRAPHER_EXPORT BatchTask
+{
+public:
+  //! The task type which is run for each item
+  typedef Task_ Task;
+  //! The \ref pageInterfaceTaskCData type of each item
+  typedef TaskCData_ TaskCData;
+  //! The \ref BatchTaskCData type which stores all the items
+  typedef BatchTaskCData<TaskCData_, TaskCountIntType_> BatchTaskCDataType;
+
+  //! The result type of the task (see \ref pageInterfaceResultable)
+  typedef typename Task::ResultType ResultType;
+  //! The status report type of the task
+  typedef typename Task::StatusReportType StatusReportType;
+
+private:
+  const std::size_t _item;
+  Task _task;
+
+public:
+  //! Construct the task of the item given in \a input
+  template<typename LoggerType>
+  BatchTask(typename BatchTaskCDataType::TaskInputType input, const BatchTaskCDataType * pcdata,
+            LoggerType & logger)
+    : _item(input.item),
+      _task(std::move(input.input), pcdata->itemCData(input.item), logger)
+  {
+  }
+
+  //! Run the task with the \a TaskCData of its item
+  template<typename LoggerType, typename TaskManagerIface>
+  inline void run(const BatchTaskCDataType * pcdata, LoggerType & logger, TaskManagerIface * tmgriface)
+  {
+    _task.run(pcdata->itemCData(_item), logger, tmgriface);
+  }
+
+  //! The index of the item this task belongs to
+  inline std::size_t item() const { return _item; }
+
+  //! Get the result of the task (see \ref pageInterfaceResultable)
+  inline ResultType getResult() const { return _task.getResult(); }
+
+  //! Get the result of the task (see \ref pageInterfaceResultable)
+  inline ResultType stealResult() { return _task.stealResult(); }
+};
+
+
+
+/** \brief Collect the results of the tasks of a batch, item by item
+ *
+ * Attach this object to a task dispatcher running the tasks of a \ref BatchTaskCData.
+ * As soon as all the tasks of an item have completed, the callback given to the
+ * constructor is called as <code>fn(i, results)</code>, where \a i is the index of the
+ * item and \a results is a <code>std::vector<const TaskResultType*></code> with the
+ * results of all the tasks of that item, in order.  This way, the results of each item
+ * can be processed (e.g. saved to a file) while the tasks of the other items are still
+ * running.
+ *
+ * The callback is called from the thread in which the last task of the item completed
+ * (see the task dispatcher's \a setTaskCompletedHandler()), and never concurrently with
+ * itself.  The result pointers refer to the results stored by the task dispatcher, and
+ * remain valid as long as the task dispatcher exists.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename TaskResultType_, typename TaskCData_, typename TaskCountIntType_ = int>
+class TOMOGRAPHER_EXPORT BatchItemResults
+{
+public:
+  //! The type of the result of a single task
+  typedef TaskResultType_ TaskResultType;
+  //! The \ref BatchTaskCData type which stores all the items
+  typedef BatchTaskCData<TaskCData_, TaskCountIntType_> BatchTaskCDataType;
+  //! Integer type used to count the number of tasks
+  typedef TaskCountIntType_ TaskCountIntType;
+
+  //! The type of the callback which is called when all the tasks of an item have completed
+  typedef std::function<void(std::size_t, const std::vector<const TaskResultType*> &)>
+    ItemCompletedCallbackType;
+
+private:
+  const BatchTaskCDataType * _pbatch;
+  ItemCompletedCallbackType _item_completed_fn;
+
+  std::vector<std::vector<const TaskResultType*> > _item_results;
+  std::vector<TaskCountIntType> _item_num_completed;
+  std::size_t _num_completed_items;
+
+public:
+  //! Constructor.  The batch \a pbatch must not be modified afterwards.
+  BatchItemResults(const BatchTaskCDataType * pbatch, ItemCompletedCallbackType fn)
+    : _pbatch(pbatch),
+      _item_completed_fn(std::move(fn)),
+      _item_results(),
+      _item_num_completed(pbatch->numItems(), 0),
+      _num_completed_items(0)
+  {
+    _item_results.reserve(pbatch->numItems());
+    for (std::size_t i = 0; i < pbatch->numItems(); ++i) {
+      _item_results.push_back(
+          std::vector<const TaskResultType*>((std::size_t)pbatch->itemNumTaskRuns(i), NULL)
+          );
+    }
+  }
+
+  /** \brief Record that the task number \a k of the batch has completed
+   *
+   * This is called automatically by the task dispatcher once this object has been
+   * attached to it with \ref attach().  The \a result must remain valid for as long as
+   * this object is used.
+   */
+  inline void recordTaskResult(TaskCountIntType k, const TaskResultType & result)
+  {
+    const std::size_t i = _pbatch->itemOfTask(k);
+    const std::size_t item_task_k = (std::size_t)(k - _pbatch->itemFirstTask(i));
+    tomographer_assert(_item_results[i][item_task_k] == NULL);
+    _item_results[i][item_task_k] = & result;
+    if (++_item_num_completed[i] == _pbatch->itemNumTaskRuns(i)) {
+      ++_num_completed_items;
+      _item_completed_fn(i, _item_results[i]);
+    }
+  }
+
+  //! Whether all the tasks of the item \a i have completed
+  inline bool itemCompleted(std::size_t i) const
+  {
+    return _item_num_completed[i] == _pbatch->itemNumTaskRuns(i);
+  }
+
+  //! The number of items whose tasks have all completed
+  inline std::size_t numCompletedItems() const { return _num_completed_items; }
+
+  /** \brief Get notified by the task dispatcher \a tasks each time a task completes
+   *
+   * This object must remain valid until the tasks have finished running.
+   */
+  template<typename TaskDispatcherType>
+  inline void attach(TaskDispatcherType & tasks)
+  {
+    tasks.setTaskCompletedHandler([this](TaskCountIntType k, const TaskResultType & result) {
+        recordTaskResult(k, result);
+      });
+  }
+};
+
+
+} // namespace MultiProc
+} // namespace Tomographer
+
+
+#endif
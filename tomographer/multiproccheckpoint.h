@@ -0,0 +1,433 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TOMOGRAPHER_MULTIPROCCHECKPOINT_H
+#define TOMOGRAPHER_MULTIPROCCHECKPOINT_H
+
+#include <cstdio> // std::rename, std::remove
+#include <cstdint>
+
+#include <string>
+#include <map>
+#include <sstream>
+#include <fstream>
+
+#include <boost/serialization/serialization.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/archive/binary_iarchive.hpp>
+
+#include <tomographer/tools/cxxutil.h>
+#include <tomographer/tools/fmt.h>
+
+
+/** \file multiproccheckpoint.h
+ *
+ * \brief Save the results of completed tasks to a file, so that an interrupted
+ *        computation can be resumed.
+ *
+ * See \ref Tomographer::MultiProc::TaskResultsCheckpoint.
+ */
+
+
+namespace Tomographer {
+namespace MultiProc {
+
+
+/** \brief Error while reading or writing a checkpoint file
+ *
+ * \since Added in %Tomographer 5.5
+ */
+TOMOGRAPHER_DEFINE_MSG_EXCEPTION(CheckpointError, "Checkpoint error: ") ;
+
+
+/** \brief Save the results of completed tasks to a file, to resume an interrupted computation
+ *
+ * Each time a task completes, its result is serialized using Boost.Serialization and
+ * appended to a checkpoint file.  If the computation is interrupted (e.g. because the
+ * process was killed), then it can be resumed later: the results stored in the checkpoint
+ * file are reloaded with \ref load(), and only the tasks which were not completed are run
+ * again.
+ *
+ * Only the results of completed tasks are saved.  The state of the tasks which are
+ * running (e.g. the current point, the random number generator and the statistics
+ * collected so far by a random walk) is not saved, and these tasks are started again from
+ * scratch when the computation is resumed.  To lose less work, split the computation
+ * into more, shorter tasks.
+ *
+ * The file starts with a header identifying the computation, followed by one record per
+ * completed task.  Each record carries the size and a checksum of the serialized result,
+ * so that a record which was only partially written when the process was interrupted is
+ * detected and ignored by \ref load().  Before new records are appended, the file is
+ * rewritten with the results stored so far (through a temporary file which then replaces
+ * the checkpoint file), which also removes any such incomplete record.
+ *
+ * Use as follows:
+ * \code
+ *   TaskDispatcher tasks(...);
+ *   TaskResultsCheckpoint<TaskResultType> checkpoint("checkpoint.dat", num_total_runs, "my run");
+ *   if (resume) {
+ *     checkpoint.load();
+ *   }
+ *   checkpoint.attach(tasks);
+ *   tasks.run();
+ * \endcode
+ *
+ * The \a TaskResultType must be default-constructible and serializable with
+ * Boost.Serialization (these are the same requirements as for \ref
+ * MultiProc::MPI::TaskDispatcher).  The task dispatcher must provide the methods \a
+ * setCompletedTaskResult() and \a setTaskCompletedHandler() (see \ref
+ * pageInterfaceTaskDispatcher).
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename TaskResultType_, typename TaskCountIntType_ = int>
+class TOMOGRAPHER_EXPORT TaskResultsCheckpoint
+{
+public:
+  //! The type of the result of a single task
+  typedef TaskResultType_ TaskResultType;
+  //! Integer type used to count the number of tasks
+  typedef TaskCountIntType_ TaskCountIntType;
+
+  //! The version of the checkpoint file format
+  static constexpr int FormatVersion = 2;
+
+private:
+  const std::string _filename;
+  const TaskCountIntType _num_total_runs;
+  const std::string _run_signature;
+
+  // the serialized result of each completed task
+  std::map<TaskCountIntType, std::string> _serialized_results;
+
+  // the checkpoint file, open for appending new records once it was (re)written by write()
+  std::ofstream _append_stream;
+
+public:
+  /** \brief Constructor
+   *
+   * \param filename the name of the checkpoint file
+   *
+   * \param num_total_runs the total number of tasks in the computation
+   *
+   * \param run_signature an arbitrary string which identifies the computation, e.g. a
+   *        summary of its parameters.  When resuming, the checkpoint file is only accepted
+   *        if it was saved with the same run signature.
+   */
+  TaskResultsCheckpoint(std::string filename, TaskCountIntType num_total_runs,
+                        std::string run_signature = std::string())
+    : _filename(std::move(filename)),
+      _num_total_runs(num_total_runs),
+      _run_signature(std::move(run_signature)),
+      _serialized_results(),
+      _append_stream()
+  {
+  }
+
+  //! The name of the checkpoint file
+  inline const std::string & fileName() const { return _filename; }
+
+  //! The total number of tasks in the computation
+  inline TaskCountIntType numTaskRuns() const { return _num_total_runs; }
+
+  //! The number of tasks whose results are stored in this checkpoint
+  inline TaskCountIntType numCompletedTasks() const { return (TaskCountIntType)_serialized_results.size(); }
+
+  //! Whether the result of the task number \a k is stored in this checkpoint
+  inline bool hasTaskResult(TaskCountIntType k) const
+  {
+    return _serialized_results.find(k) != _serialized_results.end();
+  }
+
+  /** \brief Load the task results stored in the checkpoint file
+   *
+   * Returns \a false if the checkpoint file does not exist, in which case nothing is
+   * loaded.  Throws a \ref CheckpointError if the file can't be read, or if it was saved
+   * for a different computation (a different number of tasks or a different run
+   * signature).
+   */
+  inline bool load()
+  {
+    std::ifstream stream(_filename, std::ios::in | std::ios::binary);
+    if (!stream) {
+      return false;
+    }
+
+    std::string magic(_magic().size(), '\0');
+    stream.read(&magic[0], (std::streamsize)magic.size());
+    if (!stream || magic != _magic()) {
+      throw CheckpointError(_filename + " is not a task results checkpoint file");
+    }
+
+    std::uint32_t version = 0;
+    std::int64_t num_total_runs = -1;
+    std::uint64_t signature_size = 0;
+    _read_raw(stream, version);
+    if (stream && version == (std::uint32_t)FormatVersion) {
+      _read_raw(stream, num_total_runs);
+      _read_raw(stream, signature_size);
+    }
+    if (!stream) {
+      throw CheckpointError("Can't read header of " + _filename);
+    }
+    if (version != (std::uint32_t)FormatVersion) {
+      throw CheckpointError(streamstr("Unsupported checkpoint file format version " << version
+                                      << " in " << _filename));
+    }
+    if (num_total_runs != (std::int64_t)_num_total_runs) {
+      throw CheckpointError(streamstr("Checkpoint file " << _filename << " was saved for " << num_total_runs
+                                      << " tasks, but we have " << _num_total_runs << " tasks"));
+    }
+    // don't trust a corrupt size field with a huge allocation
+    if (signature_size != (std::uint64_t)_run_signature.size()) {
+      throw CheckpointError(streamstr("Checkpoint file " << _filename << " was saved for a different "
+                                      << "computation"));
+    }
+    std::string run_signature((std::size_t)signature_size, '\0');
+    stream.read(&run_signature[0], (std::streamsize)signature_size);
+    if (!stream) {
+      throw CheckpointError("Can't read header of " + _filename);
+    }
+    if (run_signature != _run_signature) {
+      throw CheckpointError(streamstr("Checkpoint file " << _filename << " was saved for a different "
+                                      << "computation: " << run_signature));
+    }
+
+    // read the records, up to the end of the file or up to a record which was not
+    // completely written
+    const std::streamoff data_start = stream.tellg();
+    stream.seekg(0, std::ios::end);
+    const std::uint64_t file_size = (std::uint64_t)stream.tellg();
+    stream.seekg(data_start);
+    std::uint64_t offset = (std::uint64_t)data_start;
+
+    std::map<TaskCountIntType, std::string> serialized_results;
+    for (;;) {
+      std::int64_t k = -1;
+      std::uint64_t size = 0;
+      _read_raw(stream, k);
+      _read_raw(stream, size);
+      if (!stream || k < 0 || k >= (std::int64_t)_num_total_runs
+          || size > file_size - offset || file_size - offset - size < RecordOverhead) {
+        break;
+      }
+      std::string data((std::size_t)size, '\0');
+      std::uint64_t checksum = 0;
+      stream.read(&data[0], (std::streamsize)size);
+      _read_raw(stream, checksum);
+      if (!stream || checksum != _checksum(k, data)) {
+        break;
+      }
+      serialized_results[(TaskCountIntType)k] = std::move(data);
+      offset += RecordOverhead + size;
+    }
+
+    _serialized_results = std::move(serialized_results);
+    return true;
+  }
+
+  /** \brief Get a copy of the result of the task number \a k stored in this checkpoint
+   *
+   * The result is allocated with \a new and the caller takes ownership of it.
+   */
+  inline TaskResultType * getTaskResult(TaskCountIntType k) const
+  {
+    auto it = _serialized_results.find(k);
+    tomographer_assert(it != _serialized_results.end());
+
+    std::istringstream stream(it->second);
+    TaskResultType * result = new TaskResultType();
+    try {
+      boost::archive::binary_iarchive ia(stream);
+      ia >> *result;
+    } catch (const boost::archive::archive_exception & e) {
+      delete result;
+      throw CheckpointError(streamstr("Can't read result of task #" << k << " from " << _filename
+                                      << ": " << e.what()));
+    }
+    return result;
+  }
+
+  /** \brief Store the result of the completed task number \a k, and write the checkpoint file
+   */
+  inline void recordTaskResult(TaskCountIntType k, const TaskResultType & result)
+  {
+    tomographer_assert(k >= 0 && k < _num_total_runs);
+
+    std::ostringstream stream;
+    {
+      boost::archive::binary_oarchive oa(stream);
+      oa << result;
+    }
+    _serialized_results[k] = stream.str();
+
+    if (!_append_stream.is_open()) {
+      // start a new checkpoint file with the results we have so far, including this one
+      write();
+      return;
+    }
+    _write_record(_append_stream, k, _serialized_results[k]);
+    _append_stream.flush();
+    if (!_append_stream) {
+      throw CheckpointError("Error writing to " + _filename);
+    }
+  }
+
+  /** \brief Write the checkpoint file with all the task results stored so far
+   *
+   * This replaces the checkpoint file.  Results which are recorded afterwards with \ref
+   * recordTaskResult() are appended to the file.
+   *
+   * Throws a \ref CheckpointError if the file can't be written.
+   */
+  inline void write()
+  {
+    if (_append_stream.is_open()) {
+      _append_stream.close();
+    }
+    const std::string tmpfilename = _filename + ".tmp";
+    {
+      std::ofstream stream(tmpfilename, std::ios::out | std::ios::binary | std::ios::trunc);
+      if (!stream) {
+        throw CheckpointError("Can't open " + tmpfilename + " for writing");
+      }
+      const std::string magic = _magic();
+      stream.write(magic.data(), (std::streamsize)magic.size());
+      _write_raw(stream, (std::uint32_t)FormatVersion);
+      _write_raw(stream, (std::int64_t)_num_total_runs);
+      _write_raw(stream, (std::uint64_t)_run_signature.size());
+      stream.write(_run_signature.data(), (std::streamsize)_run_signature.size());
+      for (const auto & r : _serialized_results) {
+        _write_record(stream, r.first, r.second);
+      }
+      stream.close();
+      if (!stream) {
+        throw CheckpointError("Error writing to " + tmpfilename);
+      }
+    }
+    if (std::rename(tmpfilename.c_str(), _filename.c_str()) != 0) {
+      // some platforms don't allow to rename onto an existing file
+      std::remove(_filename.c_str());
+      if (std::rename(tmpfilename.c_str(), _filename.c_str()) != 0) {
+        throw CheckpointError("Can't rename " + tmpfilename + " to " + _filename);
+      }
+    }
+    _append_stream.open(_filename, std::ios::out | std::ios::binary | std::ios::app);
+    if (!_append_stream) {
+      throw CheckpointError("Can't open " + _filename + " for writing");
+    }
+  }
+
+  /** \brief Connect this checkpoint to a task dispatcher
+   *
+   * The results loaded from the checkpoint file are handed over to the task dispatcher
+   * with its \a setCompletedTaskResult() method, so that these tasks are not run again.
+   * The checkpoint file is then rewritten with these results (see \ref write()), and the
+   * result of each task which completes is appended to it.
+   *
+   * This object must remain valid until the tasks have finished running.
+   */
+  template<typename TaskDispatcherType>
+  inline void attach(TaskDispatcherType & tasks)
+  {
+    for (const auto & r : _serialized_results) {
+      tasks.setCompletedTaskResult(r.first, getTaskResult(r.first));
+    }
+    write();
+    tasks.setTaskCompletedHandler([this](TaskCountIntType k, const TaskResultType & result) {
+        recordTaskResult(k, result);
+      });
+  }
+
+  /** \brief Remove the checkpoint file
+   *
+   * This may be called once the computation has completed successfully and its results
+   * were saved.
+   */
+  inline void remove()
+  {
+    if (_append_stream.is_open()) {
+      _append_stream.close();
+    }
+    std::remove(_filename.c_str());
+  }
+
+private:
+  static inline std::string _magic() { return "TOMOGRAPHER-CHECKPOINT\n"; }
+
+  // task index, size of the serialized result and checksum
+  static constexpr std::uint64_t RecordOverhead = 24;
+
+  template<typename T>
+  static inline void _write_raw(std::ostream & stream, T value)
+  {
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+  template<typename T>
+  static inline void _read_raw(std::istream & stream, T & value)
+  {
+    stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+  }
+
+  static inline void _write_record(std::ostream & stream, TaskCountIntType k, const std::string & data)
+  {
+    _write_raw(stream, (std::int64_t)k);
+    _write_raw(stream, (std::uint64_t)data.size());
+    stream.write(data.data(), (std::streamsize)data.size());
+    _write_raw(stream, _checksum((std::int64_t)k, data));
+  }
+
+  // FNV-1a hash of the task index and the serialized result
+  static inline std::uint64_t _checksum(std::int64_t k, const std::string & data)
+  {
+    std::uint64_t h = 14695981039346656037ULL;
+    const auto feed = [&h](unsigned char c) {
+      h ^= c;
+      h *= 1099511628211ULL;
+    };
+    for (std::size_t i = 0; i < sizeof(k); ++i) {
+      feed((unsigned char)(((std::uint64_t)k >> (8*i)) & 0xff));
+    }
+    for (char c : data) {
+      feed((unsigned char)c);
+    }
+    return h;
+  }
+};
+
+template<typename TaskResultType_, typename TaskCountIntType_>
+constexpr int TaskResultsCheckpoint<TaskResultType_, TaskCountIntType_>::FormatVersion;
+template<typename TaskResultType_, typename TaskCountIntType_>
+constexpr std::uint64_t TaskResultsCheckpoint<TaskResultType_, TaskCountIntType_>::RecordOverhead;
+
+
+} // namespace MultiProc
+} // namespace Tomographer
+
+
+#endif
@@ -314,6 +314,13 @@ public:
    */
   using typename Base::FullStatusReportCallbackType;
 
+  /** \brief The type of a callback function (or callable) which is invoked each time a
+   *         task has completed
+   *
+   * See \ref setTaskCompletedHandler().
+   */
+  using typename Base::TaskCompletedCallbackType;
+
 private:
 
   typedef typename Base::template ThreadSharedData<TaskCData, LoggerType>
@@ -515,6 +522,38 @@ public:
   }
 
 
+  /** \brief Provide the result of a task which has already been completed
+   *
+   * The task number \a k will not be run; instead, \a result is reported as its
+   * result.  This is useful to resume a computation which was interrupted, see
+   * \ref TaskResultsCheckpoint.  This function must be called before \ref run().
+   *
+   * The task dispatcher takes ownership of \a result, which must have been
+   * allocated with \a new.
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  inline void setCompletedTaskResult(TaskCountIntType k, TaskResultType * result)
+  {
+    shared_data.set_completed_task_result(k, result);
+  }
+
+  /** \brief Assign a callable to be called each time a task has completed
+   *
+   * The callable \a fn is invoked as <code>fn(k, result)</code> after the task
+   * number \a k has completed, where \a result is a const reference to the
+   * task's result.  It may be called from any thread, but never concurrently
+   * with itself or with the status report handler.  It is not called for tasks
+   * whose result was set by \ref setCompletedTaskResult().
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  inline void setTaskCompletedHandler(TaskCompletedCallbackType fn)
+  {
+    shared_data.task_completed_fn = fn;
+  }
+
+
   
   /** \brief assign a callable to be called whenever a status report is 
    *         requested
@@ -119,6 +119,14 @@ public:
    */
   typedef std::function<void(const FullStatusReportType&)> FullStatusReportCallbackType;
 
+  /** \brief The type of a callback function (or callable) which is invoked each time a
+   *         task has completed
+   *
+   * This is the type used as argument to a subclass' \a setTaskCompletedHandler() method
+   * (see \ref pageInterfaceTaskDispatcher).
+   */
+  typedef std::function<void(TaskCountIntType, const TaskResultType&)> TaskCompletedCallbackType;
+
   // \a TaskCountIntType must be a signed integer type, because we might need to set the
   // special value \a -1
   TOMO_STATIC_ASSERT_EXPR(std::is_signed<TaskCountIntType>::value) ;
@@ -151,7 +159,8 @@ protected:
         logger(logger_),
         time_start(StdClockType::now()),
         schedule(num_total_runs, num_threads),
-        status_report()
+        status_report(),
+        task_completed_fn()
     {
     }
 
@@ -161,7 +170,8 @@ protected:
         logger(x.logger),
         time_start(std::move(x.time_start)),
         schedule(std::move(x.schedule)),
-        status_report(std::move(x.status_report))
+        status_report(std::move(x.status_report)),
+        task_completed_fn(std::move(x.task_completed_fn))
     { }
 
     ~ThreadSharedData()
@@ -263,6 +273,22 @@ protected:
       }
     };
     StatusReport status_report;
+
+    //! Called each time a task has completed, if set
+    TaskCompletedCallbackType task_completed_fn;
+
+    //! Store the result of a task which has already been completed; it won't be run
+    inline void set_completed_task_result(TaskCountIntType k, TaskResultType * result)
+    {
+      tomographer_assert(k >= 0 && k < schedule.num_total_runs);
+      tomographer_assert(result != NULL);
+      if (results[(std::size_t)k] != NULL) {
+        delete results[(std::size_t)k];
+      } else {
+        ++ schedule.num_completed;
+      }
+      results[(std::size_t)k] = result;
+    }
   };
 
   //! thread-local variables and stuff &mdash; also serves as TaskManagerIface
@@ -579,6 +605,14 @@ protected:
         throw TaskInterruptedInnerException();
       }
 
+      // nothing to do if the task's result was already provided
+      if (shared_data.results[(std::size_t)private_data.task_id] != NULL) {
+        logger.longdebug([&](std::ostream & stream) {
+            stream << "Task #" << private_data.task_id << " already completed";
+          }) ;
+        return;
+      }
+
       logger.longdebug([&](std::ostream & stream) {
           stream << "Run #" << private_data.task_id << ": querying CData for task input";
         }) ;
@@ -615,6 +649,13 @@ protected:
           ++ shared_data.schedule.num_completed;
         }) ;
 
+      if (shared_data.task_completed_fn) {
+        private_data.locker.critical_status_report_and_user_fn([&]() {
+            shared_data.task_completed_fn(private_data.task_id,
+                                          *shared_data.results[(std::size_t)private_data.task_id]);
+          }) ;
+      }
+
       logger.longdebug([&](std::ostream & stream) {
           stream << "Task #" << private_data.task_id << " done.";
         }) ;
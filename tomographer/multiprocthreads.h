@@ -37,6 +37,7 @@
 #include <tomographer/tools/loggers.h>
 #include <tomographer/tools/cxxutil.h> // tomographer_assert()
 #include <tomographer/tools/needownoperatornew.h>
+#include <tomographer/tools/cputopology.h>
 #include <tomographer/multiproc.h>
 #include <tomographer/multiprocthreadcommon.h>
 
@@ -284,6 +285,13 @@ public:
    */
   using typename Base::FullStatusReportCallbackType;
 
+  /** \brief The type of a callback function (or callable) which is invoked each time a
+   *         task has completed
+   *
+   * See \ref setTaskCompletedHandler().
+   */
+  using typename Base::TaskCompletedCallbackType;
+
 private:
 
   typedef typename Base::template ThreadSharedData<TaskCData, LoggerType>
@@ -329,6 +337,8 @@ private:
   };
 
   CriticalSectionManager critical;
+
+  Tools::ThreadAffinity thread_affinity;
   
   typedef typename Base::template ThreadPrivateData<
     ThreadSharedDataType,
@@ -360,14 +370,16 @@ public:
                  int num_threads = 0)
     : shared_data(pcdata, logger, num_total_runs,
                   ((num_threads > 0) ? num_threads
-                   : (int)std::min(num_total_runs, (TaskCountIntType)std::thread::hardware_concurrency())) )
+                   : (int)std::min(num_total_runs, (TaskCountIntType)std::thread::hardware_concurrency())) ),
+      thread_affinity()
   {
   }
 
   TaskDispatcher(TaskDispatcher && other)
-    : shared_data(std::move(other.shared_data))
+    : shared_data(std::move(other.shared_data)),
     // critical(std::move(other.critical)) -- mutexes are not movable, so just
     //                                        use new ones...  ugly :(
+      thread_affinity(std::move(other.thread_affinity))
   {
   }
 
@@ -389,6 +401,18 @@ public:
     
     logger.debug("Preparing for parallel runs");
 
+    // the CPUs to which each thread is pinned (empty if we don't pin threads)
+    std::vector<std::vector<int> > thread_cpus;
+    if (thread_affinity.policy != Tools::THREAD_AFFINITY_NONE) {
+      const Tools::CpuTopology topology = Tools::CpuTopology::detect();
+      thread_cpus = thread_affinity.assignCpus(topology, shared_data.schedule.num_threads);
+      logger.debug([&](std::ostream & stream) {
+          stream << "CPU topology: " << topology.summary() << "\n"
+                 << "Thread affinity (" << thread_affinity.toString() << "): "
+                 << Tools::formatThreadCpus(thread_cpus);
+        });
+    }
+
     auto worker_fn_id = [&](const int thread_id) noexcept(true) {
       
       // construct a thread-safe logger we can use
@@ -397,6 +421,26 @@ public:
       Tomographer::Logger::LocalLogger<TaskLoggerType> locallogger(
           logger.originPrefix()+logger.glue()+"worker",
           threadsafelogger);
+
+      // pin the thread to its CPUs (with a NUMA-aware placement, the memory allocated by the
+      // tasks on this thread is then local).  The master thread is the caller's thread, so
+      // restore its affinity when we're done.
+      std::vector<int> saved_affinity;
+      if (!thread_cpus.empty()) {
+        if (thread_id == 0) {
+          saved_affinity = Tools::getCurrentThreadAffinity();
+        }
+        if (!Tools::setCurrentThreadAffinity(thread_cpus[(std::size_t)thread_id])) {
+          locallogger.warning([&](std::ostream & stream) {
+              stream << "Thread #" << thread_id << ": could not set CPU affinity";
+            });
+        }
+      }
+      auto _f_affinity = Tools::finally([&]() {
+          if (!saved_affinity.empty()) {
+            Tools::setCurrentThreadAffinity(saved_affinity);
+          }
+        });
       
       ThreadPrivateDataType private_data(thread_id, & shared_data, locallogger,
                                          critical);
@@ -511,6 +555,81 @@ public:
   }
 
 
+  /** \brief Provide the result of a task which has already been completed
+   *
+   * The task number \a k will not be run; instead, \a result is reported as its
+   * result.  This is useful to resume a computation which was interrupted, see
+   * \ref TaskResultsCheckpoint.  This function must be called before \ref run().
+   *
+   * The task dispatcher takes ownership of \a result, which must have been
+   * allocated with \a new.
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  inline void setCompletedTaskResult(TaskCountIntType k, TaskResultType * result)
+  {
+    shared_data.set_completed_task_result(k, result);
+  }
+
+  /** \brief Place the worker threads on the NUMA nodes of the machine
+   *
+   * If \a numa_aware_ is \c true, then on a machine with several NUMA nodes, the worker
+   * threads are distributed evenly over the nodes and each thread is pinned to the CPUs
+   * of its node.  The tasks are constructed and run in their worker thread, so the memory
+   * they allocate (e.g. the state of the random walk) is placed on the local node.  Use
+   * \ref Tools::NumaReplicated in the TaskCData to give each node its own copy of large
+   * read-only data.
+   *
+   * This has no effect on machines with a single NUMA node, or on platforms on which
+   * thread pinning is not supported (see \ref cputopology.h).  This function must be
+   * called before \ref run().
+   *
+   * This is the same as calling \ref setThreadAffinity() with the policy \ref
+   * Tools::THREAD_AFFINITY_NUMA_NODES (or \ref Tools::THREAD_AFFINITY_NONE if \a
+   * numa_aware_ is \c false).
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  inline void setNumaAware(bool numa_aware_)
+  {
+    thread_affinity = Tools::ThreadAffinity(numa_aware_ ? Tools::THREAD_AFFINITY_NUMA_NODES
+                                            : Tools::THREAD_AFFINITY_NONE);
+  }
+
+  /** \brief Pin the worker threads to CPUs according to the given policy
+   *
+   * Thread number \a k is pinned to the CPUs given by \a
+   * affinity.assignCpus(topology, num_threads)[k] (see \ref Tools::ThreadAffinity), for
+   * the topology detected when \ref run() is called.  Together with the number of threads
+   * given to the constructor, this allows e.g. to use only one thread per physical core,
+   * or to stay within a given set of CPUs.  The assignment is logged with level \c DEBUG.
+   *
+   * This has no effect on platforms on which thread pinning is not supported (see \ref
+   * cputopology.h).  This function must be called before \ref run().
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  inline void setThreadAffinity(Tools::ThreadAffinity affinity)
+  {
+    thread_affinity = std::move(affinity);
+  }
+
+  /** \brief Assign a callable to be called each time a task has completed
+   *
+   * The callable \a fn is invoked as <code>fn(k, result)</code> after the task
+   * number \a k has completed, where \a result is a const reference to the
+   * task's result.  It may be called from any thread, but never concurrently
+   * with itself or with the status report handler.  It is not called for tasks
+   * whose result was set by \ref setCompletedTaskResult().
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  inline void setTaskCompletedHandler(TaskCompletedCallbackType fn)
+  {
+    shared_data.task_completed_fn = fn;
+  }
+
+
   /** \brief assign a callable to be called whenever a status report is
    *         requested
    *
@@ -0,0 +1,320 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TOMOGRAPHER_QUERRORBARS_H
+#define TOMOGRAPHER_QUERRORBARS_H
+
+#include <cmath>
+
+#include <limits>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <initializer_list>
+
+#include <Eigen/Core>
+#include <Eigen/QR>
+
+#include <tomographer/tools/cxxutil.h>
+#include <tomographer/tools/fmt.h>
+#include <tomographer/tools/needownoperatornew.h>
+
+
+/** \file querrorbars.h
+ *
+ * \brief Fit the histogram of a figure of merit and calculate the quantum error bars.
+ *
+ * This is a C++ implementation of the default fit model of the Python module \c
+ * tomographer.querrorbars.  See \ref Tomographer::fitHistogramA2() and \ref
+ * Tomographer::quantumErrorBarsFromFitA2().
+ */
+
+
+namespace Tomographer {
+
+
+/** \brief Error raised when a histogram cannot be fitted
+ *
+ * \since Added in %Tomographer 5.5
+ */
+TOMOGRAPHER_DEFINE_MSG_EXCEPTION(HistogramFitError, "Histogram fit failed: ") ;
+
+
+/** \brief Transformation from the figure of merit \f$ f \f$ to the natural fit variable
+ *         \f$ x \f$
+ *
+ * The transformation is \f$ x = s\,(f - h) \f$, or \f$ f = s\,x + h \f$, where \f$ s =
+ * \pm 1 \f$.  For instance, for the fidelity one should use \f$ x = 1 - f \f$, i.e., \f$ h
+ * = 1 \f$ and \f$ s = -1 \f$.  This is the same as the \c ftox argument of the Python
+ * class \c tomographer.querrorbars.HistogramAnalysis.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename RealScalar_ = double>
+struct TOMOGRAPHER_EXPORT FigureOfMeritToX
+{
+  typedef RealScalar_ RealScalar;
+
+  //! Constructor. Throws \a std::invalid_argument if \a s_ is not \f$ \pm 1 \f$.
+  FigureOfMeritToX(RealScalar h_ = RealScalar(0), int s_ = 1)
+    : h(h_), s(s_)
+  {
+    if (s != 1 && s != -1) {
+      throw std::invalid_argument(streamstr("FigureOfMeritToX: s must be +1 or -1, got " << s));
+    }
+  }
+
+  //! The offset \f$ h \f$
+  RealScalar h;
+  //! The sign \f$ s \f$
+  int s;
+
+  //! Calculate \f$ x \f$ from \f$ f \f$
+  inline RealScalar x(RealScalar f) const { return RealScalar(s) * (f - h); }
+  //! Calculate \f$ f \f$ from \f$ x \f$
+  inline RealScalar f(RealScalar x) const { return RealScalar(s) * x + h; }
+};
+
+
+/** \brief The quantum error bars
+ *
+ * These are the parameters of the deskewed Gaussian fitted to the histogram, given by
+ * \f$ \exp(-(x-x_0)^2/\Delta^2 + y_0) \f$, along with the skewness \f$ \gamma \f$.  The
+ * center \f$ f_0 \f$ is expressed as a value of the figure of merit.  This is the same as
+ * the \c QuantumErrorBars named tuple of the Python module \c tomographer.querrorbars.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename RealScalar_ = double>
+struct TOMOGRAPHER_EXPORT QuantumErrorBars
+{
+  typedef RealScalar_ RealScalar;
+
+  QuantumErrorBars(RealScalar f0_ = 0, RealScalar Delta_ = 0, RealScalar gamma_ = 0, RealScalar y0_ = 0)
+    : f0(f0_), Delta(Delta_), gamma(gamma_), y0(y0_)
+  {
+  }
+
+  RealScalar f0;
+  RealScalar Delta;
+  RealScalar gamma;
+  RealScalar y0;
+};
+
+
+/** \brief The result of \ref fitHistogramA2()
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename RealScalar_ = double>
+struct TOMOGRAPHER_EXPORT HistogramFitA2Result
+  : public virtual Tools::NeedOwnOperatorNew<Eigen::Matrix<RealScalar_, 4, 4> >::ProviderType
+{
+  typedef RealScalar_ RealScalar;
+  //! Type used to store the fit parameters \f$ (a_2, a_1, m, c) \f$
+  typedef Eigen::Matrix<RealScalar, 4, 1> ParamsType;
+  //! Type used to store the covariance matrix of the fit parameters
+  typedef Eigen::Matrix<RealScalar, 4, 4> CovType;
+
+  HistogramFitA2Result()
+    : params(ParamsType::Zero()), cov(CovType::Zero()), chi2(0), redchi2(0), num_points(0)
+  {
+  }
+
+  //! The fit parameters, in the order \f$ (a_2, a_1, m, c) \f$
+  ParamsType params;
+  /** \brief The covariance matrix of the fit parameters
+   *
+   * This is \f$ (J^T J)^{-1} \f$, where \f$ J \f$ is the Jacobian of the weighted
+   * residuals, as returned by \c scipy.optimize.curve_fit(..., absolute_sigma=True).
+   */
+  CovType cov;
+  //! The chi-squared statistic, \f$ \sum_k (y_k - y(x_k))^2/\sigma_k^2 \f$
+  RealScalar chi2;
+  //! The reduced chi-squared statistic, \ref chi2 divided by the number of degrees of freedom
+  RealScalar redchi2;
+  //! The number of histogram bins which were used in the fit
+  Eigen::Index num_points;
+
+  inline RealScalar a2() const { return params(0); }
+  inline RealScalar a1() const { return params(1); }
+  inline RealScalar m() const { return params(2); }
+  inline RealScalar c() const { return params(3); }
+};
+
+
+namespace tomo_internal {
+
+// Solve the weighted linear least-squares problem min |A*p - b|^2, where the parameters
+// which are not selected by free_mask are fixed to zero.  Returns the chi2.
+template<typename MatrixType, typename VectorType, typename ParamsType>
+inline typename VectorType::Scalar lsq_with_free_params(const MatrixType & A, const VectorType & b,
+                                                        int free_mask, ParamsType & p)
+{
+  std::vector<Eigen::Index> free;
+  for (Eigen::Index j = 0; j < A.cols(); ++j) {
+    if (free_mask & (1 << j)) {
+      free.push_back(j);
+    }
+  }
+  MatrixType Afree(A.rows(), (Eigen::Index)free.size());
+  for (std::size_t k = 0; k < free.size(); ++k) {
+    Afree.col(k) = A.col(free[k]);
+  }
+  const VectorType pfree = Afree.colPivHouseholderQr().solve(b);
+  p.setZero();
+  for (std::size_t k = 0; k < free.size(); ++k) {
+    p(free[k]) = pfree(k);
+  }
+  return (A * p - b).squaredNorm();
+}
+
+} // namespace tomo_internal
+
+
+/** \brief Fit the histogram of a figure of merit with the default fit model
+ *
+ * The histogram is first normalized (see \ref HistogramWithErrorBars::normalized()).
+ * The logarithm of the normalized bin values \f$ p_k \f$ is then fitted by weighted least
+ * squares to the model
+ * \f[
+ *   y(x) = -a_2\,x^2 - a_1\,x + m\,\ln(x) + c\ ,
+ * \f]
+ * where \f$ x \f$ is obtained from the center value \f$ f \f$ of each bin by the
+ * transformation \a ftox.  Each point is weighted by its error bar \f$ \sigma_k =
+ * \delta_k / p_k \f$, and the parameters are constrained to \f$ a_2 \geq 0 \f$ and \f$ m
+ * \geq 0 \f$.  This is the fit performed by the Python class \c
+ * tomographer.querrorbars.HistogramAnalysis with its default fit model \c "a2".
+ *
+ * As the model is linear in its parameters, the fit is an exact linear least-squares
+ * problem.  It is solved directly, without any iterative optimization: the constrained
+ * minimum is the best feasible solution among the four problems in which either, both
+ * or none of \f$ a_2 \f$ and \f$ m \f$ are set to zero.
+ *
+ * Only bins with \f$ p_k \f$ larger than \a threshold_fraction times the maximal bin
+ * value are used.  Bins with \f$ x \leq 0 \f$ (where the model is not defined) or with a
+ * vanishing error bar are ignored as well.
+ *
+ * \tparam HistogramType a \ref HistogramWithErrorBars type.
+ *
+ * Throws \ref HistogramFitError if fewer than five bins can be used for the fit.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename HistogramType, typename RealScalar = typename HistogramType::Scalar>
+inline HistogramFitA2Result<RealScalar> fitHistogramA2(const HistogramType & histogram,
+                                                        FigureOfMeritToX<RealScalar> ftox
+                                                        = FigureOfMeritToX<RealScalar>(),
+                                                        RealScalar threshold_fraction = 0)
+{
+  typedef Eigen::Matrix<RealScalar, Eigen::Dynamic, Eigen::Dynamic> MatrixType;
+  typedef Eigen::Matrix<RealScalar, Eigen::Dynamic, 1> VectorType;
+  typedef typename HistogramFitA2Result<RealScalar>::ParamsType ParamsType;
+
+  const auto h = histogram.template normalized<RealScalar>();
+  const Eigen::Array<RealScalar, Eigen::Dynamic, 1> fvals = h.params.valuesCenter();
+  const RealScalar thres = threshold_fraction * h.bins.maxCoeff();
+
+  // weighted design matrix and data
+  MatrixType A(h.params.num_bins, 4);
+  VectorType b(h.params.num_bins);
+  Eigen::Index n = 0;
+  for (Eigen::Index k = 0; k < h.params.num_bins; ++k) {
+    const RealScalar p = h.bins(k);
+    const RealScalar x = ftox.x(fvals(k));
+    const RealScalar sigma = h.delta(k) / p;
+    if ( !(p > thres) || !(p > 0) || !(x > 0) || !(sigma > 0) ) {
+      continue;
+    }
+    A(n,0) = - x * x / sigma;
+    A(n,1) = - x / sigma;
+    A(n,2) = std::log(x) / sigma;
+    A(n,3) = RealScalar(1) / sigma;
+    b(n) = std::log(p) / sigma;
+    ++n;
+  }
+  if (n <= 4) {
+    throw HistogramFitError(streamstr("Not enough histogram points for the fit (" << n << ")"));
+  }
+  A.conservativeResize(n, Eigen::NoChange);
+  b.conservativeResize(n);
+
+  HistogramFitA2Result<RealScalar> result;
+  result.num_points = n;
+  result.chi2 = std::numeric_limits<RealScalar>::infinity();
+
+  // a2 is parameter #0 and m is parameter #2; try all ways of pinning them to zero
+  for (int free_mask : { 0xF, 0xF & ~0x1, 0xF & ~0x4, 0xF & ~0x5 }) {
+    ParamsType p;
+    const RealScalar chi2 = tomo_internal::lsq_with_free_params(A, b, free_mask, p);
+    if (p(0) >= 0 && p(2) >= 0 && chi2 < result.chi2) {
+      result.params = p;
+      result.chi2 = chi2;
+    }
+  }
+
+  result.cov = (A.transpose() * A).inverse();
+  result.redchi2 = result.chi2 / RealScalar(n - 4);
+  return result;
+}
+
+
+/** \brief Calculate the quantum error bars from the parameters of the default fit model
+ *
+ * The fitted curve \f$ y(x) \f$ is deskewed to obtain a second order approximation at its
+ * peak.  This is the same calculation as the Python class \c
+ * tomographer.querrorbars.FitParamToQuErrorBars_a2.
+ *
+ * Throws \ref HistogramFitError if \f$ a_2 < 0 \f$.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename RealScalar>
+inline QuantumErrorBars<RealScalar> quantumErrorBarsFromFitA2(const HistogramFitA2Result<RealScalar> & fit,
+                                                              FigureOfMeritToX<RealScalar> ftox
+                                                              = FigureOfMeritToX<RealScalar>())
+{
+  const RealScalar a2 = fit.a2(), a1 = fit.a1(), m = fit.m(), c = fit.c();
+  if (a2 < 0) {
+    throw HistogramFitError(streamstr("Invalid value of a2: " << a2 << " < 0"));
+  }
+  RealScalar x0;
+  if (a2 < RealScalar(1e-6)) {
+    x0 = m / a1;
+  } else {
+    x0 = (std::sqrt(a1*a1 + 8*a2*m) - a1) / (4*a2);
+  }
+  const RealScalar y0 = -a2*x0*x0 - a1*x0 + m*std::log(x0) + c;
+  const RealScalar a = a2 + m / (2*x0*x0);
+  return QuantumErrorBars<RealScalar>(ftox.f(x0), 1 / std::sqrt(a), m / (6*a*a*x0*x0*x0), y0);
+}
+
+
+} // namespace Tomographer
+
+
+#endif
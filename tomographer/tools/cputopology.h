@@ -0,0 +1,656 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TOMOGRAPHER_TOOLS_CPUTOPOLOGY_H
+#define TOMOGRAPHER_TOOLS_CPUTOPOLOGY_H
+
+
+/** \file cputopology.h
+ *
+ * \brief Detect the CPUs and NUMA nodes of the machine, pin threads to CPUs, and keep
+ *        per-NUMA-node copies of read-only data.
+ *
+ * Thread pinning and NUMA node and physical core detection are only implemented on Linux.
+ * Elsewhere, all CPUs are reported to belong to a single NUMA node, each CPU is reported
+ * as a separate physical core, and pinning threads has no effect.
+ */
+
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <utility>
+#include <tuple>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include <tomographer/tools/cxxutil.h> // TOMOGRAPHER_EXPORT, tomographer_assert()
+#include <tomographer/tools/fmt.h> // streamstr
+
+#if defined(__linux__) && !defined(TOMOGRAPHER_NO_CPU_AFFINITY)
+#  include <sched.h>
+#  define TOMOGRAPHER_HAVE_CPU_AFFINITY
+#endif
+
+
+namespace Tomographer {
+namespace Tools {
+
+
+/** \brief Error in the specification of a thread affinity
+ *
+ * \since Added in %Tomographer 5.5
+ */
+TOMOGRAPHER_DEFINE_MSG_EXCEPTION(InvalidThreadAffinity, "Invalid thread affinity: ") ;
+
+
+/** \brief Parse a list of CPUs in the format used by Linux, e.g. \c "0-3,8,10-11"
+ *
+ * Returns the sorted list of CPU numbers.  Invalid entries are ignored.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+inline std::vector<int> parseCpuList(const std::string & s)
+{
+  std::set<int> cpus;
+  std::istringstream stream(s);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    const std::size_t dash = item.find('-');
+    char * endp = NULL;
+    const long a = std::strtol(item.c_str(), &endp, 10);
+    if (endp == item.c_str() || a < 0) {
+      continue;
+    }
+    long b = a;
+    if (dash != std::string::npos) {
+      const char * bstr = item.c_str() + dash + 1;
+      b = std::strtol(bstr, &endp, 10);
+      if (endp == bstr || b < a) {
+        continue;
+      }
+    }
+    for (long c = a; c <= b; ++c) {
+      cpus.insert((int)c);
+    }
+  }
+  return std::vector<int>(cpus.begin(), cpus.end());
+}
+
+/** \brief Format a list of CPUs compactly, e.g. \c "0-3,8,10-11"
+ *
+ * This is the inverse of \ref parseCpuList().
+ *
+ * \since Added in %Tomographer 5.5
+ */
+inline std::string formatCpuList(std::vector<int> cpus)
+{
+  std::sort(cpus.begin(), cpus.end());
+  std::ostringstream stream;
+  std::size_t k = 0;
+  while (k < cpus.size()) {
+    std::size_t j = k;
+    while (j+1 < cpus.size() && cpus[j+1] == cpus[j] + 1) {
+      ++j;
+    }
+    if (k > 0) {
+      stream << ",";
+    }
+    stream << cpus[k];
+    if (j > k) {
+      stream << "-" << cpus[j];
+    }
+    k = j + 1;
+  }
+  return stream.str();
+}
+
+
+/** \brief The logical CPUs on which this process may run, their NUMA nodes and physical
+ *         cores
+ *
+ * Use \ref detect() to query the topology of the machine.  Only the CPUs in the affinity
+ * mask of the calling thread are listed (e.g. if the process was started with \c taskset
+ * or within a cpuset), and only the NUMA nodes which have at least one of these CPUs.
+ *
+ * The NUMA nodes are referred to by their index in \ref nodes, from zero to \ref
+ * numNodes() - 1, rather than by their number in the operating system.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+struct TOMOGRAPHER_EXPORT CpuTopology
+{
+  //! The logical CPUs (as numbered by the operating system) available to us, sorted
+  std::vector<int> cpus;
+  //! The index in \ref nodes of the NUMA node of each CPU in \ref cpus
+  std::vector<int> cpu_node;
+  //! The numbers of the NUMA nodes, as numbered by the operating system
+  std::vector<int> nodes;
+  /** \brief The physical core of each CPU in \ref cpus
+   *
+   * CPUs which share a physical core (SMT siblings, or "hyperthreads") have the same
+   * value.  The physical cores are numbered from zero in the order of their first CPU.
+   */
+  std::vector<int> cpu_core;
+  //! The physical package (socket) of each CPU in \ref cpus, numbered from zero
+  std::vector<int> cpu_package;
+
+  //! The number of logical CPUs available to us
+  inline int numCpus() const { return (int)cpus.size(); }
+
+  //! The number of NUMA nodes which have CPUs available to us
+  inline int numNodes() const { return (int)nodes.size(); }
+
+  //! The number of physical cores which have CPUs available to us
+  inline int numPhysicalCores() const
+  {
+    return (int)std::set<int>(cpu_core.begin(), cpu_core.end()).size();
+  }
+
+  //! The CPUs of the NUMA node with index \a node
+  inline std::vector<int> nodeCpus(int node) const
+  {
+    std::vector<int> list;
+    for (std::size_t k = 0; k < cpus.size(); ++k) {
+      if (cpu_node[k] == node) {
+        list.push_back(cpus[k]);
+      }
+    }
+    return list;
+  }
+
+  /** \brief The index of the NUMA node of the given CPU
+   *
+   * Returns -1 if \a cpu is not one of the CPUs available to us.
+   */
+  inline int nodeOfCpu(int cpu) const
+  {
+    auto it = std::lower_bound(cpus.begin(), cpus.end(), cpu);
+    if (it == cpus.end() || *it != cpu) {
+      return -1;
+    }
+    return cpu_node[(std::size_t)(it - cpus.begin())];
+  }
+
+  //! A one-line human-readable description of the topology
+  inline std::string summary() const
+  {
+    std::ostringstream stream;
+    stream << numCpus() << " CPU" << (numCpus() != 1 ? "s" : "") << " on "
+           << numPhysicalCores() << " physical core" << (numPhysicalCores() != 1 ? "s" : "") << " in "
+           << numNodes() << " NUMA node" << (numNodes() != 1 ? "s" : "");
+    for (int n = 0; n < numNodes(); ++n) {
+      stream << (n == 0 ? ": " : "; ") << "node " << nodes[(std::size_t)n]
+             << ": CPUs " << formatCpuList(nodeCpus(n));
+    }
+    return stream.str();
+  }
+
+  /** \brief Detect the CPUs and NUMA nodes available to the calling thread
+   */
+  static inline CpuTopology detect()
+  {
+    CpuTopology t;
+
+#ifdef TOMOGRAPHER_HAVE_CPU_AFFINITY
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+      for (int c = 0; c < CPU_SETSIZE; ++c) {
+        if (CPU_ISSET(c, &set)) {
+          t.cpus.push_back(c);
+        }
+      }
+    }
+#endif
+    if (t.cpus.empty()) {
+      const int n = std::max(1, (int)std::thread::hardware_concurrency());
+      for (int c = 0; c < n; ++c) {
+        t.cpus.push_back(c);
+      }
+    }
+
+    // NUMA node number of each CPU (in the operating system's numbering)
+    std::vector<int> os_node(t.cpus.size(), 0);
+#ifdef TOMOGRAPHER_HAVE_CPU_AFFINITY
+    std::ifstream fonline("/sys/devices/system/node/online");
+    std::string online;
+    if (fonline && std::getline(fonline, online)) {
+      for (int node : parseCpuList(online)) {
+        std::ifstream fcpus(streamstr("/sys/devices/system/node/node" << node << "/cpulist"));
+        std::string cpulist;
+        if (!fcpus || !std::getline(fcpus, cpulist)) {
+          continue;
+        }
+        for (int c : parseCpuList(cpulist)) {
+          auto it = std::lower_bound(t.cpus.begin(), t.cpus.end(), c);
+          if (it != t.cpus.end() && *it == c) {
+            os_node[(std::size_t)(it - t.cpus.begin())] = node;
+          }
+        }
+      }
+    }
+#endif
+
+    std::set<int> nodeset(os_node.begin(), os_node.end());
+    t.nodes.assign(nodeset.begin(), nodeset.end());
+    t.cpu_node.resize(t.cpus.size());
+    for (std::size_t k = 0; k < t.cpus.size(); ++k) {
+      t.cpu_node[k] = (int)(std::lower_bound(t.nodes.begin(), t.nodes.end(), os_node[k]) - t.nodes.begin());
+    }
+
+    // physical package and core of each CPU (in the operating system's numbering; a
+    // core_id is only unique within its package)
+    std::vector<std::pair<int,int> > os_core(t.cpus.size());
+    for (std::size_t k = 0; k < t.cpus.size(); ++k) {
+      os_core[k] = std::make_pair(0, t.cpus[k] + 1000000); // by default, each CPU is a core
+#ifdef TOMOGRAPHER_HAVE_CPU_AFFINITY
+      const std::string dir = streamstr("/sys/devices/system/cpu/cpu" << t.cpus[k] << "/topology/");
+      std::ifstream fpackage(dir + "physical_package_id");
+      std::ifstream fcore(dir + "core_id");
+      int package = -1, core = -1;
+      if ((fpackage >> package) && (fcore >> core) && package >= 0 && core >= 0) {
+        os_core[k] = std::make_pair(package, core);
+      }
+#endif
+    }
+    std::map<int,int> package_index;
+    std::map<std::pair<int,int>,int> core_index;
+    t.cpu_package.resize(t.cpus.size());
+    t.cpu_core.resize(t.cpus.size());
+    for (std::size_t k = 0; k < t.cpus.size(); ++k) {
+      // number packages and cores in the order in which we first see them
+      package_index.insert(std::make_pair(os_core[k].first, (int)package_index.size()));
+      core_index.insert(std::make_pair(os_core[k], (int)core_index.size()));
+      t.cpu_package[k] = package_index[os_core[k].first];
+      t.cpu_core[k] = core_index[os_core[k]];
+    }
+
+    return t;
+  }
+};
+
+
+/** \brief Restrict the calling thread to run on the given CPUs
+ *
+ * Returns \c false if this failed, or if thread pinning is not supported on this
+ * platform.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+inline bool setCurrentThreadAffinity(const std::vector<int> & cpus)
+{
+#ifdef TOMOGRAPHER_HAVE_CPU_AFFINITY
+  if (cpus.empty()) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int c : cpus) {
+    if (c < 0 || c >= CPU_SETSIZE) {
+      return false;
+    }
+    CPU_SET(c, &set);
+  }
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+  (void)cpus;
+  return false;
+#endif
+}
+
+/** \brief The CPUs on which the calling thread is allowed to run
+ *
+ * Returns an empty list if this is not supported on this platform.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+inline std::vector<int> getCurrentThreadAffinity()
+{
+  std::vector<int> cpus;
+#ifdef TOMOGRAPHER_HAVE_CPU_AFFINITY
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int c = 0; c < CPU_SETSIZE; ++c) {
+      if (CPU_ISSET(c, &set)) {
+        cpus.push_back(c);
+      }
+    }
+  }
+#endif
+  return cpus;
+}
+
+/** \brief The CPU on which the calling thread is currently running
+ *
+ * Returns -1 if this is not supported on this platform.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+inline int currentCpu()
+{
+#ifdef TOMOGRAPHER_HAVE_CPU_AFFINITY
+  return sched_getcpu();
+#else
+  return -1;
+#endif
+}
+
+
+/** \brief How to place worker threads on the CPUs of the machine
+ *
+ * See \ref ThreadAffinity.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+enum ThreadAffinityPolicy {
+  //! Threads are not pinned, the operating system decides where they run
+  THREAD_AFFINITY_NONE = 0,
+  //! Threads are spread evenly over the NUMA nodes, and may run on any CPU of their node
+  THREAD_AFFINITY_NUMA_NODES,
+  //! Consecutive threads are pinned to neighboring CPUs (filling up each physical core first)
+  THREAD_AFFINITY_COMPACT,
+  //! Consecutive threads are pinned to CPUs as far apart as possible (other package,
+  //! other physical core)
+  THREAD_AFFINITY_SCATTER,
+  //! Each thread is pinned to a separate physical core, leaving the SMT siblings unused
+  THREAD_AFFINITY_PHYSICAL_CORES,
+  //! Threads are pinned to the CPUs of an explicit list, in order
+  THREAD_AFFINITY_EXPLICIT
+};
+
+
+/** \brief A policy to place worker threads on the CPUs of the machine
+ *
+ * Call \ref assignCpus() to determine the CPUs to which each thread should be pinned.  A
+ * policy can be specified as a string (see \ref fromString()), e.g. in program options.
+ *
+ * If there are more threads than CPUs (as listed in the order of the policy), the
+ * assignment wraps around and several threads share the same CPUs.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+struct TOMOGRAPHER_EXPORT ThreadAffinity
+{
+  //! The policy
+  ThreadAffinityPolicy policy;
+  //! The list of CPUs, for \ref THREAD_AFFINITY_EXPLICIT
+  std::vector<int> cpus;
+
+  //! Constructor
+  ThreadAffinity(ThreadAffinityPolicy policy_ = THREAD_AFFINITY_NONE, std::vector<int> cpus_ = std::vector<int>())
+    : policy(policy_), cpus(std::move(cpus_))
+  {
+    if (policy == THREAD_AFFINITY_EXPLICIT && cpus.empty()) {
+      throw InvalidThreadAffinity("No CPUs given");
+    }
+  }
+
+  /** \brief Parse a thread affinity policy from a string
+   *
+   * The string may be one of \c "none", \c "numa", \c "compact", \c "scatter" or \c
+   * "cores" (see \ref ThreadAffinityPolicy), or an explicit list of CPUs such as \c
+   * "0-7,16" (in which case the threads are pinned to the CPUs in increasing order).
+   *
+   * Throws \ref InvalidThreadAffinity if the string is invalid.
+   */
+  static inline ThreadAffinity fromString(const std::string & s)
+  {
+    if (s == "none" || s.empty()) {
+      return ThreadAffinity(THREAD_AFFINITY_NONE);
+    } else if (s == "numa") {
+      return ThreadAffinity(THREAD_AFFINITY_NUMA_NODES);
+    } else if (s == "compact") {
+      return ThreadAffinity(THREAD_AFFINITY_COMPACT);
+    } else if (s == "scatter") {
+      return ThreadAffinity(THREAD_AFFINITY_SCATTER);
+    } else if (s == "cores") {
+      return ThreadAffinity(THREAD_AFFINITY_PHYSICAL_CORES);
+    }
+    if (s.find_first_not_of("0123456789,-") != std::string::npos) {
+      throw InvalidThreadAffinity(streamstr("'" << s << "' is neither a known policy nor a list of CPUs"));
+    }
+    return ThreadAffinity(THREAD_AFFINITY_EXPLICIT, parseCpuList(s));
+  }
+
+  //! The string representation of this policy, as accepted by \ref fromString()
+  inline std::string toString() const
+  {
+    switch (policy) {
+    case THREAD_AFFINITY_NONE: return "none";
+    case THREAD_AFFINITY_NUMA_NODES: return "numa";
+    case THREAD_AFFINITY_COMPACT: return "compact";
+    case THREAD_AFFINITY_SCATTER: return "scatter";
+    case THREAD_AFFINITY_PHYSICAL_CORES: return "cores";
+    case THREAD_AFFINITY_EXPLICIT: return formatCpuList(cpus);
+    }
+    return "<invalid>";
+  }
+
+  /** \brief The natural number of threads for this policy
+   *
+   * This is the number of physical cores for \ref THREAD_AFFINITY_PHYSICAL_CORES, the
+   * number of given CPUs for \ref THREAD_AFFINITY_EXPLICIT, and the number of available
+   * CPUs otherwise.
+   */
+  inline int defaultNumThreads(const CpuTopology & topology) const
+  {
+    switch (policy) {
+    case THREAD_AFFINITY_PHYSICAL_CORES: return topology.numPhysicalCores();
+    case THREAD_AFFINITY_EXPLICIT: return (int)cpus.size();
+    default: return topology.numCpus();
+    }
+  }
+
+  /** \brief The CPUs to which each of \a num_threads threads should be pinned
+   *
+   * Returns an empty list if the threads should not be pinned, i.e. for \ref
+   * THREAD_AFFINITY_NONE, and for \ref THREAD_AFFINITY_NUMA_NODES if there is a single
+   * NUMA node.
+   */
+  inline std::vector<std::vector<int> > assignCpus(const CpuTopology & topology, int num_threads) const
+  {
+    std::vector<std::vector<int> > thread_cpus;
+    if (policy == THREAD_AFFINITY_NONE || num_threads <= 0) {
+      return thread_cpus;
+    }
+    if (policy == THREAD_AFFINITY_NUMA_NODES) {
+      if (topology.numNodes() > 1) {
+        for (int thread_id = 0; thread_id < num_threads; ++thread_id) {
+          // consecutive threads are placed on the same node
+          thread_cpus.push_back(topology.nodeCpus((int)((long)thread_id * topology.numNodes() / num_threads)));
+        }
+      }
+      return thread_cpus;
+    }
+
+    const std::vector<int> order = cpuOrder(topology);
+    tomographer_assert(order.size() > 0);
+    for (int thread_id = 0; thread_id < num_threads; ++thread_id) {
+      thread_cpus.push_back(std::vector<int>(1, order[(std::size_t)thread_id % order.size()]));
+    }
+    return thread_cpus;
+  }
+
+  /** \brief The CPUs in the order in which they are given to the threads
+   *
+   * Only for the policies which pin each thread to a single CPU.
+   */
+  inline std::vector<int> cpuOrder(const CpuTopology & topology) const
+  {
+    if (policy == THREAD_AFFINITY_EXPLICIT) {
+      return cpus;
+    }
+
+    const std::size_t n = topology.cpus.size();
+    // rank of each CPU among the CPUs of its core, and rank of its core within its package
+    std::vector<int> smt_rank(n), core_rank(n);
+    std::map<int,int> cpus_in_core;
+    std::map<int,int> cores_in_package;
+    std::map<int,int> core_rank_of_core;
+    for (std::size_t k = 0; k < n; ++k) {
+      const int core = topology.cpu_core[k];
+      smt_rank[k] = cpus_in_core[core]++;
+      if (core_rank_of_core.find(core) == core_rank_of_core.end()) {
+        core_rank_of_core[core] = cores_in_package[topology.cpu_package[k]]++;
+      }
+      core_rank[k] = core_rank_of_core[core];
+    }
+
+    typedef std::tuple<int,int,int,int> Key;
+    std::vector<std::pair<Key,int> > keyed;
+    for (std::size_t k = 0; k < n; ++k) {
+      Key key;
+      if (policy == THREAD_AFFINITY_COMPACT) {
+        key = Key(topology.cpu_package[k], core_rank[k], smt_rank[k], topology.cpus[k]);
+      } else {
+        // scatter, and physical cores: first CPU of each core, alternating between packages
+        if (policy == THREAD_AFFINITY_PHYSICAL_CORES && smt_rank[k] > 0) {
+          continue;
+        }
+        key = Key(smt_rank[k], core_rank[k], topology.cpu_package[k], topology.cpus[k]);
+      }
+      keyed.push_back(std::make_pair(key, topology.cpus[k]));
+    }
+    std::sort(keyed.begin(), keyed.end());
+
+    std::vector<int> order;
+    for (const auto & kc : keyed) {
+      order.push_back(kc.second);
+    }
+    return order;
+  }
+};
+
+
+/** \brief Format the assignment of threads to CPUs, e.g. for logging
+ *
+ * \a thread_cpus is the list of CPUs of each thread, as returned by \ref
+ * ThreadAffinity::assignCpus().
+ *
+ * \since Added in %Tomographer 5.5
+ */
+inline std::string formatThreadCpus(const std::vector<std::vector<int> > & thread_cpus)
+{
+  if (thread_cpus.empty()) {
+    return "threads are not pinned";
+  }
+  std::ostringstream stream;
+  for (std::size_t t = 0; t < thread_cpus.size(); ++t) {
+    stream << (t > 0 ? ", " : "") << "#" << t << "->" << formatCpuList(thread_cpus[t]);
+  }
+  return stream.str();
+}
+
+
+/** \brief Keep a copy of some read-only data on each NUMA node
+ *
+ * On machines with several NUMA nodes, reading data which lives in the memory of another
+ * node is slower than reading local data.  This class provides a copy of an object \a T
+ * for each NUMA node, which is created the first time \ref local() is called from a
+ * thread running on that node.  Memory is assigned to a NUMA node when it is first written
+ * to, so that the copy is made in the local memory of the node of the calling thread.
+ * (The thread should be pinned to the CPUs of its node, otherwise it may later be moved to
+ * another node.)
+ *
+ * If replication is disabled, or if there is a single NUMA node, \ref local() simply
+ * returns the original object.  The original object must outlive this object.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename T>
+class TOMOGRAPHER_EXPORT NumaReplicated
+{
+public:
+  /** \brief Constructor
+   *
+   * If \a enabled is \c false, no copies are ever made.
+   */
+  NumaReplicated(const T & original, bool enabled, CpuTopology topology = CpuTopology::detect())
+    : _original(original),
+      _topology(std::move(topology)),
+      _enabled(enabled && _topology.numNodes() > 1),
+      _replicas(_enabled ? (std::size_t)_topology.numNodes() : 0)
+  {
+  }
+
+  //! Whether copies are made for the different NUMA nodes
+  inline bool enabled() const { return _enabled; }
+
+  //! The number of copies which have been made so far
+  inline int numReplicas() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return (int)std::count_if(_replicas.begin(), _replicas.end(),
+                              [](const std::unique_ptr<T> & p) { return p != nullptr; });
+  }
+
+  /** \brief The copy of the object for the NUMA node of the calling thread
+   *
+   * The returned reference remains valid as long as this object exists.
+   */
+  inline const T & local() const
+  {
+    if (!_enabled) {
+      return _original;
+    }
+    const int node = _topology.nodeOfCpu(currentCpu());
+    if (node < 0) {
+      return _original;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::unique_ptr<T> & replica = _replicas[(std::size_t)node];
+    if (!replica) {
+      replica.reset(new T(_original));
+    }
+    return *replica;
+  }
+
+  //! The topology of the machine which was used to set up this object
+  inline const CpuTopology & topology() const { return _topology; }
+
+private:
+  const T & _original;
+  const CpuTopology _topology;
+  const bool _enabled;
+  mutable std::mutex _mutex;
+  mutable std::vector<std::unique_ptr<T> > _replicas;
+};
+
+
+} // namespace Tools
+} // namespace Tomographer
+
+
+#endif
@@ -552,6 +552,8 @@ inline constexpr bool multiplicationWillOverflow(IntType a, IntType b)
 namespace tomo_internal {
 template<typename Enabledtype = void> struct sfinae_no { typedef int no[1]; };
 template<typename EnabledType = void> struct sfinae_yes { typedef int yes[2]; };
+// sfinae_void<T>::type is void for any valid type T, for partial specializations
+template<typename T> struct sfinae_void { typedef void type; };
 } // namespace tomo_internal
 
 
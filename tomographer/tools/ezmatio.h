@@ -2052,6 +2052,229 @@ public:
 };
 
 
+/** \brief Read a large multidimensional array variable matrix by matrix
+ *
+ * Decoding a large array with \ref VarValueDecoder (e.g. as a \a std::vector of Eigen
+ * matrices) requires the full variable data to be loaded into memory by MatIO and then
+ * copied into the C++ object.  Instead, this class reads the array in chunks of
+ * consecutive matrices (using \a Mat_VarReadDataLinear()), and hands each matrix over to
+ * a callback as two real matrices holding its real and imaginary parts.  Only a single
+ * chunk is held in memory at any time.
+ *
+ * The variable is interpreted as for \ref VarValueDecoder<std::vector<Eigen::Matrix> >:
+ * the first two dimensions are the dimensions of each matrix, and all further dimensions
+ * are collapsed in column-major ordering into the index of the matrix.
+ *
+ * The data is converted in bulk from the type stored in the file to \a RealScalar.
+ *
+ * \note Compressed variables (the default for MATLAB's \c "-v7" format) can't be read
+ *       efficiently at arbitrary positions, because the data has to be decompressed from
+ *       the start of the variable.  They are loaded all at once by MatIO, and only the
+ *       conversion is done matrix by matrix.
+ *
+ * Example:
+ * \code
+ *   Tomographer::MAT::VarMatrixSliceReader<double> reader(matf, "Emn");
+ *   reader.forEachSlice([&](std::size_t k,
+ *                           const Tomographer::MAT::VarMatrixSliceReader<double>::RealMatrixMapType & re,
+ *                           const Tomographer::MAT::VarMatrixSliceReader<double>::RealMatrixMapType & im) {
+ *       // ... matrix number k is re + i*im ...
+ *     });
+ * \endcode
+ */
+template<typename RealScalar_>
+class TOMOGRAPHER_EXPORT VarMatrixSliceReader
+{
+public:
+  //! The real scalar type the data is converted to
+  typedef RealScalar_ RealScalar;
+  //! A real matrix type
+  typedef Eigen::Matrix<RealScalar, Eigen::Dynamic, Eigen::Dynamic> RealMatrixType;
+  //! The type of the real and imaginary parts of each matrix given to the callback
+  typedef Eigen::Map<const RealMatrixType> RealMatrixMapType;
+
+  //! The default maximum size of a chunk of data, in bytes
+  static constexpr std::size_t DefaultMaxChunkBytes = 16*1024*1024;
+
+  /** \brief Prepare to read the variable \a varname of the open file \a matf
+   *
+   * Only the type and shape information of the variable is read at this point.  The file
+   * \a matf must remain open as long as this object is used.  Each chunk of data read
+   * holds at most \a max_chunk_bytes bytes (but at least one matrix).
+   */
+  VarMatrixSliceReader(File & matf, const std::string & varname,
+                       std::size_t max_chunk_bytes = DefaultMaxChunkBytes)
+    : _matf(matf), _var(matf.var(varname, false))
+  {
+    const DimList vardims = _var.dims();
+    if (vardims.size() < 1) {
+      throw VarTypeError(varname, "Invalid (empty) variable dimensions");
+    }
+    _rows = vardims[0];
+    _cols = (vardims.size() >= 2 ? vardims[1] : 1);
+    _num_slices = (vardims.size() > 2
+                   ? (std::size_t)getNumEl(vardims.data()+2, vardims.data()+vardims.size())
+                   : 1);
+
+    const std::size_t slice_bytes = (std::size_t)_rows * (std::size_t)_cols * sizeof(double)
+      * (_var.isComplex() ? 2 : 1);
+    _chunk_slices = std::max<std::size_t>(1, max_chunk_bytes / std::max<std::size_t>(slice_bytes, 1));
+  }
+
+  //! The name of the variable
+  inline const std::string & varName() const { return _var.varName(); }
+  //! The number of rows of each matrix
+  inline int rows() const { return _rows; }
+  //! The number of columns of each matrix
+  inline int cols() const { return _cols; }
+  //! The number of matrices stored in the variable
+  inline std::size_t numSlices() const { return _num_slices; }
+  //! Whether the variable is complex
+  inline bool isComplex() const { return _var.isComplex(); }
+  //! The number of matrices read at once (for uncompressed variables)
+  inline std::size_t chunkSlices() const { return _chunk_slices; }
+
+  /** \brief Read all the matrices, in order, and hand them over to \a fn
+   *
+   * The callback \a fn is called for each matrix as <code>fn(std::size_t k, const
+   * RealMatrixMapType & re, const RealMatrixMapType & im)</code>, where \a k is the index
+   * of the matrix and \a re and \a im are its real and imaginary parts (\a im is zero if
+   * the variable is real).  The maps point into an internal buffer which is only valid
+   * during the call.
+   *
+   * Throws \ref VarReadError if the data can't be read, and \ref VarMatTypeError if the
+   * variable doesn't store numeric data.
+   */
+  template<typename Fn>
+  inline void forEachSlice(Fn && fn)
+  {
+    if (_var.getMatvarPtr()->compression != MAT_COMPRESSION_NONE) {
+      // the data has to be decompressed from the start of the variable anyway, so load it
+      // all at once
+      const Var fullvar = _matf.var(_var.varName(), true);
+      const matvar_t * matvar_ptr = fullvar.getMatvarPtr();
+      const void * re;
+      const void * im = NULL;
+      if (matvar_ptr->isComplex) {
+        const mat_complex_split_t * cdata = (const mat_complex_split_t*) matvar_ptr->data;
+        re = cdata->Re;
+        im = cdata->Im;
+      } else {
+        re = matvar_ptr->data;
+      }
+      std::vector<RealScalar> conv_re, conv_im;
+      MAT_SWITCH_REAL_TYPE(
+          matvar_ptr->data_type,
+          _process_chunk(fn, 0, _num_slices, (const Type*)re, (const Type*)im, conv_re, conv_im);
+          );
+      return;
+    }
+
+    switch (_var.getMatvarPtr()->class_type) {
+    case MAT_C_DOUBLE: _read_slices<double>(fn); break;
+    case MAT_C_SINGLE: _read_slices<float>(fn); break;
+    case MAT_C_INT64: _read_slices<int64_t>(fn); break;
+    case MAT_C_INT32: _read_slices<int32_t>(fn); break;
+    case MAT_C_INT16: _read_slices<int16_t>(fn); break;
+    case MAT_C_INT8: _read_slices<int8_t>(fn); break;
+    case MAT_C_UINT64: _read_slices<uint64_t>(fn); break;
+    case MAT_C_UINT32: _read_slices<uint32_t>(fn); break;
+    case MAT_C_UINT16: _read_slices<uint16_t>(fn); break;
+    case MAT_C_UINT8: _read_slices<uint8_t>(fn); break;
+    default:
+      throw VarMatTypeError(streamstr("Variable " << _var.varName() << " doesn't hold numeric data (class type "
+                                      << _var.getMatvarPtr()->class_type << ")"));
+    }
+  }
+
+private:
+  // MatIO returns the data as the C type corresponding to the variable's class type
+  template<typename MatClassType, typename Fn>
+  inline void _read_slices(Fn & fn)
+  {
+    const std::size_t slice_numel = (std::size_t)_rows * (std::size_t)_cols;
+    const bool is_complex = _var.isComplex();
+    matvar_t * matvar = const_cast<matvar_t*>(_var.getMatvarPtr());
+
+    std::vector<MatClassType> buf_re(_chunk_slices * slice_numel);
+    std::vector<MatClassType> buf_im(is_complex ? _chunk_slices * slice_numel : 0);
+    std::vector<RealScalar> conv_re, conv_im;
+
+    for (std::size_t start = 0; start < _num_slices; start += _chunk_slices) {
+      const std::size_t count = std::min(_chunk_slices, _num_slices - start);
+      const int numel = (int)(count * slice_numel);
+
+      int ret;
+      if (is_complex) {
+        mat_complex_split_t cdata;
+        cdata.Re = buf_re.data();
+        cdata.Im = buf_im.data();
+        ret = Mat_VarReadDataLinear(_matf.getMatPtr(), matvar, &cdata, (int)(start * slice_numel), 1, numel);
+      } else {
+        ret = Mat_VarReadDataLinear(_matf.getMatPtr(), matvar, buf_re.data(), (int)(start * slice_numel), 1, numel);
+      }
+      if (ret != 0) {
+        throw VarReadError(_var.varName());
+      }
+
+      _process_chunk(fn, start, count, buf_re.data(), (is_complex ? buf_im.data() : NULL), conv_re, conv_im);
+    }
+  }
+
+  // hand over the matrices [start, start+count) stored at re (and im, if not NULL)
+  template<typename MatClassType, typename Fn>
+  inline void _process_chunk(Fn & fn, std::size_t start, std::size_t count,
+                             const MatClassType * re, const MatClassType * im,
+                             std::vector<RealScalar> & conv_re, std::vector<RealScalar> & conv_im)
+  {
+    const std::size_t slice_numel = (std::size_t)_rows * (std::size_t)_cols;
+    const std::size_t numel = count * slice_numel;
+
+    const RealScalar * re_r = _as_real(re, conv_re, numel);
+    const RealScalar * im_r;
+    std::size_t im_stride = slice_numel;
+    if (im != NULL) {
+      im_r = _as_real(im, conv_im, numel);
+    } else {
+      // the imaginary part of a real variable
+      conv_im.assign(slice_numel, RealScalar(0));
+      im_r = conv_im.data();
+      im_stride = 0;
+    }
+    for (std::size_t j = 0; j < count; ++j) {
+      fn(start + j,
+         RealMatrixMapType(re_r + j * slice_numel, _rows, _cols),
+         RealMatrixMapType(im_r + j * im_stride, _rows, _cols));
+    }
+  }
+
+  // convert a chunk of data to RealScalar at once (no conversion needed if the data
+  // already has the right type)
+  template<typename MatClassType>
+  static inline const RealScalar * _as_real(const MatClassType * src, std::vector<RealScalar> & conv,
+                                            std::size_t numel)
+  {
+    conv.resize(numel);
+    Eigen::Map<Eigen::Array<RealScalar, Eigen::Dynamic, 1> >(conv.data(), (Eigen::Index)numel)
+      = Eigen::Map<const Eigen::Array<MatClassType, Eigen::Dynamic, 1> >(src, (Eigen::Index)numel)
+      .template cast<RealScalar>();
+    return conv.data();
+  }
+  static inline const RealScalar * _as_real(const RealScalar * src, std::vector<RealScalar> & , std::size_t )
+  {
+    return src;
+  }
+
+  File & _matf;
+  Var _var;
+  int _rows;
+  int _cols;
+  std::size_t _num_slices;
+  std::size_t _chunk_slices;
+};
+
+
+
 // get a (guaranteed) positive semidefinite matrix from the variable, along with its
 // matrix square root
 
@@ -29,6 +29,9 @@
 #define TOMOGRAPHER_VALUECALCULATOR_H
 
 #include <tuple>
+#include <type_traits>
+
+#include <Eigen/Core>
 
 #include <tomographer/tools/cxxutil.h>
 #include <tomographer/tools/needownoperatornew.h>
@@ -45,9 +48,138 @@
 namespace Tomographer {
 
 
+/** \brief The point cache type declared by a ValueCalculator or a random walk, or \c void
+ *
+ * A \ref pageInterfaceValueCalculator "ValueCalculator" may declare a type \a
+ * PointCacheType, in which case its \a getValue() also accepts an object of that type in
+ * place of the point itself.  A point cache stores quantities derived from a point (see
+ * \ref pageInterfaceMHWalker and e.g. \ref DenseDM::TSpace::DensePointCache), which the
+ * value calculator may then reuse instead of recalculating them.
+ *
+ * The member \a type is \a T::PointCacheType if this type is declared, and \c void
+ * otherwise.  This also applies to \ref MHRandomWalk types, for which \a type is the
+ * point cache type of the \a MHWalker (or \c void).
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename T, typename = void>
+struct TOMOGRAPHER_EXPORT PointCacheTypeOf
+{
+  typedef void type;
+};
+#ifndef TOMOGRAPHER_PARSED_BY_DOXYGEN
+template<typename T>
+struct TOMOGRAPHER_EXPORT PointCacheTypeOf<
+  T, typename Tools::tomo_internal::sfinae_void<typename T::PointCacheType>::type
+  >
+{
+  typedef typename T::PointCacheType type;
+};
+#endif
+
+/** \brief Whether a ValueCalculator can be evaluated on the current point cache of a
+ *         random walk
+ *
+ * This is \c true if both the \a ValueCalculator and the \a MHRandomWalk declare the
+ * same (non-void) \a PointCacheType.  See \ref getValueAtCurrentPoint().
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename ValueCalculator, typename MHRandomWalk>
+struct TOMOGRAPHER_EXPORT UsesPointCache
+  : public std::integral_constant<
+      bool,
+      !std::is_void<typename PointCacheTypeOf<ValueCalculator>::type>::value &&
+      std::is_same<typename PointCacheTypeOf<ValueCalculator>::type,
+                   typename PointCacheTypeOf<MHRandomWalk>::type>::value
+    >
+{
+};
+
+
+/** \brief Calculate the value of a ValueCalculator at the current point of a random walk
+ *
+ * If the value calculator can use the point cache of the random walk (see \ref
+ * UsesPointCache), then the value is calculated from \a rw.getCurrentPointCache().
+ * Otherwise, the value is calculated at the point \a curpt, which must be the current
+ * point of the random walk.
+ *
+ * This is meant to be used in \ref pageInterfaceMHRWStatsCollector "stats collectors".
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename ValueCalculator, typename PointType, typename MHRandomWalk,
+         TOMOGRAPHER_ENABLED_IF_TMPL(
+             !UsesPointCache<typename std::remove_const<ValueCalculator>::type, MHRandomWalk>::value)>
+inline auto getValueAtCurrentPoint(ValueCalculator & vcalc, const PointType & curpt,
+                                   const MHRandomWalk & /*rw*/)
+  -> decltype(vcalc.getValue(curpt))
+{
+  return vcalc.getValue(curpt);
+}
+#ifndef TOMOGRAPHER_PARSED_BY_DOXYGEN
+template<typename ValueCalculator, typename PointType, typename MHRandomWalk,
+         TOMOGRAPHER_ENABLED_IF_TMPL(
+             UsesPointCache<typename std::remove_const<ValueCalculator>::type, MHRandomWalk>::value)>
+inline auto getValueAtCurrentPoint(ValueCalculator & vcalc, const PointType & /*curpt*/,
+                                   const MHRandomWalk & rw)
+  -> decltype(vcalc.getValue(rw.getCurrentPointCache()))
+{
+  return vcalc.getValue(rw.getCurrentPointCache());
+}
+#endif
+
+/** \brief Calculate the values of a multi-value calculator at the current point of a
+ *         random walk
+ *
+ * As \ref getValueAtCurrentPoint(), but for a \a MultiValueCalculator (see \ref
+ * MultiValueCalculatorCache).
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename MultiValueCalculator, typename PointType, typename MHRandomWalk, typename ValueArrayType,
+         TOMOGRAPHER_ENABLED_IF_TMPL(
+             !UsesPointCache<typename std::remove_const<MultiValueCalculator>::type, MHRandomWalk>::value)>
+inline void getValuesAtCurrentPoint(MultiValueCalculator & mvcalc, const PointType & curpt,
+                                    const MHRandomWalk & /*rw*/, ValueArrayType & values)
+{
+  mvcalc.getValues(curpt, values);
+}
+#ifndef TOMOGRAPHER_PARSED_BY_DOXYGEN
+template<typename MultiValueCalculator, typename PointType, typename MHRandomWalk, typename ValueArrayType,
+         TOMOGRAPHER_ENABLED_IF_TMPL(
+             UsesPointCache<typename std::remove_const<MultiValueCalculator>::type, MHRandomWalk>::value)>
+inline void getValuesAtCurrentPoint(MultiValueCalculator & mvcalc, const PointType & /*curpt*/,
+                                    const MHRandomWalk & rw, ValueArrayType & values)
+{
+  mvcalc.getValues(rw.getCurrentPointCache(), values);
+}
+#endif
+
+
 
 namespace tomo_internal {
 
+// the common point cache type of a list of value calculators, or void if they don't
+// declare the same one
+template<typename... ValueCalculators>
+struct MplxVC_common_point_cache_type;
+template<typename ValueCalculator>
+struct MplxVC_common_point_cache_type<ValueCalculator>
+{
+  typedef typename PointCacheTypeOf<ValueCalculator>::type type;
+};
+template<typename ValueCalculator, typename... OtherValueCalculators>
+struct MplxVC_common_point_cache_type<ValueCalculator, OtherValueCalculators...>
+{
+  typedef typename std::conditional<
+    std::is_same<typename PointCacheTypeOf<ValueCalculator>::type,
+                 typename MplxVC_common_point_cache_type<OtherValueCalculators...>::type>::value,
+    typename PointCacheTypeOf<ValueCalculator>::type,
+    void
+    >::type type;
+};
+
 //
 // helper for the helper for getValue()
 //
@@ -295,6 +427,13 @@ public:
   //  typedef std::tuple<ValueCalculators&...> ValueCalculatorsRefTupleType;
   typedef std::tuple<ValueCalculators...> ValueCalculatorsTupleType;
 
+  /** \brief The point cache type accepted by all ValueCalculators, or \c void if they
+   *         don't all accept the same one (see \ref PointCacheTypeOf)
+   *
+   * \since Added in %Tomographer 5.5
+   */
+  typedef typename tomo_internal::MplxVC_common_point_cache_type<ValueCalculators...>::type PointCacheType;
+
 private:
 
   // pointer to the actual ValueCalculator instance in use, or NULL
@@ -460,6 +599,126 @@ public:
 
 
 
+/** \brief Cache the values computed by a multi-value calculator for the current point
+ *
+ * A \a MultiValueCalculator computes several values for a same point in one go, which
+ * allows it to share intermediate results (for instance, a density matrix and its
+ * eigendecomposition) between the different values.  It must provide:
+ *
+ * - a \a ValueType typedef;
+ * - a method <code>Eigen::Index numValues() const</code>, returning the number of values
+ *   which are calculated for each point;
+ * - a method <code>void getValues(const PointType & x, Eigen::Array<ValueType,Eigen::Dynamic,1> & values) const</code>,
+ *   which stores all the values for the point \a x in \a values (which has already been
+ *   resized to \a numValues() entries).
+ *
+ * This object remembers the values of the last point it was asked about, until \ref
+ * invalidate() is called.  Individual values can then be exposed as standard \ref
+ * pageInterfaceValueCalculator "ValueCalculator"s using \ref MultiValueComponentCalculator,
+ * such that existing tools (e.g. \ref ValueHistogramWithBinningMHRWStatsCollector) can be
+ * used for each value while the values are all computed together only once.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename MultiValueCalculator_>
+class TOMOGRAPHER_EXPORT MultiValueCalculatorCache
+{
+public:
+  //! The multi-value calculator type
+  typedef MultiValueCalculator_ MultiValueCalculator;
+  //! The type of each calculated value
+  typedef typename MultiValueCalculator::ValueType ValueType;
+  //! The type used to store all the values of a point
+  typedef Eigen::Array<ValueType,Eigen::Dynamic,1> ValueArrayType;
+
+private:
+  const MultiValueCalculator _mvcalc;
+  ValueArrayType _values;
+  bool _valid;
+
+public:
+  //! Constructor
+  MultiValueCalculatorCache(MultiValueCalculator mvcalc)
+    : _mvcalc(std::move(mvcalc)), _values(ValueArrayType::Zero(_mvcalc.numValues())), _valid(false)
+  {
+  }
+
+  //! The underlying multi-value calculator
+  inline const MultiValueCalculator & multiValueCalculator() const { return _mvcalc; }
+
+  //! Number of values calculated for each point
+  inline Eigen::Index numValues() const { return _values.size(); }
+
+  /** \brief Forget the cached values
+   *
+   * Call this whenever the point which will be passed to \ref value() may have changed.
+   */
+  inline void invalidate() { _valid = false; }
+
+  /** \brief Get the \a i-th value of the point \a x
+   *
+   * All values are calculated for \a x if they haven't been since the last call to \ref
+   * invalidate().  It is assumed that the point \a x is the same as the one the cached
+   * values were calculated for.
+   */
+  template<typename PointType>
+  inline ValueType value(Eigen::Index i, PointType && x)
+  {
+    if (!_valid) {
+      _mvcalc.getValues(std::forward<PointType>(x), _values);
+      _valid = true;
+    }
+    return _values(i);
+  }
+};
+
+
+/** \brief A ValueCalculator which returns one of the values of a \ref MultiValueCalculatorCache
+ *
+ * This is a lightweight \ref pageInterfaceValueCalculator "ValueCalculator" which refers
+ * to a \ref MultiValueCalculatorCache, which must outlive this object.
+ *
+ * \since Added in %Tomographer 5.5
+ */
+template<typename MultiValueCalculator_>
+class TOMOGRAPHER_EXPORT MultiValueComponentCalculator
+{
+public:
+  //! The corresponding cache type
+  typedef MultiValueCalculatorCache<MultiValueCalculator_> CacheType;
+  //! Value type returned by getValue() (see \ref pageInterfaceValueCalculator)
+  typedef typename CacheType::ValueType ValueType;
+  /** \brief The point cache type accepted by the multi-value calculator, if any (see \ref
+   *         PointCacheTypeOf)
+   */
+  typedef typename PointCacheTypeOf<MultiValueCalculator_>::type PointCacheType;
+
+private:
+  CacheType * _cache;
+  Eigen::Index _index;
+
+public:
+  //! Constructor: expose the value number \a index of the given \a cache
+  MultiValueComponentCalculator(CacheType * cache, Eigen::Index index)
+    : _cache(cache), _index(index)
+  {
+    tomographer_assert(_cache != NULL);
+    tomographer_assert(_index >= 0 && _index < _cache->numValues());
+  }
+
+  //! The index of the value we return, in the list of values of the cache
+  inline Eigen::Index index() const { return _index; }
+
+  //! Calculate the value (see \ref pageInterfaceValueCalculator)
+  template<typename PointType>
+  inline ValueType getValue(PointType && x) const
+  {
+    return _cache->value(_index, std::forward<PointType>(x));
+  }
+};
+
+
+
 } // namespace Tomographer
 
 
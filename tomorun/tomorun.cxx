@@ -61,6 +61,7 @@
 #include <tomographer/mhrw.h>
 #include <tomographer/mhrwstepsizecontroller.h>
 #include <tomographer/mhrwvalueerrorbinsconvergedcontroller.h>
+#include <tomographer/mhrwsweepsizecontroller.h>
 #include <tomographer/mhrwtasks.h>
 #include <tomographer/multiproc.h>
 #include <tomographer/densedm/tspacellhwalker.h>
@@ -99,6 +100,7 @@ inline int defaultNumRepeat() { return 1; }
 #  include <tomographer/multiprocthreads.h>
 #  define TomorunMultiProcTaskDispatcher Tomographer::MultiProc::CxxThreads::TaskDispatcher
 #  define TomorunMultiProcTaskDispatcherTitle "C++11 Threads"
+#  define TOMORUN_MULTIPROC_HAVE_THREAD_AFFINITY
 
 inline int defaultNumRepeat() { return (int)std::thread::hardware_concurrency(); }
 
@@ -114,6 +116,7 @@ inline int defaultNumRepeat() { return (int)std::thread::hardware_concurrency();
 #include "tomorun_helpers.h"
 #include "tomorun_opts.h"
 #include "tomorun_dispatch.h"
+#include "tomorun_server.h"
 
 
 // ------------------------------------------------------------------------------
@@ -133,11 +136,16 @@ int main(int argc, char **argv)
 #endif
 
   ProgOptions opt;
+  // with --batch, the options for each data set
+  std::vector<ProgOptions> batch_opts;
 
   auto logger = Tomographer::Logger::makeLocalLogger("main()", baselogger);
 
   try {
     parse_options(&opt, argc, argv, baselogger, filelogger);
+    if (opt.batch_file.size()) {
+      batch_opts = parse_batch_file(&opt, baselogger);
+    }
   } catch (const bad_options& e) {
     fprintf(stderr, "%s\n", e.what());
     return 127;
@@ -197,6 +205,23 @@ int main(int argc, char **argv)
   }
 
 
+  //
+  // ---------------------------------------------------------------------------
+  // With --serve, run the jobs submitted to us (each one is checked separately)
+  // ---------------------------------------------------------------------------
+  //
+
+  if (opt.serve_socket.size()) {
+    try {
+      tomorun_serve(&opt, baselogger, filelogger);
+    } catch (const std::exception& e) {
+      logger.error("Exception: %s", e.what());
+      throw;
+    }
+    return 0;
+  }
+
+
   opt.binning_analysis_num_levels =
     Tomographer::sanitizeBinningLevels(opt.binning_analysis_num_levels,
                                        opt.Nrun,
@@ -220,6 +245,22 @@ int main(int argc, char **argv)
       });
   }
 
+  //
+  // ---------------------------------------------------------------------------
+  // In batch mode, run all data sets with a single pool of workers
+  // ---------------------------------------------------------------------------
+  //
+
+  if (batch_opts.size()) {
+    try {
+      tomorun_batch_main(batch_opts, logger.parentLogger());
+    } catch (const std::exception& e) {
+      logger.error("Exception: %s", e.what());
+      throw;
+    }
+    return 0;
+  }
+
   //
   // ---------------------------------------------------------------------------
   // Display parameters, and run
@@ -264,48 +305,10 @@ int main(int argc, char **argv)
   // ---------------------------------------------------------------------------
   //
 
-  // Maybe use statically instantiated size for some predefined sizes.
-
   try {
-    // some special cases where we can avoid dynamic memory allocation for Eigen matrices
-    // by using compile-time sizes
-    
-#if defined(TOMORUN_CUSTOM_FIXED_DIM) && defined(TOMORUN_CUSTOM_FIXED_MAX_DIM) && defined(TOMORUN_CUSTOM_MAX_POVM_EFFECTS)
-    
-    //
-    // We want a single customized case, with a fixed dimension of
-    // TOMORUN_CUSTOM_FIXED_DIM (which may be "Eigen::Dynamic"), and a fixed maximum
-    // number of POVM effects TOMORUN_CUSTOM_MAX_POVM_EFFECTS (which may also be
-    // "Eigen::Dynamic").
-    //
-    // These macros can be defined in  "tomorun_config.h"
-    //
-    logger.debug("Using custom fixed dim = %d, custom fixed max dim = %d, "
-                 " and fixed max POVM effects = %d  (%d=dynamic)",
-		 TOMORUN_CUSTOM_FIXED_DIM, TOMORUN_CUSTOM_FIXED_MAX_DIM,
-                 TOMORUN_CUSTOM_MAX_POVM_EFFECTS, Eigen::Dynamic);
-    tomorun_dispatch_st<TOMORUN_CUSTOM_FIXED_DIM,TOMORUN_CUSTOM_FIXED_MAX_DIM,
-                        TOMORUN_CUSTOM_MAX_POVM_EFFECTS>(dim, &opt, matf, logger.parentLogger());
-
     (void)n_povms; // silence unused variable warning
 
-#else
-    
-    (void)n_povms; // silence unused variable warning
-
-    //
-    // Provide some standard fixed-size cases, in order to avoid dynamic memory allocation
-    // for small matrices for common system sizes (e.g. a single qubit)
-    //
-    if (dim == 2) {
-      tomorun_dispatch_st<2, 2, Eigen::Dynamic>(dim, &opt, matf, logger.parentLogger());
-    } else if (dim == 4) { // two-qubit systems are also common
-      tomorun_dispatch_st<4, 4, Eigen::Dynamic>(dim, &opt, matf, logger.parentLogger());
-    } else {
-      tomorun_dispatch_st<Eigen::Dynamic, Eigen::Dynamic, Eigen::Dynamic>(dim, &opt, matf, logger.parentLogger());
-    }
-
-#endif
+    tomorun_dispatch_dim(dim, &opt, matf, logger.parentLogger());
 
   } catch (const std::exception& e) {
     logger.error("Exception: %s", e.what());
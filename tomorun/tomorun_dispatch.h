@@ -29,19 +29,36 @@
 #define TOMORUN_DISPATCH
 
 #include <random>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <sstream>
+
+#include <boost/serialization/base_object.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/archive/binary_oarchive.hpp>
 
 #include <tomographer/tools/cxxutil.h>
 #include <tomographer/tools/loggers.h>
 #include <tomographer/tools/ezmatio.h>
 #include <tomographer/tools/signal_status_report.h>
 #include <tomographer/tools/eigenutil.h>
+#include <tomographer/tools/cputopology.h>
 #include <tomographer/densedm/dmtypes.h>
 #include <tomographer/densedm/param_herm_x.h>
 #include <tomographer/densedm/indepmeasllh.h>
+#include <tomographer/densedm/povmvalidation.h>
 #include <tomographer/densedm/tspacefigofmerit.h>
 #include <tomographer/mhrw.h>
 #include <tomographer/mhrwtasks.h>
+#include <tomographer/mhrwtempering.h>
 #include <tomographer/mhrw_valuehist_tools.h>
+#include <tomographer/mhrwsweepsizecontroller.h>
+#include <tomographer/mhrw_samplestream.h>
+#include <tomographer/mhrw_resultsfile.h>
+#include <tomographer/querrorbars.h>
+#include <tomographer/multiproccheckpoint.h>
+#include <tomographer/multiprocbatch.h>
 #include <tomographer/densedm/tspacellhwalker.h>
 #include <tomographer/mathtools/pos_semidef_util.h>
 
@@ -63,6 +80,7 @@ struct TomorunCData : public CDataBaseType_
   static constexpr bool BinningAnalysisEnabled = Base::UseBinningAnalysis;
 
   typedef DenseLLH_ DenseLLH;
+  typedef typename DenseLLH::DMTypes DMTypes;
 
   using typename Base::ValueCalculator;
   using typename Base::MHRWParamsType;
@@ -71,36 +89,82 @@ struct TomorunCData : public CDataBaseType_
 
   typedef TomorunRng RngType;
 
-  // the value result is always the first of a tuple
+  // the extra figures of merit (--extra-value-type) are all calculated together
+  typedef TomorunMultipleFiguresOfMeritCalculator<DMTypes> ExtraValueCalculator;
+  typedef Tomographer::ValueHistogramWithBinningMHRWStatsCollectorParams<
+    Tomographer::MultiValueComponentCalculator<ExtraValueCalculator>,
+    TomorunInt,
+    TomorunReal
+    > ExtraValueStatsCollectorParams;
+  typedef std::vector<typename ExtraValueStatsCollectorParams::Result> ExtraValueResultsType;
+  typedef Tomographer::AggregatedHistogramWithErrorBars<
+    typename ExtraValueStatsCollectorParams::HistogramType,
+    TomorunReal
+    > ExtraValueAggregatedHistogramType;
+
+  // the value result is always the first of a tuple, the extra values result is the last
   struct MHRWStatsResultsType : public MHRWStatsResultsBaseType
   {
     template<typename... Types>
     MHRWStatsResultsType(std::tuple<ValueStatsCollectorResultType, Types...> && r)
-      : MHRWStatsResultsBaseType(std::move(std::get<0>(r)))
+      : MHRWStatsResultsBaseType(std::move(std::get<0>(r))),
+        extra_values_results(std::move(std::get<sizeof...(Types)>(r)))
+    { }
+
+    // for Boost.Serialization (--checkpoint)
+    MHRWStatsResultsType()
+      : MHRWStatsResultsBaseType(), extra_values_results()
     { }
+
+    ExtraValueResultsType extra_values_results;
+
+  private:
+    friend boost::serialization::access;
+    template<typename Archive>
+    void serialize(Archive & a, unsigned int /* version */)
+    {
+      a & boost::serialization::base_object<MHRWStatsResultsBaseType>(*this);
+      a & extra_values_results;
+    }
   };
 
  
   template<typename SeedInitType,
            TOMOGRAPHER_ENABLED_IF_TMPL(!BinningAnalysisEnabled)>
-  TomorunCData(const DenseLLH & llh_, ValueCalculator valcalc,
+  TomorunCData(const DenseLLH & llh_, ValueCalculator valcalc, ExtraValueCalculator extra_valcalc_,
+               Tomographer::SampleStreamWriter * sample_writer_,
                const ProgOptions * opt, SeedInitType base_seed_or_task_seed_list)
     : Base(valcalc,
 	   typename Base::HistogramParams(opt->val_min, opt->val_max, opt->val_nbins),
 	   typename Base::MHRWParamsType(opt->step_size, opt->Nsweep, opt->Ntherm, opt->Nrun),
 	   std::move(base_seed_or_task_seed_list)),
       llh(llh_),
+      llh_replicas(llh, opt->numa),
+      extra_valcalc(std::move(extra_valcalc_)),
+      extra_histogram_params(opt->val_min, opt->val_max, opt->val_nbins),
+      extra_histogram_adaptive_range(opt->val_hist_auto_pilot_samples, opt->val_hist_auto_max_overflow),
+      extra_binning_num_levels(opt->binning_analysis_num_levels),
+      sample_writer(sample_writer_),
+      sample_thin(opt->write_samples_thin),
+      sample_task_counter(0),
       ctrl_moving_avg_samples(opt->control_step_size_moving_avg_samples),
+      ctrl_sweep_size_probes(opt->control_sweep_size ? Tomographer::MHRWSweepSizeControllerDefaults::ProbesPerSweep : 0),
       ctrl_max_allowed_unknown(opt->control_binning_converged_max_unknown),
       ctrl_max_allowed_unknown_notisolated(opt->control_binning_converged_max_unknown_notisolated),
       ctrl_max_allowed_not_converged(opt->control_binning_converged_max_not_converged),
-      ctrl_max_add_run_iters(opt->control_binning_converged_max_add_run_iters)
+      ctrl_max_add_run_iters(opt->control_binning_converged_max_add_run_iters),
+      tempering_betas(opt->tempering_replicas > 1
+                      ? Tomographer::geometricTemperingLadder((std::size_t)opt->tempering_replicas,
+                                                              opt->tempering_beta_min)
+                      : std::vector<double>())
   {
+    set_histogram_adaptive_range(opt);
   }
 
   template<typename SeedInitType,
            TOMOGRAPHER_ENABLED_IF_TMPL(BinningAnalysisEnabled)>
-  TomorunCData(const DenseLLH & llh_, ValueCalculator valcalc,
+  TomorunCData(const DenseLLH & llh_, ValueCalculator valcalc, ExtraValueCalculator extra_valcalc_,
+               Tomographer::SampleStreamWriter * sample_writer_,
                const ProgOptions * opt, SeedInitType base_seed_or_task_seed_list)
     : Base(valcalc,
 	   typename Base::HistogramParams(opt->val_min, opt->val_max, opt->val_nbins),
@@ -108,28 +172,116 @@ struct TomorunCData : public CDataBaseType_
 	   typename Base::MHRWParamsType(opt->step_size, opt->Nsweep, opt->Ntherm, opt->Nrun),
 	   std::move(base_seed_or_task_seed_list)),
       llh(llh_),
+      llh_replicas(llh, opt->numa),
+      extra_valcalc(std::move(extra_valcalc_)),
+      extra_histogram_params(opt->val_min, opt->val_max, opt->val_nbins),
+      extra_histogram_adaptive_range(opt->val_hist_auto_pilot_samples, opt->val_hist_auto_max_overflow),
+      extra_binning_num_levels(opt->binning_analysis_num_levels),
+      sample_writer(sample_writer_),
+      sample_thin(opt->write_samples_thin),
+      sample_task_counter(0),
       ctrl_moving_avg_samples(opt->control_step_size_moving_avg_samples),
+      ctrl_sweep_size_probes(opt->control_sweep_size ? Tomographer::MHRWSweepSizeControllerDefaults::ProbesPerSweep : 0),
       ctrl_max_allowed_unknown(opt->control_binning_converged_max_unknown),
       ctrl_max_allowed_unknown_notisolated(opt->control_binning_converged_max_unknown_notisolated),
       ctrl_max_allowed_not_converged(opt->control_binning_converged_max_not_converged),
-      ctrl_max_add_run_iters(opt->control_binning_converged_max_add_run_iters)
+      ctrl_max_add_run_iters(opt->control_binning_converged_max_add_run_iters),
+      tempering_betas(opt->tempering_replicas > 1
+                      ? Tomographer::geometricTemperingLadder((std::size_t)opt->tempering_replicas,
+                                                              opt->tempering_beta_min)
+                      : std::vector<double>())
   {
+    set_histogram_adaptive_range(opt);
+  }
+
+  inline void set_histogram_adaptive_range(const ProgOptions * opt)
+  {
+    if (opt->val_hist_auto) {
+      Base::histogram_adaptive_range =
+        Tomographer::HistogramAdaptiveRange<TomorunReal>(opt->val_hist_auto_pilot_samples,
+                                                         opt->val_hist_auto_max_overflow,
+                                                         opt->val_hist_auto_lower_bound,
+                                                         opt->val_hist_auto_upper_bound);
+    }
   }
 
   const DenseLLH llh;
+  // with --numa, the random walks use a copy of llh in the memory of their NUMA node
+  const Tomographer::Tools::NumaReplicated<DenseLLH> llh_replicas;
+
+  const ExtraValueCalculator extra_valcalc;
+  // the range of the extra histograms is always chosen during thermalization; these params
+  // are only used as fallback
+  const typename Base::HistogramParams extra_histogram_params;
+  const Tomographer::HistogramAdaptiveRange<TomorunReal> extra_histogram_adaptive_range;
+  const int extra_binning_num_levels;
+
+  // where to write the samples (--write-samples), or NULL
+  Tomographer::SampleStreamWriter * const sample_writer;
+  const int sample_thin;
+  // each random walk gets its own number in the sample stream, in the order in which they start
+  mutable std::atomic<int> sample_task_counter;
 
   const TomorunInt ctrl_moving_avg_samples;
+  // number of probes per sweep for --control-sweep-size, or zero
+  const int ctrl_sweep_size_probes;
   const Eigen::Index ctrl_max_allowed_unknown;
   const Eigen::Index ctrl_max_allowed_unknown_notisolated;
   const Eigen::Index ctrl_max_allowed_not_converged;
   const double ctrl_max_add_run_iters;
 
+  // inverse temperatures of the replicas for --tempering-replicas, or empty
+  const std::vector<double> tempering_betas;
+
+  template<typename LoggerType>
+  inline Tomographer::MultipleValueHistogramsWithBinningMHRWStatsCollector<ExtraValueCalculator, TomorunInt,
+                                                                           TomorunReal, LoggerType>
+  createExtraValueStatsCollector(LoggerType & logger) const
+  {
+    const std::size_t num_values = (std::size_t)extra_valcalc.numValues();
+    // without --extra-value-type, this is an empty stats collector which does nothing
+    return Tomographer::mkMultipleValueHistogramsWithBinningMHRWStatsCollector<TomorunInt, TomorunReal>(
+        std::vector<typename Base::HistogramParams>(num_values, extra_histogram_params),
+        num_values ? extra_valcalc : ExtraValueCalculator(),
+        extra_binning_num_levels,
+        logger,
+        std::vector<Tomographer::HistogramAdaptiveRange<TomorunReal> >(num_values, extra_histogram_adaptive_range)
+        );
+  }
+
+  template<typename LoggerType>
+  inline Tomographer::SampleStreamMHRWStatsCollector<
+    Tomographer::DenseDM::TSpace::RhoParamXCalculator<DMTypes, TomorunReal>, LoggerType>
+  createSampleStreamStatsCollector(LoggerType & logger) const
+  {
+    return Tomographer::mkSampleStreamMHRWStatsCollector(
+        sample_writer,
+        Tomographer::DenseDM::TSpace::RhoParamXCalculator<DMTypes, TomorunReal>(llh.dmt),
+        sample_task_counter++,
+        logger,
+        sample_thin
+        );
+  }
+
+  template<typename TaskResultType>
+  inline ExtraValueAggregatedHistogramType
+  aggregateExtraValueHistograms(std::size_t i, const std::vector<TaskResultType*> & task_result_list) const
+  {
+    return Tomographer::aggregateHistogramsOnCommonGrid<ExtraValueAggregatedHistogramType>(
+        task_result_list,
+        [i](const TaskResultType * task_result)
+        -> const typename ExtraValueAggregatedHistogramType::HistogramType &
+        {
+          return task_result->stats_results.extra_values_results[i].histogram;
+        });
+  }
+
   template<typename RngType, typename LoggerType,
            TOMOGRAPHER_ENABLED_IF_TMPL(!UseTSpaceLLHWalkerLight)>
   inline Tomographer::DenseDM::TSpace::LLHMHWalker<DenseLLH,RngType,LoggerType>
   createLLHWalker(RngType & rng, LoggerType & logger) const
   {
-    return { llh.dmt.initMatrixType(), llh, rng, logger };
+    return { llh.dmt.initMatrixType(), llh_replicas.local(), rng, logger };
   }
 
   template<typename RngType, typename LoggerType,
@@ -137,9 +289,42 @@ struct TomorunCData : public CDataBaseType_
   inline Tomographer::DenseDM::TSpace::LLHMHWalkerLight<DenseLLH,RngType,LoggerType>
   createLLHWalker(RngType & rng, LoggerType & logger) const
   {
-    return { llh.dmt.initMatrixType(), llh, rng, logger };
+    return { llh.dmt.initMatrixType(), llh_replicas.local(), rng, logger };
   }
 
+  // run a usual random walk, or a parallel tempering random walk with --tempering-replicas
+  template<typename RunFn, typename LLHWalkerType, typename StatsType, typename ControllerType>
+  inline void runMaybeTempered(RunFn & run, LLHWalkerType & llhwalker, StatsType & stats,
+                               ControllerType & ctrl) const
+  {
+    if (tempering_betas.size() > 1) {
+      run(llhwalker, stats, ctrl, tempering_betas);
+    } else {
+      run(llhwalker, stats, ctrl);
+    }
+  }
+
+  // sweep size controller (--control-sweep-size), with its buddy stats collector.  The
+  // controller refers to the stats collector, so both are held together and constructed
+  // in place; both must be included in the random walk.
+  template<typename LoggerType>
+  struct SweepSizeControl
+  {
+    typedef Tomographer::MHRWThermalizingAutocorrelationStatsCollector<ValueCalculator, TomorunInt>
+      StatsCollectorType;
+    typedef Tomographer::MHRWSweepSizeController<StatsCollectorType, LoggerType, TomorunInt>
+      ControllerType;
+
+    SweepSizeControl(const TomorunCData & cdata, LoggerType & logger)
+      : stats(cdata.valcalc, cdata.ctrl_sweep_size_probes),
+        ctrl(stats, logger)
+    {
+    }
+
+    StatsCollectorType stats;
+    ControllerType ctrl;
+  };
+
   template<typename RngType, typename LoggerType, typename RunFn,
            TOMOGRAPHER_ENABLED_IF_TMPL(!ControlStepSize && !ControlValueErrorBins)>
   inline void setupRandomWalkAndRun(RngType & rng, LoggerType & logger, RunFn run) const
@@ -147,9 +332,16 @@ struct TomorunCData : public CDataBaseType_
     auto llhwalker = createLLHWalker(rng, logger);
 
     auto value_stats = Base::createValueStatsCollector(logger);
-    auto stats = Tomographer::mkMultipleMHRWStatsCollectors(value_stats);
 
-    run(llhwalker, stats);
+    // sweep size controller (--control-sweep-size), with its buddy stats collector
+    SweepSizeControl<LoggerType> sweep_size(*this, logger);
+
+    auto sample_stats = createSampleStreamStatsCollector(logger);
+    auto extra_value_stats = createExtraValueStatsCollector(logger);
+    auto stats = Tomographer::mkMultipleMHRWStatsCollectors(value_stats, sweep_size.stats, sample_stats,
+                                                            extra_value_stats);
+
+    runMaybeTempered(run, llhwalker, stats, sweep_size.ctrl);
   }
 
   template<typename Rng, typename LoggerType, typename RunFn,
@@ -166,9 +358,19 @@ struct TomorunCData : public CDataBaseType_
     auto ctrl_step = 
       Tomographer::mkMHRWStepSizeController<MHRWParamsType>(movavg_accept_stats, logger);
 
-    auto stats = Tomographer::mkMultipleMHRWStatsCollectors(value_stats, movavg_accept_stats);
+    // sweep size controller (--control-sweep-size), with its buddy stats collector
+    SweepSizeControl<LoggerType> sweep_size(*this, logger);
+    // combined to a:
+    auto ctrl_combined =
+      Tomographer::mkMHRWMultipleControllers(ctrl_step, sweep_size.ctrl);
 
-    run(llhwalker, stats, ctrl_step);
+    auto sample_stats = createSampleStreamStatsCollector(logger);
+    auto extra_value_stats = createExtraValueStatsCollector(logger);
+    auto stats = Tomographer::mkMultipleMHRWStatsCollectors(value_stats, movavg_accept_stats,
+                                                            sweep_size.stats, sample_stats,
+                                                            extra_value_stats);
+
+    runMaybeTempered(run, llhwalker, stats, ctrl_combined);
   }
 
   template<typename Rng, typename LoggerType, typename RunFn,
@@ -189,9 +391,18 @@ struct TomorunCData : public CDataBaseType_
           ctrl_max_add_run_iters
           );
 
-    auto stats = Tomographer::mkMultipleMHRWStatsCollectors(value_stats);
+    // sweep size controller (--control-sweep-size), with its buddy stats collector
+    SweepSizeControl<LoggerType> sweep_size(*this, logger);
+    // combined to a:
+    auto ctrl_combined =
+      Tomographer::mkMHRWMultipleControllers(sweep_size.ctrl, ctrl_convergence);
+
+    auto sample_stats = createSampleStreamStatsCollector(logger);
+    auto extra_value_stats = createExtraValueStatsCollector(logger);
+    auto stats = Tomographer::mkMultipleMHRWStatsCollectors(value_stats, sweep_size.stats, sample_stats,
+                                                            extra_value_stats);
 
-    run(llhwalker, stats, ctrl_convergence);
+    runMaybeTempered(run, llhwalker, stats, ctrl_combined);
   }
 
   template<typename Rng, typename LoggerType, typename RunFn,
@@ -219,18 +430,43 @@ struct TomorunCData : public CDataBaseType_
           ctrl_max_allowed_not_converged,
           ctrl_max_add_run_iters
           );
+    // sweep size controller (--control-sweep-size), with its buddy stats collector
+    SweepSizeControl<LoggerType> sweep_size(*this, logger);
     // combined to a:
     auto ctrl_combined =
-      Tomographer::mkMHRWMultipleControllers(ctrl_step, ctrl_convergence);
+      Tomographer::mkMHRWMultipleControllers(ctrl_step, sweep_size.ctrl, ctrl_convergence);
 
-    auto stats = Tomographer::mkMultipleMHRWStatsCollectors(value_stats, movavg_accept_stats);
+    auto sample_stats = createSampleStreamStatsCollector(logger);
+    auto extra_value_stats = createExtraValueStatsCollector(logger);
+    auto stats = Tomographer::mkMultipleMHRWStatsCollectors(value_stats, movavg_accept_stats,
+                                                            sweep_size.stats, sample_stats,
+                                                            extra_value_stats);
 
-    run(llhwalker, stats, ctrl_combined);
+    runMaybeTempered(run, llhwalker, stats, ctrl_combined);
   }
 
 };
 
 
+template<typename DenseLLH, typename ValueCalculator, bool UseBinningAnalysisErrorBars,
+         bool ControlStepSize, bool ControlValueErrorBins, bool UseLLHWalkerLight>
+using TomorunCDataType = TomorunCData<
+  DenseLLH,
+  Tomographer::MHRWTasks::ValueHistogramTools::CDataBase<
+    ValueCalculator,
+    UseBinningAnalysisErrorBars,
+    Tomographer::MHWalkerParamsStepSize<TomorunReal>,
+    TomorunRng::result_type, // RngSeedType
+    TomorunInt, // IterCountIntType
+    TomorunReal, // CountRealType
+    TomorunInt // HistCountIntType
+    >,
+  ControlStepSize,
+  ControlValueErrorBins,
+  UseLLHWalkerLight
+  >;
+
+
 
 #if TOMORUN_USE_DEVICE_SEED != 0
 template<typename LocalLoggerType>
@@ -268,8 +504,255 @@ TomorunRng::result_type get_base_seed_or_task_seed_list(TomorunInt num_tasks, Lo
 }
 #endif
 
+// the seeds for the num_tasks random walks of a data set in a batch, whose first random
+// walk is the first_task-th random walk of the batch
+inline std::vector<TomorunRng::result_type>
+batch_item_seed_list(const std::vector<TomorunRng::result_type> & seeds, TomorunInt first_task, TomorunInt num_tasks)
+{
+  return std::vector<TomorunRng::result_type>(seeds.begin() + first_task, seeds.begin() + first_task + num_tasks);
+}
+inline TomorunRng::result_type
+batch_item_seed_list(TomorunRng::result_type base_seed, TomorunInt first_task, TomorunInt /*num_tasks*/)
+{
+  return base_seed + (TomorunRng::result_type)first_task;
+}
 
 
+// identifies the computation in a checkpoint file, so that we don't resume a run with
+// different options
+inline std::string tomorun_checkpoint_signature(const ProgOptions * opt)
+{
+  std::stringstream ss;
+  ss << "tomorun " << TOMOGRAPHER_VERSION
+     << "; data=" << opt->data_file_name
+     << "; amplify=" << opt->NMeasAmplifyFactor
+     << "; valtype=" << opt->valtype;
+  for (const auto & extra_valtype : opt->extra_valtypes) {
+    ss << "," << extra_valtype;
+  }
+  ss << "; hist=";
+  if (opt->val_hist_auto) {
+    ss << "auto[" << opt->val_hist_auto_lower_bound << "," << opt->val_hist_auto_upper_bound << "]";
+  } else {
+    ss << "[" << opt->val_min << "," << opt->val_max << "]";
+  }
+  ss << "/" << opt->val_nbins
+     << "; light_jumps=" << opt->light_jumps
+     << "; binning=" << opt->binning_analysis_error_bars << "/" << opt->binning_analysis_num_levels
+     << "; step=" << opt->step_size << "/" << opt->control_step_size
+     << "; sweep=" << opt->Nsweep << "/" << opt->control_sweep_size
+     << "; therm=" << opt->Ntherm << "; run=" << opt->Nrun
+     << "/" << opt->control_binning_converged
+     << "; tempering=" << opt->tempering_replicas << "/" << opt->tempering_beta_min;
+  return ss.str();
+}
+
+
+// --thread-affinity (--numa implies the 'numa' policy, unless another one is given)
+inline Tomographer::Tools::ThreadAffinity tomorun_thread_affinity(const ProgOptions * opt)
+{
+  Tomographer::Tools::ThreadAffinity affinity = Tomographer::Tools::ThreadAffinity::fromString(opt->thread_affinity);
+  if (opt->numa && affinity.policy == Tomographer::Tools::THREAD_AFFINITY_NONE) {
+    affinity = Tomographer::Tools::ThreadAffinity(Tomographer::Tools::THREAD_AFFINITY_NUMA_NODES);
+  }
+  return affinity;
+}
+
+// --num-threads, by default as many as suggested by the thread affinity policy; there is
+// no point in having more threads than random walks
+inline int tomorun_num_threads(const ProgOptions * opt, int num_runs)
+{
+  int num_threads = opt->num_threads;
+  if (num_threads <= 0) {
+    num_threads = tomorun_thread_affinity(opt).defaultNumThreads(Tomographer::Tools::CpuTopology::detect());
+  }
+  return std::max(1, std::min(num_threads, num_runs));
+}
+
+// --thread-affinity and --numa: place the worker threads on the CPUs of the machine, and
+// report the placement (with --numa, each TomorunCData replicates its LLH data on the NUMA
+// nodes by itself)
+template<typename TaskDispatcherType, typename LocalLoggerType>
+inline void tomorun_setup_threads(TaskDispatcherType & tasks, const ProgOptions * opt, int num_threads,
+                                  LocalLoggerType & logger)
+{
+  const Tomographer::Tools::ThreadAffinity affinity = tomorun_thread_affinity(opt);
+  if (affinity.policy == Tomographer::Tools::THREAD_AFFINITY_NONE) {
+    logger.debug("Using %d worker threads, not pinned to CPUs", num_threads);
+    return;
+  }
+#if defined(TOMORUN_MULTIPROC_HAVE_THREAD_AFFINITY)
+  const Tomographer::Tools::CpuTopology topology = Tomographer::Tools::CpuTopology::detect();
+  logger.info([&](std::ostream & str) {
+      str << "Detected " << topology.summary() << "\n"
+          << "Placement of " << num_threads << " worker threads (" << affinity.toString()
+          << (opt->numa ? ", with NUMA-local data" : "") << "): "
+          << Tomographer::Tools::formatThreadCpus(affinity.assignCpus(topology, num_threads));
+    });
+  tasks.setThreadAffinity(affinity);
+#else
+  (void)tasks;
+  (void)num_threads;
+  logger.warning("Worker threads can't be pinned to CPUs with the " TomorunMultiProcTaskDispatcherTitle
+                 " multiprocessing scheme (with OpenMP, set OMP_PROC_BIND and OMP_PLACES).");
+#endif
+}
+
+
+// where to write the individual samples of the random walks, if requested
+template<typename DenseLLH>
+inline std::unique_ptr<Tomographer::SampleStreamWriter>
+tomorun_open_sample_writer(const DenseLLH & llh, const ProgOptions * opt)
+{
+  std::unique_ptr<Tomographer::SampleStreamWriter> sample_writer;
+  if (opt->write_samples.size()) {
+    sample_writer.reset(new Tomographer::SampleStreamWriter(
+                            opt->write_samples,
+                            Tomographer::SampleStreamLayout((std::uint64_t)llh.dmt.dim2(), sizeof(double))
+                            ));
+  }
+  return sample_writer;
+}
+
+template<typename LocalLoggerType>
+inline void tomorun_close_sample_writer(const std::unique_ptr<Tomographer::SampleStreamWriter> & sample_writer,
+                                        const ProgOptions * opt, LocalLoggerType & logger)
+{
+  if (sample_writer) {
+    sample_writer->close();
+    logger.info([&](std::ostream & str) {
+        str << "Wrote " << sample_writer->numRecordsWritten() << " samples to file " << opt->write_samples << ".";
+      });
+  }
+}
+
+
+// fit the final histogram and print the quantum error bars (see --quantum-error-bars)
+template<typename HistogramType, typename LocalLoggerType>
+inline void tomorun_report_quantum_error_bars(const HistogramType & histogram, const ProgOptions * opt,
+                                              LocalLoggerType & logger)
+{
+  typedef typename HistogramType::Scalar RealScalar;
+  const Tomographer::FigureOfMeritToX<RealScalar> ftox(opt->quantum_error_bars_ftox_h,
+                                                       opt->quantum_error_bars_ftox_s);
+  try {
+    const auto fit = Tomographer::fitHistogramA2(histogram, ftox);
+    const auto q = Tomographer::quantumErrorBarsFromFitA2(fit, ftox);
+    logger.info([&](std::ostream & stream) {
+        Tomographer::Tools::ConsoleFormatterHelper h;
+        stream << "\n"
+               << h.centerLine("Quantum Error Bars")
+               << h.hrule()
+               << "  fit in x = " << (ftox.s > 0 ? "" : "-") << "(f - " << ftox.h << "), "
+               << fit.num_points << " points, reduced chi2 = " << Tomographer::Tools::fmts("%.4g", (double)fit.redchi2)
+               << "\n"
+               << "  fit parameters:  a2 = " << fit.a2() << ", a1 = " << fit.a1()
+               << ", m = " << fit.m() << ", c = " << fit.c() << "\n"
+               << "\n"
+               << "            f0 = " << Tomographer::Tools::fmts("%.4g", (double)q.f0) << "\n"
+               << "         Delta = " << Tomographer::Tools::fmts("%.4g", (double)q.Delta) << "\n"
+               << "         gamma = " << Tomographer::Tools::fmts("%.4g", (double)q.gamma) << "\n"
+               << h.hrule()
+               << "\n";
+      });
+    if (fit.redchi2 > 2) {
+      logger.warning("Reduced chi-squared statistic = %.4g. It could be that the fit model isn't good.",
+                     (double)fit.redchi2);
+    }
+  } catch (const Tomographer::HistogramFitError & e) {
+    logger.warning("Can't calculate the quantum error bars: %s", e.what());
+  }
+}
+
+
+// print the final report and write the histograms to CSV files, once all the random walks
+// have completed
+template<typename CDataType, typename TaskResultType, typename LocalLoggerType>
+inline void tomorun_report_results(CDataType & taskcdat, const std::vector<TaskResultType*> & task_results,
+                                   const ProgOptions * opt, LocalLoggerType & logger)
+{
+  // the results of the individual tasks, aggregated into a full averaged histogram
+  auto aggregated_histogram = taskcdat.aggregateResultHistograms(task_results) ;
+
+  logger.info([&](std::ostream & stream) {
+      Tomographer::MHRWTasks::ValueHistogramTools::printFinalReport(
+          stream, // where to output
+          taskcdat, // the cdata
+          task_results, // the results
+          aggregated_histogram // aggregated
+          );
+    });
+
+  if (opt->quantum_error_bars) {
+    tomorun_report_quantum_error_bars(aggregated_histogram.final_histogram, opt, logger);
+  }
+
+  // save the histogram to a CSV file if the user required it
+  if (opt->write_histogram.size()) {
+    std::string csvfname = opt->write_histogram + "-histogram.csv";
+    std::ofstream outf;
+    outf.open(csvfname);
+    aggregated_histogram.printHistogramCsv(outf);
+    logger.info([&](std::ostream & str) { str << "Wrote histogram to CSV file " << csvfname << "."; });
+  }
+
+  // append the histograms of the individual random walks and the final histogram to the
+  // results file if the user required it
+  if (opt->write_results.size()) {
+    Tomographer::ResultsFileWriter results_writer(opt->write_results);
+    Tomographer::writeValueHistogramResults(results_writer, opt->write_results_dataset_id, opt->data_file_name,
+                                            taskcdat, task_results, aggregated_histogram);
+    logger.info([&](std::ostream & str) {
+        str << "Wrote " << results_writer.numRecordsWritten() << " records to results file "
+            << opt->write_results << ".";
+      });
+  }
+
+  // the histograms of the extra figures of merit, if any
+  for (std::size_t i = 0; i < opt->extra_valtypes.size(); ++i) {
+    auto extra_aggregated_histogram = taskcdat.aggregateExtraValueHistograms(i, task_results);
+
+    logger.info([&](std::ostream & stream) {
+        Tomographer::Tools::ConsoleFormatterHelper h;
+        stream << "\n"
+               << h.centerLine(streamstr("Final Histogram -- " << opt->extra_valtypes[i]))
+               << h.hrule();
+        Tomographer::histogramPrettyPrint(stream, extra_aggregated_histogram.final_histogram, (int)h.columns());
+        stream << h.hrule()
+               << "\n";
+      });
+
+    if (opt->write_histogram.size()) {
+      std::string name = streamstr(opt->extra_valtypes[i]);
+      std::replace(name.begin(), name.end(), ':', '_');
+      std::string csvfname = opt->write_histogram + "-histogram-" + name + ".csv";
+      std::ofstream outf;
+      outf.open(csvfname);
+      extra_aggregated_histogram.printHistogramCsv(outf);
+      logger.info([&](std::ostream & str) { str << "Wrote histogram to CSV file " << csvfname << "."; });
+    }
+  }
+}
+
+
+//
+// Serialize the results of the individual random walks, for opt->serialized_task_results
+// (see --serve)
+//
+template<typename TaskResultType>
+inline std::string tomorun_serialize_task_results(const std::vector<TaskResultType*> & task_results)
+{
+  std::ostringstream stream;
+  {
+    boost::archive::binary_oarchive oa(stream);
+    const std::size_t num_results = task_results.size();
+    oa << num_results;
+    for (const TaskResultType * r : task_results) {
+      oa << *r;
+    }
+  }
+  return stream.str();
+}
 
 
 //
@@ -280,7 +763,9 @@ template<bool UseBinningAnalysisErrorBars,
          bool ControlStepSize, bool ControlValueErrorBins, bool UseLLHWalkerLight,
          typename DenseLLH, typename ValueCalculator, typename LoggerType>
 inline void tomorun(const DenseLLH & llh, const ProgOptions * opt,
-		    ValueCalculator valcalc, LoggerType & baselogger)
+		    ValueCalculator valcalc,
+                    TomorunMultipleFiguresOfMeritCalculator<typename DenseLLH::DMTypes> extra_valcalc,
+                    LoggerType & baselogger)
 {
   Tomographer::Logger::LocalLogger<LoggerType> logger(TOMO_ORIGIN, baselogger);
 
@@ -288,41 +773,84 @@ inline void tomorun(const DenseLLH & llh, const ProgOptions * opt,
   // create the Task Dispatcher and run.
   //
 
-  typedef TomorunCData<
-    DenseLLH,
-    Tomographer::MHRWTasks::ValueHistogramTools::CDataBase<
-      ValueCalculator,
-      UseBinningAnalysisErrorBars,
-      Tomographer::MHWalkerParamsStepSize<TomorunReal>,
-      TomorunRng::result_type, // RngSeedType
-      TomorunInt, // IterCountIntType
-      TomorunReal, // CountRealType
-      TomorunInt // HistCountIntType
-      >,
-    ControlStepSize,
-    ControlValueErrorBins,
-    UseLLHWalkerLight
-    > OurCData;
+  typedef TomorunCDataType<DenseLLH, ValueCalculator, UseBinningAnalysisErrorBars,
+                           ControlStepSize, ControlValueErrorBins, UseLLHWalkerLight> OurCData;
 
   typedef Tomographer::MHRWTasks::MHRandomWalkTask<OurCData, typename OurCData::RngType>  OurMHRandomWalkTask;
 
   // seed for random number generator, if no random device is available
   auto seedinit = get_base_seed_or_task_seed_list(opt->Nrepeats, logger);
 
-  OurCData taskcdat(llh, valcalc, opt, std::move(seedinit));
+  // where to write the individual samples, if requested
+  std::unique_ptr<Tomographer::SampleStreamWriter> sample_writer = tomorun_open_sample_writer(llh, opt);
+
+  OurCData taskcdat(llh, valcalc, std::move(extra_valcalc), sample_writer.get(), opt, std::move(seedinit));
+
+  const int num_threads = tomorun_num_threads(opt, (int)opt->Nrepeats);
 
   TomorunMultiProcTaskDispatcher<OurMHRandomWalkTask, OurCData, LoggerType> tasks(
       &taskcdat, // constant data
       logger.parentLogger(), // the main logger object
       (int)opt->Nrepeats // num_runs
+#if defined(TOMORUN_MULTIPROC_HAVE_THREAD_AFFINITY)
+      , num_threads
+#endif
       );
+  tomorun_setup_threads(tasks, opt, num_threads, logger);
+
+  // save the results of the completed tasks, and reload them if we're resuming an
+  // interrupted run
+  typedef Tomographer::MultiProc::TaskResultsCheckpoint<typename OurMHRandomWalkTask::ResultType>
+    CheckpointType;
+  std::unique_ptr<CheckpointType> checkpoint;
+  if (opt->checkpoint_file.size()) {
+    checkpoint.reset(new CheckpointType(opt->checkpoint_file, (int)opt->Nrepeats,
+                                        tomorun_checkpoint_signature(opt)));
+    if (opt->resume) {
+      if (checkpoint->load()) {
+        logger.info([&](std::ostream & str) {
+            str << "Resuming from checkpoint file " << opt->checkpoint_file << ": "
+                << checkpoint->numCompletedTasks() << " of " << opt->Nrepeats
+                << " random walks were already completed.";
+          });
+      } else {
+        logger.warning([&](std::ostream & str) {
+            str << "Checkpoint file " << opt->checkpoint_file << " does not exist, starting from scratch.";
+          });
+      }
+    }
+    checkpoint->attach(tasks);
+  }
 
   // set up signal handling
-  auto srep = Tomographer::Tools::makeSigHandlerTaskDispatcherStatusReporter(&tasks, logger.parentLogger());
+  typedef typename decltype(tasks)::FullStatusReportType FullStatusReportType;
+  // if we only request the periodic status reports to check the output, don't print them
+  const bool print_status_reports =
+    (opt->periodic_status_report_ms > 0 || opt->abort_on_output_error_check_ms <= 0);
+  auto srep = Tomographer::Tools::makeSigHandlerTaskDispatcherStatusReporter(
+      &tasks, logger.parentLogger(),
+      [opt, print_status_reports, &tasks](const FullStatusReportType & report) {
+        if (print_status_reports) {
+          std::fprintf(opt->fstatusreport, "\n%s\n", report.getHumanReport().c_str());
+          std::fflush(opt->fstatusreport);
+        }
+        if (opt->abort_on_output_error_check_ms > 0 &&
+            (std::ferror(opt->fstatusreport) || std::ferror(opt->flog))) {
+          tasks.requestInterrupt();
+        }
+      });
   Tomographer::Tools::installSignalHandler(SIGINT, &srep);
+  // srep is local to this function, don't leave a dangling handler behind us (e.g. when we
+  // are running as a server)
+  auto uninstall_srep = Tomographer::Tools::finally([] {
+      Tomographer::Tools::installSignalHandler(SIGINT, NULL);
+    });
 
   if (opt->periodic_status_report_ms > 0) {
+    // the output is then also checked with each status report
     tasks.requestPeriodicStatusReport(opt->periodic_status_report_ms);
+  } else if (opt->abort_on_output_error_check_ms > 0) {
+    tasks.requestPeriodicStatusReport(opt->abort_on_output_error_check_ms);
   }
 
   // and run our tomo process
@@ -335,31 +863,18 @@ inline void tomorun(const DenseLLH & llh, const ProgOptions * opt,
 
   logger.debug("Random walks done.");
 
+  tomorun_close_sample_writer(sample_writer, opt, logger);
+
   // delta-time, in seconds and fraction of seconds
   std::string elapsed_s = Tomographer::Tools::fmtDuration(time_end - time_start);
 
   // individual results from each task
   const auto & task_results = tasks.collectedTaskResults();
 
-  // ... aggregated into a full averaged histogram
-  auto aggregated_histogram = taskcdat.aggregateResultHistograms(task_results) ;
+  tomorun_report_results(taskcdat, task_results, opt, logger);
 
-  logger.info([&](std::ostream & stream) {
-      Tomographer::MHRWTasks::ValueHistogramTools::printFinalReport(
-          stream, // where to output
-          taskcdat, // the cdata
-          task_results, // the results
-          aggregated_histogram // aggregated
-          );
-    });
-
-  // save the histogram to a CSV file if the user required it
-  if (opt->write_histogram.size()) {
-    std::string csvfname = opt->write_histogram + "-histogram.csv";
-    std::ofstream outf;
-    outf.open(csvfname);
-    aggregated_histogram.printHistogramCsv(outf);
-    logger.info([&](std::ostream & str) { str << "Wrote histogram to CSV file " << csvfname << "."; });
+  if (opt->serialized_task_results != NULL) {
+    *opt->serialized_task_results = tomorun_serialize_task_results(task_results);
   }
 
   logger.info([&](std::ostream & stream) {
@@ -374,6 +889,111 @@ inline void tomorun(const DenseLLH & llh, const ProgOptions * opt,
 
 
 
+//
+// Read the POVM effects and the measurement counts from the data file
+//
+template<typename DenseLLH, typename LocalLoggerType>
+inline void tomorun_read_llh(DenseLLH & llh, const ProgOptions * opt, Tomographer::MAT::File * matf,
+                             LocalLoggerType & logger)
+{
+  typedef typename DenseLLH::DMTypes DMTypes;
+
+  const Eigen::Index dim = llh.dmt.dim();
+
+  Eigen::Matrix<TomorunInt,Eigen::Dynamic,1> Nm;
+  Nm = Tomographer::MAT::value<Eigen::Matrix<TomorunInt,Eigen::Dynamic,1> >(matf->var("Nm"));
+  ensure_valid_input((Nm.array() >= 0).all(), "frequency counts in `Nm' must be nonnegative");
+
+  // read the POVM effects matrix by matrix, and store them directly in X-parameterization
+  // (a large Emn is never held in memory as a whole)
+  typedef Tomographer::MAT::VarMatrixSliceReader<typename DMTypes::RealScalar> EmnReaderType;
+  EmnReaderType Emn_reader(*matf, "Emn");
+  ensure_valid_input((Eigen::Index)Emn_reader.numSlices() == Nm.size(),
+		     "number of POVM effects in `Emn' doesn't match length of `Nm'");
+  ensure_valid_input(Emn_reader.numSlices() == 0 || (Emn_reader.rows() == dim && Emn_reader.cols() == dim),
+		     streamstr("POVM effects don't have dimension " << dim << " x " << dim));
+
+  // the measurement settings of the POVM effects are optional; if given, we check that the
+  // effects of each setting sum up to the identity
+  Eigen::Matrix<TomorunInt,Eigen::Dynamic,1> Sm;
+  bool have_settings = false;
+  try {
+    Sm = Tomographer::MAT::value<Eigen::Matrix<TomorunInt,Eigen::Dynamic,1> >(matf->var("Sm"));
+    have_settings = true;
+  } catch (const Tomographer::MAT::VarReadError & ) {
+  }
+  ensure_valid_input(!have_settings || Sm.size() == Nm.size(),
+                     "number of measurement settings in `Sm' doesn't match length of `Nm'");
+  Tomographer::DenseDM::POVMCompletenessChecker<DMTypes> completeness(llh.dmt);
+
+  // POVM effects which were never observed are not stored (see IndepMeasLLH::addMeasEffect())
+  const Eigen::Index num_effects = (Nm.array() > 0).count();
+  typename DenseLLH::VectorParamListType Exn(num_effects, llh.dmt.dim2());
+  typename DenseLLH::FreqListType Nx(num_effects);
+
+  const Tomographer::DenseDM::ParamX<DMTypes> px(llh.dmt);
+  Eigen::Index i = 0;
+  Emn_reader.forEachSlice([&](std::size_t k, const typename EmnReaderType::RealMatrixMapType & Emn_re,
+                              const typename EmnReaderType::RealMatrixMapType & Emn_im) {
+      if (have_settings) {
+        completeness.addEffect((long)Sm((Eigen::Index)k), Emn_re, Emn_im);
+      }
+      if (Nm((Eigen::Index)k) == 0) {
+        return;
+      }
+      // splitHermToX() only reads the lower triangular part, so check that the effect is
+      // hermitian before converting it: || E - E^\dagger ||^2 = || Re - Re^T ||^2 + || Im + Im^T ||^2
+      if (TOMORUN_DO_SLOW_POVM_CONSISTENCY_CHECKS &&
+          ! (std::sqrt(double((Emn_re - Emn_re.transpose()).squaredNorm()
+                              + (Emn_im + Emn_im.transpose()).squaredNorm())) < 1e-8)) {
+        typename DMTypes::MatrixType E_m(llh.dmt.initMatrixType());
+        E_m.real() = Emn_re.template cast<typename DMTypes::RealScalar>();
+        E_m.imag() = Emn_im.template cast<typename DMTypes::RealScalar>();
+        throw Tomographer::DenseDM::InvalidMeasData(streamstr("POVM effect is not hermitian : E_m =\n"
+                                                              << std::setprecision(10) << E_m));
+      }
+      px.splitHermToX(Exn.row(i), Emn_re, Emn_im);
+      Nx(i) = Nm((Eigen::Index)k);
+      ++i;
+    });
+  tomographer_assert(i == num_effects);
+
+  llh.setMeas(std::move(Exn), std::move(Nx), false);
+
+  if (TOMORUN_DO_SLOW_POVM_CONSISTENCY_CHECKS) {
+    // check the effects using all cores, this is significant for large data sets
+    Tomographer::DenseDM::checkAllMeasParallel(llh);
+  }
+  if (have_settings) {
+    completeness.check();
+    logger.debug("POVM effects of %d measurement settings sum up to the identity",
+                 (int)completeness.numSettings());
+  }
+
+  logger.debug([&](std::ostream & ss) {
+      ss << "\n\nExn: size="<<llh.Exn().size()<<"\n"
+	 << llh.Exn() << "\n";
+      ss << "\n\nNx: size="<<llh.Nx().size()<<"\n"
+	 << llh.Nx() << "\n";
+    });
+
+  llh.setNMeasAmplifyFactor(opt->NMeasAmplifyFactor);
+}
+
+// The calculator for the extra figures of merit (--extra-value-type)
+template<typename DMTypes>
+inline TomorunMultipleFiguresOfMeritCalculator<DMTypes>
+makeTomorunExtraValueCalculator(DMTypes dmt, const ProgOptions * opt, Tomographer::MAT::File * matf)
+{
+  TomorunMultipleFiguresOfMeritCalculator<DMTypes> extra_value_calculator;
+  for (const auto & extra_valtype : opt->extra_valtypes) {
+    addTomorunMultipleFiguresOfMerit<DMTypes>(extra_value_calculator, extra_valtype.valtype, dmt,
+                                              extra_valtype.ref_obj_name, matf);
+  }
+  return extra_value_calculator;
+}
+
+
 //
 // And here is the dispatcher. It will call the correct variant of tomorun() (with the
 // correct template parameters), depending on what we were asked to do.
@@ -406,29 +1026,7 @@ inline void tomorun_dispatch(const Eigen::Index dim, ProgOptions * opt, Tomograp
   DMTypes dmt(dim);
   OurDenseLLH llh(dmt);
 
-  typename Tomographer::Tools::EigenStdVector<typename DMTypes::MatrixType>::type Emn;
-  Emn = Tomographer::MAT::value<decltype(Emn)>(matf->var("Emn"));
-  Eigen::Matrix<TomorunInt,Eigen::Dynamic,1> Nm;
-  Nm = Tomographer::MAT::value<Eigen::Matrix<TomorunInt,Eigen::Dynamic,1> >(matf->var("Nm"));
-  ensure_valid_input((Eigen::Index)Emn.size() == Nm.size(),
-		     "number of POVM effects in `Emn' doesn't match length of `Nm'");
-  if (Emn.size() > 0) {
-    ensure_valid_input(Emn[0].cols() == dim && Emn[0].rows() == dim,
-		       streamstr("POVM effects don't have dimension " << dim << " x " << dim));
-  }
-
-  for (std::size_t k = 0; k < Emn.size(); ++k) {
-    llh.addMeasEffect(Emn[k], Nm((Eigen::Index)k), TOMORUN_DO_SLOW_POVM_CONSISTENCY_CHECKS);
-  }
-
-  logger.debug([&](std::ostream & ss) {
-      ss << "\n\nExn: size="<<llh.Exn().size()<<"\n"
-	 << llh.Exn() << "\n";
-      ss << "\n\nNx: size="<<llh.Nx().size()<<"\n"
-	 << llh.Nx() << "\n";
-    });
-
-  llh.setNMeasAmplifyFactor(opt->NMeasAmplifyFactor);
+  tomorun_read_llh(llh, opt, matf, logger);
 
   //
   // Data has now been successfully read. Now, dispatch to the correct template function
@@ -440,10 +1038,13 @@ inline void tomorun_dispatch(const Eigen::Index dim, ProgOptions * opt, Tomograp
   auto multiplexor_value_calculator =
     makeTomorunMultiplexorValueCalculatorType<DMTypes>(opt->valtype.valtype, dmt, opt->valtype.ref_obj_name, matf);
 
+  auto extra_value_calculator = makeTomorunExtraValueCalculator(dmt, opt, matf);
+
   tomorun<UseBinningAnalysisErrorBars, ControlStepSize, ControlValueErrorBins, UseLLHWalkerLight>(
       llh,
       opt,
       multiplexor_value_calculator,
+      std::move(extra_value_calculator),
       logger.parentLogger());
         
 }
@@ -461,9 +1062,11 @@ inline void tomorun_dispatch(const Eigen::Index dim, ProgOptions * opt, Tomograp
     
 
 
-template<int FixedDim, int FixedMaxDim, int FixedMaxPOVMEffects, typename LoggerType>
-inline void tomorun_dispatch_st(const int dim, ProgOptions * opt, Tomographer::MAT::File * matf,
-                                LoggerType & logger)
+// Call job.run<FixedDim, FixedMaxDim, FixedMaxPOVMEffects, UseBinningAnalysisErrorBars,
+// ControlStepSize, ControlValueErrorBins, UseLLHWalkerLight>(logger), with the template
+// parameters corresponding to the options in opt
+template<int FixedDim, int FixedMaxDim, int FixedMaxPOVMEffects, typename JobType, typename LoggerType>
+inline void tomorun_dispatch_flags(const ProgOptions * opt, JobType & job, LoggerType & logger)
 {
   DISPATCH_STATIC_BOOL(
       opt->light_jumps, UseLLHWalkerLight,
@@ -475,18 +1078,16 @@ inline void tomorun_dispatch_st(const int dim, ProgOptions * opt, Tomographer::M
               DISPATCH_STATIC_BOOL(
                   opt->control_binning_converged, ControlValueErrorBins,
                   {
-                    tomorun_dispatch<FixedDim, FixedMaxDim, FixedMaxPOVMEffects,
+                    job.template run<FixedDim, FixedMaxDim, FixedMaxPOVMEffects,
                                      UseBinningAnalysisErrorBars, ControlStepSize, ControlValueErrorBins,
-                                     UseLLHWalkerLight, 
-                                     LoggerType>(dim, opt, matf, logger);
+                                     UseLLHWalkerLight>(logger);
                   }
                   ) ;
             } else {
               static constexpr bool UseBinningAnalysisErrorBars = false;
               // no binning analysis, we cannot control binning converged
-              tomorun_dispatch<FixedDim, FixedMaxDim, FixedMaxPOVMEffects,
-                               UseBinningAnalysisErrorBars, ControlStepSize, false, UseLLHWalkerLight,
-                               LoggerType>(dim, opt, matf, logger);
+              job.template run<FixedDim, FixedMaxDim, FixedMaxPOVMEffects,
+                               UseBinningAnalysisErrorBars, ControlStepSize, false, UseLLHWalkerLight>(logger);
             }
           }
           ) ;
@@ -494,6 +1095,307 @@ inline void tomorun_dispatch_st(const int dim, ProgOptions * opt, Tomographer::M
 }
 
 
+struct TomorunDispatchJob
+{
+  const int dim;
+  ProgOptions * opt;
+  Tomographer::MAT::File * matf;
+
+  template<int FixedDim, int FixedMaxDim, int FixedMaxPOVMEffects,
+           bool UseBinningAnalysisErrorBars,
+           bool ControlStepSize, bool ControlValueErrorBins, bool UseLLHWalkerLight,
+           typename LoggerType>
+  inline void run(LoggerType & logger)
+  {
+    tomorun_dispatch<FixedDim, FixedMaxDim, FixedMaxPOVMEffects,
+                     UseBinningAnalysisErrorBars, ControlStepSize, ControlValueErrorBins, UseLLHWalkerLight,
+                     LoggerType>(dim, opt, matf, logger);
+  }
+};
+
+template<int FixedDim, int FixedMaxDim, int FixedMaxPOVMEffects, typename LoggerType>
+inline void tomorun_dispatch_st(const int dim, ProgOptions * opt, Tomographer::MAT::File * matf,
+                                LoggerType & logger)
+{
+  TomorunDispatchJob job{dim, opt, matf};
+  tomorun_dispatch_flags<FixedDim, FixedMaxDim, FixedMaxPOVMEffects>(opt, job, logger);
+}
+
+
+//
+// Run tomorun for the data in matf, of dimension dim.  Maybe use statically instantiated
+// sizes for some predefined dimensions.
+//
+template<typename LoggerType>
+inline void tomorun_dispatch_dim(const int dim, ProgOptions * opt, Tomographer::MAT::File * matf,
+                                 LoggerType & baselogger)
+{
+  Tomographer::Logger::LocalLogger<LoggerType> logger(TOMO_ORIGIN, baselogger);
+
+  // some special cases where we can avoid dynamic memory allocation for Eigen matrices
+  // by using compile-time sizes
+
+#if defined(TOMORUN_CUSTOM_FIXED_DIM) && defined(TOMORUN_CUSTOM_FIXED_MAX_DIM) && defined(TOMORUN_CUSTOM_MAX_POVM_EFFECTS)
+
+  //
+  // We want a single customized case, with a fixed dimension of
+  // TOMORUN_CUSTOM_FIXED_DIM (which may be "Eigen::Dynamic"), and a fixed maximum
+  // number of POVM effects TOMORUN_CUSTOM_MAX_POVM_EFFECTS (which may also be
+  // "Eigen::Dynamic").
+  //
+  // These macros can be defined in  "tomorun_config.h"
+  //
+  logger.debug("Using custom fixed dim = %d, custom fixed max dim = %d, "
+               " and fixed max POVM effects = %d  (%d=dynamic)",
+               TOMORUN_CUSTOM_FIXED_DIM, TOMORUN_CUSTOM_FIXED_MAX_DIM,
+               TOMORUN_CUSTOM_MAX_POVM_EFFECTS, Eigen::Dynamic);
+  tomorun_dispatch_st<TOMORUN_CUSTOM_FIXED_DIM,TOMORUN_CUSTOM_FIXED_MAX_DIM,
+                      TOMORUN_CUSTOM_MAX_POVM_EFFECTS>(dim, opt, matf, logger.parentLogger());
+
+#else
+
+  //
+  // Provide some standard fixed-size cases, in order to avoid dynamic memory allocation
+  // for small matrices for common system sizes (e.g. a single qubit)
+  //
+  if (dim == 2) {
+    tomorun_dispatch_st<2, 2, Eigen::Dynamic>(dim, opt, matf, logger.parentLogger());
+  } else if (dim == 4) { // two-qubit systems are also common
+    tomorun_dispatch_st<4, 4, Eigen::Dynamic>(dim, opt, matf, logger.parentLogger());
+  } else {
+    tomorun_dispatch_st<Eigen::Dynamic, Eigen::Dynamic, Eigen::Dynamic>(dim, opt, matf, logger.parentLogger());
+  }
+
+#endif
+}
+
+
+
+// -----------------------------------------------------------------------------
+// Batch mode (--batch)
+// -----------------------------------------------------------------------------
+
+
+//
+// Run the random walks of all the data sets of a batch with a single task dispatcher.
+// The results of each data set are reported as soon as all its random walks have
+// completed.
+//
+template<int FixedDim, int FixedMaxDim, int FixedMaxPOVMEffects,
+         bool UseBinningAnalysisErrorBars,
+         bool ControlStepSize, bool ControlValueErrorBins, bool UseLLHWalkerLight,
+         typename LoggerType>
+inline void tomorun_batch(const std::vector<int> & dims, const std::vector<ProgOptions> & batch_opts,
+                          const std::vector<Tomographer::MAT::File*> & matfs, LoggerType & baselogger)
+{
+  Tomographer::Logger::LocalLogger<LoggerType> logger(TOMO_ORIGIN, baselogger);
+
+  logger.debug("preparing batch of %d data sets. FixedDim=%d, FixedMaxDim=%d, FixedMaxPOVMEffects=%d",
+               (int)batch_opts.size(), FixedDim, FixedMaxDim, FixedMaxPOVMEffects);
+
+  typedef Tomographer::DenseDM::DMTypes<FixedDim, TomorunReal, FixedMaxDim> DMTypes;
+  typedef Tomographer::DenseDM::IndepMeasLLH<DMTypes, TomorunReal, TomorunInt, FixedMaxPOVMEffects, true>
+    OurDenseLLH;
+
+  typedef TomorunCDataType<OurDenseLLH, TomorunMultiplexorValueCalculatorType<DMTypes>,
+                           UseBinningAnalysisErrorBars, ControlStepSize, ControlValueErrorBins,
+                           UseLLHWalkerLight> OurCData;
+
+  typedef Tomographer::MHRWTasks::MHRandomWalkTask<OurCData, typename OurCData::RngType>  OurMHRandomWalkTask;
+  typedef typename OurMHRandomWalkTask::ResultType TaskResultType;
+
+  typedef Tomographer::MultiProc::BatchTaskCData<OurCData> OurBatchCData;
+  typedef Tomographer::MultiProc::BatchTask<OurMHRandomWalkTask, OurCData> OurBatchTask;
+
+  const std::size_t num_items = batch_opts.size();
+
+  // the seeds of all random walks of the batch are distinct
+  TomorunInt num_total_runs = 0;
+  for (const auto & item_opt : batch_opts) {
+    num_total_runs += item_opt.Nrepeats;
+  }
+  auto seedinit = get_base_seed_or_task_seed_list(num_total_runs, logger);
+
+  //
+  // Read the data of each data set, and set up its constant data
+  //
+
+  std::vector<std::unique_ptr<Tomographer::SampleStreamWriter> > sample_writers;
+  std::vector<std::unique_ptr<OurCData> > taskcdats;
+  OurBatchCData batch;
+
+  for (std::size_t i = 0; i < num_items; ++i) {
+    const ProgOptions * opt = & batch_opts[i];
+
+    DMTypes dmt(dims[i]);
+    OurDenseLLH llh(dmt);
+
+    try {
+      tomorun_read_llh(llh, opt, matfs[i], logger);
+    } catch (const std::exception & ) {
+      logger.error("While reading data file %s:", opt->data_file_name.c_str());
+      throw;
+    }
+
+    sample_writers.push_back(tomorun_open_sample_writer(llh, opt));
+
+    taskcdats.emplace_back(new OurCData(
+        llh,
+        makeTomorunMultiplexorValueCalculatorType<DMTypes>(opt->valtype.valtype, dmt, opt->valtype.ref_obj_name,
+                                                           matfs[i]),
+        makeTomorunExtraValueCalculator(dmt, opt, matfs[i]),
+        sample_writers.back().get(),
+        opt,
+        batch_item_seed_list(seedinit, batch.numTaskRuns(), opt->Nrepeats)
+        ));
+
+    batch.addItem(taskcdats.back().get(), (int)opt->Nrepeats);
+  }
+
+  //
+  // create the Task Dispatcher for all the random walks of the batch
+  //
+
+  // (the same for all data sets, these options can only be given on the command line)
+  const int num_threads = tomorun_num_threads(&batch_opts[0], batch.numTaskRuns());
+
+  TomorunMultiProcTaskDispatcher<OurBatchTask, OurBatchCData, LoggerType> tasks(
+      &batch, // constant data
+      logger.parentLogger(), // the main logger object
+      batch.numTaskRuns() // num_runs
+#if defined(TOMORUN_MULTIPROC_HAVE_THREAD_AFFINITY)
+      , num_threads
+#endif
+      );
+  tomorun_setup_threads(tasks, &batch_opts[0], num_threads, logger);
+
+  // report the results of each data set as soon as all its random walks have completed
+  std::size_t num_items_done = 0;
+  Tomographer::MultiProc::BatchItemResults<TaskResultType, OurCData> item_results(
+      &batch,
+      [&](std::size_t i, const std::vector<const TaskResultType*> & task_results) {
+        ++num_items_done;
+        logger.info([&](std::ostream & str) {
+            str << "Random walks for data file " << batch_opts[i].data_file_name << " done ("
+                << num_items_done << "/" << num_items << " data sets).";
+          });
+        tomorun_close_sample_writer(sample_writers[i], &batch_opts[i], logger);
+        tomorun_report_results(*taskcdats[i], task_results, &batch_opts[i], logger);
+      });
+  item_results.attach(tasks);
+
+  // set up signal handling
+  auto srep = Tomographer::Tools::makeSigHandlerTaskDispatcherStatusReporter(&tasks, logger.parentLogger());
+  Tomographer::Tools::installSignalHandler(SIGINT, &srep);
+
+  // (the same for all data sets, it can only be given on the command line)
+  if (batch_opts[0].periodic_status_report_ms > 0) {
+    tasks.requestPeriodicStatusReport(batch_opts[0].periodic_status_report_ms);
+  }
+
+  // and run all the random walks
+
+  auto time_start = TimerClock::now();
+
+  tasks.run();
+
+  auto time_end = TimerClock::now();
+
+  logger.debug("Random walks done.");
+
+  logger.info([&](std::ostream & stream) {
+      stream << "Computation time for " << num_items << " data sets: "
+             << Tomographer::Tools::fmtDuration(time_end - time_start) << "\n\n";
+    });
+}
+
+
+struct TomorunBatchJob
+{
+  const std::vector<int> & dims;
+  const std::vector<ProgOptions> & batch_opts;
+  const std::vector<Tomographer::MAT::File*> & matfs;
+
+  template<int FixedDim, int FixedMaxDim, int FixedMaxPOVMEffects,
+           bool UseBinningAnalysisErrorBars,
+           bool ControlStepSize, bool ControlValueErrorBins, bool UseLLHWalkerLight,
+           typename LoggerType>
+  inline void run(LoggerType & logger)
+  {
+    tomorun_batch<FixedDim, FixedMaxDim, FixedMaxPOVMEffects,
+                  UseBinningAnalysisErrorBars, ControlStepSize, ControlValueErrorBins, UseLLHWalkerLight,
+                  LoggerType>(dims, batch_opts, matfs, logger);
+  }
+};
+
+
+//
+// Run all data sets listed in the file given to --batch.  batch_opts are the options of
+// each data set, as returned by parse_batch_file().
+//
+template<typename LoggerType>
+inline void tomorun_batch_main(std::vector<ProgOptions> & batch_opts, LoggerType & baselogger)
+{
+  Tomographer::Logger::LocalLogger<LoggerType> logger(TOMO_ORIGIN, baselogger);
+
+  std::vector<int> dims;
+  std::vector<Tomographer::MAT::File*> matfs;
+
+  auto delete_matfs = Tomographer::Tools::finally([&matfs,&logger] {
+      logger.debug("Freeing input file resources");
+      for (auto matf : matfs) {
+        delete matf;
+      }
+    });
+
+  for (auto & opt : batch_opts) {
+
+    opt.binning_analysis_num_levels =
+      Tomographer::sanitizeBinningLevels(opt.binning_analysis_num_levels,
+                                         opt.Nrun,
+                                         last_binning_level_warn_min_samples,
+                                         logger) ;
+
+    display_parameters(&opt, logger.parentLogger());
+
+    try {
+      matfs.push_back(new Tomographer::MAT::File(opt.data_file_name));
+      dims.push_back(Tomographer::MAT::value<int>(matfs.back()->var("dim")));
+    } catch (const std::exception& e) {
+      logger.error([&opt, &e](std::ostream & str){
+          str << "Failed to read data from file "<< opt.data_file_name << "\n\t" << e.what() << "\n";
+        });
+      ::exit(1);
+    }
+
+    logger.debug([&](std::ostream & stream) {
+        stream << "Data file " << opt.data_file_name << " opened, found dim = " << dims.back();
+      }) ;
+  }
+
+  // the template parameters which don't depend on the data are the same for all data sets
+  // (see parse_options())
+  const ProgOptions * flags_opt = & batch_opts[0];
+
+  TomorunBatchJob job{dims, batch_opts, matfs};
+
+#if defined(TOMORUN_CUSTOM_FIXED_DIM) && defined(TOMORUN_CUSTOM_FIXED_MAX_DIM) && defined(TOMORUN_CUSTOM_MAX_POVM_EFFECTS)
+  tomorun_dispatch_flags<TOMORUN_CUSTOM_FIXED_DIM,TOMORUN_CUSTOM_FIXED_MAX_DIM,
+                         TOMORUN_CUSTOM_MAX_POVM_EFFECTS>(flags_opt, job, logger.parentLogger());
+#else
+  // a single task dispatcher runs all data sets, so we can only use fixed-size matrices if
+  // all data sets have the same dimension
+  if (std::all_of(dims.begin(), dims.end(), [](int d) { return d == 2; })) {
+    tomorun_dispatch_flags<2, 2, Eigen::Dynamic>(flags_opt, job, logger.parentLogger());
+  } else if (std::all_of(dims.begin(), dims.end(), [](int d) { return d == 4; })) {
+    tomorun_dispatch_flags<4, 4, Eigen::Dynamic>(flags_opt, job, logger.parentLogger());
+  } else {
+    tomorun_dispatch_flags<Eigen::Dynamic, Eigen::Dynamic, Eigen::Dynamic>(flags_opt, job, logger.parentLogger());
+  }
+#endif
+}
+
+
 
 
 
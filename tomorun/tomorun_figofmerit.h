@@ -118,6 +118,13 @@ inline typename DMTypes::MatrixType  read_ref_state_rho(Tomographer::MAT::File *
 // =============================================================================
 
 
+// Calculates several built-in figures of merit at once, sharing the common work between
+// them; used for --extra-value-type.
+template<typename DMTypes>
+using TomorunMultipleFiguresOfMeritCalculator =
+  Tomographer::DenseDM::TSpace::MultipleFiguresOfMeritCalculator<DMTypes,TomorunReal>;
+
+
 
 // -----------------------------------------------------------------------------
 // Figure of merit: (root) fidelity, cf. Nielsen & Chuang
@@ -140,6 +147,16 @@ struct FidelityFigureOfMerit
     return new ValueCalculator<DMTypes>(read_ref_state_T<DMTypes>(matf, ref_obj_name)) ; 
   }
 
+  // Register this figure of merit with a calculator which evaluates several of them at once
+  // (optional -- needed to use this figure of merit with --extra-value-type)
+  template<typename DMTypes>
+  static inline void
+  addToMultipleCalculator(TomorunMultipleFiguresOfMeritCalculator<DMTypes> & mcalc, DMTypes /*dmt*/,
+                          const std::string & ref_obj_name, Tomographer::MAT::File * matf)
+  {
+    mcalc.addFidelityToRef(read_ref_state_T<DMTypes>(matf, ref_obj_name));
+  }
+
   // Print some help text to the screen when queried with --help. We can insert footnotes
   // using footnotes.addFootNote(...)
   static void print(std::ostream & stream, Tomographer::Tools::FmtFootnotes & footnotes) {
@@ -185,6 +202,16 @@ struct PurifiedDistanceFigureOfMerit
     return new ValueCalculator<DMTypes>(read_ref_state_T<DMTypes>(matf, ref_obj_name)) ; 
   }
 
+  // Register this figure of merit with a calculator which evaluates several of them at once
+  // (optional -- needed to use this figure of merit with --extra-value-type)
+  template<typename DMTypes>
+  static inline void
+  addToMultipleCalculator(TomorunMultipleFiguresOfMeritCalculator<DMTypes> & mcalc, DMTypes /*dmt*/,
+                          const std::string & ref_obj_name, Tomographer::MAT::File * matf)
+  {
+    mcalc.addPurifDistToRef(read_ref_state_T<DMTypes>(matf, ref_obj_name));
+  }
+
   // Print some help text to the screen when queried with --help. We can insert footnotes
   // using footnotes.addFootNote(...)
   static void print(std::ostream & stream, Tomographer::Tools::FmtFootnotes & footnotes) {
@@ -223,6 +250,16 @@ struct TraceDistanceFigureOfMerit
     return new ValueCalculator<DMTypes>(read_ref_state_rho<DMTypes>(matf, ref_obj_name)) ; 
   }
 
+  // Register this figure of merit with a calculator which evaluates several of them at once
+  // (optional -- needed to use this figure of merit with --extra-value-type)
+  template<typename DMTypes>
+  static inline void
+  addToMultipleCalculator(TomorunMultipleFiguresOfMeritCalculator<DMTypes> & mcalc, DMTypes /*dmt*/,
+                          const std::string & ref_obj_name, Tomographer::MAT::File * matf)
+  {
+    mcalc.addTrDistToRef(read_ref_state_rho<DMTypes>(matf, ref_obj_name));
+  }
+
   // Print some help text to the screen when queried with --help. We can insert footnotes
   // using footnotes.addFootNote(...)
   static void print(std::ostream & stream, Tomographer::Tools::FmtFootnotes & footnotes) {
@@ -269,6 +306,22 @@ struct ObsValueFigureOfMerit
     return new ValueCalculator<DMTypes>(dmt, std::move(A)) ; 
   }
 
+  // Register this figure of merit with a calculator which evaluates several of them at once
+  // (optional -- needed to use this figure of merit with --extra-value-type)
+  template<typename DMTypes>
+  static inline void
+  addToMultipleCalculator(TomorunMultipleFiguresOfMeritCalculator<DMTypes> & mcalc, DMTypes /*dmt*/,
+                          std::string ref_obj_name, Tomographer::MAT::File * matf)
+  {
+    using MatrixType = typename DMTypes::MatrixType;
+
+    if (!ref_obj_name.size()) {
+      ref_obj_name = "Observable";
+    }
+
+    mcalc.addObservable(matf->var(ref_obj_name).value<MatrixType>());
+  }
+
   // Print some help text to the screen when queried with --help. We can insert footnotes
   // using footnotes.addFootNote(...)
   static void print(std::ostream & stream, Tomographer::Tools::FmtFootnotes & /*footnotes*/) {
@@ -311,6 +364,9 @@ struct ObsValueFigureOfMerit
 //     return new ValueCalculator<DMTypes>(dmt, ...) ; 
 //   }
 //
+//   // Optionally, see the figures of merit above for how to define addToMultipleCalculator()
+//   // so that this figure of merit may also be used with --extra-value-type.
+//
 //   // Print some help text to the screen when queried with --help. We can insert footnotes
 //   // using footnotes.addFootNote(...)
 //   static void print(std::ostream & stream, Tomographer::Tools::FmtFootnotes & footnotes) {
@@ -150,6 +150,67 @@ makeTomorunMultiplexorValueCalculatorType(int i, DMTypes dmt, const std::string
 };
 
 
+// Add a figure of merit (given by its index in FiguresOfMeritTuple) to a
+// TomorunMultipleFiguresOfMeritCalculator, for --extra-value-type.  Figures of merit which
+// don't define addToMultipleCalculator() can't be used in this way.
+template<typename FigureOfMerit, typename DMTypes, typename dummy = void>
+struct TrMultipleFigOfMeritAddOne
+{
+  static inline void add(TomorunMultipleFiguresOfMeritCalculator<DMTypes> & , DMTypes ,
+                         const std::string & , Tomographer::MAT::File * )
+  {
+    throw std::invalid_argument(std::string("Figure of merit '") + FigureOfMerit().name
+                                + std::string("' can't be used as an extra value type"));
+  }
+};
+template<typename FigureOfMerit, typename DMTypes>
+struct TrMultipleFigOfMeritAddOne<
+  FigureOfMerit, DMTypes,
+  decltype((void)FigureOfMerit::template addToMultipleCalculator<DMTypes>(
+               std::declval<TomorunMultipleFiguresOfMeritCalculator<DMTypes>&>(), std::declval<DMTypes>(),
+               std::declval<const std::string&>(), std::declval<Tomographer::MAT::File*>()))
+  >
+{
+  static inline void add(TomorunMultipleFiguresOfMeritCalculator<DMTypes> & mcalc, DMTypes dmt,
+                         const std::string & ref_obj_name, Tomographer::MAT::File * matf)
+  {
+    FigureOfMerit::template addToMultipleCalculator<DMTypes>(mcalc, dmt, ref_obj_name, matf);
+  }
+};
+
+template<typename DMTypes, typename FiguresOfMeritTuple>
+struct TrMultipleFigOfMeritAdd
+{
+  template<int I=0, typename std::enable_if<(I<std::tuple_size<FiguresOfMeritTuple>::value),bool>::type = true>
+  static inline void add(int i, TomorunMultipleFiguresOfMeritCalculator<DMTypes> & mcalc, DMTypes dmt,
+                         const std::string & ref_obj_name, Tomographer::MAT::File * matf)
+  {
+    if (I == i) {
+      TrMultipleFigOfMeritAddOne<typename std::tuple_element<I, FiguresOfMeritTuple>::type, DMTypes>::add(
+          mcalc, dmt, ref_obj_name, matf
+          );
+      return;
+    }
+    add<I+1>(i, mcalc, dmt, ref_obj_name, matf);
+  }
+  template<int I=0, typename std::enable_if<(I==std::tuple_size<FiguresOfMeritTuple>::value),bool>::type = true>
+  static inline void add(int , TomorunMultipleFiguresOfMeritCalculator<DMTypes> & , DMTypes ,
+                         const std::string & , Tomographer::MAT::File * )
+  {
+    tomographer_assert(false && "Invalid figure of merit index");
+  }
+};
+
+template<typename DMTypes>
+inline void addTomorunMultipleFiguresOfMerit(TomorunMultipleFiguresOfMeritCalculator<DMTypes> & mcalc,
+                                             int i, DMTypes dmt, const std::string & ref_obj_name,
+                                             Tomographer::MAT::File * matf)
+{
+  TrMultipleFigOfMeritAdd<DMTypes, TomorunFiguresOfMerit>::add(i, mcalc, dmt, ref_obj_name, matf);
+}
+
+
+
 // Store a figure of merit
 struct figure_of_merit_spec
 {
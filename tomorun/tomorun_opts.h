@@ -31,11 +31,16 @@
 
 #include <stdexcept>
 #include <typeinfo>
+#include <string>
+#include <vector>
+#include <set>
+#include <fstream>
 
 #include <boost/version.hpp>
 
 #include <tomographer/tomographer_version.h>
 #include <tomographer/tools/ezmatio.h>
+#include <tomographer/tools/cputopology.h>
 
 
 
@@ -197,11 +202,18 @@ struct ProgOptions
   TomorunInt Nrun{32768};
 
   figure_of_merit_spec valtype{"fidelity"};
+  std::vector<figure_of_merit_spec> extra_valtypes;
 
   TomorunReal val_min{TomorunReal(0.9)};
   TomorunReal val_max{TomorunReal(1.0)};
   Eigen::Index val_nbins{50};
 
+  bool val_hist_auto{false};
+  TomorunReal val_hist_auto_lower_bound{-std::numeric_limits<TomorunReal>::infinity()};
+  TomorunReal val_hist_auto_upper_bound{std::numeric_limits<TomorunReal>::infinity()};
+  Eigen::Index val_hist_auto_pilot_samples{256};
+  Eigen::Index val_hist_auto_max_overflow{4096};
+
   bool light_jumps{false};
 
   bool binning_analysis_error_bars{true};
@@ -210,6 +222,8 @@ struct ProgOptions
   bool control_step_size{true};
   TomorunInt control_step_size_moving_avg_samples{2048};
 
+  bool control_sweep_size{false};
+
   bool control_binning_converged{true};
   Eigen::Index control_binning_converged_max_not_converged{0};
   Eigen::Index control_binning_converged_max_unknown{2};
@@ -219,6 +233,9 @@ struct ProgOptions
   int Nrepeats{defaultNumRepeat()};
   int Nchunk{1};
 
+  int tempering_replicas{1};
+  double tempering_beta_min{0.01};
+
   TomorunReal NMeasAmplifyFactor{TomorunReal(1.0)};
 
   Tomographer::Logger::LogLevel loglevel{Tomographer::Logger::INFO};
@@ -226,7 +243,46 @@ struct ProgOptions
 
   std::string write_histogram{""};
 
+  // --quantum-error-bars: fit the final histogram with x = s*(f-h)
+  bool quantum_error_bars{false};
+  TomorunReal quantum_error_bars_ftox_h{TomorunReal(0)};
+  int quantum_error_bars_ftox_s{1};
+
+  std::string write_samples{""};
+  int write_samples_thin{1};
+
+  std::string write_results{""};
+  // identifies the data set in the --write-results file (the index of the data set in a
+  // --batch file, otherwise zero)
+  int write_results_dataset_id{0};
+
+  std::string checkpoint_file{""};
+  bool resume{false};
+
+  // pin the worker threads to NUMA nodes and replicate the LLH data on each node
+  bool numa{false};
+
+  // number of worker threads (zero: as many as the thread affinity policy suggests)
+  int num_threads{0};
+  // how to pin the worker threads to CPUs, see Tomographer::Tools::ThreadAffinity::fromString()
+  std::string thread_affinity{"none"};
+
   int periodic_status_report_ms{-1};
+
+  std::string batch_file{""};
+
+  std::string serve_socket{""};
+
+  // The following are not program options, they are set up by the job server (see
+  // --serve) for each job it runs.  Where to write the status reports:
+  FILE * fstatusreport{stderr};
+  // if not NULL, the results of the individual random walks are stored here, serialized
+  // with Boost.Serialization:
+  std::string * serialized_task_results{NULL};
+  // if nonzero, the output (log and status reports) is checked every this many
+  // milliseconds (or with each periodic status report, if these are requested), and the
+  // job is interrupted as soon as writing to it failed (e.g. because the client went away):
+  int abort_on_output_error_check_ms{0};
 };
 
 
@@ -251,20 +307,38 @@ inline void ensure_valid_input(bool condition, std::string msg) {
 
 
 
+// Where the options given to parse_options() come from
+enum ProgOptionsSource {
+  OptionsFromCommandLine = 0,
+  OptionsFromBatchFile, // options of a single data set listed in a batch manifest (see --batch)
+  OptionsFromServerJob // options of a job submitted to a tomorun server (see --serve)
+};
+
+// Parse the options given in args.  If source is not OptionsFromCommandLine, then opt must
+// have been initialized with the options given on the command line, which serve as
+// defaults, and filelogger is not used and may be NULL.
 template<typename BaseLoggerType>
-void parse_options(ProgOptions * opt, int argc, char **argv,
-                   BaseLoggerType & baselogger, Tomographer::Logger::FileLogger & filelogger)
+void parse_options(ProgOptions * opt, const std::vector<std::string> & args, ProgOptionsSource source,
+                   BaseLoggerType & baselogger, Tomographer::Logger::FileLogger * filelogger)
 {
   // read the options
   using namespace boost::program_options;
 
   auto logger = Tomographer::Logger::makeLocalLogger("parse_options()", baselogger);
 
+  const bool batch_item = (source == OptionsFromBatchFile);
+  const bool job_item = (source == OptionsFromServerJob);
+
+  // for a data set in a batch, the options given on the command line
+  const ProgOptions batch_opt = *opt;
+
   std::string flogname;
   bool flogname_from_config_file_name = false;
 
   std::string valhiststr;
 
+  std::string querrorbarsstr;
+
   std::string configfname;
   std::string configdir;
   std::string configbasename;
@@ -279,6 +353,9 @@ void parse_options(ProgOptions * opt, int argc, char **argv,
   bool control_step_size_set = false;
   bool no_control_step_size_set = false;
 
+  bool control_sweep_size_set = false;
+  bool no_control_sweep_size_set = false;
+
   bool control_binning_converged_set = false;
   bool no_control_binning_converged_set = false;
 
@@ -291,8 +368,25 @@ void parse_options(ProgOptions * opt, int argc, char **argv,
      "Which value to acquire histogram of, e.g. fidelity to MLE. Possible values are 'fidelity', "
      "'purif-dist', 'tr-dist' or 'obs-value'. The value type may be followed by ':ObjName' to refer "
      "to a particular object defined in the datafile. See below for more info.")
+    ("extra-value-type", value<std::vector<figure_of_merit_spec> >(& opt->extra_valtypes)->composing(),
+     "Also acquire a histogram of this figure of merit, in the same random walks as the main "
+     "--value-type. May be specified several times. Same syntax as --value-type. The histogram "
+     "range of each extra figure of merit is chosen automatically during thermalization (see "
+     "--value-hist=auto), with as many bins as for the main histogram, and error bars are "
+     "always determined by binning analysis.")
     ("value-hist", value<std::string>(&valhiststr),
-     "Do a histogram of the figure of merit for different measured values. Format MIN:MAX/NUM_BINS")
+     "Do a histogram of the figure of merit for different measured values. Format MIN:MAX/NUM_BINS. "
+     "Use 'auto/NUM_BINS' to choose the range automatically during thermalization, or "
+     "'auto:MIN:MAX/NUM_BINS' to choose it automatically within the bounds [MIN,MAX].")
+    ("value-hist-auto-pilot-samples", value<Eigen::Index>(& opt->val_hist_auto_pilot_samples)
+     ->default_value(opt->val_hist_auto_pilot_samples),
+     "With --value-hist=auto, the number of values (one per thermalization sweep, the most recent "
+     "ones) on which the histogram range is based.")
+    ("value-hist-auto-max-overflow", value<Eigen::Index>(& opt->val_hist_auto_max_overflow)
+     ->default_value(opt->val_hist_auto_max_overflow),
+     "With --value-hist=auto, the maximum number of samples falling outside of the chosen range "
+     "which are remembered, such that the range can be extended to include them at the end "
+     "of the random walk. Further samples outside of the range are lost.")
     ("light-jumps", bool_switch(& light_jumps_set)->default_value(light_jumps_set),
      "Carry out the \"light\" version of the random walk, where instead of moving the "
      "bipartite purified state vector uniformly on the hypersphere, we apply a random "
@@ -339,6 +433,20 @@ void parse_options(ProgOptions * opt, int argc, char **argv,
      "The number of most recent samples to use when calculating the moving average of "
      "the acceptance ratio.  Used only for dynamically adjusting the step size when "
      "--control-step-size is set.")
+    ("control-sweep-size", bool_switch(& control_sweep_size_set)->default_value(false),
+     Tomographer::Tools::fmts(
+         "Measure the autocorrelation time of the figure of merit during the last %.2f*n_therm "
+         "thermalization sweeps, and set the sweep size to %.1f times this autocorrelation time "
+         "for the live runs, so that the samples are approximately independent. The "
+         "thermalization runs may be prolonged (up to %.1f*n_therm sweeps) until the estimate "
+         "of the autocorrelation time has converged. This option is disabled by default.",
+         1 - Tomographer::MHRWSweepSizeControllerDefaults::SkipNThermFraction,
+         Tomographer::MHRWSweepSizeControllerDefaults::SampleSpacingTauInt,
+         Tomographer::MHRWSweepSizeControllerDefaults::MaxAddThermIters
+         ).c_str())
+    ("no-control-sweep-size", bool_switch(& no_control_sweep_size_set)->default_value(false),
+     "Use the given sweep size for the live runs (possibly adjusted along with the step size, "
+     "see --control-step-size).")
     ("control-binning-converged", bool_switch(& control_binning_converged_set)->default_value(false),
      "When calculating error bars via a binning analysis, ensure that the error bars have "
      "converged for (almost) all bins (see fine-tuning options below) before terminating "
@@ -385,12 +493,47 @@ void parse_options(ProgOptions * opt, int argc, char **argv,
      "number of times to repeat the metropolis procedure")
     ("n-chunk", value<int>(& opt->Nchunk)->default_value(opt->Nchunk),
      "OBSOLETE OPTION -- has no effect")
+    ("tempering-replicas", value<int>(& opt->tempering_replicas)->default_value(opt->tempering_replicas),
+     "Run each random walk as a parallel tempering (replica exchange) random walk with this number "
+     "of replicas, which sample the likelihood raised to powers 1 > beta_1 > ... >= "
+     "<tempering-beta-min> and which exchange their points at the end of each sweep. Only the "
+     "samples of the replica at beta=1 are collected. This helps the random walk to mix when the "
+     "likelihood is very peaked, at the cost of evaluating the likelihood for each replica. The "
+     "default, 1, runs a usual random walk.")
+    ("tempering-beta-min", value<double>(& opt->tempering_beta_min)->default_value(opt->tempering_beta_min),
+     "With --tempering-replicas, the power to which the likelihood is raised for the hottest "
+     "replica. The powers of the other replicas are spaced geometrically between 1 and this value.")
     ("n-meas-amplify-factor", value<TomorunReal>(& opt->NMeasAmplifyFactor)
      ->default_value(opt->NMeasAmplifyFactor),
      "Specify an integer factor by which to multiply number of measurements. "
      "Don't use this. It's unphysical, and meant just for debugging Tomographer itself.")
     ("write-histogram", value<std::string>(& opt->write_histogram),
      "write the histogram to the given file in tabbed CSV values")
+    ("quantum-error-bars", value<std::string>(& querrorbarsstr)->implicit_value("auto"),
+     "fit the final histogram of the figure of merit and print the quantum error bars. The fit "
+     "is done in the variable x = S*(f-H), where f is the figure of merit, which you may specify "
+     "as an argument H,S with S being 1 or -1 (for instance, use 1,-1 for x=1-f). By default, or "
+     "with 'auto', x=1-f is used for the fidelity and x=f for the other figures of merit.")
+    ("write-samples", value<std::string>(& opt->write_samples),
+     "write all the samples of the random walks to the given file, in a binary format which can be "
+     "read with the python module tomographer.samplestream. For each sample, the file stores the "
+     "number of the random walk, the log-likelihood and the X-parameterization of the density matrix.")
+    ("write-samples-thin", value<int>(& opt->write_samples_thin)->default_value(opt->write_samples_thin),
+     "only write every so many samples to the file given by --write-samples.")
+    ("write-results", value<std::string>(& opt->write_results),
+     "append the histogram of each random walk and the final histogram to the given file, in a "
+     "compact binary format which can be read with the python module tomographer.resultsfile. "
+     "With --batch, the results of all data sets may be written to the same file; they are "
+     "identified by the index of the data set in the batch file.")
+    ("checkpoint", value<std::string>(& opt->checkpoint_file),
+     "save the result of each random walk to the given file as soon as it completes. If tomorun "
+     "is interrupted, run it again with the same options and with --resume to skip the random "
+     "walks which were already completed. The state of the random walks which were still "
+     "running is not saved; these are started again from scratch (use a larger --n-repeats "
+     "with a smaller --n-run to lose less work).")
+    ("resume", bool_switch(& opt->resume)->default_value(opt->resume),
+     "resume an interrupted computation using the file given by --checkpoint. All other options "
+     "must be the same as for the interrupted run.")
     ("verbose", value<Tomographer::Logger::LogLevel>(& opt->loglevel)->default_value(opt->loglevel)
      ->implicit_value(Tomographer::Logger::DEBUG),
      "print verbose information. Not very readable unless n-repeats=1. You may also specify "
@@ -401,6 +544,25 @@ void parse_options(ProgOptions * opt, int argc, char **argv,
     ("nice", value<int>(& opt->nice_level)->default_value(opt->nice_level),
      "Renice the process to the given level to avoid slowing down the whole system. Set to zero "
      "to avoid renicing.")
+    ("numa", bool_switch(& opt->numa)->default_value(opt->numa),
+     "On machines with several NUMA nodes (e.g. several CPU sockets), pin the worker threads to "
+     "the CPUs of the nodes (unless another --thread-affinity is given) and give each node its "
+     "own copy of the measurement data, so that the random walks only access local memory. The "
+     "detected topology is reported in the log. (Only Linux is supported; this has no effect "
+     "elsewhere.)")
+    ("num-threads", value<int>(& opt->num_threads)->default_value(opt->num_threads),
+     "The number of worker threads running the random walks in parallel. The default (zero) "
+     "uses one thread per available CPU, or per physical core with --thread-affinity=cores, or "
+     "per CPU given to --thread-affinity. Set a lower value to leave some CPUs free for other "
+     "work.")
+    ("thread-affinity", value<std::string>(& opt->thread_affinity)->default_value(opt->thread_affinity),
+     "Pin the worker threads to CPUs: 'none' (let the system decide), 'numa' (spread threads "
+     "over NUMA nodes, see --numa), 'compact' (fill up neighboring CPUs, including SMT "
+     "siblings, first), 'scatter' (spread threads as far apart as possible), 'cores' (one "
+     "thread per physical core, leave SMT siblings unused), or an explicit list of CPUs, "
+     "e.g. '0-7,16-23'. Only the CPUs on which tomorun is allowed to run (e.g. via taskset) "
+     "are considered. The chosen placement is reported in the log. (Only Linux is supported; "
+     "threads are not pinned elsewhere.)")
     ("log", value<std::string>(& flogname),
      "Redirect standard output (log) to the given file. Use '-' for stdout. If file exists, will append.")
     ("log-from-config-file-name", bool_switch(& flogname_from_config_file_name)->default_value(false),
@@ -419,6 +581,22 @@ void parse_options(ProgOptions * opt, int argc, char **argv,
      "If set to a value > 0, then tomorun will produce a status report every so many milliseconds. "
      "The format of the status report is the same as when you hit Ctrl+C. You can still get reports "
      "anytime by hitting Ctrl+C.")
+    ("batch", value<std::string>(& opt->batch_file),
+     "Process several data sets with a single pool of workers. The given file lists one data set "
+     "per line, with the options specific to that data set in command line syntax, e.g. "
+     "\"--data-file-name=a.mat --write-histogram=a\" or \"--config=a.conf\" (empty lines and lines "
+     "starting with '#' are ignored). The options given on the command line apply to all data "
+     "sets. The random walks of all data sets are run in parallel, and the results of each data "
+     "set are reported as soon as all its random walks have completed.")
+    ("serve", value<std::string>(& opt->serve_socket),
+     "Run as a server which listens on the given UNIX domain socket, and which runs the jobs "
+     "submitted to it one after the other. A client submits a job by connecting to the socket and "
+     "sending a single line with the options of the job, in command line syntax (e.g. "
+     "\"--data-file-name=a.mat --value-type=fidelity\"). The options given on the command line serve "
+     "as defaults for all jobs. The server sends back tomorun's output as the job runs, including "
+     "the periodic status reports, and finally a line \"TOMORUN-SERVER-RESULT <n>\" followed by "
+     "<n> bytes with the results of the individual random walks serialized with Boost.Serialization "
+     "(binary archive), or a line \"TOMORUN-SERVER-ERROR <message>\" if the job failed.")
     ("version",
      "Print Tomographer/Tomorun version information as well as information about enabled features.")
     ("help", "Print this help message")
@@ -429,10 +607,10 @@ void parse_options(ProgOptions * opt, int argc, char **argv,
 
   try {
     variables_map vm;
-    store(command_line_parser(argc, argv).options(desc).positional(p).run(), vm);
+    store(command_line_parser(args).options(desc).positional(p).run(), vm);
 
 
-    if (vm.count("help")) {
+    if (source == OptionsFromCommandLine && vm.count("help")) {
     Tomographer::Tools::FmtFootnotes footnotes;
     // Reference [1]
     footnotes.addSilentFootNote(1, "Christandl and Renner, Phys. Rev. Lett. 12:120403 (2012), arXiv:1108.5329");
@@ -448,6 +626,8 @@ void parse_options(ProgOptions * opt, int argc, char **argv,
       "\n"
       "Usage: tomorun --data-file-name=<data-file-name> [options]\n"
       "       tomorun --config=<tomorun-config-file>\n"
+      "       tomorun --batch=<batch-file> [options]\n"
+      "       tomorun --serve=<socket-file> [options]\n"
       "\n"
 //    |--------------------------------------------------------------------------------| 80 chars (col. 87)
       "Produce a histogram of a figure of merit during a random walk in quantum state\n"
@@ -478,6 +658,12 @@ void parse_options(ProgOptions * opt, int argc, char **argv,
       "      A list of (integer) frequencies. Nm(k) is the number of times the POVM\n"
       "      effect Emn(:,:,k) was observed.\n"
       "\n"
+      "    - Sm (optional)\n"
+      "      A list of (integer) labels of measurement settings. Sm(k) is the\n"
+      "      measurement setting to which the POVM effect Emn(:,:,k) belongs. If\n"
+      "      given, `tomorun` checks that the effects of each setting sum up to the\n"
+      "      identity.\n"
+      "\n"
       "    - <any other variable name>\n"
       "      The MATLAB data file may contain further variables for use in some\n"
       "      figures of merit. See below.\n"
@@ -518,10 +704,10 @@ void parse_options(ProgOptions * opt, int argc, char **argv,
       "      instanciated). There is no fourth column if binning analysis is disabled.\n"
       "\n"
       "FIGURES OF MERIT:\n"
-      "The argument to the option --value-type should be specified as \"keyword\" or\n"
-      "\"keyword:<RefObject>\". <RefObject> should be the name of a MATLAB variable\n"
-      "present in the data file provided to --data-file-name. The possible keywords and\n"
-      "corresponding possible reference variables are:\n"
+      "The argument to the options --value-type and --extra-value-type should be\n"
+      "specified as \"keyword\" or \"keyword:<RefObject>\". <RefObject> should be the\n"
+      "name of a MATLAB variable present in the data file provided to --data-file-name.\n"
+      "The possible keywords and corresponding possible reference variables are:\n"
       "\n"
       ;
     PrintFigsOfMerit<TomorunFiguresOfMerit>::print(stream, footnotes);
@@ -553,7 +739,7 @@ void parse_options(ProgOptions * opt, int argc, char **argv,
       ::exit(1);
     }
 
-    if (vm.count("version")) {
+    if (source == OptionsFromCommandLine && vm.count("version")) {
       std::cout << prog_version_info
 		<< "----\n"
 		<< "using:\n"
@@ -593,6 +779,30 @@ void parse_options(ProgOptions * opt, int argc, char **argv,
       }
     }
 
+    if (batch_item) {
+      // these options concern the whole tomorun process
+      for (const char * optname : {"batch", "serve", "log", "log-from-config-file-name", "verbose", "verbose-log-info",
+                                   "nice", "numa", "num-threads", "thread-affinity", "periodic-status-report-ms",
+                                   "checkpoint", "resume",
+                                   "help", "version"}) {
+        if (vm.count(optname) && !vm[optname].defaulted()) {
+          throw bad_options(streamstr("--" << optname << " can't be specified for a single data set "
+                                      "of a batch, specify it on the command line instead"));
+        }
+      }
+    }
+    if (job_item) {
+      // these options concern the whole server
+      for (const char * optname : {"batch", "serve", "log", "log-from-config-file-name", "verbose",
+                                   "verbose-log-info", "nice", "numa", "num-threads", "thread-affinity",
+                                   "checkpoint", "resume", "help", "version"}) {
+        if (vm.count(optname) && !vm[optname].defaulted()) {
+          throw bad_options(streamstr("--" << optname << " can't be specified for a job submitted "
+                                      "to a tomorun server"));
+        }
+      }
+    }
+
     notify(vm);
   } catch (const bad_options&) {
     throw;
@@ -603,45 +813,47 @@ void parse_options(ProgOptions * opt, int argc, char **argv,
   // First thing: set up logging, so that we can issue log messages.
   // --------------------
 
-  // set up level and verbosity
-  filelogger.setLevel(opt->loglevel);
-  filelogger.setDisplayOrigin(opt->verbose_log_info);
-  // maybe set up log file name from config file name
-  if (flogname_from_config_file_name) {
-    if (!configfname.size()) {
-      throw bad_options("--log-from-config-file-name may only be used with --config");
-    }
-    if (flogname.size()) {
-      throw bad_options("--log-from-config-file-name may not be used with --log");
-    }
-    flogname = configdir + "/" + configbasename + std::string(".log");
-  }
-  // prepare log file, and maybe write out header
-  if (flogname.size() == 0 || flogname == "-") {
-    opt->flog = stdout;
-  } else {
-    opt->flog = fopen(flogname.c_str(), "a");
-    if (opt->flog == NULL) {
-      throw bad_options(streamstr("Can't open file "<<flogname<<" for logging: " << strerror(errno)));
+  if (source == OptionsFromCommandLine) {
+    // set up level and verbosity
+    filelogger->setLevel(opt->loglevel);
+    filelogger->setDisplayOrigin(opt->verbose_log_info);
+    // maybe set up log file name from config file name
+    if (flogname_from_config_file_name) {
+      if (!configfname.size()) {
+        throw bad_options("--log-from-config-file-name may only be used with --config");
+      }
+      if (flogname.size()) {
+        throw bad_options("--log-from-config-file-name may not be used with --log");
+      }
+      flogname = configdir + "/" + configbasename + std::string(".log");
     }
+    // prepare log file, and maybe write out header
+    if (flogname.size() == 0 || flogname == "-") {
+      opt->flog = stdout;
+    } else {
+      opt->flog = fopen(flogname.c_str(), "a");
+      if (opt->flog == NULL) {
+        throw bad_options(streamstr("Can't open file "<<flogname<<" for logging: " << strerror(errno)));
+      }
 
-    // write out header
-    char curdtstr[128];
-    std::time_t tt;
-    std::time(&tt);
-    std::tm * ptim = localtime(&tt);
-    std::strftime(curdtstr, sizeof(curdtstr), "%c", ptim);
-    std::fprintf(
-        opt->flog,
-        "\n\n\n"
-        "================================================================================\n"
-        "    tomorun -- NEW RUN   on %s\n"
-        "================================================================================\n\n",
-        curdtstr
-        );
-
-    filelogger.setFp(opt->flog);
-    logger.info("Output is now being redirected to %s.", flogname.c_str());
+      // write out header
+      char curdtstr[128];
+      std::time_t tt;
+      std::time(&tt);
+      std::tm * ptim = localtime(&tt);
+      std::strftime(curdtstr, sizeof(curdtstr), "%c", ptim);
+      std::fprintf(
+          opt->flog,
+          "\n\n\n"
+          "================================================================================\n"
+          "    tomorun -- NEW RUN   on %s\n"
+          "================================================================================\n\n",
+          curdtstr
+          );
+
+      filelogger->setFp(opt->flog);
+      logger.info("Output is now being redirected to %s.", flogname.c_str());
+    }
   }
 
   // issue any delayed log messages
@@ -676,8 +888,32 @@ void parse_options(ProgOptions * opt, int argc, char **argv,
 
   SET_OPT_BOOL_SWITCH(control_step_size, control-step-size) ;
 
+  SET_OPT_BOOL_SWITCH(control_sweep_size, control-sweep-size) ;
+
   SET_OPT_BOOL_SWITCH(control_binning_converged, control-binning-converged) ;
 
+  if (batch_item &&
+      (opt->light_jumps != batch_opt.light_jumps ||
+       opt->binning_analysis_error_bars != batch_opt.binning_analysis_error_bars ||
+       opt->control_step_size != batch_opt.control_step_size ||
+       opt->control_binning_converged != batch_opt.control_binning_converged)) {
+    // all the data sets of a batch are run with the same kind of random walk
+    throw bad_options("All data sets of a batch must use the same --[no-]light-jumps, "
+                      "--[no-]binning-analysis-error-bars, --[no-]control-step-size and "
+                      "--[no-]control-binning-converged, specify these on the command line");
+  }
+
+
+  // check the thread placement options
+  if (opt->num_threads < 0) {
+    throw bad_options("--num-threads must be positive, or zero for the default");
+  }
+  try {
+    Tomographer::Tools::ThreadAffinity::fromString(opt->thread_affinity);
+  } catch (const Tomographer::Tools::InvalidThreadAffinity & e) {
+    throw bad_options(streamstr("--thread-affinity: " << e.what()));
+  }
+
 
   // set up write histogram file name from config file name
   if (write_histogram_from_config_file_name) {
@@ -693,13 +929,54 @@ void parse_options(ProgOptions * opt, int argc, char **argv,
 
 
   // make sure we have a data file
-  if (!opt->data_file_name.size()) {
+  if (opt->serve_socket.size()) {
+    // the data files are specified by each job submitted to the server
+    if (opt->data_file_name.size() || opt->batch_file.size() || opt->checkpoint_file.size()) {
+      throw bad_options("--serve can't be used with --data-file-name, --batch or --checkpoint");
+    }
+  } else if (opt->batch_file.size()) {
+    // the data files, and where to write the results, are specified in the batch manifest
+    if (opt->data_file_name.size() || opt->write_histogram.size() || opt->write_samples.size()) {
+      throw bad_options("--data-file-name, --write-histogram and --write-samples must be specified for "
+                        "each data set in the file given to --batch");
+    }
+    if (opt->checkpoint_file.size()) {
+      throw bad_options("--checkpoint can't be used with --batch");
+    }
+  } else if (!opt->data_file_name.size()) {
+    if (source != OptionsFromCommandLine) {
+      throw bad_options("No data file specified with --data-file-name");
+    }
     logger.error("No data file specified. Please specify a MATLAB file with --data-file-name.");
     ::exit(3);
   }
 
   // set up value histogram parameters
-  if (valhiststr.size()) {
+  if (valhiststr.size() && valhiststr.compare(0, 4, "auto") == 0) {
+    double fmin, fmax;
+    int nbins = 50;
+    if (std::sscanf(valhiststr.c_str(), "auto:%lf:%lf/%d", &fmin, &fmax, &nbins) >= 2) {
+      opt->val_hist_auto_lower_bound = (TomorunReal)fmin;
+      opt->val_hist_auto_upper_bound = (TomorunReal)fmax;
+      // also serves as fallback if no range could be determined
+      opt->val_min = (TomorunReal)fmin;
+      opt->val_max = (TomorunReal)fmax;
+    } else if (valhiststr != "auto" && std::sscanf(valhiststr.c_str(), "auto/%d", &nbins) < 1) {
+      throw bad_options("--value-hist=auto expects an argument of format auto[:MIN:MAX][/NUM_BINS]");
+    }
+    if (nbins < 2) {
+      throw bad_options("--value-hist=auto needs at least two bins");
+    }
+    if (opt->val_hist_auto_pilot_samples <= 0) {
+      throw bad_options("--value-hist-auto-pilot-samples must be positive");
+    }
+    opt->val_hist_auto = true;
+    opt->val_nbins = (Eigen::Index)nbins;
+    logger.debug([&](std::ostream & stream) {
+        stream << "Automatic histogram range requested: bounds=[" << opt->val_hist_auto_lower_bound
+               << "," << opt->val_hist_auto_upper_bound << "], num_bins=" << opt->val_nbins;
+      });
+  } else if (valhiststr.size()) {
     double fmin, fmax;
     int nbins = 100;
     if (std::sscanf(valhiststr.c_str(), "%lf:%lf/%d", &fmin, &fmax, &nbins) < 2) {
@@ -714,6 +991,106 @@ void parse_options(ProgOptions * opt, int argc, char **argv,
                << ", num_bins=" << opt->val_nbins ;
       });
   }
+
+  if (querrorbarsstr.size()) {
+    opt->quantum_error_bars = true;
+    if (querrorbarsstr == "auto") {
+      const bool is_fidelity =
+        (streamstr(opt->valtype).compare(0, std::string("fidelity").size(), "fidelity") == 0);
+      opt->quantum_error_bars_ftox_h = (is_fidelity ? TomorunReal(1) : TomorunReal(0));
+      opt->quantum_error_bars_ftox_s = (is_fidelity ? -1 : 1);
+    } else {
+      double h;
+      int s;
+      char dummy;
+      if (std::sscanf(querrorbarsstr.c_str(), "%lf,%d%c", &h, &s, &dummy) != 2 || (s != 1 && s != -1)) {
+        throw bad_options("--quantum-error-bars expects 'auto' or an argument of format H,S with S=1 or S=-1");
+      }
+      opt->quantum_error_bars_ftox_h = (TomorunReal)h;
+      opt->quantum_error_bars_ftox_s = s;
+    }
+  }
+
+  if (opt->write_samples_thin < 1) {
+    throw bad_options("--write-samples-thin must be positive");
+  }
+
+  if (opt->tempering_replicas < 1) {
+    throw bad_options("--tempering-replicas must be positive");
+  }
+  if (!(opt->tempering_beta_min > 0 && opt->tempering_beta_min < 1)) {
+    throw bad_options("--tempering-beta-min must be in the range (0,1)");
+  }
+
+  if (opt->resume && !opt->checkpoint_file.size()) {
+    throw bad_options("--resume requires --checkpoint");
+  }
+  if (opt->resume && opt->write_samples.size()) {
+    throw bad_options("--resume can't be used with --write-samples, because the samples of the "
+                      "random walks completed before the interruption are not available");
+  }
+}
+
+template<typename BaseLoggerType>
+void parse_options(ProgOptions * opt, int argc, char **argv,
+                   BaseLoggerType & baselogger, Tomographer::Logger::FileLogger & filelogger)
+{
+  parse_options(opt, std::vector<std::string>(argv + 1, argv + argc), OptionsFromCommandLine, baselogger, &filelogger);
+}
+
+
+// Read the file given to --batch, and return the options for each data set listed in it
+template<typename BaseLoggerType>
+std::vector<ProgOptions> parse_batch_file(const ProgOptions * opt, BaseLoggerType & baselogger)
+{
+  auto logger = Tomographer::Logger::makeLocalLogger("parse_batch_file()", baselogger);
+
+  std::ifstream inf(opt->batch_file);
+  if (!inf) {
+    throw bad_options(streamstr("Can't open batch file " << opt->batch_file));
+  }
+
+  std::vector<ProgOptions> batch_opts;
+
+  std::string line;
+  int lineno = 0;
+  while (std::getline(inf, line)) {
+    ++lineno;
+    const std::vector<std::string> args = boost::program_options::split_unix(line);
+    if (args.empty() || args[0][0] == '#') {
+      continue;
+    }
+
+    ProgOptions item_opt = *opt;
+    item_opt.batch_file = std::string();
+    item_opt.write_results_dataset_id = (int)batch_opts.size();
+    try {
+      parse_options(&item_opt, args, OptionsFromBatchFile, baselogger, NULL);
+    } catch (const bad_options & ) {
+      logger.error("In batch file %s, line %d:", opt->batch_file.c_str(), lineno);
+      throw;
+    }
+    batch_opts.push_back(std::move(item_opt));
+  }
+
+  if (batch_opts.empty()) {
+    throw bad_options(streamstr("Batch file " << opt->batch_file << " doesn't list any data set"));
+  }
+
+  // make sure the data sets don't overwrite each other's output files
+  std::set<std::string> output_files;
+  for (const auto & item_opt : batch_opts) {
+    for (const std::string & fname : {item_opt.write_histogram, item_opt.write_samples}) {
+      if (fname.size() && !output_files.insert(fname).second) {
+        throw bad_options(streamstr("Several data sets of batch file " << opt->batch_file
+                                    << " write their results to " << fname));
+      }
+    }
+  }
+
+  logger.debug("Read %d data sets from batch file %s", (int)batch_opts.size(), opt->batch_file.c_str());
+
+  return batch_opts;
 }
 
 
@@ -726,42 +1103,72 @@ void parse_options(ProgOptions * opt, int argc, char **argv,
 template<typename LoggerType>
 void display_parameters(ProgOptions * opt, LoggerType & logger)
 {
+  std::string extra_valtypes_str;
+  for (const auto & v : opt->extra_valtypes) {
+    extra_valtypes_str += streamstr(", " << v);
+  }
+
   logger.info(
       // origin
       "display_parameters()",
       // message
       "Using  data from file :     %s  (measurements x%.3g)\n"
       "       random walk jumps :  %s\n"
-      "       value type :         %s\n"
-      "       val. histogram :     [%.2g, %.2g] (%s bins)\n"
+      "       value type :         %s%s\n"
+      "       val. histogram :     %s (%s bins)\n"
       "       error bars :         %s\n"
       "       step size :          %-8.4g%s\n"
       "       sweep size :         %-8s%s\n"
       "       # therm sweeps :     %s\n"
       "       # run sweeps :       %-8s%s\n"
       "       # intgr. repeats :   %d\n"
+      "       tempering :          %s\n"
       "       write histogram to : %s\n"
+      "       write samples to :   %s\n"
+      "       write results to :   %s\n"
+      "       checkpoint file :    %s\n"
       "\n"
       "       --> total no. of live samples = %s  (%.2e)\n"
       "\n",
       opt->data_file_name.c_str(), (double)opt->NMeasAmplifyFactor,
       (opt->light_jumps ? "\"light\"" : "\"full\""),
       streamcstr(opt->valtype),
-      (double)opt->val_min, (double)opt->val_max, streamcstr(opt->val_nbins),
+      extra_valtypes_str.c_str(),
+      (opt->val_hist_auto
+       ? Tomographer::Tools::fmts("auto within [%.2g, %.2g]", (double)opt->val_hist_auto_lower_bound,
+                                  (double)opt->val_hist_auto_upper_bound)
+       : Tomographer::Tools::fmts("[%.2g, %.2g]", (double)opt->val_min, (double)opt->val_max)).c_str(),
+      streamcstr(opt->val_nbins),
       (opt->binning_analysis_error_bars
        ? Tomographer::Tools::fmts("binning analysis (%d levels)", opt->binning_analysis_num_levels).c_str()
        : "std. dev. of runs"),
       (double)opt->step_size,
       (opt->control_step_size ? "  (dyn. adjustment enabled)" : ""),
       streamcstr(opt->Nsweep),
-      (opt->control_step_size ? "  (dyn. adjustment enabled)" : ""),
+      (opt->control_sweep_size ? "  (set from autocorrelation time)"
+       : (opt->control_step_size ? "  (dyn. adjustment enabled)" : "")),
       streamcstr(opt->Ntherm),
       streamcstr(opt->Nrun),
       (opt->control_binning_converged ? "  (dyn. control of convergence)" : ""),
       (int)opt->Nrepeats,
+      (opt->tempering_replicas > 1
+       ? Tomographer::Tools::fmts("%d replicas, beta down to %.3g", opt->tempering_replicas,
+                                  opt->tempering_beta_min)
+       : std::string("<no tempering>")).c_str(),
       (opt->write_histogram.size()
        ? opt->write_histogram + std::string("-histogram.csv")
        : std::string("<don't write histogram>")).c_str(),
+      (opt->write_samples.size()
+       ? (opt->write_samples_thin > 1
+          ? Tomographer::Tools::fmts("%s  (every %d-th sample)", opt->write_samples.c_str(), opt->write_samples_thin)
+          : opt->write_samples)
+       : std::string("<don't write samples>")).c_str(),
+      (opt->write_results.size()
+       ? opt->write_results
+       : std::string("<don't write results>")).c_str(),
+      (opt->checkpoint_file.size()
+       ? (opt->resume ? opt->checkpoint_file + std::string("  (resume)") : opt->checkpoint_file)
+       : std::string("<no checkpoint>")).c_str(),
       streamcstr(opt->Nrun*(TomorunInt)opt->Nrepeats),
       (double)(opt->Nrun*(TomorunInt)opt->Nrepeats)
       );
@@ -0,0 +1,294 @@
+/* This file is part of the Tomographer project, which is distributed under the
+ * terms of the MIT license.
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 ETH Zurich, Institute for Theoretical Physics, Philippe Faist
+ * Copyright (c) 2017 Caltech, Institute for Quantum Information and Matter, Philippe Faist
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TOMORUN_SERVER
+#define TOMORUN_SERVER
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#include <unistd.h>
+#ifndef TOMORUN_NOT_HAVE_UNIX_SOCKETS
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#endif
+
+#include <boost/program_options/parsers.hpp> // split_unix()
+
+#include <tomographer/tools/cxxutil.h>
+#include <tomographer/tools/loggers.h>
+#include <tomographer/tools/ezmatio.h>
+
+
+// -----------------------------------------------------------------------------
+// Job server (--serve)
+// -----------------------------------------------------------------------------
+//
+// The server listens on a UNIX domain socket and runs the jobs submitted to it one after
+// the other, each one with the full pool of workers.  A client connects to the socket and
+// sends a single line with the options of its job, in command line syntax.  The server
+// sends back everything tomorun outputs while running the job, including the status
+// reports, and finally either
+//
+//   TOMORUN-SERVER-RESULT <n>\n<n bytes>
+//
+// where the <n> bytes are the results of the individual random walks, serialized with
+// Boost.Serialization (binary archive: the number of results followed by each
+// MHRandomWalkTaskResult), or
+//
+//   TOMORUN-SERVER-ERROR <message>\n
+//
+// if the job failed.  The server then closes the connection.
+//
+// The server doesn't wait forever for a client: the job line must arrive within
+// tomorun_server_client_timeout_s seconds and be at most tomorun_server_max_job_line_size
+// bytes long, and a client which stops reading its output makes the writes time out.  If
+// writing to the client fails, the job is interrupted.
+//
+
+
+TOMOGRAPHER_DEFINE_MSG_EXCEPTION(server_error, "Tomorun server: ") ;
+
+
+#ifndef TOMORUN_NOT_HAVE_UNIX_SOCKETS
+
+static const int tomorun_server_client_timeout_s = 60;
+static const std::size_t tomorun_server_max_job_line_size = 65536;
+// interval at which the output to the client is checked while a job is running
+static const int tomorun_server_output_check_ms = 1000;
+
+
+// Don't let a client block the server forever by not sending its job or not reading its
+// output
+inline void tomorun_server_set_client_timeouts(int fd)
+{
+  struct timeval tv;
+  tv.tv_sec = tomorun_server_client_timeout_s;
+  tv.tv_usec = 0;
+  if (::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0 ||
+      ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) < 0) {
+    throw server_error(streamstr("Can't set timeouts on client connection: " << strerror(errno)));
+  }
+}
+
+
+// Read the options of a job from the client connection fd, up to the first newline.  The
+// client doesn't send anything after the job line, so we may read ahead.
+inline std::string tomorun_server_read_job_line(int fd)
+{
+  std::string line;
+  char buf[1024];
+  for (;;) {
+    const ssize_t n = ::read(fd, buf, sizeof(buf));
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        throw server_error("Timed out waiting for job from client");
+      }
+      throw server_error(streamstr("Can't read job from client: " << strerror(errno)));
+    }
+    if (n == 0) {
+      break;
+    }
+    const char * end = std::find(buf, buf + n, '\n');
+    line.append(buf, (std::size_t)(end - buf));
+    if (line.size() > tomorun_server_max_job_line_size) {
+      throw server_error(streamstr("Job line from client exceeds " << tomorun_server_max_job_line_size
+                                   << " bytes"));
+    }
+    if (end != buf + n) {
+      break;
+    }
+  }
+  return line;
+}
+
+
+// Run the job submitted on the client connection fd.  All output is redirected to the
+// client while the job is running.
+template<typename BaseLoggerType>
+inline void tomorun_server_run_job(int fd, const ProgOptions * server_opt, BaseLoggerType & baselogger,
+                                   Tomographer::Logger::FileLogger & filelogger)
+{
+  auto logger = Tomographer::Logger::makeLocalLogger(TOMO_ORIGIN, baselogger);
+
+  const std::string job_line = tomorun_server_read_job_line(fd);
+  logger.info("Received job: %s", job_line.c_str());
+
+  const int jobfd = ::dup(fd);
+  FILE * fjob = (jobfd >= 0) ? fdopen(jobfd, "w") : NULL;
+  if (fjob == NULL) {
+    throw server_error(streamstr("Can't set up output to client: " << strerror(errno)));
+  }
+  // forward the output to the client as it is produced
+  std::setvbuf(fjob, NULL, _IOLBF, 0);
+
+  std::string serialized_task_results;
+  std::string error_msg;
+
+  // we only ever touch the file logger between jobs, while no worker is running
+  filelogger.setFp(fjob);
+
+  try {
+    // the options given on the server's command line serve as defaults
+    ProgOptions opt = *server_opt;
+    opt.serve_socket = std::string();
+
+    parse_options(&opt, boost::program_options::split_unix(job_line), OptionsFromServerJob, baselogger, NULL);
+
+    opt.flog = fjob;
+    opt.fstatusreport = fjob;
+    opt.serialized_task_results = &serialized_task_results;
+    opt.abort_on_output_error_check_ms = tomorun_server_output_check_ms;
+
+    opt.binning_analysis_num_levels =
+      Tomographer::sanitizeBinningLevels(opt.binning_analysis_num_levels,
+                                         opt.Nrun,
+                                         last_binning_level_warn_min_samples,
+                                         logger) ;
+
+    display_parameters(&opt, baselogger);
+
+    Tomographer::MAT::File matf(opt.data_file_name);
+    const int dim = Tomographer::MAT::value<int>(matf.var("dim"));
+
+    tomorun_dispatch_dim(dim, &opt, &matf, baselogger);
+
+  } catch (const std::exception & e) {
+    error_msg = e.what();
+    // keep the reply on a single line
+    std::replace(error_msg.begin(), error_msg.end(), '\n', ' ');
+    logger.error("%s", error_msg.c_str());
+  }
+
+  // a write error may have occurred earlier while running the job, hence ferror()
+  bool write_ok = !std::ferror(fjob);
+  if (write_ok) {
+    if (error_msg.size()) {
+      write_ok = (std::fprintf(fjob, "TOMORUN-SERVER-ERROR %s\n", error_msg.c_str()) >= 0);
+    } else {
+      write_ok = (std::fprintf(fjob, "TOMORUN-SERVER-RESULT %lu\n",
+                               (unsigned long)serialized_task_results.size()) >= 0 &&
+                  std::fwrite(serialized_task_results.data(), 1, serialized_task_results.size(), fjob)
+                  == serialized_task_results.size());
+    }
+  }
+  write_ok = (std::fclose(fjob) == 0) && write_ok;
+
+  filelogger.setFp(server_opt->flog);
+
+  if (!write_ok) {
+    throw server_error("Lost connection to client, job output was not delivered");
+  }
+  if (error_msg.size()) {
+    logger.warning("Job failed: %s", error_msg.c_str());
+  } else {
+    logger.info("Job completed.");
+  }
+}
+
+
+//
+// Run as a server listening on the socket opt->serve_socket.  This function only returns
+// by throwing an exception.
+//
+template<typename BaseLoggerType>
+inline void tomorun_serve(const ProgOptions * opt, BaseLoggerType & baselogger,
+                          Tomographer::Logger::FileLogger & filelogger)
+{
+  auto logger = Tomographer::Logger::makeLocalLogger(TOMO_ORIGIN, baselogger);
+
+  struct sockaddr_un addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (opt->serve_socket.size() >= sizeof(addr.sun_path)) {
+    throw server_error(streamstr("Socket file name is too long: " << opt->serve_socket));
+  }
+  std::strncpy(addr.sun_path, opt->serve_socket.c_str(), sizeof(addr.sun_path) - 1);
+
+  const int sock = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sock < 0) {
+    throw server_error(streamstr("Can't create socket: " << strerror(errno)));
+  }
+  auto close_sock = Tomographer::Tools::finally([sock] { ::close(sock); });
+
+  // remove any stale socket file left behind by a previous server
+  ::unlink(opt->serve_socket.c_str());
+  if (::bind(sock, (const struct sockaddr *) &addr, sizeof(addr)) < 0) {
+    throw server_error(streamstr("Can't bind socket to " << opt->serve_socket << ": " << strerror(errno)));
+  }
+  if (::listen(sock, 16) < 0) {
+    throw server_error(streamstr("Can't listen on socket " << opt->serve_socket << ": " << strerror(errno)));
+  }
+
+  // don't die if a client goes away before its job is finished
+  signal(SIGPIPE, SIG_IGN);
+
+  logger.info("Listening for jobs on %s", opt->serve_socket.c_str());
+
+  for (;;) {
+    const int fd = ::accept(sock, NULL, NULL);
+    if (fd < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw server_error(streamstr("Can't accept connection: " << strerror(errno)));
+    }
+    auto close_fd = Tomographer::Tools::finally([fd] { ::close(fd); });
+
+    try {
+      tomorun_server_set_client_timeouts(fd);
+      tomorun_server_run_job(fd, opt, baselogger, filelogger);
+    } catch (const server_error & e) {
+      // problem with this client only, keep serving
+      logger.warning("%s", e.what());
+    }
+  }
+}
+
+#else
+
+template<typename BaseLoggerType>
+inline void tomorun_serve(const ProgOptions * , BaseLoggerType & , Tomographer::Logger::FileLogger & )
+{
+  throw server_error("--serve is not supported on this system");
+}
+
+#endif
+
+
+
+#endif